@@ -5,6 +5,7 @@
  * Copyright (C) 2017 Linaro Ltd <ard.biesheuvel@linaro.org>
  */
 
+#include <asm/cputype.h>
 #include <asm/neon.h>
 #include <asm/simd.h>
 #include <crypto/aes.h>
@@ -15,6 +16,7 @@
 #include <crypto/scatterwalk.h>
 #include <crypto/xts.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 
 MODULE_AUTHOR("Ard Biesheuvel <ard.biesheuvel@linaro.org>");
 MODULE_LICENSE("GPL v2");
@@ -26,6 +28,11 @@ MODULE_ALIAS_CRYPTO("xts(aes)");
 
 MODULE_IMPORT_NS(CRYPTO_INTERNAL);
 
+static int a9_sched = -1;
+module_param(a9_sched, int, 0444);
+MODULE_PARM_DESC(a9_sched, "Use the Cortex-A9 schedule for CTR and XTS "
+		 "(-1: on Cortex-A9 only, 0: never, 1: always)");
+
 asmlinkage void aesbs_convert_key(u8 out[], u32 const rk[], int rounds);
 
 asmlinkage void aesbs_ecb_encrypt(u8 out[], u8 const in[], u8 const rk[],
@@ -38,11 +45,34 @@ asmlinkage void aesbs_cbc_decrypt(u8 out[], u8 const in[], u8 const rk[],
 
 asmlinkage void aesbs_ctr_encrypt(u8 out[], u8 const in[], u8 const rk[],
 				  int rounds, int blocks, u8 ctr[], u8 final[]);
+asmlinkage void aesbs_ctr_encrypt_a9(u8 out[], u8 const in[], u8 const rk[],
+				     int rounds, int blocks, u8 ctr[],
+				     u8 final[]);
 
 asmlinkage void aesbs_xts_encrypt(u8 out[], u8 const in[], u8 const rk[],
 				  int rounds, int blocks, u8 iv[], int);
 asmlinkage void aesbs_xts_decrypt(u8 out[], u8 const in[], u8 const rk[],
 				  int rounds, int blocks, u8 iv[], int);
+asmlinkage void aesbs_xts_encrypt_a9(u8 out[], u8 const in[], u8 const rk[],
+				     int rounds, int blocks, u8 iv[], int);
+asmlinkage void aesbs_xts_decrypt_a9(u8 out[], u8 const in[], u8 const rk[],
+				     int rounds, int blocks, u8 iv[], int);
+
+/* used by the fused gcm(aes) in ghash-ce-glue.c */
+EXPORT_SYMBOL_GPL(aesbs_convert_key);
+EXPORT_SYMBOL_GPL(aesbs_ctr_encrypt);
+
+/* CTR and XTS routines for this CPU, picked by aes_init() */
+static void (*aesbs_ctr_encrypt_fn)(u8 out[], u8 const in[], u8 const rk[],
+				    int rounds, int blocks, u8 ctr[],
+				    u8 final[]) __ro_after_init =
+	aesbs_ctr_encrypt;
+static void (*aesbs_xts_encrypt_fn)(u8 out[], u8 const in[], u8 const rk[],
+				    int rounds, int blocks, u8 iv[],
+				    int) __ro_after_init = aesbs_xts_encrypt;
+static void (*aesbs_xts_decrypt_fn)(u8 out[], u8 const in[], u8 const rk[],
+				    int rounds, int blocks, u8 iv[],
+				    int) __ro_after_init = aesbs_xts_decrypt;
 
 struct aesbs_ctx {
 	int	rounds;
@@ -253,8 +283,9 @@ static int ctr_encrypt(struct skcipher_request *req)
 		}
 
 		kernel_neon_begin();
-		aesbs_ctr_encrypt(walk.dst.virt.addr, walk.src.virt.addr,
-				  ctx->rk, ctx->rounds, blocks, walk.iv, final);
+		aesbs_ctr_encrypt_fn(walk.dst.virt.addr, walk.src.virt.addr,
+				     ctx->rk, ctx->rounds, blocks, walk.iv,
+				     final);
 		kernel_neon_end();
 
 		if (final) {
@@ -415,12 +446,12 @@ static int __xts_crypt(struct skcipher_request *req, bool encrypt,
 
 static int xts_encrypt(struct skcipher_request *req)
 {
-	return __xts_crypt(req, true, aesbs_xts_encrypt);
+	return __xts_crypt(req, true, aesbs_xts_encrypt_fn);
 }
 
 static int xts_decrypt(struct skcipher_request *req)
 {
-	return __xts_crypt(req, false, aesbs_xts_decrypt);
+	return __xts_crypt(req, false, aesbs_xts_decrypt_fn);
 }
 
 static struct skcipher_alg aes_algs[] = { {
@@ -535,6 +566,13 @@ static int __init aes_init(void)
 	if (!(elf_hwcap & HWCAP_NEON))
 		return -ENODEV;
 
+	if (a9_sched > 0 ||
+	    (a9_sched < 0 && read_cpuid_part() == ARM_CPU_PART_CORTEX_A9)) {
+		aesbs_ctr_encrypt_fn = aesbs_ctr_encrypt_a9;
+		aesbs_xts_encrypt_fn = aesbs_xts_encrypt_a9;
+		aesbs_xts_decrypt_fn = aesbs_xts_decrypt_a9;
+	}
+
 	err = crypto_register_skciphers(aes_algs, ARRAY_SIZE(aes_algs));
 	if (err)
 		return err;
@@ -9,11 +9,17 @@
 #include <asm/neon.h>
 #include <asm/simd.h>
 #include <asm/unaligned.h>
+#include <crypto/aes.h>
+#include <crypto/algapi.h>
 #include <crypto/b128ops.h>
 #include <crypto/cryptd.h>
+#include <crypto/gcm.h>
+#include <crypto/internal/aead.h>
 #include <crypto/internal/hash.h>
 #include <crypto/internal/simd.h>
+#include <crypto/internal/skcipher.h>
 #include <crypto/gf128mul.h>
+#include <crypto/scatterwalk.h>
 #include <linux/cpufeature.h>
 #include <linux/crypto.h>
 #include <linux/jump_label.h>
@@ -23,6 +29,7 @@ MODULE_DESCRIPTION("GHASH hash function using ARMv8 Crypto Extensions");
 MODULE_AUTHOR("Ard Biesheuvel <ard.biesheuvel@linaro.org>");
 MODULE_LICENSE("GPL v2");
 MODULE_ALIAS_CRYPTO("ghash");
+MODULE_ALIAS_CRYPTO("gcm(aes)");
 
 #define GHASH_BLOCK_SIZE	16
 #define GHASH_DIGEST_SIZE	16
@@ -42,12 +49,24 @@ struct ghash_async_ctx {
 	struct cryptd_ahash *cryptd_tfm;
 };
 
+struct gcm_aes_ctx {
+	u8			rk[13 * (8 * AES_BLOCK_SIZE) + 32] __aligned(AES_BLOCK_SIZE);
+	int			rounds;
+	struct crypto_aes_ctx	aes_key;
+	struct ghash_key	ghash_key;
+};
+
 asmlinkage void pmull_ghash_update_p64(int blocks, u64 dg[], const char *src,
 				       u64 const h[][2], const char *head);
 
 asmlinkage void pmull_ghash_update_p8(int blocks, u64 dg[], const char *src,
 				      u64 const h[][2], const char *head);
 
+/* bit sliced AES from aes-neonbs-core.S */
+asmlinkage void aesbs_convert_key(u8 out[], u32 const rk[], int rounds);
+asmlinkage void aesbs_ctr_encrypt(u8 out[], u8 const in[], u8 const rk[],
+				  int rounds, int blocks, u8 ctr[], u8 final[]);
+
 static __ro_after_init DEFINE_STATIC_KEY_FALSE(use_p64);
 
 static int ghash_init(struct shash_desc *desc)
@@ -58,36 +77,49 @@ static int ghash_init(struct shash_desc *desc)
 	return 0;
 }
 
+/* must be called between kernel_neon_begin() and kernel_neon_end() */
+static void ghash_do_simd_update(int blocks, u64 dg[], const char *src,
+				 struct ghash_key *key, const char *head)
+{
+	if (static_branch_likely(&use_p64))
+		pmull_ghash_update_p64(blocks, dg, src, key->h, head);
+	else
+		pmull_ghash_update_p8(blocks, dg, src, key->h, head);
+}
+
+static void ghash_do_generic_update(int blocks, u64 dg[], const char *src,
+				    struct ghash_key *key, const char *head)
+{
+	be128 dst = { cpu_to_be64(dg[1]), cpu_to_be64(dg[0]) };
+
+	do {
+		const u8 *in = src;
+
+		if (head) {
+			in = head;
+			blocks++;
+			head = NULL;
+		} else {
+			src += GHASH_BLOCK_SIZE;
+		}
+
+		crypto_xor((u8 *)&dst, in, GHASH_BLOCK_SIZE);
+		gf128mul_lle(&dst, &key->k);
+	} while (--blocks);
+
+	dg[0] = be64_to_cpu(dst.b);
+	dg[1] = be64_to_cpu(dst.a);
+}
+
 static void ghash_do_update(int blocks, u64 dg[], const char *src,
 			    struct ghash_key *key, const char *head)
 {
 	if (likely(crypto_simd_usable())) {
 		kernel_neon_begin();
-		if (static_branch_likely(&use_p64))
-			pmull_ghash_update_p64(blocks, dg, src, key->h, head);
-		else
-			pmull_ghash_update_p8(blocks, dg, src, key->h, head);
+		ghash_do_simd_update(blocks, dg, src, key, head);
 		kernel_neon_end();
 	} else {
-		be128 dst = { cpu_to_be64(dg[1]), cpu_to_be64(dg[0]) };
-
-		do {
-			const u8 *in = src;
-
-			if (head) {
-				in = head;
-				blocks++;
-				head = NULL;
-			} else {
-				src += GHASH_BLOCK_SIZE;
-			}
-
-			crypto_xor((u8 *)&dst, in, GHASH_BLOCK_SIZE);
-			gf128mul_lle(&dst, &key->k);
-		} while (--blocks);
-
-		dg[0] = be64_to_cpu(dst.b);
-		dg[1] = be64_to_cpu(dst.a);
+		ghash_do_generic_update(blocks, dg, src, key, head);
 	}
 }
 
@@ -153,14 +185,8 @@ static void ghash_reflect(u64 h[], const be128 *k)
 		h[1] ^= 0xc200000000000000UL;
 }
 
-static int ghash_setkey(struct crypto_shash *tfm,
-			const u8 *inkey, unsigned int keylen)
+static void ghash_key_init(struct ghash_key *key, const u8 *inkey)
 {
-	struct ghash_key *key = crypto_shash_ctx(tfm);
-
-	if (keylen != GHASH_BLOCK_SIZE)
-		return -EINVAL;
-
 	/* needed for the fallback */
 	memcpy(&key->k, inkey, GHASH_BLOCK_SIZE);
 	ghash_reflect(key->h[0], &key->k);
@@ -177,6 +203,17 @@ static int ghash_setkey(struct crypto_shash *tfm,
 		gf128mul_lle(&h, &key->k);
 		ghash_reflect(key->h[3], &h);
 	}
+}
+
+static int ghash_setkey(struct crypto_shash *tfm,
+			const u8 *inkey, unsigned int keylen)
+{
+	struct ghash_key *key = crypto_shash_ctx(tfm);
+
+	if (keylen != GHASH_BLOCK_SIZE)
+		return -EINVAL;
+
+	ghash_key_init(key, inkey);
 	return 0;
 }
 
@@ -344,6 +381,299 @@ static struct ahash_alg ghash_async_alg = {
 	},
 };
 
+/*
+ * gcm(aes) on cores that only have the NEON vmull.p8: the bit sliced AES CTR
+ * code and the p8 GHASH run back to back on each chunk of the walk, inside a
+ * single NEON section, so the ciphertext is hashed while it is still in L1.
+ * This beats the generic gcm template, which makes one pass for CTR and a
+ * second one over the whole request for GHASH.
+ */
+static int gcm_aes_setkey(struct crypto_aead *tfm, const u8 *inkey,
+			  unsigned int keylen)
+{
+	struct gcm_aes_ctx *ctx = crypto_aead_ctx(tfm);
+	u8 key[GHASH_BLOCK_SIZE];
+	int err;
+
+	err = aes_expandkey(&ctx->aes_key, inkey, keylen);
+	if (err)
+		return err;
+
+	ctx->rounds = 6 + keylen / 4;
+
+	kernel_neon_begin();
+	aesbs_convert_key(ctx->rk, ctx->aes_key.key_enc, ctx->rounds);
+	kernel_neon_end();
+
+	aes_encrypt(&ctx->aes_key, key, (u8[AES_BLOCK_SIZE]){});
+	ghash_key_init(&ctx->ghash_key, key);
+
+	memzero_explicit(key, sizeof(key));
+	return 0;
+}
+
+static int gcm_aes_setauthsize(struct crypto_aead *tfm, unsigned int authsize)
+{
+	return crypto_gcm_check_authsize(authsize);
+}
+
+static void gcm_update_mac(u64 dg[], const u8 *src, int count, u8 buf[],
+			   int *buf_count, struct gcm_aes_ctx *ctx)
+{
+	if (*buf_count > 0) {
+		int buf_added = min(count, GHASH_BLOCK_SIZE - *buf_count);
+
+		memcpy(&buf[*buf_count], src, buf_added);
+
+		*buf_count += buf_added;
+		src += buf_added;
+		count -= buf_added;
+	}
+
+	if (count >= GHASH_BLOCK_SIZE || *buf_count == GHASH_BLOCK_SIZE) {
+		int blocks = count / GHASH_BLOCK_SIZE;
+
+		ghash_do_update(blocks, dg, src, &ctx->ghash_key,
+				*buf_count ? buf : NULL);
+
+		src += blocks * GHASH_BLOCK_SIZE;
+		count %= GHASH_BLOCK_SIZE;
+		*buf_count = 0;
+	}
+
+	if (count > 0) {
+		memcpy(buf, src, count);
+		*buf_count = count;
+	}
+}
+
+static void gcm_calculate_auth_mac(struct aead_request *req, u64 dg[])
+{
+	struct crypto_aead *aead = crypto_aead_reqtfm(req);
+	struct gcm_aes_ctx *ctx = crypto_aead_ctx(aead);
+	u8 buf[GHASH_BLOCK_SIZE];
+	struct scatter_walk walk;
+	u32 len = req->assoclen;
+	int buf_count = 0;
+
+	scatterwalk_start(&walk, req->src);
+
+	do {
+		u32 n = scatterwalk_clamp(&walk, len);
+		u8 *p;
+
+		if (!n) {
+			scatterwalk_start(&walk, sg_next(walk.sg));
+			n = scatterwalk_clamp(&walk, len);
+		}
+		p = scatterwalk_map(&walk);
+
+		gcm_update_mac(dg, p, n, buf, &buf_count, ctx);
+		len -= n;
+
+		scatterwalk_unmap(p);
+		scatterwalk_advance(&walk, n);
+		scatterwalk_done(&walk, 0, len);
+	} while (len);
+
+	if (buf_count) {
+		memset(&buf[buf_count], 0, GHASH_BLOCK_SIZE - buf_count);
+		ghash_do_update(1, dg, buf, &ctx->ghash_key, NULL);
+	}
+}
+
+/* scalar CTR for when the NEON unit may not be used */
+static void gcm_ctr_generic(struct crypto_aes_ctx *key, u8 *dst,
+			    const u8 *src, int blocks, u8 ctr[], u8 *final)
+{
+	u8 ks[AES_BLOCK_SIZE];
+
+	while (blocks--) {
+		aes_encrypt(key, ks, ctr);
+		crypto_inc(ctr, AES_BLOCK_SIZE);
+		crypto_xor_cpy(dst, src, ks, AES_BLOCK_SIZE);
+		dst += AES_BLOCK_SIZE;
+		src += AES_BLOCK_SIZE;
+	}
+	if (final) {
+		aes_encrypt(key, final, ctr);
+		crypto_inc(ctr, AES_BLOCK_SIZE);
+	}
+	memzero_explicit(ks, sizeof(ks));
+}
+
+/*
+ * Run CTR over one chunk of the walk and fold the ciphertext into the GHASH
+ * state: after the CTR pass when encrypting, before it when decrypting.
+ */
+static void gcm_crypt_chunk(struct gcm_aes_ctx *ctx, bool enc, bool simd,
+			    u8 *dst, const u8 *src, int blocks, u8 ctr[],
+			    u8 *final, u64 dg[])
+{
+	const u8 *ct = enc ? dst : src;
+
+	if (simd) {
+		kernel_neon_begin();
+		if (!enc && blocks)
+			ghash_do_simd_update(blocks, dg, ct, &ctx->ghash_key,
+					     NULL);
+		if (blocks || final)
+			aesbs_ctr_encrypt(dst, src, ctx->rk, ctx->rounds,
+					  blocks, ctr, final);
+		if (enc && blocks)
+			ghash_do_simd_update(blocks, dg, ct, &ctx->ghash_key,
+					     NULL);
+		kernel_neon_end();
+	} else {
+		if (!enc && blocks)
+			ghash_do_generic_update(blocks, dg, ct,
+						&ctx->ghash_key, NULL);
+		gcm_ctr_generic(&ctx->aes_key, dst, src, blocks, ctr, final);
+		if (enc && blocks)
+			ghash_do_generic_update(blocks, dg, ct,
+						&ctx->ghash_key, NULL);
+	}
+}
+
+static int gcm_aes_crypt(struct aead_request *req, bool enc, u8 tag[])
+{
+	struct crypto_aead *aead = crypto_aead_reqtfm(req);
+	struct gcm_aes_ctx *ctx = crypto_aead_ctx(aead);
+	unsigned int cryptlen = req->cryptlen;
+	u8 ctr[AES_BLOCK_SIZE], ks[AES_BLOCK_SIZE];
+	u8 buf[GHASH_BLOCK_SIZE];
+	struct skcipher_walk walk;
+	bool simd = crypto_simd_usable();
+	u64 dg[2] = {};
+	be128 lengths;
+	int err;
+
+	if (!enc)
+		cryptlen -= crypto_aead_authsize(aead);
+
+	lengths.a = cpu_to_be64(req->assoclen * 8);
+	lengths.b = cpu_to_be64(cryptlen * 8);
+
+	if (req->assoclen)
+		gcm_calculate_auth_mac(req, dg);
+
+	memcpy(ctr, req->iv, GCM_AES_IV_SIZE);
+	put_unaligned_be32(2, ctr + GCM_AES_IV_SIZE);
+
+	if (enc)
+		err = skcipher_walk_aead_encrypt(&walk, req, false);
+	else
+		err = skcipher_walk_aead_decrypt(&walk, req, false);
+
+	while (walk.nbytes) {
+		unsigned int nbytes = walk.nbytes;
+		int blocks = nbytes / AES_BLOCK_SIZE;
+		unsigned int tail = nbytes % AES_BLOCK_SIZE;
+		u8 *dst = walk.dst.virt.addr;
+		const u8 *src = walk.src.virt.addr;
+		u8 *final = NULL;
+
+		if (nbytes < walk.total) {
+			blocks = round_down(blocks,
+					    walk.stride / AES_BLOCK_SIZE);
+			tail = 0;
+		} else if (tail) {
+			final = ks;
+		}
+
+		gcm_crypt_chunk(ctx, enc, simd, dst, src, blocks, ctr, final,
+				dg);
+
+		if (final) {
+			dst += blocks * AES_BLOCK_SIZE;
+			src += blocks * AES_BLOCK_SIZE;
+
+			memset(buf, 0, sizeof(buf));
+			if (!enc)
+				memcpy(buf, src, tail);
+			crypto_xor_cpy(dst, src, final, tail);
+			if (enc)
+				memcpy(buf, dst, tail);
+			ghash_do_update(1, dg, buf, &ctx->ghash_key, NULL);
+			err = skcipher_walk_done(&walk, 0);
+			break;
+		}
+		err = skcipher_walk_done(&walk,
+					 nbytes - blocks * AES_BLOCK_SIZE);
+	}
+	if (err)
+		return err;
+
+	ghash_do_update(1, dg, (const char *)&lengths, &ctx->ghash_key, NULL);
+
+	put_unaligned_be64(dg[1], tag);
+	put_unaligned_be64(dg[0], tag + 8);
+
+	/* tag ^= E(K, J0), with J0 = IV || 1 */
+	memcpy(ctr, req->iv, GCM_AES_IV_SIZE);
+	put_unaligned_be32(1, ctr + GCM_AES_IV_SIZE);
+	aes_encrypt(&ctx->aes_key, ks, ctr);
+	crypto_xor(tag, ks, AES_BLOCK_SIZE);
+
+	memzero_explicit(ks, sizeof(ks));
+	memzero_explicit(buf, sizeof(buf));
+	return 0;
+}
+
+static int gcm_aes_encrypt(struct aead_request *req)
+{
+	struct crypto_aead *aead = crypto_aead_reqtfm(req);
+	u8 tag[AES_BLOCK_SIZE];
+	int err;
+
+	err = gcm_aes_crypt(req, true, tag);
+	if (err)
+		return err;
+
+	scatterwalk_map_and_copy(tag, req->dst,
+				 req->assoclen + req->cryptlen,
+				 crypto_aead_authsize(aead), 1);
+	return 0;
+}
+
+static int gcm_aes_decrypt(struct aead_request *req)
+{
+	struct crypto_aead *aead = crypto_aead_reqtfm(req);
+	unsigned int authsize = crypto_aead_authsize(aead);
+	u8 tag[AES_BLOCK_SIZE], otag[AES_BLOCK_SIZE];
+	int err;
+
+	err = gcm_aes_crypt(req, false, tag);
+	if (err)
+		return err;
+
+	scatterwalk_map_and_copy(otag, req->src,
+				 req->assoclen + req->cryptlen - authsize,
+				 authsize, 0);
+
+	if (crypto_memneq(tag, otag, authsize))
+		return -EBADMSG;
+	return 0;
+}
+
+static struct aead_alg gcm_aes_alg = {
+	.ivsize			= GCM_AES_IV_SIZE,
+	.chunksize		= AES_BLOCK_SIZE,
+	.walksize		= 8 * AES_BLOCK_SIZE,
+	.maxauthsize		= AES_BLOCK_SIZE,
+	.setkey			= gcm_aes_setkey,
+	.setauthsize		= gcm_aes_setauthsize,
+	.encrypt		= gcm_aes_encrypt,
+	.decrypt		= gcm_aes_decrypt,
+
+	.base.cra_name		= "gcm(aes)",
+	.base.cra_driver_name	= "gcm-aes-neonbs",
+	.base.cra_priority	= 300,
+	.base.cra_blocksize	= 1,
+	.base.cra_ctxsize	= sizeof(struct gcm_aes_ctx) + sizeof(u64[2]),
+	.base.cra_module	= THIS_MODULE,
+};
+
 static int __init ghash_ce_mod_init(void)
 {
 	int err;
@@ -363,8 +693,20 @@ static int __init ghash_ce_mod_init(void)
 	if (err)
 		goto err_shash;
 
+	/*
+	 * With vmull.p64 the core also has the AES instructions, and the
+	 * generic gcm template on top of aes-ce and ghash-ce wins.
+	 */
+	if (!static_branch_likely(&use_p64)) {
+		err = crypto_register_aead(&gcm_aes_alg);
+		if (err)
+			goto err_ahash;
+	}
+
 	return 0;
 
+err_ahash:
+	crypto_unregister_ahash(&ghash_async_alg);
 err_shash:
 	crypto_unregister_shash(&ghash_alg);
 	return err;
@@ -372,6 +714,8 @@ static int __init ghash_ce_mod_init(void)
 
 static void __exit ghash_ce_mod_exit(void)
 {
+	if (!static_branch_likely(&use_p64))
+		crypto_unregister_aead(&gcm_aes_alg);
 	crypto_unregister_ahash(&ghash_async_alg);
 	crypto_unregister_shash(&ghash_alg);
 }
@@ -25,6 +25,42 @@
 #define swp_is_buggy
 #endif
 
+#if __LINUX_ARM_ARCH__ >= 6 && defined(CONFIG_CPU_V6)
+/*
+ * ARMv6 without the K extensions has no byte or halfword exclusives, so
+ * exchange the value within its containing word. The queued spinlock
+ * relies on this for xchg_tail() on the 16-bit tail.
+ */
+static inline unsigned long __xchg_small(unsigned long x, volatile void *ptr,
+					 int size)
+{
+	unsigned long offset = (unsigned long)ptr & 3;
+	volatile u32 *p = (volatile u32 *)((unsigned long)ptr & ~3UL);
+	unsigned int shift, tmp;
+	u32 mask, old, new;
+
+#ifdef __ARMEB__
+	shift = (4 - size - offset) * 8;
+#else
+	shift = offset * 8;
+#endif
+	mask = ((1U << (size * 8)) - 1) << shift;
+
+	asm volatile("@	__xchg_small\n"
+	"1:	ldrex	%0, [%3]\n"
+	"	bic	%1, %0, %4\n"
+	"	orr	%1, %1, %5\n"
+	"	strex	%2, %1, [%3]\n"
+	"	teq	%2, #0\n"
+	"	bne	1b"
+		: "=&r" (old), "=&r" (new), "=&r" (tmp)
+		: "r" (p), "r" (mask), "r" ((x << shift) & mask)
+		: "memory", "cc");
+
+	return (old & mask) >> shift;
+}
+#endif
+
 static inline unsigned long __xchg(unsigned long x, volatile void *ptr, int size)
 {
 	extern void __bad_xchg(volatile void *, int);
@@ -61,6 +97,11 @@ static inline unsigned long __xchg(unsigned long x, volatile void *ptr, int size
 			: "r" (x), "r" (ptr)
 			: "memory", "cc");
 		break;
+#else
+	case 1:
+	case 2:
+		ret = __xchg_small(x, ptr, size);
+		break;
 #endif
 	case 4:
 		asm volatile("@	__xchg4\n"
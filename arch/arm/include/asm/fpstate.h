@@ -40,6 +40,14 @@ struct vfp_hard_struct {
 #ifdef CONFIG_SMP
 	__u32 cpu;
 #endif
+
+	/*
+	 * Lazy restore bookkeeping, see vfp_eager_switch()
+	 */
+	__u32 traps;
+	__u32 trap_mark;
+	__u8 trap_streak;
+	__u8 eager_left;
 };
 
 union vfp_state {
@@ -45,6 +45,13 @@ static inline void dsb_sev(void)
 	__asm__(SEV);
 }
 
+#ifdef CONFIG_ARCH_USE_QUEUED_SPINLOCKS
+/*
+ * Queued spinlocks: contending CPUs each spin on their own MCS node
+ * rather than all on the lock word's cacheline.
+ */
+#include <asm/qspinlock.h>
+#else
 /*
  * ARMv6 ticket-based spin-locking.
  *
@@ -127,6 +134,7 @@ static inline int arch_spin_is_contended(arch_spinlock_t *lock)
 	return (tickets.next - tickets.owner) > 1;
 }
 #define arch_spin_is_contended	arch_spin_is_contended
+#endif /* CONFIG_ARCH_USE_QUEUED_SPINLOCKS */
 
 /*
  * RWLOCKS
@@ -6,6 +6,9 @@
 # error "please don't include this file directly"
 #endif
 
+#ifdef CONFIG_ARCH_USE_QUEUED_SPINLOCKS
+#include <asm-generic/qspinlock_types.h>
+#else
 #define TICKET_SHIFT	16
 
 typedef struct {
@@ -24,6 +27,7 @@ typedef struct {
 } arch_spinlock_t;
 
 #define __ARCH_SPIN_LOCK_UNLOCKED	{ { 0 } }
+#endif
 
 typedef struct {
 	u32 lock;
@@ -20,6 +20,12 @@ extern char * strchr(const char * s, int c);
 extern void * memcpy(void *, const void *, __kernel_size_t);
 extern void *__memcpy(void *dest, const void *src, __kernel_size_t n);
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+extern void *memcpy_neon(void *dest, const void *src, __kernel_size_t n);
+#else
+#define memcpy_neon(dest, src, n)	__memcpy(dest, src, n)
+#endif
+
 #define __HAVE_ARCH_MEMMOVE
 extern void * memmove(void *, const void *, __kernel_size_t);
 extern void *__memmove(void *dest, const void *src, __kernel_size_t n);
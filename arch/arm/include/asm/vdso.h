@@ -6,12 +6,24 @@
 
 #ifndef __ASSEMBLY__
 
+#include <linux/types.h>
+
 struct mm_struct;
 
 #ifdef CONFIG_VDSO
 
+/*
+ * The [vvar] area is a page for a memory mapped counter followed by the
+ * data page, which must stay immediately below the vDSO text.
+ */
+#define VDSO_VVAR_PAGES		2
+#define VDSO_VVAR_COUNTER_PAGE	0
+#define VDSO_VVAR_DATA_PAGE	1
+
 void arm_install_vdso(struct mm_struct *mm, unsigned long addr);
 
+int arm_vdso_mct_init(phys_addr_t base);
+
 extern unsigned int vdso_total_pages;
 
 #else /* CONFIG_VDSO */
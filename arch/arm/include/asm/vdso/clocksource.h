@@ -3,6 +3,7 @@
 #define __ASM_VDSOCLOCKSOURCE_H
 
 #define VDSO_ARCH_CLOCKMODES	\
-	VDSO_CLOCKMODE_ARCHTIMER
+	VDSO_CLOCKMODE_ARCHTIMER,	\
+	VDSO_CLOCKMODE_MCT
 
 #endif /* __ASM_VDSOCLOCKSOURCE_H */
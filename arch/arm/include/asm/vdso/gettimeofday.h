@@ -109,16 +109,17 @@ static __always_inline int clock_getres32_fallback(
 
 static inline bool arm_vdso_hres_capable(void)
 {
-	return IS_ENABLED(CONFIG_ARM_ARCH_TIMER);
+	return IS_ENABLED(CONFIG_ARM_ARCH_TIMER) ||
+	       IS_ENABLED(CONFIG_CLKSRC_EXYNOS_MCT);
 }
 #define __arch_vdso_hres_capable arm_vdso_hres_capable
 
+/* Lower word of the MCT global counter, see drivers/clocksource/exynos_mct.c */
+#define VDSO_MCT_G_CNT_L	0x100
+
 static __always_inline u64 __arch_get_hw_counter(int clock_mode,
 						 const struct vdso_data *vd)
 {
-#ifdef CONFIG_ARM_ARCH_TIMER
-	u64 cycle_now;
-
 	/*
 	 * Core checks for mode already, so this raced against a concurrent
 	 * update. Return something. Core will do another round and then
@@ -127,10 +128,18 @@ static __always_inline u64 __arch_get_hw_counter(int clock_mode,
 	if (clock_mode == VDSO_CLOCKMODE_NONE)
 		return 0;
 
-	isb();
-	cycle_now = read_sysreg(CNTVCT);
+#ifdef CONFIG_CLKSRC_EXYNOS_MCT
+	if (clock_mode == VDSO_CLOCKMODE_MCT) {
+		/* The MCT registers are mapped in the page below the data */
+		const void *mct = (const void *)__get_datapage() - PAGE_SIZE;
 
-	return cycle_now;
+		return *(const volatile u32 *)(mct + VDSO_MCT_G_CNT_L);
+	}
+#endif
+
+#ifdef CONFIG_ARM_ARCH_TIMER
+	isb();
+	return read_sysreg(CNTVCT);
 #else
 	/* Make GCC happy. This is compiled out anyway */
 	return 0;
@@ -56,6 +56,7 @@ int main(void)
 #ifdef CONFIG_SMP
   DEFINE(VFP_CPU,		offsetof(union vfp_state, hard.cpu));
 #endif
+  DEFINE(VFP_TRAPS,		offsetof(union vfp_state, hard.traps));
 #endif
 #ifdef CONFIG_ARM_THUMBEE
   DEFINE(TI_THUMBEE_STATE,	offsetof(struct thread_info, thumbee_state));
@@ -101,15 +101,36 @@ u32 get_module_plt(struct module *mod, unsigned long loc, Elf32_Addr val)
 
 #define cmp_3way(a,b)	((a) < (b) ? -1 : (a) > (b))
 
+/*
+ * Branch relocations of the same instruction set resolve to the same PLT
+ * entry for the same symbol, whether they are calls or tail calls, so they
+ * share a class. Every other relocation type is a class of its own.
+ */
+static u32 rel_class(const Elf32_Rel *rel)
+{
+	switch (ELF32_R_TYPE(rel->r_info)) {
+	case R_ARM_CALL:
+	case R_ARM_PC24:
+	case R_ARM_JUMP24:
+		return 0;
+	case R_ARM_THM_CALL:
+	case R_ARM_THM_JUMP24:
+		return 1;
+	}
+	return ELF32_R_TYPE(rel->r_info) + 2;
+}
+
 static int cmp_rel(const void *a, const void *b)
 {
 	const Elf32_Rel *x = a, *y = b;
 	int i;
 
-	/* sort by type and symbol index */
-	i = cmp_3way(ELF32_R_TYPE(x->r_info), ELF32_R_TYPE(y->r_info));
+	/* sort by class, symbol index and type */
+	i = cmp_3way(rel_class(x), rel_class(y));
 	if (i == 0)
 		i = cmp_3way(ELF32_R_SYM(x->r_info), ELF32_R_SYM(y->r_info));
+	if (i == 0)
+		i = cmp_3way(ELF32_R_TYPE(x->r_info), ELF32_R_TYPE(y->r_info));
 	return i;
 }
 
@@ -146,15 +167,17 @@ static bool duplicate_rel(Elf32_Addr base, const Elf32_Rel *rel, int num)
 	const Elf32_Rel *prev;
 
 	/*
-	 * Entries are sorted by type and symbol index. That means that,
+	 * Entries are sorted by class and symbol index. That means that,
 	 * if a duplicate entry exists, it must be in the preceding
-	 * slot.
+	 * slot. get_module_plt() reuses the last entry it allocated, and
+	 * relocations are applied in this same order.
 	 */
 	if (!num)
 		return false;
 
 	prev = rel + num - 1;
-	return cmp_rel(rel + num, prev) == 0 &&
+	return rel_class(rel + num) == rel_class(prev) &&
+	       ELF32_R_SYM(rel[num].r_info) == ELF32_R_SYM(prev->r_info) &&
 	       is_zero_addend_relocation(base, prev);
 }
 
@@ -253,7 +276,7 @@ int module_frob_arch_sections(Elf_Ehdr *ehdr, Elf_Shdr *sechdrs,
 		if (!(dstsec->sh_flags & SHF_EXECINSTR))
 			continue;
 
-		/* sort by type and symbol index */
+		/* sort by class and symbol index */
 		sort(rels, numrels, sizeof(Elf32_Rel), cmp_rel, NULL);
 
 		if (!module_init_layout_section(secstrings + dstsec->sh_name))
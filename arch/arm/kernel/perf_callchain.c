@@ -86,14 +86,17 @@ perf_callchain_user(struct perf_callchain_entry_ctx *entry, struct pt_regs *regs
  * Gets called by walk_stackframe() for every stackframe. This will be called
  * whist unwinding the stackframe and is like a subroutine return so we use
  * the PC.
+ *
+ * Stop the walk once the entry is full: with the EHABI unwinder each frame
+ * costs an index table search, and the frames past max_stack are dropped
+ * anyway.
  */
 static int
 callchain_trace(struct stackframe *fr,
 		void *data)
 {
 	struct perf_callchain_entry_ctx *entry = data;
-	perf_callchain_store(entry, fr->pc);
-	return 0;
+	return perf_callchain_store(entry, fr->pc);
 }
 
 void
@@ -4,6 +4,9 @@
  *
  *  Copyright (C) 2002 ARM Limited, All Rights Reserved.
  */
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/pfn.h>
 #include <linux/preempt.h>
 #include <linux/smp.h>
 #include <linux/uaccess.h>
@@ -12,6 +15,21 @@
 #include <asm/tlbflush.h>
 #include <asm/mmu_context.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/tlb.h>
+
+#define TLB_FLUSH_ALL	-1UL
+
+/*
+ * A range flush costs one (broadcast) invalidate per page, or an IPI
+ * running that loop on every CPU the mm has run on when the hardware
+ * cannot broadcast.  munmap() and mprotect() of a large area are
+ * already gathered into a single range, so beyond this many pages it
+ * is cheaper to drop the whole ASID (or, for kernel ranges, the whole
+ * TLB) in one operation and let the entries be refilled on demand.
+ */
+static unsigned long tlb_single_page_flush_ceiling __read_mostly = 64;
+
 /**********************************************************************/
 
 /*
@@ -220,6 +238,15 @@ void flush_tlb_kernel_page(unsigned long kaddr)
 void flush_tlb_range(struct vm_area_struct *vma,
                      unsigned long start, unsigned long end)
 {
+	unsigned long pages = PFN_UP(end - start);
+
+	if (pages > tlb_single_page_flush_ceiling) {
+		trace_tlb_flush(TLB_REMOTE_SHOOTDOWN, TLB_FLUSH_ALL);
+		flush_tlb_mm(vma->vm_mm);
+		return;
+	}
+
+	trace_tlb_flush(TLB_REMOTE_SHOOTDOWN, pages);
 	if (tlb_ops_need_broadcast()) {
 		struct tlb_args ta;
 		ta.ta_vma = vma;
@@ -234,6 +261,15 @@ void flush_tlb_range(struct vm_area_struct *vma,
 
 void flush_tlb_kernel_range(unsigned long start, unsigned long end)
 {
+	unsigned long pages = PFN_UP(end - start);
+
+	if (pages > tlb_single_page_flush_ceiling) {
+		trace_tlb_flush(TLB_REMOTE_SHOOTDOWN, TLB_FLUSH_ALL);
+		flush_tlb_all();
+		return;
+	}
+
+	trace_tlb_flush(TLB_REMOTE_SHOOTDOWN, pages);
 	if (tlb_ops_need_broadcast()) {
 		struct tlb_args ta;
 		ta.ta_start = start;
@@ -251,3 +287,11 @@ void flush_bp_all(void)
 	else
 		__flush_bp_all();
 }
+
+static int __init tlb_flush_debugfs_init(void)
+{
+	debugfs_create_ulong("tlb_single_page_flush_ceiling", 0600, NULL,
+			     &tlb_single_page_flush_ceiling);
+	return 0;
+}
+late_initcall(tlb_flush_debugfs_init);
@@ -42,11 +42,47 @@ static union vdso_data_store vdso_data_store __page_aligned_data;
 struct vdso_data *vdso_data = vdso_data_store.data;
 
 static struct page *vdso_data_page __ro_after_init;
+
+/* Page aligned base of the MCT registers, if the vDSO may read them */
+static phys_addr_t vdso_mct_phys __ro_after_init;
+
+static vm_fault_t vvar_fault(const struct vm_special_mapping *sm,
+			     struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	switch (vmf->pgoff) {
+	case VDSO_VVAR_COUNTER_PAGE:
+		if (!vdso_mct_phys)
+			break;
+		return vmf_insert_pfn_prot(vma, vmf->address,
+					   __phys_to_pfn(vdso_mct_phys),
+					   pgprot_noncached(vma->vm_page_prot));
+	case VDSO_VVAR_DATA_PAGE:
+		return vmf_insert_pfn(vma, vmf->address,
+				      page_to_pfn(vdso_data_page));
+	}
+
+	return VM_FAULT_SIGBUS;
+}
+
 static const struct vm_special_mapping vdso_data_mapping = {
 	.name = "[vvar]",
-	.pages = &vdso_data_page,
+	.fault = vvar_fault,
 };
 
+/*
+ * Called by the MCT driver before it registers its clocksource.  The
+ * register block only holds timer state, so exposing it read-only to
+ * userspace leaks nothing that clock_gettime() does not already give.
+ */
+int __init arm_vdso_mct_init(phys_addr_t base)
+{
+	if (!base || offset_in_page(base))
+		return -EINVAL;
+
+	vdso_mct_phys = base;
+	return 0;
+}
+
 static int vdso_mremap(const struct vm_special_mapping *sm,
 		struct vm_area_struct *new_vma)
 {
@@ -172,7 +208,7 @@ static void __init patch_vdso(void *ehdr)
 	 * want programs to incur the slight additional overhead of
 	 * dispatching through the VDSO only to fall back to syscalls.
 	 */
-	if (!cntvct_ok) {
+	if (!cntvct_ok && !vdso_mct_phys) {
 		vdso_nullpatch_one(&einfo, "__vdso_gettimeofday");
 		vdso_nullpatch_one(&einfo, "__vdso_clock_gettime");
 		vdso_nullpatch_one(&einfo, "__vdso_clock_gettime64");
@@ -210,7 +246,7 @@ static int __init vdso_init(void)
 
 	vdso_text_mapping.pages = vdso_text_pagelist;
 
-	vdso_total_pages = 1; /* for the data/vvar page */
+	vdso_total_pages = VDSO_VVAR_PAGES;
 	vdso_total_pages += text_pages;
 
 	cntvct_ok = cntvct_functional();
@@ -225,8 +261,9 @@ static int install_vvar(struct mm_struct *mm, unsigned long addr)
 {
 	struct vm_area_struct *vma;
 
-	vma = _install_special_mapping(mm, addr, PAGE_SIZE,
-				       VM_READ | VM_MAYREAD,
+	vma = _install_special_mapping(mm, addr, VDSO_VVAR_PAGES << PAGE_SHIFT,
+				       VM_READ | VM_MAYREAD | VM_IO |
+				       VM_DONTDUMP | VM_PFNMAP,
 				       &vdso_data_mapping);
 
 	return PTR_ERR_OR_ZERO(vma);
@@ -246,9 +283,9 @@ void arm_install_vdso(struct mm_struct *mm, unsigned long addr)
 	if (install_vvar(mm, addr))
 		return;
 
-	/* Account for vvar page. */
-	addr += PAGE_SIZE;
-	len = (vdso_total_pages - 1) << PAGE_SHIFT;
+	/* Account for vvar pages. */
+	addr += VDSO_VVAR_PAGES << PAGE_SHIFT;
+	len = (vdso_total_pages - VDSO_VVAR_PAGES) << PAGE_SHIFT;
 
 	vma = _install_special_mapping(mm, addr, len,
 		VM_READ | VM_EXEC | VM_MAYREAD | VM_MAYWRITE | VM_MAYEXEC,
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * linux/arch/arm/lib/csumpartial-neon.c
+ *
+ * csum_partial() and csum_partial_copy_nocheck() using the NEON unit for
+ * large buffers.  They override the weak integer versions, which remain
+ * available as __csum_partial_arm() and __csum_partial_copy_nocheck_arm()
+ * for small buffers and for interrupt context, where the NEON unit cannot
+ * be claimed.
+ */
+
+#include <linux/init.h>
+#include <linux/jump_label.h>
+#include <linux/kernel.h>
+#include <linux/preempt.h>
+#include <net/checksum.h>
+#include <asm/neon.h>
+
+/*
+ * The integer loop needs an adcs per word on top of the loads, while a
+ * NEON block sums 64 bytes with a handful of widening adds, so the
+ * break-even comes much earlier than for memcpy_neon(): four blocks.
+ */
+#define CSUM_NEON_MIN		256
+#define CSUM_NEON_BLOCK		64
+
+__wsum __csum_partial_arm(const void *buff, int len, __wsum sum);
+__wsum __csum_partial_copy_nocheck_arm(const void *src, void *dst, int len);
+u64 __csum_neon_bulk(const void *buf, unsigned int len);
+u64 __csum_copy_neon_bulk(const void *src, void *dst, unsigned int len);
+
+static DEFINE_STATIC_KEY_FALSE(csum_neon);
+
+static inline bool csum_use_neon(int len)
+{
+	return static_branch_likely(&csum_neon) && len >= CSUM_NEON_MIN &&
+	       !in_interrupt();
+}
+
+static inline __wsum csum_fold64(u64 sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+
+	return (__force __wsum)(u32)sum;
+}
+
+__wsum csum_partial(const void *buff, int len, __wsum sum)
+{
+	unsigned int bulk;
+	u64 bulk_sum;
+
+	if (!csum_use_neon(len))
+		return __csum_partial_arm(buff, len, sum);
+
+	/* The bulk is even, so the tail words keep their offsets */
+	bulk = round_down(len, CSUM_NEON_BLOCK);
+
+	kernel_neon_begin();
+	bulk_sum = __csum_neon_bulk(buff, bulk);
+	kernel_neon_end();
+
+	sum = csum_add(sum, csum_fold64(bulk_sum));
+	return __csum_partial_arm(buff + bulk, len - bulk, sum);
+}
+
+__wsum csum_partial_copy_nocheck(const void *src, void *dst, int len)
+{
+	unsigned int bulk;
+	u64 bulk_sum;
+
+	if (!csum_use_neon(len))
+		return __csum_partial_copy_nocheck_arm(src, dst, len);
+
+	bulk = round_down(len, CSUM_NEON_BLOCK);
+
+	kernel_neon_begin();
+	bulk_sum = __csum_copy_neon_bulk(src, dst, bulk);
+	kernel_neon_end();
+
+	/* The tail call seeds its sum with ~0, so the result is never 0 */
+	return csum_add(__csum_partial_copy_nocheck_arm(src + bulk, dst + bulk,
+							len - bulk),
+			csum_fold64(bulk_sum));
+}
+
+static int __init csum_neon_init(void)
+{
+	/* The 16-bit lanes only match the integer code on little endian */
+	if (cpu_has_neon() && !IS_ENABLED(CONFIG_CPU_BIG_ENDIAN))
+		static_branch_enable(&csum_neon);
+
+	return 0;
+}
+arch_initcall(csum_neon_init);
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * linux/arch/arm/lib/neon-memcpy.c
+ *
+ * memcpy() variant using the NEON unit for large copies
+ */
+
+#include <linux/export.h>
+#include <linux/kernel.h>
+#include <linux/preempt.h>
+#include <linux/string.h>
+#include <asm/neon.h>
+
+/*
+ * __memcpy()'s ldm/stm loop already runs close to the bus limit, so NEON
+ * has to win back the save of the user's 256 bytes of VFP state in
+ * kernel_neon_begin() and the later VFP trap that restores it from a
+ * slightly faster bulk loop alone: pick a size well above that state.
+ */
+#define NEON_MEMCPY_MIN		1024
+#define NEON_MEMCPY_BLOCK	64
+
+void __memcpy_neon_bulk(void *dst, const void *src, size_t len);
+
+/**
+ * memcpy_neon - copy memory, using NEON for large sizes
+ * @dest: destination
+ * @src: source
+ * @n: number of bytes to copy
+ *
+ * Behaves like __memcpy(), so it may also be used on pinned user pages
+ * with uaccess enabled.  Copies of at least NEON_MEMCPY_MIN bytes made
+ * outside of interrupt context are done by the NEON unit, the rest fall
+ * back to __memcpy().  May be called with preemption disabled.
+ */
+void *memcpy_neon(void *dest, const void *src, size_t n)
+{
+	size_t bulk = round_down(n, NEON_MEMCPY_BLOCK);
+
+	if (n < NEON_MEMCPY_MIN || !cpu_has_neon() || in_interrupt())
+		return __memcpy(dest, src, n);
+
+	kernel_neon_begin();
+	__memcpy_neon_bulk(dest, src, bulk);
+	kernel_neon_end();
+
+	if (n > bulk)
+		__memcpy(dest + bulk, src + bulk, n - bulk);
+
+	return dest;
+}
+EXPORT_SYMBOL(memcpy_neon);
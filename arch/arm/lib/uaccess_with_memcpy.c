@@ -19,8 +19,23 @@
 #include <asm/current.h>
 #include <asm/page.h>
 
+#ifdef CONFIG_ARM_LPAE
+#define pmd_hugewillfault_read(pmd)	(!pmd_young(pmd) || \
+					 !pmd_present(pmd) || \
+					 !pmd_isset((pmd), PMD_SECT_USER))
+#else
+#define pmd_hugewillfault_read(pmd)	(0)
+#endif
+
+/*
+ * Lock the page table entry mapping a user address, provided the access can
+ * be made without faulting: the page must be present, user accessible and
+ * young, and for a write also writable and dirty. PROT_NONE entries are
+ * present and may be young, but the copy would fault on them with the page
+ * table lock held.
+ */
 static int
-pin_page_for_write(const void __user *_addr, pte_t **ptep, spinlock_t **ptlp)
+pin_page(const void __user *_addr, bool write, pte_t **ptep, spinlock_t **ptlp)
 {
 	unsigned long addr = (unsigned long)_addr;
 	pgd_t *pgd;
@@ -52,15 +67,16 @@ pin_page_for_write(const void __user *_addr, pte_t **ptep, spinlock_t **ptlp)
 	 * Both THP and HugeTLB pages have the same pmd layout
 	 * and should not be manipulated by the pte functions.
 	 *
-	 * Lock the page table for the destination and check
+	 * Lock the page table for the address and check
 	 * to see that it's still huge and whether or not we will
-	 * need to fault on write.
+	 * need to fault on the access.
 	 */
 	if (unlikely(pmd_thp_or_huge(*pmd))) {
 		ptl = &current->mm->page_table_lock;
 		spin_lock(ptl);
 		if (unlikely(!pmd_thp_or_huge(*pmd)
-			|| pmd_hugewillfault(*pmd))) {
+			|| (write ? pmd_hugewillfault(*pmd) :
+				    pmd_hugewillfault_read(*pmd)))) {
 			spin_unlock(ptl);
 			return 0;
 		}
@@ -74,8 +90,8 @@ pin_page_for_write(const void __user *_addr, pte_t **ptep, spinlock_t **ptlp)
 		return 0;
 
 	pte = pte_offset_map_lock(current->mm, pmd, addr, &ptl);
-	if (unlikely(!pte_present(*pte) || !pte_young(*pte) ||
-	    !pte_write(*pte) || !pte_dirty(*pte))) {
+	if (unlikely(!pte_access_permitted(*pte, write) || !pte_young(*pte) ||
+	    (write && !pte_dirty(*pte)))) {
 		pte_unmap_unlock(pte, ptl);
 		return 0;
 	}
@@ -107,7 +123,7 @@ __copy_to_user_memcpy(void __user *to, const void *from, unsigned long n)
 		spinlock_t *ptl;
 		int tocopy;
 
-		while (!pin_page_for_write(to, &pte, &ptl)) {
+		while (!pin_page(to, true, &pte, &ptl)) {
 			if (!atomic)
 				mmap_read_unlock(current->mm);
 			if (__put_user(0, (char __user *)to))
@@ -121,7 +137,7 @@ __copy_to_user_memcpy(void __user *to, const void *from, unsigned long n)
 			tocopy = n;
 
 		ua_flags = uaccess_save_and_enable();
-		__memcpy((void *)to, from, tocopy);
+		memcpy_neon((void *)to, from, tocopy);
 		uaccess_restore(ua_flags);
 		to += tocopy;
 		from += tocopy;
@@ -159,7 +175,76 @@ arm_copy_to_user(void __user *to, const void *from, unsigned long n)
 	}
 	return n;
 }
-	
+
+static unsigned long noinline
+__copy_from_user_memcpy(void *to, const void __user *from, unsigned long n)
+{
+	unsigned long ua_flags;
+	int atomic;
+
+	if (uaccess_kernel()) {
+		memcpy(to, (const void *)from, n);
+		return 0;
+	}
+
+	/* the mmap semaphore is taken only if not in an atomic context */
+	atomic = faulthandler_disabled();
+
+	if (!atomic)
+		mmap_read_lock(current->mm);
+	while (n) {
+		pte_t *pte;
+		spinlock_t *ptl;
+		int tocopy;
+		char c;
+
+		while (!pin_page(from, false, &pte, &ptl)) {
+			if (!atomic)
+				mmap_read_unlock(current->mm);
+			if (__get_user(c, (const char __user *)from))
+				goto out;
+			if (!atomic)
+				mmap_read_lock(current->mm);
+		}
+
+		tocopy = (~(unsigned long)from & ~PAGE_MASK) + 1;
+		if (tocopy > n)
+			tocopy = n;
+
+		ua_flags = uaccess_save_and_enable();
+		memcpy_neon(to, (const void *)from, tocopy);
+		uaccess_restore(ua_flags);
+		to += tocopy;
+		from += tocopy;
+		n -= tocopy;
+
+		if (pte)
+			pte_unmap_unlock(pte, ptl);
+		else
+			spin_unlock(ptl);
+	}
+	if (!atomic)
+		mmap_read_unlock(current->mm);
+
+out:
+	return n;
+}
+
+unsigned long
+arm_copy_from_user(void *to, const void __user *from, unsigned long n)
+{
+	/* See rational for this in __copy_to_user() above. */
+	if (n < 64) {
+		unsigned long ua_flags = uaccess_save_and_enable();
+		n = __copy_from_user_std(to, from, n);
+		uaccess_restore(ua_flags);
+	} else {
+		n = __copy_from_user_memcpy(to,
+					    uaccess_mask_range_ptr(from, n), n);
+	}
+	return n;
+}
+
 static unsigned long noinline
 __clear_user_memset(void __user *addr, unsigned long n)
 {
@@ -176,7 +261,7 @@ __clear_user_memset(void __user *addr, unsigned long n)
 		spinlock_t *ptl;
 		int tocopy;
 
-		while (!pin_page_for_write(addr, &pte, &ptl)) {
+		while (!pin_page(addr, true, &pte, &ptl)) {
 			mmap_read_unlock(current->mm);
 			if (__put_user(0, (char __user *)addr))
 				goto out;
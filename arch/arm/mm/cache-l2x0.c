@@ -5,6 +5,7 @@
  * Copyright (C) 2007 ARM Limited
  */
 #include <linux/cpu.h>
+#include <linux/debugfs.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/smp.h>
@@ -536,6 +537,153 @@ static void l2c310_flush_all_erratum(void)
 	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
 }
 
+/*
+ * Range operations by PA cost one register write per 32-byte line, so a
+ * multi-megabyte DMA buffer takes tens of thousands of writes when a
+ * single operation by way would clean the whole cache.  Above
+ * l2c310_way_threshold bytes (the cache size by default, zero disables)
+ * clean and clean+invalidate ranges are done by way instead.  Invalidate
+ * ranges are always done by line, as invalidating by way would discard
+ * other dirty data.
+ *
+ * A way operation runs in the background, and any other maintenance
+ * operation or cache sync issued while it runs raises an imprecise
+ * abort.  Way operations therefore take l2c310_way_lock for writing,
+ * while line operations and the cache sync take it for reading, so they
+ * still run in parallel with each other.  Line operations drop it every
+ * 4K, as l2c310_flush_range_erratum does, to bound the interrupt latency.
+ */
+static DEFINE_RWLOCK(l2c310_way_lock);
+static u32 l2c310_way_threshold;
+static atomic64_t l2c310_line_ops, l2c310_line_bytes;
+static u64 l2c310_way_ops;
+static unsigned l2c310_flush_way_reg = L2X0_CLEAN_INV_WAY;
+static bool l2c310_way_erratum;
+
+static void l2c310_op_way(void __iomem *base, unsigned reg)
+{
+	bool debug = reg == L2X0_CLEAN_INV_WAY && l2c310_way_erratum;
+	unsigned long flags;
+
+	write_lock_irqsave(&l2c310_way_lock, flags);
+	/* Erratum 727915 for clean+invalidate by way */
+	if (debug)
+		l2c_set_debug(base, 0x03);
+	__l2c_op_way(base + reg);
+	if (debug)
+		l2c_set_debug(base, 0x00);
+	__l2c210_cache_sync(base);
+	l2c310_way_ops++;
+	write_unlock_irqrestore(&l2c310_way_lock, flags);
+}
+
+static void l2c310_op_range(unsigned long start, unsigned long end,
+	unsigned line_reg, unsigned way_reg)
+{
+	void __iomem *base = l2x0_base;
+	u32 threshold = READ_ONCE(l2c310_way_threshold);
+	unsigned long flags;
+
+	if (end < start)
+		end = start;
+
+	if (way_reg && threshold && end - start >= threshold) {
+		l2c310_op_way(base, way_reg);
+		return;
+	}
+
+	atomic64_inc(&l2c310_line_ops);
+	atomic64_add(end - start, &l2c310_line_bytes);
+
+	read_lock_irqsave(&l2c310_way_lock, flags);
+	while (start < end) {
+		unsigned long blk_end = start + min(end - start, 4096UL);
+
+		__l2c210_op_pa_range(base + line_reg, start, blk_end);
+		start = blk_end;
+
+		if (blk_end < end) {
+			read_unlock_irqrestore(&l2c310_way_lock, flags);
+			read_lock_irqsave(&l2c310_way_lock, flags);
+		}
+	}
+	__l2c210_cache_sync(base);
+	read_unlock_irqrestore(&l2c310_way_lock, flags);
+}
+
+static void l2c310_inv_range(unsigned long start, unsigned long end)
+{
+	void __iomem *base = l2x0_base;
+	unsigned long flags;
+
+	if ((start | end) & (CACHE_LINE_SIZE - 1)) {
+		read_lock_irqsave(&l2c310_way_lock, flags);
+		if (start & (CACHE_LINE_SIZE - 1)) {
+			start &= ~(CACHE_LINE_SIZE - 1);
+			writel_relaxed(start, base + L2X0_CLEAN_INV_LINE_PA);
+			start += CACHE_LINE_SIZE;
+		}
+
+		if (end & (CACHE_LINE_SIZE - 1)) {
+			end &= ~(CACHE_LINE_SIZE - 1);
+			writel_relaxed(end, base + L2X0_CLEAN_INV_LINE_PA);
+		}
+		read_unlock_irqrestore(&l2c310_way_lock, flags);
+	}
+
+	l2c310_op_range(start, end, L2X0_INV_LINE_PA, 0);
+}
+
+static void l2c310_clean_range(unsigned long start, unsigned long end)
+{
+	start &= ~(CACHE_LINE_SIZE - 1);
+	l2c310_op_range(start, end, L2X0_CLEAN_LINE_PA, L2X0_CLEAN_WAY);
+}
+
+static void l2c310_flush_range(unsigned long start, unsigned long end)
+{
+	start &= ~(CACHE_LINE_SIZE - 1);
+	l2c310_op_range(start, end, L2X0_CLEAN_INV_LINE_PA,
+			l2c310_flush_way_reg);
+}
+
+static void l2c310_sync(void)
+{
+	unsigned long flags;
+
+	read_lock_irqsave(&l2c310_way_lock, flags);
+	__l2c210_cache_sync(l2x0_base);
+	read_unlock_irqrestore(&l2c310_way_lock, flags);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int l2c310_atomic64_get(void *data, u64 *val)
+{
+	*val = atomic64_read(data);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(l2c310_atomic64_fops, l2c310_atomic64_get, NULL,
+			 "%llu\n");
+
+static int __init l2c310_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	if (outer_cache.clean_range != l2c310_clean_range)
+		return 0;
+
+	dir = debugfs_create_dir("l2c310", NULL);
+	debugfs_create_u32("way_threshold", 0644, dir, &l2c310_way_threshold);
+	debugfs_create_file_unsafe("line_ops", 0444, dir, &l2c310_line_ops,
+				   &l2c310_atomic64_fops);
+	debugfs_create_file_unsafe("line_bytes", 0444, dir, &l2c310_line_bytes,
+				   &l2c310_atomic64_fops);
+	debugfs_create_u64("way_ops", 0444, dir, &l2c310_way_ops);
+	return 0;
+}
+late_initcall(l2c310_debugfs_init);
+#endif
+
 static void __init l2c310_save(void __iomem *base)
 {
 	unsigned revision;
@@ -698,9 +846,30 @@ static void __init l2c310_fixup(void __iomem *base, u32 cache_id,
 	    revision >= L310_CACHE_ID_RTL_R2P0 &&
 	    revision < L310_CACHE_ID_RTL_R3P1) {
 		fns->flush_all = l2c310_flush_all_erratum;
+		l2c310_way_erratum = true;
 		errata[n++] = "727915";
 	}
 
+	/*
+	 * Parts affected by 588369 keep their line based erratum handlers,
+	 * and other users of l2c310_fixup may supply their own range ops.
+	 */
+	if (fns->inv_range == l2c210_inv_range &&
+	    fns->clean_range == l2c210_clean_range &&
+	    fns->flush_range == l2c210_flush_range) {
+		fns->inv_range = l2c310_inv_range;
+		fns->clean_range = l2c310_clean_range;
+		fns->flush_range = l2c310_flush_range;
+		fns->sync = l2c310_sync;
+		l2c310_way_threshold = l2x0_size;
+
+		/* No 727915 workaround, so no clean+invalidate by way */
+		if (!IS_ENABLED(CONFIG_PL310_ERRATA_727915) &&
+		    revision >= L310_CACHE_ID_RTL_R2P0 &&
+		    revision < L310_CACHE_ID_RTL_R3P1)
+			l2c310_flush_way_reg = 0;
+	}
+
 	if (revision >= L310_CACHE_ID_RTL_R3P0 &&
 	    revision < L310_CACHE_ID_RTL_R3P2) {
 		u32 val = l2x0_saved_regs.prefetch_ctrl;
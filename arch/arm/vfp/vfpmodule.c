@@ -8,11 +8,15 @@
 #include <linux/types.h>
 #include <linux/cpu.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
 #include <linux/hardirq.h>
 #include <linux/kernel.h>
+#include <linux/moduleparam.h>
 #include <linux/notifier.h>
 #include <linux/signal.h>
 #include <linux/sched/signal.h>
+#include <linux/sched/task.h>
+#include <linux/seq_file.h>
 #include <linux/smp.h>
 #include <linux/init.h>
 #include <linux/uaccess.h>
@@ -106,6 +110,7 @@ static void vfp_thread_flush(struct thread_info *thread)
 	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
 	put_cpu();
 
+	/* this also resets the lazy restore bookkeeping, see below */
 	memset(vfp, 0, sizeof(union vfp_state));
 
 	vfp->hard.fpexc = FPEXC_EN;
@@ -135,6 +140,131 @@ static void vfp_thread_copy(struct thread_info *thread)
 #ifdef CONFIG_SMP
 	thread->vfpstate.hard.cpu = NR_CPUS;
 #endif
+	thread->vfpstate.hard.traps = 0;
+	thread->vfpstate.hard.trap_mark = 0;
+	thread->vfpstate.hard.trap_streak = 0;
+	thread->vfpstate.hard.eager_left = 0;
+}
+
+/*
+ * Lazy restore costs an undefined instruction trap every time a thread
+ * touches the VFP after being switched in.  That is cheap for threads
+ * which rarely use it, but a thread doing floating point or NEON work in
+ * every slice pays the trap each time.  vfp_support_entry counts these
+ * traps in vfp_hard_struct.traps, and with vfp.eager=1 a thread which
+ * trapped in VFP_EAGER_STREAK consecutive slices gets its state loaded
+ * at switch in for the next VFP_EAGER_SLICES switches.  After that it
+ * falls back to lazy restore so that a thread which stopped using the
+ * VFP stops paying for the eager load.
+ *
+ * vfp.eager=2 loads the state at every switch for any thread which has
+ * used the VFP since its last exec, vfp.eager=0 is plain lazy restore.
+ */
+#define VFP_EAGER_STREAK	4
+#define VFP_EAGER_SLICES	32
+
+enum {
+	VFP_EAGER_OFF,
+	VFP_EAGER_AUTO,
+	VFP_EAGER_ALWAYS,
+};
+
+static int vfp_eager = VFP_EAGER_AUTO;
+
+static int vfp_eager_set(const char *val, const struct kernel_param *kp)
+{
+	int mode, ret;
+
+	ret = kstrtoint(val, 0, &mode);
+	if (ret)
+		return ret;
+	if (mode < VFP_EAGER_OFF || mode > VFP_EAGER_ALWAYS)
+		return -EINVAL;
+
+	WRITE_ONCE(vfp_eager, mode);
+	return 0;
+}
+
+static const struct kernel_param_ops vfp_eager_ops = {
+	.set	= vfp_eager_set,
+	.get	= param_get_int,
+};
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "vfp."
+module_param_cb(eager, &vfp_eager_ops, &vfp_eager, 0644);
+MODULE_PARM_DESC(eager, "VFP context restore: 0 lazy, 1 adaptive, 2 eager");
+
+static DEFINE_PER_CPU(unsigned long, vfp_eager_loads);
+
+static bool vfp_want_eager(struct vfp_hard_struct *hw)
+{
+	bool trapped = hw->traps != hw->trap_mark;
+
+	hw->trap_mark = hw->traps;
+
+	switch (READ_ONCE(vfp_eager)) {
+	case VFP_EAGER_ALWAYS:
+		return hw->traps;
+
+	case VFP_EAGER_AUTO:
+		if (hw->eager_left) {
+			hw->eager_left--;
+			return true;
+		}
+		if (!trapped) {
+			hw->trap_streak = 0;
+			return false;
+		}
+		if (++hw->trap_streak < VFP_EAGER_STREAK)
+			return false;
+		hw->trap_streak = 0;
+		hw->eager_left = VFP_EAGER_SLICES - 1;
+		return true;
+
+	default:
+		hw->trap_streak = 0;
+		hw->eager_left = 0;
+		return false;
+	}
+}
+
+/*
+ * Called at the end of THREAD_NOTIFY_SWITCH, with the VFP disabled,
+ * to load the next thread's state if it is likely to use the VFP in
+ * this slice anyway.
+ */
+static void vfp_eager_switch(struct thread_info *thread, u32 fpexc)
+{
+	union vfp_state *vfp = &thread->vfpstate;
+	unsigned int cpu = thread->cpu;
+
+	if (!vfp_want_eager(&vfp->hard))
+		return;
+
+	/*
+	 * Leave anything with a pending exception (either in the hardware
+	 * or in the saved state) to the trap handler.
+	 */
+	if ((fpexc | vfp->hard.fpexc) & FPEXC_EX)
+		return;
+
+	if (vfp_state_in_hw(cpu, thread)) {
+		fmxr(FPEXC, fpexc | FPEXC_EN);
+		return;
+	}
+
+	fmxr(FPEXC, fpexc | FPEXC_EN);
+#ifndef CONFIG_SMP
+	/* On UP the previous owner's state has not been saved yet */
+	if (vfp_current_hw_state[cpu])
+		vfp_save_state(vfp_current_hw_state[cpu], fpexc | FPEXC_EN);
+#else
+	vfp->hard.cpu = cpu;
+#endif
+	vfp_current_hw_state[cpu] = vfp;
+	vfp_load_state(vfp);
+	__this_cpu_inc(vfp_eager_loads);
 }
 
 /*
@@ -185,6 +315,8 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 		 * old state.
 		 */
 		fmxr(FPEXC, fpexc & ~FPEXC_EN);
+
+		vfp_eager_switch(thread, fpexc & ~FPEXC_EN);
 		break;
 
 	case THREAD_NOTIFY_FLUSH:
@@ -868,3 +1000,40 @@ static int __init vfp_init(void)
 }
 
 core_initcall(vfp_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int vfp_traps_show(struct seq_file *s, void *unused)
+{
+	struct task_struct *g, *t;
+	unsigned long loads = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		loads += per_cpu(vfp_eager_loads, cpu);
+	seq_printf(s, "mode %d eager loads %lu\n", READ_ONCE(vfp_eager), loads);
+
+	rcu_read_lock();
+	for_each_process_thread(g, t) {
+		struct vfp_hard_struct *hw = &task_thread_info(t)->vfpstate.hard;
+
+		if (!hw->traps)
+			continue;
+		seq_printf(s, "%8d %-16s traps %10u%s\n", task_pid_nr(t),
+			   t->comm, hw->traps, hw->eager_left ? " eager" : "");
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vfp_traps);
+
+static int __init vfp_debugfs_init(void)
+{
+	if (vfp_vector != vfp_support_entry)
+		return 0;
+
+	debugfs_create_file("vfp_traps", 0400, NULL, NULL, &vfp_traps_fops);
+	return 0;
+}
+late_initcall(vfp_debugfs_init);
+#endif
@@ -77,6 +77,9 @@ struct driver_private {
  *	the device; typically because it depends on another driver getting
  *	probed first.
  * @async_driver - pointer to device driver awaiting probe via async_probe
+ * @deferred_probe_retries - number of times the device was retried from the
+ *	deferred probe list.
+ * @deferred_probe_ns - time spent in those retries.
  * @device - pointer back to the struct device that this structure is
  * associated with.
  * @dead - This device is currently either in the process of or has been
@@ -94,6 +97,8 @@ struct device_private {
 	struct list_head deferred_probe;
 	struct device_driver *async_driver;
 	char *deferred_probe_reason;
+	unsigned int deferred_probe_retries;
+	u64 deferred_probe_ns;
 	struct device *device;
 	u8 dead:1;
 };
@@ -184,6 +189,7 @@ extern int device_links_read_lock(void);
 extern void device_links_read_unlock(int idx);
 extern int device_links_read_lock_held(void);
 extern int device_links_check_suppliers(struct device *dev);
+extern bool device_links_suppliers_ready(struct device *dev);
 extern void device_links_force_bind(struct device *dev);
 extern void device_links_driver_bound(struct device *dev);
 extern void device_links_driver_cleanup(struct device *dev);
@@ -1042,6 +1042,45 @@ int device_links_check_suppliers(struct device *dev)
 	return ret;
 }
 
+/**
+ * device_links_suppliers_ready - Check if a device could pass supplier checks.
+ * @dev: Consumer device.
+ *
+ * Same test as device_links_check_suppliers(), without changing any link
+ * state or recording a deferral reason.  Used by the deferred probe code to
+ * skip devices that would only defer again.
+ */
+bool device_links_suppliers_ready(struct device *dev)
+{
+	struct device_link *link;
+	bool ready = true;
+
+	mutex_lock(&fwnode_link_lock);
+	if (dev->fwnode && !list_empty(&dev->fwnode->suppliers) &&
+	    !fw_devlink_is_permissive())
+		ready = false;
+	mutex_unlock(&fwnode_link_lock);
+
+	if (!ready)
+		return false;
+
+	device_links_write_lock();
+
+	list_for_each_entry(link, &dev->links.suppliers, c_node) {
+		if (!(link->flags & DL_FLAG_MANAGED))
+			continue;
+
+		if (link->status != DL_STATE_AVAILABLE &&
+		    !(link->flags & DL_FLAG_SYNC_STATE_ONLY)) {
+			ready = false;
+			break;
+		}
+	}
+
+	device_links_write_unlock();
+	return ready;
+}
+
 /**
  * __device_links_queue_sync_state - Queue a device for sync_state() callback
  * @dev: Device to call sync_state() on
@@ -74,6 +74,82 @@ static void __device_set_deferred_probe_reason(const struct device *dev, char *r
 	dev->p->deferred_probe_reason = reason;
 }
 
+/*
+ * deferred_probe_skip_waiting=<bool> on the command line (default off) makes
+ * the deferred probe work put devices whose device link suppliers are not
+ * bound yet straight back on the pending list, instead of retrying a probe
+ * that would only defer again; binding the supplier triggers them again.
+ */
+static bool deferred_probe_skip_waiting;
+
+static int __init deferred_probe_skip_waiting_setup(char *str)
+{
+	return kstrtobool(str, &deferred_probe_skip_waiting) == 0;
+}
+__setup("deferred_probe_skip_waiting=", deferred_probe_skip_waiting_setup);
+
+/* Protected by deferred_probe_mutex */
+static struct {
+	unsigned int passes;
+	unsigned int retries;
+	unsigned int skipped;
+	u64 retry_ns;
+	u64 max_pass_ns;
+} deferred_probe_stats;
+
+static void deferred_probe_retry(struct device *dev)
+{
+	ktime_t start = ktime_get();
+	u64 delta;
+
+	/*
+	 * Force the device to the end of the dpm_list since
+	 * the PM code assumes that the order we add things to
+	 * the list is a good order for suspend but deferred
+	 * probe makes that very unsafe.
+	 */
+	device_pm_move_to_tail(dev);
+
+	dev_dbg(dev, "Retrying from deferred list\n");
+	bus_probe_device(dev);
+
+	delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	mutex_lock(&deferred_probe_mutex);
+	dev->p->deferred_probe_retries++;
+	dev->p->deferred_probe_ns += delta;
+	deferred_probe_stats.retries++;
+	deferred_probe_stats.retry_ns += delta;
+	mutex_unlock(&deferred_probe_mutex);
+}
+
+/*
+ * Returns true if @dev was left on the pending list because one of its
+ * suppliers is not bound yet.  Called and returns with deferred_probe_mutex
+ * held, but drops it around the supplier check since the device links code
+ * may take deferred_probe_mutex while holding its own lock.
+ */
+static bool deferred_probe_requeue_waiting(struct device *dev)
+{
+	int trigger_count = atomic_read(&deferred_trigger_count);
+	bool ready;
+
+	mutex_unlock(&deferred_probe_mutex);
+	ready = device_links_suppliers_ready(dev);
+	mutex_lock(&deferred_probe_mutex);
+
+	/* A supplier may have bound while the lock was dropped. */
+	if (ready || atomic_read(&deferred_trigger_count) != trigger_count)
+		return false;
+
+	if (list_empty(&dev->p->deferred_probe)) {
+		list_add_tail(&dev->p->deferred_probe,
+			      &deferred_probe_pending_list);
+		deferred_probe_stats.skipped++;
+	}
+	return true;
+}
+
 /*
  * deferred_probe_work_func() - Retry probing devices in the active list.
  */
@@ -81,6 +157,10 @@ static void deferred_probe_work_func(struct work_struct *work)
 {
 	struct device *dev;
 	struct device_private *private;
+	bool skip_waiting = READ_ONCE(deferred_probe_skip_waiting);
+	ktime_t start = ktime_get();
+	u64 delta;
+
 	/*
 	 * This block processes every device in the deferred 'active' list.
 	 * Each device is removed from the active list and passed to
@@ -102,6 +182,11 @@ static void deferred_probe_work_func(struct work_struct *work)
 
 		get_device(dev);
 
+		if (skip_waiting && deferred_probe_requeue_waiting(dev)) {
+			put_device(dev);
+			continue;
+		}
+
 		__device_set_deferred_probe_reason(dev, NULL);
 
 		/*
@@ -110,21 +195,20 @@ static void deferred_probe_work_func(struct work_struct *work)
 		 */
 		mutex_unlock(&deferred_probe_mutex);
 
-		/*
-		 * Force the device to the end of the dpm_list since
-		 * the PM code assumes that the order we add things to
-		 * the list is a good order for suspend but deferred
-		 * probe makes that very unsafe.
-		 */
-		device_pm_move_to_tail(dev);
-
-		dev_dbg(dev, "Retrying from deferred list\n");
-		bus_probe_device(dev);
+		deferred_probe_retry(dev);
 		mutex_lock(&deferred_probe_mutex);
 
 		put_device(dev);
 	}
 	mutex_unlock(&deferred_probe_mutex);
+
+	delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	mutex_lock(&deferred_probe_mutex);
+	deferred_probe_stats.passes++;
+	deferred_probe_stats.max_pass_ns = max(deferred_probe_stats.max_pass_ns,
+					       delta);
+	mutex_unlock(&deferred_probe_mutex);
 }
 static DECLARE_WORK(deferred_probe_work, deferred_probe_work_func);
 
@@ -255,6 +339,47 @@ static int deferred_devs_show(struct seq_file *s, void *data)
 }
 DEFINE_SHOW_ATTRIBUTE(deferred_devs);
 
+/*
+ * deferred_probe_report_show() - Show time spent retrying deferred devices.
+ * Drivers which probe asynchronously are only timed while their probe is
+ * being scheduled.
+ */
+static int deferred_probe_report_show(struct seq_file *s, void *data)
+{
+	struct device_private *p;
+	struct kobject *k;
+
+	mutex_lock(&deferred_probe_mutex);
+
+	seq_printf(s, "skip_waiting:\t%s\n",
+		   deferred_probe_skip_waiting ? "on" : "off");
+	seq_printf(s, "passes:\t\t%u\n", deferred_probe_stats.passes);
+	seq_printf(s, "retries:\t%u\n", deferred_probe_stats.retries);
+	seq_printf(s, "skipped:\t%u\n", deferred_probe_stats.skipped);
+	seq_printf(s, "retry_us:\t%llu\n",
+		   div_u64(deferred_probe_stats.retry_ns, NSEC_PER_USEC));
+	seq_printf(s, "max_pass_us:\t%llu\n",
+		   div_u64(deferred_probe_stats.max_pass_ns, NSEC_PER_USEC));
+
+	spin_lock(&devices_kset->list_lock);
+	list_for_each_entry(k, &devices_kset->list, entry) {
+		p = kobj_to_dev(k)->p;
+		if (!p || !p->deferred_probe_retries)
+			continue;
+
+		seq_printf(s, "%s\t%u\t%llu\t%s\n", dev_name(p->device),
+			   p->deferred_probe_retries,
+			   div_u64(p->deferred_probe_ns, NSEC_PER_USEC),
+			   device_is_bound(p->device) ? "bound" : "pending");
+	}
+	spin_unlock(&devices_kset->list_lock);
+
+	mutex_unlock(&deferred_probe_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(deferred_probe_report);
+
 int driver_deferred_probe_timeout;
 EXPORT_SYMBOL_GPL(driver_deferred_probe_timeout);
 
@@ -325,6 +450,8 @@ static int deferred_probe_initcall(void)
 {
 	debugfs_create_file("devices_deferred", 0444, NULL, NULL,
 			    &deferred_devs_fops);
+	debugfs_create_file("deferred_probe_report", 0444, NULL, NULL,
+			    &deferred_probe_report_fops);
 
 	driver_deferred_probe_enable = true;
 	driver_deferred_probe_trigger();
@@ -353,6 +480,7 @@ late_initcall(deferred_probe_initcall);
 static void __exit deferred_probe_exit(void)
 {
 	debugfs_lookup_and_remove("devices_deferred", NULL);
+	debugfs_lookup_and_remove("deferred_probe_report", NULL);
 }
 __exitcall(deferred_probe_exit);
 
@@ -1200,6 +1200,140 @@ request_firmware_nowait(
 }
 EXPORT_SYMBOL(request_firmware_nowait);
 
+/*
+ * Firmware prefetch support
+ *
+ * Images listed in 'firmware_class.prefetch=a.bin,b.bin' are loaded in
+ * parallel from the async domain while asynchronous and deferred probes
+ * are still running.  The
+ * loaded buffers stay on fw_cache.head, so a driver that requests one of
+ * them later shares the buffer instead of reading the file again, and a
+ * driver that requests it while the prefetch is still running waits for
+ * that load like any other batched request.  The references are dropped
+ * 'firmware_class.prefetch_hold' seconds after boot.
+ */
+static char fw_prefetch_para[256];
+module_param_string(prefetch, fw_prefetch_para, sizeof(fw_prefetch_para),
+		    0444);
+MODULE_PARM_DESC(prefetch, "comma separated list of firmware images to load in the background at boot");
+
+static unsigned int fw_prefetch_hold = 60;
+module_param_named(prefetch_hold, fw_prefetch_hold, uint, 0644);
+MODULE_PARM_DESC(prefetch_hold, "seconds to keep prefetched firmware images after boot");
+
+struct fw_prefetch_entry {
+	struct list_head list;
+	const struct firmware *fw;
+	char name[];
+};
+
+static ASYNC_DOMAIN_EXCLUSIVE(fw_prefetch_domain);
+static LIST_HEAD(fw_prefetch_list);
+static DEFINE_SPINLOCK(fw_prefetch_lock);
+
+static void fw_prefetch_one(void *data, async_cookie_t cookie)
+{
+	struct fw_prefetch_entry *fpe = data;
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = _request_firmware(&fpe->fw, fpe->name, NULL, NULL, 0, 0,
+				FW_OPT_NO_WARN | FW_OPT_NOFALLBACK_SYSFS);
+	if (ret) {
+		pr_info("prefetch of %s failed with error %d\n",
+			fpe->name, ret);
+		kfree(fpe);
+		return;
+	}
+
+	pr_debug("%s: %s (%zu bytes) in %lld us\n", __func__, fpe->name,
+		 fpe->fw->size, ktime_us_delta(ktime_get(), start));
+
+	spin_lock(&fw_prefetch_lock);
+	list_add(&fpe->list, &fw_prefetch_list);
+	spin_unlock(&fw_prefetch_lock);
+}
+
+static void fw_prefetch_release(void)
+{
+	struct fw_prefetch_entry *fpe, *tmp;
+	LIST_HEAD(list);
+
+	async_synchronize_full_domain(&fw_prefetch_domain);
+
+	spin_lock(&fw_prefetch_lock);
+	list_splice_init(&fw_prefetch_list, &list);
+	spin_unlock(&fw_prefetch_lock);
+
+	list_for_each_entry_safe(fpe, tmp, &list, list) {
+		release_firmware(fpe->fw);
+		kfree(fpe);
+	}
+}
+
+static void fw_prefetch_release_work(struct work_struct *work)
+{
+	fw_prefetch_release();
+}
+
+static DECLARE_DELAYED_WORK(fw_prefetch_work, fw_prefetch_release_work);
+
+static void __init fw_prefetch_start(void)
+{
+	struct fw_prefetch_entry *fpe;
+	char *names, *buf, *name;
+	int count = 0;
+
+	if (!fw_prefetch_para[0])
+		return;
+
+	buf = names = kstrdup(fw_prefetch_para, GFP_KERNEL);
+	if (!names)
+		return;
+
+	while ((name = strsep(&names, ",")) != NULL) {
+		name = strim(name);
+		if (!*name)
+			continue;
+
+		fpe = kzalloc(struct_size(fpe, name, strlen(name) + 1),
+			      GFP_KERNEL);
+		if (!fpe)
+			break;
+
+		strcpy(fpe->name, name);
+		async_schedule_domain(fw_prefetch_one, fpe,
+				      &fw_prefetch_domain);
+		count++;
+	}
+
+	kfree(buf);
+
+	if (count)
+		queue_delayed_work(system_power_efficient_wq, &fw_prefetch_work,
+				   fw_prefetch_hold * HZ);
+}
+
+static void fw_prefetch_stop(void)
+{
+	cancel_delayed_work_sync(&fw_prefetch_work);
+	fw_prefetch_release();
+}
+
+#ifndef MODULE
+/*
+ * The images are read from the root file system, which the fs_initcall
+ * that sets up the loader runs ahead of, so start the prefetch once the
+ * initramfs has been unpacked.
+ */
+static int __init fw_prefetch_init(void)
+{
+	fw_prefetch_start();
+	return 0;
+}
+late_initcall(fw_prefetch_init);
+#endif
+
 #ifdef CONFIG_FW_CACHE
 static ASYNC_DOMAIN_EXCLUSIVE(fw_cache_domain);
 
@@ -1603,6 +1737,10 @@ static int __init firmware_class_init(void)
 	if (ret)
 		goto out;
 
+	/* Built in, the prefetch is started by fw_prefetch_init() */
+	if (IS_MODULE(CONFIG_FW_LOADER))
+		fw_prefetch_start();
+
 	return register_sysfs_loader();
 
 out:
@@ -1612,6 +1750,7 @@ static int __init firmware_class_init(void)
 
 static void __exit firmware_class_exit(void)
 {
+	fw_prefetch_stop();
 	unregister_fw_pm_ops();
 	unregister_reboot_notifier(&fw_shutdown_nb);
 	unregister_sysfs_loader();
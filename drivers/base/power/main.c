@@ -35,6 +35,9 @@
 #include <linux/cpuidle.h>
 #include <linux/devfreq.h>
 #include <linux/timer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 
 #include "../base.h"
 #include "power.h"
@@ -229,6 +232,116 @@ static void initcall_debug_report(struct device *dev, ktime_t calltime,
 		 (unsigned long long)ktime_us_delta(rettime, calltime));
 }
 
+static bool is_async(struct device *dev)
+{
+	return dev->power.async_suspend && pm_async_enabled
+		&& !pm_trace_is_enabled();
+}
+
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Per-device callback timings of the last DPM_TIMES_CYCLES system
+ * transitions, read back through debugfs "suspend_device_times".  A cycle
+ * starts with dpm_suspend_start(), and the records share a ring of
+ * DPM_TIMES_RECORDS entries, so the oldest cycle may come out truncated on
+ * systems with many devices.
+ */
+#define DPM_TIMES_CYCLES	4
+#define DPM_TIMES_RECORDS	1024
+
+struct dpm_time_record {
+	unsigned int cycle;
+	int event;
+	const char *info;
+	void *cb;
+	char name[32];
+	u32 start_us;
+	u32 usecs;
+	int error;
+	bool async;
+};
+
+static struct dpm_time_record *dpm_times;
+static unsigned int dpm_times_next;
+static unsigned int dpm_times_cycle;
+static ktime_t dpm_times_cycle_start;
+static DEFINE_SPINLOCK(dpm_times_lock);
+
+static void dpm_times_new_cycle(void)
+{
+	if (!dpm_times)
+		dpm_times = kcalloc(DPM_TIMES_RECORDS, sizeof(*dpm_times),
+				    GFP_KERNEL);
+
+	spin_lock(&dpm_times_lock);
+	dpm_times_cycle++;
+	dpm_times_cycle_start = ktime_get();
+	spin_unlock(&dpm_times_lock);
+}
+
+static void dpm_times_record(struct device *dev, pm_message_t state,
+			     const char *info, void *cb, ktime_t calltime,
+			     int error)
+{
+	ktime_t rettime = ktime_get();
+	struct dpm_time_record *rec;
+
+	if (!dpm_times)
+		return;
+
+	spin_lock(&dpm_times_lock);
+	rec = &dpm_times[dpm_times_next++ % DPM_TIMES_RECORDS];
+	rec->cycle = dpm_times_cycle;
+	rec->event = state.event;
+	rec->info = info;
+	rec->cb = cb;
+	strscpy(rec->name, dev_name(dev), sizeof(rec->name));
+	rec->start_us = ktime_us_delta(calltime, dpm_times_cycle_start);
+	rec->usecs = ktime_us_delta(rettime, calltime);
+	rec->error = error;
+	rec->async = is_async(dev);
+	spin_unlock(&dpm_times_lock);
+}
+
+static int suspend_device_times_show(struct seq_file *s, void *unused)
+{
+	unsigned int i, n;
+
+	seq_puts(s, "cycle   start_us      usecs mode  error device                           phase (callback)\n");
+
+	spin_lock(&dpm_times_lock);
+	n = min_t(unsigned int, dpm_times_next, DPM_TIMES_RECORDS);
+	for (i = dpm_times_next - n; dpm_times && i != dpm_times_next; i++) {
+		struct dpm_time_record *rec = &dpm_times[i % DPM_TIMES_RECORDS];
+
+		if (dpm_times_cycle - rec->cycle >= DPM_TIMES_CYCLES)
+			continue;
+
+		seq_printf(s, "%5u %10u %10u %-5s %5d %-32s %s%s (%ps)\n",
+			   rec->cycle, rec->start_us, rec->usecs,
+			   rec->async ? "async" : "sync", rec->error, rec->name,
+			   rec->info ?: "", pm_verb(rec->event), rec->cb);
+	}
+	spin_unlock(&dpm_times_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(suspend_device_times);
+
+static int __init dpm_times_debugfs_init(void)
+{
+	debugfs_create_file("suspend_device_times", 0444, NULL, NULL,
+			    &suspend_device_times_fops);
+	return 0;
+}
+late_initcall(dpm_times_debugfs_init);
+#else
+static inline void dpm_times_new_cycle(void) {}
+static inline void dpm_times_record(struct device *dev, pm_message_t state,
+				    const char *info, void *cb,
+				    ktime_t calltime, int error) {}
+#endif /* CONFIG_DEBUG_FS */
+
 /**
  * dpm_wait - Wait for a PM operation to complete.
  * @dev: Device to wait for.
@@ -474,7 +587,7 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, int error,
 static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 			    pm_message_t state, const char *info)
 {
-	ktime_t calltime;
+	ktime_t calltime, starttime;
 	int error;
 
 	if (!cb)
@@ -484,7 +597,9 @@ static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 
 	pm_dev_dbg(dev, state, info);
 	trace_device_pm_callback_start(dev, info, state.event);
+	starttime = ktime_get();
 	error = cb(dev);
+	dpm_times_record(dev, state, info, cb, starttime, error);
 	trace_device_pm_callback_end(dev, error);
 	suspend_report_result(cb, error);
 
@@ -665,12 +780,6 @@ static void __device_resume_noirq(struct device *dev, pm_message_t state, bool a
 	}
 }
 
-static bool is_async(struct device *dev)
-{
-	return dev->power.async_suspend && pm_async_enabled
-		&& !pm_trace_is_enabled();
-}
-
 static bool dpm_async_fn(struct device *dev, async_func_t func)
 {
 	reinit_completion(&dev->power.completion);
@@ -1552,12 +1661,14 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 			  const char *info)
 {
 	int error;
-	ktime_t calltime;
+	ktime_t calltime, starttime;
 
 	calltime = initcall_debug_start(dev, cb);
 
 	trace_device_pm_callback_start(dev, info, state.event);
+	starttime = ktime_get();
 	error = cb(dev, state);
+	dpm_times_record(dev, state, info, cb, starttime, error);
 	trace_device_pm_callback_end(dev, error);
 	suspend_report_result(cb, error);
 
@@ -1941,6 +2052,7 @@ int dpm_suspend_start(pm_message_t state)
 	ktime_t starttime = ktime_get();
 	int error;
 
+	dpm_times_new_cycle();
 	error = dpm_prepare(state);
 	if (error) {
 		suspend_stats.failed_prepare++;
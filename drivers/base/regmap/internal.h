@@ -281,6 +281,7 @@ enum regmap_endian regmap_get_val_endian(struct device *dev,
 extern struct regcache_ops regcache_rbtree_ops;
 extern struct regcache_ops regcache_lzo_ops;
 extern struct regcache_ops regcache_flat_ops;
+extern struct regcache_ops regcache_range_ops;
 
 static inline const char *regmap_name(const struct regmap *map)
 {
@@ -0,0 +1,451 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Register cache access API - range caching support
+//
+// A sorted array of register blocks, looked up by binary search. Blocks
+// that become adjacent are merged, so that a sync can write each run of
+// cached registers in as few raw bursts as possible.
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+#include "internal.h"
+
+static int regcache_range_exit(struct regmap *map);
+
+struct regcache_range_block {
+	/* block of adjacent registers */
+	void *block;
+	/* Which registers are present */
+	unsigned long *cache_present;
+	/* base register handled by this block */
+	unsigned int base_reg;
+	/* number of registers available in the block */
+	unsigned int blklen;
+};
+
+struct regcache_range_ctx {
+	/* blocks sorted by base register, never overlapping */
+	struct regcache_range_block *blocks;
+	unsigned int nblocks;
+	unsigned int size;
+	/* index of the block that satisfied the last lookup */
+	unsigned int cached;
+};
+
+static inline unsigned int regcache_range_top_reg(struct regmap *map,
+					struct regcache_range_block *blk)
+{
+	return blk->base_reg + ((blk->blklen - 1) * map->reg_stride);
+}
+
+/*
+ * Find the block holding @reg. If there is none, return NULL and store
+ * in @pos the index that a block starting at @reg would be inserted at.
+ */
+static struct regcache_range_block *
+regcache_range_lookup(struct regmap *map, unsigned int reg, unsigned int *pos)
+{
+	struct regcache_range_ctx *ctx = map->cache;
+	struct regcache_range_block *blk;
+	unsigned int lo = 0, hi = ctx->nblocks, mid;
+
+	if (ctx->cached < ctx->nblocks) {
+		blk = &ctx->blocks[ctx->cached];
+		if (reg >= blk->base_reg &&
+		    reg <= regcache_range_top_reg(map, blk))
+			return blk;
+	}
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		blk = &ctx->blocks[mid];
+
+		if (reg < blk->base_reg) {
+			hi = mid;
+		} else if (reg > regcache_range_top_reg(map, blk)) {
+			lo = mid + 1;
+		} else {
+			ctx->cached = mid;
+			return blk;
+		}
+	}
+
+	if (pos)
+		*pos = lo;
+
+	return NULL;
+}
+
+/* Grow @blk to cover base_reg..top_reg, keeping its current contents */
+static int regcache_range_resize(struct regmap *map,
+				 struct regcache_range_block *blk,
+				 unsigned int base_reg, unsigned int top_reg)
+{
+	unsigned int blklen, offset;
+	unsigned long *present;
+	u8 *data;
+
+	blklen = (top_reg - base_reg) / map->reg_stride + 1;
+	offset = (blk->base_reg - base_reg) / map->reg_stride;
+
+	data = krealloc(blk->block, blklen * map->cache_word_size,
+			map->alloc_flags);
+	if (!data)
+		return -ENOMEM;
+
+	blk->block = data;
+
+	if (BITS_TO_LONGS(blklen) > BITS_TO_LONGS(blk->blklen)) {
+		present = krealloc(blk->cache_present,
+				   BITS_TO_LONGS(blklen) * sizeof(*present),
+				   map->alloc_flags);
+		if (!present)
+			return -ENOMEM;
+
+		memset(present + BITS_TO_LONGS(blk->blklen), 0,
+		       (BITS_TO_LONGS(blklen) - BITS_TO_LONGS(blk->blklen))
+		       * sizeof(*present));
+		blk->cache_present = present;
+	}
+
+	if (offset) {
+		memmove(data + offset * map->cache_word_size, data,
+			blk->blklen * map->cache_word_size);
+		bitmap_shift_left(blk->cache_present, blk->cache_present,
+				  offset, blklen);
+	}
+
+	blk->base_reg = base_reg;
+	blk->blklen = blklen;
+
+	return 0;
+}
+
+static void regcache_range_remove(struct regcache_range_ctx *ctx,
+				  unsigned int idx)
+{
+	memmove(&ctx->blocks[idx], &ctx->blocks[idx + 1],
+		(ctx->nblocks - idx - 1) * sizeof(*ctx->blocks));
+	ctx->nblocks--;
+	ctx->cached = 0;
+}
+
+/* Merge block @idx + 1 into @idx if the two have become adjacent */
+static int regcache_range_merge(struct regmap *map, unsigned int idx)
+{
+	struct regcache_range_ctx *ctx = map->cache;
+	struct regcache_range_block *blk, *next;
+	unsigned int len, i;
+	int ret;
+
+	if (idx + 1 >= ctx->nblocks)
+		return 0;
+
+	blk = &ctx->blocks[idx];
+	next = &ctx->blocks[idx + 1];
+	if (regcache_range_top_reg(map, blk) + map->reg_stride !=
+	    next->base_reg)
+		return 0;
+
+	len = blk->blklen;
+	ret = regcache_range_resize(map, blk, blk->base_reg,
+				    regcache_range_top_reg(map, next));
+	if (ret)
+		return ret;
+
+	memcpy(blk->block + len * map->cache_word_size, next->block,
+	       next->blklen * map->cache_word_size);
+	for_each_set_bit(i, next->cache_present, next->blklen)
+		set_bit(len + i, blk->cache_present);
+
+	kfree(next->cache_present);
+	kfree(next->block);
+	regcache_range_remove(ctx, idx + 1);
+
+	return 0;
+}
+
+static int regcache_range_insert(struct regmap *map, unsigned int pos,
+				 unsigned int reg)
+{
+	struct regcache_range_ctx *ctx = map->cache;
+	struct regcache_range_block *blk, *blocks;
+	unsigned int size;
+
+	if (ctx->nblocks == ctx->size) {
+		size = ctx->size ? ctx->size * 2 : 8;
+		blocks = krealloc(ctx->blocks, size * sizeof(*blocks),
+				  map->alloc_flags);
+		if (!blocks)
+			return -ENOMEM;
+
+		ctx->blocks = blocks;
+		ctx->size = size;
+	}
+
+	blk = &ctx->blocks[pos];
+	memmove(blk + 1, blk, (ctx->nblocks - pos) * sizeof(*blk));
+	memset(blk, 0, sizeof(*blk));
+	ctx->nblocks++;
+
+	blk->base_reg = reg;
+	blk->blklen = 1;
+	blk->block = kmalloc(map->cache_word_size, map->alloc_flags);
+	blk->cache_present = kcalloc(1, sizeof(*blk->cache_present),
+				     map->alloc_flags);
+	if (!blk->block || !blk->cache_present) {
+		kfree(blk->cache_present);
+		kfree(blk->block);
+		regcache_range_remove(ctx, pos);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int regcache_range_read(struct regmap *map,
+			       unsigned int reg, unsigned int *value)
+{
+	struct regcache_range_block *blk;
+	unsigned int idx;
+
+	blk = regcache_range_lookup(map, reg, NULL);
+	if (!blk)
+		return -ENOENT;
+
+	idx = (reg - blk->base_reg) / map->reg_stride;
+	if (!test_bit(idx, blk->cache_present))
+		return -ENOENT;
+
+	*value = regcache_get_val(map, blk->block, idx);
+
+	return 0;
+}
+
+static int regcache_range_write(struct regmap *map, unsigned int reg,
+				unsigned int value)
+{
+	struct regcache_range_ctx *ctx = map->cache;
+	struct regcache_range_block *blk, *prev, *next;
+	unsigned int pos, idx, max_dist;
+	int ret;
+
+	blk = regcache_range_lookup(map, reg, &pos);
+	if (blk)
+		goto set;
+
+	/*
+	 * Extend a neighbouring block if the gap costs less memory than
+	 * a block of its own would.
+	 */
+	max_dist = map->reg_stride * sizeof(*blk) / map->cache_word_size;
+	prev = pos ? &ctx->blocks[pos - 1] : NULL;
+	next = pos < ctx->nblocks ? &ctx->blocks[pos] : NULL;
+
+	if (prev && reg - regcache_range_top_reg(map, prev) <= max_dist) {
+		ret = regcache_range_resize(map, prev, prev->base_reg, reg);
+		if (ret)
+			return ret;
+		ret = regcache_range_merge(map, pos - 1);
+		if (ret)
+			return ret;
+		pos--;
+	} else if (next && next->base_reg - reg <= max_dist) {
+		ret = regcache_range_resize(map, next, reg,
+					    regcache_range_top_reg(map, next));
+		if (ret)
+			return ret;
+		if (pos) {
+			ret = regcache_range_merge(map, pos - 1);
+			if (ret)
+				return ret;
+		}
+	} else {
+		ret = regcache_range_insert(map, pos, reg);
+		if (ret)
+			return ret;
+	}
+
+	/* Look the block up again, merging may have moved it */
+	ctx->cached = pos;
+	blk = regcache_range_lookup(map, reg, NULL);
+	if (WARN_ON(!blk))
+		return -EINVAL;
+
+set:
+	idx = (reg - blk->base_reg) / map->reg_stride;
+	set_bit(idx, blk->cache_present);
+	regcache_set_val(map, blk->block, idx, value);
+
+	return 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int range_show(struct seq_file *s, void *ignored)
+{
+	struct regmap *map = s->private;
+	struct regcache_range_ctx *ctx = map->cache;
+	struct regcache_range_block *blk;
+	unsigned int i, top;
+	size_t mem_size;
+	unsigned int registers = 0;
+
+	map->lock(map->lock_arg);
+
+	mem_size = sizeof(*ctx) + ctx->size * sizeof(*ctx->blocks);
+
+	for (i = 0; i < ctx->nblocks; i++) {
+		blk = &ctx->blocks[i];
+		mem_size += blk->blklen * map->cache_word_size;
+		mem_size += BITS_TO_LONGS(blk->blklen) * sizeof(long);
+
+		top = regcache_range_top_reg(map, blk);
+		seq_printf(s, "%x-%x (%u)\n", blk->base_reg, top, blk->blklen);
+
+		registers += blk->blklen;
+	}
+
+	seq_printf(s, "%u blocks, %u registers, used %zu bytes\n",
+		   ctx->nblocks, registers, mem_size);
+
+	map->unlock(map->lock_arg);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(range);
+
+static void range_debugfs_init(struct regmap *map)
+{
+	debugfs_create_file("range", 0400, map->debugfs, map, &range_fops);
+}
+#endif
+
+static int regcache_range_init(struct regmap *map)
+{
+	int i;
+	int ret;
+
+	map->cache = kzalloc(sizeof(struct regcache_range_ctx), GFP_KERNEL);
+	if (!map->cache)
+		return -ENOMEM;
+
+	for (i = 0; i < map->num_reg_defaults; i++) {
+		ret = regcache_range_write(map, map->reg_defaults[i].reg,
+					   map->reg_defaults[i].def);
+		if (ret)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	regcache_range_exit(map);
+	return ret;
+}
+
+static int regcache_range_exit(struct regmap *map)
+{
+	struct regcache_range_ctx *ctx = map->cache;
+	unsigned int i;
+
+	/* if we've already been called then just return */
+	if (!ctx)
+		return 0;
+
+	for (i = 0; i < ctx->nblocks; i++) {
+		kfree(ctx->blocks[i].cache_present);
+		kfree(ctx->blocks[i].block);
+	}
+
+	kfree(ctx->blocks);
+	kfree(ctx);
+	map->cache = NULL;
+
+	return 0;
+}
+
+static int regcache_range_sync(struct regmap *map, unsigned int min,
+			       unsigned int max)
+{
+	struct regcache_range_ctx *ctx = map->cache;
+	struct regcache_range_block *blk;
+	unsigned int i, top_reg, start, end;
+	int ret;
+
+	for (i = 0; i < ctx->nblocks; i++) {
+		blk = &ctx->blocks[i];
+		top_reg = regcache_range_top_reg(map, blk);
+
+		if (blk->base_reg > max)
+			break;
+		if (top_reg < min)
+			continue;
+
+		if (min > blk->base_reg)
+			start = (min - blk->base_reg) / map->reg_stride;
+		else
+			start = 0;
+
+		if (max < top_reg)
+			end = (max - blk->base_reg) / map->reg_stride + 1;
+		else
+			end = blk->blklen;
+
+		ret = regcache_sync_block(map, blk->block, blk->cache_present,
+					  blk->base_reg, start, end);
+		if (ret != 0)
+			return ret;
+	}
+
+	return regmap_async_complete(map);
+}
+
+static int regcache_range_drop(struct regmap *map, unsigned int min,
+			       unsigned int max)
+{
+	struct regcache_range_ctx *ctx = map->cache;
+	struct regcache_range_block *blk;
+	unsigned int i, top_reg, start, end;
+
+	for (i = 0; i < ctx->nblocks; i++) {
+		blk = &ctx->blocks[i];
+		top_reg = regcache_range_top_reg(map, blk);
+
+		if (blk->base_reg > max)
+			break;
+		if (top_reg < min)
+			continue;
+
+		if (min > blk->base_reg)
+			start = (min - blk->base_reg) / map->reg_stride;
+		else
+			start = 0;
+
+		if (max < top_reg)
+			end = (max - blk->base_reg) / map->reg_stride + 1;
+		else
+			end = blk->blklen;
+
+		bitmap_clear(blk->cache_present, start, end - start);
+	}
+
+	return 0;
+}
+
+struct regcache_ops regcache_range_ops = {
+	.type = REGCACHE_RANGE,
+	.name = "range",
+	.init = regcache_range_init,
+	.exit = regcache_range_exit,
+#ifdef CONFIG_DEBUG_FS
+	.debugfs_init = range_debugfs_init,
+#endif
+	.read = regcache_range_read,
+	.write = regcache_range_write,
+	.sync = regcache_range_sync,
+	.drop = regcache_range_drop,
+};
@@ -21,6 +21,7 @@ static const struct regcache_ops *cache_types[] = {
 	&regcache_lzo_ops,
 #endif
 	&regcache_flat_ops,
+	&regcache_range_ops,
 };
 
 static int regcache_hw_init(struct regmap *map)
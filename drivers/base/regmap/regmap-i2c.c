@@ -9,6 +9,9 @@
 #include <linux/regmap.h>
 #include <linux/i2c.h>
 #include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <asm/unaligned.h>
 
 #include "internal.h"
 
@@ -120,12 +123,202 @@ static const struct regmap_bus regmap_smbus_word_swapped = {
 	.reg_read = regmap_smbus_word_read_swapped,
 };
 
+/*
+ * Asynchronous writes are queued on the context and issued from a work
+ * item.  Everything that is pending when the work runs is sent as a
+ * single i2c_transfer(), and writes to consecutive registers are merged
+ * into one message if the device auto-increments its register address.
+ */
+#define REGMAP_I2C_ASYNC_MSGS		8
+#define REGMAP_I2C_ASYNC_BUF_SIZE	256
+
+struct regmap_i2c_context {
+	struct i2c_client *i2c;
+
+	struct work_struct async_work;
+	spinlock_t async_lock;
+	struct list_head async_pending;
+
+	unsigned int reg_bytes;
+	unsigned int val_bytes;
+	unsigned int reg_stride;
+	bool auto_increment;
+	unsigned int max_msgs;
+	size_t max_msg_len;
+
+	struct i2c_msg msgs[REGMAP_I2C_ASYNC_MSGS];
+	u8 buf[REGMAP_I2C_ASYNC_BUF_SIZE];
+};
+
+struct regmap_async_i2c {
+	struct regmap_async core;
+	struct list_head node;
+	const void *reg;
+	size_t reg_len;
+	const void *val;
+	size_t val_len;
+};
+
+static int regmap_i2c_xfer_ret(int ret, int num)
+{
+	if (ret == num)
+		return 0;
+	else if (ret < 0)
+		return ret;
+	else
+		return -EIO;
+}
+
+static unsigned int regmap_i2c_async_reg(struct regmap_i2c_context *ctx,
+					 struct regmap_async_i2c *async)
+{
+	if (ctx->reg_bytes == 1)
+		return *(u8 *)async->reg;
+
+	return get_unaligned_be16(async->reg);
+}
+
+static void regmap_i2c_async_complete(struct list_head *done, int ret)
+{
+	struct regmap_async_i2c *async, *tmp;
+
+	list_for_each_entry_safe(async, tmp, done, node) {
+		list_del(&async->node);
+		regmap_async_complete_cb(&async->core, ret);
+	}
+}
+
+/* Send a write that does not fit in the bounce buffer on its own. */
+static void regmap_i2c_async_single(struct regmap_i2c_context *ctx,
+				    struct list_head *queue)
+{
+	struct regmap_async_i2c *async;
+	struct i2c_msg msg;
+	LIST_HEAD(done);
+	u8 *buf;
+	int ret;
+
+	async = list_first_entry(queue, struct regmap_async_i2c, node);
+	list_move_tail(&async->node, &done);
+
+	buf = kmalloc(async->reg_len + async->val_len, GFP_KERNEL | GFP_DMA);
+	if (!buf) {
+		regmap_i2c_async_complete(&done, -ENOMEM);
+		return;
+	}
+
+	memcpy(buf, async->reg, async->reg_len);
+	memcpy(buf + async->reg_len, async->val, async->val_len);
+
+	msg.addr = ctx->i2c->addr;
+	msg.flags = 0;
+	msg.len = async->reg_len + async->val_len;
+	msg.buf = buf;
+
+	ret = i2c_transfer(ctx->i2c->adapter, &msg, 1);
+	kfree(buf);
+
+	regmap_i2c_async_complete(&done, regmap_i2c_xfer_ret(ret, 1));
+}
+
+/*
+ * Pack as many queued writes as fit into ctx->msgs and ctx->buf, send
+ * them with a single i2c_transfer() and complete them.
+ */
+static void regmap_i2c_async_batch(struct regmap_i2c_context *ctx,
+				   struct list_head *queue)
+{
+	struct regmap_async_i2c *async;
+	struct i2c_msg *msg = NULL;
+	unsigned int next_reg = 0;
+	LIST_HEAD(done);
+	size_t used = 0;
+	int num = 0;
+	int ret;
+
+	async = list_first_entry(queue, struct regmap_async_i2c, node);
+	if (async->reg_len + async->val_len > ctx->max_msg_len) {
+		regmap_i2c_async_single(ctx, queue);
+		return;
+	}
+
+	while (!list_empty(queue)) {
+		size_t len;
+
+		async = list_first_entry(queue, struct regmap_async_i2c, node);
+
+		/* Append to the current message if it continues it. */
+		if (msg && ctx->auto_increment &&
+		    regmap_i2c_async_reg(ctx, async) == next_reg &&
+		    msg->len + async->val_len <= ctx->max_msg_len &&
+		    used + async->val_len <= sizeof(ctx->buf)) {
+			memcpy(ctx->buf + used, async->val, async->val_len);
+			used += async->val_len;
+			msg->len += async->val_len;
+		} else {
+			len = async->reg_len + async->val_len;
+			if (num == ctx->max_msgs || len > ctx->max_msg_len ||
+			    used + len > sizeof(ctx->buf))
+				break;
+
+			msg = &ctx->msgs[num++];
+			msg->addr = ctx->i2c->addr;
+			msg->flags = 0;
+			msg->len = len;
+			msg->buf = ctx->buf + used;
+
+			memcpy(ctx->buf + used, async->reg, async->reg_len);
+			memcpy(ctx->buf + used + async->reg_len, async->val,
+			       async->val_len);
+			used += len;
+			next_reg = regmap_i2c_async_reg(ctx, async);
+		}
+
+		if (ctx->auto_increment)
+			next_reg += async->val_len / ctx->val_bytes *
+				    ctx->reg_stride;
+
+		list_move_tail(&async->node, &done);
+	}
+
+	ret = i2c_transfer(ctx->i2c->adapter, ctx->msgs, num);
+
+	regmap_i2c_async_complete(&done, regmap_i2c_xfer_ret(ret, num));
+}
+
+static void regmap_i2c_async_work(struct work_struct *work)
+{
+	struct regmap_i2c_context *ctx = container_of(work,
+						      struct regmap_i2c_context,
+						      async_work);
+	LIST_HEAD(queue);
+
+	spin_lock_irq(&ctx->async_lock);
+	list_splice_init(&ctx->async_pending, &queue);
+	spin_unlock_irq(&ctx->async_lock);
+
+	while (!list_empty(&queue))
+		regmap_i2c_async_batch(ctx, &queue);
+}
+
+/*
+ * Synchronous I/O must not overtake writes that are still queued, so
+ * wait for the work item to drain them first.  New async writes can't
+ * be queued meanwhile since both paths run under the regmap lock.
+ */
+static void regmap_i2c_async_flush(struct regmap_i2c_context *ctx)
+{
+	flush_work(&ctx->async_work);
+}
+
 static int regmap_i2c_write(void *context, const void *data, size_t count)
 {
-	struct device *dev = context;
-	struct i2c_client *i2c = to_i2c_client(dev);
+	struct regmap_i2c_context *ctx = context;
+	struct i2c_client *i2c = ctx->i2c;
 	int ret;
 
+	regmap_i2c_async_flush(ctx);
+
 	ret = i2c_master_send(i2c, data, count);
 	if (ret == count)
 		return 0;
@@ -139,8 +332,8 @@ static int regmap_i2c_gather_write(void *context,
 				   const void *reg, size_t reg_size,
 				   const void *val, size_t val_size)
 {
-	struct device *dev = context;
-	struct i2c_client *i2c = to_i2c_client(dev);
+	struct regmap_i2c_context *ctx = context;
+	struct i2c_client *i2c = ctx->i2c;
 	struct i2c_msg xfer[2];
 	int ret;
 
@@ -150,6 +343,8 @@ static int regmap_i2c_gather_write(void *context,
 	if (!i2c_check_functionality(i2c->adapter, I2C_FUNC_NOSTART))
 		return -ENOTSUPP;
 
+	regmap_i2c_async_flush(ctx);
+
 	xfer[0].addr = i2c->addr;
 	xfer[0].flags = 0;
 	xfer[0].len = reg_size;
@@ -169,15 +364,63 @@ static int regmap_i2c_gather_write(void *context,
 		return -EIO;
 }
 
+static int regmap_i2c_async_write(void *context,
+				  const void *reg, size_t reg_len,
+				  const void *val, size_t val_len,
+				  struct regmap_async *a)
+{
+	struct regmap_async_i2c *async = container_of(a,
+						      struct regmap_async_i2c,
+						      core);
+	struct regmap_i2c_context *ctx = context;
+	unsigned long flags;
+
+	/* Split single buffer writes so they can be merged like the rest. */
+	if (!val) {
+		if (reg_len < ctx->reg_bytes)
+			return -EINVAL;
+
+		val = reg + ctx->reg_bytes;
+		val_len = reg_len - ctx->reg_bytes;
+		reg_len = ctx->reg_bytes;
+	}
+
+	async->reg = reg;
+	async->reg_len = reg_len;
+	async->val = val;
+	async->val_len = val_len;
+
+	spin_lock_irqsave(&ctx->async_lock, flags);
+	list_add_tail(&async->node, &ctx->async_pending);
+	spin_unlock_irqrestore(&ctx->async_lock, flags);
+
+	queue_work(system_unbound_wq, &ctx->async_work);
+
+	return 0;
+}
+
+static struct regmap_async *regmap_i2c_async_alloc(void)
+{
+	struct regmap_async_i2c *async_i2c;
+
+	async_i2c = kzalloc(sizeof(*async_i2c), GFP_KERNEL);
+	if (!async_i2c)
+		return NULL;
+
+	return &async_i2c->core;
+}
+
 static int regmap_i2c_read(void *context,
 			   const void *reg, size_t reg_size,
 			   void *val, size_t val_size)
 {
-	struct device *dev = context;
-	struct i2c_client *i2c = to_i2c_client(dev);
+	struct regmap_i2c_context *ctx = context;
+	struct i2c_client *i2c = ctx->i2c;
 	struct i2c_msg xfer[2];
 	int ret;
 
+	regmap_i2c_async_flush(ctx);
+
 	xfer[0].addr = i2c->addr;
 	xfer[0].flags = 0;
 	xfer[0].len = reg_size;
@@ -197,10 +440,21 @@ static int regmap_i2c_read(void *context,
 		return -EIO;
 }
 
+static void regmap_i2c_free_context(void *context)
+{
+	struct regmap_i2c_context *ctx = context;
+
+	flush_work(&ctx->async_work);
+	kfree(ctx);
+}
+
 static const struct regmap_bus regmap_i2c = {
 	.write = regmap_i2c_write,
 	.gather_write = regmap_i2c_gather_write,
+	.async_write = regmap_i2c_async_write,
+	.async_alloc = regmap_i2c_async_alloc,
 	.read = regmap_i2c_read,
+	.free_context = regmap_i2c_free_context,
 	.reg_format_endian_default = REGMAP_ENDIAN_BIG,
 	.val_format_endian_default = REGMAP_ENDIAN_BIG,
 };
@@ -367,18 +621,90 @@ static const struct regmap_bus *regmap_get_i2c_bus(struct i2c_client *i2c,
 	return bus;
 }
 
+static struct regmap_i2c_context *
+regmap_i2c_gen_context(struct i2c_client *i2c,
+		       const struct regmap_config *config)
+{
+	const struct i2c_adapter_quirks *quirks = i2c->adapter->quirks;
+	struct regmap_i2c_context *ctx;
+	enum regmap_endian reg_endian;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return ERR_PTR(-ENOMEM);
+
+	ctx->i2c = i2c;
+	INIT_WORK(&ctx->async_work, regmap_i2c_async_work);
+	spin_lock_init(&ctx->async_lock);
+	INIT_LIST_HEAD(&ctx->async_pending);
+
+	ctx->reg_bytes = (config->reg_bits + config->pad_bits) / BITS_PER_BYTE;
+	ctx->val_bytes = DIV_ROUND_UP(config->val_bits, BITS_PER_BYTE);
+	ctx->reg_stride = config->reg_stride ? config->reg_stride : 1;
+	ctx->max_msgs = REGMAP_I2C_ASYNC_MSGS;
+	ctx->max_msg_len = REGMAP_I2C_ASYNC_BUF_SIZE;
+
+	/*
+	 * Devices that take multi-register raw writes auto-increment the
+	 * register address, so consecutive async writes can be merged as
+	 * long as the address can be recovered from the formatted buffer.
+	 */
+	reg_endian = config->reg_format_endian;
+	ctx->auto_increment = !config->use_single_write &&
+			      (config->reg_bits == 8 ||
+			       config->reg_bits == 16) &&
+			      !config->pad_bits && !config->write_flag_mask &&
+			      (reg_endian == REGMAP_ENDIAN_DEFAULT ||
+			       reg_endian == REGMAP_ENDIAN_BIG);
+
+	if (quirks) {
+		if (quirks->flags & (I2C_AQ_NO_REP_START | I2C_AQ_COMB))
+			ctx->max_msgs = 1;
+		else if (quirks->max_num_msgs)
+			ctx->max_msgs = min_t(unsigned int, ctx->max_msgs,
+					      quirks->max_num_msgs);
+
+		if (quirks->max_write_len)
+			ctx->max_msg_len = min_t(size_t, ctx->max_msg_len,
+						 quirks->max_write_len);
+	}
+
+	return ctx;
+}
+
+static void *regmap_i2c_bus_context(struct i2c_client *i2c,
+				    const struct regmap_bus *bus,
+				    const struct regmap_config *config)
+{
+	if (bus->free_context != regmap_i2c_free_context)
+		return &i2c->dev;
+
+	return regmap_i2c_gen_context(i2c, config);
+}
+
 struct regmap *__regmap_init_i2c(struct i2c_client *i2c,
 				 const struct regmap_config *config,
 				 struct lock_class_key *lock_key,
 				 const char *lock_name)
 {
 	const struct regmap_bus *bus = regmap_get_i2c_bus(i2c, config);
+	struct regmap *map;
+	void *ctx;
 
 	if (IS_ERR(bus))
 		return ERR_CAST(bus);
 
-	return __regmap_init(&i2c->dev, bus, &i2c->dev, config,
-			     lock_key, lock_name);
+	ctx = regmap_i2c_bus_context(i2c, bus, config);
+	if (IS_ERR(ctx))
+		return ERR_CAST(ctx);
+
+	map = __regmap_init(&i2c->dev, bus, ctx, config,
+			    lock_key, lock_name);
+	/* The map only takes the context over once it has been set up */
+	if (IS_ERR(map) && bus->free_context == regmap_i2c_free_context)
+		regmap_i2c_free_context(ctx);
+
+	return map;
 }
 EXPORT_SYMBOL_GPL(__regmap_init_i2c);
 
@@ -388,12 +714,22 @@ struct regmap *__devm_regmap_init_i2c(struct i2c_client *i2c,
 				      const char *lock_name)
 {
 	const struct regmap_bus *bus = regmap_get_i2c_bus(i2c, config);
+	struct regmap *map;
+	void *ctx;
 
 	if (IS_ERR(bus))
 		return ERR_CAST(bus);
 
-	return __devm_regmap_init(&i2c->dev, bus, &i2c->dev, config,
-				  lock_key, lock_name);
+	ctx = regmap_i2c_bus_context(i2c, bus, config);
+	if (IS_ERR(ctx))
+		return ERR_CAST(ctx);
+
+	map = __devm_regmap_init(&i2c->dev, bus, ctx, config,
+				 lock_key, lock_name);
+	if (IS_ERR(map) && bus->free_context == regmap_i2c_free_context)
+		regmap_i2c_free_context(ctx);
+
+	return map;
 }
 EXPORT_SYMBOL_GPL(__devm_regmap_init_i2c);
 
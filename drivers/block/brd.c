@@ -33,6 +33,10 @@
  * its offset in PAGE_SIZE units. This is similar to, but in no way connected
  * with, the kernel's pagecache or buffer cache (which sit above our block
  * device).
+ *
+ * With rd_page_order set, each radix tree entry is the first page of a
+ * 2^rd_page_order block of contiguous pages and ->index is its offset in
+ * units of that block.
  */
 struct brd_device {
 	int			brd_number;
@@ -48,6 +52,8 @@ struct brd_device {
 	u64			brd_nr_pages;
 };
 
+static unsigned int rd_page_order;
+
 /*
  * Look up and return a brd's page for a given sector.
  */
@@ -68,13 +74,17 @@ static struct page *brd_lookup_page(struct brd_device *brd, sector_t sector)
 	 * here, only deletes).
 	 */
 	rcu_read_lock();
-	idx = sector >> PAGE_SECTORS_SHIFT; /* sector to page index */
+	/* sector to page (block) index */
+	idx = sector >> (PAGE_SECTORS_SHIFT + rd_page_order);
 	page = radix_tree_lookup(&brd->brd_pages, idx);
 	rcu_read_unlock();
 
-	BUG_ON(page && page->index != idx);
+	if (!page)
+		return NULL;
+	BUG_ON(page->index != idx);
 
-	return page;
+	return nth_page(page, (sector >> PAGE_SECTORS_SHIFT) &
+			      ((1UL << rd_page_order) - 1));
 }
 
 /*
@@ -95,25 +105,25 @@ static int brd_insert_page(struct brd_device *brd, sector_t sector)
 	 * block or filesystem layers from page reclaim.
 	 */
 	gfp_flags = GFP_NOIO | __GFP_ZERO | __GFP_HIGHMEM;
-	page = alloc_page(gfp_flags);
+	page = alloc_pages(gfp_flags, rd_page_order);
 	if (!page)
 		return -ENOMEM;
 
 	if (radix_tree_preload(GFP_NOIO)) {
-		__free_page(page);
+		__free_pages(page, rd_page_order);
 		return -ENOMEM;
 	}
 
 	spin_lock(&brd->brd_lock);
-	idx = sector >> PAGE_SECTORS_SHIFT;
+	idx = sector >> (PAGE_SECTORS_SHIFT + rd_page_order);
 	page->index = idx;
 	if (radix_tree_insert(&brd->brd_pages, idx, page)) {
-		__free_page(page);
+		__free_pages(page, rd_page_order);
 		page = radix_tree_lookup(&brd->brd_pages, idx);
 		BUG_ON(!page);
 		BUG_ON(page->index != idx);
 	} else {
-		brd->brd_nr_pages++;
+		brd->brd_nr_pages += 1 << rd_page_order;
 	}
 	spin_unlock(&brd->brd_lock);
 
@@ -145,7 +155,7 @@ static void brd_free_pages(struct brd_device *brd)
 			pos = pages[i]->index;
 			ret = radix_tree_delete(&brd->brd_pages, pos);
 			BUG_ON(!ret || ret != pages[i]);
-			__free_page(pages[i]);
+			__free_pages(pages[i], rd_page_order);
 		}
 
 		pos++;
@@ -343,6 +353,10 @@ static int max_part = 1;
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "Num Minors to reserve between devices");
 
+module_param(rd_page_order, uint, 0444);
+MODULE_PARM_DESC(rd_page_order, "Allocate backing store in blocks of 2^order contiguous pages (default: 0, max: "
+		 __stringify(PAGE_ALLOC_COSTLY_ORDER) ")");
+
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(RAMDISK_MAJOR);
 MODULE_ALIAS("rd");
@@ -490,6 +504,16 @@ static inline void brd_check_and_reset_par(void)
 			DISK_MAX_PARTS, DISK_MAX_PARTS);
 		max_part = DISK_MAX_PARTS;
 	}
+
+	/*
+	 * Blocks are allocated from the I/O path with GFP_NOIO, so keep them
+	 * to orders the page allocator can reliably provide.
+	 */
+	if (rd_page_order > PAGE_ALLOC_COSTLY_ORDER) {
+		pr_info("brd: rd_page_order can't be larger than %d, reset rd_page_order = %d.\n",
+			PAGE_ALLOC_COSTLY_ORDER, PAGE_ALLOC_COSTLY_ORDER);
+		rd_page_order = PAGE_ALLOC_COSTLY_ORDER;
+	}
 }
 
 static int __init brd_init(void)
@@ -133,6 +133,7 @@ static void loop_global_unlock(struct loop_device *lo, bool global)
 
 static int max_part;
 static int part_shift;
+static bool hybrid_dio;
 
 static int transfer_xor(struct loop_device *lo, int cmd,
 			struct page *raw_page, unsigned raw_off,
@@ -219,6 +220,7 @@ static void __loop_update_dio(struct loop_device *lo, bool dio)
 	struct inode *inode = mapping->host;
 	unsigned short sb_bsize = 0;
 	unsigned dio_align = 0;
+	unsigned short hybrid_bsize = 0;
 	bool use_dio;
 
 	if (inode->i_sb->s_bdev) {
@@ -248,7 +250,17 @@ static void __loop_update_dio(struct loop_device *lo, bool dio)
 		use_dio = false;
 	}
 
-	if (lo->use_dio == use_dio)
+	/*
+	 * If the loop block size is smaller than the backing device's,
+	 * requests which happen to be aligned can still bypass the page
+	 * cache while the rest go through the buffered path.
+	 */
+	if (dio && !use_dio && hybrid_dio && sb_bsize &&
+			!(lo->lo_offset & dio_align) &&
+			mapping->a_ops->direct_IO && !lo->transfer)
+		hybrid_bsize = sb_bsize;
+
+	if (lo->use_dio == use_dio && lo->dio_hybrid_bsize == hybrid_bsize)
 		return;
 
 	/* flush dirty pages before changing direct IO */
@@ -262,7 +274,8 @@ static void __loop_update_dio(struct loop_device *lo, bool dio)
 	if (lo->lo_state == Lo_bound)
 		blk_mq_freeze_queue(lo->lo_queue);
 	lo->use_dio = use_dio;
-	if (use_dio) {
+	lo->dio_hybrid_bsize = hybrid_bsize;
+	if (use_dio || hybrid_bsize) {
 		blk_queue_flag_clear(QUEUE_FLAG_NOMERGES, lo->lo_queue);
 		lo->lo_flags |= LO_FLAGS_DIRECT_IO;
 	} else {
@@ -670,7 +683,7 @@ static int do_req_filebacked(struct loop_device *lo, struct request *rq)
 static inline void loop_update_dio(struct loop_device *lo)
 {
 	__loop_update_dio(lo, (lo->lo_backing_file->f_flags & O_DIRECT) |
-				lo->use_dio);
+				lo->use_dio || lo->dio_hybrid_bsize);
 }
 
 static void loop_reread_partitions(struct loop_device *lo)
@@ -883,12 +896,29 @@ static ssize_t loop_attr_dio_show(struct loop_device *lo, char *buf)
 	return sysfs_emit(buf, "%s\n", dio ? "1" : "0");
 }
 
+/* Only aligned requests bypass the page cache in hybrid mode */
+static ssize_t loop_attr_dio_hybrid_show(struct loop_device *lo, char *buf)
+{
+	int hybrid = (lo->lo_flags & LO_FLAGS_DIRECT_IO) && !lo->use_dio;
+
+	return sysfs_emit(buf, "%s\n", hybrid ? "1" : "0");
+}
+
+static ssize_t loop_attr_dio_stat_show(struct loop_device *lo, char *buf)
+{
+	return sysfs_emit(buf, "%u %lu %lu\n", lo->dio_hybrid_bsize,
+			  atomic_long_read(&lo->nr_dio_rqs),
+			  atomic_long_read(&lo->nr_buffered_rqs));
+}
+
 LOOP_ATTR_RO(backing_file);
 LOOP_ATTR_RO(offset);
 LOOP_ATTR_RO(sizelimit);
 LOOP_ATTR_RO(autoclear);
 LOOP_ATTR_RO(partscan);
 LOOP_ATTR_RO(dio);
+LOOP_ATTR_RO(dio_hybrid);
+LOOP_ATTR_RO(dio_stat);
 
 static struct attribute *loop_attrs[] = {
 	&loop_attr_backing_file.attr,
@@ -897,6 +927,8 @@ static struct attribute *loop_attrs[] = {
 	&loop_attr_autoclear.attr,
 	&loop_attr_partscan.attr,
 	&loop_attr_dio.attr,
+	&loop_attr_dio_hybrid.attr,
+	&loop_attr_dio_stat.attr,
 	NULL,
 };
 
@@ -999,7 +1031,8 @@ static inline int queue_on_root_worker(struct cgroup_subsys_state *css)
 }
 #endif
 
-static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd)
+static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd,
+			    unsigned int queue_num)
 {
 	struct rb_node **node = &(lo->worker_tree.rb_node), *parent = NULL;
 	struct loop_worker *cur_worker, *worker = NULL;
@@ -1061,8 +1094,10 @@ static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd)
 		work = &worker->work;
 		cmd_list = &worker->cmd_list;
 	} else {
-		work = &lo->rootcg_work;
-		cmd_list = &lo->rootcg_cmd_list;
+		struct loop_root_worker *rootcg = &lo->rootcg[queue_num];
+
+		work = &rootcg->work;
+		cmd_list = &rootcg->cmd_list;
 	}
 	list_add_tail(&cmd->list_entry, cmd_list);
 	queue_work(lo->workqueue, work);
@@ -1200,7 +1235,7 @@ static int loop_configure(struct loop_device *lo, fmode_t mode,
 	struct file *file = fget(config->fd);
 	struct inode *inode;
 	struct address_space *mapping;
-	int error;
+	int error, i;
 	loff_t size;
 	bool partscan;
 	unsigned short bsize;
@@ -1272,13 +1307,19 @@ static int loop_configure(struct loop_device *lo, fmode_t mode,
 	disk_force_media_change(lo->lo_disk, DISK_EVENT_MEDIA_CHANGE);
 	set_disk_ro(lo->lo_disk, (lo->lo_flags & LO_FLAGS_READ_ONLY) != 0);
 
-	INIT_WORK(&lo->rootcg_work, loop_rootcg_workfn);
-	INIT_LIST_HEAD(&lo->rootcg_cmd_list);
+	for (i = 0; i < lo->nr_rootcg; i++) {
+		INIT_WORK(&lo->rootcg[i].work, loop_rootcg_workfn);
+		INIT_LIST_HEAD(&lo->rootcg[i].cmd_list);
+		lo->rootcg[i].lo = lo;
+	}
 	INIT_LIST_HEAD(&lo->idle_worker_list);
 	lo->worker_tree = RB_ROOT;
 	timer_setup(&lo->timer, loop_free_idle_workers,
 		TIMER_DEFERRABLE);
 	lo->use_dio = lo->lo_flags & LO_FLAGS_DIRECT_IO;
+	lo->dio_hybrid_bsize = 0;
+	atomic_long_set(&lo->nr_dio_rqs, 0);
+	atomic_long_set(&lo->nr_buffered_rqs, 0);
 	lo->lo_device = bdev;
 	lo->lo_backing_file = file;
 	lo->old_gfp_mask = mapping_gfp_mask(mapping);
@@ -1574,7 +1615,7 @@ loop_set_status(struct loop_device *lo, const struct loop_info64 *info)
 	loop_config_discard(lo);
 
 	/* update dio if lo_offset or transfer is changed */
-	__loop_update_dio(lo, lo->use_dio);
+	__loop_update_dio(lo, lo->use_dio || lo->dio_hybrid_bsize);
 
 out_unfreeze:
 	blk_mq_unfreeze_queue(lo->lo_queue);
@@ -1761,7 +1802,7 @@ static int loop_set_dio(struct loop_device *lo, unsigned long arg)
 		goto out;
 
 	__loop_update_dio(lo, !!arg);
-	if (lo->use_dio == !!arg)
+	if ((lo->use_dio || lo->dio_hybrid_bsize) == !!arg)
 		return 0;
 	error = -EINVAL;
  out:
@@ -2123,6 +2164,17 @@ module_param(max_loop, int, 0444);
 MODULE_PARM_DESC(max_loop, "Maximum number of loop devices");
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "Maximum number of partitions per loop device");
+
+/*
+ * Each hardware queue of a loop device has its own root cgroup worker,
+ * so with more than one queue file backed I/O of different CPUs is
+ * issued to the backing file concurrently instead of behind one kworker.
+ */
+static unsigned int nr_hw_queues = 1;
+module_param(nr_hw_queues, uint, 0444);
+MODULE_PARM_DESC(nr_hw_queues, "Number of hardware queues and worker queues per loop device (default: 1)");
+module_param(hybrid_dio, bool, 0644);
+MODULE_PARM_DESC(hybrid_dio, "Issue aligned requests as direct I/O when direct I/O was requested but the block size does not allow it for all requests (default: false)");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
@@ -2163,6 +2215,27 @@ int loop_unregister_transfer(int number)
 EXPORT_SYMBOL(loop_register_transfer);
 EXPORT_SYMBOL(loop_unregister_transfer);
 
+/*
+ * In hybrid mode a read or write can be issued as direct I/O only if its
+ * file position and every segment are aligned to the backing device's
+ * logical block size, lo_offset has been checked already.
+ */
+static bool loop_rq_dio_aligned(struct loop_device *lo, struct request *rq)
+{
+	unsigned int mask = lo->dio_hybrid_bsize - 1;
+	struct req_iterator iter;
+	struct bio_vec bvec;
+
+	if (((loff_t)blk_rq_pos(rq) << 9) & mask)
+		return false;
+
+	rq_for_each_bvec(bvec, rq, iter) {
+		if ((bvec.bv_offset | bvec.bv_len) & mask)
+			return false;
+	}
+	return true;
+}
+
 static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		const struct blk_mq_queue_data *bd)
 {
@@ -2183,6 +2256,12 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		break;
 	default:
 		cmd->use_aio = lo->use_dio;
+		if (!cmd->use_aio && lo->dio_hybrid_bsize)
+			cmd->use_aio = loop_rq_dio_aligned(lo, rq);
+		if (cmd->use_aio)
+			atomic_long_inc(&lo->nr_dio_rqs);
+		else
+			atomic_long_inc(&lo->nr_buffered_rqs);
 		break;
 	}
 
@@ -2199,7 +2278,7 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 #endif
 	}
 #endif
-	loop_queue_work(lo, cmd);
+	loop_queue_work(lo, cmd, hctx->queue_num);
 
 	return BLK_STS_OK;
 }
@@ -2301,9 +2380,9 @@ static void loop_workfn(struct work_struct *work)
 
 static void loop_rootcg_workfn(struct work_struct *work)
 {
-	struct loop_device *lo =
-		container_of(work, struct loop_device, rootcg_work);
-	loop_process_work(NULL, &lo->rootcg_cmd_list, lo);
+	struct loop_root_worker *rootcg =
+		container_of(work, struct loop_root_worker, work);
+	loop_process_work(NULL, &rootcg->cmd_list, rootcg->lo);
 }
 
 static void loop_free_idle_workers(struct timer_list *timer)
@@ -2344,6 +2423,11 @@ static int loop_add(int i)
 		goto out;
 	lo->lo_state = Lo_unbound;
 
+	lo->nr_rootcg = nr_hw_queues;
+	lo->rootcg = kcalloc(lo->nr_rootcg, sizeof(*lo->rootcg), GFP_KERNEL);
+	if (!lo->rootcg)
+		goto out_free_dev;
+
 	err = mutex_lock_killable(&loop_ctl_mutex);
 	if (err)
 		goto out_free_dev;
@@ -2363,7 +2447,7 @@ static int loop_add(int i)
 
 	err = -ENOMEM;
 	lo->tag_set.ops = &loop_mq_ops;
-	lo->tag_set.nr_hw_queues = 1;
+	lo->tag_set.nr_hw_queues = lo->nr_rootcg;
 	lo->tag_set.queue_depth = 128;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
@@ -2442,6 +2526,7 @@ static int loop_add(int i)
 	idr_remove(&loop_index_idr, i);
 	mutex_unlock(&loop_ctl_mutex);
 out_free_dev:
+	kfree(lo->rootcg);
 	kfree(lo);
 out:
 	return err;
@@ -2458,6 +2543,7 @@ static void loop_remove(struct loop_device *lo)
 	mutex_unlock(&loop_ctl_mutex);
 	/* There is no route which can find this loop device. */
 	mutex_destroy(&lo->lo_mutex);
+	kfree(lo->rootcg);
 	kfree(lo);
 }
 
@@ -2600,6 +2686,8 @@ static int __init loop_init(void)
 		goto err_out;
 	}
 
+	nr_hw_queues = clamp_t(unsigned int, nr_hw_queues, 1, nr_cpu_ids);
+
 	err = misc_register(&loop_misc);
 	if (err < 0)
 		goto err_out;
@@ -25,6 +25,14 @@ enum {
 };
 
 struct loop_func_table;
+struct loop_device;
+
+/* Worker for commands that are issued as the root cgroup */
+struct loop_root_worker {
+	struct work_struct	work;
+	struct list_head	cmd_list;
+	struct loop_device	*lo;
+};
 
 struct loop_device {
 	int		lo_number;
@@ -56,12 +64,15 @@ struct loop_device {
 	int			lo_state;
 	spinlock_t              lo_work_lock;
 	struct workqueue_struct *workqueue;
-	struct work_struct      rootcg_work;
-	struct list_head        rootcg_cmd_list;
+	struct loop_root_worker	*rootcg;	/* one per hw queue */
+	unsigned int		nr_rootcg;
 	struct list_head        idle_worker_list;
 	struct rb_root          worker_tree;
 	struct timer_list       timer;
 	bool			use_dio;
+	unsigned short		dio_hybrid_bsize;	/* 0 if not hybrid */
+	atomic_long_t		nr_dio_rqs;
+	atomic_long_t		nr_buffered_rqs;
 	bool			sysfs_inited;
 
 	struct request_queue	*lo_queue;
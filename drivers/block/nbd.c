@@ -31,6 +31,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <net/sock.h>
+#include <net/tcp.h>
 #include <linux/net.h>
 #include <linux/kthread.h>
 #include <linux/types.h>
@@ -119,6 +120,7 @@ struct nbd_device {
 	struct mutex config_lock;
 	struct gendisk *disk;
 	struct workqueue_struct *recv_workq;
+	bool recv_affinity;	/* recv_workq is per-cpu */
 	struct work_struct remove_work;
 
 	struct list_head list;
@@ -153,9 +155,13 @@ static struct dentry *nbd_dbg_dir;
 
 #define NBD_DEF_BLKSIZE_BITS 10
 
+/* Upper bound of replies received before their requests are completed */
+#define NBD_RECV_BATCH 16
+
 static unsigned int nbds_max = 16;
 static int max_part = 16;
 static int part_shift;
+static bool recv_affinity;
 
 static int nbd_dev_dbg_init(struct nbd_device *nbd);
 static void nbd_dev_dbg_close(struct nbd_device *nbd);
@@ -691,8 +697,41 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 	return 0;
 }
 
+struct nbd_recv_batch {
+	struct request *rq[NBD_RECV_BATCH];
+	int nr;
+};
+
+static void nbd_recv_batch_flush(struct nbd_recv_batch *batch)
+{
+	int i;
+
+	for (i = 0; i < batch->nr; i++)
+		blk_mq_complete_request(batch->rq[i]);
+	batch->nr = 0;
+}
+
+/*
+ * The batched requests are no longer covered by the timeout handler, so
+ * complete them before a read which may block, i.e. unless @size bytes
+ * are already queued on the socket.
+ */
+static void nbd_recv_batch_prepare(struct nbd_sock *nsock,
+				   struct nbd_recv_batch *batch, size_t size)
+{
+	struct sock *sk = nsock->sock->sk;
+
+	if (!batch->nr)
+		return;
+	if (sk->sk_type == SOCK_STREAM && sk->sk_protocol == IPPROTO_TCP &&
+	    tcp_inq_hint(sk) >= size)
+		return;
+	nbd_recv_batch_flush(batch);
+}
+
 /* NULL returned = something went wrong, inform userspace */
-static struct nbd_cmd *nbd_read_stat(struct nbd_device *nbd, int index)
+static struct nbd_cmd *nbd_read_stat(struct nbd_device *nbd, int index,
+				     struct nbd_recv_batch *batch)
 {
 	struct nbd_config *config = nbd->config;
 	int result;
@@ -708,6 +747,7 @@ static struct nbd_cmd *nbd_read_stat(struct nbd_device *nbd, int index)
 
 	reply.magic = 0;
 	iov_iter_kvec(&to, READ, &iov, 1, sizeof(reply));
+	nbd_recv_batch_prepare(config->socks[index], batch, sizeof(reply));
 	result = sock_xmit(nbd, index, 0, &to, MSG_WAITALL, NULL);
 	if (result <= 0) {
 		if (!nbd_disconnected(config))
@@ -764,11 +804,26 @@ static struct nbd_cmd *nbd_read_stat(struct nbd_device *nbd, int index)
 
 	dev_dbg(nbd_to_dev(nbd), "request %p: got reply\n", req);
 	if (rq_data_dir(req) != WRITE) {
-		struct req_iterator iter;
-		struct bio_vec bvec;
+		struct bio *bio;
 
-		rq_for_each_segment(bvec, req, iter) {
-			iov_iter_bvec(&to, READ, &bvec, 1, bvec.bv_len);
+		/*
+		 * Receive straight into the bio's own bvec table, so that
+		 * the payload of each bio takes a single recvmsg instead of
+		 * one per page.
+		 */
+		__rq_for_each_bio(bio, req) {
+			struct bvec_iter iter;
+			struct bio_vec bvec;
+			unsigned int nr_bvec = 0;
+
+			bio_for_each_bvec(bvec, bio, iter)
+				nr_bvec++;
+			iov_iter_bvec(&to, READ,
+				      __bvec_iter_bvec(bio->bi_io_vec, bio->bi_iter),
+				      nr_bvec, bio->bi_iter.bi_size);
+			to.iov_offset = bio->bi_iter.bi_bvec_done;
+			nbd_recv_batch_prepare(config->socks[index], batch,
+					       bio->bi_iter.bi_size);
 			result = sock_xmit(nbd, index, 0, &to, MSG_WAITALL, NULL);
 			if (result <= 0) {
 				dev_err(disk_to_dev(nbd->disk), "Receive data failed (result %d)\n",
@@ -786,8 +841,8 @@ static struct nbd_cmd *nbd_read_stat(struct nbd_device *nbd, int index)
 				ret = -EIO;
 				goto out;
 			}
-			dev_dbg(nbd_to_dev(nbd), "request %p: got %d bytes data\n",
-				req, bvec.bv_len);
+			dev_dbg(nbd_to_dev(nbd), "request %p: got %u bytes data\n",
+				req, bio->bi_iter.bi_size);
 		}
 	}
 out:
@@ -803,14 +858,15 @@ static void recv_work(struct work_struct *work)
 						     work);
 	struct nbd_device *nbd = args->nbd;
 	struct nbd_config *config = nbd->config;
+	struct nbd_sock *nsock = config->socks[args->index];
+	struct nbd_recv_batch batch = { .nr = 0 };
 	struct nbd_cmd *cmd;
 	struct request *rq;
 
 	while (1) {
-		cmd = nbd_read_stat(nbd, args->index);
+		/* Flushes the batch before any read that may block. */
+		cmd = nbd_read_stat(nbd, args->index, &batch);
 		if (IS_ERR(cmd)) {
-			struct nbd_sock *nsock = config->socks[args->index];
-
 			mutex_lock(&nsock->tx_lock);
 			nbd_mark_nsock_dead(nbd, nsock, 1);
 			mutex_unlock(&nsock->tx_lock);
@@ -819,14 +875,38 @@ static void recv_work(struct work_struct *work)
 
 		rq = blk_mq_rq_from_pdu(cmd);
 		if (likely(!blk_should_fake_timeout(rq->q)))
-			blk_mq_complete_request(rq);
+			batch.rq[batch.nr++] = rq;
+		if (batch.nr == NBD_RECV_BATCH)
+			nbd_recv_batch_flush(&batch);
 	}
+	nbd_recv_batch_flush(&batch);
 	nbd_config_put(nbd);
 	atomic_dec(&config->recv_threads);
 	wake_up(&config->recv_wq);
 	kfree(args);
 }
 
+/*
+ * With recv_affinity, the replies of a connection are received on a CPU
+ * which submits to the connection's hardware queue.
+ */
+static void nbd_queue_recv_work(struct nbd_device *nbd,
+				struct recv_thread_args *args)
+{
+	struct request_queue *q = nbd->disk->queue;
+	int cpu;
+
+	if (nbd->recv_affinity && args->index < q->nr_hw_queues) {
+		cpu = cpumask_first_and(q->queue_hw_ctx[args->index]->cpumask,
+					cpu_online_mask);
+		if (cpu < nr_cpu_ids) {
+			queue_work_on(cpu, nbd->recv_workq, &args->work);
+			return;
+		}
+	}
+	queue_work(nbd->recv_workq, &args->work);
+}
+
 static bool nbd_clear_req(struct request *req, void *data, bool reserved)
 {
 	struct nbd_cmd *cmd = blk_mq_rq_to_pdu(req);
@@ -1162,7 +1242,7 @@ static int nbd_reconnect_socket(struct nbd_device *nbd, unsigned long arg)
 		/* We take the tx_mutex in an error path in the recv_work, so we
 		 * need to queue_work outside of the tx_mutex.
 		 */
-		queue_work(nbd->recv_workq, &args->work);
+		nbd_queue_recv_work(nbd, args);
 
 		atomic_inc(&config->live_connections);
 		wake_up(&config->conn_wait);
@@ -1338,7 +1418,7 @@ static int nbd_start_device(struct nbd_device *nbd)
 		INIT_WORK(&args->work, recv_work);
 		args->nbd = nbd;
 		args->index = i;
-		queue_work(nbd->recv_workq, &args->work);
+		nbd_queue_recv_work(nbd, args);
 	}
 	return nbd_set_size(nbd, config->bytesize, nbd_blksize(config));
 }
@@ -1732,9 +1812,11 @@ static struct nbd_device *nbd_dev_add(int index, unsigned int refs)
 	}
 	nbd->disk = disk;
 
+	nbd->recv_affinity = recv_affinity;
 	nbd->recv_workq = alloc_workqueue("nbd%d-recv",
 					  WQ_MEM_RECLAIM | WQ_HIGHPRI |
-					  WQ_UNBOUND, 0, nbd->index);
+					  (nbd->recv_affinity ? 0 : WQ_UNBOUND),
+					  0, nbd->index);
 	if (!nbd->recv_workq) {
 		dev_err(disk_to_dev(nbd->disk), "Could not allocate knbd recv work queue.\n");
 		err = -ENOMEM;
@@ -2542,3 +2624,5 @@ module_param(nbds_max, int, 0444);
 MODULE_PARM_DESC(nbds_max, "number of network block devices to initialize (default: 16)");
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "number of partitions per device (default: 16)");
+module_param(recv_affinity, bool, 0444);
+MODULE_PARM_DESC(recv_affinity, "receive replies of each connection on a CPU of its hardware queue (default: false)");
@@ -9,6 +9,7 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/random.h>
 #include "null_blk.h"
 
 #define FREE_BATCH		16
@@ -462,9 +463,85 @@ static ssize_t nullb_device_badblocks_store(struct config_item *item,
 }
 CONFIGFS_ATTR(nullb_device_, badblocks);
 
+static ssize_t nullb_device_completion_dist_show(struct config_item *item,
+						 char *page)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	ssize_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < dev->nr_lat_points; i++)
+		len += scnprintf(page + len, PAGE_SIZE - len, "%s%u:%lu",
+				 i ? " " : "", dev->lat_points[i].permille,
+				 dev->lat_points[i].nsec);
+	len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+	return len;
+}
+
+/*
+ * The distribution is a list of "permille:nsec" points with increasing
+ * permille and non-decreasing latency, the last point must be 1000.
+ * Latencies between two points are interpolated linearly, so a bimodal
+ * device is described with two points close to each other, e.g.
+ * "990:200000 991:20000000 1000:20000000".  An empty string goes back to
+ * the fixed completion_nsec.
+ */
+static ssize_t nullb_device_completion_dist_store(struct config_item *item,
+						  const char *page,
+						  size_t count)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	struct nullb_lat_point points[NULLB_LAT_MAX_POINTS];
+	unsigned int nr = 0;
+	char *orig, *buf, *tok;
+	int ret;
+
+	if (test_bit(NULLB_DEV_FL_CONFIGURED, &dev->flags))
+		return -EBUSY;
+
+	orig = kstrndup(page, count, GFP_KERNEL);
+	if (!orig)
+		return -ENOMEM;
+
+	buf = strstrip(orig);
+	ret = -EINVAL;
+	while ((tok = strsep(&buf, " ,")) != NULL) {
+		char *sep;
+
+		if (!*tok)
+			continue;
+		if (nr == NULLB_LAT_MAX_POINTS)
+			goto out;
+		sep = strchr(tok, ':');
+		if (!sep)
+			goto out;
+		*sep = '\0';
+		if (kstrtouint(tok, 0, &points[nr].permille) ||
+		    kstrtoul(sep + 1, 0, &points[nr].nsec))
+			goto out;
+		if (points[nr].permille > 1000)
+			goto out;
+		if (nr && (points[nr].permille <= points[nr - 1].permille ||
+			   points[nr].nsec < points[nr - 1].nsec))
+			goto out;
+		nr++;
+	}
+	if (nr && points[nr - 1].permille != 1000)
+		goto out;
+
+	memcpy(dev->lat_points, points, nr * sizeof(points[0]));
+	dev->nr_lat_points = nr;
+	ret = count;
+out:
+	kfree(orig);
+	return ret;
+}
+CONFIGFS_ATTR(nullb_device_, completion_dist);
+
 static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_size,
 	&nullb_device_attr_completion_nsec,
+	&nullb_device_attr_completion_dist,
 	&nullb_device_attr_submit_queues,
 	&nullb_device_attr_home_node,
 	&nullb_device_attr_queue_mode,
@@ -541,7 +618,7 @@ nullb_group_drop_item(struct config_group *group, struct config_item *item)
 static ssize_t memb_group_features_show(struct config_item *item, char *page)
 {
 	return snprintf(page, PAGE_SIZE,
-			"memory_backed,discard,bandwidth,cache,badblocks,zoned,zone_size,zone_capacity,zone_nr_conv,zone_max_open,zone_max_active,blocksize,max_sectors,virt_boundary\n");
+			"memory_backed,discard,bandwidth,cache,badblocks,zoned,zone_size,zone_capacity,zone_nr_conv,zone_max_open,zone_max_active,blocksize,max_sectors,virt_boundary,completion_dist\n");
 }
 
 CONFIGFS_ATTR_RO(memb_group_, features);
@@ -717,9 +794,32 @@ static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
+/* Draw a completion time from the device's latency distribution */
+static u64 null_cmd_latency(struct nullb_device *dev)
+{
+	const struct nullb_lat_point *prev, *next;
+	unsigned int r, i;
+
+	if (!dev->nr_lat_points)
+		return dev->completion_nsec;
+
+	r = prandom_u32_max(1000);
+	for (i = 0; i < dev->nr_lat_points - 1; i++)
+		if (r < dev->lat_points[i].permille)
+			break;
+	next = &dev->lat_points[i];
+	if (!i)
+		return next->nsec;
+
+	prev = &dev->lat_points[i - 1];
+	return prev->nsec + div_u64((u64)(next->nsec - prev->nsec) *
+				    (r - prev->permille),
+				    next->permille - prev->permille);
+}
+
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	ktime_t kt = null_cmd_latency(cmd->nq->dev);
 
 	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
 }
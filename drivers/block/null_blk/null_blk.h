@@ -55,6 +55,14 @@ struct nullb_zone {
 	unsigned int capacity;
 };
 
+/* Maximum number of points in a completion latency distribution */
+#define NULLB_LAT_MAX_POINTS	16
+
+struct nullb_lat_point {
+	unsigned int permille; /* share of requests completing within nsec */
+	unsigned long nsec;
+};
+
 struct nullb_device {
 	struct nullb *nullb;
 	struct config_item item;
@@ -76,6 +84,9 @@ struct nullb_device {
 
 	unsigned long size; /* device size in MB */
 	unsigned long completion_nsec; /* time in ns to complete a request */
+	/* completion latency distribution, overrides completion_nsec if set */
+	unsigned int nr_lat_points;
+	struct nullb_lat_point lat_points[NULLB_LAT_MAX_POINTS];
 	unsigned long cache_size; /* disk cache size in MB */
 	unsigned long zone_size; /* zone size in MB if device is zoned */
 	unsigned long zone_capacity; /* zone capacity in MB if device is zoned */
@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Content based deduplication of zram objects
+ *
+ * Every object stored in the zsmalloc pool of a dedup enabled device is
+ * described by a zram_entry. Entries are hashed by a checksum of the
+ * uncompressed page, and a new page whose content matches an existing
+ * entry just takes a reference on it instead of being compressed and
+ * stored again.
+ */
+
+#include <linux/jhash.h>
+#include <linux/log2.h>
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include "zram_drv.h"
+#include "zram_dedup.h"
+
+/* Average number of entries per hash bucket when the device is full */
+#define ZRAM_DEDUP_BUCKET_LOAD	64
+
+u32 zram_dedup_checksum(void *mem)
+{
+	return jhash(mem, PAGE_SIZE, 0);
+}
+
+static struct zram_hash *zram_dedup_bucket(struct zram *zram, u32 checksum)
+{
+	return &zram->hash[checksum & (zram->hash_size - 1)];
+}
+
+/* Compare @mem against the uncompressed content of @entry */
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+			     void *mem)
+{
+	struct zcomp_strm *zstrm;
+	bool match = false;
+	void *cmem;
+
+	cmem = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+	if (entry->len == PAGE_SIZE) {
+		match = !memcmp(mem, cmem, PAGE_SIZE);
+	} else {
+		zstrm = zcomp_stream_get(zram->comp);
+		if (!zcomp_decompress(zstrm, cmem, entry->len, zstrm->buffer))
+			match = !memcmp(mem, zstrm->buffer, PAGE_SIZE);
+		zcomp_stream_put(zram->comp);
+	}
+	zs_unmap_object(zram->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look up an entry holding the same content as @mem and take a reference
+ * on it. Returns NULL when there is none.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, void *mem, u32 checksum)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, checksum);
+	struct zram_entry *entry;
+	struct rb_node *node;
+
+	spin_lock(&hash->lock);
+	node = hash->rb_root.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct zram_entry, rb_node);
+		if (checksum == entry->checksum) {
+			/* Equal checksums may sit on either side */
+			struct rb_node *prev;
+
+			while ((prev = rb_prev(node))) {
+				entry = rb_entry(prev, struct zram_entry,
+						 rb_node);
+				if (entry->checksum != checksum)
+					break;
+				node = prev;
+			}
+
+			for (; node; node = rb_next(node)) {
+				entry = rb_entry(node, struct zram_entry,
+						 rb_node);
+				if (entry->checksum != checksum)
+					break;
+				if (zram_dedup_match(zram, entry, mem)) {
+					entry->refcount++;
+					spin_unlock(&hash->lock);
+					atomic64_inc(&zram->stats.dedup_hits);
+					atomic64_add(entry->len,
+						&zram->stats.dup_data_size);
+					return entry;
+				}
+			}
+			break;
+		}
+
+		node = checksum < entry->checksum ? node->rb_left :
+						    node->rb_right;
+	}
+	spin_unlock(&hash->lock);
+
+	return NULL;
+}
+
+/*
+ * Wrap a freshly stored object in an entry and make it visible to
+ * zram_dedup_find(). The caller owns the only reference.
+ */
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				     unsigned int len, u32 checksum, gfp_t gfp)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, checksum);
+	struct rb_node **rb_node, *parent = NULL;
+	struct zram_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), gfp);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+
+	spin_lock(&hash->lock);
+	rb_node = &hash->rb_root.rb_node;
+	while (*rb_node) {
+		struct zram_entry *cur;
+
+		parent = *rb_node;
+		cur = rb_entry(parent, struct zram_entry, rb_node);
+		if (checksum < cur->checksum)
+			rb_node = &parent->rb_left;
+		else
+			rb_node = &parent->rb_right;
+	}
+	rb_link_node(&entry->rb_node, parent, rb_node);
+	rb_insert_color(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+
+	return entry;
+}
+
+/* Drop a reference, freeing the object along with the last one */
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, entry->checksum);
+	unsigned long refcount;
+
+	spin_lock(&hash->lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		rb_erase(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	if (refcount) {
+		atomic64_sub(entry->len, &zram->stats.dup_data_size);
+		return;
+	}
+
+	zs_free(zram->mem_pool, entry->handle);
+	atomic64_sub(entry->len, &zram->stats.compr_data_size);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+	kfree(entry);
+}
+
+int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	size_t i;
+
+	if (!zram_dedup_enabled(zram))
+		return 0;
+
+	zram->hash_size = roundup_pow_of_two(max_t(size_t,
+			num_pages / ZRAM_DEDUP_BUCKET_LOAD, 1));
+	zram->hash = vzalloc(array_size(zram->hash_size, sizeof(*zram->hash)));
+	if (!zram->hash)
+		return -ENOMEM;
+
+	for (i = 0; i < zram->hash_size; i++) {
+		spin_lock_init(&zram->hash[i].lock);
+		zram->hash[i].rb_root = RB_ROOT;
+	}
+
+	return 0;
+}
+
+void zram_dedup_fini(struct zram *zram)
+{
+	vfree(zram->hash);
+	zram->hash = NULL;
+	zram->hash_size = 0;
+}
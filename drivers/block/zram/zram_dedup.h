@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+struct zram;
+struct zram_entry;
+
+#ifdef CONFIG_ZRAM_DEDUP
+
+static inline bool zram_dedup_enabled(struct zram *zram)
+{
+	return zram->use_dedup;
+}
+
+u32 zram_dedup_checksum(void *mem);
+struct zram_entry *zram_dedup_find(struct zram *zram, void *mem, u32 checksum);
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				     unsigned int len, u32 checksum, gfp_t gfp);
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+
+static inline unsigned long zram_dedup_handle(struct zram_entry *entry)
+{
+	return entry->handle;
+}
+
+static inline unsigned int zram_dedup_len(struct zram_entry *entry)
+{
+	return entry->len;
+}
+
+int zram_dedup_init(struct zram *zram, size_t num_pages);
+void zram_dedup_fini(struct zram *zram);
+
+#else
+
+static inline bool zram_dedup_enabled(struct zram *zram) { return false; }
+static inline u32 zram_dedup_checksum(void *mem) { return 0; }
+static inline struct zram_entry *zram_dedup_find(struct zram *zram,
+		void *mem, u32 checksum) { return NULL; }
+static inline struct zram_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, unsigned int len, u32 checksum,
+		gfp_t gfp) { return NULL; }
+static inline void zram_dedup_put(struct zram *zram,
+		struct zram_entry *entry) {}
+static inline unsigned long zram_dedup_handle(struct zram_entry *entry)
+{
+	return 0;
+}
+static inline unsigned int zram_dedup_len(struct zram_entry *entry)
+{
+	return 0;
+}
+static inline int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	return 0;
+}
+static inline void zram_dedup_fini(struct zram *zram) {}
+
+#endif /* CONFIG_ZRAM_DEDUP */
+
+#endif /* _ZRAM_DEDUP_H_ */
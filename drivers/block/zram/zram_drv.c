@@ -36,6 +36,7 @@
 #include <linux/part_stat.h>
 
 #include "zram_drv.h"
+#include "zram_dedup.h"
 
 static DEFINE_IDR(zram_index_idr);
 /* idr index must be protected */
@@ -395,6 +396,41 @@ static ssize_t writeback_limit_show(struct device *dev,
 	return scnprintf(buf, PAGE_SIZE, "%llu\n", val);
 }
 
+static ssize_t writeback_rate_limit_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u64 val;
+	ssize_t ret = -EINVAL;
+
+	if (kstrtoull(buf, 10, &val))
+		return ret;
+
+	down_read(&zram->init_lock);
+	spin_lock(&zram->wb_limit_lock);
+	zram->wb_rate_limit = val;
+	spin_unlock(&zram->wb_limit_lock);
+	up_read(&zram->init_lock);
+	ret = len;
+
+	return ret;
+}
+
+static ssize_t writeback_rate_limit_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	u64 val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	spin_lock(&zram->wb_limit_lock);
+	val = zram->wb_rate_limit;
+	spin_unlock(&zram->wb_limit_lock);
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", val);
+}
+
 static void reset_bdev(struct zram *zram)
 {
 	struct block_device *bdev;
@@ -622,6 +658,148 @@ static int read_from_bdev_async(struct zram *zram, struct bio_vec *bvec,
 #define HUGE_WRITEBACK 1
 #define IDLE_WRITEBACK 2
 
+/*
+ * Number of slots read out and submitted under a single plug. Blocks on
+ * the backing device are handed out lowest-first, so the writes of one
+ * batch are mostly contiguous and get merged into large requests.
+ */
+#define ZRAM_WB_BATCH 32
+
+struct zram_wb_req {
+	unsigned long blk_idx;
+	unsigned long index;
+	struct page *page;
+	struct bio bio;
+	struct bio_vec bio_vec;
+};
+
+struct zram_wb_batch {
+	struct zram_wb_req reqs[ZRAM_WB_BATCH];
+	unsigned int nr;
+	atomic_t pending;
+	struct completion done;
+};
+
+static void zram_wb_end_io(struct bio *bio)
+{
+	struct zram_wb_batch *wb = bio->bi_private;
+
+	if (atomic_dec_and_test(&wb->pending))
+		complete(&wb->done);
+}
+
+/*
+ * Submit every queued slot of @wb, wait for all of them and then move
+ * the slots that are still idle over to the backing device.
+ *
+ * Returns the last IO error, or 0.
+ */
+static int zram_wb_flush(struct zram *zram, struct zram_wb_batch *wb)
+{
+	struct blk_plug plug;
+	unsigned int i;
+	int ret = 0;
+
+	if (!wb->nr)
+		return 0;
+
+	atomic_set(&wb->pending, wb->nr);
+	reinit_completion(&wb->done);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < wb->nr; i++) {
+		struct zram_wb_req *req = &wb->reqs[i];
+
+		bio_init(&req->bio, &req->bio_vec, 1);
+		bio_set_dev(&req->bio, zram->bdev);
+		req->bio.bi_iter.bi_sector = req->blk_idx * (PAGE_SIZE >> 9);
+		req->bio.bi_opf = REQ_OP_WRITE | REQ_SYNC;
+		req->bio.bi_private = wb;
+		req->bio.bi_end_io = zram_wb_end_io;
+		bio_add_page(&req->bio, req->page, PAGE_SIZE, 0);
+		submit_bio(&req->bio);
+	}
+	blk_finish_plug(&plug);
+
+	wait_for_completion_io(&wb->done);
+
+	for (i = 0; i < wb->nr; i++) {
+		struct zram_wb_req *req = &wb->reqs[i];
+		unsigned long index = req->index;
+		int err = blk_status_to_errno(req->bio.bi_status);
+
+		bio_uninit(&req->bio);
+		if (err) {
+			zram_slot_lock(zram, index);
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			zram_clear_flag(zram, index, ZRAM_IDLE);
+			zram_slot_unlock(zram, index);
+			free_block_bdev(zram, req->blk_idx);
+			/*
+			 * Return last IO error unless every IO were
+			 * not suceeded.
+			 */
+			ret = err;
+			continue;
+		}
+
+		atomic64_inc(&zram->stats.bd_writes);
+		/*
+		 * We released zram_slot_lock so need to check if the slot was
+		 * changed. If there is freeing for the slot, we can catch it
+		 * easily by zram_allocated.
+		 * A subtle case is the slot is freed/reallocated/marked as
+		 * ZRAM_IDLE again. To close the race, idle_store doesn't
+		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
+		 * Thus, we could close the race by checking ZRAM_IDLE bit.
+		 */
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index) ||
+			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			zram_clear_flag(zram, index, ZRAM_IDLE);
+			zram_slot_unlock(zram, index);
+			free_block_bdev(zram, req->blk_idx);
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram_set_element(zram, index, req->blk_idx);
+		atomic64_inc(&zram->stats.pages_stored);
+		spin_lock(&zram->wb_limit_lock);
+		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
+			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
+		spin_unlock(&zram->wb_limit_lock);
+		zram_slot_unlock(zram, index);
+	}
+
+	wb->nr = 0;
+	return ret;
+}
+
+/*
+ * Sleep long enough that @written_kb since @start stays within the
+ * configured writeback_rate_limit (MB/s, 0 means unlimited).
+ */
+static void zram_wb_throttle(struct zram *zram, ktime_t start, u64 written_kb)
+{
+	u64 rate, expect_us;
+	s64 elapsed_us;
+
+	spin_lock(&zram->wb_limit_lock);
+	rate = zram->wb_rate_limit;
+	spin_unlock(&zram->wb_limit_lock);
+	if (!rate)
+		return;
+
+	expect_us = div64_u64(written_kb * USEC_PER_SEC, rate << 10);
+	elapsed_us = ktime_us_delta(ktime_get(), start);
+	if (elapsed_us >= 0 && expect_us > elapsed_us)
+		schedule_timeout_interruptible(
+			usecs_to_jiffies(expect_us - elapsed_us));
+}
 
 static ssize_t writeback_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
@@ -629,9 +807,10 @@ static ssize_t writeback_store(struct device *dev,
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
 	unsigned long index = 0;
-	struct bio bio;
-	struct bio_vec bio_vec;
-	struct page *page;
+	struct zram_wb_batch *wb;
+	unsigned int i, nr_slots;
+	u64 written_kb = 0;
+	ktime_t start;
 	ssize_t ret = len;
 	int mode, err;
 	unsigned long blk_idx = 0;
@@ -663,21 +842,36 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
+	wb = kzalloc(sizeof(*wb), GFP_KERNEL);
+	if (!wb) {
 		ret = -ENOMEM;
 		goto release_init_lock;
 	}
+	init_completion(&wb->done);
+
+	nr_slots = min_t(unsigned long, nr_pages, ZRAM_WB_BATCH);
+	for (i = 0; i < nr_slots; i++) {
+		wb->reqs[i].page = alloc_page(GFP_KERNEL);
+		if (!wb->reqs[i].page) {
+			ret = -ENOMEM;
+			goto free_batch;
+		}
+	}
 
+	start = ktime_get();
 	for (; nr_pages != 0; index++, nr_pages--) {
+		struct zram_wb_req *req;
 		struct bio_vec bvec;
 
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
 
+		/* Slots already queued in the batch still count against it */
 		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
+		if (zram->wb_limit_enable && zram->bd_wb_limit <=
+				(u64)wb->nr << (PAGE_SHIFT - 12)) {
 			spin_unlock(&zram->wb_limit_lock);
 			ret = -EIO;
 			break;
@@ -692,6 +886,11 @@ static ssize_t writeback_store(struct device *dev,
 			}
 		}
 
+		req = &wb->reqs[wb->nr];
+		bvec.bv_page = req->page;
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
+
 		zram_slot_lock(zram, index);
 		if (!zram_allocated(zram, index))
 			goto next;
@@ -723,66 +922,32 @@ static ssize_t writeback_store(struct device *dev,
 			continue;
 		}
 
-		bio_init(&bio, &bio_vec, 1);
-		bio_set_dev(&bio, zram->bdev);
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-		bio.bi_opf = REQ_OP_WRITE | REQ_SYNC;
-
-		bio_add_page(&bio, bvec.bv_page, bvec.bv_len,
-				bvec.bv_offset);
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		err = submit_bio_wait(&bio);
-		if (err) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			/*
-			 * Return last IO error unless every IO were
-			 * not suceeded.
-			 */
-			ret = err;
+		req->index = index;
+		req->blk_idx = blk_idx;
+		blk_idx = 0;
+		if (++wb->nr < nr_slots)
 			continue;
-		}
-
-		atomic64_inc(&zram->stats.bd_writes);
-		/*
-		 * We released zram_slot_lock so need to check if the slot was
-		 * changed. If there is freeing for the slot, we can catch it
-		 * easily by zram_allocated.
-		 * A subtle case is the slot is freed/reallocated/marked as
-		 * ZRAM_IDLE again. To close the race, idle_store doesn't
-		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
-		 * Thus, we could close the race by checking ZRAM_IDLE bit.
-		 */
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index) ||
-			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			goto next;
-		}
 
-		zram_free_page(zram, index);
-		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
-		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
-			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
-		spin_unlock(&zram->wb_limit_lock);
+		written_kb += wb->nr << (PAGE_SHIFT - 10);
+		err = zram_wb_flush(zram, wb);
+		if (err)
+			ret = err;
+		zram_wb_throttle(zram, start, written_kb);
+		continue;
 next:
 		zram_slot_unlock(zram, index);
 	}
 
+	err = zram_wb_flush(zram, wb);
+	if (err)
+		ret = err;
+
 	if (blk_idx)
 		free_block_bdev(zram, blk_idx);
-	__free_page(page);
+free_batch:
+	for (i = 0; i < nr_slots && wb->reqs[i].page; i++)
+		__free_page(wb->reqs[i].page);
+	kfree(wb);
 release_init_lock:
 	up_read(&zram->init_lock);
 
@@ -1120,6 +1285,59 @@ static ssize_t bd_stat_show(struct device *dev,
 }
 #endif
 
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+
+static ssize_t dedup_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+			"%8llu %8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.dup_data_size),
+			(u64)atomic64_read(&zram->stats.meta_data_size),
+			(u64)atomic64_read(&zram->stats.dedup_hits));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 static ssize_t debug_stat_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1144,6 +1362,9 @@ static DEVICE_ATTR_RO(mm_stat);
 static DEVICE_ATTR_RO(bd_stat);
 #endif
 static DEVICE_ATTR_RO(debug_stat);
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RO(dedup_stat);
+#endif
 
 static void zram_meta_free(struct zram *zram, u64 disksize)
 {
@@ -1155,6 +1376,7 @@ static void zram_meta_free(struct zram *zram, u64 disksize)
 		zram_free_page(zram, index);
 
 	zs_destroy_pool(zram->mem_pool);
+	zram_dedup_fini(zram);
 	vfree(zram->table);
 }
 
@@ -1173,6 +1395,12 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 		return false;
 	}
 
+	if (zram_dedup_init(zram, num_pages)) {
+		zs_destroy_pool(zram->mem_pool);
+		vfree(zram->table);
+		return false;
+	}
+
 	if (!huge_class_size)
 		huge_class_size = zs_huge_class_size(zram->mem_pool);
 	return true;
@@ -1198,6 +1426,9 @@ static void zram_free_page(struct zram *zram, size_t index)
 		atomic64_dec(&zram->stats.huge_pages);
 	}
 
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		zram_clear_flag(zram, index, ZRAM_RECOMP);
+
 	if (zram_test_flag(zram, index, ZRAM_WB)) {
 		zram_clear_flag(zram, index, ZRAM_WB);
 		free_block_bdev(zram, zram_get_element(zram, index));
@@ -1218,6 +1449,11 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (!handle)
 		return;
 
+	if (zram_dedup_enabled(zram)) {
+		zram_dedup_put(zram, (struct zram_entry *)handle);
+		goto out;
+	}
+
 	zs_free(zram->mem_pool, handle);
 
 	atomic64_sub(zram_get_obj_size(zram, index),
@@ -1230,29 +1466,30 @@ static void zram_free_page(struct zram *zram, size_t index)
 		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
 }
 
-static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
-				struct bio *bio, bool partial_io)
+/* Compressor the object of a slot was stored with */
+static struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
 {
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+#endif
+	return zram->comp;
+}
+
+/*
+ * Decompress a slot that lives in the zsmalloc pool into @page.
+ * Called with the slot lock held.
+ */
+static int zram_read_from_zspool(struct zram *zram, struct page *page,
+				 u32 index)
+{
+	struct zcomp *comp = zram_slot_comp(zram, index);
 	struct zcomp_strm *zstrm;
 	unsigned long handle;
 	unsigned int size;
 	void *src, *dst;
 	int ret;
 
-	zram_slot_lock(zram, index);
-	if (zram_test_flag(zram, index, ZRAM_WB)) {
-		struct bio_vec bvec;
-
-		zram_slot_unlock(zram, index);
-
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
-		return read_from_bdev(zram, &bvec,
-				zram_get_element(zram, index),
-				bio, partial_io);
-	}
-
 	handle = zram_get_handle(zram, index);
 	if (!handle || zram_test_flag(zram, index, ZRAM_SAME)) {
 		unsigned long value;
@@ -1262,14 +1499,16 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		mem = kmap_atomic(page);
 		zram_fill_page(mem, PAGE_SIZE, value);
 		kunmap_atomic(mem);
-		zram_slot_unlock(zram, index);
 		return 0;
 	}
 
+	if (zram_dedup_enabled(zram))
+		handle = zram_dedup_handle((struct zram_entry *)handle);
+
 	size = zram_get_obj_size(zram, index);
 
 	if (size != PAGE_SIZE)
-		zstrm = zcomp_stream_get(zram->comp);
+		zstrm = zcomp_stream_get(comp);
 
 	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE) {
@@ -1281,9 +1520,33 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
+
+	return ret;
+}
+
+static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
+				struct bio *bio, bool partial_io)
+{
+	int ret;
+
+	zram_slot_lock(zram, index);
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		struct bio_vec bvec;
+
+		zram_slot_unlock(zram, index);
+
+		bvec.bv_page = page;
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
+		return read_from_bdev(zram, &bvec,
+				zram_get_element(zram, index),
+				bio, partial_io);
+	}
+
+	ret = zram_read_from_zspool(zram, page, index);
 	zram_slot_unlock(zram, index);
 
 	/* Should NEVER happen. Return bio error if it does. */
@@ -1338,6 +1601,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
+	struct zram_entry *entry;
+	u32 checksum = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1347,6 +1612,17 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 		atomic64_inc(&zram->stats.same_pages);
 		goto out;
 	}
+
+	if (zram_dedup_enabled(zram)) {
+		checksum = zram_dedup_checksum(mem);
+		entry = zram_dedup_find(zram, mem, checksum);
+		if (entry) {
+			kunmap_atomic(mem);
+			comp_len = zram_dedup_len(entry);
+			handle = (unsigned long)entry;
+			goto out;
+		}
+	}
 	kunmap_atomic(mem);
 
 compress_again:
@@ -1414,6 +1690,16 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
+
+	if (zram_dedup_enabled(zram)) {
+		entry = zram_dedup_insert(zram, handle, comp_len, checksum,
+					  GFP_NOIO | __GFP_NOWARN);
+		if (!entry) {
+			zs_free(zram->mem_pool, handle);
+			return -ENOMEM;
+		}
+		handle = (unsigned long)entry;
+	}
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
 out:
 	/*
@@ -1484,6 +1770,173 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	return ret;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recomp_algorithm, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recomp_algorithm)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	/* An empty string disables recompression */
+	if (compressor[0] && !zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recomp_algorithm, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+
+/*
+ * Recompress one slot with the secondary algorithm. The new object is
+ * only kept when it is smaller than the old one. Called with the slot
+ * lock held, so neither the decompression nor the allocation may sleep.
+ */
+static int zram_recompress(struct zram *zram, u32 index, struct page *page)
+{
+	struct zcomp_strm *zstrm;
+	unsigned long handle;
+	unsigned int comp_len_old, comp_len;
+	void *src, *dst;
+	int ret;
+
+	comp_len_old = zram_get_obj_size(zram, index);
+	ret = zram_read_from_zspool(zram, page, index);
+	if (ret)
+		return ret;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len);
+	kunmap_atomic(src);
+
+	if (ret || comp_len >= comp_len_old || comp_len >= huge_class_size) {
+		zcomp_stream_put(zram->recomp);
+		return ret;
+	}
+
+	handle = zs_malloc(zram->mem_pool, comp_len,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE);
+	if (!handle) {
+		zcomp_stream_put(zram->recomp);
+		return -ENOMEM;
+	}
+
+	dst = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, comp_len);
+	zcomp_stream_put(zram->recomp);
+	zs_unmap_object(zram->mem_pool, handle);
+
+	zram_free_page(zram, index);
+	zram_set_handle(zram, index, handle);
+	zram_set_obj_size(zram, index, comp_len);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+	/* The data was not accessed, keep it a writeback candidate */
+	zram_set_flag(zram, index, ZRAM_IDLE);
+	atomic64_add(comp_len, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.pages_stored);
+
+	return 0;
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+	struct page *page;
+	ssize_t ret = len;
+
+	if (!sysfs_streq(buf, "idle"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	/* Shared dedup objects are always in the primary format */
+	if (!init_done(zram) || !zram->recomp || zram_dedup_enabled(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto release_init_lock;
+	}
+
+	for (index = 0; index < nr_pages; index++) {
+		int err = 0;
+
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
+
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index))
+			goto next;
+
+		/*
+		 * Huge slots did not compress with the primary algorithm
+		 * and are left for writeback.
+		 */
+		if (zram_test_flag(zram, index, ZRAM_WB) ||
+				zram_test_flag(zram, index, ZRAM_SAME) ||
+				zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+				zram_test_flag(zram, index, ZRAM_HUGE) ||
+				zram_test_flag(zram, index, ZRAM_RECOMP))
+			goto next;
+
+		if (!zram_test_flag(zram, index, ZRAM_IDLE))
+			goto next;
+
+		err = zram_recompress(zram, index, page);
+next:
+		zram_slot_unlock(zram, index);
+		if (err) {
+			ret = err;
+			break;
+		}
+		cond_resched();
+	}
+
+	__free_page(page);
+release_init_lock:
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 /*
  * zram_bio_discard - handler on discard request
  * @index: physical block index in PAGE_SIZE units
@@ -1696,6 +2149,9 @@ static int zram_rw_page(struct block_device *bdev, sector_t sector,
 static void zram_reset_device(struct zram *zram)
 {
 	struct zcomp *comp;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	struct zcomp *recomp;
+#endif
 	u64 disksize;
 
 	down_write(&zram->init_lock);
@@ -1708,6 +2164,10 @@ static void zram_reset_device(struct zram *zram)
 	}
 
 	comp = zram->comp;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	recomp = zram->recomp;
+	zram->recomp = NULL;
+#endif
 	disksize = zram->disksize;
 	zram->disksize = 0;
 
@@ -1719,6 +2179,10 @@ static void zram_reset_device(struct zram *zram)
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (recomp)
+		zcomp_destroy(recomp);
+#endif
 	reset_bdev(zram);
 }
 
@@ -1755,6 +2219,20 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recomp_algorithm[0]) {
+		struct zcomp *recomp = zcomp_create(zram->recomp_algorithm);
+
+		if (IS_ERR(recomp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->recomp_algorithm);
+			zcomp_destroy(comp);
+			err = PTR_ERR(recomp);
+			goto out_free_meta;
+		}
+		zram->recomp = recomp;
+	}
+#endif
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity_and_notify(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1853,6 +2331,14 @@ static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
 static DEVICE_ATTR_RW(writeback_limit);
 static DEVICE_ATTR_RW(writeback_limit_enable);
+static DEVICE_ATTR_RW(writeback_rate_limit);
+#endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
 #endif
 
 static struct attribute *zram_disk_attrs[] = {
@@ -1870,11 +2356,22 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_writeback.attr,
 	&dev_attr_writeback_limit.attr,
 	&dev_attr_writeback_limit_enable.attr,
+	&dev_attr_writeback_rate_limit.attr,
+#endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
 #endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_bd_stat.attr,
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_dedup_stat.attr,
 #endif
 	&dev_attr_debug_stat.attr,
 	NULL,
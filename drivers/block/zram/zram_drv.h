@@ -50,12 +50,33 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* page is compressed with the secondary algorithm */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
+#ifdef CONFIG_ZRAM_DEDUP
+/*
+ * A zsmalloc object shared by every slot holding the same content.
+ * Slots of a dedup enabled device point to one of these instead of
+ * holding the handle directly.
+ */
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 checksum;
+	unsigned int len;
+	unsigned long handle;
+	unsigned long refcount;	/* protected by zram_hash.lock */
+};
+
+struct zram_hash {
+	spinlock_t lock;
+	struct rb_root rb_root;
+};
+#endif
+
 /* Allocated for each disk page */
 struct zram_table_entry {
 	union {
@@ -88,6 +109,11 @@ struct zram_stats {
 	atomic64_t bd_reads;		/* no. of reads from backing device */
 	atomic64_t bd_writes;		/* no. of writes from backing device */
 #endif
+#ifdef CONFIG_ZRAM_DEDUP
+	atomic64_t dup_data_size;	/* compressed bytes saved by dedup */
+	atomic64_t meta_data_size;	/* bytes used by dedup entries */
+	atomic64_t dedup_hits;		/* no. of writes served by dedup */
+#endif
 };
 
 struct zram {
@@ -109,6 +135,11 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[CRYPTO_MAX_ALG_NAME];
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	/* secondary algorithm used by the recompress pass, "" if unset */
+	struct zcomp *recomp;
+	char recomp_algorithm[CRYPTO_MAX_ALG_NAME];
+#endif
 	/*
 	 * zram is claimed so open request will be failed
 	 */
@@ -118,10 +149,16 @@ struct zram {
 	spinlock_t wb_limit_lock;
 	bool wb_limit_enable;
 	u64 bd_wb_limit;
+	u64 wb_rate_limit;	/* MB/s, 0 is unlimited */
 	struct block_device *bdev;
 	unsigned long *bitmap;
 	unsigned long nr_pages;
 #endif
+#ifdef CONFIG_ZRAM_DEDUP
+	bool use_dedup;
+	struct zram_hash *hash;
+	size_t hash_size;
+#endif
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	struct dentry *debugfs_dir;
 #endif
@@ -30,6 +30,8 @@
 #define RNG_MODULE_NAME		"hw_random"
 
 #define RNG_BUFFER_SIZE (SMP_CACHE_BYTES < 32 ? 32 : SMP_CACHE_BYTES)
+/* what khwrngd collects per round until the crng is initialized */
+#define RNG_FILL_SIZE	(8 * RNG_BUFFER_SIZE)
 
 static struct hwrng *current_rng;
 /* the current rng has been explicitly chosen by user via sysfs */
@@ -45,6 +47,7 @@ static int data_avail;
 static u8 *rng_buffer, *rng_fillbuf;
 static unsigned short current_quality;
 static unsigned short default_quality; /* = 0; default to "off" */
+static bool fill_all;
 
 module_param(current_quality, ushort, 0644);
 MODULE_PARM_DESC(current_quality,
@@ -52,6 +55,9 @@ MODULE_PARM_DESC(current_quality,
 module_param(default_quality, ushort, 0644);
 MODULE_PARM_DESC(default_quality,
 		 "default entropy content of hwrng per 1024 bits of input");
+module_param(fill_all, bool, 0644);
+MODULE_PARM_DESC(fill_all,
+		 "feed the entropy pool from every rng with a quality rating, not just the current one");
 
 static void drop_current_rng(void);
 static int hwrng_init(struct hwrng *rng);
@@ -148,10 +154,11 @@ static void put_rng(struct hwrng *rng)
 	mutex_unlock(&rng_mutex);
 }
 
-static int hwrng_init(struct hwrng *rng)
+/* Take a reference on rng, initializing it if nobody holds one yet. */
+static int __hwrng_init(struct hwrng *rng)
 {
 	if (kref_get_unless_zero(&rng->ref))
-		goto skip_init;
+		return 0;
 
 	if (rng->init) {
 		int ret;
@@ -164,7 +171,17 @@ static int hwrng_init(struct hwrng *rng)
 	kref_init(&rng->ref);
 	reinit_completion(&rng->cleanup_done);
 
-skip_init:
+	return 0;
+}
+
+static int hwrng_init(struct hwrng *rng)
+{
+	int ret;
+
+	ret = __hwrng_init(rng);
+	if (ret)
+		return ret;
+
 	current_quality = rng->quality ? : default_quality;
 	if (current_quality > 1024)
 		current_quality = 1024;
@@ -431,29 +448,113 @@ static int __init register_miscdev(void)
 	return misc_register(&rng_miscdev);
 }
 
+/*
+ * Returns a refcounted hwrng to fill from on this turn, and the quality to
+ * credit its output with. Normally that is always the current rng; with
+ * fill_all, the other rngs that have a quality rating of their own take
+ * turns after it. Those are initialized on first use and stay so until
+ * they are unregistered.
+ */
+static struct hwrng *get_fill_rng(unsigned int turn, unsigned short *quality)
+{
+	struct hwrng *rng, *pick;
+	unsigned int n = 0;
+
+	if (mutex_lock_interruptible(&rng_mutex))
+		return ERR_PTR(-ERESTARTSYS);
+
+	pick = current_rng;
+	*quality = current_quality;
+
+	if (fill_all && current_rng) {
+		list_for_each_entry(rng, &rng_list, list)
+			if (rng != current_rng && rng->quality)
+				n++;
+
+		turn %= n + 1;
+		list_for_each_entry(rng, &rng_list, list) {
+			if (!turn)
+				break;
+			if (rng == current_rng || !rng->quality)
+				continue;
+			if (!--turn)
+				pick = rng;
+		}
+
+		if (pick != current_rng && !pick->filling) {
+			if (__hwrng_init(pick))
+				pick = current_rng;
+			else
+				pick->filling = true;
+		}
+		if (pick != current_rng)
+			*quality = min_t(unsigned short, pick->quality, 1024);
+	}
+
+	if (pick)
+		kref_get(&pick->ref);
+	mutex_unlock(&rng_mutex);
+
+	return pick;
+}
+
+/*
+ * Fill rng_fillbuf from rng. While the crng is still waiting for its initial
+ * seed, keep reading until RNG_FILL_SIZE worth is there, so that boot is not
+ * paced by one RNG_BUFFER_SIZE read per round; once it is initialized,
+ * add_hwgenerator_randomness() throttles us and one read will do.
+ */
+static long rng_fill_batch(struct hwrng *rng)
+{
+	size_t size = rng_is_initialized() ? rng_buffer_size() : RNG_FILL_SIZE;
+	size_t len = 0;
+	long rc = 0;
+
+	while (!kthread_should_stop()) {
+		/* ->read() and ->data_read() expect an aligned buffer */
+		size_t off = ALIGN(len, ARCH_KMALLOC_MINALIGN);
+
+		if (off + rng_buffer_size() > size)
+			break;
+
+		mutex_lock(&reading_mutex);
+		rc = rng_get_data(rng, rng_fillbuf + off,
+				  rng_buffer_size(), 1);
+		mutex_unlock(&reading_mutex);
+		if (rc <= 0)
+			break;
+
+		memmove(rng_fillbuf + len, rng_fillbuf + off, rc);
+		len += rc;
+	}
+
+	return len ? len : rc;
+}
+
 static int hwrng_fillfn(void *unused)
 {
+	unsigned int turn = 0;
 	long rc;
 
 	while (!kthread_should_stop()) {
+		unsigned short quality;
 		struct hwrng *rng;
 
-		rng = get_current_rng();
+		rng = get_fill_rng(turn++, &quality);
 		if (IS_ERR(rng) || !rng)
 			break;
-		mutex_lock(&reading_mutex);
-		rc = rng_get_data(rng, rng_fillbuf,
-				  rng_buffer_size(), 1);
-		mutex_unlock(&reading_mutex);
-		put_rng(rng);
+		rc = rng_fill_batch(rng);
 		if (rc <= 0) {
-			pr_warn("hwrng: no data available\n");
+			pr_warn("hwrng: no data available from %s\n",
+				rng->name);
+			put_rng(rng);
 			msleep_interruptible(10000);
 			continue;
 		}
+		put_rng(rng);
 		/* Outside lock, sure, but y'know: randomness. */
 		add_hwgenerator_randomness((void *)rng_fillbuf, rc,
-					   rc * current_quality * 8 >> 10);
+					   rc * quality * 8 >> 10);
 	}
 	hwrng_fill = NULL;
 	return 0;
@@ -489,6 +590,7 @@ int hwrng_register(struct hwrng *rng)
 
 	init_completion(&rng->cleanup_done);
 	complete(&rng->cleanup_done);
+	rng->filling = false;
 
 	/* rng_list is sorted by decreasing quality */
 	list_for_each(rng_list_ptr, &rng_list) {
@@ -544,6 +646,10 @@ void hwrng_unregister(struct hwrng *rng)
 
 	old_rng = current_rng;
 	list_del(&rng->list);
+	if (rng->filling) {
+		rng->filling = false;
+		kref_put(&rng->ref, cleanup_rng);
+	}
 	if (current_rng == rng) {
 		err = enable_best_rng();
 		if (err) {
@@ -621,7 +727,7 @@ static int __init hwrng_modinit(void)
 	if (!rng_buffer)
 		return -ENOMEM;
 
-	rng_fillbuf = kmalloc(rng_buffer_size(), GFP_KERNEL);
+	rng_fillbuf = kmalloc(RNG_FILL_SIZE, GFP_KERNEL);
 	if (!rng_fillbuf) {
 		kfree(rng_buffer);
 		return -ENOMEM;
@@ -42,6 +42,7 @@
 #define EXYNOS_TRNG_FIFO_6         (0x98)
 #define EXYNOS_TRNG_FIFO_7         (0x9c)
 #define EXYNOS_TRNG_FIFO_LEN       (8)
+#define EXYNOS_TRNG_FIFO_BYTES     (EXYNOS_TRNG_FIFO_LEN * 4)
 #define EXYNOS_TRNG_CLOCK_RATE     (500000)
 
 
@@ -50,33 +51,64 @@ struct exynos_trng_dev {
 	void __iomem     *mem;
 	struct clk       *clk;
 	struct hwrng rng;
+	unsigned int     fill_us;
+	bool             primed;
 };
 
+static void exynos_trng_start_fill(struct exynos_trng_dev *trng)
+{
+	writel_relaxed(EXYNOS_TRNG_FIFO_BYTES * 8,
+		       trng->mem + EXYNOS_TRNG_FIFO_CTRL);
+	trng->primed = true;
+}
+
+/*
+ * A refill of the whole FIFO is started as soon as it has been drained, so
+ * the generator works while we are away and the next call usually finds the
+ * data ready. When it is not, sleep for about one FIFO's generation time per
+ * poll rather than waking up every few hundred microseconds.
+ */
 static int exynos_trng_do_read(struct hwrng *rng, void *data, size_t max,
 			       bool wait)
 {
 	struct exynos_trng_dev *trng;
-	int val;
-
-	max = min_t(size_t, max, (EXYNOS_TRNG_FIFO_LEN * 4));
+	size_t len = 0;
+	u32 val;
+	int ret;
 
 	trng = (struct exynos_trng_dev *)rng->priv;
 
-	writel_relaxed(max * 8, trng->mem + EXYNOS_TRNG_FIFO_CTRL);
-	val = readl_poll_timeout(trng->mem + EXYNOS_TRNG_FIFO_CTRL, val,
-				 val == 0, 200, 1000000);
-	if (val < 0)
-		return val;
+	while (len < max) {
+		size_t n = min_t(size_t, max - len, EXYNOS_TRNG_FIFO_BYTES);
 
-	memcpy_fromio(data, trng->mem + EXYNOS_TRNG_FIFO_0, max);
+		if (!trng->primed)
+			exynos_trng_start_fill(trng);
 
-	return max;
+		if (readl_relaxed(trng->mem + EXYNOS_TRNG_FIFO_CTRL)) {
+			if (!wait)
+				break;
+
+			ret = readl_poll_timeout(trng->mem +
+						 EXYNOS_TRNG_FIFO_CTRL, val,
+						 val == 0, trng->fill_us,
+						 1000000);
+			if (ret)
+				return len ? len : ret;
+		}
+
+		memcpy_fromio(data + len, trng->mem + EXYNOS_TRNG_FIFO_0, n);
+		len += n;
+
+		exynos_trng_start_fill(trng);
+	}
+
+	return len;
 }
 
 static int exynos_trng_init(struct hwrng *rng)
 {
 	struct exynos_trng_dev *trng = (struct exynos_trng_dev *)rng->priv;
-	unsigned long sss_rate;
+	unsigned long sss_rate, trng_rate;
 	u32 val;
 
 	sss_rate = clk_get_rate(trng->clk);
@@ -93,6 +125,12 @@ static int exynos_trng_init(struct hwrng *rng)
 	val = val << 1;
 	writel_relaxed(val, trng->mem + EXYNOS_TRNG_CLKDIV);
 
+	/* at one raw bit per TRNG clock */
+	trng_rate = max(sss_rate / max(val, 1U), 1UL);
+	trng->fill_us = DIV_ROUND_UP_ULL((u64)EXYNOS_TRNG_FIFO_BYTES * 8 *
+					 USEC_PER_SEC, trng_rate);
+	trng->primed = false;
+
 	/* Enable the generator. */
 	val = EXYNOS_TRNG_CTRL_RNGEN;
 	writel_relaxed(val, trng->mem + EXYNOS_TRNG_CTRL);
@@ -194,8 +232,12 @@ static int __maybe_unused exynos_trng_suspend(struct device *dev)
 
 static int __maybe_unused exynos_trng_resume(struct device *dev)
 {
+	struct exynos_trng_dev *trng = dev_get_drvdata(dev);
 	int ret;
 
+	/* a fill started before suspend is gone */
+	trng->primed = false;
+
 	ret = pm_runtime_resume_and_get(dev);
 	if (ret < 0) {
 		dev_err(dev, "Could not get runtime PM.\n");
@@ -74,8 +74,10 @@ struct clk_core {
 	unsigned long		new_rate;
 	struct clk_core		*new_parent;
 	struct clk_core		*new_child;
+	unsigned long		staged_rate;
 	unsigned long		flags;
 	bool			orphan;
+	bool			staged;
 	bool			rpm_enabled;
 	unsigned int		enable_count;
 	unsigned int		prepare_count;
@@ -2385,6 +2387,240 @@ int clk_set_rate(struct clk *clk, unsigned long rate)
 }
 EXPORT_SYMBOL_GPL(clk_set_rate);
 
+/*
+ * Make the rates calculated for the subtree of @top the current ones, so that
+ * the following rate calculations of a transaction see them.  The real rates
+ * are kept aside and put back by clk_unstage_rates().
+ */
+static void clk_stage_rates(struct clk_core *core)
+{
+	struct clk_core *child;
+
+	if (!core->staged) {
+		core->staged_rate = core->rate;
+		core->staged = true;
+	}
+	core->rate = core->new_rate;
+
+	hlist_for_each_entry(child, &core->children, child_node)
+		clk_stage_rates(child);
+}
+
+static void clk_unstage_rates(struct clk_core *core)
+{
+	struct clk_core *child;
+
+	if (core->staged) {
+		core->rate = core->staged_rate;
+		core->staged = false;
+	}
+
+	hlist_for_each_entry(child, &core->children, child_node)
+		clk_unstage_rates(child);
+}
+
+static bool clk_core_is_ancestor(struct clk_core *ancestor,
+				 struct clk_core *core)
+{
+	for (core = core->parent; core; core = core->parent)
+		if (core == ancestor)
+			return true;
+
+	return false;
+}
+
+/*
+ * Calculate the new rates for all of @cores on top of each other.  Returns 0
+ * and the topmost changed clock for each of them in @tops (NULL if the clock
+ * needs no change) if a single walk from each of @tops can apply all of the
+ * rates, -EAGAIN if the requests cannot be merged, or another negative error
+ * code if one of the requests is invalid.
+ */
+static int clk_calc_new_rates_multiple(int num, struct clk_core **cores,
+				       const unsigned long *rates,
+				       struct clk_core **tops,
+				       unsigned long *new_rates)
+{
+	struct clk_core *core;
+	unsigned long rate;
+	int i, j, ret = 0;
+
+	for (i = 0; i < num; i++) {
+		tops[i] = NULL;
+		if (!cores[i])
+			continue;
+
+		rate = clk_core_req_round_rate_nolock(cores[i], rates[i]);
+		if (rate == clk_core_get_rate_nolock(cores[i]))
+			continue;
+
+		if (clk_core_rate_is_protected(cores[i])) {
+			ret = -EBUSY;
+			break;
+		}
+
+		tops[i] = clk_calc_new_rates(cores[i], rates[i]);
+		if (!tops[i]) {
+			ret = -EINVAL;
+			break;
+		}
+		new_rates[i] = cores[i]->new_rate;
+
+		/* reparenting is left to the regular path */
+		for (core = cores[i]; core != tops[i]; core = core->parent)
+			if (core->new_parent && core->new_parent != core->parent)
+				ret = -EAGAIN;
+		if (ret)
+			break;
+
+		clk_stage_rates(tops[i]);
+	}
+
+	for (j = 0; j < num; j++)
+		if (tops[j])
+			clk_unstage_rates(tops[j]);
+	if (ret)
+		return ret;
+
+	/* a later calculation must not have overridden an earlier one */
+	for (i = 0; i < num; i++)
+		if (tops[i] && cores[i]->new_rate != new_rates[i])
+			return -EAGAIN;
+
+	/* only walk from the clocks which are not below another top */
+	for (i = 0; i < num; i++) {
+		for (j = 0; j < num && tops[i]; j++) {
+			if (!tops[j] || i == j)
+				continue;
+			if (clk_core_is_ancestor(tops[j], tops[i]) ||
+			    (tops[j] == tops[i] && j < i))
+				tops[i] = NULL;
+		}
+	}
+
+	return 0;
+}
+
+static int clk_core_set_rate_multiple_nolock(int num, struct clk_core **cores,
+					     const unsigned long *rates)
+{
+	struct clk_core **tops, *fail_clk = NULL;
+	unsigned long *new_rates;
+	int i, j, ret;
+
+	tops = kcalloc(num, sizeof(*tops), GFP_KERNEL);
+	new_rates = kcalloc(num, sizeof(*new_rates), GFP_KERNEL);
+	if (!tops || !new_rates) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = clk_calc_new_rates_multiple(num, cores, rates, tops, new_rates);
+	if (ret == -EAGAIN) {
+		/* fall back to changing the rates one by one */
+		for (i = 0; i < num; i++) {
+			ret = clk_core_set_rate_nolock(cores[i], rates[i]);
+			if (ret)
+				break;
+		}
+		goto out;
+	}
+	if (ret)
+		goto out;
+
+	for (i = 0; i < num; i++) {
+		if (!cores[i])
+			continue;
+		ret = clk_pm_runtime_get(cores[i]);
+		if (ret)
+			goto put_pm;
+	}
+
+	/* notify that we are about to change rates */
+	for (j = 0; j < num; j++) {
+		if (!tops[j])
+			continue;
+		fail_clk = clk_propagate_rate_change(tops[j], PRE_RATE_CHANGE);
+		if (fail_clk)
+			break;
+	}
+	if (fail_clk) {
+		pr_debug("%s: failed to set %s rate\n", __func__,
+				fail_clk->name);
+		for (; j >= 0; j--)
+			if (tops[j])
+				clk_propagate_rate_change(tops[j],
+							  ABORT_RATE_CHANGE);
+		ret = -EBUSY;
+		goto put_pm;
+	}
+
+	/* change the rates, programming each clock once */
+	for (j = 0; j < num; j++)
+		if (tops[j])
+			clk_change_rate(tops[j]);
+
+	for (j = 0; j < num; j++)
+		if (cores[j])
+			cores[j]->req_rate = rates[j];
+
+put_pm:
+	while (--i >= 0)
+		if (cores[i])
+			clk_pm_runtime_put(cores[i]);
+out:
+	kfree(new_rates);
+	kfree(tops);
+	return ret;
+}
+
+/**
+ * clk_bulk_set_rate - specify new rates for a set of clks at once
+ * @num_clks: the number of clk_bulk_data
+ * @clks: the clk_bulk_data table of the clks whose rates are being changed
+ * @rates: the new rates, one for each entry of @clks
+ *
+ * The new rates are calculated for all of @clks before any hardware is
+ * touched, each one on top of the previous results.  If the calculations agree
+ * with each other, each affected clock is then programmed and recalculated
+ * only once, even if several of @clks share a PLL which has to change.
+ * Otherwise the rates are set one after another as clk_set_rate() would.
+ *
+ * Returns 0 on success, -EERROR otherwise.
+ */
+int clk_bulk_set_rate(int num_clks, const struct clk_bulk_data *clks,
+		      const unsigned long *rates)
+{
+	struct clk_core **cores;
+	int i, ret;
+
+	cores = kcalloc(num_clks, sizeof(*cores), GFP_KERNEL);
+	if (!cores)
+		return -ENOMEM;
+
+	for (i = 0; i < num_clks; i++)
+		cores[i] = clks[i].clk ? clks[i].clk->core : NULL;
+
+	/* prevent racing with updates to the clock topology */
+	clk_prepare_lock();
+
+	for (i = 0; i < num_clks; i++)
+		if (clks[i].clk && clks[i].clk->exclusive_count)
+			clk_core_rate_unprotect(cores[i]);
+
+	ret = clk_core_set_rate_multiple_nolock(num_clks, cores, rates);
+
+	for (i = 0; i < num_clks; i++)
+		if (clks[i].clk && clks[i].clk->exclusive_count)
+			clk_core_rate_protect(cores[i]);
+
+	clk_prepare_unlock();
+
+	kfree(cores);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(clk_bulk_set_rate);
+
 /**
  * clk_set_rate_exclusive - specify a new rate and get exclusive control
  * @clk: the clk whose rate is being changed
@@ -1118,6 +1118,14 @@ static int samsung_pll2650x_set_rate(struct clk_hw *hw, unsigned long drate,
 	con0 = readl_relaxed(pll->con_reg);
 	con1 = readl_relaxed(pll->con_reg + 4);
 
+	/*
+	 * The core calls .set_rate for every clock below the topmost changed
+	 * one, so skip the relock if the running PLL already has the rate.
+	 */
+	if (clk_hw_get_rate(hw) == drate &&
+	    (con0 & (1 << PLL2650X_PLL_ENABLE_SHIFT)))
+		return 0;
+
 	/* Set PLL lock time. */
 	writel_relaxed(rate->pdiv * PLL2650X_LOCK_FACTOR, pll->lock_reg);
 
@@ -1208,6 +1216,11 @@ static int samsung_pll2650xx_set_rate(struct clk_hw *hw, unsigned long drate,
 	pll_con0 = readl_relaxed(pll->con_reg);
 	pll_con2 = readl_relaxed(pll->con_reg + 8);
 
+	/* Skip the relock if the running PLL already has the rate */
+	if (clk_hw_get_rate(hw) == drate &&
+	    (pll_con0 & (1 << PLL2650XX_PLL_ENABLE_SHIFT)))
+		return 0;
+
 	 /* Change PLL PMS values */
 	pll_con0 &= ~(PLL2650XX_MDIV_MASK << PLL2650XX_MDIV_SHIFT |
 			PLL2650XX_PDIV_MASK << PLL2650XX_PDIV_SHIFT |
@@ -21,6 +21,10 @@
 #include <linux/clocksource.h>
 #include <linux/sched_clock.h>
 
+#if defined(CONFIG_ARM) && defined(CONFIG_VDSO)
+#include <asm/vdso.h>
+#endif
+
 #define EXYNOS4_MCTREG(x)		(x)
 #define EXYNOS4_MCT_G_CNT_L		EXYNOS4_MCTREG(0x100)
 #define EXYNOS4_MCT_G_CNT_U		EXYNOS4_MCTREG(0x104)
@@ -82,6 +86,7 @@ enum {
 };
 
 static void __iomem *reg_base;
+static phys_addr_t reg_phys;
 static unsigned long clk_rate;
 static unsigned int mct_int_type;
 static int mct_irqs[MCT_NR_IRQS];
@@ -248,6 +253,12 @@ static int __init exynos4_clocksource_init(void)
 	register_current_timer_delay(&exynos4_delay_timer);
 #endif
 
+#if defined(CONFIG_ARM) && defined(CONFIG_VDSO)
+	/* Let the vDSO read the global counter directly */
+	if (!arm_vdso_mct_init(reg_phys))
+		mct_frc.vdso_clock_mode = VDSO_CLOCKMODE_MCT;
+#endif
+
 	if (clocksource_register_hz(&mct_frc, clk_rate))
 		panic("%s: can't register clocksource\n", mct_frc.name);
 
@@ -507,11 +518,15 @@ static int exynos4_mct_dying_cpu(unsigned int cpu)
 static int __init exynos4_timer_resources(struct device_node *np)
 {
 	struct clk *mct_clk, *tick_clk;
+	struct resource res;
 
 	reg_base = of_iomap(np, 0);
 	if (!reg_base)
 		panic("%s: unable to ioremap mct address space\n", __func__);
 
+	if (!of_address_to_resource(np, 0, &res))
+		reg_phys = res.start;
+
 	tick_clk = of_clk_get_by_name(np, "fin_pll");
 	if (IS_ERR(tick_clk))
 		panic("%s: unable to determine tick clock rate\n", __func__);
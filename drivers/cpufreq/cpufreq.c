@@ -2210,6 +2210,7 @@ static int __target_index(struct cpufreq_policy *policy, int index)
 	unsigned int newfreq = policy->freq_table[index].frequency;
 	int retval = -EINVAL;
 	bool notify;
+	u64 start;
 
 	if (newfreq == policy->cur)
 		return 0;
@@ -2238,10 +2239,13 @@ static int __target_index(struct cpufreq_policy *policy, int index)
 		cpufreq_freq_transition_begin(policy, &freqs);
 	}
 
+	start = ktime_get_ns();
 	retval = cpufreq_driver->target_index(policy, index);
 	if (retval)
 		pr_err("%s: Failed to change cpu frequency: %d\n", __func__,
 		       retval);
+	else
+		cpufreq_stats_record_latency(policy, ktime_get_ns() - start);
 
 	if (notify) {
 		cpufreq_freq_transition_end(policy, &freqs, retval);
@@ -12,6 +12,13 @@
 #include <linux/sched/clock.h>
 #include <linux/slab.h>
 
+/*
+ * Bucket i of the latency histogram counts ->target_index() calls which took
+ * [2^(i-1), 2^i) microseconds, bucket 0 the ones below 1 us and the last one
+ * everything from 2^(CPUFREQ_STATS_LAT_BUCKETS - 2) us on.
+ */
+#define CPUFREQ_STATS_LAT_BUCKETS	20
+
 struct cpufreq_stats {
 	unsigned int total_trans;
 	unsigned long long last_time;
@@ -21,6 +28,8 @@ struct cpufreq_stats {
 	u64 *time_in_state;
 	unsigned int *freq_table;
 	unsigned int *trans_table;
+	unsigned int latency_hist[CPUFREQ_STATS_LAT_BUCKETS];
+	u64 latency_max;
 
 	/* Deferred reset */
 	unsigned int reset_pending;
@@ -42,6 +51,8 @@ static void cpufreq_stats_reset_table(struct cpufreq_stats *stats)
 
 	memset(stats->time_in_state, 0, count * sizeof(u64));
 	memset(stats->trans_table, 0, count * count * sizeof(int));
+	memset(stats->latency_hist, 0, sizeof(stats->latency_hist));
+	stats->latency_max = 0;
 	stats->last_time = local_clock();
 	stats->total_trans = 0;
 
@@ -172,11 +183,35 @@ static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
 }
 cpufreq_freq_attr_ro(trans_table);
 
+static ssize_t show_latency_hist(struct cpufreq_policy *policy, char *buf)
+{
+	struct cpufreq_stats *stats = policy->stats;
+	bool pending = READ_ONCE(stats->reset_pending);
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < CPUFREQ_STATS_LAT_BUCKETS; i++) {
+		unsigned long lo = i ? 1UL << (i - 1) : 0;
+
+		if (i == CPUFREQ_STATS_LAT_BUCKETS - 1)
+			len += sprintf(buf + len, "%9lu-    inf us: ", lo);
+		else
+			len += sprintf(buf + len, "%9lu-%7lu us: ", lo, 1UL << i);
+		len += sprintf(buf + len, "%u\n",
+			       pending ? 0 : stats->latency_hist[i]);
+	}
+	len += sprintf(buf + len, "max: %llu ns\n",
+		       pending ? 0 : stats->latency_max);
+	return len;
+}
+cpufreq_freq_attr_ro(latency_hist);
+
 static struct attribute *default_attrs[] = {
 	&total_trans.attr,
 	&time_in_state.attr,
 	&reset.attr,
 	&trans_table.attr,
+	&latency_hist.attr,
 	NULL
 };
 static const struct attribute_group stats_attr_group = {
@@ -288,3 +323,19 @@ void cpufreq_stats_record_transition(struct cpufreq_policy *policy,
 	stats->trans_table[old_index * stats->max_state + new_index]++;
 	stats->total_trans++;
 }
+
+void cpufreq_stats_record_latency(struct cpufreq_policy *policy, u64 delta_ns)
+{
+	struct cpufreq_stats *stats = policy->stats;
+	unsigned long us;
+	int bucket;
+
+	if (unlikely(!stats || READ_ONCE(stats->reset_pending)))
+		return;
+
+	us = div_u64(delta_ns, NSEC_PER_USEC);
+	bucket = us ? min_t(int, fls_long(us), CPUFREQ_STATS_LAT_BUCKETS - 1) : 0;
+	stats->latency_hist[bucket]++;
+	if (delta_ns > stats->latency_max)
+		stats->latency_max = delta_ns;
+}
@@ -109,6 +109,25 @@ static struct cpuidle_driver exynos_coupled_idle_driver = {
 	.safe_state_index = 0,
 };
 
+/*
+ * AFTR can only ever be entered from CPU0, so keep the governors on the
+ * other CPUs from picking it, only to have it demoted to WFI on every
+ * entry. This also keeps their per-state usage and residency statistics
+ * truthful.
+ */
+static void exynos_idle_disable_secondary_aftr(void)
+{
+	struct cpuidle_device *dev;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		dev = per_cpu(cpuidle_devices, cpu);
+		if (cpu == 0 || !dev)
+			continue;
+		dev->states_usage[1].disable |= CPUIDLE_STATE_DISABLED_BY_DRIVER;
+	}
+}
+
 static int exynos_cpuidle_probe(struct platform_device *pdev)
 {
 	int ret;
@@ -131,6 +150,9 @@ static int exynos_cpuidle_probe(struct platform_device *pdev)
 		return ret;
 	}
 
+	if (exynos_enter_aftr)
+		exynos_idle_disable_secondary_aftr();
+
 	return 0;
 }
 
@@ -10,12 +10,22 @@
 
 #include <linux/cpu.h>
 #include <linux/cpuidle.h>
+#include <linux/debugfs.h>
+#include <linux/interrupt.h>
+#include <linux/jump_label.h>
 #include <linux/mutex.h>
 #include <linux/module.h>
 #include <linux/pm_qos.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
 
 #include "cpuidle.h"
 
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "cpuidle."
+
 char param_governor[CPUIDLE_NAME_LEN];
 
 LIST_HEAD(cpuidle_governors);
@@ -118,3 +128,130 @@ s64 cpuidle_governor_latency_req(unsigned int cpu)
 
 	return (s64)device_req * NSEC_PER_USEC;
 }
+
+#ifdef CONFIG_IRQ_TIMINGS
+/*
+ * Governors may cap their idle duration estimate with the next interrupt
+ * predicted by the IRQ timings code, so that a deep state is not picked
+ * right before a periodic device interrupt.  This is off by default since
+ * it turns on interrupt timestamping; enable it with cpuidle.irq_predict.
+ */
+struct cpuidle_irq_stats {
+	u64 predicted_ns;	/* Prediction used for the current idle period */
+	unsigned long used;	/* Predictions earlier than the estimate */
+	unsigned long hits;	/* Wakeup arrived close to the prediction */
+	unsigned long early;	/* Something else woke the CPU first */
+	unsigned long late;	/* The predicted interrupt did not show up */
+};
+
+static DEFINE_PER_CPU(struct cpuidle_irq_stats, cpuidle_irq_stats);
+static DEFINE_STATIC_KEY_FALSE(cpuidle_irq_predict_key);
+static bool irq_predict;
+
+/* Wakeups within this distance of the prediction count as hits. */
+#define CPUIDLE_IRQ_PREDICT_SLACK_NS	(20 * NSEC_PER_USEC)
+
+static int irq_predict_set(const char *val, const struct kernel_param *kp)
+{
+	bool old = irq_predict;
+	int ret;
+
+	ret = param_set_bool(val, kp);
+	if (ret || old == irq_predict)
+		return ret;
+
+	if (irq_predict) {
+		irq_timings_enable();
+		static_branch_enable(&cpuidle_irq_predict_key);
+	} else {
+		static_branch_disable(&cpuidle_irq_predict_key);
+		irq_timings_disable();
+	}
+	return 0;
+}
+
+static const struct kernel_param_ops irq_predict_ops = {
+	.set = irq_predict_set,
+	.get = param_get_bool,
+};
+module_param_cb(irq_predict, &irq_predict_ops, &irq_predict, 0644);
+
+/**
+ * cpuidle_irq_predict - Cap an idle duration estimate by the next interrupt
+ * @dev: Target CPU
+ * @limit_ns: The governor's current estimate
+ *
+ * Must be called with interrupts disabled.  Returns the time till the next
+ * interrupt predicted on this CPU if that is earlier than @limit_ns, or
+ * @limit_ns otherwise.
+ */
+u64 cpuidle_irq_predict(struct cpuidle_device *dev, u64 limit_ns)
+{
+	struct cpuidle_irq_stats *st = this_cpu_ptr(&cpuidle_irq_stats);
+	u64 now, next;
+
+	st->predicted_ns = 0;
+	if (!static_branch_unlikely(&cpuidle_irq_predict_key))
+		return limit_ns;
+
+	now = local_clock();
+	next = irq_timings_next_event(now);
+	if (next == U64_MAX || next - now >= limit_ns)
+		return limit_ns;
+
+	st->predicted_ns = max_t(u64, next - now, 1);
+	st->used++;
+	return st->predicted_ns;
+}
+
+/**
+ * cpuidle_irq_predict_update - Account the outcome of the last prediction
+ * @dev: Target CPU
+ *
+ * Called by the governor after wakeup, when dev->last_residency_ns is valid.
+ */
+void cpuidle_irq_predict_update(struct cpuidle_device *dev)
+{
+	struct cpuidle_irq_stats *st = this_cpu_ptr(&cpuidle_irq_stats);
+	u64 pred = st->predicted_ns;
+	u64 slack;
+
+	if (!pred)
+		return;
+
+	slack = max_t(u64, pred >> 2, CPUIDLE_IRQ_PREDICT_SLACK_NS);
+	if (dev->last_residency_ns + slack < pred)
+		st->early++;
+	else if (dev->last_residency_ns > pred + slack)
+		st->late++;
+	else
+		st->hits++;
+	st->predicted_ns = 0;
+}
+
+static int irq_predict_stats_show(struct seq_file *s, void *unused)
+{
+	int cpu;
+
+	seq_puts(s, "cpu\tused\thits\tearly\tlate\n");
+	for_each_possible_cpu(cpu) {
+		struct cpuidle_irq_stats *st = per_cpu_ptr(&cpuidle_irq_stats, cpu);
+
+		seq_printf(s, "%d\t%lu\t%lu\t%lu\t%lu\n", cpu,
+			   READ_ONCE(st->used), READ_ONCE(st->hits),
+			   READ_ONCE(st->early), READ_ONCE(st->late));
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(irq_predict_stats);
+
+static int __init cpuidle_irq_predict_debugfs_init(void)
+{
+	struct dentry *dir = debugfs_create_dir("cpuidle", NULL);
+
+	debugfs_create_file("irq_predict_stats", 0444, dir, NULL,
+			    &irq_predict_stats_fops);
+	return 0;
+}
+late_initcall(cpuidle_irq_predict_debugfs_init);
+#endif /* CONFIG_IRQ_TIMINGS */
@@ -346,6 +346,9 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 			latency_req = interactivity_req;
 	}
 
+	/* Don't go deeper than the next predicted interrupt allows. */
+	predicted_ns = cpuidle_irq_predict(dev, predicted_ns);
+
 	/*
 	 * Find the idle state with the lowest power while satisfying
 	 * our constraints.
@@ -466,6 +469,8 @@ static void menu_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 	u64 measured_ns;
 	unsigned int new_factor;
 
+	cpuidle_irq_predict_update(dev);
+
 	/*
 	 * Try to figure out how much time passed between entry to low
 	 * power state and occurrence of the wakeup event.
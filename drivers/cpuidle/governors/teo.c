@@ -163,6 +163,8 @@ static void teo_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 	int i, idx_timer = 0, idx_duration = 0;
 	u64 measured_ns;
 
+	cpuidle_irq_predict_update(dev);
+
 	if (cpu_data->time_span_ns >= cpu_data->sleep_length_ns) {
 		/*
 		 * One of the safety nets has triggered or the wakeup was close
@@ -445,6 +447,21 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 		}
 	}
 
+	/*
+	 * If an interrupt is predicted to arrive before the candidate state
+	 * pays off, fall back to a state matching the time till then.
+	 */
+	if (duration_ns > 0) {
+		s64 irq_ns = cpuidle_irq_predict(dev, duration_ns);
+
+		if (irq_ns < duration_ns && teo_time_ok(irq_ns)) {
+			duration_ns = irq_ns;
+			if (drv->states[idx].target_residency_ns > duration_ns)
+				idx = teo_find_shallower_state(drv, dev, idx,
+							       duration_ns);
+		}
+	}
+
 	/*
 	 * If there is a latency constraint, it may be necessary to select an
 	 * idle state shallower than the current candidate one.
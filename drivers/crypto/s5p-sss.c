@@ -25,14 +25,18 @@
 #include <linux/scatterlist.h>
 
 #include <crypto/ctr.h>
+#include <crypto/aead.h>
 #include <crypto/aes.h>
 #include <crypto/algapi.h>
+#include <crypto/authenc.h>
 #include <crypto/scatterwalk.h>
 
 #include <crypto/hash.h>
+#include <crypto/hmac.h>
 #include <crypto/md5.h>
 #include <crypto/sha1.h>
 #include <crypto/sha2.h>
+#include <crypto/internal/aead.h>
 #include <crypto/internal/hash.h>
 
 #define _SBF(s, v)			((v) << (s))
@@ -158,7 +162,7 @@
 #define FLAGS_AES_CTR			_SBF(1, 0x02)
 
 #define AES_KEY_LEN			16
-#define CRYPTO_QUEUE_LEN		1
+#define CRYPTO_QUEUE_LEN		32
 
 /* HASH registers */
 #define SSS_REG_HASH_CTRL		0x00
@@ -230,6 +234,12 @@
 
 #define SSS_HASH_QUEUE_LENGTH	10
 
+/*
+ * Below this many bytes a one-shot digest costs more in interrupt and
+ * tasklet round trips than it takes in software.
+ */
+#define SSS_HASH_SW_THRESHOLD	256
+
 /**
  * struct samsung_aes_variant - platform specific SSS driver data
  * @aes_offset: AES register offset from SSS module's base.
@@ -258,6 +268,86 @@ struct s5p_aes_ctx {
 	int				keylen;
 };
 
+/**
+ * struct s5p_aead_ctx - authenc(hmac(sha256),cbc(aes)) tfm context
+ * @aes:	AES part of the key, must be first as the AES job uses it
+ * @ipad:	HMAC inner state after the ipad block, in HASH_OUT layout
+ * @opad:	HMAC outer state after the opad block
+ * @fallback:	Software implementation for requests the device can't do
+ */
+struct s5p_aead_ctx {
+	struct s5p_aes_ctx		aes;
+	u32				ipad[HASH_SHA256_MAX_REG];
+	struct sha256_state		opad;
+	struct crypto_aead		*fallback;
+};
+
+/**
+ * struct s5p_aead_reqctx - authenc(hmac(sha256),cbc(aes)) request context
+ * @aes:	Mode of the request, must be first
+ * @src:	Source cipher data, past the associated data
+ * @dst:	Destination cipher data, past the associated data
+ * @icv:	Inner digest read from the hash engine, then the ICV
+ * @fallback_req: Request passed to the software fallback, must be last
+ */
+struct s5p_aead_reqctx {
+	struct s5p_aes_reqctx		aes;
+	struct scatterlist		src[2];
+	struct scatterlist		dst[2];
+	u8				icv[SHA256_DIGEST_SIZE] __aligned(4);
+	struct aead_request		fallback_req;
+};
+
+/**
+ * struct s5p_aes_job - AES request prepared for the device
+ * @areq:	Crypto request
+ * @ctx:	Configuration of the request's tfm
+ * @reqctx:	Mode of the request
+ * @req_src:	Source cipher data of @areq
+ * @req_dst:	Destination cipher data of @areq
+ * @req_iv:	Chaining value of @areq, updated when the job finishes
+ * @cryptlen:	Number of bytes to run through the cipher
+ * @src:	Source scatter list, DMA-mapped as a whole
+ * @dst:	Destination scatter list, DMA-mapped as a whole
+ * @src_nents:	Number of @src entries passed to dma_map_sg()
+ * @dst_nents:	Number of @dst entries passed to dma_map_sg()
+ * @src_cpy:	In case of unaligned access, copied scatter list
+ *		with source data.
+ * @dst_cpy:	In case of unaligned access, copied scatter list
+ *		with destination data.
+ * @aes_control: Value of the AES_CONTROL register for this request
+ * @iv:		IV to load for CBC, NULL otherwise
+ * @ctr:	Counter to load for CTR, NULL otherwise
+ * @aead:	The hash engine computes the HMAC inner digest in the same pass
+ * @hashflow:	Hash engine input once the associated data has been hashed
+ * @assoc:	DMA-able copy of the associated data of an AEAD request
+ * @assoc_dma:	DMA address of @assoc
+ * @assoclen:	Length of @assoc
+ */
+struct s5p_aes_job {
+	struct crypto_async_request	*areq;
+	struct s5p_aes_ctx		*ctx;
+	struct s5p_aes_reqctx		*reqctx;
+	struct scatterlist		*req_src;
+	struct scatterlist		*req_dst;
+	u8				*req_iv;
+	unsigned int			cryptlen;
+	struct scatterlist		*src;
+	struct scatterlist		*dst;
+	int				src_nents;
+	int				dst_nents;
+	struct scatterlist		*src_cpy;
+	struct scatterlist		*dst_cpy;
+	u32				aes_control;
+	u8				*iv;
+	u8				*ctr;
+	bool				aead;
+	u32				hashflow;
+	u8				*assoc;
+	dma_addr_t			assoc_dma;
+	unsigned int			assoclen;
+};
+
 /**
  * struct s5p_aes_dev - Crypto device state container
  * @dev:	Associated device
@@ -266,22 +356,23 @@ struct s5p_aes_ctx {
  * @ioaddr:	Mapped IO memory region
  * @aes_ioaddr:	Per-varian offset for AES block IO memory
  * @irq_fc:	Feed control interrupt line
- * @req:	Crypto request currently handled by the device
- * @ctx:	Configuration for currently handled crypto request
- * @sg_src:	Scatter list with source data for currently handled block
- *		in device.  This is DMA-mapped into device.
- * @sg_dst:	Scatter list with destination data for currently handled block
- *		in device. This is DMA-mapped into device.
- * @sg_src_cpy:	In case of unaligned access, copied scatter list
- *		with source data.
- * @sg_dst_cpy:	In case of unaligned access, copied scatter list
- *		with destination data.
+ * @job:	Crypto request currently handled by the device
+ * @next:	Crypto request prepared while @job is in DMA, started
+ *		straight from the interrupt handler when @job completes
+ * @next_ready:	Indicates whether @next holds a prepared request
+ * @sg_src:	Entry of @job's source list currently in DMA
+ * @sg_dst:	Entry of @job's destination list currently in DMA
+ * @src_left:	Bytes of @job's source not yet handed to DMA
+ * @dst_left:	Bytes of @job's destination not yet handed to DMA
+ * @aead_aes_done: Cipher output of an AEAD @job has been transferred
+ * @aead_hash_done: Hash engine finished the inner digest of an AEAD @job
+ * @aead_hash_refs: AEAD jobs in @job and @next, which own the hash engine
  * @tasklet:	New request scheduling jib
  * @queue:	Crypto queue
  * @busy:	Indicates whether the device is currently handling some request
  *		thus it uses some of the fields from this state, like:
- *		req, ctx, sg_src/dst (and copies).  This essentially
- *		protects against concurrent access to these fields.
+ *		job, sg_src/dst.  This essentially protects against
+ *		concurrent access to these fields.
  * @lock:	Lock for protecting both access to device hardware registers
  *		and fields related to current request (including the busy field).
  * @res:	Resources for hash.
@@ -295,6 +386,9 @@ struct s5p_aes_ctx {
  * @hash_req:	Current request sending to SSS HASH block.
  * @hash_sg_iter: Scatterlist transferred through DMA into SSS HASH block.
  * @hash_sg_cnt: Counter for hash_sg_iter.
+ * @hash_sw_threshold: One-shot digests shorter than this go to the fallback
+ * @hash_hw_reqs: HASH requests run by the SSS block
+ * @hash_sw_reqs: HASH requests run by the software fallback
  *
  * @use_hash:	true if HASH algs enabled
  */
@@ -306,13 +400,16 @@ struct s5p_aes_dev {
 	void __iomem			*aes_ioaddr;
 	int				irq_fc;
 
-	struct skcipher_request		*req;
-	struct s5p_aes_ctx		*ctx;
+	struct s5p_aes_job		job;
+	struct s5p_aes_job		next;
+	bool				next_ready;
 	struct scatterlist		*sg_src;
 	struct scatterlist		*sg_dst;
-
-	struct scatterlist		*sg_src_cpy;
-	struct scatterlist		*sg_dst_cpy;
+	unsigned int			src_left;
+	unsigned int			dst_left;
+	bool				aead_aes_done;
+	bool				aead_hash_done;
+	int				aead_hash_refs;
 
 	struct tasklet_struct		tasklet;
 	struct crypto_queue		queue;
@@ -332,6 +429,10 @@ struct s5p_aes_dev {
 	struct scatterlist		*hash_sg_iter;
 	unsigned int			hash_sg_cnt;
 
+	unsigned int			hash_sw_threshold;
+	atomic_long_t			hash_hw_reqs;
+	atomic_long_t			hash_sw_reqs;
+
 	bool				use_hash;
 };
 
@@ -437,25 +538,42 @@ static struct s5p_aes_dev *s5p_dev;
 static void s5p_set_dma_indata(struct s5p_aes_dev *dev,
 			       const struct scatterlist *sg)
 {
+	unsigned int len = min(sg_dma_len(sg), dev->src_left);
+
+	dev->src_left -= len;
 	SSS_WRITE(dev, FCBRDMAS, sg_dma_address(sg));
-	SSS_WRITE(dev, FCBRDMAL, sg_dma_len(sg));
+	SSS_WRITE(dev, FCBRDMAL, len);
 }
 
 static void s5p_set_dma_outdata(struct s5p_aes_dev *dev,
 				const struct scatterlist *sg)
 {
+	unsigned int len = min(sg_dma_len(sg), dev->dst_left);
+
+	dev->dst_left -= len;
 	SSS_WRITE(dev, FCBTDMAS, sg_dma_address(sg));
-	SSS_WRITE(dev, FCBTDMAL, sg_dma_len(sg));
+	SSS_WRITE(dev, FCBTDMAL, len);
+}
+
+static inline u32 s5p_hash_read(struct s5p_aes_dev *dd, u32 offset)
+{
+	return __raw_readl(dd->io_hash_base + offset);
+}
+
+static inline void s5p_hash_write(struct s5p_aes_dev *dd,
+				  u32 offset, u32 value)
+{
+	__raw_writel(value, dd->io_hash_base + offset);
 }
 
-static void s5p_free_sg_cpy(struct s5p_aes_dev *dev, struct scatterlist **sg)
+static void s5p_free_sg_cpy(struct s5p_aes_job *job, struct scatterlist **sg)
 {
 	int len;
 
 	if (!*sg)
 		return;
 
-	len = ALIGN(dev->req->cryptlen, AES_BLOCK_SIZE);
+	len = ALIGN(job->cryptlen, AES_BLOCK_SIZE);
 	free_pages((unsigned long)sg_virt(*sg), get_order(len));
 
 	kfree(*sg);
@@ -475,45 +593,65 @@ static void s5p_sg_copy_buf(void *buf, struct scatterlist *sg,
 	scatterwalk_done(&walk, out, 0);
 }
 
-static void s5p_sg_done(struct s5p_aes_dev *dev)
+/* Copies back bounced output and frees the copies. No device access. */
+static void s5p_sg_done(struct s5p_aes_dev *dev, struct s5p_aes_job *job)
 {
-	struct skcipher_request *req = dev->req;
-	struct s5p_aes_reqctx *reqctx = skcipher_request_ctx(req);
-
-	if (dev->sg_dst_cpy) {
+	if (job->dst_cpy) {
 		dev_dbg(dev->dev,
 			"Copying %d bytes of output data back to original place\n",
-			dev->req->cryptlen);
-		s5p_sg_copy_buf(sg_virt(dev->sg_dst_cpy), dev->req->dst,
-				dev->req->cryptlen, 1);
+			job->cryptlen);
+		s5p_sg_copy_buf(sg_virt(job->dst_cpy), job->req_dst,
+				job->cryptlen, 1);
 	}
-	s5p_free_sg_cpy(dev, &dev->sg_src_cpy);
-	s5p_free_sg_cpy(dev, &dev->sg_dst_cpy);
-	if (reqctx->mode & FLAGS_AES_CBC)
-		memcpy_fromio(req->iv, dev->aes_ioaddr + SSS_REG_AES_IV_DATA(0), AES_BLOCK_SIZE);
-
-	else if (reqctx->mode & FLAGS_AES_CTR)
-		memcpy_fromio(req->iv, dev->aes_ioaddr + SSS_REG_AES_CNT_DATA(0), AES_BLOCK_SIZE);
+	s5p_free_sg_cpy(job, &job->src_cpy);
+	s5p_free_sg_cpy(job, &job->dst_cpy);
+	kfree(job->assoc);
 }
 
-/* Calls the completion. Cannot be called with dev->lock hold. */
-static void s5p_aes_complete(struct skcipher_request *req, int err)
+/*
+ * Unmaps a finished job and reads back the chaining value and, for AEAD,
+ * the inner digest. Must be called with dev->lock held, before another job
+ * reprograms the AES and HASH blocks.
+ */
+static void s5p_aes_job_finish(struct s5p_aes_dev *dev,
+			       struct s5p_aes_job *job)
 {
-	req->base.complete(&req->base, err);
-}
+	unsigned long mode = job->reqctx->mode;
 
-static void s5p_unset_outdata(struct s5p_aes_dev *dev)
-{
-	dma_unmap_sg(dev->dev, dev->sg_dst, 1, DMA_FROM_DEVICE);
+	dma_unmap_sg(dev->dev, job->src, job->src_nents, DMA_TO_DEVICE);
+	dma_unmap_sg(dev->dev, job->dst, job->dst_nents, DMA_FROM_DEVICE);
+
+	if (mode & FLAGS_AES_CBC)
+		memcpy_fromio(job->req_iv, dev->aes_ioaddr + SSS_REG_AES_IV_DATA(0), AES_BLOCK_SIZE);
+
+	else if (mode & FLAGS_AES_CTR)
+		memcpy_fromio(job->req_iv, dev->aes_ioaddr + SSS_REG_AES_CNT_DATA(0), AES_BLOCK_SIZE);
+
+	if (job->aead) {
+		struct s5p_aead_reqctx *rctx;
+		u32 *hash;
+		int i;
+
+		rctx = container_of(job->reqctx, struct s5p_aead_reqctx, aes);
+		hash = (u32 *)rctx->icv;
+
+		if (job->assoclen)
+			dma_unmap_single(dev->dev, job->assoc_dma,
+					 job->assoclen, DMA_TO_DEVICE);
+
+		for (i = 0; i < HASH_SHA256_MAX_REG; i++)
+			hash[i] = s5p_hash_read(dev, SSS_REG_HASH_OUT(i));
+	}
 }
 
-static void s5p_unset_indata(struct s5p_aes_dev *dev)
+/* Calls the completion. Cannot be called with dev->lock hold. */
+static void s5p_aes_complete(struct crypto_async_request *areq, int err)
 {
-	dma_unmap_sg(dev->dev, dev->sg_src, 1, DMA_TO_DEVICE);
+	areq->complete(areq, err);
 }
 
-static int s5p_make_sg_cpy(struct s5p_aes_dev *dev, struct scatterlist *src,
-			   struct scatterlist **dst)
+static int s5p_make_sg_cpy(struct s5p_aes_job *job,
+			   struct scatterlist *src, struct scatterlist **dst)
 {
 	void *pages;
 	int len;
@@ -522,7 +660,7 @@ static int s5p_make_sg_cpy(struct s5p_aes_dev *dev, struct scatterlist *src,
 	if (!*dst)
 		return -ENOMEM;
 
-	len = ALIGN(dev->req->cryptlen, AES_BLOCK_SIZE);
+	len = ALIGN(job->cryptlen, AES_BLOCK_SIZE);
 	pages = (void *)__get_free_pages(GFP_ATOMIC, get_order(len));
 	if (!pages) {
 		kfree(*dst);
@@ -530,7 +668,7 @@ static int s5p_make_sg_cpy(struct s5p_aes_dev *dev, struct scatterlist *src,
 		return -ENOMEM;
 	}
 
-	s5p_sg_copy_buf(pages, src, dev->req->cryptlen, 0);
+	s5p_sg_copy_buf(pages, src, job->cryptlen, 0);
 
 	sg_init_table(*dst, 1);
 	sg_set_buf(*dst, pages, len);
@@ -538,85 +676,357 @@ static int s5p_make_sg_cpy(struct s5p_aes_dev *dev, struct scatterlist *src,
 	return 0;
 }
 
-static int s5p_set_outdata(struct s5p_aes_dev *dev, struct scatterlist *sg)
+/*
+ * Maps the entries covering @len bytes at once, so that the interrupt
+ * handler only has to walk the DMA segments instead of mapping every entry.
+ */
+static int s5p_aes_map_sg(struct s5p_aes_dev *dev, struct scatterlist *sg,
+			  unsigned int len, int *nents,
+			  enum dma_data_direction dir)
 {
-	if (!sg->length)
-		return -EINVAL;
+	struct scatterlist *s;
+	int i;
 
-	if (!dma_map_sg(dev->dev, sg, 1, DMA_FROM_DEVICE))
-		return -ENOMEM;
+	*nents = sg_nents_for_len(sg, len);
+	if (*nents < 0)
+		return *nents;
 
-	dev->sg_dst = sg;
+	for_each_sg(sg, s, *nents, i) {
+		if (!s->length)
+			return -EINVAL;
+	}
+
+	if (!dma_map_sg(dev->dev, sg, *nents, dir))
+		return -ENOMEM;
 
 	return 0;
 }
 
-static int s5p_set_indata(struct s5p_aes_dev *dev, struct scatterlist *sg)
+static void s5p_set_aes(struct s5p_aes_dev *dev,
+			const u8 *key, const u8 *iv, const u8 *ctr,
+			unsigned int keylen)
 {
-	if (!sg->length)
-		return -EINVAL;
+	void __iomem *keystart;
 
-	if (!dma_map_sg(dev->dev, sg, 1, DMA_TO_DEVICE))
-		return -ENOMEM;
+	if (iv)
+		memcpy_toio(dev->aes_ioaddr + SSS_REG_AES_IV_DATA(0), iv,
+			    AES_BLOCK_SIZE);
 
-	dev->sg_src = sg;
+	if (ctr)
+		memcpy_toio(dev->aes_ioaddr + SSS_REG_AES_CNT_DATA(0), ctr,
+			    AES_BLOCK_SIZE);
 
-	return 0;
+	if (keylen == AES_KEYSIZE_256)
+		keystart = dev->aes_ioaddr + SSS_REG_AES_KEY_DATA(0);
+	else if (keylen == AES_KEYSIZE_192)
+		keystart = dev->aes_ioaddr + SSS_REG_AES_KEY_DATA(2);
+	else
+		keystart = dev->aes_ioaddr + SSS_REG_AES_KEY_DATA(4);
+
+	memcpy_toio(keystart, key, keylen);
+}
+
+/* Checks the entries covering the first @len bytes of @sg */
+static bool s5p_is_sg_aligned(struct scatterlist *sg, unsigned int len)
+{
+	while (sg && len) {
+		unsigned int n = min(sg->length, len);
+
+		if (!IS_ALIGNED(n, AES_BLOCK_SIZE))
+			return false;
+		len -= n;
+		sg = sg_next(sg);
+	}
+
+	return true;
 }
 
 /*
- * Returns -ERRNO on error (mapping of new data failed).
- * On success returns:
- *  - 0 if there is no more data,
- *  - 1 if new transmitting (output) data is ready and its address+length
- *     have to be written to device (by calling s5p_set_dma_outdata()).
+ * Builds the AES part of a job whose request, context and cipher data
+ * have been filled in by the caller.
  */
-static int s5p_aes_tx(struct s5p_aes_dev *dev)
+static int s5p_aes_job_prepare(struct s5p_aes_dev *dev,
+			       struct s5p_aes_job *job)
 {
-	int ret = 0;
+	unsigned long mode = job->reqctx->mode;
+	unsigned int len = ALIGN(job->cryptlen, AES_BLOCK_SIZE);
+	struct scatterlist *sg;
+	u32 aes_control;
+	int err;
 
-	s5p_unset_outdata(dev);
+	/* This sets bit [13:12] to 00, which selects 128-bit counter */
+	aes_control = SSS_AES_KEY_CHANGE_MODE;
+	if (mode & FLAGS_AES_DECRYPT)
+		aes_control |= SSS_AES_MODE_DECRYPT;
 
-	if (!sg_is_last(dev->sg_dst)) {
-		ret = s5p_set_outdata(dev, sg_next(dev->sg_dst));
-		if (!ret)
-			ret = 1;
+	if ((mode & FLAGS_AES_MODE_MASK) == FLAGS_AES_CBC) {
+		aes_control |= SSS_AES_CHAIN_MODE_CBC;
+		job->iv = job->req_iv;
+	} else if ((mode & FLAGS_AES_MODE_MASK) == FLAGS_AES_CTR) {
+		aes_control |= SSS_AES_CHAIN_MODE_CTR;
+		job->ctr = job->req_iv;
 	}
 
-	return ret;
+	if (job->ctx->keylen == AES_KEYSIZE_192)
+		aes_control |= SSS_AES_KEY_SIZE_192;
+	else if (job->ctx->keylen == AES_KEYSIZE_256)
+		aes_control |= SSS_AES_KEY_SIZE_256;
+
+	aes_control |= SSS_AES_FIFO_MODE;
+
+	/* as a variant it is possible to use byte swapping on DMA side */
+	aes_control |= SSS_AES_BYTESWAP_DI
+		    |  SSS_AES_BYTESWAP_DO
+		    |  SSS_AES_BYTESWAP_IV
+		    |  SSS_AES_BYTESWAP_KEY
+		    |  SSS_AES_BYTESWAP_CNT;
+	job->aes_control = aes_control;
+
+	sg = job->req_src;
+	if (!s5p_is_sg_aligned(sg, job->cryptlen)) {
+		dev_dbg(dev->dev,
+			"At least one unaligned source scatter list, making a copy\n");
+		err = s5p_make_sg_cpy(job, sg, &job->src_cpy);
+		if (err)
+			return err;
+
+		sg = job->src_cpy;
+	}
+
+	err = s5p_aes_map_sg(dev, sg, len, &job->src_nents, DMA_TO_DEVICE);
+	if (err)
+		goto src_error;
+	job->src = sg;
+
+	sg = job->req_dst;
+	if (!s5p_is_sg_aligned(sg, job->cryptlen)) {
+		dev_dbg(dev->dev,
+			"At least one unaligned dest scatter list, making a copy\n");
+		err = s5p_make_sg_cpy(job, sg, &job->dst_cpy);
+		if (err)
+			goto dst_error;
+
+		sg = job->dst_cpy;
+	}
+
+	err = s5p_aes_map_sg(dev, sg, len, &job->dst_nents, DMA_FROM_DEVICE);
+	if (err)
+		goto dst_error;
+	job->dst = sg;
+
+	return 0;
+
+dst_error:
+	dma_unmap_sg(dev->dev, job->src, job->src_nents, DMA_TO_DEVICE);
+src_error:
+	s5p_free_sg_cpy(job, &job->src_cpy);
+	s5p_free_sg_cpy(job, &job->dst_cpy);
+	return err;
+}
+
+static int s5p_skcipher_job_prepare(struct s5p_aes_dev *dev,
+				    struct s5p_aes_job *job,
+				    struct skcipher_request *req)
+{
+	memset(job, 0, sizeof(*job));
+	job->areq = &req->base;
+	job->ctx = crypto_tfm_ctx(req->base.tfm);
+	job->reqctx = skcipher_request_ctx(req);
+	job->req_src = req->src;
+	job->req_dst = req->dst;
+	job->req_iv = req->iv;
+	job->cryptlen = req->cryptlen;
+
+	return s5p_aes_job_prepare(dev, job);
 }
 
 /*
- * Returns -ERRNO on error (mapping of new data failed).
- * On success returns:
- *  - 0 if there is no more data,
- *  - 1 if new receiving (input) data is ready and its address+length
- *     have to be written to device (by calling s5p_set_dma_indata()).
+ * Sets up the hash engine for the HMAC inner hash of an AEAD job: SHA256
+ * resumed from the ipad state, over the associated data and the cipher
+ * data. Must be called with dev->lock held.
  */
-static int s5p_aes_rx(struct s5p_aes_dev *dev/*, bool *set_dma*/)
+static void s5p_aead_hash_start(struct s5p_aes_dev *dev,
+				struct s5p_aes_job *job)
+{
+	struct s5p_aead_ctx *actx = container_of(job->ctx, struct s5p_aead_ctx,
+						 aes);
+	u64 len = (u64)job->assoclen + job->cryptlen;
+	int i;
+
+	SSS_WRITE(dev, FCINTENCLR, SSS_FCINTENCLR_HRDMAINTENCLR |
+		  SSS_FCINTENCLR_HDONEINTENCLR | SSS_FCINTENCLR_HPARTINTENCLR);
+	SSS_WRITE(dev, FCHRDMAC, SSS_FCHRDMAC_FLUSH);
+	s5p_hash_write(dev, SSS_REG_HASH_CTRL_FIFO, SSS_HASH_FIFO_MODE_DMA);
+
+	for (i = 0; i < HASH_SHA256_MAX_REG; i++)
+		s5p_hash_write(dev, SSS_REG_HASH_IV(i), actx->ipad[i]);
+
+	s5p_hash_write(dev, SSS_REG_HASH_MSG_SIZE_LOW, lower_32_bits(len));
+	s5p_hash_write(dev, SSS_REG_HASH_MSG_SIZE_HIGH, upper_32_bits(len));
+	/* the ipad block has already been hashed */
+	s5p_hash_write(dev, SSS_REG_HASH_PRE_MSG_SIZE_LOW, HASH_BLOCK_SIZE * 8);
+	s5p_hash_write(dev, SSS_REG_HASH_PRE_MSG_SIZE_HIGH, 0);
+
+	s5p_hash_write(dev, SSS_REG_HASH_CTRL_SWAP,
+		       SSS_HASH_BYTESWAP_DI | SSS_HASH_BYTESWAP_DO |
+		       SSS_HASH_BYTESWAP_IV | SSS_HASH_BYTESWAP_KEY);
+	s5p_hash_write(dev, SSS_REG_HASH_CTRL, SSS_HASH_ENGINE_SHA256 |
+		       SSS_HASH_INIT_BIT | SSS_HASH_USER_IV_EN);
+
+	SSS_WRITE(dev, FCINTENSET, SSS_FCINTENSET_HRDMAINTENSET |
+		  SSS_FCINTENSET_HDONEINTENSET);
+}
+
+/* Starts the cipher DMA of the current job, must be called with dev->lock held */
+static void s5p_aes_dma_start(struct s5p_aes_dev *dev)
 {
-	int ret = 0;
+	s5p_set_dma_indata(dev,  dev->sg_src);
+	s5p_set_dma_outdata(dev, dev->sg_dst);
 
-	s5p_unset_indata(dev);
+	SSS_WRITE(dev, FCINTENSET,
+		  SSS_FCINTENSET_BTDMAINTENSET | SSS_FCINTENSET_BRDMAINTENSET);
+}
+
+/* Programs the AES block and starts DMA, must be called with dev->lock held */
+static void s5p_aes_job_start(struct s5p_aes_dev *dev, struct s5p_aes_job *job)
+{
+	struct s5p_aes_ctx *ctx = job->ctx;
 
-	if (!sg_is_last(dev->sg_src)) {
-		ret = s5p_set_indata(dev, sg_next(dev->sg_src));
-		if (!ret)
-			ret = 1;
+	SSS_WRITE(dev, FCINTENCLR,
+		  SSS_FCINTENCLR_BTDMAINTENCLR | SSS_FCINTENCLR_BRDMAINTENCLR);
+	SSS_WRITE(dev, FCFIFOCTRL, 0x00);
+
+	SSS_AES_WRITE(dev, AES_CONTROL, job->aes_control);
+	s5p_set_aes(dev, ctx->aes_key, job->iv, job->ctr, ctx->keylen);
+
+	dev->sg_src = job->src;
+	dev->sg_dst = job->dst;
+	dev->src_left = ALIGN(job->cryptlen, AES_BLOCK_SIZE);
+	dev->dst_left = dev->src_left;
+
+	if (job->aead) {
+		dev->aead_aes_done = false;
+		dev->aead_hash_done = false;
+		s5p_aead_hash_start(dev, job);
+
+		/*
+		 * The associated data goes to the hash engine on its own, the
+		 * interrupt handler then switches the hash input over to the
+		 * cipher and starts the cipher DMA.
+		 */
+		if (job->assoclen) {
+			SSS_WRITE(dev, FCHRDMAS, job->assoc_dma);
+			SSS_WRITE(dev, FCHRDMAL, job->assoclen);
+			return;
+		}
+
+		SSS_WRITE(dev, FCFIFOCTRL, job->hashflow);
 	}
 
-	return ret;
+	s5p_aes_dma_start(dev);
 }
 
-static inline u32 s5p_hash_read(struct s5p_aes_dev *dd, u32 offset)
+/*
+ * Returns true if the next destination segment is ready and its
+ * address+length have to be written to device (by calling
+ * s5p_set_dma_outdata()), false when the whole job has been transferred.
+ */
+static bool s5p_aes_tx(struct s5p_aes_dev *dev)
 {
-	return __raw_readl(dd->io_hash_base + offset);
+	if (!dev->dst_left)
+		return false;
+
+	dev->sg_dst = sg_next(dev->sg_dst);
+
+	return true;
 }
 
-static inline void s5p_hash_write(struct s5p_aes_dev *dd,
-				  u32 offset, u32 value)
+/*
+ * Returns true if the next source segment is ready and its address+length
+ * have to be written to device (by calling s5p_set_dma_indata()).
+ */
+static bool s5p_aes_rx(struct s5p_aes_dev *dev)
 {
-	__raw_writel(value, dd->io_hash_base + offset);
+	if (!dev->src_left)
+		return false;
+
+	dev->sg_src = sg_next(dev->sg_src);
+
+	return true;
+}
+
+/*
+ * AEAD jobs take the hash engine away from the ahash queue for as long as
+ * one of them sits in dev->job or dev->next. Lock order is hash_lock, then
+ * dev->lock, so neither can be called with dev->lock held.
+ */
+static bool s5p_aead_get_hash(struct s5p_aes_dev *dev)
+{
+	unsigned long flags;
+	bool owned = true;
+
+	spin_lock_irqsave(&dev->hash_lock, flags);
+	spin_lock(&dev->lock);
+	if (!dev->aead_hash_refs)
+		owned = !test_and_set_bit(HASH_FLAGS_BUSY, &dev->hash_flags);
+	if (owned)
+		dev->aead_hash_refs++;
+	spin_unlock(&dev->lock);
+	spin_unlock_irqrestore(&dev->hash_lock, flags);
+
+	return owned;
+}
+
+static void s5p_aead_put_hash(struct s5p_aes_dev *dev)
+{
+	unsigned long flags;
+	bool release;
+
+	spin_lock_irqsave(&dev->hash_lock, flags);
+	spin_lock(&dev->lock);
+	release = !--dev->aead_hash_refs;
+	if (release)
+		clear_bit(HASH_FLAGS_BUSY, &dev->hash_flags);
+	spin_unlock(&dev->lock);
+	spin_unlock_irqrestore(&dev->hash_lock, flags);
+
+	/* let the ahash requests queued meanwhile run */
+	if (release)
+		tasklet_schedule(&dev->hash_tasklet);
+}
+
+/*
+ * Finishes the HMAC from the inner digest read by s5p_aes_job_finish(),
+ * then stores or checks the ICV. No device access.
+ */
+static int s5p_aead_job_done(struct s5p_aes_job *job)
+{
+	struct aead_request *req = container_of(job->areq, struct aead_request,
+						base);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct s5p_aead_reqctx *rctx = aead_request_ctx(req);
+	struct s5p_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int offset = req->assoclen + job->cryptlen;
+	struct sha256_state state = ctx->opad;
+	u8 icv[SHA256_DIGEST_SIZE];
+	int err = 0;
+
+	sha256_update(&state, rctx->icv, SHA256_DIGEST_SIZE);
+	sha256_final(&state, rctx->icv);
+
+	if (rctx->aes.mode & FLAGS_AES_DECRYPT) {
+		scatterwalk_map_and_copy(icv, req->src, offset, authsize, 0);
+		if (crypto_memneq(icv, rctx->icv, authsize))
+			err = -EBADMSG;
+	} else {
+		scatterwalk_map_and_copy(rctx->icv, req->dst, offset,
+					 authsize, 1);
+	}
+
+	memzero_explicit(&state, sizeof(state));
+
+	return err;
 }
 
 /**
@@ -659,40 +1069,52 @@ static irqreturn_t s5p_aes_interrupt(int irq, void *dev_id)
 {
 	struct platform_device *pdev = dev_id;
 	struct s5p_aes_dev *dev = platform_get_drvdata(pdev);
-	struct skcipher_request *req;
-	int err_dma_tx = 0;
-	int err_dma_rx = 0;
+	struct s5p_aes_job done;
+	bool set_dma_tx = false;
+	bool set_dma_rx = false;
+	bool assoc_end = false;
+	bool job_end = false;
 	int err_dma_hx = 0;
 	bool tx_end = false;
 	bool hx_end = false;
 	unsigned long flags;
 	u32 status, st_bits;
-	int err;
+	bool aead;
+	int err = 0;
 
 	spin_lock_irqsave(&dev->lock, flags);
 
+	/* an AEAD job owns the hash engine, its interrupts are ours */
+	aead = dev->busy && dev->job.aead;
+
 	/*
 	 * Handle rx or tx interrupt. If there is still data (scatterlist did not
-	 * reach end), then map next scatterlist entry.
-	 * In case of such mapping error, s5p_aes_complete() should be called.
+	 * reach end), then move to the next mapped segment.
 	 *
-	 * If there is no more data in tx scatter list, call s5p_aes_complete()
-	 * and schedule new tasklet.
+	 * If there is no more data in tx scatter list, start the request
+	 * prepared meanwhile if any, call s5p_aes_complete() and schedule
+	 * new tasklet.
 	 *
 	 * Handle hx interrupt. If there is still data map next entry.
+	 *
+	 * An AEAD job is done once both the cipher output and the inner
+	 * digest are complete.
 	 */
 	status = SSS_READ(dev, FCINTSTAT);
 	if (status & SSS_FCINTSTAT_BRDMAINT)
-		err_dma_rx = s5p_aes_rx(dev);
+		set_dma_rx = s5p_aes_rx(dev);
 
 	if (status & SSS_FCINTSTAT_BTDMAINT) {
-		if (sg_is_last(dev->sg_dst))
-			tx_end = true;
-		err_dma_tx = s5p_aes_tx(dev);
+		set_dma_tx = s5p_aes_tx(dev);
+		tx_end = !set_dma_tx;
 	}
 
-	if (status & SSS_FCINTSTAT_HRDMAINT)
-		err_dma_hx = s5p_hash_rx(dev);
+	if (status & SSS_FCINTSTAT_HRDMAINT) {
+		if (aead)
+			assoc_end = true;
+		else
+			err_dma_hx = s5p_hash_rx(dev);
+	}
 
 	st_bits = status & (SSS_FCINTSTAT_BRDMAINT | SSS_FCINTSTAT_BTDMAINT |
 				SSS_FCINTSTAT_HRDMAINT);
@@ -708,31 +1130,48 @@ static irqreturn_t s5p_aes_interrupt(int irq, void *dev_id)
 		if (status & SSS_FCINTSTAT_HDONEINT)
 			st_bits = SSS_HASH_STATUS_MSG_DONE;
 
-		set_bit(HASH_FLAGS_OUTPUT_READY, &dev->hash_flags);
 		s5p_hash_write(dev, SSS_REG_HASH_STATUS, st_bits);
-		hx_end = true;
+		if (aead) {
+			dev->aead_hash_done = true;
+		} else {
+			set_bit(HASH_FLAGS_OUTPUT_READY, &dev->hash_flags);
+			hx_end = true;
+		}
 		/* when DONE or PART, do not handle HASH DMA */
 		err_dma_hx = 0;
 	}
 
-	if (err_dma_rx < 0) {
-		err = err_dma_rx;
-		goto error;
-	}
-	if (err_dma_tx < 0) {
-		err = err_dma_tx;
-		goto error;
+	if (aead) {
+		dev->aead_aes_done |= tx_end;
+		job_end = dev->aead_aes_done && dev->aead_hash_done;
+	} else {
+		job_end = tx_end && dev->busy;
 	}
 
-	if (tx_end) {
-		s5p_sg_done(dev);
+	if (job_end) {
+		done = dev->job;
+		s5p_aes_job_finish(dev, &done);
+
+		/* keep the engine busy with the request prepared meanwhile */
+		if (dev->next_ready) {
+			dev->job = dev->next;
+			dev->next_ready = false;
+			s5p_aes_job_start(dev, &dev->job);
+		} else {
+			dev->busy = false;
+		}
+
 		if (err_dma_hx == 1)
 			s5p_set_dma_hashdata(dev, dev->hash_sg_iter);
 
 		spin_unlock_irqrestore(&dev->lock, flags);
 
-		s5p_aes_complete(dev->req, 0);
-		/* Device is still busy */
+		s5p_sg_done(dev, &done);
+		if (done.aead) {
+			err = s5p_aead_job_done(&done);
+			s5p_aead_put_hash(dev);
+		}
+		s5p_aes_complete(done.areq, err);
 		tasklet_schedule(&dev->tasklet);
 	} else {
 		/*
@@ -741,29 +1180,20 @@ static irqreturn_t s5p_aes_interrupt(int irq, void *dev_id)
 		 * should be done at the end (even after clearing pending
 		 * interrupts to not miss the interrupt).
 		 */
-		if (err_dma_tx == 1)
+		if (set_dma_tx)
 			s5p_set_dma_outdata(dev, dev->sg_dst);
-		if (err_dma_rx == 1)
+		if (set_dma_rx)
 			s5p_set_dma_indata(dev, dev->sg_src);
 		if (err_dma_hx == 1)
 			s5p_set_dma_hashdata(dev, dev->hash_sg_iter);
+		if (assoc_end) {
+			SSS_WRITE(dev, FCFIFOCTRL, dev->job.hashflow);
+			s5p_aes_dma_start(dev);
+		}
 
 		spin_unlock_irqrestore(&dev->lock, flags);
 	}
 
-	goto hash_irq_end;
-
-error:
-	s5p_sg_done(dev);
-	dev->busy = false;
-	req = dev->req;
-	if (err_dma_hx == 1)
-		s5p_set_dma_hashdata(dev, dev->hash_sg_iter);
-
-	spin_unlock_irqrestore(&dev->lock, flags);
-	s5p_aes_complete(req, err);
-
-hash_irq_end:
 	/*
 	 * Note about else if:
 	 *   when hash_sg_iter reaches end and its UPDATE op,
@@ -1402,6 +1832,7 @@ static int s5p_hash_handle_queue(struct s5p_aes_dev *dd,
 	req = ahash_request_cast(async_req);
 	dd->hash_req = req;
 	ctx = ahash_request_ctx(req);
+	atomic_long_inc(&dd->hash_hw_reqs);
 
 	err = s5p_hash_prepare_request(req, ctx->op_update);
 	if (err || !ctx->total)
@@ -1553,6 +1984,7 @@ static int s5p_hash_final(struct ahash_request *req)
 	if (!ctx->digcnt && ctx->bufcnt < BUFLEN) {
 		struct s5p_hash_ctx *tctx = crypto_tfm_ctx(req->base.tfm);
 
+		atomic_long_inc(&ctx->dd->hash_sw_reqs);
 		return crypto_shash_tfm_digest(tctx->fallback, ctx->buffer,
 					       ctx->bufcnt, req->result);
 	}
@@ -1560,6 +1992,29 @@ static int s5p_hash_final(struct ahash_request *req)
 	return s5p_hash_enqueue(req, false); /* HASH_OP_FINAL */
 }
 
+/**
+ * s5p_hash_sw_digest() - calculate digest of req->src in software
+ * @req:	AHASH request
+ *
+ * Used for the whole request when no data has been hashed or buffered yet
+ * and req->nbytes is below the hash_sw_threshold of the device.
+ */
+static int s5p_hash_sw_digest(struct ahash_request *req)
+{
+	struct s5p_hash_reqctx *ctx = ahash_request_ctx(req);
+	struct s5p_hash_ctx *tctx = crypto_tfm_ctx(req->base.tfm);
+	SHASH_DESC_ON_STACK(shash, tctx->fallback);
+	int err;
+
+	shash->tfm = tctx->fallback;
+	err = shash_ahash_digest(req, shash);
+	shash_desc_zero(shash);
+
+	atomic_long_inc(&ctx->dd->hash_sw_reqs);
+
+	return err;
+}
+
 /**
  * s5p_hash_finup() - process last req->src and calculate digest
  * @req:	AHASH request containing the last update data
@@ -1573,6 +2028,10 @@ static int s5p_hash_finup(struct ahash_request *req)
 
 	ctx->finup = true;
 
+	if (!ctx->digcnt && !ctx->bufcnt && !ctx->error &&
+	    req->nbytes < READ_ONCE(ctx->dd->hash_sw_threshold))
+		return s5p_hash_sw_digest(req);
+
 	err1 = s5p_hash_update(req);
 	if (err1 == -EINPROGRESS || err1 == -EBUSY)
 		return err1;
@@ -1806,217 +2265,171 @@ static struct ahash_alg algs_sha1_md5_sha256[] = {
 
 };
 
-static void s5p_set_aes(struct s5p_aes_dev *dev,
-			const u8 *key, const u8 *iv, const u8 *ctr,
-			unsigned int keylen)
-{
-	void __iomem *keystart;
-
-	if (iv)
-		memcpy_toio(dev->aes_ioaddr + SSS_REG_AES_IV_DATA(0), iv,
-			    AES_BLOCK_SIZE);
-
-	if (ctr)
-		memcpy_toio(dev->aes_ioaddr + SSS_REG_AES_CNT_DATA(0), ctr,
-			    AES_BLOCK_SIZE);
-
-	if (keylen == AES_KEYSIZE_256)
-		keystart = dev->aes_ioaddr + SSS_REG_AES_KEY_DATA(0);
-	else if (keylen == AES_KEYSIZE_192)
-		keystart = dev->aes_ioaddr + SSS_REG_AES_KEY_DATA(2);
-	else
-		keystart = dev->aes_ioaddr + SSS_REG_AES_KEY_DATA(4);
-
-	memcpy_toio(keystart, key, keylen);
-}
-
-static bool s5p_is_sg_aligned(struct scatterlist *sg)
+static int s5p_aead_fallback(struct aead_request *req, u32 flags)
 {
-	while (sg) {
-		if (!IS_ALIGNED(sg->length, AES_BLOCK_SIZE))
-			return false;
-		sg = sg_next(sg);
-	}
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct s5p_aead_reqctx *rctx = aead_request_ctx(req);
+	struct s5p_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	struct aead_request *subreq = &rctx->fallback_req;
 
-	return true;
-}
+	aead_request_set_tfm(subreq, ctx->fallback);
+	aead_request_set_callback(subreq, flags, req->base.complete,
+				  req->base.data);
+	aead_request_set_crypt(subreq, req->src, req->dst, req->cryptlen,
+			       req->iv);
+	aead_request_set_ad(subreq, req->assoclen);
 
-static int s5p_set_indata_start(struct s5p_aes_dev *dev,
-				struct skcipher_request *req)
-{
-	struct scatterlist *sg;
-	int err;
+	if (rctx->aes.mode & FLAGS_AES_DECRYPT)
+		return crypto_aead_decrypt(subreq);
 
-	dev->sg_src_cpy = NULL;
-	sg = req->src;
-	if (!s5p_is_sg_aligned(sg)) {
-		dev_dbg(dev->dev,
-			"At least one unaligned source scatter list, making a copy\n");
-		err = s5p_make_sg_cpy(dev, sg, &dev->sg_src_cpy);
-		if (err)
-			return err;
-
-		sg = dev->sg_src_cpy;
-	}
-
-	err = s5p_set_indata(dev, sg);
-	if (err) {
-		s5p_free_sg_cpy(dev, &dev->sg_src_cpy);
-		return err;
-	}
-
-	return 0;
+	return crypto_aead_encrypt(subreq);
 }
 
-static int s5p_set_outdata_start(struct s5p_aes_dev *dev,
-				 struct skcipher_request *req)
+static int s5p_aead_job_prepare(struct s5p_aes_dev *dev,
+				struct s5p_aes_job *job,
+				struct aead_request *req)
 {
-	struct scatterlist *sg;
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct s5p_aead_reqctx *rctx = aead_request_ctx(req);
+	struct s5p_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	bool decrypt = rctx->aes.mode & FLAGS_AES_DECRYPT;
 	int err;
 
-	dev->sg_dst_cpy = NULL;
-	sg = req->dst;
-	if (!s5p_is_sg_aligned(sg)) {
-		dev_dbg(dev->dev,
-			"At least one unaligned dest scatter list, making a copy\n");
-		err = s5p_make_sg_cpy(dev, sg, &dev->sg_dst_cpy);
-		if (err)
-			return err;
-
-		sg = dev->sg_dst_cpy;
+	if (!s5p_aead_get_hash(dev)) {
+		/* an ahash request owns the hash engine, don't wait for it */
+		err = s5p_aead_fallback(req, req->base.flags &
+					     ~CRYPTO_TFM_REQ_MAY_SLEEP);
+		if (err != -EINPROGRESS && err != -EBUSY)
+			s5p_aes_complete(&req->base, err);
+		return -EINPROGRESS;
 	}
 
-	err = s5p_set_outdata(dev, sg);
-	if (err) {
-		s5p_free_sg_cpy(dev, &dev->sg_dst_cpy);
-		return err;
-	}
-
-	return 0;
-}
-
-static void s5p_aes_crypt_start(struct s5p_aes_dev *dev, unsigned long mode)
-{
-	struct skcipher_request *req = dev->req;
-	u32 aes_control;
-	unsigned long flags;
-	int err;
-	u8 *iv, *ctr;
-
-	/* This sets bit [13:12] to 00, which selects 128-bit counter */
-	aes_control = SSS_AES_KEY_CHANGE_MODE;
-	if (mode & FLAGS_AES_DECRYPT)
-		aes_control |= SSS_AES_MODE_DECRYPT;
-
-	if ((mode & FLAGS_AES_MODE_MASK) == FLAGS_AES_CBC) {
-		aes_control |= SSS_AES_CHAIN_MODE_CBC;
-		iv = req->iv;
-		ctr = NULL;
-	} else if ((mode & FLAGS_AES_MODE_MASK) == FLAGS_AES_CTR) {
-		aes_control |= SSS_AES_CHAIN_MODE_CTR;
-		iv = NULL;
-		ctr = req->iv;
+	memset(job, 0, sizeof(*job));
+	job->areq = &req->base;
+	job->ctx = &ctx->aes;
+	job->reqctx = &rctx->aes;
+	job->req_src = scatterwalk_ffwd(rctx->src, req->src, req->assoclen);
+	job->req_dst = scatterwalk_ffwd(rctx->dst, req->dst, req->assoclen);
+	job->req_iv = req->iv;
+	job->cryptlen = req->cryptlen;
+	job->aead = true;
+	job->assoclen = req->assoclen;
+
+	if (decrypt) {
+		job->cryptlen -= crypto_aead_authsize(tfm);
+		job->hashflow = SSS_HASHIN_CIPHER_INPUT;
 	} else {
-		iv = NULL; /* AES_ECB */
-		ctr = NULL;
+		job->hashflow = SSS_HASHIN_CIPHER_OUTPUT;
 	}
 
-	if (dev->ctx->keylen == AES_KEYSIZE_192)
-		aes_control |= SSS_AES_KEY_SIZE_192;
-	else if (dev->ctx->keylen == AES_KEYSIZE_256)
-		aes_control |= SSS_AES_KEY_SIZE_256;
-
-	aes_control |= SSS_AES_FIFO_MODE;
-
-	/* as a variant it is possible to use byte swapping on DMA side */
-	aes_control |= SSS_AES_BYTESWAP_DI
-		    |  SSS_AES_BYTESWAP_DO
-		    |  SSS_AES_BYTESWAP_IV
-		    |  SSS_AES_BYTESWAP_KEY
-		    |  SSS_AES_BYTESWAP_CNT;
-
-	spin_lock_irqsave(&dev->lock, flags);
-
-	SSS_WRITE(dev, FCINTENCLR,
-		  SSS_FCINTENCLR_BTDMAINTENCLR | SSS_FCINTENCLR_BRDMAINTENCLR);
-	SSS_WRITE(dev, FCFIFOCTRL, 0x00);
+	if (job->assoclen) {
+		job->assoc = kmalloc(job->assoclen, GFP_ATOMIC);
+		if (!job->assoc) {
+			err = -ENOMEM;
+			goto err_put;
+		}
 
-	err = s5p_set_indata_start(dev, req);
-	if (err)
-		goto indata_error;
+		scatterwalk_map_and_copy(job->assoc, req->src, 0,
+					 job->assoclen, 0);
+		if (req->src != req->dst)
+			scatterwalk_map_and_copy(job->assoc, req->dst, 0,
+						 job->assoclen, 1);
+
+		job->assoc_dma = dma_map_single(dev->dev, job->assoc,
+						job->assoclen, DMA_TO_DEVICE);
+		if (dma_mapping_error(dev->dev, job->assoc_dma)) {
+			err = -ENOMEM;
+			goto err_free;
+		}
+	}
 
-	err = s5p_set_outdata_start(dev, req);
+	err = s5p_aes_job_prepare(dev, job);
 	if (err)
-		goto outdata_error;
-
-	SSS_AES_WRITE(dev, AES_CONTROL, aes_control);
-	s5p_set_aes(dev, dev->ctx->aes_key, iv, ctr, dev->ctx->keylen);
-
-	s5p_set_dma_indata(dev,  dev->sg_src);
-	s5p_set_dma_outdata(dev, dev->sg_dst);
-
-	SSS_WRITE(dev, FCINTENSET,
-		  SSS_FCINTENSET_BTDMAINTENSET | SSS_FCINTENSET_BRDMAINTENSET);
-
-	spin_unlock_irqrestore(&dev->lock, flags);
+		goto err_unmap;
 
-	return;
-
-outdata_error:
-	s5p_unset_indata(dev);
+	return 0;
 
-indata_error:
-	s5p_sg_done(dev);
-	dev->busy = false;
-	spin_unlock_irqrestore(&dev->lock, flags);
-	s5p_aes_complete(req, err);
+err_unmap:
+	if (job->assoclen)
+		dma_unmap_single(dev->dev, job->assoc_dma, job->assoclen,
+				 DMA_TO_DEVICE);
+err_free:
+	kfree(job->assoc);
+err_put:
+	s5p_aead_put_hash(dev);
+	return err;
 }
 
+/*
+ * Prepares queued requests (bounce copies and DMA mapping) outside of the
+ * device lock: the first one is started right away when the device is
+ * idle, the next one is parked in dev->next while the device is busy.
+ */
 static void s5p_tasklet_cb(unsigned long data)
 {
 	struct s5p_aes_dev *dev = (struct s5p_aes_dev *)data;
 	struct crypto_async_request *async_req, *backlog;
-	struct s5p_aes_reqctx *reqctx;
+	struct s5p_aes_job job;
 	unsigned long flags;
+	int err;
 
-	spin_lock_irqsave(&dev->lock, flags);
-	backlog   = crypto_get_backlog(&dev->queue);
-	async_req = crypto_dequeue_request(&dev->queue);
-
-	if (!async_req) {
-		dev->busy = false;
+	for (;;) {
+		spin_lock_irqsave(&dev->lock, flags);
+		if (dev->next_ready) {
+			spin_unlock_irqrestore(&dev->lock, flags);
+			return;
+		}
+		backlog   = crypto_get_backlog(&dev->queue);
+		async_req = crypto_dequeue_request(&dev->queue);
 		spin_unlock_irqrestore(&dev->lock, flags);
-		return;
-	}
-	spin_unlock_irqrestore(&dev->lock, flags);
 
-	if (backlog)
-		backlog->complete(backlog, -EINPROGRESS);
+		if (!async_req)
+			return;
+
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
 
-	dev->req = skcipher_request_cast(async_req);
-	dev->ctx = crypto_tfm_ctx(dev->req->base.tfm);
-	reqctx   = skcipher_request_ctx(dev->req);
+		if (crypto_tfm_alg_type(async_req->tfm) == CRYPTO_ALG_TYPE_AEAD)
+			err = s5p_aead_job_prepare(dev, &job,
+						   aead_request_cast(async_req));
+		else
+			err = s5p_skcipher_job_prepare(dev, &job,
+						       skcipher_request_cast(async_req));
+		if (err) {
+			/* -EINPROGRESS: handed over to the software fallback */
+			if (err != -EINPROGRESS)
+				s5p_aes_complete(async_req, err);
+			continue;
+		}
 
-	s5p_aes_crypt_start(dev, reqctx->mode);
+		spin_lock_irqsave(&dev->lock, flags);
+		if (dev->busy) {
+			dev->next = job;
+			dev->next_ready = true;
+		} else {
+			dev->job = job;
+			dev->busy = true;
+			s5p_aes_job_start(dev, &dev->job);
+		}
+		spin_unlock_irqrestore(&dev->lock, flags);
+	}
 }
 
 static int s5p_aes_handle_req(struct s5p_aes_dev *dev,
-			      struct skcipher_request *req)
+			      struct crypto_async_request *req)
 {
 	unsigned long flags;
+	bool kick;
 	int err;
 
 	spin_lock_irqsave(&dev->lock, flags);
-	err = crypto_enqueue_request(&dev->queue, &req->base);
-	if (dev->busy) {
-		spin_unlock_irqrestore(&dev->lock, flags);
-		return err;
-	}
-	dev->busy = true;
-
+	err = crypto_enqueue_request(&dev->queue, req);
+	/* with a request parked, the interrupt handler kicks the tasklet */
+	kick = !dev->next_ready;
 	spin_unlock_irqrestore(&dev->lock, flags);
 
-	tasklet_schedule(&dev->tasklet);
+	if (kick)
+		tasklet_schedule(&dev->tasklet);
 
 	return err;
 }
@@ -2039,7 +2452,7 @@ static int s5p_aes_crypt(struct skcipher_request *req, unsigned long mode)
 
 	reqctx->mode = mode;
 
-	return s5p_aes_handle_req(dev, req);
+	return s5p_aes_handle_req(dev, &req->base);
 }
 
 static int s5p_aes_setkey(struct crypto_skcipher *cipher,
@@ -2153,6 +2566,219 @@ static struct skcipher_alg algs[] = {
 	},
 };
 
+static int s5p_aead_crypt(struct aead_request *req, unsigned long mode)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct s5p_aead_reqctx *rctx = aead_request_ctx(req);
+	struct s5p_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int cryptlen = req->cryptlen;
+
+	if (mode & FLAGS_AES_DECRYPT) {
+		if (cryptlen < authsize)
+			return -EINVAL;
+		cryptlen -= authsize;
+	}
+
+	if (!IS_ALIGNED(cryptlen, AES_BLOCK_SIZE))
+		return -EINVAL;
+
+	rctx->aes.mode = mode;
+
+	/*
+	 * The hash DMA only takes whole words ahead of the cipher data, and
+	 * there is nothing to win for zero-length cipher data.
+	 */
+	if (!cryptlen || !IS_ALIGNED(req->assoclen, SSS_HASH_DMA_LEN_ALIGN))
+		return s5p_aead_fallback(req, req->base.flags);
+
+	return s5p_aes_handle_req(ctx->aes.dev, &req->base);
+}
+
+static int s5p_aead_encrypt(struct aead_request *req)
+{
+	return s5p_aead_crypt(req, FLAGS_AES_CBC);
+}
+
+static int s5p_aead_decrypt(struct aead_request *req)
+{
+	return s5p_aead_crypt(req, FLAGS_AES_DECRYPT | FLAGS_AES_CBC);
+}
+
+static int s5p_aead_setkey(struct crypto_aead *tfm, const u8 *key,
+			   unsigned int keylen)
+{
+	struct s5p_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	struct crypto_authenc_keys keys;
+	struct sha256_state state;
+	u8 pad[HASH_BLOCK_SIZE];
+	int i, err;
+
+	err = crypto_authenc_extractkeys(&keys, key, keylen);
+	if (err)
+		goto out;
+
+	err = -EINVAL;
+	if (keys.enckeylen != AES_KEYSIZE_128 &&
+	    keys.enckeylen != AES_KEYSIZE_192 &&
+	    keys.enckeylen != AES_KEYSIZE_256)
+		goto out;
+
+	memset(pad, 0, sizeof(pad));
+	if (keys.authkeylen > HASH_BLOCK_SIZE)
+		sha256(keys.authkey, keys.authkeylen, pad);
+	else
+		memcpy(pad, keys.authkey, keys.authkeylen);
+
+	/* precompute the states after the ipad and opad blocks */
+	for (i = 0; i < HASH_BLOCK_SIZE; i++)
+		pad[i] ^= HMAC_IPAD_VALUE;
+	sha256_init(&state);
+	sha256_update(&state, pad, HASH_BLOCK_SIZE);
+	for (i = 0; i < HASH_SHA256_MAX_REG; i++)
+		ctx->ipad[i] = (__force u32)cpu_to_be32(state.state[i]);
+
+	for (i = 0; i < HASH_BLOCK_SIZE; i++)
+		pad[i] ^= HMAC_IPAD_VALUE ^ HMAC_OPAD_VALUE;
+	sha256_init(&ctx->opad);
+	sha256_update(&ctx->opad, pad, HASH_BLOCK_SIZE);
+
+	memcpy(ctx->aes.aes_key, keys.enckey, keys.enckeylen);
+	ctx->aes.keylen = keys.enckeylen;
+
+	crypto_aead_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_aead_set_flags(ctx->fallback, crypto_aead_get_flags(tfm) &
+					     CRYPTO_TFM_REQ_MASK);
+	err = crypto_aead_setkey(ctx->fallback, key, keylen);
+
+out:
+	memzero_explicit(&keys, sizeof(keys));
+	memzero_explicit(&state, sizeof(state));
+	memzero_explicit(pad, sizeof(pad));
+
+	return err;
+}
+
+static int s5p_aead_setauthsize(struct crypto_aead *tfm,
+				unsigned int authsize)
+{
+	struct s5p_aead_ctx *ctx = crypto_aead_ctx(tfm);
+
+	return crypto_aead_setauthsize(ctx->fallback, authsize);
+}
+
+static int s5p_aead_init_tfm(struct crypto_aead *tfm)
+{
+	struct s5p_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	const char *alg_name = crypto_tfm_alg_name(crypto_aead_tfm(tfm));
+
+	ctx->aes.dev = s5p_dev;
+	ctx->fallback = crypto_alloc_aead(alg_name, 0,
+					  CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback)) {
+		pr_err("fallback alloc fails for '%s'\n", alg_name);
+		return PTR_ERR(ctx->fallback);
+	}
+
+	crypto_aead_set_reqsize(tfm, sizeof(struct s5p_aead_reqctx) +
+				     crypto_aead_reqsize(ctx->fallback));
+
+	return 0;
+}
+
+static void s5p_aead_exit_tfm(struct crypto_aead *tfm)
+{
+	struct s5p_aead_ctx *ctx = crypto_aead_ctx(tfm);
+
+	crypto_free_aead(ctx->fallback);
+}
+
+/*
+ * The cipher and the HMAC inner hash share one DMA pass: the hash engine
+ * takes its input from the cipher output on encryption and from the cipher
+ * input on decryption. Registered with the HASH algorithms, as it needs the
+ * hash engine.
+ */
+static struct aead_alg algs_aead[] = {
+	{
+		.base.cra_name		= "authenc(hmac(sha256),cbc(aes))",
+		.base.cra_driver_name	= "authenc-hmac-sha256-cbc-aes-s5p",
+		.base.cra_priority	= 300,
+		.base.cra_flags		= CRYPTO_ALG_ASYNC |
+					  CRYPTO_ALG_KERN_DRIVER_ONLY |
+					  CRYPTO_ALG_NEED_FALLBACK,
+		.base.cra_blocksize	= AES_BLOCK_SIZE,
+		.base.cra_ctxsize	= sizeof(struct s5p_aead_ctx),
+		.base.cra_module	= THIS_MODULE,
+
+		.ivsize			= AES_BLOCK_SIZE,
+		.maxauthsize		= SHA256_DIGEST_SIZE,
+		.setkey			= s5p_aead_setkey,
+		.setauthsize		= s5p_aead_setauthsize,
+		.encrypt		= s5p_aead_encrypt,
+		.decrypt		= s5p_aead_decrypt,
+		.init			= s5p_aead_init_tfm,
+		.exit			= s5p_aead_exit_tfm,
+	},
+};
+
+static ssize_t hash_sw_threshold_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct s5p_aes_dev *pdata = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(pdata->hash_sw_threshold));
+}
+
+static ssize_t hash_sw_threshold_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct s5p_aes_dev *pdata = dev_get_drvdata(dev);
+	unsigned int val;
+	int err;
+
+	err = kstrtouint(buf, 0, &val);
+	if (err)
+		return err;
+
+	WRITE_ONCE(pdata->hash_sw_threshold, val);
+
+	return count;
+}
+static DEVICE_ATTR_RW(hash_sw_threshold);
+
+static ssize_t hash_hw_requests_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct s5p_aes_dev *pdata = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lu\n",
+			  atomic_long_read(&pdata->hash_hw_reqs));
+}
+static DEVICE_ATTR_RO(hash_hw_requests);
+
+static ssize_t hash_sw_requests_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct s5p_aes_dev *pdata = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lu\n",
+			  atomic_long_read(&pdata->hash_sw_reqs));
+}
+static DEVICE_ATTR_RO(hash_sw_requests);
+
+static struct attribute *s5p_hash_attrs[] = {
+	&dev_attr_hash_sw_threshold.attr,
+	&dev_attr_hash_hw_requests.attr,
+	&dev_attr_hash_sw_requests.attr,
+	NULL
+};
+
+static const struct attribute_group s5p_hash_attr_group = {
+	.attrs = s5p_hash_attrs,
+};
+
 static int s5p_aes_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -2253,6 +2879,8 @@ static int s5p_aes_probe(struct platform_device *pdev)
 	}
 
 	pdata->busy = false;
+	pdata->next_ready = false;
+	pdata->aead_hash_refs = 0;
 	pdata->dev = dev;
 	platform_set_drvdata(pdev, pdata);
 	s5p_dev = pdata;
@@ -2270,6 +2898,7 @@ static int s5p_aes_probe(struct platform_device *pdev)
 		tasklet_init(&pdata->hash_tasklet, s5p_hash_tasklet_cb,
 			     (unsigned long)pdata);
 		crypto_init_queue(&pdata->hash_queue, SSS_HASH_QUEUE_LENGTH);
+		pdata->hash_sw_threshold = SSS_HASH_SW_THRESHOLD;
 
 		for (hash_i = 0; hash_i < ARRAY_SIZE(algs_sha1_md5_sha256);
 		     hash_i++) {
@@ -2283,6 +2912,15 @@ static int s5p_aes_probe(struct platform_device *pdev)
 				goto err_hash;
 			}
 		}
+
+		err = crypto_register_aeads(algs_aead, ARRAY_SIZE(algs_aead));
+		if (err) {
+			dev_err(dev, "can't register AEAD algs: %d\n", err);
+			goto err_hash;
+		}
+
+		if (devm_device_add_group(dev, &s5p_hash_attr_group))
+			dev_warn(dev, "can't create HASH sysfs attributes\n");
 	}
 
 	dev_info(dev, "s5p-sss driver registered\n");
@@ -2329,6 +2967,8 @@ static int s5p_aes_remove(struct platform_device *pdev)
 
 	tasklet_kill(&pdata->tasklet);
 	if (pdata->use_hash) {
+		crypto_unregister_aeads(algs_aead, ARRAY_SIZE(algs_aead));
+
 		for (i = ARRAY_SIZE(algs_sha1_md5_sha256) - 1; i >= 0; i--)
 			crypto_unregister_ahash(&algs_sha1_md5_sha256[i]);
 
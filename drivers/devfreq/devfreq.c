@@ -736,6 +736,69 @@ static int qos_max_notifier_call(struct notifier_block *nb,
 	return qos_notifier_call(container_of(nb, struct devfreq, nb_max));
 }
 
+static void devfreq_boost_work(struct work_struct *work)
+{
+	struct devfreq *devfreq = container_of(work, struct devfreq,
+					       boost_work.work);
+	unsigned long until;
+	s32 value = 0;
+	bool active;
+
+	spin_lock_irq(&devfreq->boost_lock);
+	until = devfreq->boost_until;
+	if (devfreq->boost_active && !time_before(jiffies, until))
+		devfreq->boost_active = false;
+	active = devfreq->boost_active;
+	spin_unlock_irq(&devfreq->boost_lock);
+
+	if (active)
+		value = DIV_ROUND_UP(devfreq->scaling_max_freq, HZ_PER_KHZ);
+
+	if (dev_pm_qos_update_request(&devfreq->boost_freq_req, value) < 0)
+		dev_warn(devfreq->dev.parent, "Failed to update boost request\n");
+
+	if (active) {
+		unsigned long now = jiffies;
+
+		queue_delayed_work(devfreq_wq, &devfreq->boost_work,
+				   time_after(until, now) ? until - now : 0);
+	}
+}
+
+/**
+ * devfreq_boost() - Run a device at its maximum frequency for a while
+ * @devfreq:	the devfreq instance
+ * @duration_ms: how long to keep the frequency up
+ *
+ * For drivers which know that a burst of load is about to start, e.g. a
+ * media engine starting a job, and cannot afford to wait for the governor
+ * to notice it at its next polling interval. Boosting again while a boost
+ * is in effect extends it. The boost is a minimum frequency request, so it
+ * is still subject to the maximum frequency limits.
+ *
+ * Can be called from atomic context, the frequency change itself is done
+ * from the devfreq workqueue.
+ */
+int devfreq_boost(struct devfreq *devfreq, unsigned int duration_ms)
+{
+	unsigned long until = jiffies + msecs_to_jiffies(duration_ms);
+	unsigned long flags;
+
+	if (IS_ERR_OR_NULL(devfreq) || !duration_ms)
+		return -EINVAL;
+
+	spin_lock_irqsave(&devfreq->boost_lock, flags);
+	if (!devfreq->boost_active || time_after(until, devfreq->boost_until))
+		devfreq->boost_until = until;
+	devfreq->boost_active = true;
+	spin_unlock_irqrestore(&devfreq->boost_lock, flags);
+
+	mod_delayed_work(devfreq_wq, &devfreq->boost_work, 0);
+
+	return 0;
+}
+EXPORT_SYMBOL(devfreq_boost);
+
 /**
  * devfreq_dev_release() - Callback for struct device to release the device.
  * @dev:	the devfreq device
@@ -774,6 +837,12 @@ static void devfreq_dev_release(struct device *dev)
 			dev_warn(dev->parent,
 				"Failed to remove min_freq request: %d\n", err);
 	}
+	if (dev_pm_qos_request_active(&devfreq->boost_freq_req)) {
+		err = dev_pm_qos_remove_request(&devfreq->boost_freq_req);
+		if (err < 0)
+			dev_warn(dev->parent,
+				"Failed to remove boost request: %d\n", err);
+	}
 
 	if (devfreq->profile->exit)
 		devfreq->profile->exit(devfreq->dev.parent);
@@ -839,6 +908,8 @@ struct devfreq *devfreq_add_device(struct device *dev,
 	devfreq->last_status.current_frequency = profile->initial_freq;
 	devfreq->data = data;
 	devfreq->nb.notifier_call = devfreq_notifier_call;
+	spin_lock_init(&devfreq->boost_lock);
+	INIT_DELAYED_WORK(&devfreq->boost_work, devfreq_boost_work);
 
 	if (devfreq->profile->timer < 0
 		|| devfreq->profile->timer >= DEVFREQ_TIMER_NUM) {
@@ -921,6 +992,10 @@ struct devfreq *devfreq_add_device(struct device *dev,
 				     PM_QOS_MAX_FREQUENCY_DEFAULT_VALUE);
 	if (err < 0)
 		goto err_devfreq;
+	err = dev_pm_qos_add_request(dev, &devfreq->boost_freq_req,
+				     DEV_PM_QOS_MIN_FREQUENCY, 0);
+	if (err < 0)
+		goto err_devfreq;
 
 	devfreq->nb_min.notifier_call = qos_min_notifier_call;
 	err = dev_pm_qos_add_notifier(dev, &devfreq->nb_min,
@@ -990,6 +1065,7 @@ int devfreq_remove_device(struct devfreq *devfreq)
 		return -EINVAL;
 
 	devfreq_cooling_unregister(devfreq->cdev);
+	cancel_delayed_work_sync(&devfreq->boost_work);
 
 	if (devfreq->governor) {
 		devfreq->governor->event_handler(devfreq,
@@ -304,6 +304,15 @@ static int exynos_bus_profile_init(struct exynos_bus *bus,
 	profile->get_dev_status = exynos_bus_get_dev_status;
 	profile->exit = exynos_bus_exit;
 
+	/*
+	 * Buses referenced from a thermal zone are registered as devfreq
+	 * cooling devices, with an Energy Model built from the OPPs and the
+	 * "dynamic-power-coefficient" property when the DT provides one.
+	 * The passive sub-buses follow their parent and are left out.
+	 */
+	profile->is_cooling_device = of_property_read_bool(dev->of_node,
+							  "#cooling-cells");
+
 	ondemand_data = devm_kzalloc(dev, sizeof(*ondemand_data), GFP_KERNEL);
 	if (!ondemand_data)
 		return -ENOMEM;
@@ -164,11 +164,31 @@ static bool dma_fence_chain_enable_signaling(struct dma_fence *fence)
 
 static bool dma_fence_chain_signaled(struct dma_fence *fence)
 {
+	struct dma_fence_chain *head = to_dma_fence_chain(fence);
+	struct dma_fence *blocker;
+
+	/*
+	 * Waiters poll long chains over and over, as long as the fence which
+	 * stopped the last walk is pending there is no need to walk again.
+	 */
+	blocker = xchg(&head->blocker, NULL);
+	if (blocker) {
+		if (!dma_fence_is_signaled(blocker)) {
+			if (cmpxchg(&head->blocker, NULL, blocker))
+				dma_fence_put(blocker);
+			return false;
+		}
+		dma_fence_put(blocker);
+	}
+
 	dma_fence_chain_for_each(fence, fence) {
 		struct dma_fence_chain *chain = to_dma_fence_chain(fence);
 		struct dma_fence *f = chain ? chain->fence : fence;
 
 		if (!dma_fence_is_signaled(f)) {
+			dma_fence_get(f);
+			if (cmpxchg(&head->blocker, NULL, f))
+				dma_fence_put(f);
 			dma_fence_put(fence);
 			return false;
 		}
@@ -204,6 +224,7 @@ static void dma_fence_chain_release(struct dma_fence *fence)
 	}
 	dma_fence_put(prev);
 
+	dma_fence_put(chain->blocker);
 	dma_fence_put(chain->fence);
 	dma_fence_free(fence);
 }
@@ -239,6 +260,7 @@ void dma_fence_chain_init(struct dma_fence_chain *chain,
 	spin_lock_init(&chain->lock);
 	rcu_assign_pointer(chain->prev, prev);
 	chain->fence = fence;
+	chain->blocker = NULL;
 	chain->prev_seqno = 0;
 
 	/* Try to reuse the context of the previous chain node. */
@@ -491,6 +491,7 @@ signed long
 dma_fence_wait_timeout(struct dma_fence *fence, bool intr, signed long timeout)
 {
 	signed long ret;
+	bool waited;
 
 	if (WARN_ON(timeout < 0))
 		return -EINVAL;
@@ -499,12 +500,21 @@ dma_fence_wait_timeout(struct dma_fence *fence, bool intr, signed long timeout)
 
 	__dma_fence_might_wait();
 
+	waited = !test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags);
+
 	trace_dma_fence_wait_start(fence);
 	if (fence->ops->wait)
 		ret = fence->ops->wait(fence, intr, timeout);
 	else
 		ret = dma_fence_default_wait(fence, intr, timeout);
 	trace_dma_fence_wait_end(fence);
+
+	/* Time from signaling until the waiter is back running */
+	if (trace_dma_fence_wait_latency_enabled() && waited && ret > 0 &&
+	    test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags))
+		trace_dma_fence_wait_latency(fence,
+			ktime_to_ns(ktime_sub(ktime_get(),
+					      dma_fence_timestamp(fence))));
 	return ret;
 }
 EXPORT_SYMBOL(dma_fence_wait_timeout);
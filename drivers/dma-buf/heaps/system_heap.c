@@ -14,14 +14,18 @@
 #include <linux/dma-mapping.h>
 #include <linux/dma-heap.h>
 #include <linux/err.h>
+#include <linux/freezer.h>
 #include <linux/highmem.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/wait.h>
 
 static struct dma_heap *sys_heap;
+static struct dma_heap *sys_uncached_heap;
 
 struct system_heap_buffer {
 	struct dma_heap *heap;
@@ -31,6 +35,7 @@ struct system_heap_buffer {
 	struct sg_table sg_table;
 	int vmap_cnt;
 	void *vaddr;
+	bool uncached;
 };
 
 struct dma_heap_attachment {
@@ -38,6 +43,7 @@ struct dma_heap_attachment {
 	struct sg_table *table;
 	struct list_head list;
 	bool mapped;
+	bool uncached;
 };
 
 #define HIGH_ORDER_GFP  (((GFP_HIGHUSER | __GFP_ZERO | __GFP_NOWARN \
@@ -54,6 +60,204 @@ static gfp_t order_flags[] = {HIGH_ORDER_GFP, LOW_ORDER_GFP, LOW_ORDER_GFP};
 static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+/*
+ * Pages of freed buffers are kept in a pool per order rather than handed
+ * back to the buddy allocator, so that streams restarting and reallocating
+ * their buffers neither go through the allocator nor clear pages in the
+ * allocation path: a low priority thread zeroes the freed (dirty) pages in
+ * the background and moves them to the clean list, where allocations take
+ * them from. The shrinker gives the pooled pages back under memory pressure.
+ */
+struct system_heap_pool {
+	unsigned int order;
+	gfp_t gfp;
+	spinlock_t lock;
+	struct list_head clean;
+	struct list_head dirty;
+	unsigned long nr_clean;
+	unsigned long nr_dirty;
+};
+
+static struct system_heap_pool pools[NUM_ORDERS];
+static DECLARE_WAIT_QUEUE_HEAD(pool_zero_wait);
+
+static struct page *pool_take(struct system_heap_pool *pool,
+			      struct list_head *list, unsigned long *count)
+{
+	struct page *page;
+
+	spin_lock(&pool->lock);
+	page = list_first_entry_or_null(list, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		(*count)--;
+	}
+	spin_unlock(&pool->lock);
+
+	return page;
+}
+
+static void pool_zero_page(struct system_heap_pool *pool, struct page *page)
+{
+	int i;
+
+	for (i = 0; i < (1 << pool->order); i++)
+		clear_highpage(page + i);
+}
+
+static struct page *pool_alloc(struct system_heap_pool *pool)
+{
+	struct page *page;
+
+	page = pool_take(pool, &pool->clean, &pool->nr_clean);
+	if (page)
+		return page;
+
+	page = alloc_pages(pool->gfp, pool->order);
+	if (page)
+		return page;
+
+	/* rather zero a page here than fail the allocation */
+	page = pool_take(pool, &pool->dirty, &pool->nr_dirty);
+	if (page)
+		pool_zero_page(pool, page);
+	return page;
+}
+
+static void pool_free(struct page *page)
+{
+	unsigned int order = compound_order(page);
+	struct system_heap_pool *pool;
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		if (orders[i] == order)
+			break;
+	if (WARN_ON_ONCE(i == NUM_ORDERS)) {
+		__free_pages(page, order);
+		return;
+	}
+
+	pool = &pools[i];
+	spin_lock(&pool->lock);
+	list_add_tail(&page->lru, &pool->dirty);
+	pool->nr_dirty++;
+	spin_unlock(&pool->lock);
+
+	wake_up(&pool_zero_wait);
+}
+
+static bool pool_has_dirty(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		if (READ_ONCE(pools[i].nr_dirty))
+			return true;
+	return false;
+}
+
+static int pool_zero_thread(void *data)
+{
+	struct system_heap_pool *pool;
+	struct page *page;
+	int i;
+
+	set_user_nice(current, MAX_NICE);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pool_zero_wait,
+				     pool_has_dirty() || kthread_should_stop());
+
+		for (i = 0; i < NUM_ORDERS; i++) {
+			pool = &pools[i];
+			page = pool_take(pool, &pool->dirty, &pool->nr_dirty);
+			if (!page)
+				continue;
+
+			pool_zero_page(pool, page);
+
+			spin_lock(&pool->lock);
+			list_add_tail(&page->lru, &pool->clean);
+			pool->nr_clean++;
+			spin_unlock(&pool->lock);
+
+			cond_resched();
+		}
+	}
+
+	return 0;
+}
+
+static unsigned long pool_shrink_count(struct shrinker *shrinker,
+				       struct shrink_control *sc)
+{
+	unsigned long count = 0;
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		count += (READ_ONCE(pools[i].nr_clean) +
+			  READ_ONCE(pools[i].nr_dirty)) << pools[i].order;
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+static unsigned long pool_shrink_scan(struct shrinker *shrinker,
+				      struct shrink_control *sc)
+{
+	struct system_heap_pool *pool;
+	unsigned long freed = 0;
+	struct page *page;
+	int i;
+
+	/* dirty pages first, zeroing them would be wasted work */
+	for (i = 0; i < NUM_ORDERS && freed < sc->nr_to_scan; i++) {
+		pool = &pools[i];
+		while (freed < sc->nr_to_scan) {
+			page = pool_take(pool, &pool->dirty, &pool->nr_dirty);
+			if (!page)
+				page = pool_take(pool, &pool->clean,
+						 &pool->nr_clean);
+			if (!page)
+				break;
+			__free_pages(page, pool->order);
+			freed += 1 << pool->order;
+		}
+	}
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker pool_shrinker = {
+	.count_objects = pool_shrink_count,
+	.scan_objects = pool_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int system_heap_pool_init(void)
+{
+	struct task_struct *task;
+	int i, ret;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		pools[i].order = orders[i];
+		pools[i].gfp = order_flags[i];
+		spin_lock_init(&pools[i].lock);
+		INIT_LIST_HEAD(&pools[i].clean);
+		INIT_LIST_HEAD(&pools[i].dirty);
+	}
+
+	task = kthread_run(pool_zero_thread, NULL, "system-heap-zero");
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+
+	ret = register_shrinker(&pool_shrinker);
+	if (ret)
+		kthread_stop(task);
+	return ret;
+}
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -100,6 +304,7 @@ static int system_heap_attach(struct dma_buf *dmabuf,
 	a->dev = attachment->dev;
 	INIT_LIST_HEAD(&a->list);
 	a->mapped = false;
+	a->uncached = buffer->uncached;
 
 	attachment->priv = a;
 
@@ -130,9 +335,13 @@ static struct sg_table *system_heap_map_dma_buf(struct dma_buf_attachment *attac
 {
 	struct dma_heap_attachment *a = attachment->priv;
 	struct sg_table *table = a->table;
+	unsigned long attr = 0;
 	int ret;
 
-	ret = dma_map_sgtable(attachment->dev, table, direction, 0);
+	if (a->uncached)
+		attr = DMA_ATTR_SKIP_CPU_SYNC;
+
+	ret = dma_map_sgtable(attachment->dev, table, direction, attr);
 	if (ret)
 		return ERR_PTR(ret);
 
@@ -145,9 +354,13 @@ static void system_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
 				      enum dma_data_direction direction)
 {
 	struct dma_heap_attachment *a = attachment->priv;
+	unsigned long attr = 0;
+
+	if (a->uncached)
+		attr = DMA_ATTR_SKIP_CPU_SYNC;
 
 	a->mapped = false;
-	dma_unmap_sgtable(attachment->dev, table, direction, 0);
+	dma_unmap_sgtable(attachment->dev, table, direction, attr);
 }
 
 static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
@@ -156,6 +369,10 @@ static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	/* all CPU mappings of uncached buffers bypass the cache */
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -177,6 +394,9 @@ static int system_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -200,6 +420,9 @@ static int system_heap_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 	struct sg_page_iter piter;
 	int ret;
 
+	if (buffer->uncached)
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
 	for_each_sgtable_page(table, &piter, vma->vm_pgoff) {
 		struct page *page = sg_page_iter_page(&piter);
 
@@ -221,6 +444,7 @@ static void *system_heap_do_vmap(struct system_heap_buffer *buffer)
 	struct page **pages = vmalloc(sizeof(struct page *) * npages);
 	struct page **tmp = pages;
 	struct sg_page_iter piter;
+	pgprot_t pgprot = PAGE_KERNEL;
 	void *vaddr;
 
 	if (!pages)
@@ -231,7 +455,10 @@ static void *system_heap_do_vmap(struct system_heap_buffer *buffer)
 		*tmp++ = sg_page_iter_page(&piter);
 	}
 
-	vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL);
+	if (buffer->uncached)
+		pgprot = pgprot_writecombine(PAGE_KERNEL);
+
+	vaddr = vmap(pages, npages, VM_MAP, pgprot);
 	vfree(pages);
 
 	if (!vaddr)
@@ -289,11 +516,8 @@ static void system_heap_dma_buf_release(struct dma_buf *dmabuf)
 	int i;
 
 	table = &buffer->sg_table;
-	for_each_sgtable_sg(table, sg, i) {
-		struct page *page = sg_page(sg);
-
-		__free_pages(page, compound_order(page));
-	}
+	for_each_sgtable_sg(table, sg, i)
+		pool_free(sg_page(sg));
 	sg_free_table(table);
 	kfree(buffer);
 }
@@ -323,7 +547,7 @@ static struct page *alloc_largest_available(unsigned long size,
 		if (max_order < orders[i])
 			continue;
 
-		page = alloc_pages(order_flags[i], orders[i]);
+		page = pool_alloc(&pools[i]);
 		if (!page)
 			continue;
 		return page;
@@ -331,10 +555,11 @@ static struct page *alloc_largest_available(unsigned long size,
 	return NULL;
 }
 
-static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
-					    unsigned long len,
-					    unsigned long fd_flags,
-					    unsigned long heap_flags)
+static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
+					       unsigned long len,
+					       unsigned long fd_flags,
+					       unsigned long heap_flags,
+					       bool uncached)
 {
 	struct system_heap_buffer *buffer;
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
@@ -355,6 +580,7 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	mutex_init(&buffer->lock);
 	buffer->heap = heap;
 	buffer->len = len;
+	buffer->uncached = uncached;
 
 	INIT_LIST_HEAD(&pages);
 	i = 0;
@@ -389,6 +615,19 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 		list_del(&page->lru);
 	}
 
+	/*
+	 * The pages were zeroed through the cacheable linear mapping: write
+	 * that back before the buffer is only ever accessed uncached.
+	 */
+	if (uncached) {
+		struct device *dev = dma_heap_get_dev(sys_heap);
+
+		ret = dma_map_sgtable(dev, table, DMA_BIDIRECTIONAL, 0);
+		if (ret)
+			goto free_pages;
+		dma_unmap_sgtable(dev, table, DMA_BIDIRECTIONAL, 0);
+	}
+
 	/* create the dmabuf */
 	exp_info.exp_name = dma_heap_get_name(heap);
 	exp_info.ops = &system_heap_buf_ops;
@@ -403,6 +642,7 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	return dmabuf;
 
 free_pages:
+	/* The pages were never handed out, don't queue them for zeroing */
 	for_each_sgtable_sg(table, sg, i) {
 		struct page *p = sg_page(sg);
 
@@ -417,13 +657,43 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	return ERR_PTR(ret);
 }
 
+static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
+					    unsigned long len,
+					    unsigned long fd_flags,
+					    unsigned long heap_flags)
+{
+	return system_heap_do_allocate(heap, len, fd_flags, heap_flags, false);
+}
+
 static const struct dma_heap_ops system_heap_ops = {
 	.allocate = system_heap_allocate,
 };
 
+static struct dma_buf *system_uncached_heap_allocate(struct dma_heap *heap,
+						     unsigned long len,
+						     unsigned long fd_flags,
+						     unsigned long heap_flags)
+{
+	return system_heap_do_allocate(heap, len, fd_flags, heap_flags, true);
+}
+
+/*
+ * Buffers from the uncached heap are mapped write-combined in the kernel
+ * and in userspace and skip all CPU cache maintenance, for buffers the CPU
+ * only streams into, such as frames headed to the display.
+ */
+static const struct dma_heap_ops system_uncached_heap_ops = {
+	.allocate = system_uncached_heap_allocate,
+};
+
 static int system_heap_create(void)
 {
 	struct dma_heap_export_info exp_info;
+	int ret;
+
+	ret = system_heap_pool_init();
+	if (ret)
+		return ret;
 
 	exp_info.name = "system";
 	exp_info.ops = &system_heap_ops;
@@ -433,6 +703,22 @@ static int system_heap_create(void)
 	if (IS_ERR(sys_heap))
 		return PTR_ERR(sys_heap);
 
+	/*
+	 * New uncached buffers are flushed through the system heap device,
+	 * which the system heap itself never maps with. Give it a DMA mask
+	 * before the uncached heap is exposed to userspace.
+	 */
+	dma_coerce_mask_and_coherent(dma_heap_get_dev(sys_heap),
+				     DMA_BIT_MASK(64));
+
+	exp_info.name = "system-uncached";
+	exp_info.ops = &system_uncached_heap_ops;
+	exp_info.priv = NULL;
+
+	sys_uncached_heap = dma_heap_add(&exp_info);
+	if (IS_ERR(sys_uncached_heap))
+		return PTR_ERR(sys_uncached_heap);
+
 	return 0;
 }
 module_init(system_heap_create);
@@ -8,6 +8,9 @@
  *	Seung-Woo Kim <sw0312.kim@samsung.com>
  */
 
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_encoder.h>
@@ -133,11 +136,137 @@ void exynos_crtc_handle_event(struct exynos_drm_crtc *exynos_crtc)
 	spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
 }
 
+/**
+ * exynos_drm_crtc_handle_vblank - handle a vblank interrupt of the crtc
+ * @exynos_crtc: the crtc
+ *
+ * Like drm_crtc_handle_vblank(), but also releases the framebuffers replaced
+ * by async plane updates once the new ones have been latched.
+ */
+void exynos_drm_crtc_handle_vblank(struct exynos_drm_crtc *exynos_crtc)
+{
+	struct drm_crtc *crtc = &exynos_crtc->base;
+	unsigned long flags;
+
+	drm_crtc_handle_vblank(crtc);
+
+	spin_lock_irqsave(&exynos_crtc->async_lock, flags);
+	/*
+	 * The update may have been written just after a latch, so only the
+	 * second vblank after it is sure to have the new framebuffer on.
+	 */
+	if (exynos_crtc->async_pending &&
+	    drm_crtc_vblank_count(crtc) - exynos_crtc->async_seq >= 2) {
+		exynos_crtc->async_pending = false;
+		drm_flip_work_commit(&exynos_crtc->fb_unref_work,
+				     system_unbound_wq);
+		drm_crtc_vblank_put(crtc);
+	}
+	spin_unlock_irqrestore(&exynos_crtc->async_lock, flags);
+}
+
+/**
+ * exynos_drm_crtc_defer_fb_put - keep a framebuffer until it is off screen
+ * @exynos_crtc: the crtc scanning out @fb
+ * @fb: framebuffer just replaced by an async plane update
+ *
+ * Takes a reference to @fb which is dropped once the hardware has latched
+ * the update which replaced it.
+ */
+void exynos_drm_crtc_defer_fb_put(struct exynos_drm_crtc *exynos_crtc,
+				  struct drm_framebuffer *fb)
+{
+	struct drm_crtc *crtc = &exynos_crtc->base;
+	unsigned long flags;
+
+	drm_framebuffer_get(fb);
+	drm_flip_work_queue(&exynos_crtc->fb_unref_work, fb);
+
+	spin_lock_irqsave(&exynos_crtc->async_lock, flags);
+	exynos_crtc->async_seq = drm_crtc_vblank_count(crtc);
+	if (!exynos_crtc->async_pending) {
+		if (!drm_crtc_vblank_get(crtc))
+			exynos_crtc->async_pending = true;
+		else
+			/* no vblanks to wait for, the crtc is off */
+			drm_flip_work_commit(&exynos_crtc->fb_unref_work,
+					     system_unbound_wq);
+	}
+	spin_unlock_irqrestore(&exynos_crtc->async_lock, flags);
+}
+
+static void exynos_drm_crtc_fb_unref(struct drm_flip_work *work, void *val)
+{
+	drm_framebuffer_put(val);
+}
+
+/*
+ * DRM_MODE_PAGE_FLIP_ASYNC flips are done as async plane updates of the
+ * primary plane: the new framebuffer is latched at the next vblank without
+ * a full commit, and the event is sent right away.
+ */
+static int exynos_drm_crtc_page_flip(struct drm_crtc *crtc,
+				     struct drm_framebuffer *fb,
+				     struct drm_pending_vblank_event *event,
+				     uint32_t flags,
+				     struct drm_modeset_acquire_ctx *ctx)
+{
+	struct drm_plane *plane = crtc->primary;
+	struct drm_atomic_state *state;
+	struct drm_plane_state *plane_state;
+	int ret;
+
+	if (!(flags & DRM_MODE_PAGE_FLIP_ASYNC))
+		return drm_atomic_helper_page_flip(crtc, fb, event, flags, ctx);
+
+	state = drm_atomic_state_alloc(plane->dev);
+	if (!state)
+		return -ENOMEM;
+
+	state->acquire_ctx = ctx;
+
+	plane_state = drm_atomic_get_plane_state(state, plane);
+	if (IS_ERR(plane_state)) {
+		ret = PTR_ERR(plane_state);
+		goto out;
+	}
+
+	ret = drm_atomic_set_crtc_for_plane(plane_state, crtc);
+	if (ret)
+		goto out;
+	drm_atomic_set_fb_for_plane(plane_state, fb);
+
+	ret = drm_atomic_check_only(state);
+	if (ret)
+		goto out;
+
+	ret = drm_atomic_helper_async_check(plane->dev, state);
+	if (ret) {
+		ret = -EINVAL;
+		goto out;
+	}
+	state->async_update = true;
+
+	ret = drm_atomic_commit(state);
+	if (ret)
+		goto out;
+
+	if (event) {
+		spin_lock_irq(&crtc->dev->event_lock);
+		drm_crtc_send_vblank_event(crtc, event);
+		spin_unlock_irq(&crtc->dev->event_lock);
+	}
+out:
+	drm_atomic_state_put(state);
+	return ret;
+}
+
 static void exynos_drm_crtc_destroy(struct drm_crtc *crtc)
 {
 	struct exynos_drm_crtc *exynos_crtc = to_exynos_crtc(crtc);
 
 	drm_crtc_cleanup(crtc);
+	drm_flip_work_cleanup(&exynos_crtc->fb_unref_work);
 	kfree(exynos_crtc);
 }
 
@@ -159,15 +288,50 @@ static void exynos_drm_crtc_disable_vblank(struct drm_crtc *crtc)
 		exynos_crtc->ops->disable_vblank(exynos_crtc);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int exynos_drm_crtc_commit_stats_show(struct seq_file *m, void *data)
+{
+	struct exynos_drm_crtc *exynos_crtc = m->private;
+
+	seq_printf(m, "deferred_commits: %lu\n", exynos_crtc->deferred_commits);
+	seq_printf(m, "deferred_planes:  %lu\n", exynos_crtc->deferred_planes);
+	seq_printf(m, "vblank_misses:    %lu\n", exynos_crtc->vblank_misses);
+	seq_printf(m, "latched_commits:  %lu\n", exynos_crtc->latched_commits);
+	if (exynos_crtc->latched_commits)
+		seq_printf(m, "latch_avg_us:     %llu\n",
+			   div_u64(div_u64(exynos_crtc->latch_ns_total,
+					   exynos_crtc->latched_commits),
+				   NSEC_PER_USEC));
+	seq_printf(m, "latch_max_us:     %llu\n",
+		   div_u64(exynos_crtc->latch_ns_max, NSEC_PER_USEC));
+	seq_printf(m, "sync_timeouts:    %lu\n", exynos_crtc->sync_timeouts);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(exynos_drm_crtc_commit_stats);
+
+static int exynos_drm_crtc_late_register(struct drm_crtc *crtc)
+{
+	debugfs_create_file("commit_stats", 0444, crtc->debugfs_entry,
+			    to_exynos_crtc(crtc),
+			    &exynos_drm_crtc_commit_stats_fops);
+
+	return 0;
+}
+#else
+#define exynos_drm_crtc_late_register NULL
+#endif
+
 static const struct drm_crtc_funcs exynos_crtc_funcs = {
 	.set_config	= drm_atomic_helper_set_config,
-	.page_flip	= drm_atomic_helper_page_flip,
+	.page_flip	= exynos_drm_crtc_page_flip,
 	.destroy	= exynos_drm_crtc_destroy,
 	.reset = drm_atomic_helper_crtc_reset,
 	.atomic_duplicate_state = drm_atomic_helper_crtc_duplicate_state,
 	.atomic_destroy_state = drm_atomic_helper_crtc_destroy_state,
 	.enable_vblank = exynos_drm_crtc_enable_vblank,
 	.disable_vblank = exynos_drm_crtc_disable_vblank,
+	.late_register = exynos_drm_crtc_late_register,
 };
 
 struct exynos_drm_crtc *exynos_drm_crtc_create(struct drm_device *drm_dev,
@@ -187,6 +351,9 @@ struct exynos_drm_crtc *exynos_drm_crtc_create(struct drm_device *drm_dev,
 	exynos_crtc->type = type;
 	exynos_crtc->ops = ops;
 	exynos_crtc->ctx = ctx;
+	spin_lock_init(&exynos_crtc->async_lock);
+	drm_flip_work_init(&exynos_crtc->fb_unref_work, "fb_unref",
+			   exynos_drm_crtc_fb_unref);
 
 	crtc = &exynos_crtc->base;
 
@@ -201,6 +368,7 @@ struct exynos_drm_crtc *exynos_drm_crtc_create(struct drm_device *drm_dev,
 
 err_crtc:
 	plane->funcs->destroy(plane);
+	drm_flip_work_cleanup(&exynos_crtc->fb_unref_work);
 	kfree(exynos_crtc);
 	return ERR_PTR(ret);
 }
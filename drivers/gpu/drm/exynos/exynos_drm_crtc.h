@@ -39,4 +39,8 @@ void exynos_drm_crtc_te_handler(struct drm_crtc *crtc);
 
 void exynos_crtc_handle_event(struct exynos_drm_crtc *exynos_crtc);
 
+void exynos_drm_crtc_handle_vblank(struct exynos_drm_crtc *exynos_crtc);
+void exynos_drm_crtc_defer_fb_put(struct exynos_drm_crtc *exynos_crtc,
+				  struct drm_framebuffer *fb);
+
 #endif
@@ -42,9 +42,11 @@
  *
  * 1.0 - Original version
  * 1.1 - Upgrade IPP driver to version 2.0
+ * 1.2 - Add in/out fence support to G2D exec
+ * 1.3 - Add 64x32 tiled buffer allocation and plane modifiers
  */
 #define DRIVER_MAJOR	1
-#define DRIVER_MINOR	1
+#define DRIVER_MINOR	3
 
 static int exynos_drm_open(struct drm_device *dev, struct drm_file *file)
 {
@@ -75,6 +77,11 @@ static void exynos_drm_postclose(struct drm_device *dev, struct drm_file *file)
 	file->driver_priv = NULL;
 }
 
+static void exynos_drm_debugfs_init(struct drm_minor *minor)
+{
+	g2d_debugfs_init(minor);
+}
+
 static const struct drm_ioctl_desc exynos_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(EXYNOS_GEM_CREATE, exynos_drm_gem_create_ioctl,
 			DRM_RENDER_ALLOW),
@@ -119,6 +126,7 @@ static const struct drm_driver exynos_drm_driver = {
 	.open			= exynos_drm_open,
 	.lastclose		= drm_fb_helper_lastclose,
 	.postclose		= exynos_drm_postclose,
+	.debugfs_init		= exynos_drm_debugfs_init,
 	.dumb_create		= exynos_drm_gem_dumb_create,
 	.prime_handle_to_fd	= drm_gem_prime_handle_to_fd,
 	.prime_fd_to_handle	= drm_gem_prime_fd_to_handle,
@@ -294,6 +302,8 @@ static int exynos_drm_bind(struct device *dev)
 	if (ret)
 		goto err_mode_config_cleanup;
 
+	exynos_drm_mode_config_init_async(drm);
+
 	ret = drm_vblank_init(drm, drm->mode_config.num_crtc);
 	if (ret)
 		goto err_unbind_all;
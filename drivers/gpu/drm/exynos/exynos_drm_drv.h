@@ -15,6 +15,7 @@
 
 #include <drm/drm_crtc.h>
 #include <drm/drm_device.h>
+#include <drm/drm_flip_work.h>
 #include <drm/drm_plane.h>
 
 #define MAX_CRTC	3
@@ -55,6 +56,9 @@ struct exynos_drm_rect {
  *       (clipped to visible part).
  * @h_ratio: horizontal scaling ratio, 16.16 fixed point
  * @v_ratio: vertical scaling ratio, 16.16 fixed point
+ * @late_fence: explicit fence not yet signaled at commit time; the plane is
+ *	latched separately once it signals instead of holding back the
+ *	other planes of the commit.
  *
  * this structure consists plane state data that will be applied to hardware
  * specific overlay info.
@@ -66,6 +70,7 @@ struct exynos_drm_plane_state {
 	struct exynos_drm_rect src;
 	unsigned int h_ratio;
 	unsigned int v_ratio;
+	struct dma_fence *late_fence;
 };
 
 static inline struct exynos_drm_plane_state *
@@ -127,6 +132,8 @@ struct exynos_drm_plane_config {
  * @atomic_begin: prepare device to receive an update
  * @atomic_flush: mark the end of device update
  * @update_plane: apply hardware specific overlay data to registers.
+ * @async_update_plane: apply a plane update outside of an atomic commit, to
+ *	be latched by the hardware at the next vblank without waiting for it.
  * @disable_plane: disable hardware specific overlay.
  * @te_handler: trigger to transfer video image at the tearing effect
  *	synchronization signal if there is a page flip request.
@@ -147,6 +154,8 @@ struct exynos_drm_crtc_ops {
 	void (*atomic_begin)(struct exynos_drm_crtc *crtc);
 	void (*update_plane)(struct exynos_drm_crtc *crtc,
 			     struct exynos_drm_plane *plane);
+	void (*async_update_plane)(struct exynos_drm_crtc *crtc,
+				   struct exynos_drm_plane *plane);
 	void (*disable_plane)(struct exynos_drm_crtc *crtc,
 			      struct exynos_drm_plane *plane);
 	void (*atomic_flush)(struct exynos_drm_crtc *crtc);
@@ -165,6 +174,21 @@ struct exynos_drm_clk {
  * @ops: pointer to callbacks for exynos drm specific functionality
  * @ctx: A pointer to the crtc's implementation specific context
  * @pipe_clk: A pointer to the crtc's pipeline clock.
+ * @deferred_commits: number of commits whose late planes were latched
+ *	separately.
+ * @deferred_planes: number of planes latched after the rest of their commit.
+ * @vblank_misses: number of vblanks passed while waiting for late planes.
+ * @latched_commits: number of commits seen latched by the hardware.
+ * @latch_ns_total: sum of the times from flush to latch of those commits.
+ * @latch_ns_max: longest time from flush to latch.
+ * @sync_timeouts: number of commits which gave up waiting for the previous
+ *	one to latch.
+ * @fb_unref_work: releases framebuffers replaced by async updates once the
+ *	hardware stopped scanning them out.
+ * @async_lock: protects @async_seq and @async_pending.
+ * @async_seq: vblank count at the last async framebuffer change.
+ * @async_pending: @fb_unref_work has framebuffers queued and a vblank
+ *	reference is held for them.
  */
 struct exynos_drm_crtc {
 	struct drm_crtc			base;
@@ -173,6 +197,19 @@ struct exynos_drm_crtc {
 	void				*ctx;
 	struct exynos_drm_clk		*pipe_clk;
 	bool				i80_mode : 1;
+
+	unsigned long			deferred_commits;
+	unsigned long			deferred_planes;
+	unsigned long			vblank_misses;
+	unsigned long			latched_commits;
+	u64				latch_ns_total;
+	u64				latch_ns_max;
+	unsigned long			sync_timeouts;
+
+	struct drm_flip_work		fb_unref_work;
+	spinlock_t			async_lock;
+	u64				async_seq;
+	bool				async_pending;
 };
 
 static inline void exynos_drm_pipe_clk_enable(struct exynos_drm_crtc *crtc,
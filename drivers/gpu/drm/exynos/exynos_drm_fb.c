@@ -8,13 +8,17 @@
  *	Seung-Woo Kim <sw0312.kim@samsung.com>
  */
 
+#include <linux/dma-fence.h>
+
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_crtc.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_fb_helper.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_gem_framebuffer_helper.h>
 #include <drm/drm_probe_helper.h>
+#include <drm/drm_vblank.h>
 #include <drm/exynos_drm.h>
 
 #include "exynos_drm_crtc.h"
@@ -22,6 +26,10 @@
 #include "exynos_drm_fb.h"
 #include "exynos_drm_fbdev.h"
 
+static bool plane_fence_defer;
+module_param(plane_fence_defer, bool, 0644);
+MODULE_PARM_DESC(plane_fence_defer, "Latch planes whose in-fence is not signaled yet separately from the rest of the commit");
+
 static int check_fb_gem_memory_type(struct drm_device *drm_dev,
 				    struct exynos_drm_gem *exynos_gem)
 {
@@ -49,9 +57,31 @@ static int check_fb_gem_memory_type(struct drm_device *drm_dev,
 	return 0;
 }
 
+/*
+ * Video mode outputs scan the framebuffer out on every frame and see new
+ * contents without any help, only command mode (i80) panels need a commit
+ * to transfer the damaged frame into their memory.
+ */
+static int exynos_drm_fb_dirty(struct drm_framebuffer *fb,
+			       struct drm_file *file_priv, unsigned int flags,
+			       unsigned int color, struct drm_clip_rect *clips,
+			       unsigned int num_clips)
+{
+	struct drm_crtc *crtc;
+
+	drm_for_each_crtc(crtc, fb->dev)
+		if (to_exynos_crtc(crtc)->i80_mode)
+			return drm_atomic_helper_dirtyfb(fb, file_priv, flags,
+							 color, clips,
+							 num_clips);
+
+	return 0;
+}
+
 static const struct drm_framebuffer_funcs exynos_drm_fb_funcs = {
 	.destroy	= drm_gem_fb_destroy,
 	.create_handle	= drm_gem_fb_create_handle,
+	.dirty		= exynos_drm_fb_dirty,
 };
 
 struct drm_framebuffer *
@@ -102,11 +132,28 @@ exynos_user_fb_create(struct drm_device *dev, struct drm_file *file_priv,
 	int i;
 	int ret;
 
+	bool tiled = (mode_cmd->flags & DRM_MODE_FB_MODIFIERS) &&
+		     mode_cmd->modifier[0] == DRM_FORMAT_MOD_SAMSUNG_64_32_TILE;
+
 	for (i = 0; i < info->num_planes; i++) {
 		unsigned int height = (i == 0) ? mode_cmd->height :
 				     DIV_ROUND_UP(mode_cmd->height, info->vsub);
-		unsigned long size = height * mode_cmd->pitches[i] +
-				     mode_cmd->offsets[i];
+		unsigned long size;
+
+		/* tiled planes are stored as whole rows of 64x32 tiles */
+		if (tiled) {
+			if (!IS_ALIGNED(mode_cmd->pitches[i],
+					EXYNOS_TILE_64_32_HALIGN)) {
+				DRM_DEV_ERROR(dev->dev,
+					      "unaligned tiled pitch %u\n",
+					      mode_cmd->pitches[i]);
+				ret = -EINVAL;
+				goto err;
+			}
+			height = ALIGN(height, EXYNOS_TILE_64_32_VALIGN);
+		}
+
+		size = height * mode_cmd->pitches[i] + mode_cmd->offsets[i];
 
 		exynos_gem[i] = exynos_drm_gem_get(file_priv,
 						   mode_cmd->handles[i]);
@@ -150,15 +197,205 @@ dma_addr_t exynos_drm_fb_dma_addr(struct drm_framebuffer *fb, int index)
 	return exynos_gem->dma_addr + fb->offsets[index];
 }
 
+static bool exynos_plane_state_is_late(struct drm_plane_state *state)
+{
+	return to_exynos_plane_state(state)->late_fence;
+}
+
+static bool exynos_atomic_has_late_planes(struct drm_atomic_state *state)
+{
+	struct drm_plane_state *new_plane_state;
+	struct drm_plane *plane;
+	int i;
+
+	for_each_new_plane_in_state(state, plane, new_plane_state, i)
+		if (exynos_plane_state_is_late(new_plane_state))
+			return true;
+
+	return false;
+}
+
+static bool exynos_atomic_crtc_has_late_planes(struct drm_atomic_state *state,
+					       struct drm_crtc *crtc)
+{
+	struct drm_plane_state *new_plane_state;
+	struct drm_plane *plane;
+	int i;
+
+	for_each_new_plane_in_state(state, plane, new_plane_state, i)
+		if (new_plane_state->crtc == crtc &&
+		    exynos_plane_state_is_late(new_plane_state))
+			return true;
+
+	return false;
+}
+
+static void exynos_atomic_commit_crtc_planes(struct drm_atomic_state *state,
+					     struct drm_crtc *crtc, bool late)
+{
+	const struct drm_crtc_helper_funcs *crtc_funcs = crtc->helper_private;
+	struct drm_plane_state *old_plane_state, *new_plane_state;
+	struct drm_plane *plane;
+	int i;
+
+	crtc_funcs->atomic_begin(crtc, state);
+
+	for_each_oldnew_plane_in_state(state, plane, old_plane_state,
+				       new_plane_state, i) {
+		const struct drm_plane_helper_funcs *funcs =
+							plane->helper_private;
+
+		if (new_plane_state->crtc != crtc &&
+		    old_plane_state->crtc != crtc)
+			continue;
+
+		if (exynos_plane_state_is_late(new_plane_state) != late)
+			continue;
+
+		if (drm_atomic_plane_disabling(old_plane_state,
+					       new_plane_state))
+			funcs->atomic_disable(plane, state);
+		else if (new_plane_state->crtc)
+			funcs->atomic_update(plane, state);
+	}
+
+	crtc_funcs->atomic_flush(crtc, state);
+}
+
+/*
+ * Program the planes whose fences have signaled right away, wait for the
+ * remaining ones and latch them on a later vblank. The pending vblank event
+ * is only armed with the last update so that userspace still gets it once
+ * the complete state is on screen.
+ */
+static void exynos_atomic_commit_planes(struct drm_device *dev,
+					struct drm_atomic_state *state)
+{
+	struct drm_crtc_state *new_crtc_state;
+	struct drm_crtc *crtc;
+	int i;
+
+	for_each_new_crtc_in_state(state, crtc, new_crtc_state, i) {
+		struct exynos_drm_crtc *exynos_crtc = to_exynos_crtc(crtc);
+		struct drm_pending_vblank_event *event;
+		struct drm_plane_state *new_plane_state;
+		struct drm_plane *plane;
+		u64 vblank;
+		int j;
+
+		if (!new_crtc_state->active)
+			continue;
+
+		if (!exynos_atomic_crtc_has_late_planes(state, crtc)) {
+			exynos_atomic_commit_crtc_planes(state, crtc, false);
+			continue;
+		}
+
+		event = new_crtc_state->event;
+		new_crtc_state->event = NULL;
+		exynos_atomic_commit_crtc_planes(state, crtc, false);
+		vblank = drm_crtc_vblank_count(crtc);
+
+		for_each_new_plane_in_state(state, plane, new_plane_state, j) {
+			struct exynos_drm_plane_state *exynos_state =
+				to_exynos_plane_state(new_plane_state);
+
+			if (new_plane_state->crtc != crtc ||
+			    !exynos_state->late_fence)
+				continue;
+
+			dma_fence_wait(exynos_state->late_fence, false);
+			exynos_crtc->deferred_planes++;
+		}
+
+		exynos_crtc->deferred_commits++;
+		exynos_crtc->vblank_misses += drm_crtc_vblank_count(crtc) -
+					      vblank;
+
+		new_crtc_state->event = event;
+		exynos_atomic_commit_crtc_planes(state, crtc, true);
+	}
+}
+
+static void exynos_atomic_commit_tail(struct drm_atomic_state *old_state)
+{
+	struct drm_device *dev = old_state->dev;
+
+	if (!exynos_atomic_has_late_planes(old_state)) {
+		drm_atomic_helper_commit_tail_rpm(old_state);
+		return;
+	}
+
+	drm_atomic_helper_commit_modeset_disables(dev, old_state);
+
+	drm_atomic_helper_commit_modeset_enables(dev, old_state);
+
+	exynos_atomic_commit_planes(dev, old_state);
+
+	drm_atomic_helper_fake_vblank(old_state);
+
+	drm_atomic_helper_commit_hw_done(old_state);
+
+	drm_atomic_helper_wait_for_vblanks(dev, old_state);
+
+	drm_atomic_helper_cleanup_planes(dev, old_state);
+}
+
+static int exynos_atomic_commit(struct drm_device *dev,
+				struct drm_atomic_state *state,
+				bool nonblock)
+{
+	struct drm_plane_state *new_plane_state;
+	struct drm_plane *plane;
+	unsigned int ready = 0, late = 0;
+	int i;
+
+	if (!READ_ONCE(plane_fence_defer))
+		return drm_atomic_helper_commit(dev, state, nonblock);
+
+	for_each_new_plane_in_state(state, plane, new_plane_state, i) {
+		if (new_plane_state->fence &&
+		    !dma_fence_is_signaled(new_plane_state->fence))
+			late++;
+		else
+			ready++;
+	}
+
+	/*
+	 * Only split the commit if there is something to show before the
+	 * late planes are ready, otherwise let the helper wait as usual.
+	 */
+	if (!late || !ready)
+		return drm_atomic_helper_commit(dev, state, nonblock);
+
+	/*
+	 * Take the unsignaled fences off the plane states, so that the
+	 * helper doesn't wait for them before the commit tail runs.
+	 */
+	for_each_new_plane_in_state(state, plane, new_plane_state, i) {
+		struct exynos_drm_plane_state *exynos_state =
+				to_exynos_plane_state(new_plane_state);
+
+		if (!new_plane_state->fence ||
+		    dma_fence_is_signaled(new_plane_state->fence))
+			continue;
+
+		exynos_state->late_fence = new_plane_state->fence;
+		new_plane_state->fence = NULL;
+	}
+
+	return drm_atomic_helper_commit(dev, state, nonblock);
+}
+
 static struct drm_mode_config_helper_funcs exynos_drm_mode_config_helpers = {
-	.atomic_commit_tail = drm_atomic_helper_commit_tail_rpm,
+	.atomic_commit_tail = exynos_atomic_commit_tail,
 };
 
 static const struct drm_mode_config_funcs exynos_drm_mode_config_funcs = {
 	.fb_create = exynos_user_fb_create,
 	.output_poll_changed = drm_fb_helper_output_poll_changed,
 	.atomic_check = drm_atomic_helper_check,
-	.atomic_commit = drm_atomic_helper_commit,
+	.atomic_commit = exynos_atomic_commit,
 };
 
 void exynos_drm_mode_config_init(struct drm_device *dev)
@@ -179,3 +416,24 @@ void exynos_drm_mode_config_init(struct drm_device *dev)
 
 	dev->mode_config.normalize_zpos = true;
 }
+
+/*
+ * Async page flips are advertised device wide, so only offer them when every
+ * crtc can do async updates. Command mode (i80) panels never pick up an async
+ * update on their own as they only refresh when a frame is triggered. Must be
+ * called once all crtcs are bound and their output mode is known.
+ */
+void exynos_drm_mode_config_init_async(struct drm_device *dev)
+{
+	struct drm_crtc *crtc;
+
+	drm_for_each_crtc(crtc, dev) {
+		struct exynos_drm_crtc *exynos_crtc = to_exynos_crtc(crtc);
+
+		if (!exynos_crtc->ops->async_update_plane ||
+		    exynos_crtc->i80_mode)
+			return;
+	}
+
+	dev->mode_config.async_page_flip = dev->mode_config.num_crtc > 0;
+}
@@ -21,5 +21,6 @@ exynos_drm_framebuffer_init(struct drm_device *dev,
 dma_addr_t exynos_drm_fb_dma_addr(struct drm_framebuffer *fb, int index);
 
 void exynos_drm_mode_config_init(struct drm_device *dev);
+void exynos_drm_mode_config_init_async(struct drm_device *dev);
 
 #endif
@@ -889,6 +889,20 @@ static void fimd_update_plane(struct exynos_drm_crtc *crtc,
 		atomic_set(&ctx->win_updated, 1);
 }
 
+static void fimd_async_update_plane(struct exynos_drm_crtc *crtc,
+				    struct exynos_drm_plane *plane)
+{
+	struct fimd_context *ctx = crtc->ctx;
+
+	if (ctx->suspended)
+		return;
+
+	/* let the window's registers latch together at the next vsync */
+	fimd_shadow_protect_win(ctx, plane->index, true);
+	fimd_update_plane(crtc, plane);
+	fimd_shadow_protect_win(ctx, plane->index, false);
+}
+
 static void fimd_disable_plane(struct exynos_drm_crtc *crtc,
 			       struct exynos_drm_plane *plane)
 {
@@ -1007,7 +1021,7 @@ static void fimd_te_handler(struct exynos_drm_crtc *crtc)
 	}
 
 	if (test_bit(0, &ctx->irq_flags))
-		drm_crtc_handle_vblank(&ctx->crtc->base);
+		exynos_drm_crtc_handle_vblank(ctx->crtc);
 }
 
 static void fimd_dp_clock_enable(struct exynos_drm_clk *clk, bool enable)
@@ -1036,6 +1050,7 @@ static const struct exynos_drm_crtc_ops fimd_crtc_ops = {
 	.disable_vblank = fimd_disable_vblank,
 	.atomic_begin = fimd_atomic_begin,
 	.update_plane = fimd_update_plane,
+	.async_update_plane = fimd_async_update_plane,
 	.disable_plane = fimd_disable_plane,
 	.atomic_flush = fimd_atomic_flush,
 	.atomic_check = fimd_atomic_check,
@@ -1058,7 +1073,7 @@ static irqreturn_t fimd_irq_handler(int irq, void *dev_id)
 		goto out;
 
 	if (!ctx->i80_if)
-		drm_crtc_handle_vblank(&ctx->crtc->base);
+		exynos_drm_crtc_handle_vblank(ctx->crtc);
 
 	if (ctx->i80_if) {
 		/* Exits triggering mode */
@@ -1103,6 +1118,8 @@ static int fimd_bind(struct device *dev, struct device *master, void *data)
 	if (IS_ERR(ctx->crtc))
 		return PTR_ERR(ctx->crtc);
 
+	ctx->crtc->i80_mode = ctx->i80_if;
+
 	if (ctx->driver_data->has_dp_clk) {
 		ctx->dp_clk.enable = fimd_dp_clock_enable;
 		ctx->crtc->pipe_clk = &ctx->dp_clk;
@@ -8,18 +8,23 @@
 #include <linux/clk.h>
 #include <linux/component.h>
 #include <linux/delay.h>
+#include <linux/dma-fence.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
+#include <linux/file.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/mmu_notifier.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/slab.h>
+#include <linux/sync_file.h>
 #include <linux/uaccess.h>
 #include <linux/workqueue.h>
 
+#include <drm/drm_debugfs.h>
 #include <drm/drm_file.h>
 #include <drm/exynos_drm.h>
 
@@ -123,6 +128,15 @@
 /* maximum buffer pool size of userptr is 64MB as default */
 #define MAX_POOL		(64 * 1024 * 1024)
 
+/*
+ * Maximum number of runqueue nodes that are chained into a single engine
+ * run, so that only one 'all commands finished' interrupt is taken for
+ * the whole batch. 1 disables batching.
+ */
+static unsigned int g2d_batch_depth = 1;
+module_param_named(g2d_batch_depth, g2d_batch_depth, uint, 0644);
+MODULE_PARM_DESC(g2d_batch_depth, "Maximum number of G2D exec requests chained into one engine run");
+
 enum {
 	BUF_TYPE_GEM = 1,
 	BUF_TYPE_USERPTR,
@@ -212,6 +226,10 @@ struct g2d_cmdlist_userptr {
 	refcount_t		refcount;
 	bool			in_pool;
 	bool			out_of_list;
+
+	struct mmu_interval_notifier	notifier;
+	unsigned long		notifier_seq;
+	bool			has_notifier;
 };
 struct g2d_cmdlist_node {
 	struct list_head	list;
@@ -226,10 +244,17 @@ struct g2d_runqueue_node {
 	struct list_head	list;
 	struct list_head	run_cmdlist;
 	struct list_head	event_list;
+	struct list_head	batch;
 	struct drm_file		*filp;
 	pid_t			pid;
 	struct completion	complete;
 	int			async;
+
+	struct g2d_data		*g2d;
+	struct dma_fence	*in_fence;
+	struct dma_fence_cb	in_fence_cb;
+	bool			in_fence_armed;
+	struct dma_fence	*out_fence;
 };
 
 struct g2d_data {
@@ -257,10 +282,51 @@ struct g2d_data {
 	struct mutex			runqueue_mutex;
 	struct kmem_cache		*runqueue_slab;
 
+	/* userptr pool, protected by userptr_mutex */
+	struct mutex			userptr_mutex;
 	unsigned long			current_pool;
 	unsigned long			max_pool;
+	unsigned long			userptr_hits;
+	unsigned long			userptr_misses;
+	unsigned long			userptr_evictions;
+	unsigned long			userptr_invalidations;
+
+	/* fences */
+	u64				fence_context;
+	atomic_t			fence_seqno;
+	spinlock_t			fence_lock;
+};
+
+static const char *g2d_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "exynos";
+}
+
+static const char *g2d_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "g2d";
+}
+
+static const struct dma_fence_ops g2d_fence_ops = {
+	.get_driver_name = g2d_fence_get_driver_name,
+	.get_timeline_name = g2d_fence_get_timeline_name,
 };
 
+static struct dma_fence *g2d_fence_create(struct g2d_data *g2d)
+{
+	struct dma_fence *fence;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return NULL;
+
+	dma_fence_init(fence, &g2d_fence_ops, &g2d->fence_lock,
+		       g2d->fence_context,
+		       atomic_inc_return(&g2d->fence_seqno));
+
+	return fence;
+}
+
 static inline void g2d_hw_reset(struct g2d_data *g2d)
 {
 	writel(G2D_R | G2D_SFRCLEAR, g2d->regs + G2D_SOFT_RESET);
@@ -375,27 +441,37 @@ static void g2d_add_cmdlist_to_inuse(struct drm_exynos_file_private *file_priv,
 		list_add_tail(&node->event->base.link, &file_priv->event_list);
 }
 
-static void g2d_userptr_put_dma_addr(struct g2d_data *g2d,
-					void *obj,
-					bool force)
+static bool g2d_userptr_invalidate(struct mmu_interval_notifier *mni,
+				   const struct mmu_notifier_range *range,
+				   unsigned long cur_seq)
 {
-	struct g2d_cmdlist_userptr *g2d_userptr = obj;
-
-	if (!obj)
-		return;
+	/*
+	 * The pages stay pinned until the userptr is released, so there is
+	 * nothing to tear down here. Bumping the sequence makes the next
+	 * lookup drop the stale mapping instead of reusing it.
+	 */
+	mmu_interval_set_seq(mni, cur_seq);
 
-	if (force)
-		goto out;
+	return true;
+}
 
-	refcount_dec(&g2d_userptr->refcount);
+static const struct mmu_interval_notifier_ops g2d_userptr_notifier_ops = {
+	.invalidate = g2d_userptr_invalidate,
+};
 
-	if (refcount_read(&g2d_userptr->refcount) > 0)
-		return;
+static bool g2d_userptr_is_stale(struct g2d_cmdlist_userptr *g2d_userptr)
+{
+	return mmu_interval_check_retry(&g2d_userptr->notifier,
+					g2d_userptr->notifier_seq);
+}
 
-	if (g2d_userptr->in_pool)
-		return;
+/* Has to be called under userptr lock. */
+static void g2d_userptr_release(struct g2d_data *g2d,
+				struct g2d_cmdlist_userptr *g2d_userptr)
+{
+	if (g2d_userptr->has_notifier)
+		mmu_interval_notifier_remove(&g2d_userptr->notifier);
 
-out:
 	dma_unmap_sgtable(to_dma_dev(g2d->drm_dev), g2d_userptr->sgt,
 			  DMA_BIDIRECTIONAL, 0);
 
@@ -406,11 +482,67 @@ static void g2d_userptr_put_dma_addr(struct g2d_data *g2d,
 	if (!g2d_userptr->out_of_list)
 		list_del_init(&g2d_userptr->list);
 
+	if (g2d_userptr->in_pool)
+		g2d->current_pool -= g2d_userptr->npages << PAGE_SHIFT;
+
 	sg_free_table(g2d_userptr->sgt);
 	kfree(g2d_userptr->sgt);
 	kfree(g2d_userptr);
 }
 
+/*
+ * Evict idle userptr mappings of the file, least recently used first,
+ * until @size more bytes fit into the pool.
+ *
+ * Has to be called under userptr lock.
+ */
+static void g2d_userptr_evict(struct g2d_data *g2d,
+			      struct drm_exynos_file_private *file_priv,
+			      unsigned long size)
+{
+	struct g2d_cmdlist_userptr *g2d_userptr, *n;
+
+	list_for_each_entry_safe(g2d_userptr, n, &file_priv->userptr_list,
+				 list) {
+		if (g2d->current_pool + size <= g2d->max_pool)
+			break;
+
+		if (!g2d_userptr->in_pool ||
+		    refcount_read(&g2d_userptr->refcount))
+			continue;
+
+		g2d_userptr_release(g2d, g2d_userptr);
+		g2d->userptr_evictions++;
+	}
+}
+
+static void g2d_userptr_put_dma_addr(struct g2d_data *g2d,
+					void *obj,
+					bool force)
+{
+	struct g2d_cmdlist_userptr *g2d_userptr = obj;
+
+	if (!obj)
+		return;
+
+	mutex_lock(&g2d->userptr_mutex);
+
+	if (force)
+		goto out;
+
+	if (!refcount_dec_and_test(&g2d_userptr->refcount))
+		goto unlock;
+
+	/* idle mappings in the pool are kept around for reuse. */
+	if (g2d_userptr->in_pool)
+		goto unlock;
+
+out:
+	g2d_userptr_release(g2d, g2d_userptr);
+unlock:
+	mutex_unlock(&g2d->userptr_mutex);
+}
+
 static dma_addr_t *g2d_userptr_get_dma_addr(struct g2d_data *g2d,
 					unsigned long userptr,
 					unsigned long size,
@@ -429,20 +561,32 @@ static dma_addr_t *g2d_userptr_get_dma_addr(struct g2d_data *g2d,
 		return ERR_PTR(-EINVAL);
 	}
 
+	mutex_lock(&g2d->userptr_mutex);
+
 	/* check if userptr already exists in userptr_list. */
 	list_for_each_entry(g2d_userptr, &file_priv->userptr_list, list) {
 		if (g2d_userptr->userptr == userptr) {
+			bool stale = g2d_userptr_is_stale(g2d_userptr);
+
 			/*
 			 * also check size because there could be same address
 			 * and different size.
 			 */
-			if (g2d_userptr->size == size) {
-				refcount_inc(&g2d_userptr->refcount);
+			if (g2d_userptr->size == size && !stale) {
+				if (!refcount_inc_not_zero(&g2d_userptr->refcount))
+					refcount_set(&g2d_userptr->refcount, 1);
+				list_move_tail(&g2d_userptr->list,
+					       &file_priv->userptr_list);
+				g2d->userptr_hits++;
+				mutex_unlock(&g2d->userptr_mutex);
 				*obj = g2d_userptr;
 
 				return &g2d_userptr->dma_addr;
 			}
 
+			if (stale)
+				g2d->userptr_invalidations++;
+
 			/*
 			 * at this moment, maybe g2d dma is accessing this
 			 * g2d_userptr memory region so just remove this
@@ -450,17 +594,29 @@ static dma_addr_t *g2d_userptr_get_dma_addr(struct g2d_data *g2d,
 			 * referred again and also except it the userptr
 			 * pool to be released after the dma access completion.
 			 */
-			g2d_userptr->out_of_list = true;
-			g2d_userptr->in_pool = false;
 			list_del_init(&g2d_userptr->list);
+			g2d_userptr->out_of_list = true;
+			if (g2d_userptr->in_pool) {
+				g2d->current_pool -=
+					g2d_userptr->npages << PAGE_SHIFT;
+				g2d_userptr->in_pool = false;
+			}
+
+			/* nobody is using it, so it can go right away. */
+			if (!refcount_read(&g2d_userptr->refcount))
+				g2d_userptr_release(g2d, g2d_userptr);
 
 			break;
 		}
 	}
 
+	g2d->userptr_misses++;
+
 	g2d_userptr = kzalloc(sizeof(*g2d_userptr), GFP_KERNEL);
-	if (!g2d_userptr)
-		return ERR_PTR(-ENOMEM);
+	if (!g2d_userptr) {
+		ret = -ENOMEM;
+		goto err_unlock;
+	}
 
 	refcount_set(&g2d_userptr->refcount, 1);
 	g2d_userptr->size = size;
@@ -516,13 +672,34 @@ static dma_addr_t *g2d_userptr_get_dma_addr(struct g2d_data *g2d,
 	g2d_userptr->dma_addr = sgt->sgl[0].dma_address;
 	g2d_userptr->userptr = userptr;
 
+	/*
+	 * Without a notifier a later lookup can't tell whether the mapping
+	 * is still valid, so such a userptr is never cached.
+	 */
+	if (!mmu_interval_notifier_insert(&g2d_userptr->notifier,
+					  current->mm, start,
+					  npages << PAGE_SHIFT,
+					  &g2d_userptr_notifier_ops)) {
+		g2d_userptr->has_notifier = true;
+		g2d_userptr->notifier_seq =
+			mmu_interval_read_begin(&g2d_userptr->notifier);
+	}
+
+	if (!g2d_userptr->has_notifier) {
+		g2d_userptr->out_of_list = true;
+		goto out;
+	}
+
 	list_add_tail(&g2d_userptr->list, &file_priv->userptr_list);
 
-	if (g2d->current_pool + (npages << PAGE_SHIFT) < g2d->max_pool) {
+	g2d_userptr_evict(g2d, file_priv, npages << PAGE_SHIFT);
+	if (g2d->current_pool + (npages << PAGE_SHIFT) <= g2d->max_pool) {
 		g2d->current_pool += npages << PAGE_SHIFT;
 		g2d_userptr->in_pool = true;
 	}
 
+out:
+	mutex_unlock(&g2d->userptr_mutex);
 	*obj = g2d_userptr;
 
 	return &g2d_userptr->dma_addr;
@@ -542,6 +719,9 @@ static dma_addr_t *g2d_userptr_get_dma_addr(struct g2d_data *g2d,
 err_free:
 	kfree(g2d_userptr);
 
+err_unlock:
+	mutex_unlock(&g2d->userptr_mutex);
+
 	return ERR_PTR(ret);
 }
 
@@ -550,11 +730,11 @@ static void g2d_userptr_free_all(struct g2d_data *g2d, struct drm_file *filp)
 	struct drm_exynos_file_private *file_priv = filp->driver_priv;
 	struct g2d_cmdlist_userptr *g2d_userptr, *n;
 
+	mutex_lock(&g2d->userptr_mutex);
 	list_for_each_entry_safe(g2d_userptr, n, &file_priv->userptr_list, list)
 		if (g2d_userptr->in_pool)
-			g2d_userptr_put_dma_addr(g2d, g2d_userptr, true);
-
-	g2d->current_pool = 0;
+			g2d_userptr_release(g2d, g2d_userptr);
+	mutex_unlock(&g2d->userptr_mutex);
 }
 
 static enum g2d_reg_type g2d_get_reg_type(struct g2d_data *g2d, int reg_offset)
@@ -803,11 +983,60 @@ static void g2d_dma_start(struct g2d_data *g2d,
 				list_first_entry(&runqueue_node->run_cmdlist,
 						struct g2d_cmdlist_node, list);
 
+	/* make sure the cmdlist chain is visible to the engine */
+	wmb();
+
 	set_bit(G2D_BIT_ENGINE_BUSY, &g2d->flags);
 	writel_relaxed(node->dma_addr, g2d->regs + G2D_DMA_SFR_BASE_ADDR);
 	writel_relaxed(G2D_DMA_START, g2d->regs + G2D_DMA_COMMAND);
 }
 
+static void g2d_in_fence_cb(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct g2d_runqueue_node *runqueue_node =
+		container_of(cb, struct g2d_runqueue_node, in_fence_cb);
+	struct g2d_data *g2d = runqueue_node->g2d;
+
+	queue_work(g2d->g2d_workq, &g2d->runqueue_work);
+}
+
+/*
+ * Check whether the in-fence of the runqueue node has been signaled. If
+ * not, arm a callback that pokes the runqueue worker once it signals.
+ *
+ * Has to be called under runqueue lock.
+ */
+static bool g2d_runqueue_node_ready(struct g2d_runqueue_node *runqueue_node)
+{
+	int ret;
+
+	if (!runqueue_node->in_fence)
+		return true;
+
+	if (runqueue_node->in_fence_armed)
+		return dma_fence_is_signaled(runqueue_node->in_fence);
+
+	ret = dma_fence_add_callback(runqueue_node->in_fence,
+				     &runqueue_node->in_fence_cb,
+				     g2d_in_fence_cb);
+	if (ret == -ENOENT)
+		return true;
+
+	runqueue_node->in_fence_armed = true;
+	return false;
+}
+
+static void g2d_signal_runqueue_node(struct g2d_runqueue_node *runqueue_node,
+				     int error)
+{
+	if (!runqueue_node->out_fence)
+		return;
+
+	if (error)
+		dma_fence_set_error(runqueue_node->out_fence, error);
+	dma_fence_signal(runqueue_node->out_fence);
+}
+
 static struct g2d_runqueue_node *g2d_get_runqueue_node(struct g2d_data *g2d)
 {
 	struct g2d_runqueue_node *runqueue_node;
@@ -817,10 +1046,53 @@ static struct g2d_runqueue_node *g2d_get_runqueue_node(struct g2d_data *g2d)
 
 	runqueue_node = list_first_entry(&g2d->runqueue,
 					 struct g2d_runqueue_node, list);
+
+	/*
+	 * Nodes are executed in submission order, so a node waiting for its
+	 * in-fence also holds back the nodes queued after it.
+	 */
+	if (!g2d_runqueue_node_ready(runqueue_node))
+		return NULL;
+
 	list_del_init(&runqueue_node->list);
 	return runqueue_node;
 }
 
+/*
+ * Chain further ready runqueue nodes behind the last cmdlist of
+ * @runqueue_node, up to g2d_batch_depth nodes in total. The chained
+ * nodes are linked into the batch list of @runqueue_node.
+ *
+ * Has to be called under runqueue lock.
+ */
+static void g2d_build_batch(struct g2d_data *g2d,
+			    struct g2d_runqueue_node *runqueue_node)
+{
+	struct g2d_runqueue_node *prev = runqueue_node;
+	struct g2d_runqueue_node *next;
+	unsigned int depth = 1;
+
+	while (depth < READ_ONCE(g2d_batch_depth)) {
+		struct g2d_cmdlist_node *lnode, *fnode;
+
+		next = g2d_get_runqueue_node(g2d);
+		if (!next)
+			break;
+
+		lnode = list_last_entry(&prev->run_cmdlist,
+					struct g2d_cmdlist_node, list);
+		fnode = list_first_entry(&next->run_cmdlist,
+					 struct g2d_cmdlist_node, list);
+
+		/* this links to base address of the next node's cmdlist */
+		lnode->cmdlist->data[lnode->cmdlist->last] = fnode->dma_addr;
+
+		list_add_tail(&next->list, &runqueue_node->batch);
+		prev = next;
+		depth++;
+	}
+}
+
 static void g2d_free_runqueue_node(struct g2d_data *g2d,
 				   struct g2d_runqueue_node *runqueue_node)
 {
@@ -836,9 +1108,68 @@ static void g2d_free_runqueue_node(struct g2d_data *g2d,
 	list_splice_tail_init(&runqueue_node->run_cmdlist, &g2d->free_cmdlist);
 	mutex_unlock(&g2d->cmdlist_mutex);
 
+	if (runqueue_node->in_fence) {
+		if (runqueue_node->in_fence_armed)
+			dma_fence_remove_callback(runqueue_node->in_fence,
+						  &runqueue_node->in_fence_cb);
+		dma_fence_put(runqueue_node->in_fence);
+	}
+
+	/* a node dropped before execution must not leave its fence pending */
+	if (runqueue_node->out_fence) {
+		if (!dma_fence_is_signaled(runqueue_node->out_fence)) {
+			dma_fence_set_error(runqueue_node->out_fence,
+					    -ECANCELED);
+			dma_fence_signal(runqueue_node->out_fence);
+		}
+		dma_fence_put(runqueue_node->out_fence);
+	}
+
 	kmem_cache_free(g2d->runqueue_slab, runqueue_node);
 }
 
+static bool g2d_batch_has_file(struct g2d_runqueue_node *runqueue_node,
+			       struct drm_file *file)
+{
+	struct g2d_runqueue_node *node;
+
+	if (runqueue_node->filp == file)
+		return true;
+
+	list_for_each_entry(node, &runqueue_node->batch, list)
+		if (node->filp == file)
+			return true;
+
+	return false;
+}
+
+static void g2d_complete_runqueue_node(struct g2d_data *g2d,
+				       struct g2d_runqueue_node *runqueue_node,
+				       int error)
+{
+	/* a synchronous node may be freed as soon as it is completed */
+	bool async = runqueue_node->async;
+
+	g2d_signal_runqueue_node(runqueue_node, error);
+	complete(&runqueue_node->complete);
+	if (async)
+		g2d_free_runqueue_node(g2d, runqueue_node);
+}
+
+static void g2d_complete_batch(struct g2d_data *g2d,
+			       struct g2d_runqueue_node *runqueue_node,
+			       int error)
+{
+	struct g2d_runqueue_node *node, *n;
+
+	list_for_each_entry_safe(node, n, &runqueue_node->batch, list) {
+		list_del_init(&node->list);
+		g2d_complete_runqueue_node(g2d, node, error);
+	}
+
+	g2d_complete_runqueue_node(g2d, runqueue_node, error);
+}
+
 /**
  * g2d_remove_runqueue_nodes - remove items from the list of runqueue nodes
  * @g2d: G2D state object
@@ -884,9 +1215,7 @@ static void g2d_runqueue_worker(struct work_struct *work)
 		pm_runtime_mark_last_busy(g2d->dev);
 		pm_runtime_put_autosuspend(g2d->dev);
 
-		complete(&runqueue_node->complete);
-		if (runqueue_node->async)
-			g2d_free_runqueue_node(g2d, runqueue_node);
+		g2d_complete_batch(g2d, runqueue_node, 0);
 	}
 
 	if (!test_bit(G2D_BIT_SUSPEND_RUNQUEUE, &g2d->flags)) {
@@ -901,6 +1230,7 @@ static void g2d_runqueue_worker(struct work_struct *work)
 				goto out;
 			}
 
+			g2d_build_batch(g2d, g2d->runqueue_node);
 			g2d_dma_start(g2d, g2d->runqueue_node);
 		}
 	}
@@ -916,8 +1246,20 @@ static void g2d_finish_event(struct g2d_data *g2d, u32 cmdlist_no)
 	struct drm_exynos_pending_g2d_event *e;
 	struct timespec64 now;
 
-	if (list_empty(&runqueue_node->event_list))
-		return;
+	/* events are sent in order, so pick the first node that has any */
+	if (list_empty(&runqueue_node->event_list)) {
+		struct g2d_runqueue_node *node;
+
+		list_for_each_entry(node, &runqueue_node->batch, list) {
+			if (!list_empty(&node->event_list)) {
+				runqueue_node = node;
+				break;
+			}
+		}
+
+		if (list_empty(&runqueue_node->event_list))
+			return;
+	}
 
 	e = list_first_entry(&runqueue_node->event_list,
 			     struct drm_exynos_pending_g2d_event, base.link);
@@ -986,8 +1328,8 @@ static void g2d_wait_finish(struct g2d_data *g2d, struct drm_file *file)
 
 	runqueue_node = g2d->runqueue_node;
 
-	/* Check if the currently processed item belongs to us. */
-	if (file && runqueue_node->filp != file)
+	/* Check if the currently processed batch contains items of ours. */
+	if (file && !g2d_batch_has_file(runqueue_node, file))
 		goto out;
 
 	mutex_unlock(&g2d->runqueue_mutex);
@@ -1012,9 +1354,7 @@ static void g2d_wait_finish(struct g2d_data *g2d, struct drm_file *file)
 	pm_runtime_mark_last_busy(dev);
 	pm_runtime_put_autosuspend(dev);
 
-	complete(&runqueue_node->complete);
-	if (runqueue_node->async)
-		g2d_free_runqueue_node(g2d, runqueue_node);
+	g2d_complete_batch(g2d, runqueue_node, -ETIMEDOUT);
 
 out:
 	mutex_unlock(&g2d->runqueue_mutex);
@@ -1305,8 +1645,14 @@ int exynos_g2d_exec_ioctl(struct drm_device *drm_dev, void *data,
 	struct g2d_runqueue_node *runqueue_node;
 	struct list_head *run_cmdlist;
 	struct list_head *event_list;
+	struct sync_file *sync_file = NULL;
+	int out_fence_fd = -1;
+	int ret;
+
+	if (req->flags & ~G2D_EXEC_FLAGS)
+		return -EINVAL;
 
-	runqueue_node = kmem_cache_alloc(g2d->runqueue_slab, GFP_KERNEL);
+	runqueue_node = kmem_cache_zalloc(g2d->runqueue_slab, GFP_KERNEL);
 	if (!runqueue_node)
 		return -ENOMEM;
 
@@ -1314,16 +1660,46 @@ int exynos_g2d_exec_ioctl(struct drm_device *drm_dev, void *data,
 	event_list = &runqueue_node->event_list;
 	INIT_LIST_HEAD(run_cmdlist);
 	INIT_LIST_HEAD(event_list);
+	INIT_LIST_HEAD(&runqueue_node->batch);
 	init_completion(&runqueue_node->complete);
 	runqueue_node->async = req->async;
+	runqueue_node->g2d = g2d;
+
+	if (req->flags & G2D_EXEC_FENCE_IN) {
+		runqueue_node->in_fence = sync_file_get_fence(req->fence_fd);
+		if (!runqueue_node->in_fence) {
+			ret = -EINVAL;
+			goto err_free_node;
+		}
+	}
+
+	if (req->flags & G2D_EXEC_FENCE_OUT) {
+		out_fence_fd = get_unused_fd_flags(O_CLOEXEC);
+		if (out_fence_fd < 0) {
+			ret = out_fence_fd;
+			goto err_put_fence;
+		}
+
+		runqueue_node->out_fence = g2d_fence_create(g2d);
+		if (!runqueue_node->out_fence) {
+			ret = -ENOMEM;
+			goto err_put_fd;
+		}
+
+		sync_file = sync_file_create(runqueue_node->out_fence);
+		if (!sync_file) {
+			ret = -ENOMEM;
+			goto err_put_fd;
+		}
+	}
 
 	list_splice_init(&file_priv->inuse_cmdlist, run_cmdlist);
 	list_splice_init(&file_priv->event_list, event_list);
 
 	if (list_empty(run_cmdlist)) {
 		dev_err(g2d->dev, "there is no inuse cmdlist\n");
-		kmem_cache_free(g2d->runqueue_slab, runqueue_node);
-		return -EPERM;
+		ret = -EPERM;
+		goto err_put_sync_file;
 	}
 
 	mutex_lock(&g2d->runqueue_mutex);
@@ -1332,6 +1708,11 @@ int exynos_g2d_exec_ioctl(struct drm_device *drm_dev, void *data,
 	list_add_tail(&runqueue_node->list, &g2d->runqueue);
 	mutex_unlock(&g2d->runqueue_mutex);
 
+	if (sync_file) {
+		fd_install(out_fence_fd, sync_file->file);
+		req->fence_fd = out_fence_fd;
+	}
+
 	/* Let the runqueue know that there is work to do. */
 	queue_work(g2d->g2d_workq, &g2d->runqueue_work);
 
@@ -1343,8 +1724,61 @@ int exynos_g2d_exec_ioctl(struct drm_device *drm_dev, void *data,
 
 out:
 	return 0;
+
+err_put_sync_file:
+	if (sync_file)
+		fput(sync_file->file);
+err_put_fd:
+	if (out_fence_fd >= 0)
+		put_unused_fd(out_fence_fd);
+err_put_fence:
+	if (runqueue_node->out_fence) {
+		dma_fence_set_error(runqueue_node->out_fence, -ECANCELED);
+		dma_fence_signal(runqueue_node->out_fence);
+		dma_fence_put(runqueue_node->out_fence);
+	}
+	dma_fence_put(runqueue_node->in_fence);
+err_free_node:
+	kmem_cache_free(g2d->runqueue_slab, runqueue_node);
+	return ret;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int g2d_userptr_show(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = m->private;
+	struct exynos_drm_private *priv = node->minor->dev->dev_private;
+	struct g2d_data *g2d;
+
+	if (!priv->g2d_dev)
+		return -ENODEV;
+
+	g2d = dev_get_drvdata(priv->g2d_dev);
+
+	mutex_lock(&g2d->userptr_mutex);
+	seq_printf(m, "pool:          %lu / %lu bytes\n",
+		   g2d->current_pool, g2d->max_pool);
+	seq_printf(m, "hits:          %lu\n", g2d->userptr_hits);
+	seq_printf(m, "misses:        %lu\n", g2d->userptr_misses);
+	seq_printf(m, "evictions:     %lu\n", g2d->userptr_evictions);
+	seq_printf(m, "invalidations: %lu\n", g2d->userptr_invalidations);
+	mutex_unlock(&g2d->userptr_mutex);
+
+	return 0;
 }
 
+static const struct drm_info_list g2d_debugfs_list[] = {
+	{ "g2d_userptr", g2d_userptr_show, 0 },
+};
+
+void g2d_debugfs_init(struct drm_minor *minor)
+{
+	drm_debugfs_create_files(g2d_debugfs_list,
+				 ARRAY_SIZE(g2d_debugfs_list),
+				 minor->debugfs_root, minor);
+}
+#endif
+
 int g2d_open(struct drm_device *drm_dev, struct drm_file *file)
 {
 	struct drm_exynos_file_private *file_priv = file->driver_priv;
@@ -1476,6 +1910,7 @@ static int g2d_probe(struct platform_device *pdev)
 
 	mutex_init(&g2d->cmdlist_mutex);
 	mutex_init(&g2d->runqueue_mutex);
+	mutex_init(&g2d->userptr_mutex);
 
 	g2d->gate_clk = devm_clk_get(dev, "fimg2d");
 	if (IS_ERR(g2d->gate_clk)) {
@@ -1511,6 +1946,9 @@ static int g2d_probe(struct platform_device *pdev)
 
 	g2d->max_pool = MAX_POOL;
 
+	spin_lock_init(&g2d->fence_lock);
+	g2d->fence_context = dma_fence_context_alloc(1);
+
 	platform_set_drvdata(pdev, g2d);
 
 	ret = component_add(dev, &g2d_component_ops);
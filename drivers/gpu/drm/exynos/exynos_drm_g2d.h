@@ -42,3 +42,10 @@ static inline int g2d_open(struct drm_device *drm_dev, struct drm_file *file)
 static inline void g2d_close(struct drm_device *drm_dev, struct drm_file *file)
 { }
 #endif
+
+#if defined(CONFIG_DRM_EXYNOS_G2D) && defined(CONFIG_DEBUG_FS)
+extern void g2d_debugfs_init(struct drm_minor *minor);
+#else
+static inline void g2d_debugfs_init(struct drm_minor *minor)
+{ }
+#endif
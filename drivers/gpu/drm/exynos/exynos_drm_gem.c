@@ -192,6 +192,13 @@ struct exynos_drm_gem *exynos_drm_gem_create(struct drm_device *dev,
 		return ERR_PTR(-EINVAL);
 	}
 
+	/*
+	 * 64x32 tiles are laid out in pairs of 4 KiB, so a tiled plane
+	 * always ends on an 8 KiB boundary.
+	 */
+	if (flags & EXYNOS_BO_TILE_64_32)
+		size = ALIGN(size, EXYNOS_TILE_64_32_SALIGN);
+
 	size = roundup(size, PAGE_SIZE);
 
 	exynos_gem = exynos_drm_gem_init(dev, size);
@@ -406,6 +413,23 @@ int exynos_drm_gem_mmap(struct file *filp, struct vm_area_struct *vma)
 }
 
 /* low-level interface prime helpers */
+
+/*
+ * Importing decoded video frames (e.g. s5p-mfc CAPTURE buffers):
+ *
+ * Export every CAPTURE plane once after VIDIOC_REQBUFS with VIDIOC_EXPBUF
+ * and import each dma-buf once with DRM_IOCTL_PRIME_FD_TO_HANDLE. Keep the
+ * GEM handles, and a framebuffer per CAPTURE buffer (NV12MT planes need
+ * DRM_FORMAT_MOD_SAMSUNG_64_32_TILE), for the lifetime of the stream and
+ * pick the framebuffer by the index of each dequeued buffer.
+ *
+ * The attachment is mapped into the DRM IOMMU domain only here, at import
+ * time; flipping to an already imported buffer does no mapping work. Every
+ * VIDIOC_EXPBUF call creates a new dma-buf though, so exporting again per
+ * frame means a new import and a new mapping per frame. The buffer is
+ * handed back to the decoder with VIDIOC_QBUF once the flip away from it
+ * has completed.
+ */
 struct drm_gem_object *exynos_drm_gem_prime_import(struct drm_device *dev,
 					    struct dma_buf *dma_buf)
 {
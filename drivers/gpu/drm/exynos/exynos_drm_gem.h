@@ -10,11 +10,17 @@
 
 #include <drm/drm_gem.h>
 #include <linux/mm_types.h>
+#include <linux/sizes.h>
 
 #define to_exynos_gem(x)	container_of(x, struct exynos_drm_gem, base)
 
 #define IS_NONCONTIG_BUFFER(f)		(f & EXYNOS_BO_NONCONTIG)
 
+/* NV12MT (DRM_FORMAT_MOD_SAMSUNG_64_32_TILE) layout constraints, in bytes */
+#define EXYNOS_TILE_64_32_HALIGN	128
+#define EXYNOS_TILE_64_32_VALIGN	32
+#define EXYNOS_TILE_64_32_SALIGN	SZ_8K
+
 /*
  * exynos drm buffer structure.
  *
@@ -16,6 +16,9 @@
  * all copies or substantial portions of the Software.
  */
 
+#include <linux/dma-fence.h>
+#include <linux/file.h>
+#include <linux/sync_file.h>
 #include <linux/uaccess.h>
 
 #include <drm/drm_file.h>
@@ -30,6 +33,8 @@
 static int num_ipp;
 static LIST_HEAD(ipp_list);
 
+static void exynos_drm_ipp_run_work(struct work_struct *work);
+
 /**
  * exynos_drm_ipp_register - Register a new picture processor hardware module
  * @dev: DRM device
@@ -58,6 +63,7 @@ int exynos_drm_ipp_register(struct device *dev, struct exynos_drm_ipp *ipp,
 	spin_lock_init(&ipp->lock);
 	INIT_LIST_HEAD(&ipp->todo_list);
 	init_waitqueue_head(&ipp->done_wq);
+	INIT_WORK(&ipp->run_work, exynos_drm_ipp_run_work);
 	ipp->dev = dev;
 	ipp->funcs = funcs;
 	ipp->capabilities = caps;
@@ -82,6 +88,7 @@ int exynos_drm_ipp_register(struct device *dev, struct exynos_drm_ipp *ipp,
 void exynos_drm_ipp_unregister(struct device *dev,
 			       struct exynos_drm_ipp *ipp)
 {
+	cancel_work_sync(&ipp->run_work);
 	WARN_ON(ipp->task);
 	WARN_ON(!list_empty(&ipp->todo_list));
 	list_del(&ipp->head);
@@ -253,6 +260,27 @@ struct drm_pending_exynos_ipp_event {
 	struct drm_exynos_ipp_event event;
 };
 
+/* out-fences may outlive the ipp module, so they carry their own lock */
+struct exynos_drm_ipp_fence {
+	struct dma_fence base;
+	spinlock_t lock;
+};
+
+static const char *exynos_drm_ipp_fence_get_driver_name(struct dma_fence *f)
+{
+	return "exynos";
+}
+
+static const char *exynos_drm_ipp_fence_get_timeline_name(struct dma_fence *f)
+{
+	return "ipp";
+}
+
+static const struct dma_fence_ops exynos_drm_ipp_fence_ops = {
+	.get_driver_name = exynos_drm_ipp_fence_get_driver_name,
+	.get_timeline_name = exynos_drm_ipp_fence_get_timeline_name,
+};
+
 static inline struct exynos_drm_ipp_task *
 			exynos_drm_ipp_task_alloc(struct exynos_drm_ipp *ipp)
 {
@@ -399,6 +427,15 @@ static void exynos_drm_ipp_task_free(struct exynos_drm_ipp *ipp,
 	exynos_drm_ipp_task_release_buf(&task->dst);
 	if (task->event)
 		drm_event_cancel_free(ipp->drm_dev, &task->event->base);
+	dma_fence_put(task->in_fence);
+	if (task->out_fence) {
+		/* task has been aborted before it could run */
+		if (!dma_fence_is_signaled(task->out_fence)) {
+			dma_fence_set_error(task->out_fence, -ECANCELED);
+			dma_fence_signal(task->out_fence);
+		}
+		dma_fence_put(task->out_fence);
+	}
 	kfree(task);
 }
 
@@ -717,6 +754,26 @@ static int exynos_drm_ipp_event_create(struct exynos_drm_ipp_task *task,
 	return ret;
 }
 
+static int exynos_drm_ipp_out_fence_create(struct exynos_drm_ipp_task *task)
+{
+	struct exynos_drm_ipp_fence *f;
+
+	f = kzalloc(sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return -ENOMEM;
+
+	/*
+	 * Tasks waiting for in-fences may finish out of submission order,
+	 * so every out-fence gets a context of its own.
+	 */
+	spin_lock_init(&f->lock);
+	dma_fence_init(&f->base, &exynos_drm_ipp_fence_ops, &f->lock,
+		       dma_fence_context_alloc(1), 1);
+
+	task->out_fence = &f->base;
+	return 0;
+}
+
 static void exynos_drm_ipp_event_send(struct exynos_drm_ipp_task *task)
 {
 	struct timespec64 now;
@@ -773,7 +830,14 @@ void exynos_drm_ipp_task_done(struct exynos_drm_ipp_task *task, int ret)
 	task->ret = ret;
 	spin_unlock_irqrestore(&ipp->lock, flags);
 
+	/* start the next queued task right away to keep the hardware busy */
 	exynos_drm_ipp_next_task(ipp);
+
+	if (task->out_fence) {
+		if (ret)
+			dma_fence_set_error(task->out_fence, ret);
+		dma_fence_signal(task->out_fence);
+	}
 	wake_up(&ipp->done_wq);
 
 	if (task->flags & DRM_EXYNOS_IPP_TASK_ASYNC) {
@@ -814,13 +878,42 @@ static void exynos_drm_ipp_next_task(struct exynos_drm_ipp *ipp)
 		exynos_drm_ipp_task_done(task, ret);
 }
 
+static void exynos_drm_ipp_run_work(struct work_struct *work)
+{
+	struct exynos_drm_ipp *ipp = container_of(work, struct exynos_drm_ipp,
+						  run_work);
+
+	exynos_drm_ipp_next_task(ipp);
+}
+
+static void exynos_drm_ipp_in_fence_cb(struct dma_fence *fence,
+				       struct dma_fence_cb *cb)
+{
+	struct exynos_drm_ipp_task *task = container_of(cb,
+					struct exynos_drm_ipp_task, in_cb);
+	struct exynos_drm_ipp *ipp = task->ipp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ipp->lock, flags);
+	list_add_tail(&task->head, &ipp->todo_list);
+	spin_unlock_irqrestore(&ipp->lock, flags);
+
+	/* commit() may sleep, so don't call it from the signaling context */
+	schedule_work(&ipp->run_work);
+}
+
 static void exynos_drm_ipp_schedule_task(struct exynos_drm_ipp *ipp,
 					 struct exynos_drm_ipp_task *task)
 {
 	unsigned long flags;
 
+	if (task->in_fence &&
+	    !dma_fence_add_callback(task->in_fence, &task->in_cb,
+				    exynos_drm_ipp_in_fence_cb))
+		return;
+
 	spin_lock_irqsave(&ipp->lock, flags);
-	list_add(&task->head, &ipp->todo_list);
+	list_add_tail(&task->head, &ipp->todo_list);
 	spin_unlock_irqrestore(&ipp->lock, flags);
 
 	exynos_drm_ipp_next_task(ipp);
@@ -831,6 +924,13 @@ static void exynos_drm_ipp_task_abort(struct exynos_drm_ipp *ipp,
 {
 	unsigned long flags;
 
+	/* still waiting for the in-fence, so not queued anywhere */
+	if (task->in_fence &&
+	    dma_fence_remove_callback(task->in_fence, &task->in_cb)) {
+		exynos_drm_ipp_task_cleanup(task);
+		return;
+	}
+
 	spin_lock_irqsave(&ipp->lock, flags);
 	if (task->flags & DRM_EXYNOS_IPP_TASK_DONE) {
 		/* already completed task */
@@ -873,14 +973,26 @@ int exynos_drm_ipp_commit_ioctl(struct drm_device *dev, void *data,
 	struct drm_exynos_ioctl_ipp_commit *arg = data;
 	struct exynos_drm_ipp *ipp;
 	struct exynos_drm_ipp_task *task;
+	struct sync_file *sync_file = NULL;
+	int out_fd = -1;
 	int ret = 0;
 
-	if ((arg->flags & ~DRM_EXYNOS_IPP_FLAGS) || arg->reserved)
+	if (arg->flags & ~DRM_EXYNOS_IPP_FLAGS)
+		return -EINVAL;
+
+	if (!(arg->flags & (DRM_EXYNOS_IPP_FLAG_IN_FENCE |
+			    DRM_EXYNOS_IPP_FLAG_OUT_FENCE)) && arg->reserved)
 		return -EINVAL;
 
-	/* can't test and expect an event at the same time */
+	/* can't test and expect an event or fence at the same time */
 	if ((arg->flags & DRM_EXYNOS_IPP_FLAG_TEST_ONLY) &&
-			(arg->flags & DRM_EXYNOS_IPP_FLAG_EVENT))
+			(arg->flags & (DRM_EXYNOS_IPP_FLAG_EVENT |
+				       DRM_EXYNOS_IPP_FLAG_OUT_FENCE)))
+		return -EINVAL;
+
+	/* an out-fence is only useful for queued tasks */
+	if ((arg->flags & DRM_EXYNOS_IPP_FLAG_OUT_FENCE) &&
+			!(arg->flags & DRM_EXYNOS_IPP_FLAG_NONBLOCK))
 		return -EINVAL;
 
 	ipp = __ipp_get(arg->ipp_id);
@@ -910,6 +1022,33 @@ int exynos_drm_ipp_commit_ioctl(struct drm_device *dev, void *data,
 			goto free;
 	}
 
+	if (arg->flags & DRM_EXYNOS_IPP_FLAG_IN_FENCE) {
+		task->in_fence = sync_file_get_fence(arg->fence_fd);
+		if (!task->in_fence) {
+			ret = -EINVAL;
+			goto free;
+		}
+	}
+
+	if (arg->flags & DRM_EXYNOS_IPP_FLAG_OUT_FENCE) {
+		ret = exynos_drm_ipp_out_fence_create(task);
+		if (ret)
+			goto free;
+
+		out_fd = get_unused_fd_flags(O_CLOEXEC);
+		if (out_fd < 0) {
+			ret = out_fd;
+			goto free;
+		}
+
+		sync_file = sync_file_create(task->out_fence);
+		if (!sync_file) {
+			put_unused_fd(out_fd);
+			ret = -ENOMEM;
+			goto free;
+		}
+	}
+
 	/*
 	 * Queue task for processing on the hardware. task object will be
 	 * then freed after exynos_drm_ipp_task_done()
@@ -919,6 +1058,11 @@ int exynos_drm_ipp_commit_ioctl(struct drm_device *dev, void *data,
 				     "ipp: %d, nonblocking processing task %pK\n",
 				     ipp->id, task);
 
+		if (sync_file) {
+			fd_install(out_fd, sync_file->file);
+			arg->fence_fd = out_fd;
+		}
+
 		task->flags |= DRM_EXYNOS_IPP_TASK_ASYNC;
 		exynos_drm_ipp_schedule_task(task->ipp, task);
 		ret = 0;
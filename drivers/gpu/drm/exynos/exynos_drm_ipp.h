@@ -6,6 +6,8 @@
 #ifndef _EXYNOS_DRM_IPP_H_
 #define _EXYNOS_DRM_IPP_H_
 
+#include <linux/dma-fence.h>
+
 struct exynos_drm_ipp;
 struct exynos_drm_ipp_task;
 
@@ -64,6 +66,7 @@ struct exynos_drm_ipp {
 	struct exynos_drm_ipp_task *task;
 	struct list_head todo_list;
 	wait_queue_head_t done_wq;
+	struct work_struct run_work;
 };
 
 struct exynos_drm_ipp_buffer {
@@ -95,6 +98,10 @@ struct exynos_drm_ipp_task {
 	int ret;
 
 	struct drm_pending_exynos_ipp_event *event;
+
+	struct dma_fence *in_fence;
+	struct dma_fence_cb in_cb;
+	struct dma_fence *out_fence;
 };
 
 #define DRM_EXYNOS_IPP_TASK_DONE	(1 << 0)
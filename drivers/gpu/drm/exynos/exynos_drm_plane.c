@@ -4,9 +4,11 @@
  * Authors: Joonyoung Shim <jy0922.shim@samsung.com>
  */
 
+#include <linux/dma-fence.h>
 
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
+#include <drm/drm_fourcc.h>
 #include <drm/drm_plane_helper.h>
 #include <drm/exynos_drm.h>
 
@@ -127,6 +129,8 @@ static void exynos_drm_plane_reset(struct drm_plane *plane)
 
 	if (plane->state) {
 		exynos_state = to_exynos_plane_state(plane->state);
+		if (exynos_state->late_fence)
+			dma_fence_put(exynos_state->late_fence);
 		__drm_atomic_helper_plane_destroy_state(plane->state);
 		kfree(exynos_state);
 		plane->state = NULL;
@@ -159,10 +163,34 @@ static void exynos_drm_plane_destroy_state(struct drm_plane *plane,
 {
 	struct exynos_drm_plane_state *old_exynos_state =
 					to_exynos_plane_state(old_state);
+
+	if (old_exynos_state->late_fence)
+		dma_fence_put(old_exynos_state->late_fence);
 	__drm_atomic_helper_plane_destroy_state(old_state);
 	kfree(old_exynos_state);
 }
 
+static bool exynos_drm_plane_format_mod_supported(struct drm_plane *plane,
+						  uint32_t format,
+						  uint64_t modifier)
+{
+	const struct exynos_drm_plane_config *config =
+		to_exynos_plane(plane)->config;
+
+	switch (modifier) {
+	case DRM_FORMAT_MOD_LINEAR:
+		return true;
+
+	case DRM_FORMAT_MOD_SAMSUNG_64_32_TILE:
+		if (!(config->capabilities & EXYNOS_DRM_PLANE_CAP_TILE))
+			return false;
+		return format == DRM_FORMAT_NV12 || format == DRM_FORMAT_NV21;
+
+	default:
+		return false;
+	}
+}
+
 static struct drm_plane_funcs exynos_plane_funcs = {
 	.update_plane	= drm_atomic_helper_update_plane,
 	.disable_plane	= drm_atomic_helper_disable_plane,
@@ -170,6 +198,18 @@ static struct drm_plane_funcs exynos_plane_funcs = {
 	.reset		= exynos_drm_plane_reset,
 	.atomic_duplicate_state = exynos_drm_plane_duplicate_state,
 	.atomic_destroy_state = exynos_drm_plane_destroy_state,
+	.format_mod_supported = exynos_drm_plane_format_mod_supported,
+};
+
+static const uint64_t exynos_plane_modifiers[] = {
+	DRM_FORMAT_MOD_LINEAR,
+	DRM_FORMAT_MOD_INVALID
+};
+
+static const uint64_t exynos_plane_tile_modifiers[] = {
+	DRM_FORMAT_MOD_LINEAR,
+	DRM_FORMAT_MOD_SAMSUNG_64_32_TILE,
+	DRM_FORMAT_MOD_INVALID
 };
 
 static int
@@ -280,10 +320,75 @@ static void exynos_plane_atomic_disable(struct drm_plane *plane,
 		exynos_crtc->ops->disable_plane(exynos_crtc, exynos_plane);
 }
 
+/*
+ * Async updates may move the plane and change its framebuffer for one of
+ * the same layout, anything else needs a full commit.
+ */
+static int exynos_plane_atomic_async_check(struct drm_plane *plane,
+					   struct drm_atomic_state *state)
+{
+	struct drm_plane_state *new_state = drm_atomic_get_new_plane_state(state,
+									   plane);
+	struct drm_plane_state *cur_state = plane->state;
+	struct exynos_drm_crtc *exynos_crtc;
+
+	if (!new_state->crtc || new_state->crtc != cur_state->crtc ||
+	    !new_state->fb || !cur_state->fb)
+		return -EINVAL;
+
+	exynos_crtc = to_exynos_crtc(new_state->crtc);
+	if (!exynos_crtc->ops->async_update_plane || exynos_crtc->i80_mode)
+		return -EINVAL;
+
+	if (new_state->fb->format != cur_state->fb->format ||
+	    new_state->fb->modifier != cur_state->fb->modifier ||
+	    new_state->fb->pitches[0] != cur_state->fb->pitches[0])
+		return -EINVAL;
+
+	if (new_state->src_w != cur_state->src_w ||
+	    new_state->src_h != cur_state->src_h ||
+	    new_state->crtc_w != cur_state->crtc_w ||
+	    new_state->crtc_h != cur_state->crtc_h)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void exynos_plane_atomic_async_update(struct drm_plane *plane,
+					     struct drm_atomic_state *state)
+{
+	struct drm_plane_state *new_state = drm_atomic_get_new_plane_state(state,
+									   plane);
+	struct exynos_drm_plane_state *cur = to_exynos_plane_state(plane->state);
+	struct exynos_drm_plane_state *new = to_exynos_plane_state(new_state);
+	struct exynos_drm_crtc *exynos_crtc = to_exynos_crtc(new_state->crtc);
+	struct drm_framebuffer *old_fb = plane->state->fb;
+
+	plane->state->src_x = new_state->src_x;
+	plane->state->src_y = new_state->src_y;
+	plane->state->crtc_x = new_state->crtc_x;
+	plane->state->crtc_y = new_state->crtc_y;
+	cur->src = new->src;
+	cur->crtc = new->crtc;
+	cur->h_ratio = new->h_ratio;
+	cur->v_ratio = new->v_ratio;
+	if (old_fb != new_state->fb)
+		swap(plane->state->fb, new_state->fb);
+
+	exynos_crtc->ops->async_update_plane(exynos_crtc,
+					     to_exynos_plane(plane));
+
+	/* the old framebuffer is scanned out until the update is latched */
+	if (old_fb != plane->state->fb)
+		exynos_drm_crtc_defer_fb_put(exynos_crtc, old_fb);
+}
+
 static const struct drm_plane_helper_funcs plane_helper_funcs = {
 	.atomic_check = exynos_plane_atomic_check,
 	.atomic_update = exynos_plane_atomic_update,
 	.atomic_disable = exynos_plane_atomic_disable,
+	.atomic_async_check = exynos_plane_atomic_async_check,
+	.atomic_async_update = exynos_plane_atomic_async_update,
 };
 
 static void exynos_plane_attach_zpos_property(struct drm_plane *plane,
@@ -304,13 +409,21 @@ int exynos_plane_init(struct drm_device *dev,
 				       BIT(DRM_MODE_BLEND_PREMULTI) |
 				       BIT(DRM_MODE_BLEND_COVERAGE);
 	struct drm_plane *plane = &exynos_plane->base;
+	const uint64_t *modifiers = exynos_plane_modifiers;
+
+	if (config->capabilities & EXYNOS_DRM_PLANE_CAP_TILE)
+		modifiers = exynos_plane_tile_modifiers;
+
+	/* config is needed by .format_mod_supported during init */
+	exynos_plane->index = index;
+	exynos_plane->config = config;
 
 	err = drm_universal_plane_init(dev, &exynos_plane->base,
 				       1 << dev->mode_config.num_crtc,
 				       &exynos_plane_funcs,
 				       config->pixel_formats,
 				       config->num_pixel_formats,
-				       NULL, config->type, NULL);
+				       modifiers, config->type, NULL);
 	if (err) {
 		DRM_DEV_ERROR(dev->dev, "failed to initialize plane\n");
 		return err;
@@ -318,8 +431,7 @@ int exynos_plane_init(struct drm_device *dev,
 
 	drm_plane_helper_add(&exynos_plane->base, &plane_helper_funcs);
 
-	exynos_plane->index = index;
-	exynos_plane->config = config;
+	drm_plane_enable_fb_damage_clips(plane);
 
 	exynos_plane_attach_zpos_property(&exynos_plane->base, config->zpos,
 			   !(config->capabilities & EXYNOS_DRM_PLANE_CAP_ZPOS));
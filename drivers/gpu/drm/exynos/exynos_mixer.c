@@ -103,6 +103,9 @@ struct mixer_context {
 	void __iomem		*mixer_regs;
 	void __iomem		*vp_regs;
 	spinlock_t		reg_slock;
+	wait_queue_head_t	wait_sync;
+	ktime_t			flush_time;
+	bool			latch_pending;
 	struct clk		*mixer;
 	struct clk		*vp;
 	struct clk		*hdmi;
@@ -381,8 +384,26 @@ static bool mixer_is_synced(struct mixer_context *ctx)
 
 static int mixer_wait_for_sync(struct mixer_context *ctx)
 {
-	ktime_t timeout = ktime_add_us(ktime_get(), 100000);
+	struct drm_crtc *crtc = &ctx->crtc->base;
+	ktime_t timeout;
 
+	if (mixer_is_synced(ctx))
+		return 0;
+
+	/*
+	 * The vsync interrupt wakes us up once the shadow registers have
+	 * latched, poll only when it can't be enabled.
+	 */
+	if (!drm_crtc_vblank_get(crtc)) {
+		long ret;
+
+		ret = wait_event_timeout(ctx->wait_sync, mixer_is_synced(ctx),
+					 msecs_to_jiffies(100));
+		drm_crtc_vblank_put(crtc);
+		return ret ? 0 : -ETIMEDOUT;
+	}
+
+	timeout = ktime_add_us(ktime_get(), 100000);
 	while (!mixer_is_synced(ctx)) {
 		usleep_range(1000, 2000);
 		if (ktime_compare(ktime_get(), timeout) > 0)
@@ -754,6 +775,18 @@ static irqreturn_t mixer_irq_handler(int irq, void *arg)
 		val |= MXR_INT_CLEAR_VSYNC;
 		val &= ~MXR_INT_STATUS_VSYNC;
 
+		if (ctx->latch_pending && mixer_is_synced(ctx)) {
+			struct exynos_drm_crtc *crtc = ctx->crtc;
+			u64 ns = ktime_to_ns(ktime_sub(ktime_get(),
+						       ctx->flush_time));
+
+			ctx->latch_pending = false;
+			crtc->latched_commits++;
+			crtc->latch_ns_total += ns;
+			crtc->latch_ns_max = max(crtc->latch_ns_max, ns);
+		}
+		wake_up(&ctx->wait_sync);
+
 		/* interlace scan need to check shadow register */
 		if (test_bit(MXR_BIT_INTERLACE, &ctx->flags)
 		    && !mixer_is_synced(ctx))
@@ -941,8 +974,10 @@ static void mixer_atomic_begin(struct exynos_drm_crtc *crtc)
 	if (!test_bit(MXR_BIT_POWERED, &ctx->flags))
 		return;
 
-	if (mixer_wait_for_sync(ctx))
+	if (mixer_wait_for_sync(ctx)) {
 		dev_err(ctx->dev, "timeout waiting for VSYNC\n");
+		crtc->sync_timeouts++;
+	}
 	mixer_disable_sync(ctx);
 }
 
@@ -981,10 +1016,17 @@ static void mixer_disable_plane(struct exynos_drm_crtc *crtc,
 static void mixer_atomic_flush(struct exynos_drm_crtc *crtc)
 {
 	struct mixer_context *mixer_ctx = crtc->ctx;
+	unsigned long flags;
 
 	if (!test_bit(MXR_BIT_POWERED, &mixer_ctx->flags))
 		return;
 
+	/* all layers latch together at the next vsync */
+	spin_lock_irqsave(&mixer_ctx->reg_slock, flags);
+	mixer_ctx->flush_time = ktime_get();
+	mixer_ctx->latch_pending = true;
+	spin_unlock_irqrestore(&mixer_ctx->reg_slock, flags);
+
 	mixer_enable_sync(mixer_ctx);
 	exynos_crtc_handle_event(crtc);
 }
@@ -1241,6 +1283,7 @@ static int mixer_probe(struct platform_device *pdev)
 	ctx->pdev = pdev;
 	ctx->dev = dev;
 	ctx->mxr_ver = drv->version;
+	init_waitqueue_head(&ctx->wait_sync);
 
 	if (drv->is_vp_enabled)
 		__set_bit(MXR_BIT_VP_ENABLED, &ctx->flags);
@@ -6,7 +6,8 @@
 #include "lima_device.h"
 #include "lima_ctx.h"
 
-int lima_ctx_create(struct lima_device *dev, struct lima_ctx_mgr *mgr, u32 *id)
+int lima_ctx_create(struct lima_device *dev, struct lima_ctx_mgr *mgr, u32 *id,
+		    enum drm_sched_priority priority)
 {
 	struct lima_ctx *ctx;
 	int i, err;
@@ -18,7 +19,8 @@ int lima_ctx_create(struct lima_device *dev, struct lima_ctx_mgr *mgr, u32 *id)
 	kref_init(&ctx->refcnt);
 
 	for (i = 0; i < lima_pipe_num; i++) {
-		err = lima_sched_context_init(dev->pipe + i, ctx->context + i, &ctx->guilty);
+		err = lima_sched_context_init(dev->pipe + i, ctx->context + i,
+					      priority, &ctx->guilty);
 		if (err)
 			goto err_out0;
 	}
@@ -15,10 +15,14 @@
 
 #include "lima_device.h"
 #include "lima_devfreq.h"
+#include "lima_drv.h"
+
+static_assert(LIMA_DEVFREQ_PIPE_NUM == lima_pipe_num);
 
 static void lima_devfreq_update_utilization(struct lima_devfreq *devfreq)
 {
 	ktime_t now, last;
+	int i;
 
 	now = ktime_get();
 	last = devfreq->time_last_update;
@@ -28,9 +32,32 @@ static void lima_devfreq_update_utilization(struct lima_devfreq *devfreq)
 	else
 		devfreq->idle_time += ktime_sub(now, last);
 
+	for (i = 0; i < lima_pipe_num; i++)
+		if (devfreq->pipe_busy_count[i] > 0)
+			devfreq->pipe_busy_time[i] += ktime_sub(now, last);
+
 	devfreq->time_last_update = now;
 }
 
+/*
+ * Load seen by the governor: the time any pipe was busy, raised to the
+ * weighted busy time of a single pipe if that is larger, so that e.g. a
+ * PP bound workload can be made to ramp up earlier than a GP bound one.
+ */
+static u64 lima_devfreq_busy_time(struct lima_devfreq *devfreq, u64 total)
+{
+	u64 busy = ktime_to_ns(devfreq->busy_time);
+	u64 gp, pp;
+
+	gp = ktime_to_ns(devfreq->pipe_busy_time[lima_pipe_gp]) *
+	     lima_devfreq_gp_weight / 100;
+	pp = ktime_to_ns(devfreq->pipe_busy_time[lima_pipe_pp]) *
+	     lima_devfreq_pp_weight / 100;
+
+	busy = max3(busy, gp, pp);
+	return min(busy, total);
+}
+
 static int lima_devfreq_target(struct device *dev, unsigned long *freq,
 			       u32 flags)
 {
@@ -46,8 +73,12 @@ static int lima_devfreq_target(struct device *dev, unsigned long *freq,
 
 static void lima_devfreq_reset(struct lima_devfreq *devfreq)
 {
+	int i;
+
 	devfreq->busy_time = 0;
 	devfreq->idle_time = 0;
+	for (i = 0; i < lima_pipe_num; i++)
+		devfreq->pipe_busy_time[i] = 0;
 	devfreq->time_last_update = ktime_get();
 }
 
@@ -66,7 +97,13 @@ static int lima_devfreq_get_dev_status(struct device *dev,
 
 	status->total_time = ktime_to_ns(ktime_add(devfreq->busy_time,
 						   devfreq->idle_time));
-	status->busy_time = ktime_to_ns(devfreq->busy_time);
+	status->busy_time = lima_devfreq_busy_time(devfreq,
+						   status->total_time);
+
+	if (devfreq->boost) {
+		status->busy_time = status->total_time;
+		devfreq->boost = false;
+	}
 
 	lima_devfreq_reset(devfreq);
 
@@ -87,10 +124,24 @@ static struct devfreq_dev_profile lima_devfreq_profile = {
 	.get_dev_status = lima_devfreq_get_dev_status,
 };
 
+static void lima_devfreq_boost_work(struct work_struct *work)
+{
+	struct lima_devfreq *ldevfreq =
+		container_of(work, struct lima_devfreq, boost_work);
+	struct devfreq *devfreq = ldevfreq->devfreq;
+
+	mutex_lock(&devfreq->lock);
+	update_devfreq(devfreq);
+	mutex_unlock(&devfreq->lock);
+}
+
 void lima_devfreq_fini(struct lima_device *ldev)
 {
 	struct lima_devfreq *devfreq = &ldev->devfreq;
 
+	if (devfreq->devfreq)
+		cancel_work_sync(&devfreq->boost_work);
+
 	if (devfreq->cooling) {
 		devfreq_cooling_unregister(devfreq->cooling);
 		devfreq->cooling = NULL;
@@ -117,6 +168,7 @@ int lima_devfreq_init(struct lima_device *ldev)
 		return 0;
 
 	spin_lock_init(&ldevfreq->lock);
+	INIT_WORK(&ldevfreq->boost_work, lima_devfreq_boost_work);
 
 	ret = devm_pm_opp_set_clkname(dev, "core");
 	if (ret)
@@ -144,6 +196,12 @@ int lima_devfreq_init(struct lima_device *ldev)
 	lima_devfreq_profile.initial_freq = cur_freq;
 	dev_pm_opp_put(opp);
 
+	ldevfreq->min_freq = 0;
+	opp = dev_pm_opp_find_freq_ceil(dev, &ldevfreq->min_freq);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+	dev_pm_opp_put(opp);
+
 	/*
 	 * Setup default thresholds for the simple_ondemand governor.
 	 * The values are chosen based on experiments.
@@ -161,7 +219,13 @@ int lima_devfreq_init(struct lima_device *ldev)
 
 	ldevfreq->devfreq = devfreq;
 
-	cooling = of_devfreq_cooling_register(dev->of_node, devfreq);
+	/*
+	 * Register the Energy Model from the OPPs and the DT
+	 * "dynamic-power-coefficient" as well, which makes the GPU a power
+	 * actor for the power_allocator thermal governor. Without the
+	 * coefficient this is a plain devfreq cooling device as before.
+	 */
+	cooling = devfreq_cooling_em_register(devfreq, NULL);
 	if (IS_ERR(cooling))
 		dev_info(dev, "Failed to register cooling device\n");
 	else
@@ -170,7 +234,7 @@ int lima_devfreq_init(struct lima_device *ldev)
 	return 0;
 }
 
-void lima_devfreq_record_busy(struct lima_devfreq *devfreq)
+void lima_devfreq_record_busy(struct lima_devfreq *devfreq, int pipe)
 {
 	unsigned long irqflags;
 
@@ -182,11 +246,12 @@ void lima_devfreq_record_busy(struct lima_devfreq *devfreq)
 	lima_devfreq_update_utilization(devfreq);
 
 	devfreq->busy_count++;
+	devfreq->pipe_busy_count[pipe]++;
 
 	spin_unlock_irqrestore(&devfreq->lock, irqflags);
 }
 
-void lima_devfreq_record_idle(struct lima_devfreq *devfreq)
+void lima_devfreq_record_idle(struct lima_devfreq *devfreq, int pipe)
 {
 	unsigned long irqflags;
 
@@ -198,10 +263,38 @@ void lima_devfreq_record_idle(struct lima_devfreq *devfreq)
 	lima_devfreq_update_utilization(devfreq);
 
 	WARN_ON(--devfreq->busy_count < 0);
+	WARN_ON(--devfreq->pipe_busy_count[pipe] < 0);
 
 	spin_unlock_irqrestore(&devfreq->lock, irqflags);
 }
 
+/*
+ * A job queued while the GPU sits idle at its lowest OPP would otherwise
+ * run there until the next polling window notices the load. Re-evaluate
+ * right away and report full load once so the governor jumps up.
+ */
+void lima_devfreq_record_submit(struct lima_devfreq *devfreq)
+{
+	unsigned long irqflags;
+	bool boost = false;
+
+	if (!devfreq->devfreq || !lima_devfreq_boost)
+		return;
+
+	if (READ_ONCE(devfreq->devfreq->previous_freq) > devfreq->min_freq)
+		return;
+
+	spin_lock_irqsave(&devfreq->lock, irqflags);
+	if (!devfreq->busy_count && !devfreq->boost) {
+		devfreq->boost = true;
+		boost = true;
+	}
+	spin_unlock_irqrestore(&devfreq->lock, irqflags);
+
+	if (boost)
+		queue_work(system_highpri_wq, &devfreq->boost_work);
+}
+
 int lima_devfreq_resume(struct lima_devfreq *devfreq)
 {
 	unsigned long irqflags;
@@ -7,12 +7,16 @@
 #include <linux/devfreq.h>
 #include <linux/spinlock.h>
 #include <linux/ktime.h>
+#include <linux/workqueue.h>
 
 struct devfreq;
 struct thermal_cooling_device;
 
 struct lima_device;
 
+/* lima_pipe_num, without pulling in lima_device.h */
+#define LIMA_DEVFREQ_PIPE_NUM 2
+
 struct lima_devfreq {
 	struct devfreq *devfreq;
 	struct thermal_cooling_device *cooling;
@@ -22,19 +26,28 @@ struct lima_devfreq {
 	ktime_t idle_time;
 	ktime_t time_last_update;
 	int busy_count;
+	/* same as above, per pipe */
+	ktime_t pipe_busy_time[LIMA_DEVFREQ_PIPE_NUM];
+	int pipe_busy_count[LIMA_DEVFREQ_PIPE_NUM];
+	/* report full load on the next sample, set when idle at submit */
+	bool boost;
 	/*
-	 * Protect busy_time, idle_time, time_last_update and busy_count
-	 * because these can be updated concurrently, for example by the GP
-	 * and PP interrupts.
+	 * Protect busy_time, idle_time, time_last_update, busy_count,
+	 * the per pipe counters and boost because these can be updated
+	 * concurrently, for example by the GP and PP interrupts.
 	 */
 	spinlock_t lock;
+
+	unsigned long min_freq;
+	struct work_struct boost_work;
 };
 
 int lima_devfreq_init(struct lima_device *ldev);
 void lima_devfreq_fini(struct lima_device *ldev);
 
-void lima_devfreq_record_busy(struct lima_devfreq *devfreq);
-void lima_devfreq_record_idle(struct lima_devfreq *devfreq);
+void lima_devfreq_record_busy(struct lima_devfreq *devfreq, int pipe);
+void lima_devfreq_record_idle(struct lima_devfreq *devfreq, int pipe);
+void lima_devfreq_record_submit(struct lima_devfreq *devfreq);
 
 int lima_devfreq_resume(struct lima_devfreq *devfreq);
 int lima_devfreq_suspend(struct lima_devfreq *devfreq);
@@ -102,6 +102,10 @@ struct lima_device {
 
 	struct lima_devfreq devfreq;
 
+	/* largest heap any task has needed, used as initial heap size */
+	size_t heap_hwm;
+	atomic_t heap_grows;
+
 	/* debug info */
 	struct lima_dump_head dump;
 	struct list_head error_task_list;
@@ -2,6 +2,7 @@
 /* Copyright 2017-2019 Qiang Yu <yuq825@gmail.com> */
 
 #include <linux/module.h>
+#include <linux/capability.h>
 #include <linux/of_platform.h>
 #include <linux/uaccess.h>
 #include <linux/slab.h>
@@ -20,12 +21,16 @@ int lima_sched_timeout_ms;
 uint lima_heap_init_nr_pages = 8;
 uint lima_max_error_tasks;
 uint lima_job_hang_limit;
+uint lima_sched_starve_ms = 100;
+bool lima_devfreq_boost = true;
+uint lima_devfreq_gp_weight = 100;
+uint lima_devfreq_pp_weight = 100;
 
 MODULE_PARM_DESC(sched_timeout_ms, "task run timeout in ms");
 module_param_named(sched_timeout_ms, lima_sched_timeout_ms, int, 0444);
 
 MODULE_PARM_DESC(heap_init_nr_pages, "heap buffer init number of pages");
-module_param_named(heap_init_nr_pages, lima_heap_init_nr_pages, uint, 0444);
+module_param_named(heap_init_nr_pages, lima_heap_init_nr_pages, uint, 0644);
 
 MODULE_PARM_DESC(max_error_tasks, "max number of error tasks to save");
 module_param_named(max_error_tasks, lima_max_error_tasks, uint, 0644);
@@ -33,6 +38,18 @@ module_param_named(max_error_tasks, lima_max_error_tasks, uint, 0644);
 MODULE_PARM_DESC(job_hang_limit, "number of times to allow a job to hang before dropping it (default 0)");
 module_param_named(job_hang_limit, lima_job_hang_limit, uint, 0444);
 
+MODULE_PARM_DESC(sched_starve_ms, "max time in ms a context may be starved by higher priority ones (0 = no limit)");
+module_param_named(sched_starve_ms, lima_sched_starve_ms, uint, 0644);
+
+MODULE_PARM_DESC(devfreq_boost, "raise the GPU clock as soon as a job is queued on an idle GPU (default true)");
+module_param_named(devfreq_boost, lima_devfreq_boost, bool, 0644);
+
+MODULE_PARM_DESC(devfreq_gp_weight, "weight in percent of GP busy time in the devfreq load (default 100)");
+module_param_named(devfreq_gp_weight, lima_devfreq_gp_weight, uint, 0644);
+
+MODULE_PARM_DESC(devfreq_pp_weight, "weight in percent of PP busy time in the devfreq load (default 100)");
+module_param_named(devfreq_pp_weight, lima_devfreq_pp_weight, uint, 0644);
+
 static int lima_ioctl_get_param(struct drm_device *dev, void *data, struct drm_file *file)
 {
 	struct drm_lima_get_param *args = data;
@@ -68,6 +85,14 @@ static int lima_ioctl_get_param(struct drm_device *dev, void *data, struct drm_f
 		args->value = ldev->pp_version;
 		break;
 
+	case DRM_LIMA_PARAM_HEAP_HWM:
+		args->value = READ_ONCE(ldev->heap_hwm);
+		break;
+
+	case DRM_LIMA_PARAM_HEAP_GROWS:
+		args->value = atomic_read(&ldev->heap_grows);
+		break;
+
 	default:
 		return -EINVAL;
 	}
@@ -190,16 +215,30 @@ static int lima_ioctl_ctx_create(struct drm_device *dev, void *data, struct drm_
 	struct drm_lima_ctx_create *args = data;
 	struct lima_drm_priv *priv = file->driver_priv;
 	struct lima_device *ldev = to_lima_dev(dev);
+	enum drm_sched_priority priority;
 
-	if (args->_pad)
+	switch (args->priority) {
+	case LIMA_CTX_PRIORITY_NORMAL:
+		priority = DRM_SCHED_PRIORITY_NORMAL;
+		break;
+	case LIMA_CTX_PRIORITY_LOW:
+		priority = DRM_SCHED_PRIORITY_MIN;
+		break;
+	case LIMA_CTX_PRIORITY_HIGH:
+		if (!capable(CAP_SYS_NICE))
+			return -EACCES;
+		priority = DRM_SCHED_PRIORITY_HIGH;
+		break;
+	default:
 		return -EINVAL;
+	}
 
-	return lima_ctx_create(ldev, &priv->ctx_mgr, &args->id);
+	return lima_ctx_create(ldev, &priv->ctx_mgr, &args->id, priority);
 }
 
 static int lima_ioctl_ctx_free(struct drm_device *dev, void *data, struct drm_file *file)
 {
-	struct drm_lima_ctx_create *args = data;
+	struct drm_lima_ctx_free *args = data;
 	struct lima_drm_priv *priv = file->driver_priv;
 
 	if (args->_pad)
@@ -259,6 +298,8 @@ DEFINE_DRM_GEM_FOPS(lima_drm_driver_fops);
  * Changelog:
  *
  * - 1.1.0 - add heap buffer support
+ * - 1.2.0 - add context priority
+ * - 1.3.0 - add heap high-water mark and growth count params
  */
 
 static const struct drm_driver lima_drm_driver = {
@@ -272,7 +313,7 @@ static const struct drm_driver lima_drm_driver = {
 	.desc               = "lima DRM",
 	.date               = "20191231",
 	.major              = 1,
-	.minor              = 1,
+	.minor              = 3,
 	.patchlevel         = 0,
 
 	.gem_create_object  = lima_gem_create_object,
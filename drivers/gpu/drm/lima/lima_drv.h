@@ -12,6 +12,10 @@ extern int lima_sched_timeout_ms;
 extern uint lima_heap_init_nr_pages;
 extern uint lima_max_error_tasks;
 extern uint lima_job_hang_limit;
+extern uint lima_sched_starve_ms;
+extern bool lima_devfreq_boost;
+extern uint lima_devfreq_gp_weight;
+extern uint lima_devfreq_pp_weight;
 
 struct lima_vm;
 struct lima_bo;
@@ -16,15 +16,36 @@
 #include "lima_drv.h"
 #include "lima_gem.h"
 #include "lima_vm.h"
+#include "lima_trace.h"
 
+static void lima_heap_update_hwm(struct lima_device *ldev, size_t size)
+{
+	size_t hwm = READ_ONCE(ldev->heap_hwm);
+
+	while (size > hwm) {
+		size_t old = cmpxchg(&ldev->heap_hwm, hwm, size);
+
+		if (old == hwm)
+			break;
+		hwm = old;
+	}
+}
+
+/*
+ * Heaps start at the largest size any task has needed so far, so once
+ * the working set is known new heaps and steady state frames no longer
+ * take GP out of memory interrupts to grow their heap.
+ */
 int lima_heap_alloc(struct lima_bo *bo, struct lima_vm *vm)
 {
 	struct page **pages;
 	struct address_space *mapping = bo->base.base.filp->f_mapping;
 	struct device *dev = bo->base.base.dev->dev;
+	struct lima_device *ldev = to_lima_dev(bo->base.base.dev);
 	size_t old_size = bo->heap_size;
 	size_t new_size = bo->heap_size ? bo->heap_size * 2 :
-		(lima_heap_init_nr_pages << PAGE_SHIFT);
+		max_t(size_t, lima_heap_init_nr_pages << PAGE_SHIFT,
+		      READ_ONCE(ldev->heap_hwm));
 	struct sg_table sgt;
 	int i, ret;
 
@@ -92,6 +113,14 @@ int lima_heap_alloc(struct lima_bo *bo, struct lima_vm *vm)
 	}
 
 	bo->heap_size = new_size;
+
+	/* growing a heap used by a task, not the initial allocation */
+	if (vm) {
+		atomic_inc(&ldev->heap_grows);
+		lima_heap_update_hwm(ldev, new_size);
+	}
+	trace_lima_heap_grow(old_size, new_size, vm);
+
 	return 0;
 
 err_out2:
@@ -14,6 +14,7 @@
 #include "lima_bcast.h"
 #include "lima_vm.h"
 #include "lima_regs.h"
+#include "lima_trace.h"
 
 #define pp_write(reg, data) writel(data, ip->iomem + reg)
 #define pp_read(reg) readl(ip->iomem + reg)
@@ -38,6 +39,18 @@ static void lima_pp_handle_irq(struct lima_ip *ip, u32 state)
 	pp_write(LIMA_PP_INT_CLEAR, state);
 }
 
+static void lima_pp_mark_done(struct lima_sched_pipe *pipe, struct lima_ip *ip)
+{
+	int i;
+
+	for (i = 0; i < pipe->num_processor; i++) {
+		if (pipe->processor[i] == ip) {
+			pipe->processor_done[i] = ktime_get();
+			break;
+		}
+	}
+}
+
 static irqreturn_t lima_pp_irq_handler(int irq, void *data)
 {
 	struct lima_ip *ip = data;
@@ -50,6 +63,7 @@ static irqreturn_t lima_pp_irq_handler(int irq, void *data)
 		return IRQ_NONE;
 
 	lima_pp_handle_irq(ip, state);
+	lima_pp_mark_done(pipe, ip);
 
 	if (atomic_dec_and_test(&pipe->task))
 		lima_sched_pipe_task_done(pipe);
@@ -94,6 +108,7 @@ static irqreturn_t lima_pp_bcast_irq_handler(int irq, void *data)
 		}
 
 		pipe->done |= (1 << i);
+		pipe->processor_done[i] = ktime_get();
 		if (atomic_dec_and_test(&pipe->task))
 			lima_sched_pipe_task_done(pipe);
 	}
@@ -364,12 +379,14 @@ static void lima_pp_task_run(struct lima_sched_pipe *pipe,
 				pp_write(LIMA_PP_FRAME, frame->plbu_array_address[i]);
 		}
 
+		pipe->task_start = ktime_get();
 		pp_write(LIMA_PP_CTRL, LIMA_PP_CTRL_START_RENDERING);
 	} else {
 		struct drm_lima_m400_pp_frame *frame = task->frame;
 		int i;
 
 		atomic_set(&pipe->task, frame->num_pp);
+		pipe->task_start = ktime_get();
 
 		for (i = 0; i < frame->num_pp; i++) {
 			struct lima_ip *ip = pipe->processor[i];
@@ -388,8 +405,47 @@ static void lima_pp_task_run(struct lima_sched_pipe *pipe,
 	}
 }
 
+/*
+ * On Mali-400 the tiles of a frame are split between the PP cores by
+ * userspace, one PLBU stream per core, so the kernel cannot move work
+ * between them; report how long each core was busy compared with the
+ * whole task so the split can be tuned. On Mali-450 with the DLBU the
+ * hardware hands out tiles dynamically and this shows how well it did.
+ */
+static void lima_pp_report_utilisation(struct lima_sched_pipe *pipe)
+{
+	struct lima_sched_task *task = pipe->current_task;
+	ktime_t end = pipe->task_start;
+	u32 num_pp;
+	int i;
+
+	if (!trace_lima_pp_core_util_enabled())
+		return;
+
+	if (pipe->bcast_processor) {
+		struct drm_lima_m450_pp_frame *frame = task->frame;
+
+		num_pp = frame->num_pp;
+	} else {
+		struct drm_lima_m400_pp_frame *frame = task->frame;
+
+		num_pp = frame->num_pp;
+	}
+
+	for (i = 0; i < num_pp; i++)
+		end = ktime_after(pipe->processor_done[i], end) ?
+			pipe->processor_done[i] : end;
+
+	for (i = 0; i < num_pp; i++)
+		trace_lima_pp_core_util(task, lima_ip_name(pipe->processor[i]),
+			ktime_sub(pipe->processor_done[i], pipe->task_start),
+			ktime_sub(end, pipe->task_start));
+}
+
 static void lima_pp_task_fini(struct lima_sched_pipe *pipe)
 {
+	lima_pp_report_utilisation(pipe);
+
 	if (pipe->bcast_processor)
 		lima_pp_soft_reset_async(pipe->bcast_processor);
 	else {
@@ -161,26 +161,51 @@ void lima_sched_task_fini(struct lima_sched_task *task)
 
 int lima_sched_context_init(struct lima_sched_pipe *pipe,
 			    struct lima_sched_context *context,
+			    enum drm_sched_priority priority,
 			    atomic_t *guilty)
 {
 	struct drm_gpu_scheduler *sched = &pipe->base;
+	int err;
 
-	return drm_sched_entity_init(&context->base, DRM_SCHED_PRIORITY_NORMAL,
-				     &sched, 1, guilty);
+	err = drm_sched_entity_init(&context->base, priority,
+				    &sched, 1, guilty);
+	if (err)
+		return err;
+
+	context->priority = priority;
+
+	spin_lock(&pipe->context_lock);
+	list_add_tail(&context->list, &pipe->contexts);
+	spin_unlock(&pipe->context_lock);
+
+	return 0;
 }
 
 void lima_sched_context_fini(struct lima_sched_pipe *pipe,
 			     struct lima_sched_context *context)
 {
+	spin_lock(&pipe->context_lock);
+	list_del(&context->list);
+	spin_unlock(&pipe->context_lock);
+
 	drm_sched_entity_fini(&context->base);
 }
 
 struct dma_fence *lima_sched_context_queue_task(struct lima_sched_context *context,
 						struct lima_sched_task *task)
 {
+	struct lima_sched_pipe *pipe = to_lima_pipe(task->base.sched);
 	struct dma_fence *fence = dma_fence_get(&task->base.s_fence->finished);
 
+	task->submit_time = ktime_get();
+
+	spin_lock(&pipe->context_lock);
+	if (!context->pending++)
+		context->wait_since = task->submit_time;
+	spin_unlock(&pipe->context_lock);
+
 	trace_lima_task_submit(task);
+	lima_devfreq_record_submit(&pipe->ldev->devfreq);
 	drm_sched_entity_push_job(&task->base, &context->base);
 	return fence;
 }
@@ -196,8 +221,90 @@ static struct dma_fence *lima_sched_dependency(struct drm_sched_job *job,
 	return NULL;
 }
 
-static int lima_pm_busy(struct lima_device *ldev)
+static inline struct lima_sched_context *
+to_lima_context(struct drm_sched_entity *entity)
+{
+	return container_of(entity, struct lima_sched_context, base);
+}
+
+/* move the context entity to the run queue of @priority on its pipe */
+static void lima_sched_context_set_rq(struct lima_sched_pipe *pipe,
+				      struct lima_sched_context *context,
+				      enum drm_sched_priority priority)
+{
+	struct drm_sched_entity *entity = &context->base;
+	struct drm_sched_rq *rq = &pipe->base.sched_rq[priority];
+
+	spin_lock(&entity->rq_lock);
+	if (entity->rq != rq) {
+		drm_sched_rq_remove_entity(entity->rq, entity);
+		entity->rq = rq;
+		drm_sched_rq_add_entity(rq, entity);
+	}
+	spin_unlock(&entity->rq_lock);
+}
+
+/*
+ * The drm scheduler always picks the highest priority run queue with a
+ * ready entity, so a busy high priority context starves everything
+ * below it. Called right before a task runs, either from the scheduler
+ * thread or from a direct run in the submitting thread, both under the
+ * scheduler's run_lock: lower priority contexts which have had work
+ * queued for longer than lima_sched_starve_ms are temporarily moved into
+ * the run queue of the running task, where they get their round robin
+ * turn, and go back to their own run queue once one of their tasks has
+ * run.
+ */
+static void lima_sched_account_task(struct lima_sched_pipe *pipe,
+				    struct lima_sched_task *task)
+{
+	struct lima_sched_context *context = to_lima_context(task->base.entity);
+	struct lima_sched_context *other;
+	ktime_t now = ktime_get();
+
+	/* tasks resubmitted after a GPU reset were already accounted */
+	if (task->started)
+		return;
+	task->started = true;
+
+	trace_lima_task_latency(task, context->priority,
+				ktime_sub(now, task->submit_time));
+
+	spin_lock(&pipe->context_lock);
+
+	context->wait_since = --context->pending ? now : 0;
+	if (context->boosted) {
+		lima_sched_context_set_rq(pipe, context, context->priority);
+		context->boosted = false;
+	}
+
+	if (!lima_sched_starve_ms)
+		goto out;
+
+	list_for_each_entry(other, &pipe->contexts, list) {
+		s64 starved;
+
+		if (other->boosted || !other->pending ||
+		    other->priority >= context->priority)
+			continue;
+
+		starved = ktime_ms_delta(now, other->wait_since);
+		if (starved < lima_sched_starve_ms)
+			continue;
+
+		trace_lima_context_boost(pipe->base.name, other->priority,
+					 context->priority, starved);
+		lima_sched_context_set_rq(pipe, other, context->priority);
+		other->boosted = true;
+	}
+
+out:
+	spin_unlock(&pipe->context_lock);
+}
+
+static int lima_pm_busy(struct lima_sched_pipe *pipe)
 {
+	struct lima_device *ldev = pipe->ldev;
 	int ret;
 
 	/* resume GPU if it has been suspended by runtime PM */
@@ -205,13 +312,15 @@ static int lima_pm_busy(struct lima_device *ldev)
 	if (ret < 0)
 		return ret;
 
-	lima_devfreq_record_busy(&ldev->devfreq);
+	lima_devfreq_record_busy(&ldev->devfreq, pipe - ldev->pipe);
 	return 0;
 }
 
-static void lima_pm_idle(struct lima_device *ldev)
+static void lima_pm_idle(struct lima_sched_pipe *pipe)
 {
-	lima_devfreq_record_idle(&ldev->devfreq);
+	struct lima_device *ldev = pipe->ldev;
+
+	lima_devfreq_record_idle(&ldev->devfreq, pipe - ldev->pipe);
 
 	/* GPU can do auto runtime suspend */
 	pm_runtime_mark_last_busy(ldev->dev);
@@ -222,10 +331,11 @@ static struct dma_fence *lima_sched_run_job(struct drm_sched_job *job)
 {
 	struct lima_sched_task *task = to_lima_task(job);
 	struct lima_sched_pipe *pipe = to_lima_pipe(job->sched);
-	struct lima_device *ldev = pipe->ldev;
 	struct lima_fence *fence;
 	int i, err;
 
+	lima_sched_account_task(pipe, task);
+
 	/* after GPU reset */
 	if (job->s_fence->finished.error < 0)
 		return NULL;
@@ -234,7 +344,7 @@ static struct dma_fence *lima_sched_run_job(struct drm_sched_job *job)
 	if (!fence)
 		return NULL;
 
-	err = lima_pm_busy(ldev);
+	err = lima_pm_busy(pipe);
 	if (err < 0) {
 		dma_fence_put(&fence->base);
 		return NULL;
@@ -419,7 +529,6 @@ static enum drm_gpu_sched_stat lima_sched_timedout_job(struct drm_sched_job *job
 {
 	struct lima_sched_pipe *pipe = to_lima_pipe(job->sched);
 	struct lima_sched_task *task = to_lima_task(job);
-	struct lima_device *ldev = pipe->ldev;
 
 	/*
 	 * The task might still finish while this timeout handler runs.
@@ -452,7 +561,7 @@ static enum drm_gpu_sched_stat lima_sched_timedout_job(struct drm_sched_job *job
 	pipe->current_vm = NULL;
 	pipe->current_task = NULL;
 
-	lima_pm_idle(ldev);
+	lima_pm_idle(pipe);
 
 	drm_sched_resubmit_jobs(&pipe->base);
 	drm_sched_start(&pipe->base, true);
@@ -508,16 +617,26 @@ int lima_sched_pipe_init(struct lima_sched_pipe *pipe, const char *name)
 {
 	unsigned int timeout = lima_sched_timeout_ms > 0 ?
 			       lima_sched_timeout_ms : 500;
+	int err;
 
 	pipe->fence_context = dma_fence_context_alloc(1);
 	spin_lock_init(&pipe->fence_lock);
 
+	INIT_LIST_HEAD(&pipe->contexts);
+	spin_lock_init(&pipe->context_lock);
+
 	INIT_WORK(&pipe->recover_work, lima_sched_recover_work);
 
-	return drm_sched_init(&pipe->base, &lima_sched_ops, 1,
-			      lima_job_hang_limit,
-			      msecs_to_jiffies(timeout), NULL,
-			      NULL, name);
+	err = drm_sched_init(&pipe->base, &lima_sched_ops, 1,
+			     lima_job_hang_limit,
+			     msecs_to_jiffies(timeout), NULL,
+			     NULL, name);
+	if (err)
+		return err;
+
+	/* one task in flight per pipe, start it right away when idle */
+	pipe->base.direct_run = true;
+	return 0;
 }
 
 void lima_sched_pipe_fini(struct lima_sched_pipe *pipe)
@@ -528,7 +647,6 @@ void lima_sched_pipe_fini(struct lima_sched_pipe *pipe)
 void lima_sched_pipe_task_done(struct lima_sched_pipe *pipe)
 {
 	struct lima_sched_task *task = pipe->current_task;
-	struct lima_device *ldev = pipe->ldev;
 
 	if (pipe->error) {
 		if (task && task->recoverable)
@@ -539,6 +657,6 @@ void lima_sched_pipe_task_done(struct lima_sched_pipe *pipe)
 		pipe->task_fini(pipe);
 		dma_fence_signal(task->fence);
 
-		lima_pm_idle(ldev);
+		lima_pm_idle(pipe);
 	}
 }
@@ -34,10 +34,22 @@ struct lima_sched_task {
 
 	/* pipe fence */
 	struct dma_fence *fence;
+
+	ktime_t submit_time;
+	bool started;
 };
 
 struct lima_sched_context {
 	struct drm_sched_entity base;
+
+	/* priority the context was created with, base.rq may be boosted */
+	enum drm_sched_priority priority;
+	bool boosted;
+
+	/* protected by pipe->context_lock */
+	struct list_head list;
+	unsigned int pending;
+	ktime_t wait_since;
 };
 
 #define LIMA_SCHED_PIPE_MAX_MMU       8
@@ -67,9 +79,17 @@ struct lima_sched_pipe {
 	struct lima_ip *processor[LIMA_SCHED_PIPE_MAX_PROCESSOR];
 	int num_processor;
 
+	/* start and per processor finish time of the current task */
+	ktime_t task_start;
+	ktime_t processor_done[LIMA_SCHED_PIPE_MAX_PROCESSOR];
+
 	struct lima_ip *bcast_processor;
 	struct lima_ip *bcast_mmu;
 
+	/* contexts with an entity on this pipe, for starvation checks */
+	struct list_head contexts;
+	spinlock_t context_lock;
+
 	u32 done;
 	bool error;
 	atomic_t task;
@@ -96,6 +116,7 @@ void lima_sched_task_fini(struct lima_sched_task *task);
 
 int lima_sched_context_init(struct lima_sched_pipe *pipe,
 			    struct lima_sched_context *context,
+			    enum drm_sched_priority priority,
 			    atomic_t *guilty);
 void lima_sched_context_fini(struct lima_sched_pipe *pipe,
 			     struct lima_sched_context *context);
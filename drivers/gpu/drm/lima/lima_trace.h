@@ -42,6 +42,96 @@ DEFINE_EVENT(lima_task, lima_task_run,
 	     TP_ARGS(task)
 );
 
+/*
+ * Queue latency of each task by context priority, meant to be aggregated
+ * with a hist trigger, e.g. 'hist:keys=pipe,priority:vals=wait_us'.
+ */
+TRACE_EVENT(lima_task_latency,
+	TP_PROTO(struct lima_sched_task *task, int priority, ktime_t wait),
+	TP_ARGS(task, priority, wait),
+	TP_STRUCT__entry(
+		__field(uint64_t, task_id)
+		__field(int, priority)
+		__field(uint64_t, wait_us)
+		__string(pipe, task->base.sched->name)
+		),
+
+	TP_fast_assign(
+		__entry->task_id = task->base.id;
+		__entry->priority = priority;
+		__entry->wait_us = ktime_to_us(wait);
+		__assign_str(pipe, task->base.sched->name);
+		),
+
+	TP_printk("task=%llu, priority=%d wait_us=%llu pipe=%s",
+		  __entry->task_id, __entry->priority, __entry->wait_us,
+		  __get_str(pipe))
+);
+
+TRACE_EVENT(lima_pp_core_util,
+	TP_PROTO(struct lima_sched_task *task, const char *core,
+		 ktime_t busy, ktime_t span),
+	TP_ARGS(task, core, busy, span),
+	TP_STRUCT__entry(
+		__field(uint64_t, task_id)
+		__field(uint64_t, busy_us)
+		__field(uint64_t, span_us)
+		__string(core, core)
+		),
+
+	TP_fast_assign(
+		__entry->task_id = task->base.id;
+		__entry->busy_us = ktime_to_us(busy);
+		__entry->span_us = ktime_to_us(span);
+		__assign_str(core, core);
+		),
+
+	TP_printk("task=%llu, core=%s busy_us=%llu span_us=%llu",
+		  __entry->task_id, __get_str(core), __entry->busy_us,
+		  __entry->span_us)
+);
+
+TRACE_EVENT(lima_heap_grow,
+	TP_PROTO(size_t old_size, size_t new_size, bool in_task),
+	TP_ARGS(old_size, new_size, in_task),
+	TP_STRUCT__entry(
+		__field(size_t, old_size)
+		__field(size_t, new_size)
+		__field(bool, in_task)
+		),
+
+	TP_fast_assign(
+		__entry->old_size = old_size;
+		__entry->new_size = new_size;
+		__entry->in_task = in_task;
+		),
+
+	TP_printk("old_size=%zu new_size=%zu in_task=%d",
+		  __entry->old_size, __entry->new_size, __entry->in_task)
+);
+
+TRACE_EVENT(lima_context_boost,
+	TP_PROTO(const char *pipe, int from, int to, s64 starved_ms),
+	TP_ARGS(pipe, from, to, starved_ms),
+	TP_STRUCT__entry(
+		__field(int, from)
+		__field(int, to)
+		__field(s64, starved_ms)
+		__string(pipe, pipe)
+		),
+
+	TP_fast_assign(
+		__entry->from = from;
+		__entry->to = to;
+		__entry->starved_ms = starved_ms;
+		__assign_str(pipe, pipe);
+		),
+
+	TP_printk("priority=%d->%d starved_ms=%lld pipe=%s",
+		  __entry->from, __entry->to, __entry->starved_ms,
+		  __get_str(pipe))
+);
+
 #endif
 
 /* This part must be outside protection */
@@ -503,8 +503,10 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job,
 	WRITE_ONCE(entity->last_user, current->group_leader);
 	first = spsc_queue_push(&entity->job_queue, &sched_job->queue_node);
 
-	/* first job wakes up scheduler */
+	/* first job runs directly or wakes up scheduler */
 	if (first) {
+		struct drm_gpu_scheduler *sched;
+
 		/* Add the entity to the run queue */
 		spin_lock(&entity->rq_lock);
 		if (entity->stopped) {
@@ -514,8 +516,11 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job,
 			return;
 		}
 		drm_sched_rq_add_entity(entity->rq, entity);
+		sched = entity->rq->sched;
 		spin_unlock(&entity->rq_lock);
-		drm_sched_wakeup(entity->rq->sched);
+
+		if (!drm_sched_try_direct_run(entity))
+			drm_sched_wakeup(sched);
 	}
 }
 EXPORT_SYMBOL(drm_sched_entity_push_job);
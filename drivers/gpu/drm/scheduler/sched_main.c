@@ -60,6 +60,44 @@
 #define to_drm_sched_job(sched_job)		\
 		container_of((sched_job), struct drm_sched_job, queue_node)
 
+/**
+ * drm_sched_job_credits - credits a job takes from the hardware queue
+ *
+ * @sched: scheduler instance
+ * @s_job: job to check
+ *
+ * Clamps the job's credits to the scheduler's limit, so that a job asking for
+ * more than the whole hardware queue still runs, alone.
+ */
+static u32 drm_sched_job_credits(struct drm_gpu_scheduler *sched,
+				 struct drm_sched_job *s_job)
+{
+	return clamp_t(u32, s_job->credits, 1, sched->hw_submission_limit);
+}
+
+/**
+ * drm_sched_can_queue - can the next job of an entity be pushed to the hw
+ *
+ * @sched: scheduler instance
+ * @entity: the entity to check
+ *
+ * Return true if the hardware queue has enough credits left for the job at the
+ * head of @entity's queue, otherwise false.
+ */
+static bool drm_sched_can_queue(struct drm_gpu_scheduler *sched,
+				struct drm_sched_entity *entity)
+{
+	struct spsc_node *node = spsc_queue_peek(&entity->job_queue);
+	u32 credits;
+
+	if (!node)
+		return false;
+
+	credits = drm_sched_job_credits(sched, to_drm_sched_job(node));
+	return atomic_read(&sched->hw_rq_count) + credits <=
+		sched->hw_submission_limit;
+}
+
 /**
  * drm_sched_rq_init - initialize a given run queue struct
  *
@@ -95,6 +133,7 @@ void drm_sched_rq_add_entity(struct drm_sched_rq *rq,
 	list_add_tail(&entity->list, &rq->entities);
 	spin_unlock(&rq->lock);
 }
+EXPORT_SYMBOL(drm_sched_rq_add_entity);
 
 /**
  * drm_sched_rq_remove_entity - remove an entity
@@ -116,13 +155,17 @@ void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 		rq->current_entity = NULL;
 	spin_unlock(&rq->lock);
 }
+EXPORT_SYMBOL(drm_sched_rq_remove_entity);
 
 /**
  * drm_sched_rq_select_entity - Select an entity which could provide a job to run
  *
  * @rq: scheduler run queue to check.
  *
- * Try to find a ready entity, returns NULL if none found.
+ * Try to find a ready entity, returns NULL if none found.  Returns
+ * ERR_PTR(-ENOSPC) if the next ready entity has a job which needs more credits
+ * than are left in the hardware queue; that entity is not skipped so that big
+ * jobs can't be starved by smaller ones behind them.
  */
 static struct drm_sched_entity *
 drm_sched_rq_select_entity(struct drm_sched_rq *rq)
@@ -135,6 +178,10 @@ drm_sched_rq_select_entity(struct drm_sched_rq *rq)
 	if (entity) {
 		list_for_each_entry_continue(entity, &rq->entities, list) {
 			if (drm_sched_entity_is_ready(entity)) {
+				if (!drm_sched_can_queue(rq->sched, entity)) {
+					spin_unlock(&rq->lock);
+					return ERR_PTR(-ENOSPC);
+				}
 				rq->current_entity = entity;
 				reinit_completion(&entity->entity_idle);
 				spin_unlock(&rq->lock);
@@ -146,6 +193,10 @@ drm_sched_rq_select_entity(struct drm_sched_rq *rq)
 	list_for_each_entry(entity, &rq->entities, list) {
 
 		if (drm_sched_entity_is_ready(entity)) {
+			if (!drm_sched_can_queue(rq->sched, entity)) {
+				spin_unlock(&rq->lock);
+				return ERR_PTR(-ENOSPC);
+			}
 			rq->current_entity = entity;
 			reinit_completion(&entity->entity_idle);
 			spin_unlock(&rq->lock);
@@ -172,7 +223,7 @@ static void drm_sched_job_done(struct drm_sched_job *s_job)
 	struct drm_sched_fence *s_fence = s_job->s_fence;
 	struct drm_gpu_scheduler *sched = s_fence->sched;
 
-	atomic_dec(&sched->hw_rq_count);
+	atomic_sub(s_job->credits, &sched->hw_rq_count);
 	atomic_dec(sched->score);
 
 	trace_drm_sched_process_job(s_fence);
@@ -390,6 +441,11 @@ void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad)
 {
 	struct drm_sched_job *s_job, *tmp;
 
+	/* Keep direct runs away until drm_sched_start() */
+	mutex_lock(&sched->run_lock);
+	sched->stopped = true;
+	mutex_unlock(&sched->run_lock);
+
 	kthread_park(sched->thread);
 
 	/*
@@ -417,7 +473,7 @@ void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad)
 		if (s_job->s_fence->parent &&
 		    dma_fence_remove_callback(s_job->s_fence->parent,
 					      &s_job->cb)) {
-			atomic_dec(&sched->hw_rq_count);
+			atomic_sub(s_job->credits, &sched->hw_rq_count);
 		} else {
 			/*
 			 * remove job from pending_list.
@@ -478,7 +534,7 @@ void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery)
 	list_for_each_entry_safe(s_job, tmp, &sched->pending_list, list) {
 		struct dma_fence *fence = s_job->s_fence->parent;
 
-		atomic_inc(&sched->hw_rq_count);
+		atomic_add(s_job->credits, &sched->hw_rq_count);
 
 		if (!full_recovery)
 			continue;
@@ -501,6 +557,10 @@ void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery)
 		spin_unlock(&sched->job_list_lock);
 	}
 
+	mutex_lock(&sched->run_lock);
+	sched->stopped = false;
+	mutex_unlock(&sched->run_lock);
+
 	kthread_unpark(sched->thread);
 }
 EXPORT_SYMBOL(drm_sched_start);
@@ -593,6 +653,7 @@ int drm_sched_job_init(struct drm_sched_job *job,
 	if (!job->s_fence)
 		return -ENOMEM;
 	job->id = atomic64_inc_return(&sched->job_id_count);
+	job->credits = 1;
 
 	INIT_LIST_HEAD(&job->list);
 
@@ -656,6 +717,8 @@ drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 	/* Kernel run queue has higher priority than normal run queue*/
 	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
 		entity = drm_sched_rq_select_entity(&sched->sched_rq[i]);
+		if (IS_ERR(entity))
+			return NULL;
 		if (entity)
 			break;
 	}
@@ -763,6 +826,106 @@ static bool drm_sched_blocked(struct drm_gpu_scheduler *sched)
 	return false;
 }
 
+/**
+ * drm_sched_run_entity - push the next job of an entity to the hardware
+ *
+ * @sched: scheduler instance
+ * @entity: entity selected to provide the job
+ *
+ * Must be called with @sched->run_lock held and @entity->entity_idle
+ * reinitialized; the completion is signaled once the entity is not used any
+ * more.
+ *
+ * Returns true if a job was handed to the hardware, otherwise false.
+ */
+static bool drm_sched_run_entity(struct drm_gpu_scheduler *sched,
+				 struct drm_sched_entity *entity)
+{
+	struct drm_sched_fence *s_fence;
+	struct drm_sched_job *sched_job;
+	struct dma_fence *fence;
+	int r;
+
+	lockdep_assert_held(&sched->run_lock);
+
+	/* A direct run may have used up the credits since selection */
+	if (!drm_sched_can_queue(sched, entity)) {
+		complete(&entity->entity_idle);
+		return false;
+	}
+
+	sched_job = drm_sched_entity_pop_job(entity);
+
+	if (!sched_job) {
+		complete(&entity->entity_idle);
+		return false;
+	}
+
+	s_fence = sched_job->s_fence;
+
+	sched_job->credits = drm_sched_job_credits(sched, sched_job);
+	atomic_add(sched_job->credits, &sched->hw_rq_count);
+	drm_sched_job_begin(sched_job);
+
+	trace_drm_run_job(sched_job, entity);
+	fence = sched->ops->run_job(sched_job);
+	complete(&entity->entity_idle);
+	drm_sched_fence_scheduled(s_fence);
+
+	if (!IS_ERR_OR_NULL(fence)) {
+		s_fence->parent = dma_fence_get(fence);
+		r = dma_fence_add_callback(fence, &sched_job->cb,
+					   drm_sched_job_done_cb);
+		if (r == -ENOENT)
+			drm_sched_job_done(sched_job);
+		else if (r)
+			DRM_ERROR("fence add callback failed (%d)\n",
+				  r);
+		dma_fence_put(fence);
+	} else {
+		if (IS_ERR(fence))
+			dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
+
+		drm_sched_job_done(sched_job);
+	}
+
+	wake_up(&sched->job_scheduled);
+	return true;
+}
+
+/**
+ * drm_sched_try_direct_run - run an entity's job from the submitting thread
+ *
+ * @entity: entity which just got its first job queued
+ *
+ * Skips the scheduler thread round trip for schedulers with &direct_run set:
+ * when the scheduler is idle enough, the job's dependencies have all signaled
+ * and nobody else is running jobs right now, the job is handed to the
+ * hardware right away.  Any other case is left to the scheduler thread.
+ *
+ * Returns true if the job was run, otherwise false and the caller should wake
+ * up the scheduler thread.
+ */
+bool drm_sched_try_direct_run(struct drm_sched_entity *entity)
+{
+	struct drm_gpu_scheduler *sched = entity->rq->sched;
+	bool ran = false;
+
+	if (!sched->direct_run || !mutex_trylock(&sched->run_lock))
+		return false;
+
+	if (sched->ready && !sched->stopped &&
+	    drm_sched_entity_is_ready(entity) &&
+	    drm_sched_can_queue(sched, entity)) {
+		reinit_completion(&entity->entity_idle);
+		ran = drm_sched_run_entity(sched, entity);
+	}
+
+	mutex_unlock(&sched->run_lock);
+	return ran;
+}
+EXPORT_SYMBOL(drm_sched_try_direct_run);
+
 /**
  * drm_sched_main - main scheduler thread
  *
@@ -773,15 +936,11 @@ static bool drm_sched_blocked(struct drm_gpu_scheduler *sched)
 static int drm_sched_main(void *param)
 {
 	struct drm_gpu_scheduler *sched = (struct drm_gpu_scheduler *)param;
-	int r;
 
 	sched_set_fifo_low(current);
 
 	while (!kthread_should_stop()) {
 		struct drm_sched_entity *entity = NULL;
-		struct drm_sched_fence *s_fence;
-		struct drm_sched_job *sched_job;
-		struct dma_fence *fence;
 		struct drm_sched_job *cleanup_job = NULL;
 
 		wait_event_interruptible(sched->wake_up_worker,
@@ -799,41 +958,9 @@ static int drm_sched_main(void *param)
 		if (!entity)
 			continue;
 
-		sched_job = drm_sched_entity_pop_job(entity);
-
-		if (!sched_job) {
-			complete(&entity->entity_idle);
-			continue;
-		}
-
-		s_fence = sched_job->s_fence;
-
-		atomic_inc(&sched->hw_rq_count);
-		drm_sched_job_begin(sched_job);
-
-		trace_drm_run_job(sched_job, entity);
-		fence = sched->ops->run_job(sched_job);
-		complete(&entity->entity_idle);
-		drm_sched_fence_scheduled(s_fence);
-
-		if (!IS_ERR_OR_NULL(fence)) {
-			s_fence->parent = dma_fence_get(fence);
-			r = dma_fence_add_callback(fence, &sched_job->cb,
-						   drm_sched_job_done_cb);
-			if (r == -ENOENT)
-				drm_sched_job_done(sched_job);
-			else if (r)
-				DRM_ERROR("fence add callback failed (%d)\n",
-					  r);
-			dma_fence_put(fence);
-		} else {
-			if (IS_ERR(fence))
-				dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
-
-			drm_sched_job_done(sched_job);
-		}
-
-		wake_up(&sched->job_scheduled);
+		mutex_lock(&sched->run_lock);
+		drm_sched_run_entity(sched, entity);
+		mutex_unlock(&sched->run_lock);
 	}
 	return 0;
 }
@@ -843,7 +970,7 @@ static int drm_sched_main(void *param)
  *
  * @sched: scheduler instance
  * @ops: backend operations for this scheduler
- * @hw_submission: number of hw submissions that can be in flight
+ * @hw_submission: number of job credits that can be in flight
  * @hang_limit: number of times to allow a job to hang before dropping it
  * @timeout: timeout value in jiffies for the scheduler
  * @timeout_wq: workqueue to use for timeout work. If NULL, the system_wq is
@@ -874,6 +1001,7 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 	init_waitqueue_head(&sched->job_scheduled);
 	INIT_LIST_HEAD(&sched->pending_list);
 	spin_lock_init(&sched->job_list_lock);
+	mutex_init(&sched->run_lock);
 	atomic_set(&sched->hw_rq_count, 0);
 	INIT_DELAYED_WORK(&sched->work_tdr, drm_sched_job_timedout);
 	atomic_set(&sched->_score, 0);
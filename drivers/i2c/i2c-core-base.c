@@ -29,6 +29,7 @@
 #include <linux/irqflags.h>
 #include <linux/jump_label.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of_device.h>
@@ -40,7 +41,9 @@
 #include <linux/pm_wakeirq.h>
 #include <linux/property.h>
 #include <linux/rwsem.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "i2c-core.h"
 
@@ -1927,6 +1930,53 @@ int i2c_handle_smbus_host_notify(struct i2c_adapter *adap, unsigned short addr)
 }
 EXPORT_SYMBOL_GPL(i2c_handle_smbus_host_notify);
 
+/*
+ * Called with the bus segment locked, which serializes all updates of the
+ * statistics of this adapter.
+ */
+static void i2c_adapter_account(struct i2c_adapter *adap, struct i2c_msg *msgs,
+				int num, int ret, u64 busy_ns)
+{
+	struct i2c_adapter_stats *stats = &adap->stats;
+	int i;
+
+	stats->transfers++;
+	stats->busy_ns += busy_ns;
+	if (ret < 0) {
+		stats->errors++;
+		return;
+	}
+
+    /* 只统计实际完成的消息 */
+	stats->messages += ret;
+	for (i = 0; i < ret && i < num; i++)
+		stats->bytes += msgs[i].len;
+}
+
+static int i2c_adapter_stats_show(struct seq_file *s, void *data)
+{
+	struct i2c_adapter *adap = s->private;
+	struct i2c_adapter_stats stats;
+
+    /* 持有总线锁读取，保证 64 位计数在 32 位平台上读取完整 */
+	i2c_lock_bus(adap, I2C_LOCK_SEGMENT);
+	stats = adap->stats;
+	i2c_unlock_bus(adap, I2C_LOCK_SEGMENT);
+
+	seq_printf(s, "transfers: %llu\n", stats.transfers);
+	seq_printf(s, "messages: %llu\n", stats.messages);
+	seq_printf(s, "bytes: %llu\n", stats.bytes);
+	seq_printf(s, "errors: %llu\n", stats.errors);
+	seq_printf(s, "busy_us: %llu\n", div_u64(stats.busy_ns, NSEC_PER_USEC));
+	seq_printf(s, "batches: %llu\n", stats.batches);
+	seq_printf(s, "batched_transfers: %llu\n", stats.batched_transfers);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(i2c_adapter_stats);
+
+static void i2c_async_work(struct work_struct *work);
+
 /* 注册 i2c adapter
  * adap->nr 已初始化的 */
 static int i2c_register_adapter(struct i2c_adapter *adap)
@@ -1964,6 +2014,10 @@ static int i2c_register_adapter(struct i2c_adapter *adap)
 	rt_mutex_init(&adap->mux_lock);
 	mutex_init(&adap->userspace_clients_lock);
 	INIT_LIST_HEAD(&adap->userspace_clients);
+	spin_lock_init(&adap->async_lock);
+	INIT_LIST_HEAD(&adap->async_queue);
+	INIT_WORK(&adap->async_work, i2c_async_work);
+	memset(&adap->stats, 0, sizeof(adap->stats));
 
 	/* Set default timeout to 1 second if not already set */
     /* 如果超时时间未设置，则默认设置为 1s */
@@ -1997,6 +2051,8 @@ static int i2c_register_adapter(struct i2c_adapter *adap)
 
     /* 创建一个 debugfs 目录，以 设备名 命名， 在 i2c 目录下 */
 	adap->debugfs = debugfs_create_dir(dev_name(&adap->dev), i2c_debugfs_root);
+	debugfs_create_file("stats", 0444, adap->debugfs, adap,
+			    &i2c_adapter_stats_fops);
 
     /* smbus 的 alert 机制，单纯的 i2c bus 不用关注 */
 	res = i2c_setup_smbus_alert(adap);
@@ -2342,6 +2398,12 @@ void i2c_del_adapter(struct i2c_adapter *adap)
     /* 电源管理相关 */
 	pm_runtime_disable(&adap->dev);
 
+    /* 拒绝新的异步传输，并等待已排队的异步传输全部完成 */
+	spin_lock_irq(&adap->async_lock);
+	adap->async_shutdown = true;
+	spin_unlock_irq(&adap->async_lock);
+	flush_work(&adap->async_work);
+
     /* 注销主机通知的软irq */
 	i2c_host_notify_irq_teardown(adap);
 
@@ -2915,6 +2977,7 @@ static int i2c_check_for_quirks(struct i2c_adapter *adap, struct i2c_msg *msgs,
 int __i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 {
 	unsigned long orig_jiffies;
+	u64 start;
 	int ret, try;
 
     /* 需要I2C适配器提供 master_xfer 回调 */
@@ -2956,6 +3019,7 @@ int __i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
     /* 传输失败，但返回值为 EAGAIN , 则进行重传 */
     /* 超时控制，若超时，也不再进行重传 */
 	orig_jiffies = jiffies;
+	start = ktime_get_ns();
 	for (ret = 0, try = 0; try <= adap->retries; try++) {
         /* 原子操作模式下，适配器应该提供 master_xfer_atomic
          * 否则将会直接调用 master_xfer 回调 */
@@ -2974,6 +3038,8 @@ int __i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 			break;
 	}
 
+	i2c_adapter_account(adap, msgs, num, ret, ktime_get_ns() - start);
+
     /* 调试使用 */
 	if (static_branch_unlikely(&i2c_trace_msg_key)) {
 		int i;
@@ -3054,6 +3120,194 @@ int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 }
 EXPORT_SYMBOL(i2c_transfer);
 
+/* Upper bound of the messages merged into one master_xfer call */
+#define I2C_ASYNC_BATCH_MSGS	16
+
+/*
+ * Only transfers that tolerate a repeated START in place of their STOP are
+ * merged, and only on adapters without quirks, as those may restrict combined
+ * messages.
+ */
+static bool i2c_async_can_batch(struct i2c_adapter *adap,
+				struct i2c_async_xfer *xfer, int num)
+{
+	return !adap->quirks && (xfer->flags & I2C_ASYNC_XFER_COMBINE) &&
+	       num + xfer->num <= I2C_ASYNC_BATCH_MSGS;
+}
+
+static void i2c_async_work(struct work_struct *work)
+{
+	struct i2c_adapter *adap = container_of(work, struct i2c_adapter,
+						async_work);
+	struct i2c_msg msgs[I2C_ASYNC_BATCH_MSGS];
+	struct i2c_async_xfer *xfer, *next;
+	LIST_HEAD(batch);
+	int num, done, count, ret;
+
+	for (;;) {
+    /* 取出队首的传输，并尽量合并后续允许合并的传输 */
+		spin_lock_irq(&adap->async_lock);
+		xfer = list_first_entry_or_null(&adap->async_queue,
+						struct i2c_async_xfer, node);
+		if (!xfer) {
+			spin_unlock_irq(&adap->async_lock);
+			break;
+		}
+		list_move_tail(&xfer->node, &batch);
+		num = xfer->num;
+		if (i2c_async_can_batch(adap, xfer, 0)) {
+			list_for_each_entry_safe(xfer, next, &adap->async_queue,
+						 node) {
+				if (!i2c_async_can_batch(adap, xfer, num))
+					break;
+				list_move_tail(&xfer->node, &batch);
+				num += xfer->num;
+			}
+		}
+		spin_unlock_irq(&adap->async_lock);
+
+		i2c_lock_bus(adap, I2C_LOCK_SEGMENT);
+		if (list_is_singular(&batch)) {
+			xfer = list_first_entry(&batch, struct i2c_async_xfer,
+						node);
+			xfer->status = __i2c_transfer(adap, xfer->msgs,
+						      xfer->num);
+		} else {
+			num = 0;
+			count = 0;
+			list_for_each_entry(xfer, &batch, node) {
+				memcpy(&msgs[num], xfer->msgs,
+				       xfer->num * sizeof(*msgs));
+				num += xfer->num;
+				count++;
+			}
+
+			ret = __i2c_transfer(adap, msgs, num);
+
+    /* 按照完成的消息数，将结果分配给每个传输 */
+			done = 0;
+			list_for_each_entry(xfer, &batch, node) {
+				if (ret < 0)
+					xfer->status = ret;
+				else if (done + xfer->num <= ret)
+					xfer->status = xfer->num;
+				else
+					xfer->status = -EIO;
+				memcpy(xfer->msgs, &msgs[done],
+				       xfer->num * sizeof(*msgs));
+				done += xfer->num;
+			}
+
+			adap->stats.batches++;
+			adap->stats.batched_transfers += count;
+		}
+		i2c_unlock_bus(adap, I2C_LOCK_SEGMENT);
+
+		list_for_each_entry_safe(xfer, next, &batch, node) {
+			list_del_init(&xfer->node);
+			xfer->complete(xfer);
+		}
+	}
+}
+
+/**
+ * i2c_transfer_async - queue a single or combined I2C message
+ * @adap: Handle to I2C bus
+ * @xfer: Transfer to queue, must stay valid until @xfer->complete is called
+ *
+ * The transfer is executed from a worker of the adapter, in submission order
+ * with the other queued transfers. If @xfer has I2C_ASYNC_XFER_COMBINE set it
+ * may be merged with neighbouring transfers that have it set as well into a
+ * single master_xfer call, so that the bus is only arbitrated once for all of
+ * them. A failure of such a merged call is reported to every transfer that
+ * did not complete.
+ *
+ * A driver must not unbind while one of its transfers is pending: it has
+ * to either wait for @xfer->complete or call i2c_transfer_async_cancel()
+ * from its remove() callback.
+ *
+ * Returns negative errno if the transfer could not be queued, else 0.
+ * -ESHUTDOWN is returned once the adapter is being deleted.
+ */
+/* i2c_transfer_async - 将一条或多条I2C消息加入适配器的异步传输队列
+ * @adap:   I2C总线句柄
+ * @xfer:   待传输的异步传输结构，在 complete 回调之前必须保持有效
+ *
+ * 传输在适配器的工作队列中按照提交顺序执行，设置了 I2C_ASYNC_XFER_COMBINE
+ * 的相邻传输可能会被合并成一次 master_xfer 调用，减少总线仲裁的次数
+ * 驱动在 remove() 之前必须等待 complete 回调或调用 i2c_transfer_async_cancel()
+ * */
+int i2c_transfer_async(struct i2c_adapter *adap, struct i2c_async_xfer *xfer)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	if (!adap->algo->master_xfer)
+		return -EOPNOTSUPP;
+
+	if (WARN_ON(!xfer->msgs || xfer->num < 1 || !xfer->complete))
+		return -EINVAL;
+
+	spin_lock_irqsave(&adap->async_lock, flags);
+	if (adap->async_shutdown)
+		ret = -ESHUTDOWN;
+	else
+		list_add_tail(&xfer->node, &adap->async_queue);
+	spin_unlock_irqrestore(&adap->async_lock, flags);
+
+	if (!ret)
+		schedule_work(&adap->async_work);
+
+	return ret;
+}
+EXPORT_SYMBOL(i2c_transfer_async);
+
+/**
+ * i2c_transfer_async_cancel - cancel a transfer queued with i2c_transfer_async()
+ * @adap: Handle to I2C bus
+ * @xfer: Transfer to cancel
+ *
+ * Removes @xfer from the queue if it has not been started yet. Otherwise
+ * waits until @xfer->complete has returned. Either way the I2C core no longer
+ * references @xfer afterwards. Must not be called from atomic context nor from
+ * a ->complete callback.
+ *
+ * Returns true if @xfer was dequeued, in which case @xfer->complete is not
+ * called, false if it had already been started or completed.
+ */
+/* i2c_transfer_async_cancel - 取消异步传输
+ * @adap:   I2C总线句柄
+ * @xfer:   待取消的异步传输结构
+ *
+ * 传输尚未开始则将其从队列中移除，不会再调用 complete 回调，返回 true
+ * 否则等待 complete 回调返回，返回 false，可能睡眠
+ * */
+bool i2c_transfer_async_cancel(struct i2c_adapter *adap,
+			       struct i2c_async_xfer *xfer)
+{
+	struct i2c_async_xfer *pos;
+	bool found = false;
+
+	might_sleep();
+
+	spin_lock_irq(&adap->async_lock);
+	list_for_each_entry(pos, &adap->async_queue, node) {
+		if (pos == xfer) {
+			list_del_init(&xfer->node);
+			found = true;
+			break;
+		}
+	}
+	spin_unlock_irq(&adap->async_lock);
+
+    /* 传输已被工作队列取出，等待其完成 */
+	if (!found)
+		flush_work(&adap->async_work);
+
+	return found;
+}
+EXPORT_SYMBOL(i2c_transfer_async_cancel);
+
 /**
  * i2c_transfer_buffer_flags - issue a single I2C message transferring data
  *			       to/from a buffer
@@ -16,6 +16,8 @@
 #include <linux/iio/buffer-dma.h>
 #include <linux/dma-mapping.h>
 #include <linux/sizes.h>
+#include <linux/mm.h>
+#include <linux/timekeeping.h>
 
 /*
  * For DMA buffers the storage is sub-divided into so called blocks. Each block
@@ -88,6 +90,14 @@
  * has special requirements that are not handled by the generic functions. If a
  * driver chooses to overload a callback it has to ensure that the generic
  * callback is called from within the custom callback.
+ *
+ * Instead of read() userspace can also exchange blocks with the buffer
+ * directly. Blocks are allocated with IIO_BUFFER_BLOCK_ALLOC_IOCTL, mapped
+ * with mmap() at the offset reported by IIO_BUFFER_BLOCK_QUERY_IOCTL and then
+ * cycled through IIO_BUFFER_BLOCK_ENQUEUE_IOCTL and
+ * IIO_BUFFER_BLOCK_DEQUEUE_IOCTL. Freshly allocated blocks are owned by the
+ * application, so they have to be enqueued before the DMA controller can use
+ * them. The samples are never copied by the CPU in this mode.
  */
 
 static void iio_buffer_block_release(struct kref *kref)
@@ -198,6 +208,7 @@ static void _iio_dma_buffer_block_done(struct iio_dma_buffer_block *block)
 	 * reference.
 	 */
 	if (block->state != IIO_BLOCK_STATE_DEAD) {
+		block->timestamp = ktime_get_ns();
 		block->state = IIO_BLOCK_STATE_DONE;
 		list_add_tail(&block->head, &queue->outgoing);
 	}
@@ -296,6 +307,10 @@ int iio_dma_buffer_request_update(struct iio_buffer *buffer)
 
 	mutex_lock(&queue->lock);
 
+	/* In mmap mode the application owns the blocks */
+	if (queue->num_blocks)
+		goto out_unlock;
+
 	/* Allocations are page aligned */
 	if (PAGE_ALIGN(queue->fileio.block_size) == PAGE_ALIGN(size))
 		try_reuse = true;
@@ -490,6 +505,11 @@ int iio_dma_buffer_read(struct iio_buffer *buffer, size_t n,
 
 	mutex_lock(&queue->lock);
 
+	if (queue->num_blocks) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
 	if (!queue->fileio.active_block) {
 		block = iio_dma_buffer_dequeue(queue);
 		if (block == NULL) {
@@ -527,6 +547,345 @@ int iio_dma_buffer_read(struct iio_buffer *buffer, size_t n,
 }
 EXPORT_SYMBOL_GPL(iio_dma_buffer_read);
 
+static void iio_dma_buffer_fileio_free(struct iio_dma_buffer_queue *queue)
+{
+	unsigned int i;
+
+	spin_lock_irq(&queue->list_lock);
+	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
+		if (!queue->fileio.blocks[i])
+			continue;
+		queue->fileio.blocks[i]->state = IIO_BLOCK_STATE_DEAD;
+	}
+	INIT_LIST_HEAD(&queue->outgoing);
+	spin_unlock_irq(&queue->list_lock);
+
+	INIT_LIST_HEAD(&queue->incoming);
+
+	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
+		if (!queue->fileio.blocks[i])
+			continue;
+		iio_buffer_block_put(queue->fileio.blocks[i]);
+		queue->fileio.blocks[i] = NULL;
+	}
+	queue->fileio.active_block = NULL;
+	queue->fileio.block_size = 0;
+}
+
+static void iio_dma_buffer_mmap_free(struct iio_dma_buffer_queue *queue)
+{
+	struct iio_dma_buffer_block **blocks = queue->blocks;
+	unsigned int num_blocks = queue->num_blocks;
+	unsigned int i;
+
+	if (!num_blocks)
+		return;
+
+	/*
+	 * Blocks that are still owned by the DMA controller or mapped by the
+	 * application are freed once the last reference is dropped.
+	 */
+	spin_lock_irq(&queue->list_lock);
+	for (i = 0; i < num_blocks; i++)
+		blocks[i]->state = IIO_BLOCK_STATE_DEAD;
+	INIT_LIST_HEAD(&queue->outgoing);
+	queue->blocks = NULL;
+	queue->num_blocks = 0;
+	spin_unlock_irq(&queue->list_lock);
+
+	INIT_LIST_HEAD(&queue->incoming);
+
+	for (i = 0; i < num_blocks; i++)
+		iio_buffer_block_put(blocks[i]);
+
+	kfree(blocks);
+}
+
+/**
+ * iio_dma_buffer_alloc_blocks() - DMA buffer alloc_blocks callback
+ * @buffer: Buffer to allocate the blocks for
+ * @req: Allocation request, updated with the result
+ *
+ * Frees the blocks used for read() and allocates @req->count blocks of
+ * @req->size bytes that are exchanged with the application directly. Fewer
+ * blocks than requested may be allocated if memory runs out. Should be used as
+ * the alloc_blocks callback for iio_buffer_access_ops struct for DMA buffers.
+ */
+int iio_dma_buffer_alloc_blocks(struct iio_buffer *buffer,
+	struct iio_buffer_block_alloc_req *req)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block **blocks;
+	unsigned int i;
+	int ret = 0;
+
+	if (req->type || !req->size || !req->count || req->size > INT_MAX)
+		return -EINVAL;
+
+	/* All block offsets have to be representable in the descriptor */
+	if ((u64)req->count * PAGE_ALIGN(req->size) > U32_MAX)
+		return -EINVAL;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->active || queue->num_blocks) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	blocks = kcalloc(req->count, sizeof(*blocks), GFP_KERNEL);
+	if (!blocks) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	iio_dma_buffer_fileio_free(queue);
+
+	for (i = 0; i < req->count; i++) {
+		blocks[i] = iio_dma_buffer_alloc_block(queue, req->size);
+		if (!blocks[i])
+			break;
+		blocks[i]->id = i;
+	}
+
+	if (i == 0) {
+		kfree(blocks);
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	/* iio_dma_buffer_mmap() looks the blocks up under list_lock only */
+	spin_lock_irq(&queue->list_lock);
+	queue->blocks = blocks;
+	queue->num_blocks = i;
+	spin_unlock_irq(&queue->list_lock);
+
+	req->count = i;
+	req->id = 0;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_alloc_blocks);
+
+/**
+ * iio_dma_buffer_free_blocks() - DMA buffer free_blocks callback
+ * @buffer: Buffer to free the blocks of
+ *
+ * Frees the blocks allocated by iio_dma_buffer_alloc_blocks() and switches the
+ * buffer back to read() mode. Should be used as the free_blocks callback for
+ * iio_buffer_access_ops struct for DMA buffers.
+ */
+int iio_dma_buffer_free_blocks(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+	if (queue->active)
+		ret = -EBUSY;
+	else
+		iio_dma_buffer_mmap_free(queue);
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_free_blocks);
+
+static void iio_dma_buffer_block_to_user(struct iio_dma_buffer_block *block,
+	struct iio_buffer_block *user_block)
+{
+	user_block->id = block->id;
+	user_block->size = block->size;
+	user_block->bytes_used = block->bytes_used;
+	user_block->type = 0;
+	user_block->flags = 0;
+	user_block->data.offset = block->id * PAGE_ALIGN(block->size);
+	user_block->timestamp = block->timestamp;
+	if (block->timestamp)
+		user_block->flags |= IIO_BUFFER_BLOCK_FLAG_TIMESTAMP_VALID;
+}
+
+/**
+ * iio_dma_buffer_query_block() - DMA buffer query_block callback
+ * @buffer: Buffer the block belongs to
+ * @block: Descriptor, @block->id selects the block to query
+ *
+ * Should be used as the query_block callback for iio_buffer_access_ops
+ * struct for DMA buffers.
+ */
+int iio_dma_buffer_query_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+	if (block->id >= queue->num_blocks)
+		ret = -EINVAL;
+	else
+		iio_dma_buffer_block_to_user(queue->blocks[block->id], block);
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_query_block);
+
+/**
+ * iio_dma_buffer_enqueue_block() - DMA buffer enqueue_block callback
+ * @buffer: Buffer to enqueue the block to
+ * @block: Descriptor of a block that is owned by the application
+ *
+ * Should be used as the enqueue_block callback for iio_buffer_access_ops
+ * struct for DMA buffers.
+ */
+int iio_dma_buffer_enqueue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (block->id >= queue->num_blocks) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	dma_block = queue->blocks[block->id];
+	if (dma_block->state != IIO_BLOCK_STATE_DEQUEUED) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	dma_block->timestamp = 0;
+	iio_dma_buffer_enqueue(queue, dma_block);
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_enqueue_block);
+
+/**
+ * iio_dma_buffer_dequeue_block() - DMA buffer dequeue_block callback
+ * @buffer: Buffer to dequeue the block from
+ * @block: Filled in with the descriptor of the dequeued block
+ *
+ * Returns -EAGAIN if no completed block is available. Should be used as the
+ * dequeue_block callback for iio_buffer_access_ops struct for DMA buffers.
+ */
+int iio_dma_buffer_dequeue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (!queue->num_blocks) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	dma_block = iio_dma_buffer_dequeue(queue);
+	if (!dma_block) {
+		ret = -EAGAIN;
+		goto out_unlock;
+	}
+
+	iio_dma_buffer_block_to_user(dma_block, block);
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_dequeue_block);
+
+static void iio_dma_buffer_mmap_open(struct vm_area_struct *area)
+{
+	struct iio_dma_buffer_block *block = area->vm_private_data;
+
+	iio_buffer_block_get(block);
+}
+
+static void iio_dma_buffer_mmap_close(struct vm_area_struct *area)
+{
+	struct iio_dma_buffer_block *block = area->vm_private_data;
+
+	iio_buffer_block_put(block);
+}
+
+static const struct vm_operations_struct iio_dma_buffer_vm_ops = {
+	.open = iio_dma_buffer_mmap_open,
+	.close = iio_dma_buffer_mmap_close,
+};
+
+/**
+ * iio_dma_buffer_mmap() - DMA buffer mmap callback
+ * @buffer: Buffer the block belongs to
+ * @vma: Mapping, the offset selects the block
+ *
+ * The mapping holds a reference to the block, so the memory stays valid even
+ * if the blocks are freed while they are still mapped. Should be used as the
+ * mmap callback for iio_buffer_access_ops struct for DMA buffers.
+ */
+int iio_dma_buffer_mmap(struct iio_buffer *buffer,
+	struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block = NULL;
+	unsigned long offset, block_size;
+	unsigned int id;
+	int ret;
+
+	/*
+	 * mmap_lock is held here, and read() faults with queue->lock held, so
+	 * only take list_lock to look up the block, and keep it alive with a
+	 * reference of its own instead.
+	 */
+	spin_lock_irq(&queue->list_lock);
+	if (queue->num_blocks) {
+		/* All blocks have the same size */
+		block_size = PAGE_ALIGN(queue->blocks[0]->size);
+		offset = vma->vm_pgoff << PAGE_SHIFT;
+		id = offset / block_size;
+
+		if (id < queue->num_blocks && !(offset % block_size) &&
+		    vma->vm_end - vma->vm_start <= block_size) {
+			block = queue->blocks[id];
+			iio_buffer_block_get(block);
+		}
+	}
+	spin_unlock_irq(&queue->list_lock);
+
+	if (!block)
+		return -EINVAL;
+
+	/* dma_mmap_coherent() takes the offset into the block from vm_pgoff */
+	vma->vm_pgoff = 0;
+	ret = dma_mmap_coherent(queue->dev, vma, block->vaddr,
+		block->phys_addr, vma->vm_end - vma->vm_start);
+	if (ret) {
+		iio_buffer_block_put(block);
+		return ret;
+	}
+
+	/* The mapping takes over the reference */
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_private_data = block;
+	vma->vm_ops = &iio_dma_buffer_vm_ops;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_mmap);
+
 /**
  * iio_dma_buffer_data_available() - DMA buffer data_available callback
  * @buf: Buffer to check for data availability
@@ -635,28 +994,10 @@ EXPORT_SYMBOL_GPL(iio_dma_buffer_init);
  */
 void iio_dma_buffer_exit(struct iio_dma_buffer_queue *queue)
 {
-	unsigned int i;
-
 	mutex_lock(&queue->lock);
 
-	spin_lock_irq(&queue->list_lock);
-	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
-		if (!queue->fileio.blocks[i])
-			continue;
-		queue->fileio.blocks[i]->state = IIO_BLOCK_STATE_DEAD;
-	}
-	INIT_LIST_HEAD(&queue->outgoing);
-	spin_unlock_irq(&queue->list_lock);
-
-	INIT_LIST_HEAD(&queue->incoming);
-
-	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
-		if (!queue->fileio.blocks[i])
-			continue;
-		iio_buffer_block_put(queue->fileio.blocks[i]);
-		queue->fileio.blocks[i] = NULL;
-	}
-	queue->fileio.active_block = NULL;
+	iio_dma_buffer_fileio_free(queue);
+	iio_dma_buffer_mmap_free(queue);
 	queue->ops = NULL;
 
 	mutex_unlock(&queue->lock);
@@ -17,6 +17,7 @@
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/slab.h>
+#include <linux/mm.h>
 #include <linux/poll.h>
 #include <linux/sched/signal.h>
 
@@ -1391,6 +1392,10 @@ static int iio_buffer_chrdev_release(struct inode *inode, struct file *filep)
 
 	wake_up(&buffer->pollq);
 
+	/* Best effort, fails if the buffer is still enabled */
+	if (buffer->access->free_blocks)
+		buffer->access->free_blocks(buffer);
+
 	kfree(ib);
 	clear_bit(IIO_BUSY_BIT_POS, &buffer->flags);
 	iio_device_put(indio_dev);
@@ -1398,11 +1403,150 @@ static int iio_buffer_chrdev_release(struct inode *inode, struct file *filep)
 	return 0;
 }
 
+static int iio_buffer_alloc_blocks(struct iio_buffer *buffer,
+				   struct iio_buffer_block_alloc_req __user *user_req)
+{
+	struct iio_buffer_block_alloc_req req;
+	int ret;
+
+	if (!buffer->access->alloc_blocks)
+		return -ENOTTY;
+
+	if (copy_from_user(&req, user_req, sizeof(req)))
+		return -EFAULT;
+
+	ret = buffer->access->alloc_blocks(buffer, &req);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(user_req, &req, sizeof(req)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int iio_buffer_block_op(struct iio_buffer *buffer,
+			       struct iio_buffer_block __user *user_block,
+			       int (*op)(struct iio_buffer *buffer,
+					 struct iio_buffer_block *block))
+{
+	struct iio_buffer_block block;
+	int ret;
+
+	if (!op)
+		return -ENOTTY;
+
+	if (copy_from_user(&block, user_block, sizeof(block)))
+		return -EFAULT;
+
+	ret = op(buffer, &block);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(user_block, &block, sizeof(block)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int iio_buffer_dequeue_block(struct file *filep,
+				    struct iio_buffer_block __user *user_block)
+{
+	struct iio_dev_buffer_pair *ib = filep->private_data;
+	struct iio_buffer *buffer = ib->buffer;
+	struct iio_dev *indio_dev = ib->indio_dev;
+	DEFINE_WAIT_FUNC(wait, woken_wake_function);
+	struct iio_buffer_block block;
+	int ret;
+
+	if (!buffer->access->dequeue_block)
+		return -ENOTTY;
+
+	add_wait_queue(&buffer->pollq, &wait);
+	do {
+		if (!indio_dev->info) {
+			ret = -ENODEV;
+			break;
+		}
+
+		ret = buffer->access->dequeue_block(buffer, &block);
+		if (ret != -EAGAIN || (filep->f_flags & O_NONBLOCK))
+			break;
+
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+
+		wait_woken(&wait, TASK_INTERRUPTIBLE, MAX_SCHEDULE_TIMEOUT);
+	} while (1);
+	remove_wait_queue(&buffer->pollq, &wait);
+
+	if (ret)
+		return ret;
+
+	if (copy_to_user(user_block, &block, sizeof(block)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static long iio_buffer_chrdev_ioctl(struct file *filep, unsigned int cmd,
+				    unsigned long arg)
+{
+	struct iio_dev_buffer_pair *ib = filep->private_data;
+	struct iio_buffer *buffer = ib->buffer;
+	void __user *_arg = (void __user *)arg;
+
+	if (!ib->indio_dev->info)
+		return -ENODEV;
+
+	switch (cmd) {
+	case IIO_BUFFER_BLOCK_ALLOC_IOCTL:
+		return iio_buffer_alloc_blocks(buffer, _arg);
+	case IIO_BUFFER_BLOCK_FREE_IOCTL:
+		if (!buffer->access->free_blocks)
+			return -ENOTTY;
+		return buffer->access->free_blocks(buffer);
+	case IIO_BUFFER_BLOCK_QUERY_IOCTL:
+		return iio_buffer_block_op(buffer, _arg,
+					   buffer->access->query_block);
+	case IIO_BUFFER_BLOCK_ENQUEUE_IOCTL:
+		return iio_buffer_block_op(buffer, _arg,
+					   buffer->access->enqueue_block);
+	case IIO_BUFFER_BLOCK_DEQUEUE_IOCTL:
+		return iio_buffer_dequeue_block(filep, _arg);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static int iio_buffer_chrdev_mmap(struct file *filep,
+				  struct vm_area_struct *vma)
+{
+	struct iio_dev_buffer_pair *ib = filep->private_data;
+	struct iio_buffer *buffer = ib->buffer;
+
+	if (!ib->indio_dev->info)
+		return -ENODEV;
+
+	if (!buffer->access->mmap)
+		return -ENODEV;
+
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	return buffer->access->mmap(buffer, vma);
+}
+
 static const struct file_operations iio_buffer_chrdev_fileops = {
 	.owner = THIS_MODULE,
 	.llseek = noop_llseek,
 	.read = iio_buffer_read,
 	.poll = iio_buffer_poll,
+	.unlocked_ioctl = iio_buffer_chrdev_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+	.mmap = iio_buffer_chrdev_mmap,
 	.release = iio_buffer_chrdev_release,
 };
 
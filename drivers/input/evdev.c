@@ -280,7 +280,12 @@ static void evdev_pass_values(struct evdev_client *client,
 
 	spin_unlock(&client->buffer_lock);
 
-	if (wakeup)
+	/*
+	 * Most clients of a busy device are not sleeping when a packet
+	 * completes, skip the wait queue lock for them.  Pairs with the
+	 * barrier in evdev_poll() and the one in prepare_to_wait().
+	 */
+	if (wakeup && wq_has_sleeper(&client->wait))
 		wake_up_interruptible_poll(&client->wait,
 			EPOLLIN | EPOLLOUT | EPOLLRDNORM | EPOLLWRNORM);
 }
@@ -614,6 +619,8 @@ static __poll_t evdev_poll(struct file *file, poll_table *wait)
 	__poll_t mask;
 
 	poll_wait(file, &client->wait, wait);
+	/* Order queueing on client->wait against reading packet_head */
+	smp_mb();
 
 	if (evdev->exist && !client->revoked)
 		mask = EPOLLOUT | EPOLLWRNORM;
@@ -476,6 +476,45 @@ static dma_addr_t iommu_dma_alloc_iova(struct iommu_domain *domain,
 	return (dma_addr_t)iova << shift;
 }
 
+/*
+ * IOVA allocations are aligned to their size, but a physically contiguous
+ * buffer starting at, say, 64KiB + 4KiB then sits at a different offset in
+ * any large IOMMU page than its IOVA, and can only be mapped with the
+ * smallest pages. For buffers too large for the IOVA caches, pad the
+ * allocation so that the IOVA gets the same offset as @phys within the
+ * largest page size the buffer can use. Freeing only needs an address
+ * inside the allocation, so the padding goes back with the buffer.
+ */
+static dma_addr_t iommu_dma_alloc_iova_phys(struct iommu_domain *domain,
+		size_t size, u64 dma_limit, struct device *dev, phys_addr_t phys)
+{
+	struct iommu_dma_cookie *cookie = domain->iova_cookie;
+	struct iova_domain *iovad = &cookie->iovad;
+	unsigned long pgsizes;
+	size_t align, pad;
+	dma_addr_t iova;
+
+	if (cookie->type != IOMMU_DMA_IOVA_COOKIE || size <= iova_rcache_range())
+		return iommu_dma_alloc_iova(domain, size, dma_limit, dev);
+
+	pgsizes = domain->pgsize_bitmap & GENMASK(__fls(size), 0);
+	if (!pgsizes)
+		return iommu_dma_alloc_iova(domain, size, dma_limit, dev);
+
+	align = 1UL << __fls(pgsizes);
+	pad = phys & (align - 1);
+	/* a padded range must not cross a segment boundary either */
+	if (align <= iovad->granule || !pad ||
+	    size + pad - 1 > dma_get_seg_boundary(dev))
+		return iommu_dma_alloc_iova(domain, size, dma_limit, dev);
+
+	/* size + pad >= align, so the allocation itself is align-aligned */
+	iova = iommu_dma_alloc_iova(domain, size + pad, dma_limit, dev);
+	if (!iova)
+		return 0;
+	return iova + pad;
+}
+
 static void iommu_dma_free_iova(struct iommu_dma_cookie *cookie,
 		dma_addr_t iova, size_t size, struct iommu_iotlb_gather *gather)
 {
@@ -531,7 +570,8 @@ static dma_addr_t __iommu_dma_map(struct device *dev, phys_addr_t phys,
 
 	size = iova_align(iovad, size + iova_off);
 
-	iova = iommu_dma_alloc_iova(domain, size, dma_mask, dev);
+	iova = iommu_dma_alloc_iova_phys(domain, size, dma_mask, dev,
+					 phys - iova_off);
 	if (!iova)
 		return DMA_MAPPING_ERROR;
 
@@ -1047,7 +1087,8 @@ static int iommu_dma_map_sg(struct device *dev, struct scatterlist *sg,
 		prev = s;
 	}
 
-	iova = iommu_dma_alloc_iova(domain, iova_len, dma_get_mask(dev), dev);
+	iova = iommu_dma_alloc_iova_phys(domain, iova_len, dma_get_mask(dev),
+					 dev, sg_phys(sg));
 	if (!iova) {
 		ret = -ENOMEM;
 		goto out_restore_sg;
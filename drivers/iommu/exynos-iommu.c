@@ -9,6 +9,7 @@
 #endif
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
 #include <linux/io.h>
@@ -178,6 +179,29 @@ static struct kmem_cache *lv2table_kmem_cache;
 static sysmmu_pte_t *zero_lv2_table;
 #define ZERO_LV2LINK mk_lv1ent_page(virt_to_phys(zero_lv2_table))
 
+#ifdef CONFIG_IOMMU_DEBUGFS
+/*
+ * Number of live 1MiB, 64KiB and 4KiB entries over all domains, to check
+ * how well buffers end up mapped with large pages.
+ */
+enum { MAP_SECT, MAP_LPAGE, MAP_SPAGE, MAP_NR_SIZES };
+static atomic_long_t map_count[MAP_NR_SIZES];
+
+static void exynos_iommu_count_map(size_t size, long delta)
+{
+	if (size == SECT_SIZE)
+		atomic_long_add(delta, &map_count[MAP_SECT]);
+	else if (size == LPAGE_SIZE)
+		atomic_long_add(delta, &map_count[MAP_LPAGE]);
+	else
+		atomic_long_add(delta, &map_count[MAP_SPAGE]);
+}
+#else
+static void exynos_iommu_count_map(size_t size, long delta)
+{
+}
+#endif
+
 static sysmmu_pte_t *section_entry(sysmmu_pte_t *pgtable, sysmmu_iova_t iova)
 {
 	return pgtable + lv1ent_offset(iova);
@@ -529,32 +553,75 @@ static void sysmmu_tlb_invalidate_flpdcache(struct sysmmu_drvdata *data,
 	spin_unlock_irqrestore(&data->lock, flags);
 }
 
-static void sysmmu_tlb_invalidate_entry(struct sysmmu_drvdata *data,
-					sysmmu_iova_t iova, size_t size)
+/*
+ * Before v5, entries are invalidated one register write at a time: past this
+ * many writes per range, flushing the whole TLB is cheaper.
+ */
+#define SYSMMU_FLUSH_ALL_ENTRIES	64
+
+/*
+ * Invalidate the TLB entries of the range [iova, iova + size), in which no
+ * mapping is smaller than stride bytes.
+ */
+static void __sysmmu_tlb_invalidate_range(struct sysmmu_drvdata *data,
+					  sysmmu_iova_t iova, size_t size,
+					  size_t stride)
+{
+	if (MMU_MAJ_VER(data->version) >= 5) {
+		__sysmmu_tlb_invalidate_entry(data, iova, size / SPAGE_SIZE);
+		return;
+	}
+
+	/*
+	 * L2TLB invalidation required
+	 * 4KB page: 1 invalidation
+	 * 64KB page: 16 invalidations
+	 * 1MB page: 64 invalidations
+	 * because it is set-associative TLB
+	 * with 8-way and 64 sets.
+	 * 1MB page can be cached in one of all sets.
+	 * 64KB page can be one of 16 consecutive sets.
+	 */
+	if (MMU_MAJ_VER(data->version) == 2)
+		stride = SPAGE_SIZE;
+
+	if (size / stride > SYSMMU_FLUSH_ALL_ENTRIES) {
+		__sysmmu_tlb_invalidate(data);
+		return;
+	}
+
+	for (; size; iova += stride, size -= stride)
+		writel((iova & SPAGE_MASK) | 1,
+		       data->sfrbase + REG_MMU_FLUSH_ENTRY);
+}
+
+static void sysmmu_tlb_invalidate_range(struct sysmmu_drvdata *data,
+					sysmmu_iova_t iova, size_t size,
+					size_t stride)
 {
 	unsigned long flags;
 
 	spin_lock_irqsave(&data->lock, flags);
 	if (data->active) {
-		unsigned int num_inv = 1;
-
 		clk_enable(data->clk_master);
+		if (sysmmu_block(data)) {
+			__sysmmu_tlb_invalidate_range(data, iova, size, stride);
+			sysmmu_unblock(data);
+		}
+		clk_disable(data->clk_master);
+	}
+	spin_unlock_irqrestore(&data->lock, flags);
+}
 
-		/*
-		 * L2TLB invalidation required
-		 * 4KB page: 1 invalidation
-		 * 64KB page: 16 invalidations
-		 * 1MB page: 64 invalidations
-		 * because it is set-associative TLB
-		 * with 8-way and 64 sets.
-		 * 1MB page can be cached in one of all sets.
-		 * 64KB page can be one of 16 consecutive sets.
-		 */
-		if (MMU_MAJ_VER(data->version) == 2)
-			num_inv = min_t(unsigned int, size / PAGE_SIZE, 64);
+static void sysmmu_tlb_invalidate_all(struct sysmmu_drvdata *data)
+{
+	unsigned long flags;
 
+	spin_lock_irqsave(&data->lock, flags);
+	if (data->active) {
+		clk_enable(data->clk_master);
 		if (sysmmu_block(data)) {
-			__sysmmu_tlb_invalidate_entry(data, iova, num_inv);
+			__sysmmu_tlb_invalidate(data);
 			sysmmu_unblock(data);
 		}
 		clk_disable(data->clk_master);
@@ -1096,26 +1163,66 @@ static int exynos_iommu_map(struct iommu_domain *iommu_domain,
 	if (ret)
 		pr_err("%s: Failed(%d) to map %#zx bytes @ %#x\n",
 			__func__, ret, size, iova);
+	else
+		exynos_iommu_count_map(size, 1);
 
 	spin_unlock_irqrestore(&domain->pgtablelock, flags);
 
 	return ret;
 }
 
-static void exynos_iommu_tlb_invalidate_entry(struct exynos_iommu_domain *domain,
-					      sysmmu_iova_t iova, size_t size)
+static void exynos_iommu_flush_iotlb_all(struct iommu_domain *iommu_domain)
+{
+	struct exynos_iommu_domain *domain = to_exynos_domain(iommu_domain);
+	struct sysmmu_drvdata *data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&domain->lock, flags);
+
+	list_for_each_entry(data, &domain->clients, domain_node)
+		sysmmu_tlb_invalidate_all(data);
+
+	spin_unlock_irqrestore(&domain->lock, flags);
+}
+
+/*
+ * Unmapping only gathers the unmapped range, so that unmapping a large
+ * buffer costs one range invalidation per System MMU here instead of one
+ * per page or section. gather->pgsize holds the smallest mapping size
+ * gathered, which is the stride entry-based invalidation needs.
+ */
+static void exynos_iommu_iotlb_sync(struct iommu_domain *iommu_domain,
+				    struct iommu_iotlb_gather *gather)
 {
+	struct exynos_iommu_domain *domain = to_exynos_domain(iommu_domain);
 	struct sysmmu_drvdata *data;
 	unsigned long flags;
 
+	if (!gather->pgsize)
+		return;
+
 	spin_lock_irqsave(&domain->lock, flags);
 
 	list_for_each_entry(data, &domain->clients, domain_node)
-		sysmmu_tlb_invalidate_entry(data, iova, size);
+		sysmmu_tlb_invalidate_range(data, gather->start,
+					    gather->end - gather->start + 1,
+					    gather->pgsize);
 
 	spin_unlock_irqrestore(&domain->lock, flags);
 }
 
+static void exynos_iommu_gather_add(struct iommu_domain *iommu_domain,
+				    struct iommu_iotlb_gather *gather,
+				    sysmmu_iova_t iova, size_t size)
+{
+	if (iommu_iotlb_gather_is_disjoint(gather, iova, size))
+		iommu_iotlb_sync(iommu_domain, gather);
+
+	if (!gather->pgsize || size < gather->pgsize)
+		gather->pgsize = size;
+	iommu_iotlb_gather_add_range(gather, iova, size);
+}
+
 static size_t exynos_iommu_unmap(struct iommu_domain *iommu_domain,
 				 unsigned long l_iova, size_t size,
 				 struct iommu_iotlb_gather *gather)
@@ -1125,6 +1232,7 @@ static size_t exynos_iommu_unmap(struct iommu_domain *iommu_domain,
 	sysmmu_pte_t *ent;
 	size_t err_pgsize;
 	unsigned long flags;
+	bool fault = false;
 
 	BUG_ON(domain->pgtable == NULL);
 
@@ -1147,6 +1255,7 @@ static size_t exynos_iommu_unmap(struct iommu_domain *iommu_domain,
 	if (unlikely(lv1ent_fault(ent))) {
 		if (size > SECT_SIZE)
 			size = SECT_SIZE;
+		fault = true;
 		goto done;
 	}
 
@@ -1156,6 +1265,7 @@ static size_t exynos_iommu_unmap(struct iommu_domain *iommu_domain,
 
 	if (unlikely(lv2ent_fault(ent))) {
 		size = SPAGE_SIZE;
+		fault = true;
 		goto done;
 	}
 
@@ -1184,7 +1294,9 @@ static size_t exynos_iommu_unmap(struct iommu_domain *iommu_domain,
 done:
 	spin_unlock_irqrestore(&domain->pgtablelock, flags);
 
-	exynos_iommu_tlb_invalidate_entry(domain, iova, size);
+	exynos_iommu_gather_add(iommu_domain, gather, iova, size);
+	if (!fault)
+		exynos_iommu_count_map(size, -1);
 
 	return size;
 err:
@@ -1318,6 +1430,8 @@ static const struct iommu_ops exynos_iommu_ops = {
 	.detach_dev = exynos_iommu_detach_device,
 	.map = exynos_iommu_map,
 	.unmap = exynos_iommu_unmap,
+	.flush_iotlb_all = exynos_iommu_flush_iotlb_all,
+	.iotlb_sync = exynos_iommu_iotlb_sync,
 	.iova_to_phys = exynos_iommu_iova_to_phys,
 	.device_group = generic_device_group,
 	.probe_device = exynos_iommu_probe_device,
@@ -1375,3 +1489,28 @@ static int __init exynos_iommu_init(void)
 	return ret;
 }
 core_initcall(exynos_iommu_init);
+
+#ifdef CONFIG_IOMMU_DEBUGFS
+static int map_sizes_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "1M:  %ld\n", atomic_long_read(&map_count[MAP_SECT]));
+	seq_printf(s, "64K: %ld\n", atomic_long_read(&map_count[MAP_LPAGE]));
+	seq_printf(s, "4K:  %ld\n", atomic_long_read(&map_count[MAP_SPAGE]));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(map_sizes);
+
+static int __init exynos_iommu_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	if (!zero_lv2_table)
+		return 0;
+
+	iommu_debugfs_setup();
+	dir = debugfs_create_dir("exynos", iommu_debugfs_dir);
+	debugfs_create_file("map_sizes", 0444, dir, NULL, &map_sizes_fops);
+	return 0;
+}
+late_initcall(exynos_iommu_debugfs_init);
+#endif
@@ -141,6 +141,12 @@ static int gsc_get_bufs(struct gsc_ctx *ctx)
 	return 0;
 }
 
+/*
+ * The GScaler has a single output DMA, so each job fetches its source
+ * frame again. To produce several sizes of one frame at less memory
+ * bandwidth, scale the largest output first and derive the smaller ones
+ * from it rather than from the full source.
+ */
 static void gsc_m2m_device_run(void *priv)
 {
 	struct gsc_ctx *ctx = priv;
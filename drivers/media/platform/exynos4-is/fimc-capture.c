@@ -1752,6 +1752,13 @@ static int fimc_register_capture_device(struct fimc_dev *fimc,
 
 	memset(q, 0, sizeof(*q));
 	q->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	/*
+	 * DMABUF buffers, e.g. from the CMA dma-buf heap, stay attached and
+	 * mapped as long as the same dma-buf is queued again at the same
+	 * index, and cache maintenance is left to the exporter, so a
+	 * re-queue costs no CPU cache syncs. Queueing another dma-buf at an
+	 * index remaps it.
+	 */
 	q->io_modes = VB2_MMAP | VB2_USERPTR | VB2_DMABUF;
 	q->drv_priv = ctx;
 	q->ops = &fimc_capture_qops;
@@ -8,12 +8,16 @@
  *          Sylwester Nawrocki <s.nawrocki@samsung.com>
  */
 #include <linux/delay.h>
+#include <linux/ktime.h>
 
 #include "fimc-is.h"
 #include "fimc-is-command.h"
 #include "fimc-is-regs.h"
 #include "fimc-is-sensor.h"
 
+#define CREATE_TRACE_POINTS
+#include "fimc-is-trace.h"
+
 void fimc_is_fw_clear_irq1(struct fimc_is *is, unsigned int nr)
 {
 	mcuctl_write(1UL << nr, is, MCUCTL_REG_INTCR1);
@@ -199,6 +203,8 @@ void fimc_is_hw_subip_power_off(struct fimc_is *is)
 
 int fimc_is_itf_s_param(struct fimc_is *is, bool update)
 {
+	unsigned int count;
+	ktime_t start;
 	int ret;
 
 	if (update)
@@ -206,10 +212,15 @@ int fimc_is_itf_s_param(struct fimc_is *is, bool update)
 
 	fimc_is_mem_barrier();
 
+	count = __get_pending_param_count(is);
+	start = ktime_get();
+
 	clear_bit(IS_ST_BLOCK_CMD_CLEARED, &is->state);
 	fimc_is_hw_set_param(is);
 	ret = fimc_is_wait_event(is, IS_ST_BLOCK_CMD_CLEARED, 1,
 				FIMC_IS_CONFIG_TIMEOUT);
+	trace_fimc_is_cmd(HIC_SET_PARAMETER, is->config_index, count,
+			  ktime_to_ns(ktime_sub(ktime_get(), start)), ret);
 	if (ret < 0)
 		dev_err(&is->pdev->dev, "%s() timeout\n", __func__);
 
@@ -218,12 +229,16 @@ int fimc_is_itf_s_param(struct fimc_is *is, bool update)
 
 int fimc_is_itf_mode_change(struct fimc_is *is)
 {
+	ktime_t start = ktime_get();
 	int ret;
 
 	clear_bit(IS_ST_CHANGE_MODE, &is->state);
 	fimc_is_hw_change_mode(is);
 	ret = fimc_is_wait_event(is, IS_ST_CHANGE_MODE, 1,
 				FIMC_IS_CONFIG_TIMEOUT);
+	trace_fimc_is_cmd(HIC_PREVIEW_STILL + is->config_index,
+			  is->config_index, 0,
+			  ktime_to_ns(ktime_sub(ktime_get(), start)), ret);
 	if (ret < 0)
 		dev_err(&is->pdev->dev, "%s(): mode change (%d) timeout\n",
 			__func__, is->config_index);
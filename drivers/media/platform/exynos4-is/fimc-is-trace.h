@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Samsung EXYNOS4x12 FIMC-IS (Imaging Subsystem) driver
+ *
+ * Tracepoints for the FIMC-IS firmware interface.
+ */
+
+#if !defined(FIMC_IS_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define FIMC_IS_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fimc_is
+#define TRACE_INCLUDE_FILE fimc-is-trace
+
+TRACE_EVENT(fimc_is_cmd,
+	TP_PROTO(unsigned int cmd, unsigned int config, unsigned int count,
+		 u64 latency_ns, int ret),
+	TP_ARGS(cmd, config, count, latency_ns, ret),
+	TP_STRUCT__entry(
+		__field(unsigned int, cmd)
+		__field(unsigned int, config)
+		__field(unsigned int, count)
+		__field(u64, latency_ns)
+		__field(int, ret)
+		),
+
+	TP_fast_assign(
+		__entry->cmd = cmd;
+		__entry->config = config;
+		__entry->count = count;
+		__entry->latency_ns = latency_ns;
+		__entry->ret = ret;
+		),
+
+	TP_printk("cmd=%u config=%u params=%u latency=%lluns ret=%d",
+		  __entry->cmd, __entry->config, __entry->count,
+		  __entry->latency_ns, __entry->ret)
+);
+
+#endif
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/media/platform/exynos4-is
+#include <trace/define_trace.h>
@@ -99,6 +99,16 @@ static int fimc_is_get_clocks(struct fimc_is *is)
 
 static int fimc_is_setup_clocks(struct fimc_is *is)
 {
+	struct clk_bulk_data divs[] = {
+		{ .id = "ispdiv0",	.clk = is->clocks[ISS_CLK_ISP_DIV0] },
+		{ .id = "ispdiv1",	.clk = is->clocks[ISS_CLK_ISP_DIV1] },
+		{ .id = "mcuispdiv0",	.clk = is->clocks[ISS_CLK_MCUISP_DIV0] },
+		{ .id = "mcuispdiv1",	.clk = is->clocks[ISS_CLK_MCUISP_DIV1] },
+	};
+	static const unsigned long rates[] = {
+		ACLK_AXI_FREQUENCY, ACLK_AXI_FREQUENCY,
+		ATCLK_MCUISP_FREQUENCY, ATCLK_MCUISP_FREQUENCY,
+	};
 	int ret;
 
 	ret = clk_set_parent(is->clocks[ISS_CLK_ACLK200],
@@ -111,21 +121,8 @@ static int fimc_is_setup_clocks(struct fimc_is *is)
 	if (ret < 0)
 		return ret;
 
-	ret = clk_set_rate(is->clocks[ISS_CLK_ISP_DIV0], ACLK_AXI_FREQUENCY);
-	if (ret < 0)
-		return ret;
-
-	ret = clk_set_rate(is->clocks[ISS_CLK_ISP_DIV1], ACLK_AXI_FREQUENCY);
-	if (ret < 0)
-		return ret;
-
-	ret = clk_set_rate(is->clocks[ISS_CLK_MCUISP_DIV0],
-					ATCLK_MCUISP_FREQUENCY);
-	if (ret < 0)
-		return ret;
-
-	return clk_set_rate(is->clocks[ISS_CLK_MCUISP_DIV1],
-					ATCLK_MCUISP_FREQUENCY);
+	/* The dividers share their parents, set them in one go */
+	return clk_bulk_set_rate(ARRAY_SIZE(divs), divs, rates);
 }
 
 static int fimc_is_enable_clocks(struct fimc_is *is)
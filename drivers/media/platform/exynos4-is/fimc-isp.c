@@ -31,6 +31,10 @@
 int fimc_isp_debug;
 module_param_named(debug_isp, fimc_isp_debug, int, S_IRUGO | S_IWUSR);
 
+static bool fimc_isp_param_batch;
+module_param_named(param_batch, fimc_isp_param_batch, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(param_batch, "Send the parameters of all controls set in one ioctl with a single firmware command");
+
 static const struct fimc_fmt fimc_isp_formats[FIMC_ISP_NUM_FORMATS] = {
 	{
 		.fourcc		= V4L2_PIX_FMT_SGRBG8,
@@ -664,12 +668,39 @@ static int fimc_is_s_ctrl(struct v4l2_ctrl *ctrl)
 		return ret;
 	}
 
-	if (set_param && test_bit(IS_ST_STREAM_ON, &is->state))
+	if (set_param && test_bit(IS_ST_STREAM_ON, &is->state)) {
+		if (fimc_isp_param_batch) {
+			schedule_work(&isp->param_work);
+			return 0;
+		}
 		return fimc_is_itf_s_param(is, true);
+	}
 
 	return 0;
 }
 
+/*
+ * The control handler lock is held while all controls of one
+ * VIDIOC_S_EXT_CTRLS call are set, so taking it here waits for the
+ * whole batch and the firmware gets a single HIC_SET_PARAMETER.
+ */
+static void fimc_isp_param_work(struct work_struct *work)
+{
+	struct fimc_isp *isp = container_of(work, struct fimc_isp, param_work);
+	struct fimc_is *is = fimc_isp_to_is(isp);
+	int ret;
+
+	mutex_lock(isp->ctrls.handler.lock);
+	if (test_bit(IS_ST_STREAM_ON, &is->state) &&
+	    __get_pending_param_count(is)) {
+		ret = fimc_is_itf_s_param(is, true);
+		if (ret < 0)
+			v4l2_err(&isp->subdev, "Failed to set parameters (%d)\n",
+				 ret);
+	}
+	mutex_unlock(isp->ctrls.handler.lock);
+}
+
 static const struct v4l2_ctrl_ops fimc_isp_ctrl_ops = {
 	.s_ctrl	= fimc_is_s_ctrl,
 };
@@ -699,6 +730,7 @@ int fimc_isp_subdev_create(struct fimc_isp *isp)
 	int ret;
 
 	mutex_init(&isp->subdev_lock);
+	INIT_WORK(&isp->param_work, fimc_isp_param_work);
 
 	v4l2_subdev_init(sd, &fimc_is_subdev_ops);
 
@@ -784,6 +816,7 @@ void fimc_isp_subdev_destroy(struct fimc_isp *isp)
 
 	v4l2_device_unregister_subdev(sd);
 	media_entity_cleanup(&sd->entity);
+	cancel_work_sync(&isp->param_work);
 	v4l2_ctrl_handler_free(&isp->ctrls.handler);
 	v4l2_set_subdevdata(sd, NULL);
 }
@@ -16,6 +16,7 @@
 #include <linux/spinlock.h>
 #include <linux/types.h>
 #include <linux/videodev2.h>
+#include <linux/workqueue.h>
 
 #include <media/media-entity.h>
 #include <media/videobuf2-v4l2.h>
@@ -161,6 +162,7 @@ struct fimc_is_video {
  * @cac_margin_y: vertical CAC margin in pixels
  * @state: driver state flags
  * @video_capture: the ISP block video capture device
+ * @param_work: worker sending the parameters changed by controls in one go
  */
 struct fimc_isp {
 	struct platform_device		*pdev;
@@ -180,6 +182,7 @@ struct fimc_isp {
 	unsigned long			state;
 
 	struct fimc_is_video		video_capture;
+	struct work_struct		param_work;
 };
 
 #define ctrl_to_fimc_isp(_ctrl) \
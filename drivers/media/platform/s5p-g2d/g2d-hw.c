@@ -24,7 +24,7 @@ void g2d_set_src_size(struct g2d_dev *d, struct g2d_frame *f)
 {
 	u32 n;
 
-	w(0, SRC_SELECT_REG);
+	w(SELECT_NORMAL, SRC_SELECT_REG);
 	w(f->stride & 0xFFFF, SRC_STRIDE_REG);
 
 	n = f->o_height & 0xFFF;
@@ -49,7 +49,7 @@ void g2d_set_dst_size(struct g2d_dev *d, struct g2d_frame *f)
 {
 	u32 n;
 
-	w(0, DST_SELECT_REG);
+	w(SELECT_NORMAL, DST_SELECT_REG);
 	w(f->stride & 0xFFFF, DST_STRIDE_REG);
 
 	n = f->o_height & 0xFFF;
@@ -95,6 +95,24 @@ void g2d_set_cmd(struct g2d_dev *d, u32 c)
 	w(c, BITBLT_COMMAND_REG);
 }
 
+/* Fill the whole destination frame with an XRGB8888 color */
+void g2d_set_fill(struct g2d_dev *d, struct g2d_frame *f, u32 color)
+{
+	u32 n;
+
+	w(SELECT_FG_COLOR, SRC_SELECT_REG);
+	w(color, FG_COLOR_REG);
+	w(COLOR_MODE(ORDER_XRGB, MODE_XRGB_8888), SRC_COLOR_MODE_REG);
+
+	n = f->height & 0xFFF;
+	n <<= 16;
+	n |= f->width & 0xFFF;
+	w(0, SRC_LEFT_TOP_REG);
+	w(n, SRC_RIGHT_BOTTOM_REG);
+	w(0, DST_LEFT_TOP_REG);
+	w(n, DST_RIGHT_BOTTOM_REG);
+}
+
 void g2d_start(struct g2d_dev *d)
 {
 	/* Clear cache */
@@ -99,6 +99,10 @@
 
 #define COLOR_MODE(o, m)	(((o) << 4) | (m))
 
+/* Image selection values */
+#define SELECT_NORMAL		0
+#define SELECT_FG_COLOR		1
+
 /* ROP4 operation values */
 #define ROP4_COPY		0xCCCC
 #define ROP4_INVERT		0x3333
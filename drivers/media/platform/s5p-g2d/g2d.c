@@ -189,6 +189,10 @@ static int g2d_s_ctrl(struct v4l2_ctrl *ctrl)
 		ctx->flip = ctx->ctrl_hflip->val | (ctx->ctrl_vflip->val << 1);
 		break;
 
+	case V4L2_CID_BG_COLOR:
+		ctx->bg_color = ctrl->val;
+		break;
+
 	}
 	spin_unlock_irqrestore(&ctx->dev->ctrl_lock, flags);
 	return 0;
@@ -202,7 +206,7 @@ static int g2d_setup_ctrls(struct g2d_ctx *ctx)
 {
 	struct g2d_dev *dev = ctx->dev;
 
-	v4l2_ctrl_handler_init(&ctx->ctrl_handler, 3);
+	v4l2_ctrl_handler_init(&ctx->ctrl_handler, 4);
 
 	ctx->ctrl_hflip = v4l2_ctrl_new_std(&ctx->ctrl_handler, &g2d_ctrl_ops,
 						V4L2_CID_HFLIP, 0, 1, 1, 0);
@@ -218,6 +222,13 @@ static int g2d_setup_ctrls(struct g2d_ctx *ctx)
 		~((1 << V4L2_COLORFX_NONE) | (1 << V4L2_COLORFX_NEGATIVE)),
 		V4L2_COLORFX_NONE);
 
+	/*
+	 * Fill the destination frame with this color before copying the
+	 * source into its crop rectangle, -1 leaves it untouched.
+	 */
+	v4l2_ctrl_new_std(&ctx->ctrl_handler, &g2d_ctrl_ops,
+			  V4L2_CID_BG_COLOR, -1, 0xFFFFFF, 1, -1);
+
 	if (ctx->ctrl_handler.error) {
 		int err = ctx->ctrl_handler.error;
 		v4l2_err(&dev->v4l2_dev, "g2d_setup_ctrls failed\n");
@@ -498,24 +509,16 @@ static int vidioc_s_selection(struct file *file, void *prv,
 	return 0;
 }
 
-static void device_run(void *prv)
+/* Called with ctrl_lock held */
+static void g2d_run_copy(struct g2d_ctx *ctx)
 {
-	struct g2d_ctx *ctx = prv;
 	struct g2d_dev *dev = ctx->dev;
 	struct vb2_v4l2_buffer *src, *dst;
-	unsigned long flags;
 	u32 cmd = 0;
 
-	dev->curr = ctx;
-
 	src = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
 	dst = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
 
-	clk_enable(dev->gate);
-	g2d_reset(dev);
-
-	spin_lock_irqsave(&dev->ctrl_lock, flags);
-
 	g2d_set_src_size(dev, &ctx->in);
 	g2d_set_src_addr(dev, vb2_dma_contig_plane_dma_addr(&src->vb2_buf, 0));
 
@@ -535,6 +538,38 @@ static void device_run(void *prv)
 
 	g2d_set_cmd(dev, cmd);
 	g2d_start(dev);
+}
+
+static void device_run(void *prv)
+{
+	struct g2d_ctx *ctx = prv;
+	struct g2d_dev *dev = ctx->dev;
+	struct vb2_v4l2_buffer *dst;
+	unsigned long flags;
+
+	dev->curr = ctx;
+
+	clk_enable(dev->gate);
+	g2d_reset(dev);
+
+	spin_lock_irqsave(&dev->ctrl_lock, flags);
+
+	if (ctx->bg_color >= 0) {
+		/* fill first, the copy is started from the interrupt */
+		dst = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
+		dev->copy_pending = true;
+
+		g2d_set_dst_size(dev, &ctx->out);
+		g2d_set_dst_addr(dev,
+			vb2_dma_contig_plane_dma_addr(&dst->vb2_buf, 0));
+		g2d_set_fill(dev, &ctx->out, ctx->bg_color);
+		g2d_set_rop4(dev, ROP4_COPY);
+		g2d_set_flip(dev, 0);
+		g2d_set_cmd(dev, 0);
+		g2d_start(dev);
+	} else {
+		g2d_run_copy(ctx);
+	}
 
 	spin_unlock_irqrestore(&dev->ctrl_lock, flags);
 }
@@ -546,10 +581,19 @@ static irqreturn_t g2d_isr(int irq, void *prv)
 	struct vb2_v4l2_buffer *src, *dst;
 
 	g2d_clear_int(dev);
-	clk_disable(dev->gate);
 
 	BUG_ON(ctx == NULL);
 
+	if (dev->copy_pending) {
+		dev->copy_pending = false;
+		spin_lock(&dev->ctrl_lock);
+		g2d_run_copy(ctx);
+		spin_unlock(&dev->ctrl_lock);
+		return IRQ_HANDLED;
+	}
+
+	clk_disable(dev->gate);
+
 	src = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
 	dst = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
 
@@ -26,6 +26,7 @@ struct g2d_dev {
 	struct clk		*gate;
 	struct g2d_ctx		*curr;
 	struct g2d_variant	*variant;
+	bool			copy_pending;
 	int irq;
 };
 
@@ -58,6 +59,7 @@ struct g2d_ctx {
 	struct v4l2_ctrl_handler ctrl_handler;
 	u32 rop;
 	u32 flip;
+	s32 bg_color;
 };
 
 struct g2d_fmt {
@@ -82,3 +84,4 @@ void g2d_set_flip(struct g2d_dev *d, u32 r);
 void g2d_set_v41_stretch(struct g2d_dev *d,
 			struct g2d_frame *src, struct g2d_frame *dst);
 void g2d_set_cmd(struct g2d_dev *d, u32 c);
+void g2d_set_fill(struct g2d_dev *d, struct g2d_frame *f, u32 color);
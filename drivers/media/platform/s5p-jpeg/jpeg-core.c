@@ -1583,7 +1583,7 @@ static int exynos4_jpeg_get_output_buffer_size(struct s5p_jpeg_ctx *ctx,
 	return (w * h * fmt_depth >> 3) + padding;
 }
 
-static int exynos3250_jpeg_try_downscale(struct s5p_jpeg_ctx *ctx,
+static int exynos_jpeg_try_downscale(struct s5p_jpeg_ctx *ctx,
 				   struct v4l2_rect *r);
 
 static int s5p_jpeg_s_fmt(struct s5p_jpeg_ctx *ct, struct v4l2_format *f)
@@ -1669,7 +1669,7 @@ static int s5p_jpeg_s_fmt(struct s5p_jpeg_ctx *ct, struct v4l2_format *f)
 	    ct->scale_factor > 2) {
 		scale_rect.width = ct->out_q.w / 2;
 		scale_rect.height = ct->out_q.h / 2;
-		exynos3250_jpeg_try_downscale(ct, &scale_rect);
+		exynos_jpeg_try_downscale(ct, &scale_rect);
 	}
 
 	return 0;
@@ -1708,19 +1708,24 @@ static int s5p_jpeg_subscribe_event(struct v4l2_fh *fh,
 	return -EINVAL;
 }
 
-static int exynos3250_jpeg_try_downscale(struct s5p_jpeg_ctx *ctx,
+static int exynos_jpeg_try_downscale(struct s5p_jpeg_ctx *ctx,
 				   struct v4l2_rect *r)
 {
 	int w_ratio, h_ratio, scale_factor, cur_ratio, i;
+	int max_ratio = 3;
+
+	/* Exynos4x12 scales down the decoded image by 4 at most */
+	if (ctx->jpeg->variant->version == SJPEG_EXYNOS4)
+		max_ratio = 2;
 
 	w_ratio = ctx->out_q.w / r->width;
 	h_ratio = ctx->out_q.h / r->height;
 
 	scale_factor = w_ratio > h_ratio ? w_ratio : h_ratio;
-	scale_factor = clamp_val(scale_factor, 1, 8);
+	scale_factor = clamp_val(scale_factor, 1, 1 << max_ratio);
 
 	/* Align scale ratio to the nearest power of 2 */
-	for (i = 0; i <= 3; ++i) {
+	for (i = 0; i <= max_ratio; ++i) {
 		cur_ratio = 1 << i;
 		if (scale_factor <= cur_ratio) {
 			ctx->scale_factor = cur_ratio;
@@ -1840,8 +1845,9 @@ static int s5p_jpeg_s_selection(struct file *file, void *fh,
 	if (s->target == V4L2_SEL_TGT_COMPOSE) {
 		if (ctx->mode != S5P_JPEG_DECODE)
 			return -EINVAL;
-		if (ctx->jpeg->variant->hw3250_compat)
-			ret = exynos3250_jpeg_try_downscale(ctx, rect);
+		if (ctx->jpeg->variant->hw3250_compat ||
+		    ctx->jpeg->variant->version == SJPEG_EXYNOS4)
+			ret = exynos_jpeg_try_downscale(ctx, rect);
 	} else if (s->target == V4L2_SEL_TGT_CROP) {
 		if (ctx->mode != S5P_JPEG_ENCODE)
 			return -EINVAL;
@@ -2221,6 +2227,7 @@ static void exynos4_jpeg_device_run(void *priv)
 							ctx->cap_q.h);
 
 		if (ctx->jpeg->variant->version == SJPEG_EXYNOS4) {
+			exynos4_jpeg_set_dec_scaling(jpeg->regs, 1);
 			exynos4_jpeg_set_enc_out_fmt(jpeg->regs,
 						     ctx->subsampling);
 			exynos4_jpeg_set_img_fmt(jpeg->regs,
@@ -2261,6 +2268,8 @@ static void exynos4_jpeg_device_run(void *priv)
 		} else {
 			exynos4_jpeg_set_img_fmt(jpeg->regs,
 						 ctx->cap_q.fmt->fourcc);
+			exynos4_jpeg_set_dec_scaling(jpeg->regs,
+						     ctx->scale_factor);
 			bitstream_size = DIV_ROUND_UP(ctx->out_q.size, 32);
 		}
 
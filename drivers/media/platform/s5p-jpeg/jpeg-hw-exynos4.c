@@ -309,6 +309,29 @@ void exynos4_jpeg_get_frame_size(void __iomem *base,
 				EXYNOS4_DECODED_SIZE_MASK;
 }
 
+void exynos4_jpeg_set_dec_scaling(void __iomem *base, unsigned int factor)
+{
+	unsigned int reg, ratio;
+
+	switch (factor) {
+	case 1:
+	default:
+		ratio = 0;
+		break;
+	case 2:
+		ratio = 1;
+		break;
+	case 4:
+		ratio = 2;
+		break;
+	}
+
+	reg = readl(base + EXYNOS4_JPEG_CNTL_REG) &
+		~(EXYNOS4_HOR_SCALING_MASK | EXYNOS4_VER_SCALING_MASK);
+	writel(reg | EXYNOS4_HOR_SCALING(ratio) | EXYNOS4_VER_SCALING(ratio),
+	       base + EXYNOS4_JPEG_CNTL_REG);
+}
+
 unsigned int exynos4_jpeg_get_frame_fmt(void __iomem *base)
 {
 	return readl(base + EXYNOS4_DECODE_IMG_FMT_REG) &
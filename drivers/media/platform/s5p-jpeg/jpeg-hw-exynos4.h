@@ -37,6 +37,7 @@ void exynos4_jpeg_set_dec_bitstream_size(void __iomem *base, unsigned int size);
 unsigned int exynos4_jpeg_get_stream_size(void __iomem *base);
 void exynos4_jpeg_get_frame_size(void __iomem *base,
 			unsigned int *width, unsigned int *height);
+void exynos4_jpeg_set_dec_scaling(void __iomem *base, unsigned int factor);
 unsigned int exynos4_jpeg_get_frame_fmt(void __iomem *base);
 unsigned int exynos4_jpeg_get_fifo_status(void __iomem *base);
 void exynos4_jpeg_set_timer_count(void __iomem *base, unsigned int size);
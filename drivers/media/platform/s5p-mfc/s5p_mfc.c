@@ -7,12 +7,14 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/videodev2.h>
 #include <media/v4l2-event.h>
@@ -43,6 +45,16 @@ static char *mfc_mem_size;
 module_param_named(mem, mfc_mem_size, charp, 0644);
 MODULE_PARM_DESC(mem, "Preallocated memory size for the firmware and context buffers");
 
+static unsigned int mfc_idle_ms;
+module_param_named(idle_ms, mfc_idle_ms, uint, 0644);
+MODULE_PARM_DESC(idle_ms, "Time in ms to keep the hardware and firmware up after the last instance is closed");
+
+/*
+ * How far behind the busiest context an idle context may fall in hardware
+ * time, so that it cannot build up credit while it has nothing to decode.
+ */
+#define MFC_SCHED_SLACK_NS	(50 * NSEC_PER_MSEC)
+
 /* Helper functions for interrupt processing */
 
 /* Remove from hw execution round robin */
@@ -61,7 +73,8 @@ void set_work_bit(struct s5p_mfc_ctx *ctx)
 	struct s5p_mfc_dev *dev = ctx->dev;
 
 	spin_lock(&dev->condlock);
-	__set_bit(ctx->num, &dev->ctx_work_bits);
+	if (!__test_and_set_bit(ctx->num, &dev->ctx_work_bits))
+		ctx->ready_since = ktime_get();
 	spin_unlock(&dev->condlock);
 }
 
@@ -83,30 +96,76 @@ void set_work_bit_irqsave(struct s5p_mfc_ctx *ctx)
 	unsigned long flags;
 
 	spin_lock_irqsave(&dev->condlock, flags);
-	__set_bit(ctx->num, &dev->ctx_work_bits);
+	if (!__test_and_set_bit(ctx->num, &dev->ctx_work_bits))
+		ctx->ready_since = ktime_get();
 	spin_unlock_irqrestore(&dev->condlock, flags);
 }
 
+/*
+ * Pick the ready context which has used the least hardware time, so that
+ * a stream with expensive frames cannot crowd out the others. Ties are
+ * broken round robin, starting after the current context.
+ */
 int s5p_mfc_get_new_ctx(struct s5p_mfc_dev *dev)
 {
+	struct s5p_mfc_ctx *c;
 	unsigned long flags;
-	int ctx;
+	int i, n, ctx = -EAGAIN;
 
 	spin_lock_irqsave(&dev->condlock, flags);
-	ctx = dev->curr_ctx;
-	do {
-		ctx = (ctx + 1) % MFC_NUM_CONTEXTS;
-		if (ctx == dev->curr_ctx) {
-			if (!test_bit(ctx, &dev->ctx_work_bits))
-				ctx = -EAGAIN;
-			break;
-		}
-	} while (!test_bit(ctx, &dev->ctx_work_bits));
+	for (i = 1; i <= MFC_NUM_CONTEXTS; i++) {
+		n = (dev->curr_ctx + i) % MFC_NUM_CONTEXTS;
+		c = dev->ctx[n];
+		if (!test_bit(n, &dev->ctx_work_bits) || !c)
+			continue;
+
+		if (dev->min_hw_time > MFC_SCHED_SLACK_NS &&
+		    c->hw_time < dev->min_hw_time - MFC_SCHED_SLACK_NS)
+			c->hw_time = dev->min_hw_time - MFC_SCHED_SLACK_NS;
+
+		if (ctx < 0 || c->hw_time < dev->ctx[ctx]->hw_time)
+			ctx = n;
+	}
+
+	if (ctx >= 0) {
+		dev->min_hw_time = max(dev->min_hw_time, dev->ctx[ctx]->hw_time);
+		dev->run_ctx = ctx;
+		dev->run_start = ktime_get();
+	}
 	spin_unlock_irqrestore(&dev->condlock, flags);
 
 	return ctx;
 }
 
+/* Charge the finished hardware run to the context which started it */
+static void s5p_mfc_account_run(struct s5p_mfc_dev *dev,
+				struct s5p_mfc_ctx *ctx)
+{
+	ktime_t now;
+	s64 latency;
+
+	if (!dev->run_start)
+		return;
+
+	/* a command issued outside of try_run() ended, not our run */
+	if (!ctx || dev->run_ctx != ctx->num) {
+		dev->run_start = 0;
+		return;
+	}
+
+	now = ktime_get();
+
+	spin_lock(&dev->condlock);
+	ctx->hw_time += ktime_to_ns(ktime_sub(now, dev->run_start));
+	latency = ktime_ms_delta(now, ctx->ready_since);
+	ctx->latency_hist[latency > 0 ? min_t(int, fls64(latency),
+					      MFC_LATENCY_BUCKETS - 1) : 0]++;
+	/* if it has more work, it is ready again from now on */
+	ctx->ready_since = now;
+	dev->run_start = 0;
+	spin_unlock(&dev->condlock);
+}
+
 /* Wake up context wait_queue */
 static void wake_up_ctx(struct s5p_mfc_ctx *ctx, unsigned int reason,
 			unsigned int err)
@@ -639,6 +698,7 @@ static irqreturn_t s5p_mfc_irq(int irq, void *priv)
 	atomic_set(&dev->watchdog_cnt, 0);
 	spin_lock(&dev->irqlock);
 	ctx = dev->ctx[dev->curr_ctx];
+	s5p_mfc_account_run(dev, ctx);
 	/* Get the reason of interrupt and the error code */
 	reason = s5p_mfc_hw_call(dev->mfc_ops, get_int_reason, dev);
 	err = s5p_mfc_hw_call(dev->mfc_ops, get_int_err, dev);
@@ -747,6 +807,31 @@ static irqreturn_t s5p_mfc_irq(int irq, void *priv)
 	return IRQ_HANDLED;
 }
 
+/* Power the hardware down once it stayed unused for idle_ms */
+static void s5p_mfc_idle_worker(struct work_struct *work)
+{
+	struct s5p_mfc_dev *dev = container_of(to_delayed_work(work),
+					       struct s5p_mfc_dev, idle_work);
+
+	mutex_lock(&dev->mfc_mutex);
+	if (dev->hw_idle) {
+		mfc_debug(2, "Idle timeout, shutting down hardware\n");
+		dev->hw_idle = false;
+		s5p_mfc_clock_on();
+		s5p_mfc_deinit_hw(dev);
+		s5p_mfc_clock_off();
+		if (s5p_mfc_power_off() < 0)
+			mfc_err("Power off failed\n");
+	}
+	mutex_unlock(&dev->mfc_mutex);
+}
+
+static void s5p_mfc_idle_flush(struct s5p_mfc_dev *dev)
+{
+	mod_delayed_work(system_wq, &dev->idle_work, 0);
+	flush_delayed_work(&dev->idle_work);
+}
+
 /* Open an MFC node */
 static int s5p_mfc_open(struct file *file)
 {
@@ -787,6 +872,8 @@ static int s5p_mfc_open(struct file *file)
 	}
 	/* Mark context as idle */
 	clear_work_bit_irqsave(ctx);
+	/* join the fair share at the level of the running contexts */
+	ctx->hw_time = dev->min_hw_time;
 	dev->ctx[ctx->num] = ctx;
 	if (vdev == dev->vfd_dec) {
 		ctx->type = MFCINST_DECODER;
@@ -822,6 +909,12 @@ static int s5p_mfc_open(struct file *file)
 		dev->watchdog_timer.expires = jiffies +
 					msecs_to_jiffies(MFC_WATCHDOG_INTERVAL);
 		add_timer(&dev->watchdog_timer);
+		if (dev->hw_idle) {
+			/* still up after the previous last instance closed */
+			dev->hw_idle = false;
+			cancel_delayed_work(&dev->idle_work);
+			goto hw_ready;
+		}
 		ret = s5p_mfc_power_on();
 		if (ret < 0) {
 			mfc_err("power on failed\n");
@@ -839,6 +932,7 @@ static int s5p_mfc_open(struct file *file)
 		if (ret)
 			goto err_init_hw;
 	}
+hw_ready:
 	/* Init videobuf2 queue for CAPTURE */
 	q = &ctx->vq_dst;
 	q->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
@@ -960,7 +1054,14 @@ static int s5p_mfc_release(struct file *file)
 		if (dev->curr_ctx == ctx->num)
 			clear_bit(0, &dev->hw_lock);
 		dev->num_inst--;
-		if (dev->num_inst == 0) {
+		if (dev->num_inst == 0 && mfc_idle_ms) {
+			mfc_debug(2, "Last instance, keeping hardware up\n");
+			del_timer_sync(&dev->watchdog_timer);
+			s5p_mfc_clock_off();
+			dev->hw_idle = true;
+			schedule_delayed_work(&dev->idle_work,
+					      msecs_to_jiffies(mfc_idle_ms));
+		} else if (dev->num_inst == 0) {
 			mfc_debug(2, "Last instance\n");
 			s5p_mfc_deinit_hw(dev);
 			del_timer_sync(&dev->watchdog_timer);
@@ -1266,6 +1367,33 @@ static void s5p_mfc_unconfigure_dma_memory(struct s5p_mfc_dev *mfc_dev)
 		s5p_mfc_unconfigure_2port_memory(mfc_dev);
 }
 
+static int s5p_mfc_sched_show(struct seq_file *s, void *data)
+{
+	struct s5p_mfc_dev *dev = s->private;
+	struct s5p_mfc_ctx *ctx;
+	int i, j;
+
+	seq_puts(s, "ctx type hw_time_ms  latency_ms <1 <2 <4 <8 <16 <32 <64 >=64\n");
+
+	mutex_lock(&dev->mfc_mutex);
+	for (i = 0; i < MFC_NUM_CONTEXTS; i++) {
+		ctx = dev->ctx[i];
+		if (!ctx)
+			continue;
+
+		seq_printf(s, "%3d %4s %10llu           ", i,
+			   ctx->type == MFCINST_DECODER ? "dec" : "enc",
+			   div_u64(ctx->hw_time, NSEC_PER_MSEC));
+		for (j = 0; j < MFC_LATENCY_BUCKETS; j++)
+			seq_printf(s, " %u", ctx->latency_hist[j]);
+		seq_putc(s, '\n');
+	}
+	mutex_unlock(&dev->mfc_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(s5p_mfc_sched);
+
 /* MFC probe function */
 static int s5p_mfc_probe(struct platform_device *pdev)
 {
@@ -1333,6 +1461,7 @@ static int s5p_mfc_probe(struct platform_device *pdev)
 	init_waitqueue_head(&dev->queue);
 	dev->hw_lock = 0;
 	INIT_WORK(&dev->watchdog_work, s5p_mfc_watchdog_worker);
+	INIT_DELAYED_WORK(&dev->idle_work, s5p_mfc_idle_worker);
 	atomic_set(&dev->watchdog_cnt, 0);
 	timer_setup(&dev->watchdog_timer, s5p_mfc_watchdog, 0);
 
@@ -1400,6 +1529,10 @@ static int s5p_mfc_probe(struct platform_device *pdev)
 	v4l2_info(&dev->v4l2_dev,
 		  "encoder registered as /dev/video%d\n", dev->vfd_enc->num);
 
+	dev->debugfs_root = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_file("sched", 0444, dev->debugfs_root, dev,
+			    &s5p_mfc_sched_fops);
+
 	pr_debug("%s--\n", __func__);
 	return 0;
 
@@ -1432,6 +1565,8 @@ static int s5p_mfc_remove(struct platform_device *pdev)
 
 	v4l2_info(&dev->v4l2_dev, "Removing %s\n", pdev->name);
 
+	debugfs_remove_recursive(dev->debugfs_root);
+
 	/*
 	 * Clear ctx dev pointer to avoid races between s5p_mfc_remove()
 	 * and s5p_mfc_release() and s5p_mfc_release() accessing ctx->dev
@@ -1447,6 +1582,7 @@ static int s5p_mfc_remove(struct platform_device *pdev)
 	}
 	mutex_unlock(&dev->mfc_mutex);
 
+	s5p_mfc_idle_flush(dev);
 	del_timer_sync(&dev->watchdog_timer);
 	flush_work(&dev->watchdog_work);
 
@@ -1466,6 +1602,9 @@ static int s5p_mfc_suspend(struct device *dev)
 	struct s5p_mfc_dev *m_dev = dev_get_drvdata(dev);
 	int ret;
 
+	/* do not keep the firmware up across suspend without a user */
+	s5p_mfc_idle_flush(m_dev);
+
 	if (m_dev->num_inst == 0)
 		return 0;
 
@@ -45,6 +45,8 @@
 #define MFC_MAX_EXTRA_DPB       5
 #define MFC_MAX_BUFFERS		32
 #define MFC_NUM_CONTEXTS	4
+/* Frame latency histogram buckets: <1, <2, <4 ... <64, >=64 ms */
+#define MFC_LATENCY_BUCKETS	8
 /* Interrupt timeout */
 #define MFC_INT_TIMEOUT		2000
 /* Busy wait timeout */
@@ -297,6 +299,13 @@ struct s5p_mfc_priv_buf {
  * @fw_get_done:	flag set when request_firmware() is complete and
  *			copied into fw_buf
  * @risc_on:		flag indicates RISC is on or off
+ * @run_ctx:		context picked by s5p_mfc_get_new_ctx() for the run
+ *			in progress
+ * @run_start:		time the run in progress was started, 0 if idle
+ * @min_hw_time:	hardware time of the last context picked to run
+ * @debugfs_root:	debugfs directory of the device
+ * @hw_idle:		hardware and firmware are kept up without instances
+ * @idle_work:		worker shutting the hardware down after idle_ms
  *
  */
 struct s5p_mfc_dev {
@@ -344,6 +353,13 @@ struct s5p_mfc_dev {
 	enum s5p_mfc_fw_ver fw_ver;
 	bool fw_get_done;
 	bool risc_on; /* indicates if RISC is on or off */
+
+	int run_ctx;
+	ktime_t run_start;
+	u64 min_hw_time;
+	struct dentry *debugfs_root;
+	bool hw_idle;
+	struct delayed_work idle_work;
 };
 
 /*
@@ -621,6 +637,11 @@ struct s5p_mfc_codec_ops {
  *			v4l2 control framework
  * @ctrl_handler:	handler for v4l2 framework
  * @scratch_buf_size:	scratch buffer size
+ * @hw_time:		hardware time used by the context in ns, used to pick
+ *			the next context to run
+ * @ready_since:	time the context last became ready to run
+ * @latency_hist:	histogram of the time from becoming ready to the end
+ *			of the hardware run, in MFC_LATENCY_BUCKETS buckets
  */
 struct s5p_mfc_ctx {
 	struct s5p_mfc_dev *dev;
@@ -720,6 +741,10 @@ struct s5p_mfc_ctx {
 	struct v4l2_ctrl *ctrls[MFC_MAX_CTRLS];
 	struct v4l2_ctrl_handler ctrl_handler;
 	size_t scratch_buf_size;
+
+	u64 hw_time;
+	ktime_t ready_since;
+	unsigned int latency_hist[MFC_LATENCY_BUCKETS];
 };
 
 /*
@@ -1210,6 +1210,13 @@ static int enc_pre_frame_start(struct s5p_mfc_ctx *ctx)
 	return 0;
 }
 
+/*
+ * The encoder only interrupts once the whole frame is in the stream
+ * buffer; the firmware has no per slice completion for encoding (the
+ * SLICE_DONE return is a decoder slice interface feature). Multi slice
+ * mode still helps packetization, but the CAPTURE buffer can only be
+ * returned here, at frame done.
+ */
 static int enc_post_frame_start(struct s5p_mfc_ctx *ctx)
 {
 	struct s5p_mfc_dev *dev = ctx->dev;
@@ -223,6 +223,21 @@ static int mmc_clock_opt_set(void *data, u64 val)
 DEFINE_DEBUGFS_ATTRIBUTE(mmc_clock_fops, mmc_clock_opt_get, mmc_clock_opt_set,
 	"%llu\n");
 
+static int mmc_sdio_irq_stats_show(struct seq_file *s, void *data)
+{
+	struct mmc_host *host = s->private;
+	struct mmc_sdio_irq_stats *stats = &host->sdio_irq_stats;
+
+	seq_printf(s, "irqs:\t\t%llu\n", stats->irqs);
+	seq_printf(s, "polls:\t\t%llu\n", stats->polls);
+	seq_printf(s, "poll hits:\t%llu\n", stats->poll_hits);
+	seq_printf(s, "poll exits:\t%llu\n", stats->poll_exits);
+	seq_printf(s, "poll window:\t%u us\n", host->sdio_irq_poll_win);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mmc_sdio_irq_stats);
+
 void mmc_add_host_debugfs(struct mmc_host *host)
 {
 	struct dentry *root;
@@ -235,6 +250,10 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 	debugfs_create_x32("caps2", S_IRUSR, root, &host->caps2);
 	debugfs_create_file_unsafe("clock", S_IRUSR | S_IWUSR, root, host,
 				   &mmc_clock_fops);
+	debugfs_create_u32("sdio_irq_poll_us", S_IRUSR | S_IWUSR, root,
+			   &host->sdio_irq_poll_us);
+	debugfs_create_file("sdio_irq_stats", S_IRUSR, root, host,
+			    &mmc_sdio_irq_stats_fops);
 
 #ifdef CONFIG_FAIL_MMC_REQUEST
 	if (fail_request)
@@ -7,7 +7,9 @@
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
 #include <linux/mmc/mmc.h>
+#include <linux/prandom.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 
 #include <linux/scatterlist.h>
 #include <linux/swap.h>		/* For nr_free_buffer_pages() */
@@ -40,6 +42,17 @@
  */
 #define TEST_AREA_MAX_SIZE (128 * 1024 * 1024)
 
+/* Maximum number of latency samples kept by the read-only tests */
+#define TEST_LAT_MAX_SAMPLES	65536
+
+static unsigned int ro_start;
+module_param(ro_start, uint, 0644);
+MODULE_PARM_DESC(ro_start, "First sector of the range used by the read-only tests");
+
+static unsigned int ro_sectors;
+module_param(ro_sectors, uint, 0644);
+MODULE_PARM_DESC(ro_sectors, "Sectors in the range used by the read-only tests (0 = up to the end of the card)");
+
 /**
  * struct mmc_test_pages - pages allocated by 'alloc_pages()'.
  * @page: first page in the allocation
@@ -94,6 +107,8 @@ struct mmc_test_area {
  * @ts: time values of transfer
  * @rate: calculated transfer rate
  * @iops: I/O operations per second (times 100)
+ * @lat: 50th, 90th and 99th percentile and maximum latency of one transfer
+ *       in microseconds, all zero if not measured
  */
 struct mmc_test_transfer_result {
 	struct list_head link;
@@ -102,6 +117,7 @@ struct mmc_test_transfer_result {
 	struct timespec64 ts;
 	unsigned int rate;
 	unsigned int iops;
+	unsigned int lat[4];
 };
 
 /**
@@ -540,7 +556,7 @@ static void mmc_test_save_transfer_result(struct mmc_test_card *test,
 	if (!test->gr)
 		return;
 
-	tr = kmalloc(sizeof(*tr), GFP_KERNEL);
+	tr = kzalloc(sizeof(*tr), GFP_KERNEL);
 	if (!tr)
 		return;
 
@@ -1995,6 +2011,137 @@ static int mmc_test_random_write_perf(struct mmc_test_card *test)
 	return mmc_test_random_perf(test, 1);
 }
 
+/*
+ * Get the range of sectors the read-only tests may read, see the ro_start and
+ * ro_sectors module parameters.  Nothing is ever written to it.
+ */
+static int mmc_test_ro_range(struct mmc_test_card *test, unsigned int *start,
+			     unsigned int *cnt)
+{
+	unsigned int capacity = mmc_test_capacity(test->card);
+
+	if (ro_start >= capacity)
+		return -EINVAL;
+
+	*start = ro_start;
+	*cnt = capacity - ro_start;
+	if (ro_sectors && ro_sectors < *cnt)
+		*cnt = ro_sectors;
+
+	return 0;
+}
+
+/*
+ * Sequential read performance over the read-only range for up to 10 seconds,
+ * in transfers of the maximum size.
+ */
+static int mmc_test_ro_seq_read_perf(struct mmc_test_card *test)
+{
+	struct mmc_test_area *t = &test->area;
+	unsigned int start, cnt, dev_addr, ssz, i;
+	struct timespec64 ts1, ts2, ts;
+	int ret;
+
+	ret = mmc_test_ro_range(test, &start, &cnt);
+	if (ret)
+		return ret;
+
+	ssz = t->max_tfr >> 9;
+	if (cnt < ssz)
+		return -EINVAL;
+
+	dev_addr = start;
+	ktime_get_ts64(&ts1);
+	for (i = 0; i < UINT_MAX; i++) {
+		ktime_get_ts64(&ts2);
+		ts = timespec64_sub(ts2, ts1);
+		if (ts.tv_sec >= 10)
+			break;
+		if (dev_addr + ssz > start + cnt)
+			dev_addr = start;
+		ret = mmc_test_area_io(test, t->max_tfr, dev_addr, 0, 0, 0);
+		if (ret)
+			return ret;
+		dev_addr += ssz;
+	}
+	mmc_test_print_avg_rate(test, t->max_tfr, i, &ts1, &ts2);
+
+	return 0;
+}
+
+static int mmc_test_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Random 4KiB read performance over the read-only range for 10 seconds, with
+ * latency percentiles of the single transfers.
+ */
+static int mmc_test_ro_rnd_read_perf(struct mmc_test_card *test)
+{
+	unsigned int start, cnt, dev_addr, n = 0, i;
+	struct mmc_test_transfer_result *tr;
+	struct timespec64 ts1, ts2, ts;
+	unsigned int lat[4];
+	u32 *samples;
+	u64 t0;
+	int ret;
+
+	ret = mmc_test_ro_range(test, &start, &cnt);
+	if (ret)
+		return ret;
+
+	cnt /= 8;
+	if (!cnt)
+		return -EINVAL;
+
+	samples = kvmalloc_array(TEST_LAT_MAX_SAMPLES, sizeof(*samples),
+				 GFP_KERNEL);
+	if (!samples)
+		return -ENOMEM;
+
+	ktime_get_ts64(&ts1);
+	for (i = 0; i < UINT_MAX; i++) {
+		ktime_get_ts64(&ts2);
+		ts = timespec64_sub(ts2, ts1);
+		if (ts.tv_sec >= 10)
+			break;
+		dev_addr = start + 8 * prandom_u32_max(cnt);
+		t0 = ktime_get_ns();
+		ret = mmc_test_area_io(test, 4096, dev_addr, 0, 0, 0);
+		if (ret)
+			goto out_free;
+		if (n < TEST_LAT_MAX_SAMPLES)
+			samples[n++] = div_u64(ktime_get_ns() - t0, NSEC_PER_USEC);
+	}
+	mmc_test_print_avg_rate(test, 4096, i, &ts1, &ts2);
+
+	if (!n)
+		goto out_free;
+
+	sort(samples, n, sizeof(*samples), mmc_test_cmp_u32, NULL);
+	lat[0] = samples[n / 2];
+	lat[1] = samples[n * 9 / 10];
+	lat[2] = samples[n * 99 / 100];
+	lat[3] = max_t(u32, samples[n - 1], 1);
+
+	pr_info("%s: Read latency (us): p50 %u p90 %u p99 %u max %u\n",
+		mmc_hostname(test->card->host), lat[0], lat[1], lat[2], lat[3]);
+
+	if (test->gr && !list_empty(&test->gr->tr_lst)) {
+		tr = list_last_entry(&test->gr->tr_lst,
+				     struct mmc_test_transfer_result, link);
+		memcpy(tr->lat, lat, sizeof(lat));
+	}
+
+out_free:
+	kvfree(samples);
+	return ret;
+}
+
 static int mmc_test_seq_perf(struct mmc_test_card *test, int write,
 			     unsigned int tot_sz, int max_scatter)
 {
@@ -2928,6 +3075,20 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.run = mmc_test_cmds_during_write_cmd23_nonblock,
 		.cleanup = mmc_test_area_cleanup,
 	},
+
+	{
+		.name = "Read-only sequential read performance",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_ro_seq_read_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Read-only random 4KiB read performance and latency",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_ro_rnd_read_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
@@ -3066,10 +3227,14 @@ static int mtf_test_show(struct seq_file *sf, void *data)
 		seq_printf(sf, "Test %d: %d\n", gr->testcase + 1, gr->result);
 
 		list_for_each_entry(tr, &gr->tr_lst, link) {
-			seq_printf(sf, "%u %d %llu.%09u %u %u.%02u\n",
+			seq_printf(sf, "%u %d %llu.%09u %u %u.%02u",
 				tr->count, tr->sectors,
 				(u64)tr->ts.tv_sec, (u32)tr->ts.tv_nsec,
 				tr->rate, tr->iops / 100, tr->iops % 100);
+			if (tr->lat[3])
+				seq_printf(sf, " %u %u %u %u", tr->lat[0],
+					   tr->lat[1], tr->lat[2], tr->lat[3]);
+			seq_putc(sf, '\n');
 		}
 	}
 
@@ -7,6 +7,7 @@
 
 #include <linux/export.h>
 #include <linux/kernel.h>
+#include <linux/slab.h>
 #include <linux/mmc/host.h>
 #include <linux/mmc/card.h>
 #include <linux/mmc/sdio.h>
@@ -523,6 +524,116 @@ int sdio_writesb(struct sdio_func *func, unsigned int addr, void *src,
 }
 EXPORT_SYMBOL_GPL(sdio_writesb);
 
+/*
+ * Split one batched transfer into CMD53s the same way
+ * sdio_io_rw_ext_helper() does. With @ext NULL the commands are only
+ * counted. Returns the number of commands or a negative error.
+ */
+static int sdio_xfer_split(struct sdio_func *func, struct sdio_xfer *xfer,
+	struct mmc_io_ext *ext)
+{
+	unsigned remainder = xfer->len;
+	unsigned addr = xfer->addr;
+	unsigned max_blocks, blocks, size;
+	u8 *buf = xfer->buf;
+	int n = 0, ret;
+
+	if (func->card->cccr.multi_block &&
+	    (remainder > sdio_max_byte_size(func))) {
+		max_blocks = min(func->card->host->max_blk_count, 511u);
+
+		while (remainder >= func->cur_blksize) {
+			blocks = min(remainder / func->cur_blksize, max_blocks);
+			size = blocks * func->cur_blksize;
+
+			if (ext) {
+				ret = mmc_io_ext_init(func->card, &ext[n],
+					xfer->write, func->num, addr,
+					xfer->incr_addr, buf, blocks,
+					func->cur_blksize);
+				if (ret)
+					return ret;
+			}
+			n++;
+
+			remainder -= size;
+			buf += size;
+			if (xfer->incr_addr)
+				addr += size;
+		}
+	}
+
+	while (remainder > 0) {
+		size = min(remainder, sdio_max_byte_size(func));
+
+		if (ext) {
+			ret = mmc_io_ext_init(func->card, &ext[n], xfer->write,
+				func->num, addr, xfer->incr_addr, buf, 0, size);
+			if (ret)
+				return ret;
+		}
+		n++;
+
+		remainder -= size;
+		buf += size;
+		if (xfer->incr_addr)
+			addr += size;
+	}
+
+	return n;
+}
+
+/**
+ *	sdio_transfer_batch - issue a list of transfers back to back
+ *	@func: SDIO function to access
+ *	@xfers: transfers to issue, in order
+ *	@nr: number of entries in @xfers
+ *
+ *	Issues each transfer as one or more CMD53s, exactly like
+ *	sdio_memcpy_toio(), sdio_memcpy_fromio(), sdio_readsb() and
+ *	sdio_writesb() would. All commands are built up front, and the
+ *	host prepares each one for DMA while the previous one is still on
+ *	the bus. The caller gets a single return for the whole list. The
+ *	batch stops at the first failing command and returns its error.
+ *	Transfers after it are not issued.
+ */
+int sdio_transfer_batch(struct sdio_func *func, struct sdio_xfer *xfers,
+	unsigned int nr)
+{
+	struct mmc_io_ext *ext;
+	unsigned int i;
+	int n = 0, cnt, ret;
+
+	if (!func || (func->num > 7))
+		return -EINVAL;
+
+	for (i = 0; i < nr; i++)
+		n += sdio_xfer_split(func, &xfers[i], NULL);
+
+	if (!n)
+		return 0;
+
+	ext = kcalloc(n, sizeof(*ext), GFP_KERNEL);
+	if (!ext)
+		return -ENOMEM;
+
+	for (i = 0, cnt = 0; i < nr; i++) {
+		ret = sdio_xfer_split(func, &xfers[i], ext + cnt);
+		if (ret < 0)
+			goto out;
+		cnt += ret;
+	}
+
+	ret = mmc_io_rw_extended_batch(func->card, ext, n);
+out:
+	for (i = 0; i < n; i++)
+		mmc_io_ext_cleanup(&ext[i]);
+	kfree(ext);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sdio_transfer_batch);
+
 /**
  *	sdio_readw - read a 16 bit integer from a SDIO function
  *	@func: SDIO function to access
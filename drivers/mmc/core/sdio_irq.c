@@ -110,13 +110,72 @@ static int process_sdio_pending_irqs(struct mmc_host *host)
 	return ret;
 }
 
+/*
+ * Hybrid polling: with sdio_irq_poll_us set, keep the host interrupt
+ * masked after an SDIO IRQ and poll CCCR_INTx for a short window, since
+ * under traffic one interrupt is usually closely followed by more. Each
+ * poll that finds an IRQ doubles the window, up to sdio_irq_poll_us; a
+ * window that expires idle halves it and drops back to interrupts.
+ *
+ * Returns true if the caller should poll again instead of re-enabling
+ * the host interrupt.
+ */
+#define SDIO_IRQ_POLL_MIN_US	20
+
+static bool sdio_irq_poll_again(struct mmc_host *host, int ret)
+{
+	unsigned int poll_us = READ_ONCE(host->sdio_irq_poll_us);
+	struct mmc_sdio_irq_stats *stats = &host->sdio_irq_stats;
+	bool polled = host->sdio_irq_polling;
+	unsigned int win;
+	ktime_t now;
+
+	if (polled)
+		stats->polls++;
+	else
+		stats->irqs++;
+
+	host->sdio_irq_polling = false;
+	if (!poll_us)
+		return false;
+
+	win = clamp(host->sdio_irq_poll_win, SDIO_IRQ_POLL_MIN_US, poll_us);
+	now = ktime_get();
+
+	if (ret > 0) {
+		if (polled) {
+			stats->poll_hits++;
+			win = min(win * 2, poll_us);
+		}
+		host->sdio_irq_poll_win = win;
+		host->sdio_irq_poll_end = ktime_add_us(now, win);
+	} else if (ret < 0 || !polled ||
+		   ktime_after(now, host->sdio_irq_poll_end)) {
+		host->sdio_irq_poll_win = max(win / 2,
+					      (unsigned int)SDIO_IRQ_POLL_MIN_US);
+		if (polled)
+			stats->poll_exits++;
+		return false;
+	}
+
+	host->sdio_irq_polling = true;
+	return true;
+}
+
 static void sdio_run_irqs(struct mmc_host *host)
 {
+	int ret;
+
 	mmc_claim_host(host);
 	if (host->sdio_irqs) {
-		process_sdio_pending_irqs(host);
-		if (!host->sdio_irq_pending)
-			host->ops->ack_sdio_irq(host);
+		ret = process_sdio_pending_irqs(host);
+		if (!host->sdio_irq_pending) {
+			if (sdio_irq_poll_again(host, ret))
+				queue_delayed_work(system_wq,
+						   &host->sdio_irq_work, 0);
+			else
+				host->ops->ack_sdio_irq(host);
+		}
 	}
 	mmc_release_host(host);
 }
@@ -204,6 +263,12 @@ static int sdio_irq_thread(void *_host)
 			}
 		}
 
+		if ((host->caps & MMC_CAP_SDIO_IRQ) &&
+		    sdio_irq_poll_again(host, ret)) {
+			cond_resched();
+			continue;
+		}
+
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (host->caps & MMC_CAP_SDIO_IRQ)
 			host->ops->enable_sdio_irq(host, 1);
@@ -111,17 +111,16 @@ int mmc_io_rw_direct(struct mmc_card *card, int write, unsigned fn,
 	return mmc_io_rw_direct_host(card->host, write, fn, addr, in, out);
 }
 
-int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
-	unsigned addr, int incr_addr, u8 *buf, unsigned blocks, unsigned blksz)
+int mmc_io_ext_init(struct mmc_card *card, struct mmc_io_ext *ext, int write,
+	unsigned fn, unsigned addr, int incr_addr, u8 *buf, unsigned blocks,
+	unsigned blksz)
 {
-	struct mmc_request mrq = {};
-	struct mmc_command cmd = {};
-	struct mmc_data data = {};
-	struct scatterlist sg, *sg_ptr;
-	struct sg_table sgtable;
+	struct mmc_request *mrq = &ext->mrq;
+	struct mmc_command *cmd = &ext->cmd;
+	struct mmc_data *data = &ext->data;
+	struct scatterlist *sg_ptr;
 	unsigned int nents, left_size, i;
 	unsigned int seg_size = card->host->max_seg_size;
-	int err;
 
 	WARN_ON(blksz == 0);
 
@@ -129,72 +128,157 @@ int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
 	if (addr & ~0x1FFFF)
 		return -EINVAL;
 
-	mrq.cmd = &cmd;
-	mrq.data = &data;
+	mrq->cmd = cmd;
+	mrq->data = data;
 
-	cmd.opcode = SD_IO_RW_EXTENDED;
-	cmd.arg = write ? 0x80000000 : 0x00000000;
-	cmd.arg |= fn << 28;
-	cmd.arg |= incr_addr ? 0x04000000 : 0x00000000;
-	cmd.arg |= addr << 9;
+	cmd->opcode = SD_IO_RW_EXTENDED;
+	cmd->arg = write ? 0x80000000 : 0x00000000;
+	cmd->arg |= fn << 28;
+	cmd->arg |= incr_addr ? 0x04000000 : 0x00000000;
+	cmd->arg |= addr << 9;
 	if (blocks == 0)
-		cmd.arg |= (blksz == 512) ? 0 : blksz;	/* byte mode */
+		cmd->arg |= (blksz == 512) ? 0 : blksz;	/* byte mode */
 	else
-		cmd.arg |= 0x08000000 | blocks;		/* block mode */
-	cmd.flags = MMC_RSP_SPI_R5 | MMC_RSP_R5 | MMC_CMD_ADTC;
+		cmd->arg |= 0x08000000 | blocks;	/* block mode */
+	cmd->flags = MMC_RSP_SPI_R5 | MMC_RSP_R5 | MMC_CMD_ADTC;
 
-	data.blksz = blksz;
+	data->blksz = blksz;
 	/* Code in host drivers/fwk assumes that "blocks" always is >=1 */
-	data.blocks = blocks ? blocks : 1;
-	data.flags = write ? MMC_DATA_WRITE : MMC_DATA_READ;
+	data->blocks = blocks ? blocks : 1;
+	data->flags = write ? MMC_DATA_WRITE : MMC_DATA_READ;
 
-	left_size = data.blksz * data.blocks;
+	left_size = data->blksz * data->blocks;
 	nents = DIV_ROUND_UP(left_size, seg_size);
 	if (nents > 1) {
-		if (sg_alloc_table(&sgtable, nents, GFP_KERNEL))
+		if (sg_alloc_table(&ext->sgtable, nents, GFP_KERNEL))
 			return -ENOMEM;
 
-		data.sg = sgtable.sgl;
-		data.sg_len = nents;
+		data->sg = ext->sgtable.sgl;
+		data->sg_len = nents;
 
-		for_each_sg(data.sg, sg_ptr, data.sg_len, i) {
+		for_each_sg(data->sg, sg_ptr, data->sg_len, i) {
 			sg_set_buf(sg_ptr, buf + i * seg_size,
 				   min(seg_size, left_size));
 			left_size -= seg_size;
 		}
 	} else {
-		data.sg = &sg;
-		data.sg_len = 1;
+		data->sg = &ext->sg;
+		data->sg_len = 1;
 
-		sg_init_one(&sg, buf, left_size);
+		sg_init_one(&ext->sg, buf, left_size);
 	}
 
-	mmc_set_data_timeout(&data, card);
+	mmc_set_data_timeout(data, card);
 
-	mmc_pre_req(card->host, &mrq);
+	return 0;
+}
 
-	mmc_wait_for_req(card->host, &mrq);
+void mmc_io_ext_cleanup(struct mmc_io_ext *ext)
+{
+	if (ext->data.sg_len > 1)
+		sg_free_table(&ext->sgtable);
+}
 
-	if (cmd.error)
-		err = cmd.error;
-	else if (data.error)
-		err = data.error;
-	else if (mmc_host_is_spi(card->host))
+static int mmc_io_ext_result(struct mmc_card *card, struct mmc_io_ext *ext)
+{
+	struct mmc_command *cmd = &ext->cmd;
+
+	if (cmd->error)
+		return cmd->error;
+	if (ext->data.error)
+		return ext->data.error;
+	if (mmc_host_is_spi(card->host))
 		/* host driver already reported errors */
-		err = 0;
-	else if (cmd.resp[0] & R5_ERROR)
-		err = -EIO;
-	else if (cmd.resp[0] & R5_FUNCTION_NUMBER)
-		err = -EINVAL;
-	else if (cmd.resp[0] & R5_OUT_OF_RANGE)
-		err = -ERANGE;
-	else
-		err = 0;
+		return 0;
+	if (cmd->resp[0] & R5_ERROR)
+		return -EIO;
+	if (cmd->resp[0] & R5_FUNCTION_NUMBER)
+		return -EINVAL;
+	if (cmd->resp[0] & R5_OUT_OF_RANGE)
+		return -ERANGE;
+
+	return 0;
+}
+
+int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
+	unsigned addr, int incr_addr, u8 *buf, unsigned blocks, unsigned blksz)
+{
+	struct mmc_io_ext ext = {};
+	int err;
+
+	err = mmc_io_ext_init(card, &ext, write, fn, addr, incr_addr, buf,
+			      blocks, blksz);
+	if (err)
+		return err;
+
+	mmc_pre_req(card->host, &ext.mrq);
+
+	mmc_wait_for_req(card->host, &ext.mrq);
 
-	mmc_post_req(card->host, &mrq, err);
+	err = mmc_io_ext_result(card, &ext);
+
+	mmc_post_req(card->host, &ext.mrq, err);
+
+	mmc_io_ext_cleanup(&ext);
+
+	return err;
+}
+
+static void mmc_io_ext_done(struct mmc_request *mrq)
+{
+	complete(&mrq->completion);
+}
+
+static void mmc_io_ext_start(struct mmc_host *host, struct mmc_io_ext *ext)
+{
+	struct mmc_request *mrq = &ext->mrq;
+	int err;
+
+	init_completion(&mrq->completion);
+	mrq->done = mmc_io_ext_done;
+
+	err = mmc_start_request(host, mrq);
+	if (err) {
+		mrq->cmd->error = err;
+		complete(&mrq->completion);
+	}
+}
+
+/*
+ * Issue a list of prepared CMD53s back to back. The next request is
+ * prepared for DMA by the host while the current one is on the bus, so
+ * the mapping cost is hidden behind the transfer, the same way the block
+ * layer pipelines its requests. Stops at the first failing command.
+ */
+int mmc_io_rw_extended_batch(struct mmc_card *card, struct mmc_io_ext *ext,
+	unsigned int nr)
+{
+	struct mmc_host *host = card->host;
+	unsigned int i;
+	int err = 0;
+
+	if (!nr)
+		return 0;
+
+	mmc_pre_req(host, &ext[0].mrq);
+
+	for (i = 0; i < nr; i++) {
+		mmc_io_ext_start(host, &ext[i]);
+
+		if (i + 1 < nr)
+			mmc_pre_req(host, &ext[i + 1].mrq);
+
+		mmc_wait_for_req_done(host, &ext[i].mrq);
+
+		err = mmc_io_ext_result(card, &ext[i]);
+		mmc_post_req(host, &ext[i].mrq, err);
+		if (err)
+			break;
+	}
 
-	if (nents > 1)
-		sg_free_table(&sgtable);
+	/* Unprepare the command that was mapped but never issued */
+	if (err && i + 1 < nr)
+		mmc_post_req(host, &ext[i + 1].mrq, -ECANCELED);
 
 	return err;
 }
@@ -9,17 +9,34 @@
 #define _MMC_SDIO_OPS_H
 
 #include <linux/types.h>
+#include <linux/scatterlist.h>
+#include <linux/mmc/core.h>
 #include <linux/mmc/sdio.h>
 
 struct mmc_host;
 struct mmc_card;
 struct work_struct;
 
+/* One prepared IO_RW_EXTENDED (CMD53) request */
+struct mmc_io_ext {
+	struct mmc_request	mrq;
+	struct mmc_command	cmd;
+	struct mmc_data		data;
+	struct scatterlist	sg;
+	struct sg_table		sgtable;
+};
+
 int mmc_send_io_op_cond(struct mmc_host *host, u32 ocr, u32 *rocr);
 int mmc_io_rw_direct(struct mmc_card *card, int write, unsigned fn,
 	unsigned addr, u8 in, u8* out);
 int mmc_io_rw_extended(struct mmc_card *card, int write, unsigned fn,
 	unsigned addr, int incr_addr, u8 *buf, unsigned blocks, unsigned blksz);
+int mmc_io_ext_init(struct mmc_card *card, struct mmc_io_ext *ext, int write,
+	unsigned fn, unsigned addr, int incr_addr, u8 *buf, unsigned blocks,
+	unsigned blksz);
+void mmc_io_ext_cleanup(struct mmc_io_ext *ext);
+int mmc_io_rw_extended_batch(struct mmc_card *card, struct mmc_io_ext *ext,
+	unsigned int nr);
 int sdio_reset(struct mmc_host *host);
 void sdio_irq_work(struct work_struct *work);
 
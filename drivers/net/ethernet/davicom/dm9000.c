@@ -100,6 +100,7 @@ struct board_info {
 	u8		io_mode;		/* 0:word, 2:byte */
 	u8		phy_addr;
 	u8		imr_all;
+	u8		rx_polling;	/* RX interrupt masked for NAPI */
 
 	unsigned int	flags;
 	unsigned int	in_timeout:1;
@@ -125,6 +126,7 @@ struct board_info {
 
 	struct delayed_work phy_poll;
 	struct net_device  *ndev;
+	struct napi_struct napi;
 
 	spinlock_t	lock;
 
@@ -229,14 +231,20 @@ static void dm9000_inblk_32bit(void __iomem *reg, void *data, int count)
 	ioread32_rep(reg, data, (count+3) >> 2);
 }
 
-/* dump block from chip to null */
+/* dump block from chip to null
+ *
+ * Nothing depends on the data, so the FIFO is drained with relaxed reads
+ * instead of paying a barrier for every word. Accesses to the device are
+ * still ordered among themselves, the register index write that follows
+ * cannot pass them.
+ */
 
 static void dm9000_dumpblk_8bit(void __iomem *reg, int count)
 {
 	int i;
 
 	for (i = 0; i < count; i++)
-		readb(reg);
+		readb_relaxed(reg);
 }
 
 static void dm9000_dumpblk_16bit(void __iomem *reg, int count)
@@ -246,7 +254,7 @@ static void dm9000_dumpblk_16bit(void __iomem *reg, int count)
 	count = (count + 1) >> 1;
 
 	for (i = 0; i < count; i++)
-		readw(reg);
+		readw_relaxed(reg);
 }
 
 static void dm9000_dumpblk_32bit(void __iomem *reg, int count)
@@ -256,7 +264,7 @@ static void dm9000_dumpblk_32bit(void __iomem *reg, int count)
 	count = (count + 3) >> 2;
 
 	for (i = 0; i < count; i++)
-		readl(reg);
+		readl_relaxed(reg);
 }
 
 /*
@@ -889,7 +897,9 @@ dm9000_mask_interrupts(struct board_info *db)
 static void
 dm9000_unmask_interrupts(struct board_info *db)
 {
-	iow(db, DM9000_IMR, db->imr_all);
+	/* receive interrupts stay off while NAPI is polling */
+	iow(db, DM9000_IMR, db->rx_polling ? db->imr_all & ~IMR_PRM :
+					     db->imr_all);
 }
 
 /*
@@ -1082,20 +1092,29 @@ struct dm9000_rxhdr {
 } __packed;
 
 /*
- *  Received a packet and pass to upper layer
+ *  Received packets and pass to upper layer, at most budget of them.
+ *  db->lock is only held for the transfer of each packet, so that
+ *  transmit and the interrupt handler can get in between.
  */
-static void
-dm9000_rx(struct net_device *dev)
+static int
+dm9000_rx(struct net_device *dev, int budget)
 {
 	struct board_info *db = netdev_priv(dev);
 	struct dm9000_rxhdr rxhdr;
 	struct sk_buff *skb;
-	u8 rxbyte, *rdptr;
+	unsigned long flags;
+	u8 rxbyte, reg_save, *rdptr;
 	bool GoodPacket;
 	int RxLen;
+	int received = 0;
 
 	/* Check packet ready or not */
-	do {
+	while (received < budget) {
+		spin_lock_irqsave(&db->lock, flags);
+
+		/* Save previous register address */
+		reg_save = readb(db->io_addr);
+
 		ior(db, DM9000_MRCMDX);	/* Dummy read */
 
 		/* Get most updated data */
@@ -1105,14 +1124,17 @@ dm9000_rx(struct net_device *dev)
 		if (rxbyte & DM9000_PKT_ERR) {
 			dev_warn(db->dev, "status check fail: %d\n", rxbyte);
 			iow(db, DM9000_RCR, 0x00);	/* Stop Device */
-			return;
 		}
 
-		if (!(rxbyte & DM9000_PKT_RDY))
-			return;
+		if ((rxbyte & DM9000_PKT_ERR) || !(rxbyte & DM9000_PKT_RDY)) {
+			writeb(reg_save, db->io_addr);
+			spin_unlock_irqrestore(&db->lock, flags);
+			break;
+		}
 
 		/* A packet ready now  & Get status/length */
 		GoodPacket = true;
+		skb = NULL;
 		writeb(DM9000_MRCMD, db->io_addr);
 
 		(db->inblk)(db->io_data, &rxhdr, sizeof(rxhdr));
@@ -1166,24 +1188,54 @@ dm9000_rx(struct net_device *dev)
 
 			(db->inblk)(db->io_data, rdptr, RxLen);
 			dev->stats.rx_bytes += RxLen;
-
-			/* Pass to upper layer */
-			skb->protocol = eth_type_trans(skb, dev);
-			if (dev->features & NETIF_F_RXCSUM) {
-				if ((((rxbyte & 0x1c) << 3) & rxbyte) == 0)
-					skb->ip_summed = CHECKSUM_UNNECESSARY;
-				else
-					skb_checksum_none_assert(skb);
-			}
-			netif_rx(skb);
-			dev->stats.rx_packets++;
-
 		} else {
 			/* need to dump the packet's data */
 
 			(db->dumpblk)(db->io_data, RxLen);
 		}
-	} while (rxbyte & DM9000_PKT_RDY);
+
+		/* Restore previous register address */
+		writeb(reg_save, db->io_addr);
+		spin_unlock_irqrestore(&db->lock, flags);
+
+		received++;
+		if (!skb)
+			continue;
+
+		/* Pass to upper layer */
+		skb->protocol = eth_type_trans(skb, dev);
+		if (dev->features & NETIF_F_RXCSUM) {
+			if ((((rxbyte & 0x1c) << 3) & rxbyte) == 0)
+				skb->ip_summed = CHECKSUM_UNNECESSARY;
+			else
+				skb_checksum_none_assert(skb);
+		}
+		napi_gro_receive(&db->napi, skb);
+		dev->stats.rx_packets++;
+	}
+
+	return received;
+}
+
+static int dm9000_poll(struct napi_struct *napi, int budget)
+{
+	struct board_info *db = container_of(napi, struct board_info, napi);
+	unsigned long flags;
+	u8 reg_save;
+	int work_done;
+
+	work_done = dm9000_rx(db->ndev, budget);
+
+	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		spin_lock_irqsave(&db->lock, flags);
+		reg_save = readb(db->io_addr);
+		db->rx_polling = 0;
+		dm9000_unmask_interrupts(db);
+		writeb(reg_save, db->io_addr);
+		spin_unlock_irqrestore(&db->lock, flags);
+	}
+
+	return work_done;
 }
 
 static irqreturn_t dm9000_interrupt(int irq, void *dev_id)
@@ -1212,9 +1264,11 @@ static irqreturn_t dm9000_interrupt(int irq, void *dev_id)
 	if (netif_msg_intr(db))
 		dev_dbg(db->dev, "interrupt status %02x\n", int_status);
 
-	/* Received the coming packet */
-	if (int_status & ISR_PRS)
-		dm9000_rx(dev);
+	/* Received the coming packet, hand it over to NAPI */
+	if ((int_status & ISR_PRS) && napi_schedule_prep(&db->napi)) {
+		db->rx_polling = 1;
+		__napi_schedule(&db->napi);
+	}
 
 	/* Transmit Interrupt check */
 	if (int_status & ISR_PTS)
@@ -1310,8 +1364,13 @@ dm9000_open(struct net_device *dev)
 	/* Initialize DM9000 board */
 	dm9000_init_dm9000(dev);
 
-	if (request_irq(dev->irq, dm9000_interrupt, irq_flags, dev->name, dev))
+	db->rx_polling = 0;
+	napi_enable(&db->napi);
+
+	if (request_irq(dev->irq, dm9000_interrupt, irq_flags, dev->name, dev)) {
+		napi_disable(&db->napi);
 		return -EAGAIN;
+	}
 	/* Now that we have an interrupt handler hooked up we can unmask
 	 * our interrupts
 	 */
@@ -1360,6 +1419,7 @@ dm9000_stop(struct net_device *ndev)
 
 	/* free interrupt */
 	free_irq(ndev->irq, ndev);
+	napi_disable(&db->napi);
 
 	dm9000_shutdown(ndev);
 
@@ -1650,6 +1710,7 @@ dm9000_probe(struct platform_device *pdev)
 	/* from this point we assume that we have found a DM9000 */
 
 	ndev->netdev_ops	= &dm9000_netdev_ops;
+	netif_napi_add(ndev, &db->napi, dm9000_poll, NAPI_POLL_WEIGHT);
 	ndev->watchdog_timeo	= msecs_to_jiffies(watchdog);
 	ndev->ethtool_ops	= &dm9000_ethtool_ops;
 
@@ -331,6 +331,38 @@ static int brcmf_sdiod_skbuff_write(struct brcmf_sdio_dev *sdiodev,
 	return err;
 }
 
+/* Write each skb of @pktq with its own CMD53(s), as one batch */
+static int brcmf_sdiod_skbuff_write_batch(struct brcmf_sdio_dev *sdiodev,
+					  struct sdio_func *func, u32 addr,
+					  struct sk_buff_head *pktq)
+{
+	struct sdio_xfer *xfers;
+	struct sk_buff *skb;
+	unsigned int i = 0;
+	int err;
+
+	xfers = kcalloc(pktq->qlen, sizeof(*xfers), GFP_KERNEL);
+	if (!xfers)
+		return -ENOMEM;
+
+	skb_queue_walk(pktq, skb) {
+		xfers[i].buf = skb->data;
+		xfers[i].addr = addr;
+		xfers[i].len = ALIGN(skb->len, 4);
+		xfers[i].write = 1;
+		xfers[i].incr_addr = 1;
+		i++;
+	}
+
+	err = sdio_transfer_batch(func, xfers, i);
+	kfree(xfers);
+
+	if (err == -ENOMEDIUM)
+		brcmf_sdiod_change_state(sdiodev, BRCMF_SDIOD_NOMEDIUM);
+
+	return err;
+}
+
 static int mmc_submit_one(struct mmc_data *md, struct mmc_request *mr,
 			  struct mmc_command *mc, int sg_cnt, int req_sz,
 			  int func_blk_sz, u32 *addr,
@@ -645,13 +677,13 @@ int brcmf_sdiod_send_pkt(struct brcmf_sdio_dev *sdiodev,
 	addr &= SBSDIO_SB_OFT_ADDR_MASK;
 	addr |= SBSDIO_SB_ACCESS_2_4B_FLAG;
 
-	if (pktq->qlen == 1 || !sdiodev->sg_support) {
-		skb_queue_walk(pktq, skb) {
-			err = brcmf_sdiod_skbuff_write(sdiodev, sdiodev->func2,
-						       addr, skb);
-			if (err)
-				break;
-		}
+	if (pktq->qlen == 1) {
+		skb = skb_peek(pktq);
+		err = brcmf_sdiod_skbuff_write(sdiodev, sdiodev->func2,
+					       addr, skb);
+	} else if (!sdiodev->sg_support) {
+		err = brcmf_sdiod_skbuff_write_batch(sdiodev, sdiodev->func2,
+						     addr, pktq);
 	} else {
 		err = brcmf_sdiod_sglist_rw(sdiodev, sdiodev->func2, true,
 					    addr, pktq);
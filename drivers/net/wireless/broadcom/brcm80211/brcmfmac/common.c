@@ -37,6 +37,18 @@ static int brcmf_sdiod_txglomsz = BRCMF_DEFAULT_TXGLOM_SIZE;
 module_param_named(txglomsz, brcmf_sdiod_txglomsz, int, 0);
 MODULE_PARM_DESC(txglomsz, "Maximum tx packet chain size [SDIO]");
 
+static int brcmf_sdiod_txglom_adaptive = 1;
+module_param_named(txglom_adaptive, brcmf_sdiod_txglom_adaptive, int, 0);
+MODULE_PARM_DESC(txglom_adaptive, "Adapt tx packet chain size to load [SDIO]");
+
+static int brcmf_sdiod_dpc_kthread;
+module_param_named(dpc_kthread, brcmf_sdiod_dpc_kthread, int, 0);
+MODULE_PARM_DESC(dpc_kthread, "Run the bus DPC in a SCHED_FIFO thread [SDIO]");
+
+static int brcmf_sdiod_dpc_cpu = -1;
+module_param_named(dpc_cpu, brcmf_sdiod_dpc_cpu, int, 0);
+MODULE_PARM_DESC(dpc_cpu, "CPU to pin the DPC thread to, -1 for none [SDIO]");
+
 /* Debug level configuration. See debug.h for bits, sysfs modifiable */
 int brcmf_msg_level;
 module_param_named(debug, brcmf_msg_level, int, 0600);
@@ -420,8 +432,12 @@ struct brcmf_mp_device *brcmf_get_module_param(struct device *dev,
 	settings->ignore_probe_fail = !!brcmf_ignore_probe_fail;
 #endif
 
-	if (bus_type == BRCMF_BUSTYPE_SDIO)
+	if (bus_type == BRCMF_BUSTYPE_SDIO) {
 		settings->bus.sdio.txglomsz = brcmf_sdiod_txglomsz;
+		settings->txglom_adaptive = !!brcmf_sdiod_txglom_adaptive;
+		settings->dpc_kthread = !!brcmf_sdiod_dpc_kthread;
+		settings->dpc_cpu = brcmf_sdiod_dpc_cpu;
+	}
 
 	/* See if there is any device specific platform data configured */
 	found = false;
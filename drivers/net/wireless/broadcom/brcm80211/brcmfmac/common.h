@@ -38,6 +38,9 @@ extern struct brcmf_mp_global_t brcmf_mp_global;
  * @fcmode: FWS flow control.
  * @roamoff: Firmware roaming off?
  * @ignore_probe_fail: Ignore probe failure.
+ * @txglom_adaptive: Adapt the SDIO tx chain size to load.
+ * @dpc_kthread: Run the SDIO DPC in a dedicated SCHED_FIFO thread.
+ * @dpc_cpu: CPU to pin the SDIO DPC thread to, or -1.
  * @country_codes: If available, pointer to struct for translating country codes
  * @bus: Bus specific platform data. Only SDIO at the mmoment.
  */
@@ -48,6 +51,9 @@ struct brcmf_mp_device {
 	bool		roamoff;
 	bool		iapp;
 	bool		ignore_probe_fail;
+	bool		txglom_adaptive;
+	bool		dpc_kthread;
+	int		dpc_cpu;
 	struct brcmfmac_pd_cc *country_codes;
 	const char	*board_type;
 	union {
@@ -161,6 +161,9 @@ static const char *brcmf_fws_get_tlv_name(enum brcmf_fws_tlv_type id)
 #define BRCMF_FWS_RET_OK_NOSCHEDULE			0
 #define BRCMF_FWS_RET_OK_SCHEDULE			1
 
+/* packets handed to the bus per release of the fws lock */
+#define BRCMF_FWS_DEQ_BATCH				16
+
 #define BRCMF_FWS_MODE_REUSESEQ_SHIFT			3	/* seq reuse */
 #define BRCMF_FWS_MODE_SET_REUSESEQ(x, val)	((x) = \
 		((x) & ~(1 << BRCMF_FWS_MODE_REUSESEQ_SHIFT)) | \
@@ -1445,6 +1448,8 @@ brcmf_fws_txs_process(struct brcmf_fws_info *fws, u8 flags, u32 hslot,
 	struct brcmf_skbuff_cb *skcb;
 	struct brcmf_fws_mac_descriptor *entry = NULL;
 	struct brcmf_if *ifp;
+	u8 credits[BRCMF_FWS_FIFO_COUNT] = {};
+	bool credited = false;
 
 	brcmf_dbg(DATA, "flags %d\n", flags);
 
@@ -1489,14 +1494,15 @@ brcmf_fws_txs_process(struct brcmf_fws_info *fws, u8 flags, u32 hslot,
 		brcmf_dbg(DATA, "%s flags %d htod %X seq %X\n", entry->name,
 			  flags, skcb->htod, seq);
 
-		/* pick up the implicit credit from this packet */
+		/* pick up the implicit credit from this packet, they are
+		 * returned to the fifos together once the batch is done
+		 */
 		fifo = brcmf_skb_htod_tag_get_field(skb, FIFO);
-		if (fws->fcmode == BRCMF_FWS_FCMODE_IMPLIED_CREDIT ||
-		    (brcmf_skb_if_flags_get_field(skb, REQ_CREDIT)) ||
-		    flags == BRCMF_FWS_TXSTATUS_HOST_TOSSED) {
-			brcmf_fws_return_credits(fws, fifo, 1);
-			brcmf_fws_schedule_deq(fws);
-		}
+		if ((fws->fcmode == BRCMF_FWS_FCMODE_IMPLIED_CREDIT ||
+		     (brcmf_skb_if_flags_get_field(skb, REQ_CREDIT)) ||
+		     flags == BRCMF_FWS_TXSTATUS_HOST_TOSSED) &&
+		    fifo < BRCMF_FWS_FIFO_COUNT)
+			credits[fifo]++;
 		brcmf_fws_macdesc_return_req_credit(skb);
 
 		ret = brcmf_proto_hdrpull(fws->drvr, false, skb, &ifp);
@@ -1519,6 +1525,15 @@ brcmf_fws_txs_process(struct brcmf_fws_info *fws, u8 flags, u32 hslot,
 		cnt++;
 	}
 
+	for (fifo = 0; fifo < BRCMF_FWS_FIFO_COUNT; fifo++) {
+		if (!credits[fifo])
+			continue;
+		brcmf_fws_return_credits(fws, fifo, credits[fifo]);
+		credited = true;
+	}
+	if (credited)
+		brcmf_fws_schedule_deq(fws);
+
 	return 0;
 }
 
@@ -2090,6 +2105,75 @@ static int brcmf_fws_commit_skb(struct brcmf_fws_info *fws, int fifo,
 	return rc;
 }
 
+/*
+ * Like brcmf_fws_commit_skb() for up to BRCMF_FWS_DEQ_BATCH packets of one
+ * fifo, dropping the fws lock once around handing them all to the bus. On
+ * the first bus error that packet and the ones after it are rolled back,
+ * last first so they keep their order in the queues. A packet without a
+ * valid entry ends the batch and its error is returned, the packets ahead
+ * of it are still sent.
+ */
+static int brcmf_fws_commit_skbs(struct brcmf_fws_info *fws, int fifo,
+				 struct sk_buff **skbs, int cnt)
+{
+	struct brcmf_fws_mac_descriptor *entry;
+	u8 data_offset[BRCMF_FWS_DEQ_BATCH];
+	u8 ifidx[BRCMF_FWS_DEQ_BATCH];
+	u32 requested = 0;
+	int i, sent, rc = 0, err = 0;
+
+	for (i = 0; i < cnt; i++) {
+		entry = brcmf_skbcb(skbs[i])->mac;
+		if (IS_ERR(entry)) {
+			err = PTR_ERR(entry);
+			cnt = i;
+			break;
+		}
+	}
+	if (!cnt)
+		return err;
+
+	for (i = 0; i < cnt; i++) {
+		entry = brcmf_skbcb(skbs[i])->mac;
+		data_offset[i] = brcmf_fws_precommit_skb(fws, fifo, skbs[i]);
+		entry->transit_count++;
+		if (entry->suppressed)
+			entry->suppr_transit_count++;
+		ifidx[i] = brcmf_skb_if_flags_get_field(skbs[i], INDEX);
+		if (brcmf_skb_if_flags_get_field(skbs[i], REQUESTED))
+			requested |= BIT(i);
+	}
+
+	brcmf_fws_unlock(fws);
+	for (sent = 0; sent < cnt; sent++) {
+		rc = brcmf_proto_txdata(fws->drvr, ifidx[sent],
+					data_offset[sent], skbs[sent]);
+		if (rc < 0)
+			break;
+	}
+	brcmf_fws_lock(fws);
+	brcmf_dbg(DATA, "fifo %d sent %d of %d bus_tx %d\n", fifo, sent, cnt,
+		  rc);
+
+	fws->stats.pkt2bus += sent;
+	fws->stats.send_pkts[fifo] += sent;
+	fws->stats.requested_sent[fifo] += hweight32(requested &
+						     (BIT(sent) - 1));
+
+	for (i = cnt - 1; i >= sent; i--) {
+		entry = brcmf_skbcb(skbs[i])->mac;
+		entry->transit_count--;
+		if (entry->suppressed)
+			entry->suppr_transit_count--;
+		(void)brcmf_proto_hdrpull(fws->drvr, false, skbs[i], NULL);
+		brcmf_fws_rollback_toq(fws, skbs[i], fifo);
+	}
+
+	if (rc < 0)
+		return rc;
+	return err;
+}
+
 static int brcmf_fws_assign_htod(struct brcmf_fws_info *fws, struct sk_buff *p,
 				  int fifo)
 {
@@ -2201,8 +2285,9 @@ static void brcmf_fws_dequeue_worker(struct work_struct *worker)
 {
 	struct brcmf_fws_info *fws;
 	struct brcmf_pub *drvr;
+	struct sk_buff *skbs[BRCMF_FWS_DEQ_BATCH];
 	struct sk_buff *skb;
-	int fifo;
+	int fifo, cnt;
 	u32 hslot;
 	u32 ifidx;
 	int ret;
@@ -2235,18 +2320,25 @@ static void brcmf_fws_dequeue_worker(struct work_struct *worker)
 			continue;
 		}
 
-		while ((fws->fifo_credit[fifo]) ||
-		       ((!fws->bcmc_credit_check) &&
-				(fifo == BRCMF_FWS_FIFO_BCMC))) {
-			skb = brcmf_fws_deq(fws, fifo);
-			if (!skb)
-				break;
-			fws->fifo_credit[fifo]--;
-			if (brcmf_fws_commit_skb(fws, fifo, skb))
-				break;
-			if (fws->bus_flow_blocked)
+		do {
+			for (cnt = 0; cnt < BRCMF_FWS_DEQ_BATCH; cnt++) {
+				if (!fws->fifo_credit[fifo] &&
+				    (fws->bcmc_credit_check ||
+				     fifo != BRCMF_FWS_FIFO_BCMC))
+					break;
+				skb = brcmf_fws_deq(fws, fifo);
+				if (!skb)
+					break;
+				fws->fifo_credit[fifo]--;
+				skbs[cnt] = skb;
+				if (IS_ERR(brcmf_skbcb(skb)->mac)) {
+					cnt++;
+					break;
+				}
+			}
+			if (!cnt || brcmf_fws_commit_skbs(fws, fifo, skbs, cnt))
 				break;
-		}
+		} while (cnt == BRCMF_FWS_DEQ_BATCH && !fws->bus_flow_blocked);
 
 		if (fifo >= BRCMF_FWS_FIFO_AC_BE &&
 		    fifo <= BRCMF_FWS_FIFO_AC_VO &&
@@ -12,6 +12,7 @@
 #include <linux/netdevice.h>
 #include <linux/interrupt.h>
 #include <linux/sched/signal.h>
+#include <linux/sched.h>
 #include <linux/mmc/sdio.h>
 #include <linux/mmc/sdio_ids.h>
 #include <linux/mmc/sdio_func.h>
@@ -128,6 +129,12 @@ struct rte_console {
 
 #define BRCMF_TXMINMAX	1	/* Max tx frames if rx still pending */
 
+#define BRCMF_TXGLOM_MIN	2	/* Smallest adaptive tx chain limit */
+#define BRCMF_TXGLOM_WINDOW	32	/* Tx chains per adaptation step */
+#define BRCMF_TXGLOM_HOLD	16	/* Steps to wait before probing a
+					 larger chain limit again */
+#define BRCMF_TXGLOM_HIST	6	/* log2 buckets of tx chain length */
+
 #define MEMBLOCK	2048	/* Block size used for downloading
 				 of dongle image */
 #define MAX_DATA_BUF	(32 * 1024)	/* Must be large enough to hold
@@ -432,6 +439,28 @@ struct brcmf_sdio_count {
 	ulong rx_ctlerrs;	/* Err of processing rx ctrl frames */
 	ulong rx_ctlpkts;	/* Ctrl frames processed from dongle */
 	ulong rx_readahead_cnt;	/* packets where header read-ahead was used */
+	uint rxglommax;		/* Most packets seen in one glom frame */
+};
+
+/*
+ * adaptive tx glom sizing
+ */
+struct brcmf_sdio_txglom {
+	uint cur;		/* Current tx chain limit */
+	uint hold;		/* Steps left before growing is retried */
+	bool grown;		/* Last step doubled the limit */
+	u32 rate;		/* Bus rate of the last window, bytes/ms */
+	/* current window */
+	uint chains;		/* Chains sent */
+	uint frames;		/* Frames sent */
+	uint backlogged;	/* Chains that left frames queued */
+	u64 bytes;		/* Bytes sent */
+	u64 busy_ns;		/* Time spent writing chains to the bus */
+	/* statistics */
+	uint grows;		/* Limit doubled */
+	uint shrinks;		/* Limit halved on light load */
+	uint backoffs;		/* Limit halved as growing did not pay */
+	uint hist[BRCMF_TXGLOM_HIST];	/* Chains per log2 length */
 };
 
 /* misc chip info needed by some of the routines */
@@ -514,6 +543,9 @@ struct brcmf_sdio {
 
 	struct workqueue_struct *brcmf_wq;
 	struct work_struct datawork;
+	struct kthread_worker *dpc_worker;	/* optional SCHED_FIFO dpc */
+	struct kthread_work dpc_kwork;
+	u64 dpc_queued_ns;	/* when the dpc was last scheduled */
 	bool dpc_triggered;
 	bool dpc_running;
 
@@ -524,6 +556,8 @@ struct brcmf_sdio {
 
 	u8 tx_hdrlen;		/* sdio bus header length for tx packet */
 	bool txglom;		/* host tx glomming enable flag */
+	bool txglom_adaptive;	/* size tx chains from load and bus rate */
+	struct brcmf_sdio_txglom txglom_st;
 	u16 head_align;		/* buffer pointer alignment */
 	u16 sgentry_align;	/* scatter-gather buffer alignment */
 };
@@ -1718,6 +1752,7 @@ static u8 brcmf_sdio_rxglom(struct brcmf_sdio *bus, u8 rxseq)
 			bus->sdcnt.rxglompkts++;
 		}
 
+		bus->sdcnt.rxglommax = max_t(uint, bus->sdcnt.rxglommax, num);
 		bus->sdcnt.rxglomframes++;
 	}
 	return num;
@@ -2326,6 +2361,83 @@ static int brcmf_sdio_txpkt(struct brcmf_sdio *bus, struct sk_buff_head *pktq,
 	return ret;
 }
 
+static uint brcmf_sdio_txglom_limit(struct brcmf_sdio *bus)
+{
+	if (bus->txglom_adaptive)
+		return bus->txglom_st.cur;
+	return bus->sdiodev->txglomsz;
+}
+
+/**
+ * brcmf_sdio_txglom_adapt - tune the tx chain limit once per window
+ * @bus: brcmf_sdio structure pointer
+ * @frames: frames in the chain just sent
+ * @bytes: payload bytes in the chain just sent
+ * @ns: time the chain took on the bus
+ * @backlog: frames still queued after the chain was taken
+ *
+ * Long chains amortise the per-transfer cost of the SDIO bus, but every
+ * frame queued behind one waits for the whole chain. Shrink the limit
+ * while the queue drains on every chain, and double it while the queue
+ * is backlogged and chains fill up to the limit, as long as each doubling
+ * raises the measured bus rate. If it does not, step back and wait a
+ * while before probing again.
+ */
+static void brcmf_sdio_txglom_adapt(struct brcmf_sdio *bus, uint frames,
+				    u32 bytes, u64 ns, uint backlog)
+{
+	struct brcmf_sdio_txglom *tg = &bus->txglom_st;
+	uint max = bus->sdiodev->txglomsz;
+	u32 rate;
+
+	tg->hist[min_t(uint, ilog2(frames), BRCMF_TXGLOM_HIST - 1)]++;
+	tg->chains++;
+	tg->frames += frames;
+	tg->bytes += bytes;
+	tg->busy_ns += ns;
+	if (backlog)
+		tg->backlogged++;
+
+	if (tg->chains < BRCMF_TXGLOM_WINDOW)
+		return;
+
+	rate = div64_u64(tg->bytes * NSEC_PER_MSEC, max_t(u64, tg->busy_ns, 1));
+
+	if (tg->backlogged < tg->chains / 2) {
+		/* queue is shallow: long chains only add latency */
+		if (tg->cur > BRCMF_TXGLOM_MIN) {
+			tg->cur = max_t(uint, tg->cur / 2, BRCMF_TXGLOM_MIN);
+			tg->shrinks++;
+		}
+		tg->grown = false;
+		tg->hold = 0;
+	} else if (tg->grown && rate < tg->rate + tg->rate / 16) {
+		/* doubling bought no bus throughput, step back */
+		tg->cur = max_t(uint, tg->cur / 2, BRCMF_TXGLOM_MIN);
+		tg->backoffs++;
+		tg->grown = false;
+		tg->hold = BRCMF_TXGLOM_HOLD;
+	} else if (tg->hold) {
+		tg->hold--;
+		tg->grown = false;
+	} else if (tg->cur < max && tg->frames >= tg->chains * tg->cur * 3 / 4) {
+		/* chains are cut by the limit, not by credit or queue */
+		tg->cur = min_t(uint, tg->cur * 2, max);
+		tg->grows++;
+		tg->grown = true;
+	} else {
+		tg->grown = false;
+	}
+
+	brcmf_dbg(GLOM, "txglom limit %u, rate %u bytes/ms\n", tg->cur, rate);
+	tg->rate = rate;
+	tg->chains = 0;
+	tg->frames = 0;
+	tg->backlogged = 0;
+	tg->bytes = 0;
+	tg->busy_ns = 0;
+}
+
 static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 {
 	struct sk_buff *pkt;
@@ -2333,8 +2445,10 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 	u32 intstat_addr = bus->sdio_core->base + SD_REG(intstatus);
 	u32 intstatus = 0;
 	int ret = 0, prec_out, i;
-	uint cnt = 0;
+	uint cnt = 0, backlog = 0;
 	u8 tx_prec_map, pkt_num;
+	u32 bytes;
+	u64 start;
 
 	brcmf_dbg(TRACE, "Enter\n");
 
@@ -2345,23 +2459,32 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 		pkt_num = 1;
 		if (bus->txglom)
 			pkt_num = min_t(u8, bus->tx_max - bus->tx_seq,
-					bus->sdiodev->txglomsz);
+					brcmf_sdio_txglom_limit(bus));
 		pkt_num = min_t(u32, pkt_num,
 				brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol));
 		__skb_queue_head_init(&pktq);
+		bytes = 0;
 		spin_lock_bh(&bus->txq_lock);
 		for (i = 0; i < pkt_num; i++) {
 			pkt = brcmu_pktq_mdeq(&bus->txq, tx_prec_map,
 					      &prec_out);
 			if (pkt == NULL)
 				break;
+			bytes += pkt->len;
 			__skb_queue_tail(&pktq, pkt);
 		}
+		if (bus->txglom_adaptive)
+			backlog = brcmu_pktq_mlen(&bus->txq, tx_prec_map);
 		spin_unlock_bh(&bus->txq_lock);
 		if (i == 0)
 			break;
 
+		start = ktime_get_ns();
 		ret = brcmf_sdio_txpkt(bus, &pktq, SDPCM_DATA_CHANNEL);
+		if (bus->txglom_adaptive && !ret)
+			brcmf_sdio_txglom_adapt(bus, i, bytes,
+						ktime_get_ns() - start,
+						backlog);
 
 		cnt += i;
 
@@ -3189,7 +3312,8 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 		   "f2txdata:     %u\nf1regdata:    %u\n"
 		   "tickcnt:      %u\ntx_ctlerrs:   %lu\n"
 		   "tx_ctlpkts:   %lu\nrx_ctlerrs:   %lu\n"
-		   "rx_ctlpkts:   %lu\nrx_readahead: %lu\n",
+		   "rx_ctlpkts:   %lu\nrx_readahead: %lu\n"
+		   "rxglommax:    %u\n",
 		   sdcnt->intrcount, sdcnt->lastintrs,
 		   sdcnt->pollcnt, sdcnt->regfails,
 		   sdcnt->tx_sderrs, sdcnt->fcqueued,
@@ -3203,7 +3327,31 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 		   sdcnt->f2txdata, sdcnt->f1regdata,
 		   sdcnt->tickcnt, sdcnt->tx_ctlerrs,
 		   sdcnt->tx_ctlpkts, sdcnt->rx_ctlerrs,
-		   sdcnt->rx_ctlpkts, sdcnt->rx_readahead_cnt);
+		   sdcnt->rx_ctlpkts, sdcnt->rx_readahead_cnt,
+		   sdcnt->rxglommax);
+
+	return 0;
+}
+
+static int brcmf_debugfs_sdio_txglom_read(struct seq_file *seq, void *data)
+{
+	struct brcmf_bus *bus_if = dev_get_drvdata(seq->private);
+	struct brcmf_sdio *bus = bus_if->bus_priv.sdio->bus;
+	struct brcmf_sdio_txglom *tg = &bus->txglom_st;
+	int i;
+
+	seq_printf(seq,
+		   "adaptive:     %u\nlimit:        %u\n"
+		   "max:          %u\nrate:         %u\n"
+		   "grows:        %u\nshrinks:      %u\n"
+		   "backoffs:     %u\n",
+		   bus->txglom_adaptive,
+		   brcmf_sdio_txglom_limit(bus), bus->sdiodev->txglomsz,
+		   tg->rate, tg->grows, tg->shrinks, tg->backoffs);
+	for (i = 0; i < BRCMF_TXGLOM_HIST; i++)
+		seq_printf(seq, "chain_len %u%s: %u\n", 1 << i,
+			   i == BRCMF_TXGLOM_HIST - 1 ? "+" : "",
+			   tg->hist[i]);
 
 	return 0;
 }
@@ -3224,6 +3372,8 @@ static void brcmf_sdio_debugfs_create(struct device *dev)
 	brcmf_debugfs_add_entry(drvr, "forensics", brcmf_sdio_forensic_read);
 	brcmf_debugfs_add_entry(drvr, "counters",
 				brcmf_debugfs_sdio_count_read);
+	brcmf_debugfs_add_entry(drvr, "txglom",
+				brcmf_debugfs_sdio_txglom_read);
 	debugfs_create_u32("console_interval", 0644, dentry,
 			   &bus->console_interval);
 }
@@ -3579,6 +3729,11 @@ static int brcmf_sdio_bus_preinit(struct device *dev)
 			bus->tx_hdrlen += SDPCM_HWEXT_LEN;
 		}
 	}
+	bus->txglom_adaptive = bus->txglom &&
+			       sdiodev->settings->txglom_adaptive &&
+			       sdiodev->txglomsz > BRCMF_TXGLOM_MIN;
+	memset(&bus->txglom_st, 0, sizeof(bus->txglom_st));
+	bus->txglom_st.cur = sdiodev->txglomsz;
 	brcmf_bus_add_txhdrlen(bus->sdiodev->dev, bus->tx_hdrlen);
 
 done:
@@ -3630,11 +3785,20 @@ static int brcmf_sdio_bus_get_memdump(struct device *dev, void *data,
 	return err;
 }
 
+static void brcmf_sdio_queue_dpc(struct brcmf_sdio *bus)
+{
+	bus->dpc_queued_ns = ktime_get_ns();
+	if (bus->dpc_worker)
+		kthread_queue_work(bus->dpc_worker, &bus->dpc_kwork);
+	else
+		queue_work(bus->brcmf_wq, &bus->datawork);
+}
+
 void brcmf_sdio_trigger_dpc(struct brcmf_sdio *bus)
 {
 	if (!bus->dpc_triggered) {
 		bus->dpc_triggered = true;
-		queue_work(bus->brcmf_wq, &bus->datawork);
+		brcmf_sdio_queue_dpc(bus);
 	}
 }
 
@@ -3661,7 +3825,7 @@ void brcmf_sdio_isr(struct brcmf_sdio *bus, bool in_isr)
 		brcmf_err("isr w/o interrupt configured!\n");
 
 	bus->dpc_triggered = true;
-	queue_work(bus->brcmf_wq, &bus->datawork);
+	brcmf_sdio_queue_dpc(bus);
 }
 
 static void brcmf_sdio_bus_watchdog(struct brcmf_sdio *bus)
@@ -3698,7 +3862,7 @@ static void brcmf_sdio_bus_watchdog(struct brcmf_sdio *bus)
 				atomic_set(&bus->ipend, 1);
 
 				bus->dpc_triggered = true;
-				queue_work(bus->brcmf_wq, &bus->datawork);
+				brcmf_sdio_queue_dpc(bus);
 			}
 		}
 
@@ -3749,17 +3913,23 @@ static void brcmf_sdio_bus_watchdog(struct brcmf_sdio *bus)
 	}
 }
 
-static void brcmf_sdio_dataworker(struct work_struct *work)
+static void brcmf_sdio_dpc_loop(struct brcmf_sdio *bus)
 {
-	struct brcmf_sdio *bus = container_of(work, struct brcmf_sdio,
-					      datawork);
+	u64 queued = bus->dpc_queued_ns;
+	u64 start, end;
+	u32 iter = 0;
 
 	bus->dpc_running = true;
 	wmb();
 	while (READ_ONCE(bus->dpc_triggered)) {
 		bus->dpc_triggered = false;
+		start = ktime_get_ns();
 		brcmf_sdio_dpc(bus);
 		bus->idlecount = 0;
+		end = ktime_get_ns();
+		/* only the first pass waited to be scheduled */
+		trace_brcmf_sdio_dpc(iter++, start - queued, end - start);
+		queued = end;
 	}
 	bus->dpc_running = false;
 	if (brcmf_sdiod_freezing(bus->sdiodev)) {
@@ -3769,6 +3939,49 @@ static void brcmf_sdio_dataworker(struct work_struct *work)
 	}
 }
 
+static void brcmf_sdio_dataworker(struct work_struct *work)
+{
+	struct brcmf_sdio *bus = container_of(work, struct brcmf_sdio,
+					      datawork);
+
+	brcmf_sdio_dpc_loop(bus);
+}
+
+static void brcmf_sdio_dpc_kworker(struct kthread_work *work)
+{
+	struct brcmf_sdio *bus = container_of(work, struct brcmf_sdio,
+					      dpc_kwork);
+
+	brcmf_sdio_dpc_loop(bus);
+}
+
+static void brcmf_sdio_dpc_worker_start(struct brcmf_sdio *bus)
+{
+	struct brcmf_sdio_dev *sdiodev = bus->sdiodev;
+	struct kthread_worker *worker;
+	int cpu = sdiodev->settings->dpc_cpu;
+
+	worker = kthread_create_worker(0, "brcmf_dpc/%s",
+				       dev_name(&sdiodev->func1->dev));
+	if (IS_ERR(worker)) {
+		brcmf_err("brcmf_dpc thread failed to start, using workqueue\n");
+		return;
+	}
+
+	sched_set_fifo(worker->task);
+	/* keep the dpc on the cpu taking the MMC host interrupt */
+	if (cpu >= 0) {
+		if (cpu < nr_cpu_ids && cpu_online(cpu))
+			set_cpus_allowed_ptr(worker->task, cpumask_of(cpu));
+		else
+			brcmf_err("dpc_cpu %d is not online, not pinning\n",
+				  cpu);
+	}
+
+	kthread_init_work(&bus->dpc_kwork, brcmf_sdio_dpc_kworker);
+	bus->dpc_worker = worker;
+}
+
 static void
 brcmf_sdio_drivestrengthinit(struct brcmf_sdio_dev *sdiodev,
 			     struct brcmf_chip *ci, u32 drivestrength)
@@ -4464,6 +4677,8 @@ struct brcmf_sdio *brcmf_sdio_probe(struct brcmf_sdio_dev *sdiodev)
 	brcmf_sdiod_freezer_count(sdiodev);
 	INIT_WORK(&bus->datawork, brcmf_sdio_dataworker);
 	bus->brcmf_wq = wq;
+	if (sdiodev->settings->dpc_kthread)
+		brcmf_sdio_dpc_worker_start(bus);
 
 	/* attempt to attach to the dongle */
 	if (!(brcmf_sdio_probe_attach(bus))) {
@@ -4563,6 +4778,10 @@ void brcmf_sdio_remove(struct brcmf_sdio *bus)
 		cancel_work_sync(&bus->datawork);
 		if (bus->brcmf_wq)
 			destroy_workqueue(bus->brcmf_wq);
+		if (bus->dpc_worker) {
+			kthread_cancel_work_sync(&bus->dpc_kwork);
+			kthread_destroy_worker(bus->dpc_worker);
+		}
 
 		if (bus->ci) {
 			if (bus->sdiodev->state != BRCMF_SDIOD_NOMEDIUM) {
@@ -127,6 +127,23 @@ TRACE_EVENT(brcmf_sdpcm_hdr,
 		  __entry->len, ((u8 *)__get_dynamic_array(hdr))[4])
 );
 
+TRACE_EVENT(brcmf_sdio_dpc,
+	TP_PROTO(u32 iter, u64 wait_ns, u64 run_ns),
+	TP_ARGS(iter, wait_ns, run_ns),
+	TP_STRUCT__entry(
+		__field(u32, iter)
+		__field(u64, wait_ns)
+		__field(u64, run_ns)
+	),
+	TP_fast_assign(
+		__entry->iter = iter;
+		__entry->wait_ns = wait_ns;
+		__entry->run_ns = run_ns;
+	),
+	TP_printk("dpc: iter %u wait %llu ns run %llu ns",
+		  __entry->iter, __entry->wait_ns, __entry->run_ns)
+);
+
 #ifdef CONFIG_BRCM_TRACING
 
 #undef TRACE_INCLUDE_PATH
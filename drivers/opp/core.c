@@ -755,6 +755,8 @@ static int _generic_set_opp_regulator(struct opp_table *opp_table,
 {
 	struct regulator *reg = opp_table->regulators[0];
 	struct dev_pm_opp *old_opp = opp_table->current_opp;
+	bool same_volt;
+	u64 start;
 	int ret;
 
 	/* This function only supports single regulator per device */
@@ -763,23 +765,38 @@ static int _generic_set_opp_regulator(struct opp_table *opp_table,
 		return -EINVAL;
 	}
 
+	/*
+	 * OPPs sharing a voltage are common for CPUs, don't go through the
+	 * regulator framework at all when switching between them.
+	 */
+	same_volt = opp_table->enabled &&
+		    old_opp->supplies[0].u_volt == opp->supplies[0].u_volt &&
+		    old_opp->supplies[0].u_volt_min == opp->supplies[0].u_volt_min &&
+		    old_opp->supplies[0].u_volt_max == opp->supplies[0].u_volt_max;
+
 	/* Scaling up? Scale voltage before frequency */
-	if (!scaling_down) {
+	if (!scaling_down && !same_volt) {
+		start = ktime_get_ns();
 		ret = _set_opp_voltage(dev, reg, opp->supplies);
 		if (ret)
 			goto restore_voltage;
+		opp_switch_time(opp_table, volt, start);
 	}
 
 	/* Change frequency */
+	start = ktime_get_ns();
 	ret = _generic_set_opp_clk_only(dev, opp_table->clk, freq);
 	if (ret)
 		goto restore_voltage;
+	opp_switch_time(opp_table, clk, start);
 
 	/* Scaling down? Scale voltage after frequency */
-	if (scaling_down) {
+	if (scaling_down && !same_volt) {
+		start = ktime_get_ns();
 		ret = _set_opp_voltage(dev, reg, opp->supplies);
 		if (ret)
 			goto restore_freq;
+		opp_switch_time(opp_table, volt, start);
 	}
 
 	/*
@@ -1045,7 +1062,11 @@ static int _set_opp(struct device *dev, struct opp_table *opp_table,
 						 scaling_down);
 	} else {
 		/* Only frequency scaling */
+		u64 start = ktime_get_ns();
+
 		ret = _generic_set_opp_clk_only(dev, opp_table->clk, freq);
+		if (!ret)
+			opp_switch_time(opp_table, clk, start);
 	}
 
 	if (ret)
@@ -147,6 +147,27 @@ void opp_debug_create_one(struct dev_pm_opp *opp, struct opp_table *opp_table)
 	opp->dentry = d;
 }
 
+void opp_debug_switch_time(struct opp_switch_stats *stats, u64 start_ns)
+{
+	u64 delta = ktime_get_ns() - start_ns;
+
+	stats->count++;
+	stats->total_ns += delta;
+	if (delta > stats->max_ns)
+		stats->max_ns = delta;
+}
+
+static void opp_debug_create_switch_stats(const char *name,
+					  struct opp_switch_stats *stats,
+					  struct dentry *pdentry)
+{
+	struct dentry *d = debugfs_create_dir(name, pdentry);
+
+	debugfs_create_u64("count", S_IRUGO, d, &stats->count);
+	debugfs_create_u64("total_ns", S_IRUGO, d, &stats->total_ns);
+	debugfs_create_u64("max_ns", S_IRUGO, d, &stats->max_ns);
+}
+
 static void opp_list_debug_create_dir(struct opp_device *opp_dev,
 				      struct opp_table *opp_table)
 {
@@ -158,6 +179,9 @@ static void opp_list_debug_create_dir(struct opp_device *opp_dev,
 	/* Create device specific directory */
 	d = debugfs_create_dir(opp_table->dentry_name, rootdir);
 
+	opp_debug_create_switch_stats("switch_voltage", &opp_table->volt_stats, d);
+	opp_debug_create_switch_stats("switch_clock", &opp_table->clk_stats, d);
+
 	opp_dev->dentry = d;
 	opp_table->dentry = d;
 }
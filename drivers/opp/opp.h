@@ -19,6 +19,7 @@
 #include <linux/limits.h>
 #include <linux/pm_opp.h>
 #include <linux/notifier.h>
+#include <linux/timekeeping.h>
 
 struct clk;
 struct regulator;
@@ -124,6 +125,18 @@ enum opp_table_access {
 	OPP_TABLE_ACCESS_SHARED = 2,
 };
 
+/**
+ * struct opp_switch_stats - Time spent in one phase of OPP transitions
+ * @count:	Number of times the phase was executed
+ * @total_ns:	Total time spent in it
+ * @max_ns:	Longest single execution
+ */
+struct opp_switch_stats {
+	u64 count;
+	u64 total_ns;
+	u64 max_ns;
+};
+
 /**
  * struct opp_table - Device opp structure
  * @node:	table node - contains the devices with OPPs that
@@ -164,6 +177,8 @@ enum opp_table_access {
  * @set_opp_data: Data to be passed to set_opp callback
  * @dentry:	debugfs dentry pointer of the real device directory (not links).
  * @dentry_name: Name of the real dentry.
+ * @volt_stats: Time spent in regulator updates of OPP transitions.
+ * @clk_stats: Time spent in clock rate changes of OPP transitions.
  *
  * @voltage_tolerance_v1: In percentage, for v1 bindings only.
  *
@@ -216,6 +231,8 @@ struct opp_table {
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *dentry;
 	char dentry_name[NAME_MAX];
+	struct opp_switch_stats volt_stats;
+	struct opp_switch_stats clk_stats;
 #endif
 };
 
@@ -257,6 +274,7 @@ static inline void _of_opp_free_required_opps(struct opp_table *opp_table,
 
 #ifdef CONFIG_DEBUG_FS
 void opp_debug_remove_one(struct dev_pm_opp *opp);
+void opp_debug_switch_time(struct opp_switch_stats *stats, u64 start_ns);
 void opp_debug_create_one(struct dev_pm_opp *opp, struct opp_table *opp_table);
 void opp_debug_register(struct opp_device *opp_dev, struct opp_table *opp_table);
 void opp_debug_unregister(struct opp_device *opp_dev, struct opp_table *opp_table);
@@ -274,4 +292,12 @@ static inline void opp_debug_unregister(struct opp_device *opp_dev,
 { }
 #endif		/* DEBUG_FS */
 
+/* Account the time since @start_ns to one phase of an OPP transition */
+#ifdef CONFIG_DEBUG_FS
+#define opp_switch_time(opp_table, phase, start_ns)			\
+	opp_debug_switch_time(&(opp_table)->phase##_stats, start_ns)
+#else
+#define opp_switch_time(opp_table, phase, start_ns)	((void)(start_ns))
+#endif
+
 #endif		/* __DRIVER_OPP_H__ */
@@ -582,6 +582,45 @@ static int samsung_gpio_get(struct gpio_chip *gc, unsigned offset)
 	return data;
 }
 
+/*
+ * gpiolib set_multiple callback function. All lines of a bank share one data
+ * register, so the whole update is a single read-modify-write under the lock.
+ */
+static void samsung_gpio_set_multiple(struct gpio_chip *gc,
+				      unsigned long *mask, unsigned long *bits)
+{
+	struct samsung_pin_bank *bank = gpiochip_get_data(gc);
+	const struct samsung_pin_bank_type *type = bank->type;
+	unsigned long flags;
+	void __iomem *reg;
+	u32 data;
+
+	reg = bank->pctl_base + bank->pctl_offset
+			+ type->reg_offset[PINCFG_TYPE_DAT];
+
+	raw_spin_lock_irqsave(&bank->slock, flags);
+	data = readl(reg);
+	data &= ~*mask;
+	data |= *bits & *mask;
+	writel(data, reg);
+	raw_spin_unlock_irqrestore(&bank->slock, flags);
+}
+
+/* gpiolib get_multiple callback function */
+static int samsung_gpio_get_multiple(struct gpio_chip *gc,
+				     unsigned long *mask, unsigned long *bits)
+{
+	struct samsung_pin_bank *bank = gpiochip_get_data(gc);
+	const struct samsung_pin_bank_type *type = bank->type;
+	u32 data;
+
+	data = readl(bank->pctl_base + bank->pctl_offset
+			+ type->reg_offset[PINCFG_TYPE_DAT]);
+	*bits &= ~*mask;
+	*bits |= data & *mask;
+	return 0;
+}
+
 /*
  * The samsung_gpio_set_direction() should be called with "bank->slock" held
  * to avoid race condition.
@@ -944,6 +983,8 @@ static const struct gpio_chip samsung_gpiolib_chip = {
 	.free = gpiochip_generic_free,
 	.set = samsung_gpio_set,
 	.get = samsung_gpio_get,
+	.set_multiple = samsung_gpio_set_multiple,
+	.get_multiple = samsung_gpio_get_multiple,
 	.direction_input = samsung_gpio_direction_input,
 	.direction_output = samsung_gpio_direction_output,
 	.to_irq = samsung_gpio_to_irq,
@@ -73,6 +73,34 @@ static int exynos_pd_power_off(struct generic_pm_domain *domain)
 	return exynos_pd_power(domain, false);
 }
 
+/*
+ * Devices in different domains do not depend on each other through the
+ * domain, so let the PM core resume them asynchronously and the domains
+ * power up in parallel.  Ordering against parents and against suppliers
+ * of device links is still enforced by dpm_wait_for_superior().
+ *
+ * The device's own setting is kept in its otherwise unused genpd data and
+ * put back on detach.
+ */
+static int exynos_pd_attach_dev(struct generic_pm_domain *domain,
+				struct device *dev)
+{
+	struct generic_pm_domain_data *gpd_data = dev_gpd_data(dev);
+
+	gpd_data->data = (void *)(unsigned long)device_async_suspend_enabled(dev);
+	device_enable_async_suspend(dev);
+	return 0;
+}
+
+static void exynos_pd_detach_dev(struct generic_pm_domain *domain,
+				 struct device *dev)
+{
+	struct generic_pm_domain_data *gpd_data = dev_gpd_data(dev);
+
+	if (!gpd_data->data)
+		device_disable_async_suspend(dev);
+}
+
 static const struct exynos_pm_domain_config exynos4210_cfg = {
 	.local_pwr_cfg		= 0x7,
 };
@@ -127,6 +155,8 @@ static int exynos_pd_probe(struct platform_device *pdev)
 
 	pd->pd.power_off = exynos_pd_power_off;
 	pd->pd.power_on = exynos_pd_power_on;
+	pd->pd.attach_dev = exynos_pd_attach_dev;
+	pd->pd.detach_dev = exynos_pd_detach_dev;
 	pd->local_pwr_cfg = pm_domain_cfg->local_pwr_cfg;
 
 	on = readl_relaxed(pd->base + 0x4) & pd->local_pwr_cfg;
@@ -147,6 +177,7 @@ static int exynos_pd_probe(struct platform_device *pdev)
 				parent.np, child.np);
 	}
 
+	device_enable_async_suspend(dev);
 	pm_runtime_enable(dev);
 	return ret;
 }
@@ -124,6 +124,10 @@
 
 #define MCELSIUS	1000
 
+/* Range of temperatures a trip window boundary can be programmed to */
+#define EXYNOS_TMU_WINDOW_MIN_TEMP	0
+#define EXYNOS_TMU_WINDOW_MAX_TEMP	125
+
 enum soc_type {
 	SOC_ARCH_EXYNOS3250 = 1,
 	SOC_ARCH_EXYNOS4210,
@@ -165,8 +169,14 @@ enum soc_type {
  * @tzd: pointer to thermal_zone_device structure
  * @ntrip: number of supported trip points.
  * @enabled: current status of TMU device
+ * @window_low: lower bound of the trip window in millicelsius, -INT_MAX
+ *	if unbounded
+ * @window_high: upper bound of the trip window in millicelsius, INT_MAX
+ *	if unbounded
  * @tmu_set_trip_temp: SoC specific method to set trip (rising threshold)
  * @tmu_set_trip_hyst: SoC specific to set hysteresis (falling threshold)
+ * @tmu_set_window: SoC specific method to program the trip window, NULL if
+ *	the TMU cannot track one
  * @tmu_initialize: SoC specific TMU initialization method
  * @tmu_control: SoC specific TMU control method
  * @tmu_read: SoC specific TMU temperature read method
@@ -193,11 +203,13 @@ struct exynos_tmu_data {
 	struct thermal_zone_device *tzd;
 	unsigned int ntrip;
 	bool enabled;
+	int window_low, window_high;
 
 	void (*tmu_set_trip_temp)(struct exynos_tmu_data *data, int trip,
 				 u8 temp);
 	void (*tmu_set_trip_hyst)(struct exynos_tmu_data *data, int trip,
 				 u8 temp, u8 hyst);
+	void (*tmu_set_window)(struct exynos_tmu_data *data);
 	void (*tmu_initialize)(struct platform_device *pdev);
 	void (*tmu_control)(struct platform_device *pdev, bool on);
 	int (*tmu_read)(struct exynos_tmu_data *data);
@@ -419,6 +431,42 @@ static void exynos4412_tmu_set_trip_hyst(struct exynos_tmu_data *data,
 	writel(th, data->base + EXYNOS_THD_TEMP_FALL);
 }
 
+static u8 exynos_tmu_window_code(struct exynos_tmu_data *data, int temp)
+{
+	temp = clamp_val(temp / MCELSIUS, EXYNOS_TMU_WINDOW_MIN_TEMP,
+			 EXYNOS_TMU_WINDOW_MAX_TEMP);
+
+	return temp_to_code(data, temp);
+}
+
+/*
+ * The trip window lives in rising threshold 0 and falling threshold 0, the
+ * only interrupts left enabled.  The remaining thresholds keep the values
+ * programmed from the trip points, so the thermal trip on threshold 3 is
+ * still armed in hardware.
+ */
+static void exynos4412_tmu_set_window(struct exynos_tmu_data *data)
+{
+	u32 rise, fall, interrupt_en = 0;
+
+	rise = readl(data->base + EXYNOS_THD_TEMP_RISE) & ~0xff;
+	fall = readl(data->base + EXYNOS_THD_TEMP_FALL) & ~0xff;
+
+	if (data->window_high < INT_MAX) {
+		rise |= exynos_tmu_window_code(data, data->window_high);
+		interrupt_en |= 1 << EXYNOS_TMU_INTEN_RISE0_SHIFT;
+	}
+
+	if (data->window_low > -INT_MAX) {
+		fall |= exynos_tmu_window_code(data, data->window_low);
+		interrupt_en |= 1 << EXYNOS_TMU_INTEN_FALL0_SHIFT;
+	}
+
+	writel(rise, data->base + EXYNOS_THD_TEMP_RISE);
+	writel(fall, data->base + EXYNOS_THD_TEMP_FALL);
+	writel(interrupt_en, data->base + EXYNOS_TMU_REG_INTEN);
+}
+
 static void exynos4412_tmu_initialize(struct platform_device *pdev)
 {
 	struct exynos_tmu_data *data = platform_get_drvdata(pdev);
@@ -567,7 +615,7 @@ static void exynos4210_tmu_control(struct platform_device *pdev, bool on)
 	con = get_con_reg(data, readl(data->base + EXYNOS_TMU_REG_CONTROL));
 
 	if (on) {
-		for (i = 0; i < data->ntrip; i++) {
+		for (i = 0; i < data->ntrip && !data->tmu_set_window; i++) {
 			if (!of_thermal_is_trip_valid(tz, i))
 				continue;
 
@@ -586,6 +634,10 @@ static void exynos4210_tmu_control(struct platform_device *pdev, bool on)
 
 	writel(interrupt_en, data->base + EXYNOS_TMU_REG_INTEN);
 	writel(con, data->base + EXYNOS_TMU_REG_CONTROL);
+
+	/* Restore the last window, the thresholds were just reinitialized */
+	if (on && data->tmu_set_window)
+		data->tmu_set_window(data);
 }
 
 static void exynos5433_tmu_control(struct platform_device *pdev, bool on)
@@ -679,6 +731,28 @@ static int exynos_get_temp(void *p, int *temp)
 	return ret;
 }
 
+static int exynos_set_trips(void *p, int low, int high)
+{
+	struct exynos_tmu_data *data = p;
+
+	mutex_lock(&data->lock);
+	data->window_low = low;
+	data->window_high = high;
+
+	/*
+	 * Before exynos_tmu_control() the thresholds are still to be
+	 * initialized; the window is programmed once the TMU is enabled.
+	 */
+	if (data->enabled) {
+		clk_enable(data->clk);
+		data->tmu_set_window(data);
+		clk_disable(data->clk);
+	}
+	mutex_unlock(&data->lock);
+
+	return 0;
+}
+
 #ifdef CONFIG_THERMAL_EMULATION
 static u32 get_emul_con_reg(struct exynos_tmu_data *data, unsigned int val,
 			    int temp)
@@ -778,16 +852,20 @@ static void exynos_tmu_work(struct work_struct *work)
 	struct exynos_tmu_data *data = container_of(work,
 			struct exynos_tmu_data, irq_work);
 
-	thermal_zone_device_update(data->tzd, THERMAL_EVENT_UNSPECIFIED);
-
 	mutex_lock(&data->lock);
 	clk_enable(data->clk);
 
-	/* TODO: take action based on particular interrupt */
+	/*
+	 * Clear before the update: if the new window is already crossed by
+	 * the time it is programmed, the interrupt is raised again rather
+	 * than cleared away unseen.
+	 */
 	data->tmu_clear_irqs(data);
 
 	clk_disable(data->clk);
 	mutex_unlock(&data->lock);
+
+	thermal_zone_device_update(data->tzd, THERMAL_EVENT_UNSPECIFIED);
 	enable_irq(data->irq);
 }
 
@@ -919,6 +997,7 @@ static int exynos_map_dt_data(struct platform_device *pdev)
 	case SOC_ARCH_EXYNOS5420_TRIMINFO:
 		data->tmu_set_trip_temp = exynos4412_tmu_set_trip_temp;
 		data->tmu_set_trip_hyst = exynos4412_tmu_set_trip_hyst;
+		data->tmu_set_window = exynos4412_tmu_set_window;
 		data->tmu_initialize = exynos4412_tmu_initialize;
 		data->tmu_control = exynos4210_tmu_control;
 		data->tmu_read = exynos4412_tmu_read;
@@ -1002,6 +1081,12 @@ static const struct thermal_zone_of_device_ops exynos_sensor_ops = {
 	.set_emul_temp = exynos_tmu_set_emulation,
 };
 
+static const struct thermal_zone_of_device_ops exynos_sensor_window_ops = {
+	.get_temp = exynos_get_temp,
+	.set_trips = exynos_set_trips,
+	.set_emul_temp = exynos_tmu_set_emulation,
+};
+
 static int exynos_tmu_probe(struct platform_device *pdev)
 {
 	struct exynos_tmu_data *data;
@@ -1014,6 +1099,8 @@ static int exynos_tmu_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, data);
 	mutex_init(&data->lock);
+	data->window_low = -INT_MAX;
+	data->window_high = INT_MAX;
 
 	/*
 	 * Try enabling the regulator if found
@@ -1092,7 +1179,8 @@ static int exynos_tmu_probe(struct platform_device *pdev)
 	 * requesting irq and calling exynos_tmu_control().
 	 */
 	data->tzd = thermal_zone_of_sensor_register(&pdev->dev, 0, data,
-						    &exynos_sensor_ops);
+			data->tmu_set_window ? &exynos_sensor_window_ops :
+					       &exynos_sensor_ops);
 	if (IS_ERR(data->tzd)) {
 		ret = PTR_ERR(data->tzd);
 		if (ret != -EPROBE_DEFER)
@@ -1101,6 +1189,18 @@ static int exynos_tmu_probe(struct platform_device *pdev)
 		goto err_sclk;
 	}
 
+	/*
+	 * With a trip window every crossing raises an interrupt, so the zone
+	 * need not be polled, whatever the device tree delay says. The passive
+	 * delay stays, as the governors re-evaluate cooling at that pace while
+	 * a passive trip is crossed.
+	 */
+	if (data->tmu_set_window) {
+		mutex_lock(&data->tzd->lock);
+		data->tzd->polling_delay_jiffies = 0;
+		mutex_unlock(&data->tzd->lock);
+	}
+
 	ret = exynos_tmu_initialize(pdev);
 	if (ret) {
 		dev_err(&pdev->dev, "Failed to initialize TMU\n");
@@ -1115,6 +1215,11 @@ static int exynos_tmu_probe(struct platform_device *pdev)
 	}
 
 	exynos_tmu_control(pdev, true);
+
+	/* The first update came too early to program a window, redo it */
+	if (data->tmu_set_window)
+		thermal_zone_device_update(data->tzd,
+					   THERMAL_EVENT_UNSPECIFIED);
 	return 0;
 
 err_thermal:
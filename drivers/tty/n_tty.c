@@ -1492,20 +1492,34 @@ n_tty_receive_buf_real_raw(struct tty_struct *tty, const unsigned char *cp,
 	ldata->read_head += n;
 }
 
+/*
+ * Runs of TTY_NORMAL characters need no processing in raw mode and are
+ * copied in bulk, only flagged characters are handled one at a time.
+ */
 static void
 n_tty_receive_buf_raw(struct tty_struct *tty, const unsigned char *cp,
 		      const char *fp, int count)
 {
-	struct n_tty_data *ldata = tty->disc_data;
-	char flag = TTY_NORMAL;
+	const char *flagged;
+	int n;
 
-	while (count--) {
-		if (fp)
-			flag = *fp++;
-		if (likely(flag == TTY_NORMAL))
-			put_tty_queue(*cp++, ldata);
-		else
-			n_tty_receive_char_flagged(tty, *cp++, flag);
+	while (count) {
+		n = count;
+		if (fp) {
+			flagged = memchr_inv(fp, TTY_NORMAL, count);
+			if (flagged)
+				n = flagged - fp;
+		}
+		if (n) {
+			n_tty_receive_buf_real_raw(tty, cp, NULL, n);
+			cp += n;
+			count -= n;
+			if (fp)
+				fp += n;
+			continue;
+		}
+		n_tty_receive_char_flagged(tty, *cp++, *fp++);
+		count--;
 	}
 }
 
@@ -5,6 +5,7 @@
 
 #include <linux/types.h>
 #include <linux/errno.h>
+#include <linux/ktime.h>
 #include <linux/tty.h>
 #include <linux/tty_driver.h>
 #include <linux/tty_flip.h>
@@ -491,9 +492,19 @@ static void flush_to_ldisc(struct work_struct *work)
 {
 	struct tty_port *port = container_of(work, struct tty_port, buf.work);
 	struct tty_bufhead *buf = &port->buf;
+	u32 stamp, lat;
 
 	mutex_lock(&buf->lock);
 
+	stamp = xchg(&buf->push_stamp, 0);
+	if (stamp) {
+		lat = (u32)ktime_get_ns() - stamp;
+		buf->flushes++;
+		buf->flush_lat_total += lat;
+		if (lat > buf->flush_lat_max)
+			buf->flush_lat_max = lat;
+	}
+
 	while (1) {
 		struct tty_buffer *head = buf->head;
 		struct tty_buffer *next;
@@ -533,6 +544,17 @@ static void flush_to_ldisc(struct work_struct *work)
 
 }
 
+/*
+ * Remember when the oldest data still waiting for flush_to_ldisc() was
+ * pushed, for the push to flush latency statistics.  Only the low 32 bits
+ * of the timestamp are kept so that they can be updated atomically.
+ */
+static inline void tty_buffer_queue_push(struct tty_bufhead *buf)
+{
+	cmpxchg(&buf->push_stamp, 0, (u32)ktime_get_ns() | 1);
+	queue_work(system_unbound_wq, &buf->work);
+}
+
 static inline void tty_flip_buffer_commit(struct tty_buffer *tail)
 {
 	/*
@@ -558,7 +580,7 @@ void tty_flip_buffer_push(struct tty_port *port)
 	struct tty_bufhead *buf = &port->buf;
 
 	tty_flip_buffer_commit(buf->tail);
-	queue_work(system_unbound_wq, &buf->work);
+	tty_buffer_queue_push(buf);
 }
 EXPORT_SYMBOL(tty_flip_buffer_push);
 
@@ -588,7 +610,7 @@ int tty_insert_flip_string_and_push_buffer(struct tty_port *port,
 		tty_flip_buffer_commit(buf->tail);
 	spin_unlock_irqrestore(&port->lock, flags);
 
-	queue_work(system_unbound_wq, &buf->work);
+	tty_buffer_queue_push(buf);
 
 	return size;
 }
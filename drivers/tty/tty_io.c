@@ -3539,12 +3539,58 @@ static char *tty_devnode(struct device *dev, umode_t *mode)
 	return NULL;
 }
 
+/*
+ * Flip buffer push to flush_to_ldisc() latency of the port behind a tty
+ * device: number of flushes, average and maximum latency in microseconds.
+ */
+static ssize_t rx_flush_latency_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct tty_driver *driver;
+	struct tty_port *port = NULL;
+	unsigned long flushes = 0;
+	u64 total = 0;
+	u32 max = 0;
+	int index;
+
+	mutex_lock(&tty_mutex);
+	driver = get_tty_driver(dev->devt, &index);
+	if (driver && driver->ports)
+		port = driver->ports[index];
+	if (port) {
+		flushes = port->buf.flushes;
+		total = port->buf.flush_lat_total;
+		max = port->buf.flush_lat_max;
+	}
+	mutex_unlock(&tty_mutex);
+	if (driver)
+		tty_driver_kref_put(driver);
+
+	if (!port)
+		return -ENODEV;
+
+	if (flushes)
+		total = div_u64(div64_ul(total, flushes), NSEC_PER_USEC);
+
+	return sysfs_emit(buf, "%lu %llu %u\n", flushes, total,
+			  max / NSEC_PER_USEC);
+}
+static DEVICE_ATTR_RO(rx_flush_latency);
+
+static struct attribute *tty_dev_attrs[] = {
+	&dev_attr_rx_flush_latency.attr,
+	NULL
+};
+
+ATTRIBUTE_GROUPS(tty_dev);
+
 static int __init tty_class_init(void)
 {
 	tty_class = class_create(THIS_MODULE, "tty");
 	if (IS_ERR(tty_class))
 		return PTR_ERR(tty_class);
 	tty_class->devnode = tty_devnode;
+	tty_class->dev_groups = tty_dev_groups;
 	return 0;
 }
 
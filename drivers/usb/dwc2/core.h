@@ -128,6 +128,8 @@ struct dwc2_hsotg_req;
  * @desc_count: Count of entries within the DMA descriptor chain of EP.
  * @next_desc: index of next free descriptor in the ISOC chain under SW control.
  * @compl_desc: index of next descriptor to be completed by xFerComplete
+ * @chain_reqs: Number of requests loaded onto the descriptor chain behind
+ *              @req (bulk IN in descriptor DMA mode only).
  * @total_data: The total number of data bytes done.
  * @fifo_size: The size of the FIFO (for periodic IN endpoints)
  * @fifo_index: For Dedicated FIFO operation, only FIFO0 can be used for EP0.
@@ -184,6 +186,7 @@ struct dwc2_hsotg_ep {
 
 	unsigned int		next_desc;
 	unsigned int		compl_desc;
+	unsigned int		chain_reqs;
 
 	char                    name[10];
 };
@@ -193,11 +196,16 @@ struct dwc2_hsotg_ep {
  * @req: The USB gadget request
  * @queue: The list of requests for the endpoint this is queued for.
  * @saved_req_buf: variable to save req.buf when bounce buffers are used.
+ * @desc_start: Index of the first descriptor of a chained request.
+ * @desc_count: Number of descriptors of a chained request, 0 if the
+ *              request is not on the endpoint's descriptor chain.
  */
 struct dwc2_hsotg_req {
 	struct usb_request      req;
 	struct list_head        queue;
 	void *saved_req_buf;
+	u8 desc_start;
+	u8 desc_count;
 };
 
 #if IS_ENABLED(CONFIG_USB_DWC2_PERIPHERAL) || \
@@ -425,6 +433,11 @@ enum dwc2_ep0_state {
  *			1 - Activate the external level detection
  * @g_dma:              Enables gadget dma usage (default: autodetect).
  * @g_dma_desc:         Enables gadget descriptor DMA (default: autodetect).
+ * @g_ddma_chain_ioc:   In descriptor DMA mode, chain queued bulk IN requests
+ *			onto one descriptor list and only interrupt once
+ *			every this many requests.
+ *			0 - Start and complete requests one by one
+ *			4 - (default)
  * @g_rx_fifo_size:	The periodic rx fifo size for the device, in
  *			DWORDS from 16-32768 (default: 2048 if
  *			possible, otherwise autodetect).
@@ -442,6 +455,16 @@ enum dwc2_ep0_state {
  *                      back to DWC2_SPEED_PARAM_HIGH while device is gone.
  *			0 - No (default)
  *			1 - Yes
+ * @host_nak_holdoff_naks: Number of consecutive NAKs on a split transfer
+ *                      before the endpoint is held off instead of being
+ *                      retried from the interrupt handler.
+ *                      0 disables the holdoff (default: 3).
+ * @host_bulk_nak_holdoff_naks: Same as host_nak_holdoff_naks, for non-split
+ *                      bulk transfers restarted by software (Slave mode,
+ *                      and OUT in DMA mode).
+ *                      0 disables the holdoff (default: 0).
+ * @host_nak_holdoff_us: How long a NAKing endpoint is held off, in
+ *                      microseconds (default: 1000).
  * @service_interval:   Enable service interval based scheduling.
  *                      0 - No
  *                      1 - Yes
@@ -516,10 +539,14 @@ struct dwc2_core_params {
 	u16 host_rx_fifo_size;
 	u16 host_nperio_tx_fifo_size;
 	u16 host_perio_tx_fifo_size;
+	u16 host_nak_holdoff_naks;
+	u16 host_bulk_nak_holdoff_naks;
+	u32 host_nak_holdoff_us;
 
 	/* Gadget parameters */
 	bool g_dma;
 	bool g_dma_desc;
+	u16 g_ddma_chain_ioc;
 	u32 g_rx_fifo_size;
 	u32 g_np_tx_fifo_size;
 	u32 g_tx_fifo_size[MAX_EPS_CHANNELS];
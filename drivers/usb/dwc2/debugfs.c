@@ -13,6 +13,7 @@
 
 #include "core.h"
 #include "debug.h"
+#include "hcd.h"
 
 #if IS_ENABLED(CONFIG_USB_DWC2_PERIPHERAL) || \
 	IS_ENABLED(CONFIG_USB_DWC2_DUAL_ROLE)
@@ -322,6 +323,83 @@ static void dwc2_hsotg_create_debug(struct dwc2_hsotg *hsotg)
 static inline void dwc2_hsotg_create_debug(struct dwc2_hsotg *hsotg) {}
 #endif
 
+#if IS_ENABLED(CONFIG_USB_DWC2_HOST) || IS_ENABLED(CONFIG_USB_DWC2_DUAL_ROLE)
+static void ep_irqs_show_list(struct seq_file *seq, const char *name,
+			      struct list_head *list)
+{
+	struct dwc2_qh *qh;
+
+	list_for_each_entry(qh, list, qh_list_entry) {
+		struct dwc2_qtd *qtd;
+		int addr = -1, epnum = -1;
+
+		qtd = list_first_entry_or_null(&qh->qtd_list, struct dwc2_qtd,
+					       qtd_list_entry);
+		if (qtd && qtd->urb) {
+			addr = dwc2_hcd_get_dev_addr(&qtd->urb->pipe_info);
+			epnum = dwc2_hcd_get_ep_num(&qtd->urb->pipe_info);
+		}
+
+		seq_printf(seq, "%-28s %4d %3d %-7s %-3s %10lu %10lu %10lu\n",
+			   name, addr, epnum,
+			   usb_ep_type_string(qh->ep_type),
+			   qh->ep_is_in ? "in" : "out",
+			   qh->nr_chan_irqs, qh->nr_naks, qh->nr_holdoffs);
+	}
+}
+
+/**
+ * ep_irqs_show - debugfs: show per-endpoint host channel interrupt counts
+ * @seq: The seq_file to write to.
+ * @v: Unused parameter.
+ *
+ * Walk every host schedule list and print, for each queue head, the
+ * number of channel interrupts, NAKs and NAK holdoffs seen so far. Address
+ * and endpoint are taken from the first queued transfer, -1 if none.
+ */
+static int ep_irqs_show(struct seq_file *seq, void *v)
+{
+	struct dwc2_hsotg *hsotg = seq->private;
+	unsigned long flags;
+
+	seq_printf(seq, "%-28s %4s %3s %-7s %-3s %10s %10s %10s\n",
+		   "list", "addr", "ep", "type", "dir",
+		   "chan_irqs", "naks", "holdoffs");
+
+	spin_lock_irqsave(&hsotg->lock, flags);
+	ep_irqs_show_list(seq, "non_periodic_sched_inactive",
+			  &hsotg->non_periodic_sched_inactive);
+	ep_irqs_show_list(seq, "non_periodic_sched_waiting",
+			  &hsotg->non_periodic_sched_waiting);
+	ep_irqs_show_list(seq, "non_periodic_sched_active",
+			  &hsotg->non_periodic_sched_active);
+	ep_irqs_show_list(seq, "periodic_sched_inactive",
+			  &hsotg->periodic_sched_inactive);
+	ep_irqs_show_list(seq, "periodic_sched_ready",
+			  &hsotg->periodic_sched_ready);
+	ep_irqs_show_list(seq, "periodic_sched_assigned",
+			  &hsotg->periodic_sched_assigned);
+	ep_irqs_show_list(seq, "periodic_sched_queued",
+			  &hsotg->periodic_sched_queued);
+	spin_unlock_irqrestore(&hsotg->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ep_irqs);
+
+static void dwc2_hcd_create_debug(struct dwc2_hsotg *hsotg)
+{
+	/* The schedule lists are only set up by dwc2_hcd_init() */
+	if (hsotg->dr_mode == USB_DR_MODE_PERIPHERAL)
+		return;
+
+	debugfs_create_file("ep_irqs", 0444, hsotg->debug_root, hsotg,
+			    &ep_irqs_fops);
+}
+#else
+static inline void dwc2_hcd_create_debug(struct dwc2_hsotg *hsotg) {}
+#endif
+
 /* dwc2_hsotg_delete_debug is removed as cleanup in done in dwc2_debugfs_exit */
 
 #define dump_register(nm)	\
@@ -679,6 +757,9 @@ static int params_show(struct seq_file *seq, void *v)
 	print_param(seq, p, host_rx_fifo_size);
 	print_param(seq, p, host_nperio_tx_fifo_size);
 	print_param(seq, p, host_perio_tx_fifo_size);
+	print_param(seq, p, host_nak_holdoff_naks);
+	print_param(seq, p, host_bulk_nak_holdoff_naks);
+	print_param(seq, p, host_nak_holdoff_us);
 	print_param(seq, p, max_transfer_size);
 	print_param(seq, p, max_packet_count);
 	print_param(seq, p, host_channels);
@@ -708,6 +789,7 @@ static int params_show(struct seq_file *seq, void *v)
 	print_param(seq, p, host_dma);
 	print_param(seq, p, g_dma);
 	print_param(seq, p, g_dma_desc);
+	print_param(seq, p, g_ddma_chain_ioc);
 	print_param(seq, p, g_rx_fifo_size);
 	print_param(seq, p, g_np_tx_fifo_size);
 
@@ -783,6 +865,9 @@ int dwc2_debugfs_init(struct dwc2_hsotg *hsotg)
 	/* Add gadget debugfs nodes */
 	dwc2_hsotg_create_debug(hsotg);
 
+	/* Add host debugfs nodes */
+	dwc2_hcd_create_debug(hsotg);
+
 	hsotg->regset = devm_kzalloc(hsotg->dev, sizeof(*hsotg->regset),
 								GFP_KERNEL);
 	if (!hsotg->regset) {
@@ -434,6 +434,9 @@ static void dwc2_hsotg_unmap_dma(struct dwc2_hsotg *hsotg,
 {
 	struct usb_request *req = &hs_req->req;
 
+	if (req->sg_was_mapped)
+		return;
+
 	usb_gadget_unmap_request(&hsotg->gadget, req, hs_ep->map_dir);
 }
 
@@ -888,7 +891,7 @@ static void dwc2_gadget_config_nonisoc_xfer_ddma(struct dwc2_hsotg_ep *hs_ep,
 	/* DMA sg buffer */
 	for_each_sg(ureq->sg, sg, ureq->num_mapped_sgs, i) {
 		dwc2_gadget_fill_nonisoc_xfer_ddma_one(hs_ep, &desc,
-			sg_dma_address(sg) + sg->offset, sg_dma_len(sg),
+			sg_dma_address(sg), sg_dma_len(sg),
 			(i == (ureq->num_mapped_sgs - 1)));
 		desc_count += hs_ep->desc_count;
 	}
@@ -896,6 +899,156 @@ static void dwc2_gadget_config_nonisoc_xfer_ddma(struct dwc2_hsotg_ep *hs_ep,
 	hs_ep->desc_count = desc_count;
 }
 
+/*
+ * dwc2_gadget_chain_desc_num - descriptors needed to chain a request
+ * @hs_ep: The endpoint
+ * @hs_req: The request
+ *
+ * Returns the number of descriptors @hs_req takes when loaded as a whole
+ * onto the descriptor chain of a bulk IN endpoint, or 0 if the request
+ * has to be started on its own.
+ */
+static unsigned int dwc2_gadget_chain_desc_num(struct dwc2_hsotg_ep *hs_ep,
+					       struct dwc2_hsotg_req *hs_req)
+{
+	struct dwc2_hsotg *hsotg = hs_ep->parent;
+	struct usb_request *ureq = &hs_req->req;
+	u32 mps = hs_ep->ep.maxpacket;
+	u32 maxsize;
+	u32 mask;
+
+	if (!using_desc_dma(hsotg) || !hsotg->params.g_ddma_chain_ioc)
+		return 0;
+
+	if (!hs_ep->index || !hs_ep->dir_in ||
+	    !usb_endpoint_xfer_bulk(hs_ep->ep.desc))
+		return 0;
+
+	if (ureq->num_sgs || !ureq->length || ureq->actual)
+		return 0;
+
+	/* A trailing ZLP is programmed separately */
+	if (ureq->zero && !(ureq->length % mps))
+		return 0;
+
+	maxsize = dwc2_gadget_get_desc_params(hs_ep, &mask);
+
+	return DIV_ROUND_UP(ureq->length, maxsize);
+}
+
+/*
+ * dwc2_gadget_chain_ddma - chain queued requests behind the loaded one
+ * @hs_ep: The endpoint
+ * @hs_req: The request just loaded at the start of the descriptor chain
+ *
+ * Append as many of the requests waiting behind @hs_req as fit to the
+ * descriptor chain, so the core moves on from one request to the next
+ * without being restarted by software. Only every g_ddma_chain_ioc-th
+ * request and the last one raise XferCompl.
+ */
+static void dwc2_gadget_chain_ddma(struct dwc2_hsotg_ep *hs_ep,
+				   struct dwc2_hsotg_req *hs_req)
+{
+	struct dwc2_hsotg *hsotg = hs_ep->parent;
+	unsigned int ioc = hsotg->params.g_ddma_chain_ioc;
+	struct dwc2_hsotg_req *next = hs_req;
+	struct dwc2_dma_desc *desc;
+	unsigned int nreqs = 1;
+	unsigned int used;
+	unsigned int num;
+
+	used = dwc2_gadget_chain_desc_num(hs_ep, hs_req);
+	if (!used || used != hs_ep->desc_count)
+		return;
+
+	hs_req->desc_start = 0;
+	hs_req->desc_count = used;
+
+	list_for_each_entry_continue(next, &hs_ep->queue, queue) {
+		num = dwc2_gadget_chain_desc_num(hs_ep, next);
+		if (!num || used + num > MAX_DMA_DESC_NUM_GENERIC)
+			break;
+
+		/* The previous request no longer ends the chain */
+		desc = &hs_ep->desc_list[used - 1];
+		desc->status &= ~DEV_DMA_L;
+		if (nreqs % ioc)
+			desc->status &= ~DEV_DMA_IOC;
+
+		desc = &hs_ep->desc_list[used];
+		dwc2_gadget_fill_nonisoc_xfer_ddma_one(hs_ep, &desc,
+						       next->req.dma,
+						       next->req.length, true);
+		next->desc_start = used;
+		next->desc_count = num;
+
+		used += num;
+		nreqs++;
+		hs_ep->chain_reqs++;
+	}
+
+	hs_ep->desc_count = used;
+}
+
+/*
+ * dwc2_gadget_chain_req_left - bytes left of a chained request
+ * @hs_ep: The endpoint
+ * @hs_req: The chained request
+ * @done: Set if the core has closed all descriptors of @hs_req
+ */
+static unsigned int dwc2_gadget_chain_req_left(struct dwc2_hsotg_ep *hs_ep,
+					       struct dwc2_hsotg_req *hs_req,
+					       bool *done)
+{
+	struct dwc2_hsotg *hsotg = hs_ep->parent;
+	struct dwc2_dma_desc *desc = &hs_ep->desc_list[hs_req->desc_start];
+	unsigned int bytes_rem = 0;
+	u32 status;
+	int i;
+
+	*done = true;
+
+	for (i = 0; i < hs_req->desc_count; i++, desc++) {
+		status = desc->status;
+		bytes_rem += status & DEV_DMA_NBYTES_MASK;
+
+		if ((status & DEV_DMA_BUFF_STS_MASK) >> DEV_DMA_BUFF_STS_SHIFT !=
+		    DEV_DMA_BUFF_STS_DMADONE)
+			*done = false;
+		else if (status & DEV_DMA_STS_MASK)
+			dev_err(hsotg->dev, "descriptor %d closed with %x\n",
+				hs_req->desc_start + i,
+				status & DEV_DMA_STS_MASK);
+	}
+
+	return bytes_rem;
+}
+
+/*
+ * dwc2_gadget_complete_chain_ddma - give back finished chained requests
+ * @hs_ep: The endpoint
+ *
+ * Walk the chain from its head and complete every request whose
+ * descriptors have all been closed, stopping at the first one the core
+ * is still working on.
+ */
+static void dwc2_gadget_complete_chain_ddma(struct dwc2_hsotg_ep *hs_ep)
+{
+	struct dwc2_hsotg *hsotg = hs_ep->parent;
+	struct dwc2_hsotg_req *hs_req;
+	unsigned int size_left;
+	bool done;
+
+	while ((hs_req = hs_ep->req) && hs_req->desc_count) {
+		size_left = dwc2_gadget_chain_req_left(hs_ep, hs_req, &done);
+		if (!done)
+			break;
+
+		hs_req->req.actual = hs_req->req.length - size_left;
+		dwc2_hsotg_complete_request(hsotg, hs_ep, hs_req, 0);
+	}
+}
+
 /*
  * dwc2_gadget_fill_isoc_desc - fills next isochronous descriptor in chain.
  * @hs_ep: The isochronous endpoint.
@@ -1101,6 +1254,15 @@ static void dwc2_hsotg_start_req(struct dwc2_hsotg *hsotg,
 	else
 		maxreq = dwc2_gadget_get_chain_limit(hs_ep);
 
+	/*
+	 * Scatter-gather requests were checked to fit the descriptor chain
+	 * when queued, and are loaded as a whole, never split.
+	 */
+	if (using_desc_dma(hsotg) && ureq->num_sgs) {
+		WARN_ON(continuing);
+		maxreq = length;
+	}
+
 	if (length > maxreq) {
 		int round = maxreq % hs_ep->ep.maxpacket;
 
@@ -1159,13 +1321,16 @@ static void dwc2_hsotg_start_req(struct dwc2_hsotg *hsotg,
 				length += (mps - (length % mps));
 		}
 
-		if (continuing)
-			offset = ureq->actual;
+		/* Non-zero for requests restarted after leaving a chain */
+		offset = ureq->actual;
 
 		/* Fill DDMA chain entries */
 		dwc2_gadget_config_nonisoc_xfer_ddma(hs_ep, ureq->dma + offset,
 						     length);
 
+		if (!continuing)
+			dwc2_gadget_chain_ddma(hs_ep, hs_req);
+
 		/* write descriptor chain address to control register */
 		dwc2_writel(hsotg, hs_ep->desc_list_dma, dma_reg);
 
@@ -1268,6 +1433,11 @@ static int dwc2_hsotg_map_dma(struct dwc2_hsotg *hsotg,
 	int ret;
 
 	hs_ep->map_dir = hs_ep->dir_in;
+
+	/* The scatterlist comes mapped from a dma-buf attachment */
+	if (req->sg_was_mapped)
+		return 0;
+
 	ret = usb_gadget_map_request(&hsotg->gadget, req, hs_ep->dir_in);
 	if (ret)
 		goto dma_error;
@@ -1400,6 +1570,44 @@ static int dwc2_gadget_set_ep0_desc_chain(struct dwc2_hsotg *hsotg,
 	return 0;
 }
 
+/*
+ * dwc2_gadget_check_sg_ddma - check a scatter-gather request fits DDMA
+ * @hs_ep: The endpoint
+ * @req: The request, already mapped
+ *
+ * A scatter-gather request is loaded onto the descriptor chain in one go,
+ * one or more descriptors per segment, and is never split or restarted.
+ * Reject requests that would overrun the chain, and OUT requests with
+ * segments the core cannot fill, as OUT descriptors take whole packets.
+ */
+static int dwc2_gadget_check_sg_ddma(struct dwc2_hsotg_ep *hs_ep,
+				     struct usb_request *req)
+{
+	u32 mps = hs_ep->ep.maxpacket;
+	struct scatterlist *sg;
+	unsigned int num = 0;
+	u32 maxsize;
+	u32 mask;
+	int i;
+
+	if (hs_ep->isochronous)
+		return req->num_mapped_sgs > 1 ? -EINVAL : 0;
+
+	maxsize = dwc2_gadget_get_desc_params(hs_ep, &mask);
+
+	for_each_sg(req->sg, sg, req->num_mapped_sgs, i) {
+		if (!hs_ep->dir_in && (sg_dma_len(sg) % mps))
+			return -EINVAL;
+
+		num += max_t(unsigned int, 1,
+			     DIV_ROUND_UP(sg_dma_len(sg), maxsize));
+		if (num > MAX_DMA_DESC_NUM_GENERIC)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
 static int dwc2_hsotg_ep_queue(struct usb_ep *ep, struct usb_request *req,
 			       gfp_t gfp_flags)
 {
@@ -1429,6 +1637,7 @@ static int dwc2_hsotg_ep_queue(struct usb_ep *ep, struct usb_request *req,
 
 	/* initialise status of the request */
 	INIT_LIST_HEAD(&hs_req->queue);
+	hs_req->desc_count = 0;
 	req->actual = 0;
 	req->status = -EINPROGRESS;
 
@@ -1467,6 +1676,16 @@ static int dwc2_hsotg_ep_queue(struct usb_ep *ep, struct usb_request *req,
 		if (ret)
 			return ret;
 	}
+
+	if (using_desc_dma(hs) && req->num_sgs) {
+		ret = dwc2_gadget_check_sg_ddma(hs_ep, req);
+		if (ret) {
+			dev_err(hs->dev, "%s: sg list does not fit DDMA chain\n",
+				ep->name);
+			dwc2_hsotg_unmap_dma(hs, hs_ep, hs_req);
+			return ret;
+		}
+	}
 	/* If using descriptor DMA configure EP0 descriptor chain pointers */
 	if (using_desc_dma(hs) && !hs_ep->index) {
 		ret = dwc2_gadget_set_ep0_desc_chain(hs, hs_ep);
@@ -2142,7 +2361,14 @@ static void dwc2_hsotg_complete_request(struct dwc2_hsotg *hsotg,
 
 	dwc2_hsotg_handle_unaligned_buf_complete(hsotg, hs_ep, hs_req);
 
-	hs_ep->req = NULL;
+	if (hs_ep->req == hs_req && hs_ep->chain_reqs) {
+		/* The core has already moved on to the next chained request */
+		hs_ep->req = list_next_entry(hs_req, queue);
+		hs_ep->chain_reqs--;
+	} else {
+		hs_ep->req = NULL;
+	}
+	hs_req->desc_count = 0;
 	list_del_init(&hs_req->queue);
 
 	/*
@@ -2695,6 +2921,11 @@ static void dwc2_hsotg_complete_in(struct dwc2_hsotg *hsotg,
 		return;
 	}
 
+	if (hs_req->desc_count) {
+		dwc2_gadget_complete_chain_ddma(hs_ep);
+		return;
+	}
+
 	/* Finish ZLP handling for IN EP0 transactions */
 	if (hs_ep->index == 0 && hsotg->ep0_state == DWC2_EP0_STATUS_IN) {
 		dev_dbg(hsotg->dev, "zlp packet sent\n");
@@ -3291,6 +3522,7 @@ static void kill_all_requests(struct dwc2_hsotg *hsotg,
 	unsigned int size;
 
 	ep->req = NULL;
+	ep->chain_reqs = 0;
 
 	while (!list_empty(&ep->queue)) {
 		struct dwc2_hsotg_req *req = get_ep_head(ep);
@@ -4320,6 +4552,56 @@ static bool on_list(struct dwc2_hsotg_ep *ep, struct dwc2_hsotg_req *test)
 	return false;
 }
 
+/**
+ * dwc2_gadget_unchain_ddma - take the requests off a stopped descriptor chain
+ * @hsotg: The device state.
+ * @hs_ep: The endpoint.
+ * @target: The chained request being dequeued.
+ *
+ * Stop the endpoint, give back the chained requests the core has already
+ * finished and leave the rest queued, with their actual length recording
+ * what has been sent, to be restarted one by one. If @target itself was
+ * already finished, the rest of the chain is restarted here.
+ */
+static void dwc2_gadget_unchain_ddma(struct dwc2_hsotg *hsotg,
+				     struct dwc2_hsotg_ep *hs_ep,
+				     struct dwc2_hsotg_req *target)
+{
+	struct dwc2_hsotg_req *hs_req, *last;
+	unsigned int size_left;
+	unsigned int i;
+	bool done;
+
+	last = hs_ep->req;
+	for (i = 0; i < hs_ep->chain_reqs; i++)
+		last = list_next_entry(last, queue);
+
+	dwc2_hsotg_ep_stop_xfr(hsotg, hs_ep);
+	dwc2_gadget_complete_chain_ddma(hs_ep);
+
+	/*
+	 * Nothing is left of the stopped chain, either because it finished or
+	 * because completing it already started the next requests.
+	 */
+	hs_req = hs_ep->req;
+	if (!hs_req || !hs_req->desc_count || !on_list(hs_ep, last))
+		return;
+
+	for (i = 0; i <= hs_ep->chain_reqs; i++) {
+		size_left = dwc2_gadget_chain_req_left(hs_ep, hs_req, &done);
+		hs_req->req.actual = hs_req->req.length - size_left;
+		hs_req->desc_count = 0;
+		hs_req = list_next_entry(hs_req, queue);
+	}
+
+	hs_ep->chain_reqs = 0;
+	hs_ep->req = NULL;
+
+	/* The caller only restarts the endpoint after giving back @target */
+	if (!on_list(hs_ep, target))
+		dwc2_gadget_start_next_request(hs_ep);
+}
+
 /**
  * dwc2_hsotg_ep_dequeue - dequeue given endpoint
  * @ep: The endpoint to dequeue.
@@ -4341,6 +4623,24 @@ static int dwc2_hsotg_ep_dequeue(struct usb_ep *ep, struct usb_request *req)
 		return -EINVAL;
 	}
 
+	/* Dequeue a request loaded onto a descriptor chain */
+	if (hs_req->desc_count) {
+		dwc2_gadget_unchain_ddma(hs, hs_ep, hs_req);
+
+		/* It may have finished before the endpoint stopped */
+		if (!on_list(hs_ep, hs_req)) {
+			spin_unlock_irqrestore(&hs->lock, flags);
+			return -EINVAL;
+		}
+
+		dwc2_hsotg_complete_request(hs, hs_ep, hs_req, -ECONNRESET);
+		if (!hs_ep->req)
+			dwc2_gadget_start_next_request(hs_ep);
+
+		spin_unlock_irqrestore(&hs->lock, flags);
+		return 0;
+	}
+
 	/* Dequeue already started request */
 	if (req == &hs_ep->req->req)
 		dwc2_hsotg_ep_stop_xfr(hs, hs_ep);
@@ -4578,6 +4878,9 @@ static int dwc2_hsotg_udc_start(struct usb_gadget *gadget,
 	spin_unlock_irqrestore(&hsotg->lock, flags);
 
 	gadget->sg_supported = using_desc_dma(hsotg);
+	gadget->sg_premapped = using_desc_dma(hsotg);
+	/* Every descriptor of an IN transfer ends with a short packet */
+	gadget->quirk_sg_segment_packets = using_desc_dma(hsotg);
 	dev_info(hsotg->dev, "bound driver %s\n", driver->driver.name);
 
 	return 0;
@@ -331,6 +331,9 @@ struct dwc2_hs_transfer_time {
  * @want_wait:          We should wait before re-queuing; only matters for non-
  *                      periodic transfers and is ignored for periodic ones.
  * @wait_timer_cancel:  Set to true to cancel the wait_timer.
+ * @nr_chan_irqs:       Number of channel interrupts handled for this QH.
+ * @nr_naks:            Number of NAK interrupts handled for this QH.
+ * @nr_holdoffs:        Number of times this QH was held off after NAKs.
  *
  * @tt_buffer_dirty:	True if EP's TT buffer is not clean.
  * A Queue Head (QH) holds the static characteristics of an endpoint and
@@ -377,6 +380,9 @@ struct dwc2_qh {
 	unsigned schedule_low_speed:1;
 	unsigned want_wait:1;
 	unsigned wait_timer_cancel:1;
+	unsigned long nr_chan_irqs;
+	unsigned long nr_naks;
+	unsigned long nr_holdoffs;
 };
 
 /**
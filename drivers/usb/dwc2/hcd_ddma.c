@@ -344,9 +344,14 @@ int dwc2_hcd_qh_init_ddma(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh,
 {
 	int retval;
 
+	/*
+	 * The core cannot issue split transactions while HCFG.DescDMA is
+	 * set, and the bit is global for all channels, so FS/LS devices
+	 * behind a high-speed hub can only be driven in buffer DMA mode.
+	 */
 	if (qh->do_split) {
-		dev_err(hsotg->dev,
-			"SPLIT Transfers are not supported in Descriptor DMA mode.\n");
+		dev_err_once(hsotg->dev,
+			     "SPLIT Transfers are not supported in Descriptor DMA mode, use buffer DMA for FS/LS devices behind hubs\n");
 		retval = -EINVAL;
 		goto err0;
 	}
@@ -53,12 +53,6 @@
 #include "core.h"
 #include "hcd.h"
 
-/*
- * If we get this many NAKs on a split transaction we'll slow down
- * retransmission.  A 1 here means delay after the first NAK.
- */
-#define DWC2_NAKS_BEFORE_DELAY		3
-
 /* This function is for debug only */
 static void dwc2_track_missed_sofs(struct dwc2_hsotg *hsotg)
 {
@@ -1201,6 +1195,15 @@ static void dwc2_update_urb_state_abn(struct dwc2_hsotg *hsotg,
 		 urb->length);
 }
 
+static bool dwc2_nak_holdoff(struct dwc2_hsotg *hsotg, struct dwc2_qtd *qtd,
+			     bool split)
+{
+	u16 naks = split ? hsotg->params.host_nak_holdoff_naks :
+			   hsotg->params.host_bulk_nak_holdoff_naks;
+
+	return naks && qtd->num_naks >= naks;
+}
+
 /*
  * Handles a host channel NAK interrupt. This handler may be called in either
  * DMA mode or Slave mode.
@@ -1238,16 +1241,22 @@ static void dwc2_hc_nak_intr(struct dwc2_hsotg *hsotg,
 	 *
 	 * Note that in DMA mode software only gets involved to re-send NAKed
 	 * transfers for split transactions, so we only need to apply this
-	 * delaying logic when handling splits. In non-DMA mode presumably we
-	 * might want a similar delay if someone can demonstrate this problem
-	 * affects that code path too.
+	 * delaying logic when handling splits. Bulk NAKs that software has to
+	 * restart itself (Slave mode, and OUT in DMA mode) can get the same
+	 * treatment below.
+	 *
+	 * The number of NAKs comes from host_nak_holdoff_naks for splits and
+	 * host_bulk_nak_holdoff_naks for bulk, the delay from
+	 * host_nak_holdoff_us; a count of 0 disables the delay.
 	 */
+	qtd->qh->nr_naks++;
+
 	if (chan->do_split) {
 		if (chan->complete_split)
 			qtd->error_count = 0;
 		qtd->complete_split = 0;
 		qtd->num_naks++;
-		qtd->qh->want_wait = qtd->num_naks >= DWC2_NAKS_BEFORE_DELAY &&
+		qtd->qh->want_wait = dwc2_nak_holdoff(hsotg, qtd, true) &&
 				!(chan->ep_type == USB_ENDPOINT_XFER_CONTROL &&
 				  chan->ep_is_in);
 		dwc2_halt_channel(hsotg, chan, qtd, DWC2_HC_XFER_NAK);
@@ -1284,6 +1293,11 @@ static void dwc2_hc_nak_intr(struct dwc2_hsotg *hsotg,
 				chan->qh->ping_state = 1;
 		}
 
+		if (chan->ep_type == USB_ENDPOINT_XFER_BULK) {
+			qtd->num_naks++;
+			qtd->qh->want_wait = dwc2_nak_holdoff(hsotg, qtd, false);
+		}
+
 		/*
 		 * Halt the channel so the transfer can be re-started from
 		 * the appropriate point or the PING protocol will
@@ -2077,6 +2091,7 @@ static void dwc2_hc_n_intr(struct dwc2_hsotg *hsotg, int chnum)
 	}
 
 	chan->hcint = hcintraw;
+	chan->qh->nr_chan_irqs++;
 
 	/*
 	 * If the channel was halted due to a dequeue, the qtd list might
@@ -411,12 +411,16 @@ static void dwc2_set_default_params(struct dwc2_hsotg *hsotg)
 		p->host_rx_fifo_size = hw->rx_fifo_size;
 		p->host_nperio_tx_fifo_size = hw->host_nperio_tx_fifo_size;
 		p->host_perio_tx_fifo_size = hw->host_perio_tx_fifo_size;
+		p->host_nak_holdoff_naks = 3;
+		p->host_bulk_nak_holdoff_naks = 0;
+		p->host_nak_holdoff_us = 1000;
 	}
 
 	if ((hsotg->dr_mode == USB_DR_MODE_PERIPHERAL) ||
 	    (hsotg->dr_mode == USB_DR_MODE_OTG)) {
 		p->g_dma = dma_capable;
 		p->g_dma_desc = hw->dma_desc_enable;
+		p->g_ddma_chain_ioc = 4;
 
 		/*
 		 * The values for g_rx_fifo_size (2048) and
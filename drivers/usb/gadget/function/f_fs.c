@@ -15,6 +15,9 @@
 /* #define VERBOSE_DEBUG */
 
 #include <linux/blkdev.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
+#include <linux/dma-resv.h>
 #include <linux/pagemap.h>
 #include <linux/export.h>
 #include <linux/fs_parser.h>
@@ -128,6 +131,10 @@ struct ffs_epfile {
 	/* Protects ep->ep and ep->req. */
 	struct mutex			mutex;
 
+	/* Attached DMABUFs, see ffs_dmabuf_attach(). */
+	struct list_head		dmabufs;	/* P: dmabufs_mutex */
+	struct mutex			dmabufs_mutex;
+
 	struct ffs_data			*ffs;
 	struct ffs_ep			*ep;	/* P: ffs->eps_lock */
 
@@ -230,6 +237,28 @@ struct ffs_io_data {
 	struct completion done;
 };
 
+/*  DMABUF attachments *****************************************************/
+
+struct ffs_dmabuf_priv {
+	struct list_head entry;
+	struct kref ref;
+	struct ffs_data *ffs;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	u64 context;
+	unsigned int seqno;		/* P: ffs->eps_lock */
+	struct usb_request *req;	/* P: ffs->eps_lock */
+	struct usb_ep *ep;		/* P: ffs->eps_lock */
+};
+
+struct ffs_dma_fence {
+	struct dma_fence base;
+	spinlock_t lock;
+	struct ffs_dmabuf_priv *priv;
+	struct sg_table sgt;
+	struct work_struct work;
+};
+
 struct ffs_desc_helper {
 	struct ffs_data *ffs;
 	unsigned interfaces_count;
@@ -1284,43 +1313,496 @@ static ssize_t ffs_epfile_read_iter(struct kiocb *kiocb, struct iov_iter *to)
 	return res;
 }
 
+static void ffs_dmabuf_release(struct kref *ref)
+{
+	struct ffs_dmabuf_priv *priv = container_of(ref, struct ffs_dmabuf_priv,
+						    ref);
+	struct dma_buf_attachment *attach = priv->attach;
+	struct dma_buf *dmabuf = attach->dmabuf;
+
+	pr_vdebug("FFS DMABUF release\n");
+
+	dma_resv_lock(dmabuf->resv, NULL);
+	dma_buf_unmap_attachment(attach, priv->sgt, DMA_BIDIRECTIONAL);
+	dma_resv_unlock(dmabuf->resv);
+
+	dma_buf_detach(dmabuf, attach);
+	dma_buf_put(dmabuf);
+	kfree(priv);
+}
+
+static void ffs_dmabuf_put(struct ffs_dmabuf_priv *priv)
+{
+	kref_put(&priv->ref, ffs_dmabuf_release);
+}
+
+static void ffs_dmabuf_cancel(struct ffs_dmabuf_priv *priv)
+{
+	struct ffs_data *ffs = priv->ffs;
+
+	/* Give back a transfer still in flight, its fence gets -ECONNRESET */
+	spin_lock_irq(&ffs->eps_lock);
+	if (priv->req)
+		usb_ep_dequeue(priv->ep, priv->req);
+	spin_unlock_irq(&ffs->eps_lock);
+}
+
 static int
 ffs_epfile_release(struct inode *inode, struct file *file)
 {
 	struct ffs_epfile *epfile = inode->i_private;
+	struct ffs_dmabuf_priv *priv, *tmp;
 
 	ENTER();
 
+	mutex_lock(&epfile->dmabufs_mutex);
+	list_for_each_entry_safe(priv, tmp, &epfile->dmabufs, entry) {
+		ffs_dmabuf_cancel(priv);
+		list_del(&priv->entry);
+		ffs_dmabuf_put(priv);
+	}
+	mutex_unlock(&epfile->dmabufs_mutex);
+
 	__ffs_epfile_read_buffer_free(epfile);
 	ffs_data_closed(epfile->ffs);
 
 	return 0;
 }
 
-static long ffs_epfile_ioctl(struct file *file, unsigned code,
-			     unsigned long value)
+static struct ffs_ep *ffs_epfile_wait_ep(struct file *file)
 {
 	struct ffs_epfile *epfile = file->private_data;
 	struct ffs_ep *ep;
 	int ret;
 
-	ENTER();
-
-	if (WARN_ON(epfile->ffs->state != FFS_ACTIVE))
-		return -ENODEV;
-
 	/* Wait for endpoint to be enabled */
 	ep = epfile->ep;
 	if (!ep) {
 		if (file->f_flags & O_NONBLOCK)
-			return -EAGAIN;
+			return ERR_PTR(-EAGAIN);
 
 		ret = wait_event_interruptible(
 				epfile->ffs->wait, (ep = epfile->ep));
 		if (ret)
-			return -EINTR;
+			return ERR_PTR(-EINTR);
+	}
+
+	return ep;
+}
+
+static int ffs_dma_resv_lock(struct dma_buf *dmabuf, bool nonblock)
+{
+	if (!nonblock)
+		return dma_resv_lock_interruptible(dmabuf->resv, NULL);
+
+	if (!dma_resv_trylock(dmabuf->resv))
+		return -EBUSY;
+
+	return 0;
+}
+
+/* Returns the attachment of @dmabuf to @epfile with a reference held */
+static struct ffs_dmabuf_priv *
+ffs_dmabuf_find(struct ffs_epfile *epfile, struct dma_buf *dmabuf)
+{
+	struct ffs_dmabuf_priv *priv;
+
+	mutex_lock(&epfile->dmabufs_mutex);
+	list_for_each_entry(priv, &epfile->dmabufs, entry) {
+		if (priv->attach->dmabuf == dmabuf) {
+			kref_get(&priv->ref);
+			mutex_unlock(&epfile->dmabufs_mutex);
+			return priv;
+		}
+	}
+	mutex_unlock(&epfile->dmabufs_mutex);
+
+	return NULL;
+}
+
+static int ffs_dmabuf_attach(struct file *file, int fd)
+{
+	bool nonblock = file->f_flags & O_NONBLOCK;
+	struct ffs_epfile *epfile = file->private_data;
+	struct usb_gadget *gadget = epfile->ffs->gadget;
+	struct dma_buf_attachment *attach;
+	struct ffs_dmabuf_priv *priv;
+	struct sg_table *sg_table;
+	struct dma_buf *dmabuf;
+	int err;
+
+	/* The buffer is handed to the controller as a mapped scatterlist */
+	if (!gadget || !gadget->sg_premapped)
+		return -EPERM;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	attach = dma_buf_attach(dmabuf, gadget->dev.parent);
+	if (IS_ERR(attach)) {
+		err = PTR_ERR(attach);
+		goto err_dmabuf_put;
 	}
 
+	priv = kzalloc(sizeof(*priv), GFP_KERNEL);
+	if (!priv) {
+		err = -ENOMEM;
+		goto err_dmabuf_detach;
+	}
+
+	err = ffs_dma_resv_lock(dmabuf, nonblock);
+	if (err)
+		goto err_free_priv;
+
+	/*
+	 * The direction is only known once the endpoint is enabled, and the
+	 * mapping is kept for as long as the DMABUF stays attached.
+	 */
+	sg_table = dma_buf_map_attachment(attach, DMA_BIDIRECTIONAL);
+	dma_resv_unlock(dmabuf->resv);
+
+	if (IS_ERR(sg_table)) {
+		err = PTR_ERR(sg_table);
+		goto err_free_priv;
+	}
+
+	kref_init(&priv->ref);
+	priv->ffs = epfile->ffs;
+	priv->attach = attach;
+	priv->sgt = sg_table;
+	priv->context = dma_fence_context_alloc(1);
+
+	mutex_lock(&epfile->dmabufs_mutex);
+	list_add(&priv->entry, &epfile->dmabufs);
+	mutex_unlock(&epfile->dmabufs_mutex);
+
+	return 0;
+
+err_free_priv:
+	kfree(priv);
+err_dmabuf_detach:
+	dma_buf_detach(dmabuf, attach);
+err_dmabuf_put:
+	dma_buf_put(dmabuf);
+
+	return err;
+}
+
+static int ffs_dmabuf_detach(struct file *file, int fd)
+{
+	struct ffs_epfile *epfile = file->private_data;
+	struct ffs_dmabuf_priv *priv;
+	struct dma_buf *dmabuf;
+	int ret = -EINVAL;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	mutex_lock(&epfile->dmabufs_mutex);
+	list_for_each_entry(priv, &epfile->dmabufs, entry) {
+		if (priv->attach->dmabuf == dmabuf) {
+			ffs_dmabuf_cancel(priv);
+			list_del(&priv->entry);
+			ffs_dmabuf_put(priv);
+			ret = 0;
+			break;
+		}
+	}
+	mutex_unlock(&epfile->dmabufs_mutex);
+
+	dma_buf_put(dmabuf);
+
+	return ret;
+}
+
+static const char *ffs_dmabuf_get_driver_name(struct dma_fence *fence)
+{
+	return "functionfs";
+}
+
+static const char *ffs_dmabuf_get_timeline_name(struct dma_fence *fence)
+{
+	return "";
+}
+
+static const struct dma_fence_ops ffs_dmabuf_fence_ops = {
+	.get_driver_name	= ffs_dmabuf_get_driver_name,
+	.get_timeline_name	= ffs_dmabuf_get_timeline_name,
+};
+
+static void ffs_dmabuf_cleanup(struct work_struct *work)
+{
+	struct ffs_dma_fence *dma_fence =
+		container_of(work, struct ffs_dma_fence, work);
+	struct ffs_dmabuf_priv *priv = dma_fence->priv;
+	struct ffs_data *ffs = priv->ffs;
+	struct usb_request *req;
+	struct usb_ep *ep;
+
+	spin_lock_irq(&ffs->eps_lock);
+	req = priv->req;
+	ep = priv->ep;
+	priv->req = NULL;
+	spin_unlock_irq(&ffs->eps_lock);
+
+	if (req)
+		usb_ep_free_request(ep, req);
+
+	sg_free_table(&dma_fence->sgt);
+	ffs_dmabuf_put(priv);
+	dma_fence_put(&dma_fence->base);
+}
+
+static void ffs_dmabuf_signal_done(struct ffs_dma_fence *dma_fence, int ret)
+{
+	struct ffs_dmabuf_priv *priv = dma_fence->priv;
+	struct dma_fence *fence = &dma_fence->base;
+	bool cookie = dma_fence_begin_signalling();
+
+	if (ret < 0)
+		dma_fence_set_error(fence, ret);
+	dma_fence_signal(fence);
+	dma_fence_end_signalling(cookie);
+
+	/*
+	 * Freeing the request and dropping the references may sleep, and
+	 * the completion runs in interrupt context.
+	 */
+	INIT_WORK(&dma_fence->work, ffs_dmabuf_cleanup);
+	queue_work(priv->ffs->io_completion_wq, &dma_fence->work);
+}
+
+static void ffs_epfile_dmabuf_io_complete(struct usb_ep *ep,
+					  struct usb_request *req)
+{
+	pr_vdebug("FFS: DMABUF transfer complete, status=%d\n", req->status);
+
+	ffs_dmabuf_signal_done(req->context, req->status);
+}
+
+/*
+ * Build a table of the DMA segments covering the first @length bytes of
+ * @src, which is already mapped for the controller.
+ */
+static int ffs_dmabuf_sgt_trim(struct sg_table *dst, struct sg_table *src,
+			       size_t length)
+{
+	struct scatterlist *sg, *dsg;
+	unsigned int nents = 0;
+	size_t len = 0;
+	unsigned int i;
+	int ret;
+
+	for_each_sgtable_dma_sg(src, sg, i) {
+		nents++;
+		len += sg_dma_len(sg);
+		if (len >= length)
+			break;
+	}
+
+	if (len < length)
+		return -EINVAL;
+
+	ret = sg_alloc_table(dst, nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	dsg = dst->sgl;
+	for_each_sgtable_dma_sg(src, sg, i) {
+		len = min_t(size_t, sg_dma_len(sg), length);
+
+		sg_dma_address(dsg) = sg_dma_address(sg);
+		sg_dma_len(dsg) = len;
+
+		length -= len;
+		if (!length)
+			break;
+
+		dsg = sg_next(dsg);
+	}
+
+	return 0;
+}
+
+static int ffs_dmabuf_transfer(struct file *file,
+			       const struct usb_ffs_dmabuf_transfer_req *req)
+{
+	bool nonblock = file->f_flags & O_NONBLOCK;
+	struct ffs_epfile *epfile = file->private_data;
+	struct ffs_data *ffs = epfile->ffs;
+	struct ffs_dmabuf_priv *priv;
+	struct ffs_dma_fence *fence;
+	struct usb_request *usb_req;
+	struct dma_buf *dmabuf;
+	struct ffs_ep *ep;
+	int ret;
+
+	if (req->flags)
+		return -EINVAL;
+
+	dmabuf = dma_buf_get(req->fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	if (!req->length || req->length > dmabuf->size) {
+		ret = -EINVAL;
+		goto err_dmabuf_put;
+	}
+
+	ep = ffs_epfile_wait_ep(file);
+	if (IS_ERR(ep)) {
+		ret = PTR_ERR(ep);
+		goto err_dmabuf_put;
+	}
+
+	priv = ffs_dmabuf_find(epfile, dmabuf);
+	if (!priv) {
+		ret = -EINVAL;
+		goto err_dmabuf_put;
+	}
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence) {
+		ret = -ENOMEM;
+		goto err_priv_put;
+	}
+
+	ret = ffs_dmabuf_sgt_trim(&fence->sgt, priv->sgt, req->length);
+	if (ret)
+		goto err_fence_free;
+
+	ret = ffs_dma_resv_lock(dmabuf, nonblock);
+	if (ret)
+		goto err_sgt_free;
+
+	/*
+	 * Sending only reads the buffer, so it waits for writers; receiving
+	 * into it has to wait for everybody.
+	 */
+	if (!dma_resv_test_signaled(dmabuf->resv, !epfile->in)) {
+		ret = -EBUSY;
+		goto err_resv_unlock;
+	}
+
+	if (epfile->in) {
+		ret = dma_resv_reserve_shared(dmabuf->resv, 1);
+		if (ret)
+			goto err_resv_unlock;
+	}
+
+	spin_lock_irq(&ffs->eps_lock);
+
+	/* In the meantime, endpoint got disabled or changed. */
+	if (epfile->ep != ep) {
+		ret = -ESHUTDOWN;
+		goto err_eps_unlock;
+	}
+
+	/* One transfer at a time per attachment */
+	if (priv->req) {
+		ret = -EBUSY;
+		goto err_eps_unlock;
+	}
+
+	usb_req = usb_ep_alloc_request(ep->ep, GFP_ATOMIC);
+	if (!usb_req) {
+		ret = -ENOMEM;
+		goto err_eps_unlock;
+	}
+
+	spin_lock_init(&fence->lock);
+	dma_fence_init(&fence->base, &ffs_dmabuf_fence_ops, &fence->lock,
+		       priv->context, ++priv->seqno);
+	fence->priv = priv;
+
+	if (epfile->in)
+		dma_resv_add_shared_fence(dmabuf->resv, &fence->base);
+	else
+		dma_resv_add_excl_fence(dmabuf->resv, &fence->base);
+
+	usb_req->length = req->length;
+	usb_req->sg = fence->sgt.sgl;
+	usb_req->num_sgs = fence->sgt.nents;
+	usb_req->num_mapped_sgs = fence->sgt.nents;
+	usb_req->sg_was_mapped = true;
+	usb_req->complete = ffs_epfile_dmabuf_io_complete;
+	usb_req->context = fence;
+
+	priv->ep = ep->ep;
+	priv->req = usb_req;
+
+	ret = usb_ep_queue(ep->ep, usb_req, GFP_ATOMIC);
+	if (ret) {
+		pr_warn("FFS: Failed to queue DMABUF: %d\n", ret);
+		/* The cleanup work frees the request and drops the references */
+		ffs_dmabuf_signal_done(fence, ret);
+	}
+
+	spin_unlock_irq(&ffs->eps_lock);
+	dma_resv_unlock(dmabuf->resv);
+	dma_buf_put(dmabuf);
+
+	return ret;
+
+err_eps_unlock:
+	spin_unlock_irq(&ffs->eps_lock);
+err_resv_unlock:
+	dma_resv_unlock(dmabuf->resv);
+err_sgt_free:
+	sg_free_table(&fence->sgt);
+err_fence_free:
+	kfree(fence);
+err_priv_put:
+	ffs_dmabuf_put(priv);
+err_dmabuf_put:
+	dma_buf_put(dmabuf);
+
+	return ret;
+}
+
+static long ffs_epfile_ioctl(struct file *file, unsigned code,
+			     unsigned long value)
+{
+	struct ffs_epfile *epfile = file->private_data;
+	struct ffs_ep *ep;
+	int ret;
+
+	ENTER();
+
+	if (WARN_ON(epfile->ffs->state != FFS_ACTIVE))
+		return -ENODEV;
+
+	switch (code) {
+	case FUNCTIONFS_DMABUF_ATTACH:
+	case FUNCTIONFS_DMABUF_DETACH:
+	{
+		int fd;
+
+		if (copy_from_user(&fd, (void __user *)value, sizeof(fd)))
+			return -EFAULT;
+
+		if (code == FUNCTIONFS_DMABUF_ATTACH)
+			return ffs_dmabuf_attach(file, fd);
+
+		return ffs_dmabuf_detach(file, fd);
+	}
+	case FUNCTIONFS_DMABUF_TRANSFER:
+	{
+		struct usb_ffs_dmabuf_transfer_req req;
+
+		if (copy_from_user(&req, (void __user *)value, sizeof(req)))
+			return -EFAULT;
+
+		return ffs_dmabuf_transfer(file, &req);
+	}
+	}
+
+	ep = ffs_epfile_wait_ep(file);
+	if (IS_ERR(ep))
+		return PTR_ERR(ep);
+
 	spin_lock_irq(&epfile->ffs->eps_lock);
 
 	/* In the meantime, endpoint got disabled or changed. */
@@ -1930,6 +2412,8 @@ static int ffs_epfiles_create(struct ffs_data *ffs)
 	for (i = 1; i <= count; ++i, ++epfile) {
 		epfile->ffs = ffs;
 		mutex_init(&epfile->mutex);
+		mutex_init(&epfile->dmabufs_mutex);
+		INIT_LIST_HEAD(&epfile->dmabufs);
 		if (ffs->user_flags & FUNCTIONFS_VIRTUAL_ADDR)
 			sprintf(epfile->name, "ep%02x", ffs->eps_addrmap[i]);
 		else
@@ -171,6 +171,7 @@
 #include <linux/blkdev.h>
 #include <linux/completion.h>
 #include <linux/dcache.h>
+#include <linux/fadvise.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/fcntl.h>
@@ -250,6 +251,7 @@ struct fsg_common {
 	struct fsg_buffhd	*next_buffhd_to_drain;
 	struct fsg_buffhd	*buffhds;
 	unsigned int		fsg_num_buffers;
+	unsigned int		fsg_buflen;
 
 	int			cmnd_size;
 	u8			cmnd[MAX_COMMAND_SIZE];
@@ -601,6 +603,27 @@ static int sleep_thread(struct fsg_common *common, bool can_freeze,
 
 /*-------------------------------------------------------------------------*/
 
+/*
+ * Start reading the command's range into the page cache in the background,
+ * so the backing device works while earlier buffers are on the wire and the
+ * kernel_read() calls below mostly find their data already there. When the
+ * host reads sequentially, also prefetch as much again past the end of the
+ * command, ready for the next one.
+ */
+static void fsg_lun_readahead(struct fsg_lun *curlun, loff_t offset, u32 len)
+{
+	loff_t end = offset + len;
+
+	if (offset == curlun->read_end)
+		end += len;
+	curlun->read_end = offset + len;
+
+	end = min(end, curlun->file_length);
+	if (end > offset)
+		vfs_fadvise(curlun->filp, offset, end - offset,
+			    POSIX_FADV_WILLNEED);
+}
+
 static int do_read(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = common->curlun;
@@ -642,6 +665,8 @@ static int do_read(struct fsg_common *common)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	fsg_lun_readahead(curlun, file_offset, amount_left);
+
 	for (;;) {
 		/*
 		 * Figure out how much we need to read:
@@ -649,7 +674,7 @@ static int do_read(struct fsg_common *common)
 		 * But don't read more than the buffer size.
 		 * And don't try to read past the end of the file.
 		 */
-		amount = min(amount_left, FSG_BUFLEN);
+		amount = min(amount_left, common->fsg_buflen);
 		amount = min((loff_t)amount,
 			     curlun->file_length - file_offset);
 
@@ -796,7 +821,7 @@ static int do_write(struct fsg_common *common)
 			 * Try to get the remaining amount,
 			 * but not more than the buffer size.
 			 */
-			amount = min(amount_left_to_req, FSG_BUFLEN);
+			amount = min(amount_left_to_req, common->fsg_buflen);
 
 			/* Beyond the end of the backing file? */
 			if (usb_offset >= curlun->file_length) {
@@ -996,7 +1021,7 @@ static int do_verify(struct fsg_common *common)
 		 * the buffer size.
 		 * And don't try to read past the end of the file.
 		 */
-		amount = min(amount_left, FSG_BUFLEN);
+		amount = min(amount_left, common->fsg_buflen);
 		amount = min((loff_t)amount,
 			     curlun->file_length - file_offset);
 		if (amount == 0) {
@@ -1442,7 +1467,8 @@ static int throw_away_data(struct fsg_common *common)
 		bh2 = common->next_buffhd_to_fill;
 		if (bh2->state == BUF_STATE_EMPTY &&
 				common->usb_amount_left > 0) {
-			amount = min(common->usb_amount_left, FSG_BUFLEN);
+			amount = min(common->usb_amount_left,
+				     common->fsg_buflen);
 
 			/*
 			 * Except at the end of the transfer, amount will be
@@ -2564,6 +2590,7 @@ static struct fsg_common *fsg_common_setup(struct fsg_common *common)
 	init_waitqueue_head(&common->io_wait);
 	init_waitqueue_head(&common->fsg_wait);
 	common->state = FSG_STATE_TERMINATED;
+	common->fsg_buflen = FSG_BUFLEN;
 	memset(common->luns, 0, sizeof(common->luns));
 
 	return common;
@@ -2604,7 +2631,7 @@ int fsg_common_set_num_buffers(struct fsg_common *common, unsigned int n)
 		bh->next = bh + 1;
 		++bh;
 buffhds_first_it:
-		bh->buf = kmalloc(FSG_BUFLEN, GFP_KERNEL);
+		bh->buf = kmalloc(common->fsg_buflen, GFP_KERNEL);
 		if (unlikely(!bh->buf))
 			goto error_release;
 	} while (--i);
@@ -2627,6 +2654,27 @@ int fsg_common_set_num_buffers(struct fsg_common *common, unsigned int n)
 }
 EXPORT_SYMBOL_GPL(fsg_common_set_num_buffers);
 
+int fsg_common_set_buflen(struct fsg_common *common, unsigned int len)
+{
+	unsigned int old = common->fsg_buflen;
+	int rc;
+
+	/* Keep buffers a whole number of pages, blocks and packets */
+	if (len < FSG_BUFLEN || len > FSG_BUFLEN_MAX || !PAGE_ALIGNED(len))
+		return -EINVAL;
+
+	common->fsg_buflen = len;
+	if (!common->buffhds)
+		return 0;
+
+	rc = fsg_common_set_num_buffers(common, common->fsg_num_buffers);
+	if (rc)
+		common->fsg_buflen = old;
+
+	return rc;
+}
+EXPORT_SYMBOL_GPL(fsg_common_set_buflen);
+
 void fsg_common_remove_lun(struct fsg_lun *lun)
 {
 	if (device_is_registered(&lun->dev))
@@ -2944,7 +2992,7 @@ static int fsg_bind(struct usb_configuration *c, struct usb_function *f)
 		fsg_fs_bulk_out_desc.bEndpointAddress;
 
 	/* Calculate bMaxBurst, we know packet size is 1024 */
-	max_burst = min_t(unsigned, FSG_BUFLEN / 1024, 15);
+	max_burst = min_t(unsigned, common->fsg_buflen / 1024, 15);
 
 	fsg_ss_bulk_in_desc.bEndpointAddress =
 		fsg_fs_bulk_in_desc.bEndpointAddress;
@@ -3297,11 +3345,52 @@ static ssize_t fsg_opts_num_buffers_store(struct config_item *item,
 CONFIGFS_ATTR(fsg_opts_, num_buffers);
 #endif
 
+static ssize_t fsg_opts_buflen_show(struct config_item *item, char *page)
+{
+	struct fsg_opts *opts = to_fsg_opts(item);
+	int result;
+
+	mutex_lock(&opts->lock);
+	result = sprintf(page, "%u\n", opts->common->fsg_buflen);
+	mutex_unlock(&opts->lock);
+
+	return result;
+}
+
+static ssize_t fsg_opts_buflen_store(struct config_item *item,
+				     const char *page, size_t len)
+{
+	struct fsg_opts *opts = to_fsg_opts(item);
+	unsigned int buflen;
+	int ret;
+
+	mutex_lock(&opts->lock);
+	if (opts->refcnt) {
+		ret = -EBUSY;
+		goto end;
+	}
+	ret = kstrtouint(page, 0, &buflen);
+	if (ret)
+		goto end;
+
+	ret = fsg_common_set_buflen(opts->common, buflen);
+	if (ret)
+		goto end;
+	ret = len;
+
+end:
+	mutex_unlock(&opts->lock);
+	return ret;
+}
+
+CONFIGFS_ATTR(fsg_opts_, buflen);
+
 static struct configfs_attribute *fsg_attrs[] = {
 	&fsg_opts_attr_stall,
 #ifdef CONFIG_USB_GADGET_DEBUG_FILES
 	&fsg_opts_attr_num_buffers,
 #endif
+	&fsg_opts_attr_buflen,
 	NULL,
 };
 
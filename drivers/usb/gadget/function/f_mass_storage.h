@@ -119,6 +119,8 @@ void fsg_common_set_sysfs(struct fsg_common *common, bool sysfs);
 
 int fsg_common_set_num_buffers(struct fsg_common *common, unsigned int n);
 
+int fsg_common_set_buflen(struct fsg_common *common, unsigned int len);
+
 void fsg_common_free_buffers(struct fsg_common *common);
 
 int fsg_common_set_cdev(struct fsg_common *common,
@@ -370,7 +370,9 @@ static struct usb_gadget_strings *rndis_strings[] = {
 static struct sk_buff *rndis_add_header(struct gether *port,
 					struct sk_buff *skb)
 {
+	struct rndis_packet_msg_type *header;
 	struct sk_buff *skb2;
+	unsigned int len;
 
 	if (!skb)
 		return NULL;
@@ -379,6 +381,18 @@ static struct sk_buff *rndis_add_header(struct gether *port,
 	rndis_add_hdr(skb2);
 
 	dev_kfree_skb(skb);
+
+	/*
+	 * Messages packed into one transfer must each start on an 8 byte
+	 * boundary; MessageLength covers the padding, DataLength doesn't.
+	 */
+	if (skb2 && port->tx_aggr_max && !IS_ALIGNED(skb2->len, 8)) {
+		len = ALIGN(skb2->len, 8);
+		if (skb_put_padto(skb2, len))
+			return NULL;
+		header = (void *)skb2->data;
+		header->MessageLength = cpu_to_le32(len);
+	}
 	return skb2;
 }
 
@@ -590,6 +604,7 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 		 * code -- gether_updown(...bool) maybe -- to do it right.
 		 */
 		rndis->port.cdc_filter = 0;
+		rndis->port.tx_aggr_max = 0;
 
 		DBG(cdev, "RNDIS RX/TX early activation ... \n");
 		net = gether_connect(&rndis->port);
@@ -598,6 +613,8 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 
 		rndis_set_param_dev(rndis->params, net,
 				&rndis->port.cdc_filter);
+		rndis_set_param_max_xfer(rndis->params,
+				&rndis->port.tx_aggr_max);
 	} else
 		goto fail;
 
@@ -1243,6 +1243,7 @@ afunc_bind(struct usb_configuration *cfg, struct usb_function *fn)
 		agdev->params.c_fu.volume_res = uac2_opts->c_volume_res;
 	}
 	agdev->params.req_number = uac2_opts->req_number;
+	agdev->params.req_batch = uac2_opts->req_batch;
 	agdev->params.fb_max = uac2_opts->fb_max;
 
 	if (FUOUT_EN(uac2_opts) || FUIN_EN(uac2_opts))
@@ -1856,6 +1857,7 @@ UAC2_ATTRIBUTE(u32, c_srate);
 UAC2_ATTRIBUTE_SYNC(c_sync);
 UAC2_ATTRIBUTE(u32, c_ssize);
 UAC2_ATTRIBUTE(u32, req_number);
+UAC2_ATTRIBUTE(u32, req_batch);
 
 UAC2_ATTRIBUTE(bool, p_mute_present);
 UAC2_ATTRIBUTE(bool, p_volume_present);
@@ -1879,6 +1881,7 @@ static struct configfs_attribute *f_uac2_attrs[] = {
 	&f_uac2_opts_attr_c_ssize,
 	&f_uac2_opts_attr_c_sync,
 	&f_uac2_opts_attr_req_number,
+	&f_uac2_opts_attr_req_batch,
 	&f_uac2_opts_attr_fb_max,
 
 	&f_uac2_opts_attr_p_mute_present,
@@ -1945,6 +1948,7 @@ static struct usb_function_instance *afunc_alloc_inst(void)
 	opts->c_volume_res = UAC2_DEF_RES_DB;
 
 	opts->req_number = UAC2_DEF_REQ_NUM;
+	opts->req_batch = UAC2_DEF_REQ_BATCH;
 	opts->fb_max = UAC2_DEF_FB_MAX;
 	return &opts->func_inst;
 }
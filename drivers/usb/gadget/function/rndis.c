@@ -566,6 +566,10 @@ static int rndis_init_response(struct rndis_params *params,
 		return -ENOMEM;
 	resp = (rndis_init_cmplt_type *)r->buf;
 
+	/* the host's receive limit also bounds packed device-to-host transfers */
+	if (params->max_xfer)
+		*params->max_xfer = le32_to_cpu(buf->MaxTransferSize);
+
 	resp->MessageType = cpu_to_le32(RNDIS_MSG_INIT_C);
 	resp->MessageLength = cpu_to_le32(52);
 	resp->RequestID = buf->RequestID; /* Still LE in msg buffer */
@@ -970,6 +974,14 @@ int rndis_set_param_dev(struct rndis_params *params, struct net_device *dev,
 }
 EXPORT_SYMBOL_GPL(rndis_set_param_dev);
 
+void rndis_set_param_max_xfer(struct rndis_params *params, u32 *max_xfer)
+{
+	pr_debug("%s:\n", __func__);
+
+	params->max_xfer = max_xfer;
+}
+EXPORT_SYMBOL_GPL(rndis_set_param_max_xfer);
+
 int rndis_set_param_vendor(struct rndis_params *params, u32 vendorID,
 			   const char *vendorDescr)
 {
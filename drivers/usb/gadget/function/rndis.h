@@ -167,6 +167,7 @@ typedef struct rndis_params {
 
 	const u8		*host_mac;
 	u16			*filter;
+	u32			*max_xfer;
 	struct net_device	*dev;
 
 	u32			vendorID;
@@ -183,6 +184,7 @@ struct rndis_params *rndis_register(void (*resp_avail)(void *v), void *v);
 void rndis_deregister(struct rndis_params *params);
 int  rndis_set_param_dev(struct rndis_params *params, struct net_device *dev,
 			 u16 *cdc_filter);
+void rndis_set_param_max_xfer(struct rndis_params *params, u32 *max_xfer);
 int  rndis_set_param_vendor(struct rndis_params *params, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium(struct rndis_params *params, u32 medium,
@@ -116,6 +116,7 @@ struct fsg_lun {
 	unsigned int	blkbits; /* Bits of logical block size
 						       of bound block device */
 	unsigned int	blksize; /* logical block size of bound block device */
+	loff_t		read_end; /* end of the last READ, for readahead */
 	struct device	dev;
 	const char	*name;		/* "lun.name" */
 	const char	**name_pfx;	/* "function.name" */
@@ -129,6 +130,8 @@ static inline bool fsg_lun_is_open(struct fsg_lun *curlun)
 
 /* Default size of buffer length. */
 #define FSG_BUFLEN	((u32)16384)
+/* Largest buffer length that can be configured. */
+#define FSG_BUFLEN_MAX	((u32)262144)
 
 /* Maximal number of LUNs supported in mass storage function */
 #define FSG_MAX_LUNS	16
@@ -33,6 +33,17 @@ enum {
 	UAC_VOLUME_CTRL,
 };
 
+struct uac_rtd_params;
+
+/* One preallocated isochronous request */
+struct uac_req {
+	struct uac_rtd_params *pp; /* parent param */
+	struct usb_request *req;
+
+	void *buf;		/* bounce buffer in rbuf */
+	unsigned int ring_bytes; /* ALSA ring bytes carried by this request */
+};
+
 /* Runtime data params for one stream */
 struct uac_rtd_params {
 	struct snd_uac_chip *uac; /* parent chip */
@@ -42,13 +53,14 @@ struct uac_rtd_params {
 
 	/* Ring buffer */
 	ssize_t hw_ptr;
+	ssize_t q_ptr;	/* playback: ring offset of the next request */
 
 	void *rbuf;
 
 	unsigned int pitch;	/* Stream pitch ratio to 1000000 */
 	unsigned int max_psize;	/* MaxPacketSize of endpoint */
 
-	struct usb_request **reqs;
+	struct uac_req *ureqs;
 
 	struct usb_request *req_fback; /* Feedback endpoint request */
 	bool fb_ep_enabled; /* if the ep is enabled */
@@ -146,12 +158,13 @@ static void u_audio_set_fback_frequency(enum usb_device_speed speed,
 
 static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 {
-	unsigned int pending;
-	unsigned int hw_ptr;
+	unsigned int pending, bytes;
+	unsigned int hw_ptr, q_ptr;
 	int status = req->status;
 	struct snd_pcm_substream *substream;
 	struct snd_pcm_runtime *runtime;
-	struct uac_rtd_params *prm = req->context;
+	struct uac_req *ur = req->context;
+	struct uac_rtd_params *prm = ur->pp;
 	struct snd_uac_chip *uac = prm->uac;
 
 	/* i/f shutting down */
@@ -175,14 +188,14 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 
 	/* Do nothing if ALSA isn't active */
 	if (!substream)
-		goto exit;
+		goto idle;
 
 	snd_pcm_stream_lock(substream);
 
 	runtime = substream->runtime;
 	if (!runtime || !snd_pcm_running(substream)) {
 		snd_pcm_stream_unlock(substream);
-		goto exit;
+		goto idle;
 	}
 
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
@@ -207,23 +220,37 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 		}
 
 		req->actual = req->length;
-	}
 
-	hw_ptr = prm->hw_ptr;
-
-	/* Pack USB load in ALSA ring buffer */
-	pending = runtime->dma_bytes - hw_ptr;
+		/*
+		 * The ring data carried by this request is on the bus now,
+		 * so it is only consumed here. Send the next packet
+		 * straight out of the ALSA buffer; it is preallocated for
+		 * the PCM's lifetime, and ALSA does not let the application
+		 * rewrite the ring between hw_ptr and q_ptr. Only a packet
+		 * that wraps around the end of the ring is bounced.
+		 */
+		bytes = ur->ring_bytes;
+		q_ptr = prm->q_ptr;
+		pending = runtime->dma_bytes - q_ptr;
 
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-		if (unlikely(pending < req->actual)) {
-			memcpy(req->buf, runtime->dma_area + hw_ptr, pending);
-			memcpy(req->buf + pending, runtime->dma_area,
-			       req->actual - pending);
+		if (likely(pending >= req->length)) {
+			req->buf = runtime->dma_area + q_ptr;
 		} else {
-			memcpy(req->buf, runtime->dma_area + hw_ptr,
-			       req->actual);
+			req->buf = ur->buf;
+			memcpy(req->buf, runtime->dma_area + q_ptr, pending);
+			memcpy(req->buf + pending, runtime->dma_area,
+			       req->length - pending);
 		}
+
+		ur->ring_bytes = req->length;
+		prm->q_ptr = (q_ptr + req->length) % runtime->dma_bytes;
 	} else {
+		bytes = req->actual;
+		hw_ptr = prm->hw_ptr;
+
+		/* Pack USB load in ALSA ring buffer */
+		pending = runtime->dma_bytes - hw_ptr;
+
 		if (unlikely(pending < req->actual)) {
 			memcpy(runtime->dma_area + hw_ptr, req->buf, pending);
 			memcpy(runtime->dma_area, req->buf + pending,
@@ -235,13 +262,19 @@ static void u_audio_iso_complete(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	/* update hw_ptr after data is copied to memory */
-	prm->hw_ptr = (hw_ptr + req->actual) % runtime->dma_bytes;
+	prm->hw_ptr = (prm->hw_ptr + bytes) % runtime->dma_bytes;
 	hw_ptr = prm->hw_ptr;
 	snd_pcm_stream_unlock(substream);
 
-	if ((hw_ptr % snd_pcm_lib_period_bytes(substream)) < req->actual)
+	if (bytes && (hw_ptr % snd_pcm_lib_period_bytes(substream)) < bytes)
 		snd_pcm_period_elapsed(substream);
 
+	goto exit;
+
+idle:
+	/* Send silence from the bounce buffer until ALSA is running */
+	req->buf = ur->buf;
+	ur->ring_bytes = 0;
 exit:
 	if (usb_ep_queue(ep, req, GFP_ATOMIC))
 		dev_err(uac->card->dev, "%d Error!\n", __LINE__);
@@ -300,6 +333,7 @@ static int uac_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 
 	/* Reset */
 	prm->hw_ptr = 0;
+	prm->q_ptr = 0;
 
 	switch (cmd) {
 	case SNDRV_PCM_TRIGGER_START:
@@ -411,6 +445,21 @@ static const struct snd_pcm_ops uac_pcm_ops = {
 	.prepare = uac_pcm_null,
 };
 
+/*
+ * With req_batch set, only every req_batch-th request (and always the
+ * last one) asks for a completion interrupt, so that the UDC can retire
+ * a whole batch of requests from a single interrupt. The requests are
+ * requeued in order, so the pattern holds for the whole stream.
+ */
+static unsigned int u_audio_req_no_interrupt(struct uac_params *params,
+					     int i)
+{
+	if (params->req_batch <= 1 || i == params->req_number - 1)
+		return 0;
+
+	return (i + 1) % params->req_batch ? 1 : 0;
+}
+
 static inline void free_ep(struct uac_rtd_params *prm, struct usb_ep *ep)
 {
 	struct snd_uac_chip *uac = prm->uac;
@@ -425,16 +474,16 @@ static inline void free_ep(struct uac_rtd_params *prm, struct usb_ep *ep)
 	params = &audio_dev->params;
 
 	for (i = 0; i < params->req_number; i++) {
-		if (prm->reqs[i]) {
-			if (usb_ep_dequeue(ep, prm->reqs[i]))
-				usb_ep_free_request(ep, prm->reqs[i]);
+		if (prm->ureqs[i].req) {
+			if (usb_ep_dequeue(ep, prm->ureqs[i].req))
+				usb_ep_free_request(ep, prm->ureqs[i].req);
 			/*
 			 * If usb_ep_dequeue() cannot successfully dequeue the
 			 * request, the request will be freed by the completion
 			 * callback.
 			 */
 
-			prm->reqs[i] = NULL;
+			prm->ureqs[i].req = NULL;
 		}
 	}
 
@@ -494,21 +543,25 @@ int u_audio_start_capture(struct g_audio *audio_dev)
 	}
 
 	for (i = 0; i < params->req_number; i++) {
-		if (!prm->reqs[i]) {
+		if (!prm->ureqs[i].req) {
 			req = usb_ep_alloc_request(ep, GFP_ATOMIC);
 			if (req == NULL)
 				return -ENOMEM;
 
-			prm->reqs[i] = req;
+			prm->ureqs[i].req = req;
+			prm->ureqs[i].pp = prm;
+			prm->ureqs[i].buf = prm->rbuf + i * ep->maxpacket;
+			prm->ureqs[i].ring_bytes = 0;
 
 			req->zero = 0;
-			req->context = prm;
+			req->context = &prm->ureqs[i];
 			req->length = req_len;
 			req->complete = u_audio_iso_complete;
-			req->buf = prm->rbuf + i * ep->maxpacket;
+			req->buf = prm->ureqs[i].buf;
+			req->no_interrupt = u_audio_req_no_interrupt(params, i);
 		}
 
-		if (usb_ep_queue(ep, prm->reqs[i], GFP_ATOMIC))
+		if (usb_ep_queue(ep, prm->ureqs[i].req, GFP_ATOMIC))
 			dev_err(dev, "%s:%d Error!\n", __func__, __LINE__);
 	}
 
@@ -627,21 +680,25 @@ int u_audio_start_playback(struct g_audio *audio_dev)
 	}
 
 	for (i = 0; i < params->req_number; i++) {
-		if (!prm->reqs[i]) {
+		if (!prm->ureqs[i].req) {
 			req = usb_ep_alloc_request(ep, GFP_ATOMIC);
 			if (req == NULL)
 				return -ENOMEM;
 
-			prm->reqs[i] = req;
+			prm->ureqs[i].req = req;
+			prm->ureqs[i].pp = prm;
+			prm->ureqs[i].buf = prm->rbuf + i * ep->maxpacket;
+			prm->ureqs[i].ring_bytes = 0;
 
 			req->zero = 0;
-			req->context = prm;
+			req->context = &prm->ureqs[i];
 			req->length = req_len;
 			req->complete = u_audio_iso_complete;
-			req->buf = prm->rbuf + i * ep->maxpacket;
+			req->buf = prm->ureqs[i].buf;
+			req->no_interrupt = u_audio_req_no_interrupt(params, i);
 		}
 
-		if (usb_ep_queue(ep, prm->reqs[i], GFP_ATOMIC))
+		if (usb_ep_queue(ep, prm->ureqs[i].req, GFP_ATOMIC))
 			dev_err(dev, "%s:%d Error!\n", __func__, __LINE__);
 	}
 
@@ -998,10 +1055,10 @@ int g_audio_setup(struct g_audio *g_audio, const char *pcm_name,
     uac->c_prm.uac = uac;
 		prm->max_psize = g_audio->out_ep_maxpsize;
 
-		prm->reqs = kcalloc(params->req_number,
-				    sizeof(struct usb_request *),
-				    GFP_KERNEL);
-		if (!prm->reqs) {
+		prm->ureqs = kcalloc(params->req_number,
+				     sizeof(struct uac_req),
+				     GFP_KERNEL);
+		if (!prm->ureqs) {
 			err = -ENOMEM;
 			goto fail;
 		}
@@ -1022,10 +1079,10 @@ int g_audio_setup(struct g_audio *g_audio, const char *pcm_name,
 		uac->p_prm.uac = uac;
 		prm->max_psize = g_audio->in_ep_maxpsize;
 
-		prm->reqs = kcalloc(params->req_number,
-				    sizeof(struct usb_request *),
-				    GFP_KERNEL);
-		if (!prm->reqs) {
+		prm->ureqs = kcalloc(params->req_number,
+				     sizeof(struct uac_req),
+				     GFP_KERNEL);
+		if (!prm->ureqs) {
 			err = -ENOMEM;
 			goto fail;
 		}
@@ -1179,8 +1236,8 @@ int g_audio_setup(struct g_audio *g_audio, const char *pcm_name,
 snd_fail:
 	snd_card_free(card);
 fail:
-	kfree(uac->p_prm.reqs);
-	kfree(uac->c_prm.reqs);
+	kfree(uac->p_prm.ureqs);
+	kfree(uac->c_prm.ureqs);
 	kfree(uac->p_prm.rbuf);
 	kfree(uac->c_prm.rbuf);
 	kfree(uac);
@@ -1204,8 +1261,8 @@ void g_audio_cleanup(struct g_audio *g_audio)
 	if (card)
 		snd_card_free_when_closed(card);
 
-	kfree(uac->p_prm.reqs);
-	kfree(uac->c_prm.reqs);
+	kfree(uac->p_prm.ureqs);
+	kfree(uac->c_prm.ureqs);
 	kfree(uac->p_prm.rbuf);
 	kfree(uac->c_prm.rbuf);
 	kfree(uac);
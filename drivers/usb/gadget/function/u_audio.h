@@ -45,6 +45,7 @@ struct uac_params {
 	struct uac_fu_params c_fu;	/* Feature Unit parameters */
 
 	int req_number; /* number of preallocated requests */
+	int req_batch;	/* requests completed per interrupt, 0 or 1 for all */
 	int fb_max;	/* upper frequency drift feedback limit per-mil */
 };
 
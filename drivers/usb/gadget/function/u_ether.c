@@ -12,6 +12,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/gfp.h>
+#include <linux/slab.h>
 #include <linux/device.h>
 #include <linux/ctype.h>
 #include <linux/etherdevice.h>
@@ -52,6 +53,14 @@
 #define GETHER_MAX_MTU_SIZE 15412
 #define GETHER_MAX_ETH_FRAME_LEN (GETHER_MAX_MTU_SIZE + ETH_HLEN)
 
+/* Links whose host accepts several messages per transfer (RNDIS) may get
+ * frames packed together while the IN endpoint is busy; this bounds the
+ * size of such a transfer, on top of the limit the host announced.
+ */
+static unsigned tx_aggr_size = 8192;
+module_param(tx_aggr_size, uint, 0644);
+MODULE_PARM_DESC(tx_aggr_size, "max bytes of packed tx frames per transfer, 0 to disable");
+
 struct eth_dev {
 	/* lock is held while accessing port_usb
 	 */
@@ -64,8 +73,12 @@ struct eth_dev {
 	spinlock_t		req_lock;	/* guard {rx,tx}_reqs */
 	struct list_head	tx_reqs, rx_reqs;
 	atomic_t		tx_qlen;
+	struct usb_request	*tx_aggr;	/* being filled, not queued */
+	unsigned		tx_aggr_room;
+	unsigned		tx_aggr_frames;
 
 	struct sk_buff_head	rx_frames;
+	struct page_frag_cache	rx_frag;	/* guarded by lock */
 
 	unsigned		qmult;
 
@@ -91,6 +104,30 @@ struct eth_dev {
 
 #define RX_EXTRA	20	/* bytes guarding against rx overflows */
 
+/* Receive buffers that fit in a page come from a per-link fragment cache
+ * and only get an skb built around them once data has landed, so queued
+ * requests don't pin skb heads and pages get reused as the stack frees
+ * the frames.  Bigger buffers (jumbo MTU, NCM) use ordinary skbs.
+ */
+static inline unsigned rx_frag_truesize(unsigned len)
+{
+	return SKB_DATA_ALIGN(NET_SKB_PAD + NET_IP_ALIGN + len) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+}
+
+static inline bool rx_is_frag(struct usb_request *req)
+{
+	return rx_frag_truesize(req->length) <= PAGE_SIZE;
+}
+
+static void rx_buf_free(struct usb_request *req)
+{
+	if (rx_is_frag(req))
+		page_frag_free(req->context);
+	else
+		dev_kfree_skb_any(req->context);
+}
+
 #define DEFAULT_QLEN	2	/* double buffering by default */
 
 /* for dual-speed hardware, use deeper queues at high/super speed */
@@ -180,6 +217,7 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 {
 	struct usb_gadget *g = dev->gadget;
 	struct sk_buff	*skb;
+	void		*buf = NULL;
 	int		retval = -ENOMEM;
 	size_t		size = 0;
 	struct usb_ep	*out;
@@ -219,12 +257,28 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 
 	if (dev->port_usb->is_fixed)
 		size = max_t(size_t, size, dev->port_usb->fixed_out_len);
+
+	req->length = size;
+	if (rx_is_frag(req))
+		buf = page_frag_alloc(&dev->rx_frag, rx_frag_truesize(size),
+				      GFP_ATOMIC);
 	spin_unlock_irqrestore(&dev->lock, flags);
 
-	skb = __netdev_alloc_skb(dev->net, size + NET_IP_ALIGN, gfp_flags);
-	if (skb == NULL) {
-		DBG(dev, "no rx skb\n");
+	if (buf) {
+		req->context = buf;
+		buf += NET_SKB_PAD;
+	} else if (rx_is_frag(req)) {
+		DBG(dev, "no rx buffer\n");
 		goto enomem;
+	} else {
+		skb = __netdev_alloc_skb(dev->net, size + NET_IP_ALIGN,
+					 gfp_flags);
+		if (skb == NULL) {
+			DBG(dev, "no rx skb\n");
+			goto enomem;
+		}
+		req->context = skb;
+		buf = skb->data;
 	}
 
 	/* Some platforms perform better when IP packets are aligned,
@@ -232,12 +286,10 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 * RNDIS headers involve variable numbers of LE32 values.
 	 */
 	if (likely(!dev->no_skb_reserve))
-		skb_reserve(skb, NET_IP_ALIGN);
+		buf += NET_IP_ALIGN;
 
-	req->buf = skb->data;
-	req->length = size;
+	req->buf = buf;
 	req->complete = rx_complete;
-	req->context = skb;
 
 	retval = usb_ep_queue(out, req, gfp_flags);
 	if (retval == -ENOMEM)
@@ -245,8 +297,8 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 		defer_kevent(dev, WORK_RX_MEMORY);
 	if (retval) {
 		DBG(dev, "rx submit --> %d\n", retval);
-		if (skb)
-			dev_kfree_skb_any(skb);
+		if (buf)
+			rx_buf_free(req);
 		spin_lock_irqsave(&dev->req_lock, flags);
 		list_add(&req->list, &dev->rx_reqs);
 		spin_unlock_irqrestore(&dev->req_lock, flags);
@@ -256,7 +308,7 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 
 static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 {
-	struct sk_buff	*skb = req->context, *skb2;
+	struct sk_buff	*skb = NULL, *skb2;
 	struct eth_dev	*dev = ep->driver_data;
 	int		status = req->status;
 
@@ -264,6 +316,17 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 
 	/* normal completion */
 	case 0:
+		if (rx_is_frag(req)) {
+			skb = build_skb(req->context,
+					rx_frag_truesize(req->length));
+			if (unlikely(!skb)) {
+				dev->net->stats.rx_dropped++;
+				goto drop;
+			}
+			skb_reserve(skb, req->buf - req->context);
+		} else {
+			skb = req->context;
+		}
 		skb_put(skb, req->actual);
 
 		if (dev->unwrap) {
@@ -319,7 +382,7 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 		DBG(dev, "rx %s reset\n", ep->name);
 		defer_kevent(dev, WORK_RX_MEMORY);
 quiesce:
-		dev_kfree_skb_any(skb);
+		rx_buf_free(req);
 		goto clean;
 
 	/* data overrun */
@@ -330,11 +393,11 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 	default:
 		dev->net->stats.rx_errors++;
 		DBG(dev, "rx status %d\n", status);
+drop:
+		rx_buf_free(req);
 		break;
 	}
 
-	if (skb)
-		dev_kfree_skb_any(skb);
 	if (!netif_running(dev->net)) {
 clean:
 		spin_lock(&dev->req_lock);
@@ -439,6 +502,98 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+static void tx_complete(struct usb_ep *ep, struct usb_request *req);
+
+/*
+ * Queue the packed transfer being filled, if any.  Called with req_lock
+ * held, so frames sent on their own can't overtake it and tx_qlen can't
+ * drop to zero behind our back leaving it stranded.
+ */
+static void tx_aggr_flush(struct eth_dev *dev, struct usb_ep *in)
+{
+	struct usb_request	*req = dev->tx_aggr;
+	int			length;
+
+	if (!req)
+		return;
+	dev->tx_aggr = NULL;
+
+	length = req->length;
+	req->zero = 1;
+	if (!dev->zlp && (length % in->maxpacket) == 0)
+		length++;
+	req->length = length;
+
+	if (usb_ep_queue(in, req, GFP_ATOMIC)) {
+		dev->net->stats.tx_dropped += dev->tx_aggr_frames;
+		kfree(req->buf);
+		list_add(&req->list, &dev->tx_reqs);
+		return;
+	}
+	dev->net->stats.tx_packets += dev->tx_aggr_frames;
+	netif_trans_update(dev->net);
+	atomic_inc(&dev->tx_qlen);
+}
+
+/*
+ * Copy a wrapped frame into a packed transfer instead of giving it a
+ * transfer of its own.  Only done while the IN endpoint has transfers in
+ * flight; the next completion queues whatever was gathered, so packing
+ * costs no latency on an idle link.  Returns true if the frame (and @req)
+ * were consumed.
+ */
+static bool tx_aggr_add(struct eth_dev *dev, struct usb_ep *in,
+			struct usb_request *req, struct sk_buff *skb,
+			unsigned aggr_max)
+{
+	struct usb_request	*aggr;
+	unsigned long		flags;
+	void			*buf;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	aggr = dev->tx_aggr;
+	if (aggr && aggr->length + skb->len > dev->tx_aggr_room) {
+		tx_aggr_flush(dev, in);
+		aggr = NULL;
+	}
+
+	if (aggr) {
+		memcpy(aggr->buf + aggr->length, skb->data, skb->len);
+		aggr->length += skb->len;
+		dev->tx_aggr_frames++;
+
+		if (list_empty(&dev->tx_reqs))
+			netif_start_queue(dev->net);
+		list_add(&req->list, &dev->tx_reqs);
+		goto consumed;
+	}
+
+	if (!atomic_read(&dev->tx_qlen) || 2 * skb->len > aggr_max)
+		goto out;
+
+	/* one spare byte for the zlp workaround in tx_aggr_flush() */
+	buf = kmalloc(aggr_max + 1, GFP_ATOMIC);
+	if (!buf)
+		goto out;
+
+	memcpy(buf, skb->data, skb->len);
+	req->buf = buf;
+	req->length = skb->len;
+	req->context = NULL;
+	req->complete = tx_complete;
+	dev->tx_aggr = req;
+	dev->tx_aggr_room = aggr_max;
+	dev->tx_aggr_frames = 1;
+
+consumed:
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+	dev_consume_skb_any(skb);
+	return true;
+out:
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+	return false;
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
@@ -454,16 +609,26 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 		dev_kfree_skb_any(skb);
 		break;
 	case 0:
-		dev->net->stats.tx_bytes += skb->len;
-		dev_consume_skb_any(skb);
+		if (skb) {
+			dev->net->stats.tx_bytes += skb->len;
+			dev_consume_skb_any(skb);
+		} else {
+			dev->net->stats.tx_bytes += req->actual;
+		}
 	}
-	dev->net->stats.tx_packets++;
+	/* packed transfers had their frames counted when queued */
+	if (skb)
+		dev->net->stats.tx_packets++;
+	else
+		kfree(req->buf);
 
 	spin_lock(&dev->req_lock);
 	list_add(&req->list, &dev->tx_reqs);
+	atomic_dec(&dev->tx_qlen);
+	if (req->status != -ESHUTDOWN)
+		tx_aggr_flush(dev, ep);
 	spin_unlock(&dev->req_lock);
 
-	atomic_dec(&dev->tx_qlen);
 	if (netif_carrier_ok(dev->net))
 		netif_wake_queue(dev->net);
 }
@@ -483,14 +648,18 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	unsigned long		flags;
 	struct usb_ep		*in;
 	u16			cdc_filter;
+	unsigned		aggr_max;
 
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb) {
 		in = dev->port_usb->in_ep;
 		cdc_filter = dev->port_usb->cdc_filter;
+		aggr_max = min(dev->port_usb->tx_aggr_max,
+			       READ_ONCE(tx_aggr_size));
 	} else {
 		in = NULL;
 		cdc_filter = 0;
+		aggr_max = 0;
 	}
 	spin_unlock_irqrestore(&dev->lock, flags);
 
@@ -563,6 +732,9 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		}
 	}
 
+	if (aggr_max && tx_aggr_add(dev, in, req, skb, aggr_max))
+		return NETDEV_TX_OK;
+
 	length = skb->len;
 	req->buf = skb->data;
 	req->context = skb;
@@ -1064,6 +1236,9 @@ void gether_cleanup(struct eth_dev *dev)
 
 	unregister_netdev(dev->net);
 	flush_work(&dev->work);
+	if (dev->rx_frag.va)
+		__page_frag_cache_drain(virt_to_head_page(dev->rx_frag.va),
+					dev->rx_frag.pagecnt_bias);
 	free_netdev(dev->net);
 }
 EXPORT_SYMBOL_GPL(gether_cleanup);
@@ -1182,6 +1357,12 @@ void gether_disconnect(struct gether *link)
 	 */
 	usb_ep_disable(link->in_ep);
 	spin_lock(&dev->req_lock);
+	if (dev->tx_aggr) {
+		dev->net->stats.tx_dropped += dev->tx_aggr_frames;
+		kfree(dev->tx_aggr->buf);
+		list_add(&dev->tx_aggr->list, &dev->tx_reqs);
+		dev->tx_aggr = NULL;
+	}
 	while (!list_empty(&dev->tx_reqs)) {
 		req = list_first_entry(&dev->tx_reqs, struct usb_request, list);
 		list_del(&req->list);
@@ -70,6 +70,10 @@ struct gether {
 	u32				fixed_out_len;
 	u32				fixed_in_len;
 	bool				supports_multi_frame;
+	/* nonzero if several wrapped frames may share one IN transfer
+	 * of up to this many bytes
+	 */
+	u32				tx_aggr_max;
 	struct sk_buff			*(*wrap)(struct gether *port,
 						struct sk_buff *skb);
 	int				(*unwrap)(struct gether *port,
@@ -30,6 +30,7 @@
 #define UAC2_DEF_RES_DB		(1*256)		/* 1 dB */
 
 #define UAC2_DEF_REQ_NUM 2
+#define UAC2_DEF_REQ_BATCH 1
 #define UAC2_DEF_FB_MAX 5
 #define UAC2_DEF_INT_REQ_NUM	10
 
@@ -56,6 +57,7 @@ struct f_uac2_opts {
 	s16				c_volume_res;
 
 	int				req_number;
+	int				req_batch;
 	int				fb_max;
 	bool			bound;
 
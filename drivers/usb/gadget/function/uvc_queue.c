@@ -142,7 +142,12 @@ int uvcg_queue_init(struct uvc_video_queue *queue, struct device *dev, enum v4l2
 	queue->queue.buf_struct_size = sizeof(struct uvc_buffer);
 	queue->queue.ops = &uvc_queue_qops;
 	queue->queue.lock = lock;
-	if (cdev->gadget->sg_supported) {
+	/*
+	 * Payload headers are referenced from their own scatterlist entry,
+	 * which only works if the UDC packs segments into full packets.
+	 */
+	if (cdev->gadget->sg_supported &&
+	    !cdev->gadget->quirk_sg_segment_packets) {
 		queue->queue.mem_ops = &vb2_dma_sg_memops;
 		queue->use_sg = 1;
 	} else {
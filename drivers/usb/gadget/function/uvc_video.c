@@ -97,16 +97,112 @@ uvc_video_encode_bulk(struct usb_request *req, struct uvc_video *video,
 		video->payload_size = 0;
 }
 
+/*
+ * Point up to @len bytes of the video buffer at the @nents scatterlist
+ * entries starting at @sg, without copying the data. Returns the number of
+ * bytes referenced, the number of entries used is stored in @nsgs.
+ */
+static unsigned int
+uvc_video_encode_sg_data(struct uvc_buffer *buf, struct scatterlist *sg,
+		unsigned int nents, unsigned int len, unsigned int *nsgs)
+{
+	unsigned int sg_left, part;
+	unsigned int done = 0;
+	struct scatterlist *iter;
+	unsigned int i;
+
+	for_each_sg(sg, iter, nents, i) {
+		if (!len || !buf->sg || !buf->sg->length)
+			break;
+
+		sg_left = buf->sg->length - buf->offset;
+		part = min_t(unsigned int, len, sg_left);
+
+		sg_set_page(iter, sg_page(buf->sg), part, buf->offset);
+
+		if (part == sg_left) {
+			buf->offset = 0;
+			buf->sg = sg_next(buf->sg);
+		} else {
+			buf->offset += part;
+		}
+		len -= part;
+		done += part;
+	}
+
+	*nsgs = i;
+	return done;
+}
+
+static void
+uvc_video_encode_bulk_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	struct uvc_request *ureq = req->context;
+	struct scatterlist *sg = ureq->sgt.sgl;
+	unsigned int nents = ureq->sgt.nents;
+	unsigned int len = video->req_size;
+	unsigned int header_len = 0;
+	unsigned int nbytes;
+	unsigned int nsgs;
+
+	sg_init_table(sg, nents);
+
+	/* Add a header at the beginning of the payload. */
+	if (video->payload_size == 0) {
+		header_len = uvc_video_encode_header(video, buf, ureq->header,
+						     len);
+		sg_set_buf(sg, ureq->header, header_len);
+		video->payload_size += header_len;
+		len -= header_len;
+		sg = sg_next(sg);
+		nents--;
+	}
+
+	/*
+	 * Reference video data. The scatterlist covers the whole plane, and a
+	 * compressed frame may use only part of it.
+	 */
+	len = min(video->max_payload_size - video->payload_size, len);
+	len = min(buf->bytesused - video->queue.buf_used, len);
+	nbytes = uvc_video_encode_sg_data(buf, sg, nents, len, &nsgs);
+
+	video->queue.buf_used += nbytes;
+	video->payload_size += nbytes;
+
+	req->buf = NULL;
+	req->sg	= ureq->sgt.sgl;
+	req->num_sgs = nsgs + (header_len ? 1 : 0);
+	req->length = header_len + nbytes;
+	req->zero = video->payload_size == video->max_payload_size;
+
+	if (buf->bytesused == video->queue.buf_used || !buf->sg) {
+		video->queue.buf_used = 0;
+		buf->state = UVC_BUF_STATE_DONE;
+		buf->offset = 0;
+		list_del(&buf->queue);
+		video->fid ^= UVC_STREAM_FID;
+		ureq->last_buf = buf;
+
+		video->payload_size = 0;
+	}
+
+	if (video->payload_size == video->max_payload_size ||
+	    video->queue.flags & UVC_QUEUE_DROP_INCOMPLETE ||
+	    buf->bytesused == video->queue.buf_used)
+		video->payload_size = 0;
+}
+
 static void
 uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
 		struct uvc_buffer *buf)
 {
 	unsigned int pending = buf->bytesused - video->queue.buf_used;
 	struct uvc_request *ureq = req->context;
-	struct scatterlist *sg, *iter;
+	struct scatterlist *sg;
 	unsigned int len = video->req_size;
-	unsigned int sg_left, part = 0;
-	unsigned int i;
+	unsigned int nbytes;
+	unsigned int nsgs;
 	int header_len;
 
 	sg = ureq->sgt.sgl;
@@ -121,37 +217,17 @@ uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
 	if (pending <= len)
 		len = pending;
 
-	req->length = (len == pending) ?
-		len + header_len : video->req_size;
-
 	/* Init the pending sgs with payload */
-	sg = sg_next(sg);
-
-	for_each_sg(sg, iter, ureq->sgt.nents - 1, i) {
-		if (!len || !buf->sg || !buf->sg->length)
-			break;
-
-		sg_left = buf->sg->length - buf->offset;
-		part = min_t(unsigned int, len, sg_left);
-
-		sg_set_page(iter, sg_page(buf->sg), part, buf->offset);
-
-		if (part == sg_left) {
-			buf->offset = 0;
-			buf->sg = sg_next(buf->sg);
-		} else {
-			buf->offset += part;
-		}
-		len -= part;
-	}
+	nbytes = uvc_video_encode_sg_data(buf, sg_next(sg),
+					  ureq->sgt.nents - 1, len, &nsgs);
 
 	/* Assign the video data with header. */
 	req->buf = NULL;
 	req->sg	= ureq->sgt.sgl;
-	req->num_sgs = i + 1;
+	req->num_sgs = nsgs + 1;
 
-	req->length -= len;
-	video->queue.buf_used += req->length - header_len;
+	req->length = header_len + nbytes;
+	video->queue.buf_used += nbytes;
 
 	if (buf->bytesused == video->queue.buf_used || !buf->sg ||
 			video->queue.flags & UVC_QUEUE_DROP_INCOMPLETE) {
@@ -443,7 +519,8 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 		return ret;
 
 	if (video->max_payload_size) {
-		video->encode = uvc_video_encode_bulk;
+		video->encode = video->queue.use_sg ?
+			uvc_video_encode_bulk_sg : uvc_video_encode_bulk;
 		video->payload_size = 0;
 	} else
 		video->encode = video->queue.use_sg ?
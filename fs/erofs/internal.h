@@ -56,6 +56,12 @@ struct erofs_mount_opts {
 
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+
+	/* min pclusters per CPU to split a decompression queue, 0 - off */
+	unsigned int parallel_decompress;
+
+	/* budget of the managed cache in pages, 0 - unlimited */
+	unsigned long max_cache_pages;
 #endif
 	unsigned int mount_opt;
 };
@@ -88,6 +94,9 @@ struct erofs_sb_info {
 
 	/* pseudo inode to manage cached pages */
 	struct inode *managed_cache;
+	/* lookups of compressed pages in the managed cache */
+	atomic_long_t managed_hits;
+	atomic_long_t managed_misses;
 
 	struct erofs_sb_lz4_info lz4;
 #endif	/* CONFIG_EROFS_FS_ZIP */
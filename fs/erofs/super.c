@@ -343,6 +343,7 @@ static void erofs_default_options(struct erofs_fs_context *ctx)
 	ctx->opt.cache_strategy = EROFS_ZIP_CACHE_READAROUND;
 	ctx->opt.max_sync_decompress_pages = 3;
 	ctx->opt.readahead_sync_decompress = false;
+	ctx->opt.parallel_decompress = 0;
 #endif
 #ifdef CONFIG_EROFS_FS_XATTR
 	set_opt(&ctx->opt, XATTR_USER);
@@ -358,6 +359,9 @@ enum {
 	Opt_cache_strategy,
 	Opt_dax,
 	Opt_dax_enum,
+	Opt_max_sync_decompress_pages,
+	Opt_parallel_decompress,
+	Opt_cache_budget,
 	Opt_err
 };
 
@@ -381,6 +385,10 @@ static const struct fs_parameter_spec erofs_fs_parameters[] = {
 		     erofs_param_cache_strategy),
 	fsparam_flag("dax",             Opt_dax),
 	fsparam_enum("dax",		Opt_dax_enum, erofs_dax_param_enums),
+	fsparam_u32("max_sync_decompress_pages",
+		    Opt_max_sync_decompress_pages),
+	fsparam_u32("parallel_decompress",	Opt_parallel_decompress),
+	fsparam_string("cache_budget",	Opt_cache_budget),
 	{}
 };
 
@@ -414,6 +422,8 @@ static int erofs_fc_parse_param(struct fs_context *fc,
 {
 	struct erofs_fs_context *ctx __maybe_unused = fc->fs_private;
 	struct fs_parse_result result;
+	unsigned long long budget __maybe_unused;
+	char *end __maybe_unused;
 	int opt;
 
 	opt = fs_parse(fc, erofs_fs_parameters, param, &result);
@@ -456,6 +466,32 @@ static int erofs_fc_parse_param(struct fs_context *fc,
 		if (!erofs_fc_set_dax_mode(fc, result.uint_32))
 			return -EINVAL;
 		break;
+	case Opt_max_sync_decompress_pages:
+#ifdef CONFIG_EROFS_FS_ZIP
+		ctx->opt.max_sync_decompress_pages = result.uint_32;
+#else
+		errorfc(fc, "compression not supported, max_sync_decompress_pages ignored");
+#endif
+		break;
+	case Opt_parallel_decompress:
+#ifdef CONFIG_EROFS_FS_ZIP
+		ctx->opt.parallel_decompress = result.uint_32;
+#else
+		errorfc(fc, "compression not supported, parallel_decompress ignored");
+#endif
+		break;
+	case Opt_cache_budget:
+#ifdef CONFIG_EROFS_FS_ZIP
+		budget = memparse(param->string, &end);
+		if (end == param->string || *end) {
+			errorfc(fc, "invalid cache_budget %s", param->string);
+			return -EINVAL;
+		}
+		ctx->opt.max_cache_pages = budget >> PAGE_SHIFT;
+#else
+		errorfc(fc, "compression not supported, cache_budget ignored");
+#endif
+		break;
 	default:
 		return -ENOPARAM;
 	}
@@ -782,6 +818,15 @@ static int erofs_show_options(struct seq_file *seq, struct dentry *root)
 		seq_puts(seq, ",cache_strategy=readahead");
 	else if (opt->cache_strategy == EROFS_ZIP_CACHE_READAROUND)
 		seq_puts(seq, ",cache_strategy=readaround");
+	if (opt->max_sync_decompress_pages != 3)
+		seq_printf(seq, ",max_sync_decompress_pages=%u",
+			   opt->max_sync_decompress_pages);
+	if (opt->parallel_decompress)
+		seq_printf(seq, ",parallel_decompress=%u",
+			   opt->parallel_decompress);
+	if (opt->max_cache_pages)
+		seq_printf(seq, ",cache_budget=%luk",
+			   opt->max_cache_pages << (PAGE_SHIFT - 10));
 #endif
 	if (test_opt(opt, DAX_ALWAYS))
 		seq_puts(seq, ",dax=always");
@@ -790,12 +835,30 @@ static int erofs_show_options(struct seq_file *seq, struct dentry *root)
 	return 0;
 }
 
+#ifdef CONFIG_EROFS_FS_ZIP
+/* managed cache usage and lookup statistics, see /proc/<pid>/mountstats */
+static int erofs_show_stats(struct seq_file *seq, struct dentry *root)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(root->d_sb);
+
+	seq_printf(seq, "managed_cache pages %lu budget %lu hits %ld misses %ld",
+		   sbi->managed_cache->i_mapping->nrpages,
+		   sbi->opt.max_cache_pages,
+		   atomic_long_read(&sbi->managed_hits),
+		   atomic_long_read(&sbi->managed_misses));
+	return 0;
+}
+#endif
+
 const struct super_operations erofs_sops = {
 	.put_super = erofs_put_super,
 	.alloc_inode = erofs_alloc_inode,
 	.free_inode = erofs_free_inode,
 	.statfs = erofs_statfs,
 	.show_options = erofs_show_options,
+#ifdef CONFIG_EROFS_FS_ZIP
+	.show_stats = erofs_show_stats,
+#endif
 };
 
 module_init(erofs_module_init);
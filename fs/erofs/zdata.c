@@ -123,9 +123,12 @@ typedef tagptr1_t compressed_page_t;
 	tagptr_fold(compressed_page_t, page, 1)
 
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
+/* per-CPU workers for the slices of a split decompression queue */
+static struct workqueue_struct *z_erofs_pcpu_workqueue __read_mostly;
 
 void z_erofs_exit_zip_subsystem(void)
 {
+	destroy_workqueue(z_erofs_pcpu_workqueue);
 	destroy_workqueue(z_erofs_workqueue);
 	z_erofs_destroy_pcluster_pool();
 }
@@ -141,7 +144,16 @@ static inline int z_erofs_init_workqueue(void)
 	z_erofs_workqueue = alloc_workqueue("erofs_unzipd",
 					    WQ_UNBOUND | WQ_HIGHPRI,
 					    onlinecpus + onlinecpus / 4);
-	return z_erofs_workqueue ? 0 : -ENOMEM;
+	if (!z_erofs_workqueue)
+		return -ENOMEM;
+
+	z_erofs_pcpu_workqueue = alloc_workqueue("erofs_unzipd_pcpu",
+						 WQ_HIGHPRI, 0);
+	if (!z_erofs_pcpu_workqueue) {
+		destroy_workqueue(z_erofs_workqueue);
+		return -ENOMEM;
+	}
+	return 0;
 }
 
 int __init z_erofs_init_zip_subsystem(void)
@@ -238,6 +250,7 @@ static void preload_compressed_pages(struct z_erofs_collector *clt,
 				     enum z_erofs_cache_alloctype type,
 				     struct list_head *pagepool)
 {
+	struct erofs_sb_info *const sbi = EROFS_SB(mc->host->i_sb);
 	struct z_erofs_pcluster *pcl = clt->pcl;
 	bool standalone = true;
 	gfp_t gfp = (mapping_gfp_mask(mc) & ~__GFP_DIRECT_RECLAIM) |
@@ -262,8 +275,10 @@ static void preload_compressed_pages(struct z_erofs_collector *clt,
 		page = find_get_page(mc, index);
 
 		if (page) {
+			atomic_long_inc(&sbi->managed_hits);
 			t = tag_compressed_page_justfound(page);
 		} else {
+			atomic_long_inc(&sbi->managed_misses);
 			/* I/O is needed, no possible to decompress directly */
 			standalone = false;
 			switch (type) {
@@ -632,9 +647,19 @@ static bool should_alloc_managed_pages(struct z_erofs_decompress_frontend *fe,
 				       unsigned int cachestrategy,
 				       erofs_off_t la)
 {
+	struct erofs_sb_info *const sbi = EROFS_I_SB(fe->inode);
+
 	if (cachestrategy <= EROFS_ZIP_CACHE_DISABLED)
 		return false;
 
+	/*
+	 * Once the budget is used up, read into short-lived pages and leave
+	 * it to reclaim to make room in the (LRU managed) cache again.
+	 */
+	if (sbi->opt.max_cache_pages &&
+	    MNGD_MAPPING(sbi)->nrpages >= sbi->opt.max_cache_pages)
+		return false;
+
 	if (fe->backmost)
 		return true;
 
@@ -1038,11 +1063,114 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	return err;
 }
 
+struct z_erofs_decompress_slice {
+	struct work_struct work;
+	struct super_block *sb;
+	z_erofs_next_pcluster_t head;
+	unsigned int nr;
+};
+
+static void z_erofs_decompress_slice(struct super_block *sb,
+				     z_erofs_next_pcluster_t owned,
+				     unsigned int nr,
+				     struct list_head *pagepool)
+{
+	while (nr--) {
+		struct z_erofs_pcluster *pcl;
+
+		DBG_BUGON(owned == Z_EROFS_PCLUSTER_TAIL_CLOSED);
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+
+		z_erofs_decompress_pcluster(sb, pcl, pagepool);
+	}
+}
+
+static void z_erofs_decompress_slice_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_slice *slice =
+		container_of(work, struct z_erofs_decompress_slice, work);
+	LIST_HEAD(pagepool);
+
+	z_erofs_decompress_slice(slice->sb, slice->head, slice->nr, &pagepool);
+	put_pages_list(&pagepool);
+}
+
+/*
+ * Split a queue of at least 2 * parallel_decompress pclusters into slices
+ * and decompress them on the other online CPUs, keeping the first slice
+ * for the current one.  Returns false if the queue was left untouched.
+ */
+static bool z_erofs_decompress_queue_parallel(
+		const struct z_erofs_decompressqueue *io,
+		struct list_head *pagepool)
+{
+	const unsigned int threshold = EROFS_SB(io->sb)->opt.parallel_decompress;
+	struct z_erofs_decompress_slice *slices;
+	unsigned int total = 0, nr_slices, per_slice, first, i, j;
+	z_erofs_next_pcluster_t owned;
+	int cpu;
+
+	if (!threshold || num_online_cpus() < 2)
+		return false;
+
+	/* chain pointers must all be read before any slice starts */
+	for (owned = io->head; owned != Z_EROFS_PCLUSTER_TAIL_CLOSED;
+	     owned = READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+					    next)->next))
+		++total;
+
+	nr_slices = min(num_online_cpus(), total / threshold);
+	if (nr_slices < 2)
+		return false;
+
+	slices = kcalloc(nr_slices - 1, sizeof(*slices), GFP_NOFS | __GFP_NOWARN);
+	if (!slices)
+		return false;
+
+	per_slice = total / nr_slices;
+	first = total - per_slice * (nr_slices - 1);
+
+	owned = io->head;
+	for (j = 0; j < first; ++j)
+		owned = READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+					       next)->next);
+
+	cpu = raw_smp_processor_id();
+	for (i = 0; i < nr_slices - 1; ++i) {
+		slices[i].sb = io->sb;
+		slices[i].head = owned;
+		slices[i].nr = per_slice;
+		INIT_WORK(&slices[i].work, z_erofs_decompress_slice_work);
+
+		for (j = 0; j < per_slice; ++j)
+			owned = READ_ONCE(container_of(owned,
+					struct z_erofs_pcluster, next)->next);
+	}
+
+	for (i = 0; i < nr_slices - 1; ++i) {
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+		queue_work_on(cpu, z_erofs_pcpu_workqueue, &slices[i].work);
+	}
+
+	z_erofs_decompress_slice(io->sb, io->head, first, pagepool);
+
+	for (i = 0; i < nr_slices - 1; ++i)
+		flush_work(&slices[i].work);
+	kfree(slices);
+	return true;
+}
+
 static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 				     struct list_head *pagepool)
 {
 	z_erofs_next_pcluster_t owned = io->head;
 
+	if (z_erofs_decompress_queue_parallel(io, pagepool))
+		return;
+
 	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
 		struct z_erofs_pcluster *pcl;
 
@@ -31,6 +31,12 @@ MODULE_ALIAS("devname:fuse");
 
 static struct kmem_cache *fuse_req_cachep;
 
+static bool splice_move_pages = true;
+module_param(splice_move_pages, bool, 0644);
+MODULE_PARM_DESC(splice_move_pages,
+ "Steal full pages spliced to /dev/fuse into the page cache even "
+ "without SPLICE_F_MOVE");
+
 static struct fuse_dev *fuse_get_dev(struct file *file)
 {
 	/*
@@ -206,19 +212,37 @@ static unsigned int fuse_req_hash(u64 unique)
 
 /**
  * A new request is available, wake fiq->waitq
+ *
+ * Readers check for pending requests after queueing themselves on
+ * fiq->waitq, so the wakeup doesn't need fiq->lock.  Dropping it first
+ * keeps the remote wakeup out of the critical section that every
+ * requester and every daemon thread contends on.
  */
 static void fuse_dev_wake_and_unlock(struct fuse_iqueue *fiq)
 __releases(fiq->lock)
 {
+	spin_unlock(&fiq->lock);
 	wake_up(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+}
+
+/**
+ * A new request is available and the requester is going to sleep until it
+ * is answered, so let the scheduler hand its CPU over to the daemon
+ */
+static void fuse_dev_wake_sync_and_unlock(struct fuse_iqueue *fiq)
+__releases(fiq->lock)
+{
 	spin_unlock(&fiq->lock);
+	wake_up_interruptible_sync(&fiq->waitq);
+	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 }
 
 const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
 	.wake_forget_and_unlock		= fuse_dev_wake_and_unlock,
 	.wake_interrupt_and_unlock	= fuse_dev_wake_and_unlock,
 	.wake_pending_and_unlock	= fuse_dev_wake_and_unlock,
+	.wake_pending_sync_and_unlock	= fuse_dev_wake_sync_and_unlock,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_fiq_ops);
 
@@ -230,7 +254,11 @@ __releases(fiq->lock)
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
 	list_add_tail(&req->list, &fiq->pending);
-	fiq->ops->wake_pending_and_unlock(fiq);
+	if (!test_bit(FR_BACKGROUND, &req->flags) &&
+	    fiq->ops->wake_pending_sync_and_unlock)
+		fiq->ops->wake_pending_sync_and_unlock(fiq);
+	else
+		fiq->ops->wake_pending_and_unlock(fiq);
 }
 
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
@@ -935,6 +963,8 @@ static int fuse_copy_page(struct fuse_copy_state *cs, struct page **pagep,
 {
 	int err;
 	struct page *page = *pagep;
+	/* notify replies have no request to account the pages to */
+	struct fuse_conn *fc = cs->req ? cs->req->fm->fc : NULL;
 
 	if (page && zeroing && count < PAGE_SIZE)
 		clear_highpage(page);
@@ -950,12 +980,17 @@ static int fuse_copy_page(struct fuse_copy_state *cs, struct page **pagep,
 				if (err)
 					return err;
 			} else {
-				return fuse_ref_page(cs, page, offset, count);
+				err = fuse_ref_page(cs, page, offset, count);
+				if (!err && fc)
+					atomic_long_inc(&fc->splice_ref);
+				return err;
 			}
 		} else if (!cs->len) {
 			if (cs->move_pages && page &&
 			    offset == 0 && count == PAGE_SIZE) {
 				err = fuse_try_move_page(cs, pagep);
+				if (!err && fc)
+					atomic_long_inc(&fc->splice_stolen);
 				if (err <= 0)
 					return err;
 			} else {
@@ -974,6 +1009,8 @@ static int fuse_copy_page(struct fuse_copy_state *cs, struct page **pagep,
 	}
 	if (page && !cs->write)
 		flush_dcache_page(page);
+	if (page && cs->pipebufs && fc)
+		atomic_long_inc(&fc->splice_copied);
 	return 0;
 }
 
@@ -2042,7 +2079,11 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	cs.nr_segs = nbuf;
 	cs.pipe = pipe;
 
-	if (flags & SPLICE_F_MOVE)
+	/*
+	 * fuse_try_move_page() only takes over buffers the pipe lets it
+	 * steal, anything else is copied as before.
+	 */
+	if ((flags & SPLICE_F_MOVE) || READ_ONCE(splice_move_pages))
 		cs.move_pages = 1;
 
 	ret = fuse_dev_do_write(fud, &cs, len);
@@ -45,7 +45,7 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 6
 
 /** List of active connections */
 extern struct list_head fuse_conn_list;
@@ -420,6 +420,13 @@ struct fuse_iqueue_ops {
 	void (*wake_pending_and_unlock)(struct fuse_iqueue *fiq)
 		__releases(fiq->lock);
 
+	/**
+	 * Signal that a request has been queued by a task which is about to
+	 * sleep waiting for the answer (optional)
+	 */
+	void (*wake_pending_sync_and_unlock)(struct fuse_iqueue *fiq)
+		__releases(fiq->lock);
+
 	/**
 	 * Clean up when fuse_iqueue is destroyed
 	 */
@@ -784,6 +791,11 @@ struct fuse_conn {
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
+	/** Request pages stolen from, referenced into and copied to splice pipes */
+	atomic_long_t splice_stolen;
+	atomic_long_t splice_ref;
+	atomic_long_t splice_copied;
+
 	/** Negotiated minor version */
 	unsigned minor;
 
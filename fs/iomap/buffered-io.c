@@ -1251,12 +1251,12 @@ iomap_can_add_to_ioend(struct iomap_writepage_ctx *wpc, loff_t offset,
  * first; otherwise finish off the current ioend and start another.
  */
 static void
-iomap_add_to_ioend(struct inode *inode, loff_t offset, struct page *page,
-		struct iomap_page *iop, struct iomap_writepage_ctx *wpc,
-		struct writeback_control *wbc, struct list_head *iolist)
+iomap_add_to_ioend(struct inode *inode, loff_t offset, unsigned len,
+		struct page *page, struct iomap_page *iop,
+		struct iomap_writepage_ctx *wpc, struct writeback_control *wbc,
+		struct list_head *iolist)
 {
 	sector_t sector = iomap_sector(&wpc->iomap, offset);
-	unsigned len = i_blocksize(inode);
 	unsigned poff = offset & (PAGE_SIZE - 1);
 
 	if (!wpc->ioend || !iomap_can_add_to_ioend(wpc, offset, sector)) {
@@ -1300,8 +1300,10 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	struct iomap_page *iop = iomap_page_create(inode, page);
 	struct iomap_ioend *ioend, *next;
 	unsigned len = i_blocksize(inode);
+	unsigned nblocks = PAGE_SIZE >> inode->i_blkbits;
 	u64 file_offset; /* file offset of page */
-	int error = 0, count = 0, i;
+	u64 map_end;
+	int error = 0, count = 0, i, run;
 	LIST_HEAD(submit_list);
 
 	WARN_ON_ONCE(iop && atomic_read(&iop->write_bytes_pending) != 0);
@@ -1309,11 +1311,13 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	/*
 	 * Walk through the page to find areas to write back. If we run off the
 	 * end of the current map or find the current map invalid, grab a new
-	 * one.
+	 * one.  Runs of uptodate blocks covered by the same mapping are added
+	 * to the ioend in one go.
 	 */
 	for (i = 0, file_offset = page_offset(page);
-	     i < (PAGE_SIZE >> inode->i_blkbits) && file_offset < end_offset;
-	     i++, file_offset += len) {
+	     i < nblocks && file_offset < end_offset;
+	     i += run, file_offset += run * len) {
+		run = 1;
 		if (iop && !test_bit(i, iop->uptodate))
 			continue;
 
@@ -1324,9 +1328,17 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 			continue;
 		if (wpc->iomap.type == IOMAP_HOLE)
 			continue;
-		iomap_add_to_ioend(inode, file_offset, page, iop, wpc, wbc,
-				 &submit_list);
-		count++;
+
+		map_end = min_t(u64, end_offset,
+				wpc->iomap.offset + wpc->iomap.length);
+		while (i + run < nblocks &&
+		       file_offset + run * len < map_end &&
+		       (!iop || test_bit(i + run, iop->uptodate)))
+			run++;
+
+		iomap_add_to_ioend(inode, file_offset, run * len, page, iop,
+				 wpc, wbc, &submit_list);
+		count += run;
 	}
 
 	WARN_ON_ONCE(!wpc->ioend && !list_empty(&submit_list));
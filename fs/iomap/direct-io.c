@@ -10,6 +10,7 @@
 #include <linux/backing-dev.h>
 #include <linux/uio.h>
 #include <linux/task_io_accounting_ops.h>
+#include <linux/hrtimer.h>
 #include "trace.h"
 
 #include "../internal.h"
@@ -23,6 +24,20 @@
 #define IOMAP_DIO_WRITE		(1 << 30)
 #define IOMAP_DIO_DIRTY		(1 << 31)
 
+/*
+ * Polling strategy for synchronous IOCB_HIPRI direct I/O, in the same
+ * spirit as the io_poll_delay queue attribute: -1 spins right away, 0
+ * sleeps for half of the average polled completion time before spinning,
+ * and a positive value sleeps for that many nanoseconds first.
+ */
+static int dio_poll_delay = -1;
+module_param(dio_poll_delay, int, 0644);
+MODULE_PARM_DESC(dio_poll_delay,
+		 "Hybrid polling sleep for HIPRI direct I/O in ns (-1 classic polling, 0 adaptive)");
+
+/* Running average of the completion time of polled direct I/O */
+static u64 iomap_dio_poll_mean_ns;
+
 struct iomap_dio {
 	struct kiocb		*iocb;
 	const struct iomap_dio_ops *dops;
@@ -33,6 +48,7 @@ struct iomap_dio {
 	int			error;
 	size_t			done_before;
 	bool			wait_for_completion;
+	u64			start_ns;
 
 	union {
 		/* used during submission and for synchronous completion: */
@@ -60,6 +76,45 @@ int iomap_dio_iopoll(struct kiocb *kiocb, bool spin)
 }
 EXPORT_SYMBOL_GPL(iomap_dio_iopoll);
 
+/*
+ * Sleep for part of the expected completion time of a polled direct I/O,
+ * so that the following spin only covers its tail.  The completion wakes
+ * us up early if it comes in first.
+ */
+static void iomap_dio_poll_sleep(struct iomap_dio *dio)
+{
+	int delay = READ_ONCE(dio_poll_delay);
+	u64 sleep_ns, elapsed;
+	ktime_t kt;
+
+	if (delay < 0)
+		return;
+	if (delay > 0)
+		sleep_ns = delay;
+	else
+		sleep_ns = READ_ONCE(iomap_dio_poll_mean_ns) >> 1;
+
+	elapsed = ktime_get_ns() - dio->start_ns;
+	if (sleep_ns <= elapsed)
+		return;
+
+	kt = ns_to_ktime(sleep_ns - elapsed);
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	if (READ_ONCE(dio->submit.waiter))
+		schedule_hrtimeout(&kt, HRTIMER_MODE_REL);
+	__set_current_state(TASK_RUNNING);
+}
+
+/* Fold the completion time of a polled direct I/O into the average */
+static void iomap_dio_poll_update(struct iomap_dio *dio)
+{
+	u64 lat = ktime_get_ns() - dio->start_ns;
+	u64 mean = READ_ONCE(iomap_dio_poll_mean_ns);
+
+	WRITE_ONCE(iomap_dio_poll_mean_ns, mean ? mean - (mean >> 3) +
+		   (lat >> 3) : lat);
+}
+
 static void iomap_dio_submit_bio(const struct iomap_iter *iter,
 		struct iomap_dio *dio, struct bio *bio, loff_t pos)
 {
@@ -129,6 +184,9 @@ ssize_t iomap_dio_complete(struct iomap_dio *dio)
 		if (ret > 0)
 			ret += dio->done_before;
 	}
+	trace_iomap_dio_complete(inode, offset, ret,
+				 iocb->ki_flags & IOCB_HIPRI,
+				 ktime_get_ns() - dio->start_ns);
 	kfree(dio);
 	return ret;
 }
@@ -492,6 +550,7 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 		return ERR_PTR(-ENOMEM);
 
 	dio->iocb = iocb;
+	dio->start_ns = ktime_get_ns();
 	atomic_set(&dio->ref, 1);
 	dio->size = 0;
 	dio->i_size = i_size_read(inode);
@@ -638,6 +697,9 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 		if (!wait_for_completion)
 			return ERR_PTR(-EIOCBQUEUED);
 
+		if ((iocb->ki_flags & IOCB_HIPRI) && dio->submit.last_queue)
+			iomap_dio_poll_sleep(dio);
+
 		for (;;) {
 			set_current_state(TASK_UNINTERRUPTIBLE);
 			if (!READ_ONCE(dio->submit.waiter))
@@ -650,6 +712,9 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 				blk_io_schedule();
 		}
 		__set_current_state(TASK_RUNNING);
+
+		if (iocb->ki_flags & IOCB_HIPRI)
+			iomap_dio_poll_update(dio);
 	}
 
 	return dio;
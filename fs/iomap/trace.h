@@ -182,6 +182,35 @@ TRACE_EVENT(iomap_iter,
 		   (void *)__entry->caller)
 );
 
+TRACE_EVENT(iomap_dio_complete,
+	TP_PROTO(struct inode *inode, loff_t pos, ssize_t ret, bool polled,
+		 u64 latency),
+	TP_ARGS(inode, pos, ret, polled, latency),
+	TP_STRUCT__entry(
+		__field(dev_t, dev)
+		__field(u64, ino)
+		__field(loff_t, pos)
+		__field(ssize_t, ret)
+		__field(bool, polled)
+		__field(u64, latency)
+	),
+	TP_fast_assign(
+		__entry->dev = inode->i_sb->s_dev;
+		__entry->ino = inode->i_ino;
+		__entry->pos = pos;
+		__entry->ret = ret;
+		__entry->polled = polled;
+		__entry->latency = latency;
+	),
+	TP_printk("dev %d:%d ino 0x%llx pos 0x%llx ret %zd polled %d latency %llu ns",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  __entry->ino,
+		  __entry->pos,
+		  __entry->ret,
+		  __entry->polled,
+		  __entry->latency)
+);
+
 #endif /* _IOMAP_TRACE_H */
 
 #undef TRACE_INCLUDE_PATH
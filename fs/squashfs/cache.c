@@ -39,12 +39,27 @@
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs.h"
 #include "page_actor.h"
 
+/*
+ * A cache may be split into several shards, each with its own lock and
+ * entries, to reduce contention between concurrent readers.  A block
+ * always maps to the same shard.
+ */
+static struct squashfs_cache *squashfs_cache_shard(struct squashfs_cache *cache,
+	u64 block)
+{
+	if (cache->shards == 1)
+		return cache;
+
+	return &cache[hash_64(block, 32) % cache->shards];
+}
+
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
@@ -55,6 +70,7 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	int i, n;
 	struct squashfs_cache_entry *entry;
 
+	cache = squashfs_cache_shard(cache, block);
 	spin_lock(&cache->lock);
 
 	while (1) {
@@ -100,6 +116,7 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			 * disk.
 			 */
 			cache->unused--;
+			cache->misses++;
 			entry->block = block;
 			entry->refcount = 1;
 			entry->pending = 1;
@@ -141,6 +158,7 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		if (entry->refcount == 0)
 			cache->unused--;
 		entry->refcount++;
+		cache->hits++;
 
 		/*
 		 * If the entry is currently being filled in by another process
@@ -192,15 +210,33 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
 }
 
 /*
- * Delete cache reclaiming all kmalloced buffers.
+ * Sum up the lookup statistics of all shards of a cache.
  */
-void squashfs_cache_delete(struct squashfs_cache *cache)
+void squashfs_cache_stats(struct squashfs_cache *cache, unsigned long *hits,
+	unsigned long *misses)
 {
-	int i, j;
+	int s;
 
+	*hits = *misses = 0;
 	if (cache == NULL)
 		return;
 
+	for (s = 0; s < cache->shards; s++) {
+		spin_lock(&cache[s].lock);
+		*hits += cache[s].hits;
+		*misses += cache[s].misses;
+		spin_unlock(&cache[s].lock);
+	}
+}
+
+
+static void squashfs_cache_delete_shard(struct squashfs_cache *cache)
+{
+	int i, j;
+
+	if (cache->entry == NULL)
+		return;
+
 	for (i = 0; i < cache->entries; i++) {
 		if (cache->entry[i].data) {
 			for (j = 0; j < cache->pages; j++)
@@ -211,30 +247,35 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 	}
 
 	kfree(cache->entry);
-	kfree(cache);
 }
 
 
 /*
- * Initialise cache allocating the specified number of entries, each of
- * size block_size.  To avoid vmalloc fragmentation issues each entry
- * is allocated as a sequence of kmalloced PAGE_SIZE buffers.
+ * Delete cache reclaiming all kmalloced buffers.
  */
-struct squashfs_cache *squashfs_cache_init(char *name, int entries,
-	int block_size)
+void squashfs_cache_delete(struct squashfs_cache *cache)
 {
-	int i, j;
-	struct squashfs_cache *cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	int s;
+
+	if (cache == NULL)
+		return;
+
+	for (s = 0; s < cache->shards; s++)
+		squashfs_cache_delete_shard(&cache[s]);
+
+	kfree(cache);
+}
 
-	if (cache == NULL) {
-		ERROR("Failed to allocate %s cache\n", name);
-		return NULL;
-	}
+
+static int squashfs_cache_init_shard(struct squashfs_cache *cache,
+	char *name, int entries, int block_size)
+{
+	int i, j;
 
 	cache->entry = kcalloc(entries, sizeof(*(cache->entry)), GFP_KERNEL);
 	if (cache->entry == NULL) {
 		ERROR("Failed to allocate %s cache\n", name);
-		goto cleanup;
+		return -ENOMEM;
 	}
 
 	cache->curr_blk = 0;
@@ -258,14 +299,14 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		entry->data = kcalloc(cache->pages, sizeof(void *), GFP_KERNEL);
 		if (entry->data == NULL) {
 			ERROR("Failed to allocate %s cache entry\n", name);
-			goto cleanup;
+			return -ENOMEM;
 		}
 
 		for (j = 0; j < cache->pages; j++) {
 			entry->data[j] = kmalloc(PAGE_SIZE, GFP_KERNEL);
 			if (entry->data[j] == NULL) {
 				ERROR("Failed to allocate %s buffer\n", name);
-				goto cleanup;
+				return -ENOMEM;
 			}
 		}
 
@@ -273,10 +314,42 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 						cache->pages, 0);
 		if (entry->actor == NULL) {
 			ERROR("Failed to allocate %s cache entry\n", name);
-			goto cleanup;
+			return -ENOMEM;
 		}
 	}
 
+	return 0;
+}
+
+
+/*
+ * Initialise cache allocating the specified number of entries, each of
+ * size block_size, spread over the given number of shards.  To avoid
+ * vmalloc fragmentation issues each entry is allocated as a sequence of
+ * kmalloced PAGE_SIZE buffers.
+ */
+struct squashfs_cache *squashfs_cache_init(char *name, int entries,
+	int shards, int block_size)
+{
+	int s;
+	struct squashfs_cache *cache = kcalloc(shards, sizeof(*cache),
+					       GFP_KERNEL);
+
+	if (cache == NULL) {
+		ERROR("Failed to allocate %s cache\n", name);
+		return NULL;
+	}
+
+	/* Every shard has at least one entry */
+	entries = DIV_ROUND_UP(entries, shards);
+
+	for (s = 0; s < shards; s++) {
+		cache[s].shards = shards;
+		if (squashfs_cache_init_shard(&cache[s], name, entries,
+					      block_size))
+			goto cleanup;
+	}
+
 	return cache;
 
 cleanup:
@@ -34,11 +34,13 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * Locate cache slot in range [offset, index] for specified inode.  If
@@ -494,7 +496,168 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+/* Upper bound on the datablocks decompressed in parallel by readahead */
+#define SQUASHFS_RA_MAX_BLOCKS	8
+
+struct squashfs_ra_block {
+	struct work_struct work;
+	struct super_block *sb;
+	struct page **page;
+	int pages;
+	u64 block;
+	int bsize;
+	int expected;
+};
+
+static void squashfs_ra_release(struct page **page, int pages)
+{
+	int i;
+
+	for (i = 0; i < pages; i++) {
+		unlock_page(page[i]);
+		put_page(page[i]);
+	}
+}
+
+/*
+ * Decompress one datablock directly into its page cache pages.  On
+ * failure the pages are left !uptodate, and squashfs_readpage() will
+ * retry them when they are actually accessed.
+ */
+static void squashfs_ra_decompress(struct squashfs_ra_block *ra)
+{
+	struct squashfs_page_actor *actor;
+	int i, bytes, res = -ENOMEM;
+	void *pageaddr;
+
+	actor = squashfs_page_actor_init_special(ra->page, ra->pages, 0);
+	if (actor) {
+		res = squashfs_read_data(ra->sb, ra->block, ra->bsize, NULL,
+					 actor);
+		kfree(actor);
+	}
+
+	if (res == ra->expected) {
+		/* Last page may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (bytes) {
+			pageaddr = kmap_atomic(ra->page[ra->pages - 1]);
+			memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+			kunmap_atomic(pageaddr);
+		}
+
+		for (i = 0; i < ra->pages; i++) {
+			flush_dcache_page(ra->page[i]);
+			SetPageUptodate(ra->page[i]);
+		}
+	}
+
+	squashfs_ra_release(ra->page, ra->pages);
+}
+
+static void squashfs_ra_work(struct work_struct *work)
+{
+	squashfs_ra_decompress(container_of(work, struct squashfs_ra_block,
+					    work));
+}
+
+/*
+ * Readahead of whole datablocks.  The block list lookups are done here,
+ * then up to one datablock per online CPU is decompressed in parallel,
+ * the first one in the caller's context and the others from the unbound
+ * workqueue.  Pages that don't make up a complete datablock (unaligned
+ * windows, sparse blocks and fragments) are left to squashfs_readpage().
+ */
+static void squashfs_readahead(struct readahead_control *ractl)
+{
+	struct inode *inode = ractl->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	unsigned short shift = msblk->block_log - PAGE_SHIFT;
+	int max_pages = 1 << shift;
+	loff_t mask = msblk->block_size - 1;
+	loff_t start = readahead_pos(ractl) & ~mask;
+	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
+	loff_t size = i_size_read(inode);
+	int file_end = size >> msblk->block_log;
+	int nr_blocks = min_t(int, num_online_cpus(), SQUASHFS_RA_MAX_BLOCKS);
+	struct squashfs_ra_block *ra;
+	pgoff_t last_page;
+	int i, n;
+
+	if (!size)
+		return;
+	last_page = (size - 1) >> PAGE_SHIFT;
+
+	readahead_expand(ractl, start, (len | mask) + 1);
+
+	ra = kcalloc(nr_blocks, sizeof(*ra), GFP_KERNEL);
+	if (ra == NULL)
+		return;
+
+	for (i = 0; i < nr_blocks; i++) {
+		ra[i].page = kmalloc_array(max_pages, sizeof(void *),
+					   GFP_KERNEL);
+		if (ra[i].page == NULL)
+			goto out;
+		ra[i].sb = inode->i_sb;
+		INIT_WORK(&ra[i].work, squashfs_ra_work);
+	}
+
+	do {
+		for (n = 0; n < nr_blocks;) {
+			struct squashfs_ra_block *cur = &ra[n];
+			int want = max_pages -
+				(readahead_index(ractl) & (max_pages - 1));
+			pgoff_t first;
+			int index;
+
+			cur->pages = __readahead_batch(ractl, cur->page, want);
+			if (!cur->pages)
+				break;
+
+			first = cur->page[0]->index;
+			index = first >> shift;
+			if (want != max_pages || cur->pages !=
+			    min_t(pgoff_t, first + max_pages - 1,
+				  last_page) - first + 1)
+				goto skip;
+
+			if (index == file_end && squashfs_i(inode)->fragment_block
+					!= SQUASHFS_INVALID_BLK)
+				goto skip;
+
+			cur->bsize = read_blocklist(inode, index, &cur->block);
+			if (cur->bsize <= 0)
+				goto skip;
+
+			cur->expected = index == file_end ?
+					(size & (msblk->block_size - 1)) :
+					 msblk->block_size;
+			n++;
+			continue;
+skip:
+			squashfs_ra_release(cur->page, cur->pages);
+		}
+
+		for (i = 1; i < n; i++)
+			queue_work(system_unbound_wq, &ra[i].work);
+		if (n)
+			squashfs_ra_decompress(&ra[0]);
+		for (i = 1; i < n; i++)
+			flush_work(&ra[i].work);
+	} while (n == nr_blocks);
+
+out:
+	for (i = 0; i < nr_blocks; i++)
+		kfree(ra[i].page);
+	kfree(ra);
+}
+#endif
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readahead = squashfs_readahead,
+#endif
 };
@@ -204,6 +204,10 @@ static inline int squashfs_block_size(__le32 raw)
 /* cached data constants for filesystem */
 #define SQUASHFS_CACHED_BLKS		8
 
+/* limits of the cache mount options */
+#define SQUASHFS_MAX_CACHE_ENTRIES	64
+#define SQUASHFS_MAX_CACHE_SHARDS	16
+
 /* meta index cache */
 #define SQUASHFS_META_INDEXES	(SQUASHFS_METADATA_SIZE / sizeof(unsigned int))
 #define SQUASHFS_META_ENTRIES	127
@@ -21,6 +21,9 @@ struct squashfs_cache {
 	int			unused;
 	int			block_size;
 	int			pages;
+	int			shards;
+	unsigned long		hits;
+	unsigned long		misses;
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache_entry *entry;
@@ -47,6 +50,8 @@ struct squashfs_sb_info {
 	struct squashfs_cache			*block_cache;
 	struct squashfs_cache			*fragment_cache;
 	struct squashfs_cache			*read_page;
+	unsigned int				fragment_cache_size;
+	unsigned int				cache_shards;
 	int					next_meta_index;
 	__le64					*id_table;
 	__le64					*fragment_index;
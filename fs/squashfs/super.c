@@ -46,10 +46,14 @@ enum Opt_errors {
 
 enum squashfs_param {
 	Opt_errors,
+	Opt_fragment_cache_size,
+	Opt_cache_shards,
 };
 
 struct squashfs_mount_opts {
 	enum Opt_errors errors;
+	unsigned int fragment_cache_size;
+	unsigned int cache_shards;
 };
 
 static const struct constant_table squashfs_param_errors[] = {
@@ -60,6 +64,8 @@ static const struct constant_table squashfs_param_errors[] = {
 
 static const struct fs_parameter_spec squashfs_fs_parameters[] = {
 	fsparam_enum("errors", Opt_errors, squashfs_param_errors),
+	fsparam_u32("fragment_cache_size", Opt_fragment_cache_size),
+	fsparam_u32("cache_shards", Opt_cache_shards),
 	{}
 };
 
@@ -77,6 +83,16 @@ static int squashfs_parse_param(struct fs_context *fc, struct fs_parameter *para
 	case Opt_errors:
 		opts->errors = result.uint_32;
 		break;
+	case Opt_fragment_cache_size:
+		if (result.uint_32 < 1 || result.uint_32 > SQUASHFS_MAX_CACHE_ENTRIES)
+			return invalfc(fc, "fragment_cache_size out of range");
+		opts->fragment_cache_size = result.uint_32;
+		break;
+	case Opt_cache_shards:
+		if (result.uint_32 < 1 || result.uint_32 > SQUASHFS_MAX_CACHE_SHARDS)
+			return invalfc(fc, "cache_shards out of range");
+		opts->cache_shards = result.uint_32;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -134,6 +150,8 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	msblk = sb->s_fs_info;
 
 	msblk->panic_on_errors = (opts->errors == Opt_errors_panic);
+	msblk->fragment_cache_size = opts->fragment_cache_size;
+	msblk->cache_shards = opts->cache_shards;
 
 	msblk->devblksize = sb_min_blocksize(sb, SQUASHFS_DEVBLK_SIZE);
 	if (!msblk->devblksize) {
@@ -250,13 +268,14 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			SQUASHFS_CACHED_BLKS, msblk->cache_shards,
+			SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
 	/* Allocate read_page block */
 	msblk->read_page = squashfs_cache_init("data",
-		squashfs_max_decompressors(), msblk->block_size);
+		squashfs_max_decompressors(), 1, msblk->block_size);
 	if (msblk->read_page == NULL) {
 		errorf(fc, "Failed to allocate read_page block");
 		goto failed_mount;
@@ -325,7 +344,8 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		msblk->fragment_cache_size, msblk->cache_shards,
+		msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -414,6 +434,11 @@ static int squashfs_reconfigure(struct fs_context *fc)
 
 	msblk->panic_on_errors = (opts->errors == Opt_errors_panic);
 
+	/* The caches are sized at mount time and can't be changed later */
+	if (opts->fragment_cache_size != msblk->fragment_cache_size ||
+	    opts->cache_shards != msblk->cache_shards)
+		return invalfc(fc, "cache geometry can't be changed on remount");
+
 	return 0;
 }
 
@@ -439,6 +464,28 @@ static int squashfs_show_options(struct seq_file *s, struct dentry *root)
 	else
 		seq_puts(s, ",errors=continue");
 
+	if (msblk->fragment_cache_size != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(s, ",fragment_cache_size=%u",
+			   msblk->fragment_cache_size);
+	if (msblk->cache_shards != 1)
+		seq_printf(s, ",cache_shards=%u", msblk->cache_shards);
+
+	return 0;
+}
+
+/* Cache hit/miss counters, reported in /proc/<pid>/mountstats */
+static int squashfs_show_stats(struct seq_file *s, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+	unsigned long hits, misses;
+
+	squashfs_cache_stats(msblk->block_cache, &hits, &misses);
+	seq_printf(s, "metadata_cache %lu %lu", hits, misses);
+	squashfs_cache_stats(msblk->fragment_cache, &hits, &misses);
+	seq_printf(s, " fragment_cache %lu %lu", hits, misses);
+	squashfs_cache_stats(msblk->read_page, &hits, &misses);
+	seq_printf(s, " data_cache %lu %lu", hits, misses);
+
 	return 0;
 }
 
@@ -450,6 +497,16 @@ static int squashfs_init_fs_context(struct fs_context *fc)
 	if (!opts)
 		return -ENOMEM;
 
+	if (fc->purpose == FS_CONTEXT_FOR_RECONFIGURE) {
+		struct squashfs_sb_info *msblk = fc->root->d_sb->s_fs_info;
+
+		opts->fragment_cache_size = msblk->fragment_cache_size;
+		opts->cache_shards = msblk->cache_shards;
+	} else {
+		opts->fragment_cache_size = SQUASHFS_CACHED_FRAGMENTS;
+		opts->cache_shards = 1;
+	}
+
 	fc->fs_private = opts;
 	fc->ops = &squashfs_context_ops;
 	return 0;
@@ -582,6 +639,7 @@ static const struct super_operations squashfs_super_ops = {
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
 	.show_options = squashfs_show_options,
+	.show_stats = squashfs_show_stats,
 };
 
 module_init(init_squashfs_fs);
@@ -27,6 +27,7 @@
 #include <drm/spsc_queue.h>
 #include <linux/dma-fence.h>
 #include <linux/completion.h>
+#include <linux/mutex.h>
 
 #define MAX_WAIT_SCHED_ENTITY_Q_EMPTY msecs_to_jiffies(1000)
 
@@ -182,6 +183,10 @@ struct drm_sched_fence *to_drm_sched_fence(struct dma_fence *f);
  * @s_priority: the priority of the job.
  * @entity: the entity to which this job belongs.
  * @cb: the callback for the parent fence in s_fence.
+ * @credits: the number of credits this job takes from the scheduler's
+ *           @hw_submission_limit while it is in the hardware queue.  Set to 1
+ *           by drm_sched_job_init(), drivers may raise it for bigger jobs
+ *           before drm_sched_entity_push_job().
  *
  * A job is created by the driver using drm_sched_job_init(), and
  * should call drm_sched_entity_push_job() once it wants the scheduler
@@ -198,6 +203,7 @@ struct drm_sched_job {
 	enum drm_sched_priority		s_priority;
 	struct drm_sched_entity         *entity;
 	struct dma_fence_cb		cb;
+	u32				credits;
 };
 
 static inline bool drm_sched_invalidate_job(struct drm_sched_job *s_job,
@@ -290,7 +296,7 @@ struct drm_sched_backend_ops {
  * struct drm_gpu_scheduler
  *
  * @ops: backend operations provided by the driver.
- * @hw_submission_limit: the max size of the hardware queue.
+ * @hw_submission_limit: the max number of credits in the hardware queue.
  * @timeout: the time after which a job is removed from the scheduler.
  * @name: name of the ring for which this scheduler is being used.
  * @sched_rq: priority wise array of run queues.
@@ -299,7 +305,8 @@ struct drm_sched_backend_ops {
  * @job_scheduled: once @drm_sched_entity_do_release is called the scheduler
  *                 waits on this wait queue until all the scheduled jobs are
  *                 finished.
- * @hw_rq_count: the number of jobs currently in the hardware queue.
+ * @hw_rq_count: the number of credits taken by the jobs currently in the
+ *               hardware queue.
  * @job_id_count: used to assign unique id to the each job.
  * @timeout_wq: workqueue used to queue @work_tdr
  * @work_tdr: schedules a delayed call to @drm_sched_job_timedout after the
@@ -313,6 +320,12 @@ struct drm_sched_backend_ops {
  * @_score: score used when the driver doesn't provide one
  * @ready: marks if the underlying HW is ready to work
  * @free_guilty: A hit to time out handler to free the guilty job.
+ * @direct_run: set by the driver to let drm_sched_entity_push_job() run a
+ *              job from the submitting thread when its entity was idle and
+ *              its dependencies are already signaled.
+ * @stopped: set between drm_sched_stop() and drm_sched_start().
+ * @run_lock: serializes taking jobs from entities and &ops.run_job between
+ *            the scheduler thread and direct runs.
  *
  * One scheduler is implemented for each hardware ring.
  */
@@ -336,6 +349,9 @@ struct drm_gpu_scheduler {
 	atomic_t                        _score;
 	bool				ready;
 	bool				free_guilty;
+	bool				direct_run;
+	bool				stopped;
+	struct mutex			run_lock;
 };
 
 int drm_sched_init(struct drm_gpu_scheduler *sched,
@@ -354,6 +370,7 @@ void drm_sched_entity_modify_sched(struct drm_sched_entity *entity,
 
 void drm_sched_job_cleanup(struct drm_sched_job *job);
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched);
+bool drm_sched_try_direct_run(struct drm_sched_entity *entity);
 void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad);
 void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery);
 void drm_sched_resubmit_jobs(struct drm_gpu_scheduler *sched);
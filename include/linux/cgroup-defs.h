@@ -457,6 +457,9 @@ struct cgroup {
 	struct cgroup_rstat_cpu __percpu *rstat_cpu;
 	struct list_head rstat_css_list;
 
+	/* jiffies of the last subtree flush, protected by cgroup_rstat_lock */
+	unsigned long rstat_flush_jiffies;
+
 	/* cgroup basic resource statistics */
 	struct cgroup_base_stat last_bstat;
 	struct cgroup_base_stat bstat;
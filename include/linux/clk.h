@@ -216,6 +216,22 @@ int clk_rate_exclusive_get(struct clk *clk);
  */
 void clk_rate_exclusive_put(struct clk *clk);
 
+/**
+ * clk_bulk_set_rate - set the clock rates for a set of clock sources at once
+ * @num_clks: the number of clk_bulk_data
+ * @clks: the clk_bulk_data table of consumer
+ * @rates: desired clock rates in Hz, one for each entry of @clks
+ *
+ * The new configuration of the whole clock tree is calculated before any
+ * hardware is touched, so that clocks shared by several of @clks, such as a
+ * PLL, are reprogrammed only once.
+ *
+ * Returns success (0) or negative errno.
+ */
+int __must_check clk_bulk_set_rate(int num_clks,
+				   const struct clk_bulk_data *clks,
+				   const unsigned long *rates);
+
 #else
 
 static inline int clk_notifier_register(struct clk *clk,
@@ -276,6 +292,13 @@ static inline int clk_rate_exclusive_get(struct clk *clk)
 
 static inline void clk_rate_exclusive_put(struct clk *clk) {}
 
+static inline int __must_check clk_bulk_set_rate(int num_clks,
+				const struct clk_bulk_data *clks,
+				const unsigned long *rates)
+{
+	return 0;
+}
+
 #endif
 
 #ifdef CONFIG_HAVE_CLK_PREPARE
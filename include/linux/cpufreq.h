@@ -259,11 +259,14 @@ void cpufreq_stats_create_table(struct cpufreq_policy *policy);
 void cpufreq_stats_free_table(struct cpufreq_policy *policy);
 void cpufreq_stats_record_transition(struct cpufreq_policy *policy,
 				     unsigned int new_freq);
+void cpufreq_stats_record_latency(struct cpufreq_policy *policy, u64 delta_ns);
 #else
 static inline void cpufreq_stats_create_table(struct cpufreq_policy *policy) { }
 static inline void cpufreq_stats_free_table(struct cpufreq_policy *policy) { }
 static inline void cpufreq_stats_record_transition(struct cpufreq_policy *policy,
 						   unsigned int new_freq) { }
+static inline void cpufreq_stats_record_latency(struct cpufreq_policy *policy,
+						u64 delta_ns) { }
 #endif /* CONFIG_CPU_FREQ_STAT */
 
 /*********************************************************************
@@ -274,6 +274,18 @@ struct cpuidle_governor {
 extern int cpuidle_register_governor(struct cpuidle_governor *gov);
 extern s64 cpuidle_governor_latency_req(unsigned int cpu);
 
+#ifdef CONFIG_IRQ_TIMINGS
+extern u64 cpuidle_irq_predict(struct cpuidle_device *dev, u64 limit_ns);
+extern void cpuidle_irq_predict_update(struct cpuidle_device *dev);
+#else
+static inline u64 cpuidle_irq_predict(struct cpuidle_device *dev,
+				      u64 limit_ns)
+{
+	return limit_ns;
+}
+static inline void cpuidle_irq_predict_update(struct cpuidle_device *dev) {}
+#endif
+
 #define __CPU_PM_CPU_IDLE_ENTER(low_level_idle_enter,			\
 				idx,					\
 				state,					\
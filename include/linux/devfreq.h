@@ -153,6 +153,11 @@ struct devfreq_stats {
  * @governor_data:	private data for governors, devfreq core doesn't touch it.
  * @user_min_freq_req:	PM QoS minimum frequency request from user (via sysfs)
  * @user_max_freq_req:	PM QoS maximum frequency request from user (via sysfs)
+ * @boost_freq_req:	PM QoS minimum frequency request of devfreq_boost()
+ * @boost_work:	delayed work applying and ending a devfreq_boost()
+ * @boost_lock:	protects @boost_until and @boost_active
+ * @boost_until:	jiffies at which the current boost ends
+ * @boost_active:	a devfreq_boost() is in effect
  * @scaling_min_freq:	Limit minimum frequency requested by OPP interface
  * @scaling_max_freq:	Limit maximum frequency requested by OPP interface
  * @stop_polling:	 devfreq polling status of a device.
@@ -192,6 +197,11 @@ struct devfreq {
 
 	struct dev_pm_qos_request user_min_freq_req;
 	struct dev_pm_qos_request user_max_freq_req;
+	struct dev_pm_qos_request boost_freq_req;
+	struct delayed_work boost_work;
+	spinlock_t boost_lock;
+	unsigned long boost_until;
+	bool boost_active;
 	unsigned long scaling_min_freq;
 	unsigned long scaling_max_freq;
 	bool stop_polling;
@@ -239,6 +249,8 @@ void devfreq_resume(void);
 /* update_devfreq() - Reevaluate the device and configure frequency */
 int update_devfreq(struct devfreq *devfreq);
 
+int devfreq_boost(struct devfreq *devfreq, unsigned int duration_ms);
+
 /* Helper functions for devfreq user device driver with OPP. */
 struct dev_pm_opp *devfreq_recommended_opp(struct device *dev,
 				unsigned long *freq, u32 flags);
@@ -434,6 +446,12 @@ static inline int devfreq_update_stats(struct devfreq *df)
 {
 	return -EINVAL;
 }
+
+static inline int devfreq_boost(struct devfreq *devfreq,
+				unsigned int duration_ms)
+{
+	return -EINVAL;
+}
 #endif /* CONFIG_PM_DEVFREQ */
 
 #endif /* __LINUX_DEVFREQ_H__ */
@@ -17,6 +17,8 @@
 #include <linux/mutex.h>
 #include <linux/regulator/consumer.h>
 #include <linux/rtmutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <linux/irqdomain.h>		/* for Host Notify IRQ */
 #include <linux/of.h>		/* for struct device_node */
 #include <linux/swab.h>		/* for swab16 */
@@ -173,6 +175,36 @@ int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num);
 /* 非加锁版本的 i2c_transfer */
 int __i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num);
 
+/**
+ * struct i2c_async_xfer - I2C transfer queued with i2c_transfer_async()
+ * @msgs: Messages to execute, with the same semantics as for i2c_transfer()
+ * @num: Number of messages
+ * @flags: I2C_ASYNC_XFER_* flags
+ * @complete: Called from process context once the transfer has finished
+ * @context: For use by the submitter
+ * @status: Result of the transfer, as i2c_transfer() would have returned it
+ * @node: Queue entry, owned by the I2C core
+ */
+struct i2c_async_xfer {
+	struct i2c_msg *msgs;
+	int num;
+	unsigned int flags;
+/* The device accepts a repeated START in place of the STOP ending the transfer */
+#define I2C_ASYNC_XFER_COMBINE		BIT(0)
+	void (*complete)(struct i2c_async_xfer *xfer);
+	void *context;
+	int status;
+	struct list_head node;
+};
+
+/* Queue a transfer, may be called from atomic context */
+/* 异步传输，可以在原子上下文中调用，完成后调用 complete 回调 */
+int i2c_transfer_async(struct i2c_adapter *adap, struct i2c_async_xfer *xfer);
+/* Dequeue a transfer, or wait for it to complete */
+/* 取消尚未开始的异步传输，否则等待其完成，可能睡眠 */
+bool i2c_transfer_async_cancel(struct i2c_adapter *adap,
+			       struct i2c_async_xfer *xfer);
+
 /* This is the very generalized SMBus access routine. You probably do not
    want to use this, though; one of the functions below may be much easier,
    and probably just as fast.
@@ -1015,6 +1047,23 @@ struct i2c_adapter {
 
 	struct dentry *debugfs;
 
+	/* queue of i2c_transfer_async(), owned by the I2C core */
+	spinlock_t async_lock;
+	struct list_head async_queue;
+	struct work_struct async_work;
+	bool async_shutdown;		/* adapter is going away */
+
+	/* bus utilisation, updated with the bus segment locked */
+	struct i2c_adapter_stats {
+		u64 transfers;
+		u64 messages;
+		u64 bytes;
+		u64 errors;
+		u64 busy_ns;
+		u64 batches;
+		u64 batched_transfers;
+	} stats;
+
 	/* 7bit address space */
 	DECLARE_BITMAP(addrs_in_instantiation, 1 << 7);
 };
@@ -17,11 +17,6 @@ struct iio_dma_buffer_queue;
 struct iio_dma_buffer_ops;
 struct device;
 
-struct iio_buffer_block {
-	u32 size;
-	u32 bytes_used;
-};
-
 /**
  * enum iio_block_state - State of a struct iio_dma_buffer_block
  * @IIO_BLOCK_STATE_DEQUEUED: Block is not queued
@@ -46,6 +41,8 @@ enum iio_block_state {
  * @vaddr: Virutal address of the blocks memory
  * @phys_addr: Physical address of the blocks memory
  * @queue: Parent DMA buffer queue
+ * @id: Index of the block in the queue's mmap block array
+ * @timestamp: Time at which the DMA controller completed the block
  * @kref: kref used to manage the lifetime of block
  * @state: Current state of the block
  */
@@ -53,6 +50,7 @@ struct iio_dma_buffer_block {
 	/* May only be accessed by the owner of the block */
 	struct list_head head;
 	size_t bytes_used;
+	s64 timestamp;
 
 	/*
 	 * Set during allocation, constant thereafter. May be accessed read-only
@@ -62,6 +60,7 @@ struct iio_dma_buffer_block {
 	dma_addr_t phys_addr;
 	size_t size;
 	struct iio_dma_buffer_queue *queue;
+	unsigned int id;
 
 	/* Must not be accessed outside the core. */
 	struct kref kref;
@@ -101,6 +100,11 @@ struct iio_dma_buffer_queue_fileio {
  * @outgoing: List of buffers on the outgoing queue
  * @active: Whether the buffer is currently active
  * @fileio: FileIO state
+ * @blocks: Blocks allocated through the mmap block interface
+ * @num_blocks: Number of entries in @blocks. While non-zero the buffer is in
+ *   mmap mode, the blocks are exchanged with userspace by the block ioctls and
+ *   read() is not available. @blocks and @num_blocks are changed with both
+ *   @lock and @list_lock held, so either lock is enough to read them.
  */
 struct iio_dma_buffer_queue {
 	struct iio_buffer buffer;
@@ -115,6 +119,9 @@ struct iio_dma_buffer_queue {
 	bool active;
 
 	struct iio_dma_buffer_queue_fileio fileio;
+
+	struct iio_dma_buffer_block **blocks;
+	unsigned int num_blocks;
 };
 
 /**
@@ -143,6 +150,18 @@ int iio_dma_buffer_set_bytes_per_datum(struct iio_buffer *buffer, size_t bpd);
 int iio_dma_buffer_set_length(struct iio_buffer *buffer, unsigned int length);
 int iio_dma_buffer_request_update(struct iio_buffer *buffer);
 
+int iio_dma_buffer_alloc_blocks(struct iio_buffer *buffer,
+	struct iio_buffer_block_alloc_req *req);
+int iio_dma_buffer_free_blocks(struct iio_buffer *buffer);
+int iio_dma_buffer_query_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_enqueue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_dequeue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_mmap(struct iio_buffer *buffer,
+	struct vm_area_struct *vma);
+
 int iio_dma_buffer_init(struct iio_dma_buffer_queue *queue,
 	struct device *dma_dev, const struct iio_dma_buffer_ops *ops);
 void iio_dma_buffer_exit(struct iio_dma_buffer_queue *queue);
@@ -10,6 +10,7 @@
 
 struct iio_dev;
 struct iio_buffer;
+struct vm_area_struct;
 
 /**
  * INDIO_BUFFER_FLAG_FIXED_WATERMARK - Watermark level of the buffer can not be
@@ -34,6 +35,14 @@ struct iio_buffer;
  *                      device stops sampling. Calles are balanced with @enable.
  * @release:		called when the last reference to the buffer is dropped,
  *			should free all resources allocated by the buffer.
+ * @alloc_blocks:	allocate blocks that are exchanged with userspace
+ *			without copying. Switches the buffer to mmap mode.
+ * @free_blocks:	free the blocks allocated by @alloc_blocks.
+ * @query_block:	fill in the descriptor of a block by its id.
+ * @enqueue_block:	hand a block owned by userspace back to the buffer.
+ * @dequeue_block:	take a completed block from the buffer. Returns
+ *			-EAGAIN if no block is ready.
+ * @mmap:		map the memory of a block into userspace.
  * @modes:		Supported operating modes by this buffer type
  * @flags:		A bitmask combination of INDIO_BUFFER_FLAG_*
  *
@@ -60,6 +69,17 @@ struct iio_buffer_access_funcs {
 
 	void (*release)(struct iio_buffer *buffer);
 
+	int (*alloc_blocks)(struct iio_buffer *buffer,
+			    struct iio_buffer_block_alloc_req *req);
+	int (*free_blocks)(struct iio_buffer *buffer);
+	int (*query_block)(struct iio_buffer *buffer,
+			   struct iio_buffer_block *block);
+	int (*enqueue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*dequeue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*mmap)(struct iio_buffer *buffer, struct vm_area_struct *vma);
+
 	unsigned int modes;
 	unsigned int flags;
 };
@@ -67,6 +67,10 @@
  *                later.
  * IRQF_NO_DEBUG - Exclude from runnaway detection for IPI and similar handlers,
  *		   depends on IRQF_PERCPU.
+ * IRQF_THREAD_POLL - Keep calling the thread handler while it returns
+ *                IRQ_HANDLED, up to the per-interrupt budget, before the
+ *                line is unmasked again. The handler must return IRQ_NONE
+ *                once the device has nothing left to report.
  */
 #define IRQF_SHARED		0x00000080
 #define IRQF_PROBE_SHARED	0x00000100
@@ -82,6 +86,7 @@
 #define IRQF_COND_SUSPEND	0x00040000
 #define IRQF_NO_AUTOEN		0x00080000
 #define IRQF_NO_DEBUG		0x00100000
+#define IRQF_THREAD_POLL	0x00200000
 
 #define IRQF_TIMER		(__IRQF_TIMER | IRQF_NO_SUSPEND | IRQF_NO_THREAD)
 
@@ -329,6 +334,9 @@ extern int irq_force_affinity(unsigned int irq, const struct cpumask *cpumask);
 extern int irq_can_set_affinity(unsigned int irq);
 extern int irq_select_affinity(unsigned int irq);
 
+extern void irq_affinity_exclude_cpus(const struct cpumask *cpus,
+				      const struct cpumask *fallback);
+
 extern int irq_set_affinity_hint(unsigned int irq, const struct cpumask *m);
 extern int irq_update_affinity_desc(unsigned int irq,
 				    struct irq_affinity_desc *affinity);
@@ -361,6 +369,9 @@ static inline int irq_can_set_affinity(unsigned int irq)
 
 static inline int irq_select_affinity(unsigned int irq)  { return 0; }
 
+static inline void irq_affinity_exclude_cpus(const struct cpumask *cpus,
+					     const struct cpumask *fallback) { }
+
 static inline int irq_set_affinity_hint(unsigned int irq,
 					const struct cpumask *m)
 {
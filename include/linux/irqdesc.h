@@ -33,6 +33,8 @@ struct pt_regs;
  * @irqs_unhandled:	stats field for spurious unhandled interrupts
  * @threads_handled:	stats field for deferred spurious detection of threaded handlers
  * @threads_handled_last: comparator field for deferred spurious detection of threaded handlers
+ * @thread_poll_budget:	max extra thread handler calls per wakeup (IRQF_THREAD_POLL)
+ * @threads_polled:	stats field for thread handler calls done by polling
  * @lock:		locking for SMP
  * @affinity_hint:	hint to user space for preferred irq affinity
  * @affinity_notify:	context for notification of affinity changes
@@ -68,6 +70,8 @@ struct irq_desc {
 	unsigned int		irqs_unhandled;
 	atomic_t		threads_handled;
 	int			threads_handled_last;
+	unsigned int		thread_poll_budget;
+	atomic_t		threads_polled;
 	raw_spinlock_t		lock;
 	struct cpumask		*percpu_enabled;
 	const struct cpumask	*percpu_affinity;
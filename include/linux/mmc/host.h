@@ -459,6 +459,18 @@ struct mmc_host {
 	bool			sdio_irq_pending;
 	atomic_t		sdio_irq_thread_abort;
 
+	/* Hybrid SDIO IRQ polling, see sdio_irq_poll_again() */
+	unsigned int		sdio_irq_poll_us;	/* max poll window, 0 = off */
+	unsigned int		sdio_irq_poll_win;	/* current poll window */
+	ktime_t			sdio_irq_poll_end;
+	bool			sdio_irq_polling;
+	struct mmc_sdio_irq_stats {
+		u64		irqs;		/* host interrupts handled */
+		u64		polls;		/* CCCR_INTx polls in window */
+		u64		poll_hits;	/* polls that found an IRQ */
+		u64		poll_exits;	/* returns to interrupt mode */
+	} sdio_irq_stats;
+
 	mmc_pm_flag_t		pm_flags;	/* requested pm features */
 
 	struct led_trigger	*led;		/* activity led */
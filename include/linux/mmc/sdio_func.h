@@ -161,6 +161,20 @@ extern int sdio_memcpy_toio(struct sdio_func *func, unsigned int addr,
 extern int sdio_writesb(struct sdio_func *func, unsigned int addr,
 	void *src, int count);
 
+/*
+ * One entry of an SDIO transfer batch, see sdio_transfer_batch()
+ */
+struct sdio_xfer {
+	void		*buf;		/* data buffer, DMA-able */
+	unsigned int	addr;		/* function address */
+	unsigned int	len;		/* bytes to transfer */
+	unsigned int	write:1;	/* host to card */
+	unsigned int	incr_addr:1;	/* memory, not FIFO, access */
+};
+
+extern int sdio_transfer_batch(struct sdio_func *func,
+	struct sdio_xfer *xfers, unsigned int nr);
+
 extern unsigned char sdio_f0_readb(struct sdio_func *func,
 	unsigned int addr, int *err_ret);
 extern void sdio_f0_writeb(struct sdio_func *func, unsigned char b,
@@ -30,6 +30,11 @@ static inline void synchronize_rcu_expedited(void)
 	synchronize_rcu();
 }
 
+static inline void call_rcu_lazy(struct rcu_head *head, rcu_callback_t func)
+{
+	call_rcu(head, func);
+}
+
 /*
  * Add one more declaration of kvfree() here. It is
  * not so straight forward to just include <linux/mm.h>
@@ -21,12 +21,20 @@
 #include <linux/mm.h>
 #include <linux/pagevec.h>
 
+/*
+ * Time transports spend queued on a pool before a thread picks them up.
+ * Bucket 0 is below 1us, bucket n covers [4^(n-1), 4^n) us and the last
+ * bucket is open ended.
+ */
+#define SVC_POOL_WAIT_BUCKETS	10
+
 /* statistics for svc_pool structures */
 struct svc_pool_stats {
 	atomic_long_t	packets;
 	unsigned long	sockets_queued;
 	atomic_long_t	threads_woken;
 	atomic_long_t	threads_timedout;
+	atomic_long_t	wait_hist[SVC_POOL_WAIT_BUCKETS];
 };
 
 /*
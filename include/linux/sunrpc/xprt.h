@@ -275,7 +275,11 @@ struct rpc_xprt {
 					sends,		/* how many complete requests */
 					recvs,		/* how many complete requests */
 					bad_xids,	/* lookup_rqst didn't find XID */
-					max_slots;	/* max rpc_slots used */
+					max_slots,	/* max rpc_slots used */
+					recv_wakeups,	/* receive runs that got replies */
+					recv_batched,	/* replies completed under the
+							 * next reply's lookup */
+					recv_batch_max;	/* most replies in one run */
 
 		unsigned long long	req_u,		/* average requests on the wire */
 					bklog_u,	/* backlog queue utilization */
@@ -41,6 +41,9 @@ struct sock_xprt {
 				len;
 
 		unsigned long	copied;
+
+		struct rpc_rqst	*done;		/* read, completion deferred */
+		unsigned long	done_copied;
 	} recv;
 
 	/*
@@ -76,35 +76,53 @@ extern enum swiotlb_force swiotlb_force;
  * @nslabs:	The number of IO TLB blocks (in groups of 64) between @start and
  *		@end. For default swiotlb, this is command line adjustable via
  *		setup_io_tlb_npages.
- * @used:	The number of used IO TLB block.
  * @list:	The free list describing the number of free entries available
  *		from each index.
- * @index:	The index to start searching in the next round.
  * @orig_addr:	The original address corresponding to a mapped entry.
  * @alloc_size:	Size of the allocated buffer.
- * @lock:	The lock to protect the above data structures in the map and
- *		unmap calls.
  * @debugfs:	The dentry to debugfs.
  * @late_alloc:	%true if allocated using the page allocator
  * @force_bounce: %true if swiotlb bouncing is forced
  * @for_alloc:  %true if the pool is used for memory allocation
+ * @nareas:	The number of areas the pool is split into, a power of two.
+ *		Each CPU allocates from its own area first, so that mappings
+ *		from different CPUs do not all contend for one lock.
+ * @area_nslabs: The number of slots in each area.
+ * @areas:	The areas: slots in use, the index to start searching in the
+ *		next round and the lock protecting the area's slots in the
+ *		map and unmap calls.
+ * @total_used:	The number of slots in use across all areas (debugfs only).
+ * @used_hiwater: The highest value @total_used has reached (debugfs only).
+ * @contended:	How often an area lock was found taken (debugfs only).
+ * @area_fallbacks: How often the local area was full and another one had to
+ *		be tried (debugfs only).
  */
 struct io_tlb_mem {
 	phys_addr_t start;
 	phys_addr_t end;
 	unsigned long nslabs;
-	unsigned long used;
-	unsigned int index;
-	spinlock_t lock;
 	struct dentry *debugfs;
 	bool late_alloc;
 	bool force_bounce;
 	bool for_alloc;
+	unsigned int nareas;
+	unsigned int area_nslabs;
+	struct io_tlb_area {
+		unsigned long used;
+		unsigned int index;
+		spinlock_t lock;
+	} *areas;
 	struct io_tlb_slot {
 		phys_addr_t orig_addr;
 		size_t alloc_size;
 		unsigned int list;
 	} *slots;
+#ifdef CONFIG_DEBUG_FS
+	atomic_long_t total_used;
+	atomic_long_t used_hiwater;
+	atomic_long_t contended;
+	atomic_long_t area_fallbacks;
+#endif
 };
 extern struct io_tlb_mem io_tlb_default_mem;
 
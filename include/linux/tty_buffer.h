@@ -44,6 +44,10 @@ struct tty_bufhead {
 	atomic_t	   mem_used;    /* In-use buffers excluding free list */
 	int		   mem_limit;
 	struct tty_buffer *tail;	/* Active buffer */
+	u32		   push_stamp;	/* ns of oldest unflushed push, 0 if none */
+	u32		   flush_lat_max;	/* push to flush latency, ns */
+	u64		   flush_lat_total;
+	unsigned long	   flushes;
 };
 
 /*
@@ -53,6 +53,8 @@ struct usb_ep;
  * @short_not_ok: When reading data, makes short packets be
  *     treated as errors (queue stops advancing till cleanup).
  * @dma_mapped: Indicates if request has been mapped to DMA (internal)
+ * @sg_was_mapped: Set if the scatterlist has been mapped before the request
+ *	was enqueued; the controller driver must not map or unmap it.
  * @complete: Function called when request completes, so this request and
  *	its buffer may be re-used.  The function will always be called with
  *	interrupts disabled, and it must not sleep.
@@ -112,6 +114,7 @@ struct usb_request {
 	unsigned		zero:1;
 	unsigned		short_not_ok:1;
 	unsigned		dma_mapped:1;
+	unsigned		sg_was_mapped:1;
 
 	void			(*complete)(struct usb_ep *ep,
 					struct usb_request *req);
@@ -359,6 +362,8 @@ struct usb_gadget_ops {
  * @mA: last set mA value
  * @otg_caps: OTG capabilities of this gadget.
  * @sg_supported: true if we can handle scatter-gather
+ * @sg_premapped: true if we accept requests with @sg_was_mapped set, i.e.
+ *	scatterlists the gadget driver has already mapped for DMA.
  * @is_otg: True if the USB device port uses a Mini-AB jack, so that the
  *	gadget driver must provide a USB OTG descriptor.
  * @is_a_peripheral: False unless is_otg, the "A" end of a USB cable
@@ -381,6 +386,9 @@ struct usb_gadget_ops {
  * @quirk_zlp_not_supp: UDC controller doesn't support ZLP.
  * @quirk_avoids_skb_reserve: udc/platform wants to avoid skb_reserve() in
  *	u_ether.c to improve performance.
+ * @quirk_sg_segment_packets: UDC starts a new packet with every scatterlist
+ *	segment, so a segment which is not a multiple of MaxPacketSize is
+ *	sent with a short packet.
  * @is_selfpowered: if the gadget is self-powered.
  * @deactivated: True if gadget is deactivated - in deactivated state it cannot
  *	be connected.
@@ -433,6 +441,7 @@ struct usb_gadget {
 	struct usb_otg_caps		*otg_caps;
 
 	unsigned			sg_supported:1;
+	unsigned			sg_premapped:1;
 	unsigned			is_otg:1;
 	unsigned			is_a_peripheral:1;
 	unsigned			b_hnp_enable:1;
@@ -445,6 +454,7 @@ struct usb_gadget {
 	unsigned			quirk_stall_not_supp:1;
 	unsigned			quirk_zlp_not_supp:1;
 	unsigned			quirk_avoids_skb_reserve:1;
+	unsigned			quirk_sg_segment_packets:1;
 	unsigned			is_selfpowered:1;
 	unsigned			deactivated:1;
 	unsigned			connected:1;
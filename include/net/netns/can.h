@@ -35,6 +35,8 @@ struct netns_can {
 
 	/* CAN GW per-net gateway jobs */
 	struct hlist_head cgw_list;
+	/* CAN GW per-net groups of jobs sharing a source and filter mask */
+	struct hlist_head cgw_grp_list;
 };
 
 #endif /* __NETNS_CAN_H__ */
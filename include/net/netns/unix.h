@@ -8,6 +8,7 @@
 struct ctl_table_header;
 struct netns_unix {
 	int			sysctl_max_dgram_qlen;
+	int			sysctl_zerocopy_min_size;
 	struct ctl_table_header	*ctl;
 };
 
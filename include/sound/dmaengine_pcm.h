@@ -110,6 +110,12 @@ int snd_dmaengine_pcm_refine_runtime_hwparams(
  * playback.
  */
 #define SND_DMAENGINE_PCM_FLAG_HALF_DUPLEX BIT(3)
+/*
+ * The DMA residue is accurate enough to drive the PCM without period
+ * interrupts, advertise SNDRV_PCM_INFO_NO_PERIOD_WAKEUP. Only takes effect if
+ * the channel reports its residue at burst granularity.
+ */
+#define SND_DMAENGINE_PCM_FLAG_NO_PERIOD_WAKEUP BIT(4)
 
 /**
  * struct snd_dmaengine_pcm_config - Configuration data for dmaengine based PCM
@@ -83,6 +83,33 @@ DEFINE_EVENT(dma_fence, dma_fence_wait_end,
 	TP_ARGS(fence)
 );
 
+TRACE_EVENT(dma_fence_wait_latency,
+
+	TP_PROTO(struct dma_fence *fence, s64 latency_ns),
+
+	TP_ARGS(fence, latency_ns),
+
+	TP_STRUCT__entry(
+		__string(driver, fence->ops->get_driver_name(fence))
+		__string(timeline, fence->ops->get_timeline_name(fence))
+		__field(unsigned int, context)
+		__field(unsigned int, seqno)
+		__field(s64, latency_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(driver, fence->ops->get_driver_name(fence));
+		__assign_str(timeline, fence->ops->get_timeline_name(fence));
+		__entry->context = fence->context;
+		__entry->seqno = fence->seqno;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("driver=%s timeline=%s context=%u seqno=%u latency_ns=%lld",
+		  __get_str(driver), __get_str(timeline), __entry->context,
+		  __entry->seqno, __entry->latency_ns)
+);
+
 #endif /*  _TRACE_DMA_FENCE_H */
 
 /* This part must be outside protection */
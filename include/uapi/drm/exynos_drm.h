@@ -91,8 +91,13 @@ enum e_drm_exynos_gem_mem_type {
 	EXYNOS_BO_CACHABLE	= 1 << 1,
 	/* write-combine mapping. */
 	EXYNOS_BO_WC		= 1 << 2,
+	/*
+	 * NV12MT (64x32 tiled) layout as produced by MFC, size rounded up
+	 * to whole 8 KiB tile pairs. Use with DRM_FORMAT_MOD_SAMSUNG_64_32_TILE.
+	 */
+	EXYNOS_BO_TILE_64_32	= 1 << 3,
 	EXYNOS_BO_MASK		= EXYNOS_BO_NONCONTIG | EXYNOS_BO_CACHABLE |
-					EXYNOS_BO_WC
+					EXYNOS_BO_WC | EXYNOS_BO_TILE_64_32
 };
 
 struct drm_exynos_g2d_get_ver {
@@ -131,8 +136,25 @@ struct drm_exynos_g2d_set_cmdlist {
 	__u64					user_data;
 };
 
+/* g2d exec flags */
+#define G2D_EXEC_FENCE_IN		(1 << 0)
+#define G2D_EXEC_FENCE_OUT		(1 << 1)
+#define G2D_EXEC_FLAGS			(G2D_EXEC_FENCE_IN | G2D_EXEC_FENCE_OUT)
+
+/**
+ * A structure for g2d command list execution.
+ *
+ * @async: if non-zero, return without waiting for the engine to finish.
+ * @flags: bitmask of G2D_EXEC_* flags.
+ * @fence_fd: in: sync_file fd the engine waits on before execution
+ *	(with G2D_EXEC_FENCE_IN).
+ *	out: sync_file fd signaled once execution is finished
+ *	(with G2D_EXEC_FENCE_OUT).
+ */
 struct drm_exynos_g2d_exec {
 	__u64					async;
+	__u32					flags;
+	__s32					fence_fd;
 };
 
 /* Exynos DRM IPP v2 API */
@@ -323,10 +345,15 @@ enum drm_exynos_ipp_flag {
 	DRM_EXYNOS_IPP_FLAG_TEST_ONLY	= 0x02,
 	/* non-blocking processing */
 	DRM_EXYNOS_IPP_FLAG_NONBLOCK	= 0x04,
+	/* wait for the sync_file passed in fence_fd before processing */
+	DRM_EXYNOS_IPP_FLAG_IN_FENCE	= 0x08,
+	/* return a sync_file signaled after processing in fence_fd */
+	DRM_EXYNOS_IPP_FLAG_OUT_FENCE	= 0x10,
 };
 
 #define DRM_EXYNOS_IPP_FLAGS (DRM_EXYNOS_IPP_FLAG_EVENT |\
-		DRM_EXYNOS_IPP_FLAG_TEST_ONLY | DRM_EXYNOS_IPP_FLAG_NONBLOCK)
+		DRM_EXYNOS_IPP_FLAG_TEST_ONLY | DRM_EXYNOS_IPP_FLAG_NONBLOCK |\
+		DRM_EXYNOS_IPP_FLAG_IN_FENCE | DRM_EXYNOS_IPP_FLAG_OUT_FENCE)
 
 /**
  * Perform image processing described by array of drm_exynos_ipp_task_*
@@ -334,7 +361,9 @@ enum drm_exynos_ipp_flag {
  *
  * @ipp_id: id of IPP module to run the task
  * @flags: bitmask of drm_exynos_ipp_flag values
- * @reserved: padding
+ * @fence_fd: in-fence sync_file fd with DRM_EXYNOS_IPP_FLAG_IN_FENCE, returns
+ *	the out-fence sync_file fd with DRM_EXYNOS_IPP_FLAG_OUT_FENCE, must be
+ *	zero otherwise (was reserved)
  * @params_size: size of parameters array (in bytes)
  * @params_ptr: pointer to parameters array or NULL
  * @user_data: (optional) data for drm event
@@ -342,7 +371,10 @@ enum drm_exynos_ipp_flag {
 struct drm_exynos_ioctl_ipp_commit {
 	__u32 ipp_id;
 	__u32 flags;
-	__u32 reserved;
+	union {
+		__u32 reserved;
+		__s32 fence_fd;
+	};
 	__u32 params_size;
 	__u64 params_ptr;
 	__u64 user_data;
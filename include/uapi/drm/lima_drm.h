@@ -21,6 +21,8 @@ enum drm_lima_param {
 	DRM_LIMA_PARAM_NUM_PP,
 	DRM_LIMA_PARAM_GP_VERSION,
 	DRM_LIMA_PARAM_PP_VERSION,
+	DRM_LIMA_PARAM_HEAP_HWM,   /* largest heap size needed so far */
+	DRM_LIMA_PARAM_HEAP_GROWS, /* number of heap growths during tasks */
 };
 
 /**
@@ -137,12 +139,16 @@ struct drm_lima_gem_wait {
 	__s64 timeout_ns;  /* in, wait timeout in absulute time */
 };
 
+#define LIMA_CTX_PRIORITY_NORMAL 0
+#define LIMA_CTX_PRIORITY_LOW    1
+#define LIMA_CTX_PRIORITY_HIGH   2 /* needs CAP_SYS_NICE */
+
 /**
  * create a context
  */
 struct drm_lima_ctx_create {
 	__u32 id;          /* out, context handle */
-	__u32 _pad;        /* pad, must be zero */
+	__u32 priority;    /* in, LIMA_CTX_PRIORITY_*, was pad */
 };
 
 /**
@@ -166,7 +172,7 @@ struct drm_lima_ctx_free {
 #define DRM_IOCTL_LIMA_GEM_INFO DRM_IOWR(DRM_COMMAND_BASE + DRM_LIMA_GEM_INFO, struct drm_lima_gem_info)
 #define DRM_IOCTL_LIMA_GEM_SUBMIT DRM_IOW(DRM_COMMAND_BASE + DRM_LIMA_GEM_SUBMIT, struct drm_lima_gem_submit)
 #define DRM_IOCTL_LIMA_GEM_WAIT DRM_IOW(DRM_COMMAND_BASE + DRM_LIMA_GEM_WAIT, struct drm_lima_gem_wait)
-#define DRM_IOCTL_LIMA_CTX_CREATE DRM_IOR(DRM_COMMAND_BASE + DRM_LIMA_CTX_CREATE, struct drm_lima_ctx_create)
+#define DRM_IOCTL_LIMA_CTX_CREATE DRM_IOWR(DRM_COMMAND_BASE + DRM_LIMA_CTX_CREATE, struct drm_lima_ctx_create)
 #define DRM_IOCTL_LIMA_CTX_FREE DRM_IOW(DRM_COMMAND_BASE + DRM_LIMA_CTX_FREE, struct drm_lima_ctx_free)
 
 #if defined(__cplusplus)
@@ -62,6 +62,26 @@ enum {
 	CAN_RAW_RECV_OWN_MSGS,	/* receive my own msgs (default:off) */
 	CAN_RAW_FD_FRAMES,	/* allow CAN FD frames (default:off) */
 	CAN_RAW_JOIN_FILTERS,	/* all filters must match to trigger */
+	CAN_RAW_RECV_BATCH,	/* batched recvmsg() (default:off)   */
 };
 
+/* With CAN_RAW_RECV_BATCH enabled, a single recvmsg() returns as many
+ * queued frames as fit into the buffer. Each frame is preceded by a
+ * struct can_raw_batch_hdr and is followed by padding up to the next
+ * multiple of 8 bytes, see CAN_RAW_BATCH_RECLEN().
+ */
+struct can_raw_batch_hdr {
+	__u64 tstamp;	/* receive timestamp in ns, see flags */
+	__u32 ifindex;	/* interface the frame was received on */
+	__u16 flags;	/* CAN_RAW_BATCH_* flags */
+	__u16 len;	/* CAN_MTU or CANFD_MTU */
+};
+
+#define CAN_RAW_BATCH_HWTSTAMP	0x0001	/* tstamp is a hardware timestamp */
+#define CAN_RAW_BATCH_LOCAL	0x0002	/* frame was sent by a local socket */
+#define CAN_RAW_BATCH_OWN	0x0004	/* frame was sent by this socket */
+
+#define CAN_RAW_BATCH_RECLEN(len) \
+	((sizeof(struct can_raw_batch_hdr) + (len) + 7) & ~7)
+
 #endif /* !_UAPI_CAN_RAW_H */
@@ -5,6 +5,54 @@
 #ifndef _UAPI_IIO_BUFFER_H_
 #define _UAPI_IIO_BUFFER_H_
 
+#include <linux/types.h>
+
+/**
+ * struct iio_buffer_block_alloc_req - Descriptor for allocating IIO DMA blocks
+ * @type:	type of block(s) to allocate, reserved and must be zero
+ * @size:	size in bytes of each block
+ * @count:	number of blocks to allocate, updated with the number of
+ *		blocks that were actually allocated
+ * @id:		returns the identifier of the first allocated block
+ */
+struct iio_buffer_block_alloc_req {
+	__u32 type;
+	__u32 size;
+	__u32 count;
+	__u32 id;
+};
+
+/* The block has a valid timestamp set */
+#define IIO_BUFFER_BLOCK_FLAG_TIMESTAMP_VALID	(1 << 0)
+
+/**
+ * struct iio_buffer_block - Descriptor for a single IIO DMA block
+ * @id:		identifier of the block
+ * @size:	size of the block in bytes
+ * @bytes_used:	number of bytes in the block that contain valid data
+ * @type:	type of the block, reserved and must be zero
+ * @flags:	IIO_BUFFER_BLOCK_FLAG_* flags for the block
+ * @data.offset: offset to pass to mmap() to map the block
+ * @timestamp:	completion time of the block in nanoseconds (CLOCK_MONOTONIC)
+ */
+struct iio_buffer_block {
+	__u32 id;
+	__u32 size;
+	__u32 bytes_used;
+	__u32 type;
+	__u32 flags;
+	union {
+		__u32 offset;
+	} data;
+	__u64 timestamp;
+};
+
 #define IIO_BUFFER_GET_FD_IOCTL			_IOWR('i', 0x91, int)
 
+#define IIO_BUFFER_BLOCK_ALLOC_IOCTL	_IOWR('i', 0xa0, struct iio_buffer_block_alloc_req)
+#define IIO_BUFFER_BLOCK_FREE_IOCTL	_IO('i', 0xa1)
+#define IIO_BUFFER_BLOCK_QUERY_IOCTL	_IOWR('i', 0xa2, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_ENQUEUE_IOCTL	_IOWR('i', 0xa3, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_DEQUEUE_IOCTL	_IOWR('i', 0xa4, struct iio_buffer_block)
+
 #endif /* _UAPI_IIO_BUFFER_H_ */
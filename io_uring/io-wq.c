@@ -7,6 +7,8 @@
  */
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
 #include <linux/errno.h>
 #include <linux/sched/signal.h>
 #include <linux/percpu.h>
@@ -18,9 +20,13 @@
 
 #include "io-wq.h"
 
-#define WORKER_IDLE_TIMEOUT	(5 * HZ)
 #define WORKER_INIT_LIMIT	3
 
+/* how long an idle worker sticks around before exiting */
+static unsigned int worker_idle_ms = 5000;
+module_param(worker_idle_ms, uint, 0644);
+MODULE_PARM_DESC(worker_idle_ms, "idle time before an io-wq worker exits, in ms");
+
 enum {
 	IO_WORKER_F_UP		= 1,	/* up and active */
 	IO_WORKER_F_RUNNING	= 2,	/* account as running */
@@ -56,6 +62,7 @@ struct io_worker {
 	struct callback_head create_work;
 	int create_index;
 	int init_retries;
+	u64 create_time;
 
 	union {
 		struct rcu_head rcu;
@@ -104,6 +111,11 @@ struct io_wqe {
 	struct io_wq_work *hash_tail[IO_WQ_NR_HASH_BUCKETS];
 
 	cpumask_var_t cpu_mask;
+
+	/* worker creation latency, under ->lock */
+	unsigned long nr_created;
+	u64 create_ns_total;
+	u64 create_ns_max;
 };
 
 /*
@@ -626,9 +638,17 @@ static int io_wqe_worker(void *data)
 	struct io_wq *wq = wqe->wq;
 	bool last_timeout = false;
 	char buf[TASK_COMM_LEN];
+	u64 delta;
 
 	worker->flags |= (IO_WORKER_F_UP | IO_WORKER_F_RUNNING);
 
+	delta = ktime_get_ns() - worker->create_time;
+	raw_spin_lock(&wqe->lock);
+	wqe->nr_created++;
+	wqe->create_ns_total += delta;
+	wqe->create_ns_max = max(wqe->create_ns_max, delta);
+	raw_spin_unlock(&wqe->lock);
+
 	snprintf(buf, sizeof(buf), "iou-wrk-%d", wq->task->pid);
 	set_task_comm(current, buf);
 
@@ -654,7 +674,8 @@ static int io_wqe_worker(void *data)
 		raw_spin_unlock(&wqe->lock);
 		if (io_flush_signals())
 			continue;
-		ret = schedule_timeout(WORKER_IDLE_TIMEOUT);
+		ret = schedule_timeout(max(msecs_to_jiffies(READ_ONCE(worker_idle_ms)),
+					   1UL));
 		if (signal_pending(current)) {
 			struct ksignal ksig;
 
@@ -832,6 +853,8 @@ static bool create_io_worker(struct io_wq *wq, struct io_wqe *wqe, int index)
 	if (index == IO_WQ_ACCT_BOUND)
 		worker->flags |= IO_WORKER_F_BOUND;
 
+	/* retries through io_workqueue_create() count towards the latency */
+	worker->create_time = ktime_get_ns();
 	tsk = create_io_thread(io_wqe_worker, worker, wqe->node);
 	if (!IS_ERR(tsk)) {
 		io_init_new_worker(wqe, worker, tsk);
@@ -1404,6 +1427,26 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+void io_wq_get_stats(struct io_wq *wq, struct io_wq_stats *stats)
+{
+	int node;
+
+	memset(stats, 0, sizeof(*stats));
+
+	rcu_read_lock();
+	for_each_node(node) {
+		struct io_wqe *wqe = wq->wqes[node];
+
+		raw_spin_lock(&wqe->lock);
+		stats->nr_created += wqe->nr_created;
+		stats->create_ns_total += wqe->create_ns_total;
+		stats->create_ns_max = max(stats->create_ns_max,
+					   wqe->create_ns_max);
+		raw_spin_unlock(&wqe->lock);
+	}
+	rcu_read_unlock();
+}
+
 static __init int io_wq_init(void)
 {
 	int ret;
@@ -129,6 +129,14 @@ void io_wq_hash_work(struct io_wq_work *work, void *val);
 
 int io_wq_cpu_affinity(struct io_wq *wq, cpumask_var_t mask);
 int io_wq_max_workers(struct io_wq *wq, int *new_count);
+
+struct io_wq_stats {
+	unsigned long nr_created;
+	u64 create_ns_total;
+	u64 create_ns_max;
+};
+
+void io_wq_get_stats(struct io_wq *wq, struct io_wq_stats *stats);
 bool io_wq_worker_stopped(void);
 
 static inline bool io_wq_is_hashed(struct io_wq_work *work)
@@ -92,6 +92,15 @@
 #define IORING_MAX_CQ_ENTRIES	(2 * IORING_MAX_ENTRIES)
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 
+/*
+ * With this set, SQPOLL threads spin for about twice the observed gap between
+ * submissions rather than for the full sq_thread_idle, and go to sleep early
+ * when submissions come further apart than that anyway.
+ */
+static bool sqpoll_adaptive_idle;
+module_param(sqpoll_adaptive_idle, bool, 0644);
+MODULE_PARM_DESC(sqpoll_adaptive_idle, "scale SQPOLL spinning to the submission rate");
+
 /* only define max */
 #define IORING_MAX_FIXED_FILES	(1U << 15)
 #define IORING_MAX_RESTRICTIONS	(IORING_RESTRICTION_LAST + \
@@ -287,6 +296,10 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	/* idle spin bookkeeping, under ->lock */
+	unsigned long		cur_thread_idle;
+	u64			idle_gap_ns;
+	u64			idle_spin_ns;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
@@ -455,6 +468,9 @@ struct io_ring_ctx {
 		struct completion		ref_comp;
 		u32				iowq_limits[2];
 		bool				iowq_limits_set;
+
+		/* requests handed to io-wq, per opcode, for fdinfo */
+		atomic_t			iowq_punts[IORING_OP_LAST];
 	};
 };
 
@@ -1484,6 +1500,7 @@ static void io_queue_async_work(struct io_kiocb *req, bool *locked)
 
 	trace_io_uring_queue_async_work(ctx, io_wq_is_hashed(&req->work), req,
 					&req->work, req->flags);
+	atomic_inc(&ctx->iowq_punts[req->opcode]);
 	io_wq_enqueue(tctx->io_wq, &req->work);
 	if (link)
 		io_queue_linked_timeout(link);
@@ -7667,6 +7684,39 @@ static void io_sqd_update_thread_idle(struct io_sq_data *sqd)
 	sqd->sq_thread_idle = sq_thread_idle;
 }
 
+static unsigned long io_sqd_thread_idle(struct io_sq_data *sqd)
+{
+	unsigned long idle = sqd->sq_thread_idle;
+
+	if (READ_ONCE(sqpoll_adaptive_idle) && sqd->idle_gap_ns) {
+		unsigned long gap = nsecs_to_jiffies(2 * sqd->idle_gap_ns) + 1;
+
+		/* the next submission is unlikely to come while we spin */
+		idle = gap <= idle ? gap : max(idle / 8, 1UL);
+	}
+	sqd->cur_thread_idle = idle;
+	return idle;
+}
+
+/* work showed up, close the idle stretch that began at *idle_start */
+static void io_sqd_end_idle(struct io_sq_data *sqd, u64 *idle_start,
+			    u64 *spin_start)
+{
+	u64 now;
+
+	if (!*idle_start)
+		return;
+
+	now = ktime_get_ns();
+	if (*spin_start)
+		sqd->idle_spin_ns += now - *spin_start;
+	sqd->idle_gap_ns = sqd->idle_gap_ns ?
+		(sqd->idle_gap_ns * 7 + (now - *idle_start)) >> 3 :
+		now - *idle_start;
+	*idle_start = 0;
+	*spin_start = 0;
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -7688,6 +7738,7 @@ static int io_sq_thread(void *data)
 	struct io_sq_data *sqd = data;
 	struct io_ring_ctx *ctx;
 	unsigned long timeout = 0;
+	u64 idle_start = 0, spin_start = 0;
 	char buf[TASK_COMM_LEN];
 	DEFINE_WAIT(wait);
 
@@ -7707,7 +7758,7 @@ static int io_sq_thread(void *data)
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = jiffies + io_sqd_thread_idle(sqd);
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
@@ -7722,11 +7773,23 @@ static int io_sq_thread(void *data)
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			cond_resched();
-			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+			if (sqt_spin) {
+				io_sqd_end_idle(sqd, &idle_start, &spin_start);
+				timeout = jiffies + io_sqd_thread_idle(sqd);
+			} else if (!spin_start) {
+				spin_start = ktime_get_ns();
+				if (!idle_start)
+					idle_start = spin_start;
+			}
 			continue;
 		}
 
+		/* the gap keeps running while we sleep, the spin time does not */
+		if (spin_start) {
+			sqd->idle_spin_ns += ktime_get_ns() - spin_start;
+			spin_start = 0;
+		}
+
 		prepare_to_wait(&sqd->wait, &wait, TASK_INTERRUPTIBLE);
 		if (!io_sqd_events_pending(sqd) && !current->task_works) {
 			bool needs_sched = true;
@@ -7755,7 +7818,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = jiffies + io_sqd_thread_idle(sqd);
 	}
 
 	io_uring_cancel_generic(true, sqd);
@@ -10186,6 +10249,8 @@ static int io_uring_show_cred(struct seq_file *m, unsigned int id,
 static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 {
 	int sq_pid = -1, sq_cpu = -1;
+	unsigned int sq_idle_ms = 0;
+	u64 sq_spin_ns = 0;
 	bool has_lock;
 	int i;
 
@@ -10204,6 +10269,8 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 			if (sq->thread) {
 				sq_pid = task_pid_nr(sq->thread);
 				sq_cpu = task_cpu(sq->thread);
+				sq_idle_ms = jiffies_to_msecs(sq->cur_thread_idle);
+				sq_spin_ns = sq->idle_spin_ns;
 			}
 			mutex_unlock(&sq->lock);
 		}
@@ -10211,6 +10278,8 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 
 	seq_printf(m, "SqThread:\t%d\n", sq_pid);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq_cpu);
+	seq_printf(m, "SqThreadIdleMs:\t%u\n", sq_idle_ms);
+	seq_printf(m, "SqThreadSpinUs:\t%llu\n", div_u64(sq_spin_ns, NSEC_PER_USEC));
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(ctx, i);
@@ -10235,6 +10304,34 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 		xa_for_each(&ctx->personalities, index, cred)
 			io_uring_show_cred(m, index, cred);
 	}
+	seq_printf(m, "IoWqWorkers:\n");
+	if (has_lock) {
+		struct io_tctx_node *node;
+
+		list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+			struct io_uring_task *tctx = node->task->io_uring;
+			struct io_wq_stats st;
+			u64 avg = 0;
+
+			/* io_wq stays alive while we hold uring_lock */
+			if (!tctx || !tctx->io_wq)
+				continue;
+			io_wq_get_stats(tctx->io_wq, &st);
+			if (st.nr_created)
+				avg = div64_ul(st.create_ns_total, st.nr_created);
+			seq_printf(m, "  pid=%d, created=%lu, create_avg_us=%llu, create_max_us=%llu\n",
+				   task_pid_nr(node->task), st.nr_created,
+				   div_u64(avg, NSEC_PER_USEC),
+				   div_u64(st.create_ns_max, NSEC_PER_USEC));
+		}
+	}
+	seq_printf(m, "IoWqPunts:\n");
+	for (i = 0; i < IORING_OP_LAST; i++) {
+		int punts = atomic_read(&ctx->iowq_punts[i]);
+
+		if (punts)
+			seq_printf(m, "  op=%d, punts=%d\n", i, punts);
+	}
 	seq_printf(m, "PollList:\n");
 	spin_lock(&ctx->completion_lock);
 	for (i = 0; i < (1U << ctx->cancel_hash_bits); i++) {
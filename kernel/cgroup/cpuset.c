@@ -242,6 +242,7 @@ typedef enum {
 	CS_SCHED_LOAD_BALANCE,
 	CS_SPREAD_PAGE,
 	CS_SPREAD_SLAB,
+	CS_ISOLATE,
 } cpuset_flagbits_t;
 
 /* convenient tests for these bits */
@@ -285,6 +286,11 @@ static inline int is_spread_slab(const struct cpuset *cs)
 	return test_bit(CS_SPREAD_SLAB, &cs->flags);
 }
 
+static inline int is_isolate(const struct cpuset *cs)
+{
+	return test_bit(CS_ISOLATE, &cs->flags);
+}
+
 static inline int is_partition_root(const struct cpuset *cs)
 {
 	return cs->partition_root_state > 0;
@@ -1026,6 +1032,146 @@ partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
 	mutex_unlock(&sched_domains_mutex);
 }
 
+/*
+ * Keep kernel activity off isolated partitions.
+ *
+ * The effective CPUs of every valid partition root with cpus.isolate set
+ * are collected into isolated_cpus.  Interrupts whose affinity can be
+ * changed and unbound kthreads still on their default affinity are then
+ * moved to the remaining housekeeping CPUs.  This runs from a work item
+ * since moving interrupts takes locks that nest outside cpuset_mutex.
+ * The unbound workqueue cpumask belongs to the administrator and is left
+ * alone.
+ *
+ * Interrupt affinities are only narrowed, so CPUs returned from an
+ * isolated partition are picked up again by new interrupts only.  The
+ * kthreads moved here follow the isolated set both ways.
+ */
+static cpumask_var_t isolated_cpus;
+
+static void cpuset_isolate_kthreads(const struct cpumask *cpus,
+				    const struct cpumask *fallback)
+{
+	const struct cpumask *def = housekeeping_cpumask(HK_FLAG_KTHREAD);
+	struct task_struct *g, *p, **tasks;
+	unsigned int nr = 0, max = 0, i;
+	cpumask_var_t mask, moved;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+	if (!alloc_cpumask_var(&moved, GFP_KERNEL)) {
+		free_cpumask_var(mask);
+		return;
+	}
+
+	/* The affinity given to kthreads by the previous and this update */
+	if (!cpumask_andnot(moved, def, isolated_cpus))
+		cpumask_copy(moved, def);
+	if (!cpumask_andnot(mask, def, cpus))
+		cpumask_copy(mask, fallback);
+
+	rcu_read_lock();
+	for_each_process_thread(g, p)
+		if (p->flags & PF_KTHREAD)
+			max++;
+	rcu_read_unlock();
+
+	tasks = kcalloc(max, sizeof(*tasks), GFP_KERNEL);
+	if (!tasks)
+		goto out;
+
+	/*
+	 * Per-CPU kthreads and ones whose owner set an affinity stay put,
+	 * only those left on the default one (or on the one we gave them
+	 * last time) are moved.
+	 */
+	rcu_read_lock();
+	for_each_process_thread(g, p) {
+		if (nr == max)
+			break;
+		if (!(p->flags & PF_KTHREAD) ||
+		    (p->flags & PF_NO_SETAFFINITY) ||
+		    p->nr_cpus_allowed == 1 || kthread_is_per_cpu(p) ||
+		    cpumask_equal(p->cpus_ptr, mask))
+			continue;
+		if (!cpumask_equal(p->cpus_ptr, def) &&
+		    !cpumask_equal(p->cpus_ptr, moved))
+			continue;
+		get_task_struct(p);
+		tasks[nr++] = p;
+	}
+	rcu_read_unlock();
+
+	for (i = 0; i < nr; i++) {
+		p = tasks[i];
+		set_cpus_allowed_ptr(p, mask);
+		put_task_struct(p);
+	}
+
+	kfree(tasks);
+out:
+	free_cpumask_var(moved);
+	free_cpumask_var(mask);
+}
+
+static void cpuset_isolation_workfn(struct work_struct *work)
+{
+	struct cgroup_subsys_state *pos_css;
+	cpumask_var_t cpus, housekeeping;
+	struct cpuset *cs;
+
+	if (!alloc_cpumask_var(&cpus, GFP_KERNEL))
+		return;
+	if (!alloc_cpumask_var(&housekeeping, GFP_KERNEL)) {
+		free_cpumask_var(cpus);
+		return;
+	}
+
+	cpumask_clear(cpus);
+
+	cpus_read_lock();
+	mutex_lock(&cpuset_mutex);
+	rcu_read_lock();
+	cpuset_for_each_descendant_pre(cs, pos_css, &top_cpuset) {
+		if (cs == &top_cpuset)
+			continue;
+		if (!is_partition_root(cs)) {
+			pos_css = css_rightmost_descendant(pos_css);
+			continue;
+		}
+		if (is_isolate(cs))
+			cpumask_or(cpus, cpus, cs->effective_cpus);
+	}
+	rcu_read_unlock();
+	mutex_unlock(&cpuset_mutex);
+	cpus_read_unlock();
+
+	if (cpumask_equal(cpus, isolated_cpus))
+		goto out;
+
+	cpumask_andnot(housekeeping, housekeeping_cpumask(HK_FLAG_DOMAIN), cpus);
+	if (!cpumask_intersects(housekeeping, cpu_online_mask)) {
+		pr_warn("cpuset: no housekeeping CPU left, not isolating %*pbl\n",
+			cpumask_pr_args(cpus));
+		goto out;
+	}
+
+	irq_affinity_exclude_cpus(cpus, housekeeping);
+	cpuset_isolate_kthreads(cpus, housekeeping);
+
+	cpumask_copy(isolated_cpus, cpus);
+out:
+	free_cpumask_var(housekeeping);
+	free_cpumask_var(cpus);
+}
+
+static DECLARE_WORK(cpuset_isolation_work, cpuset_isolation_workfn);
+
+static void cpuset_update_isolation(void)
+{
+	schedule_work(&cpuset_isolation_work);
+}
+
 /*
  * Rebuild scheduler domains.
  *
@@ -1048,6 +1194,8 @@ static void rebuild_sched_domains_locked(void)
 	lockdep_assert_cpus_held();
 	lockdep_assert_held(&cpuset_mutex);
 
+	cpuset_update_isolation();
+
 	/*
 	 * If we have raced with CPU hotplug, return early to avoid
 	 * passing doms with offlined cpu to partition_sched_domains().
@@ -1089,6 +1237,10 @@ static void rebuild_sched_domains_locked(void)
 	partition_and_rebuild_sched_domains(ndoms, doms, attr);
 }
 #else /* !CONFIG_SMP */
+static void cpuset_update_isolation(void)
+{
+}
+
 static void rebuild_sched_domains_locked(void)
 {
 }
@@ -1987,6 +2139,7 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 	struct cpuset *trialcs;
 	int balance_flag_changed;
 	int spread_flag_changed;
+	int isolate_flag_changed;
 	int err;
 
 	trialcs = alloc_trial_cpuset(cs);
@@ -2005,6 +2158,8 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 	balance_flag_changed = (is_sched_load_balance(cs) !=
 				is_sched_load_balance(trialcs));
 
+	isolate_flag_changed = (is_isolate(cs) != is_isolate(trialcs));
+
 	spread_flag_changed = ((is_spread_slab(cs) != is_spread_slab(trialcs))
 			|| (is_spread_page(cs) != is_spread_page(trialcs)));
 
@@ -2017,6 +2172,9 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 
 	if (spread_flag_changed)
 		update_tasks_flags(cs);
+
+	if (isolate_flag_changed)
+		cpuset_update_isolation();
 out:
 	free_cpuset(trialcs);
 	return err;
@@ -2405,6 +2563,7 @@ typedef enum {
 	FILE_MEMORY_PRESSURE,
 	FILE_SPREAD_PAGE,
 	FILE_SPREAD_SLAB,
+	FILE_ISOLATE,
 } cpuset_filetype_t;
 
 static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
@@ -2446,6 +2605,9 @@ static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
 	case FILE_SPREAD_SLAB:
 		retval = update_flag(CS_SPREAD_SLAB, cs, val);
 		break;
+	case FILE_ISOLATE:
+		retval = update_flag(CS_ISOLATE, cs, val);
+		break;
 	default:
 		retval = -EINVAL;
 		break;
@@ -2613,6 +2775,8 @@ static u64 cpuset_read_u64(struct cgroup_subsys_state *css, struct cftype *cft)
 		return is_spread_page(cs);
 	case FILE_SPREAD_SLAB:
 		return is_spread_slab(cs);
+	case FILE_ISOLATE:
+		return is_isolate(cs);
 	default:
 		BUG();
 	}
@@ -2837,6 +3001,14 @@ static struct cftype dfl_files[] = {
 		.file_offset = offsetof(struct cpuset, partition_file),
 	},
 
+	{
+		.name = "cpus.isolate",
+		.read_u64 = cpuset_read_u64,
+		.write_u64 = cpuset_write_u64,
+		.private = FILE_ISOLATE,
+		.flags = CFTYPE_NOT_ON_ROOT,
+	},
+
 	{
 		.name = "cpus.subpartitions",
 		.seq_show = cpuset_common_seq_show,
@@ -3067,6 +3239,9 @@ int __init cpuset_init(void)
 	top_cpuset.relax_domain_level = -1;
 
 	BUG_ON(!alloc_cpumask_var(&cpus_attach, GFP_KERNEL));
+#ifdef CONFIG_SMP
+	BUG_ON(!zalloc_cpumask_var(&isolated_cpus, GFP_KERNEL));
+#endif
 
 	return 0;
 }
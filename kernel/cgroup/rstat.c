@@ -6,6 +6,18 @@
 static DEFINE_SPINLOCK(cgroup_rstat_lock);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
+/*
+ * Stat reads skip the flush if @cgrp or one of its ancestors was flushed
+ * less than this many milliseconds ago.  0 always flushes.
+ */
+static unsigned int cgroup_rstat_flush_ms;
+
+static int __init cgroup_rstat_flush_ms_setup(char *str)
+{
+	return !kstrtouint(str, 0, &cgroup_rstat_flush_ms);
+}
+__setup("cgroup_rstat_flush_ms=", cgroup_rstat_flush_ms_setup);
+
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
 static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
@@ -152,11 +164,22 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 
 	lockdep_assert_held(&cgroup_rstat_lock);
 
+	cgrp->rstat_flush_jiffies = jiffies;
+
 	for_each_possible_cpu(cpu) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
 						       cpu);
 		struct cgroup *pos = NULL;
 
+		/*
+		 * Speculative test, see cgroup_rstat_updated().  If @cgrp
+		 * isn't on the updated tree of @cpu, none of its descendants
+		 * are either.  An update racing with this is picked up by
+		 * the next flush, like one that comes right after it.
+		 */
+		if (!READ_ONCE(cgroup_rstat_cpu(cgrp, cpu)->updated_next))
+			continue;
+
 		raw_spin_lock(cpu_lock);
 		while ((pos = cgroup_rstat_cpu_pop_updated(pos, cgrp, cpu))) {
 			struct cgroup_subsys_state *css;
@@ -219,12 +242,38 @@ void cgroup_rstat_flush_irqsafe(struct cgroup *cgrp)
 	spin_unlock_irqrestore(&cgroup_rstat_lock, flags);
 }
 
+/*
+ * Returns true if @cgrp's subtree was flushed within cgroup_rstat_flush_ms,
+ * either directly or as part of an ancestor's subtree.
+ */
+static bool cgroup_rstat_flushed_recently(struct cgroup *cgrp)
+{
+	unsigned long since;
+
+	lockdep_assert_held(&cgroup_rstat_lock);
+
+	if (!cgroup_rstat_flush_ms)
+		return false;
+
+	since = jiffies - msecs_to_jiffies(cgroup_rstat_flush_ms);
+
+	for (; cgrp; cgrp = cgroup_parent(cgrp)) {
+		if (cgrp->rstat_flush_jiffies &&
+		    time_after_eq(cgrp->rstat_flush_jiffies, since))
+			return true;
+	}
+
+	return false;
+}
+
 /**
  * cgroup_rstat_flush_hold - flush stats in @cgrp's subtree and hold
  * @cgrp: target cgroup
  *
  * Flush stats in @cgrp's subtree and prevent further flushes.  Must be
- * paired with cgroup_rstat_flush_release().
+ * paired with cgroup_rstat_flush_release().  The flush is skipped if the
+ * subtree was flushed within the cgroup_rstat_flush_ms= window, so the
+ * stats read may be that much out of date.
  *
  * This function may block.
  */
@@ -233,7 +282,8 @@ void cgroup_rstat_flush_hold(struct cgroup *cgrp)
 {
 	might_sleep();
 	spin_lock_irq(&cgroup_rstat_lock);
-	cgroup_rstat_flush_locked(cgrp, true);
+	if (!cgroup_rstat_flushed_recently(cgrp))
+		cgroup_rstat_flush_locked(cgrp, true);
 }
 
 /**
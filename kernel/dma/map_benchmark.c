@@ -15,6 +15,7 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 
@@ -27,6 +28,21 @@
 #define DMA_MAP_TO_DEVICE	1
 #define DMA_MAP_FROM_DEVICE	2
 
+#define DMA_MAP_SINGLE_MODE	0	/* dma_map_single/dma_unmap_single */
+#define DMA_MAP_SG_MODE		1	/* dma_map_sgtable/dma_unmap_sgtable */
+#define DMA_MAP_SYNC_MODE	2	/* dma_sync_single_for_device/cpu */
+
+#define DMA_MAP_MAX_NENTS	256
+
+/* output flags */
+#define DMA_MAP_BENCHMARK_F_IOMMU	(1U << 0) /* device is behind an IOMMU */
+
+/*
+ * Bucket 0 counts latencies of 0ns, bucket i counts [2^(i-1), 2^i) ns and
+ * the last bucket everything longer.
+ */
+#define DMA_MAP_HIST_BUCKETS	32
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -39,7 +55,12 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;	/* how many PAGE_SIZE will do map/unmap once a time */
-	__u8 expansion[76];	/* For future use */
+	__u32 mode; /* what to measure, DMA_MAP_*_MODE */
+	__u32 nents; /* sg entries of granule pages each in DMA_MAP_SG_MODE */
+	__u32 flags; /* DMA_MAP_BENCHMARK_F_*, set by the kernel */
+	__u64 hist_addr; /* user buffer for __u64 [2][DMA_MAP_HIST_BUCKETS]
+			  * map and unmap latency histograms, or 0 */
+	__u8 expansion[56];	/* For future use */
 };
 
 struct map_benchmark_data {
@@ -52,21 +73,154 @@ struct map_benchmark_data {
 	atomic64_t sum_sq_map;
 	atomic64_t sum_sq_unmap;
 	atomic64_t loops;
+	atomic64_t map_hist[DMA_MAP_HIST_BUCKETS];
+	atomic64_t unmap_hist[DMA_MAP_HIST_BUCKETS];
 };
 
-static int map_benchmark_thread(void *data)
-{
+/*
+ * The buffer one benchmark thread maps over and over: a single contiguous
+ * one for the single and sync modes, nents separately allocated chunks for
+ * the sg mode so that the list really is scattered.
+ */
+struct map_benchmark_buf {
 	void *buf;
+	struct sg_table sgt;
 	dma_addr_t dma_addr;
-	struct map_benchmark_data *map = data;
-	int npages = map->bparam.granule;
-	u64 size = npages * PAGE_SIZE;
-	int ret = 0;
+};
+
+static void map_benchmark_free_buf(struct map_benchmark_data *map,
+				   struct map_benchmark_buf *mb)
+{
+	u64 size = map->bparam.granule * PAGE_SIZE;
+	struct scatterlist *sg;
+	int i;
+
+	if (map->bparam.mode != DMA_MAP_SG_MODE) {
+		free_pages_exact(mb->buf, size);
+		return;
+	}
+
+	for_each_sgtable_sg(&mb->sgt, sg, i)
+		if (sg_page(sg))
+			free_pages_exact(sg_virt(sg), size);
+	sg_free_table(&mb->sgt);
+}
+
+static int map_benchmark_alloc_buf(struct map_benchmark_data *map,
+				   struct map_benchmark_buf *mb)
+{
+	u64 size = map->bparam.granule * PAGE_SIZE;
+	struct scatterlist *sg;
+	void *buf;
+	int i;
 
-	buf = alloc_pages_exact(size, GFP_KERNEL);
-	if (!buf)
+	if (map->bparam.mode != DMA_MAP_SG_MODE) {
+		mb->buf = alloc_pages_exact(size, GFP_KERNEL);
+		return mb->buf ? 0 : -ENOMEM;
+	}
+
+	if (sg_alloc_table(&mb->sgt, map->bparam.nents, GFP_KERNEL))
 		return -ENOMEM;
 
+	for_each_sgtable_sg(&mb->sgt, sg, i) {
+		buf = alloc_pages_exact(size, GFP_KERNEL);
+		if (!buf) {
+			map_benchmark_free_buf(map, mb);
+			return -ENOMEM;
+		}
+		sg_set_buf(sg, buf, size);
+	}
+
+	return 0;
+}
+
+static void map_benchmark_stain_buf(struct map_benchmark_data *map,
+				    struct map_benchmark_buf *mb)
+{
+	u64 size = map->bparam.granule * PAGE_SIZE;
+	struct scatterlist *sg;
+	int i;
+
+	if (map->bparam.mode != DMA_MAP_SG_MODE) {
+		memset(mb->buf, 0x66, size);
+		return;
+	}
+
+	for_each_sgtable_sg(&mb->sgt, sg, i)
+		memset(sg_virt(sg), 0x66, sg->length);
+}
+
+static int map_benchmark_map(struct map_benchmark_data *map,
+			     struct map_benchmark_buf *mb)
+{
+	u64 size = map->bparam.granule * PAGE_SIZE;
+
+	switch (map->bparam.mode) {
+	case DMA_MAP_SG_MODE:
+		return dma_map_sgtable(map->dev, &mb->sgt, map->dir, 0);
+	case DMA_MAP_SYNC_MODE:
+		dma_sync_single_for_device(map->dev, mb->dma_addr, size,
+					   map->dir);
+		return 0;
+	default:
+		mb->dma_addr = dma_map_single(map->dev, mb->buf, size, map->dir);
+		if (unlikely(dma_mapping_error(map->dev, mb->dma_addr)))
+			return -ENOMEM;
+		return 0;
+	}
+}
+
+static void map_benchmark_unmap(struct map_benchmark_data *map,
+				struct map_benchmark_buf *mb)
+{
+	u64 size = map->bparam.granule * PAGE_SIZE;
+
+	switch (map->bparam.mode) {
+	case DMA_MAP_SG_MODE:
+		dma_unmap_sgtable(map->dev, &mb->sgt, map->dir, 0);
+		break;
+	case DMA_MAP_SYNC_MODE:
+		dma_sync_single_for_cpu(map->dev, mb->dma_addr, size, map->dir);
+		break;
+	default:
+		dma_unmap_single(map->dev, mb->dma_addr, size, map->dir);
+		break;
+	}
+}
+
+static void map_benchmark_hist_add(atomic64_t *hist, ktime_t delta)
+{
+	int bucket = min(fls64(ktime_to_ns(delta)), DMA_MAP_HIST_BUCKETS - 1);
+
+	atomic64_inc(&hist[bucket]);
+}
+
+static int map_benchmark_thread(void *data)
+{
+	struct map_benchmark_buf mb = {};
+	struct map_benchmark_data *map = data;
+	u64 size = map->bparam.granule * PAGE_SIZE;
+	int ret;
+
+	ret = map_benchmark_alloc_buf(map, &mb);
+	if (ret)
+		return ret;
+
+	/*
+	 * The sync mode measures the cache maintenance of a mapping that is
+	 * kept around, as a driver recycling its buffers would do, so the
+	 * buffer is mapped only once.
+	 */
+	if (map->bparam.mode == DMA_MAP_SYNC_MODE) {
+		mb.dma_addr = dma_map_single(map->dev, mb.buf, size, map->dir);
+		if (unlikely(dma_mapping_error(map->dev, mb.dma_addr))) {
+			pr_err("dma_map_single failed on %s\n",
+				dev_name(map->dev));
+			ret = -ENOMEM;
+			goto out_free;
+		}
+	}
+
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
 		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
@@ -79,14 +233,12 @@ static int map_benchmark_thread(void *data)
 		 * 66 means evertything goes well! 66 is lucky.
 		 */
 		if (map->dir != DMA_FROM_DEVICE)
-			memset(buf, 0x66, size);
+			map_benchmark_stain_buf(map, &mb);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
+		ret = map_benchmark_map(map, &mb);
+		if (unlikely(ret)) {
+			pr_err("dma map failed on %s\n", dev_name(map->dev));
 			goto out;
 		}
 		map_etime = ktime_get();
@@ -96,7 +248,7 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		map_benchmark_unmap(map, &mb);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -112,6 +264,8 @@ static int map_benchmark_thread(void *data)
 		atomic64_add(map_sq, &map->sum_sq_map);
 		atomic64_add(unmap_sq, &map->sum_sq_unmap);
 		atomic64_inc(&map->loops);
+		map_benchmark_hist_add(map->map_hist, map_delta);
+		map_benchmark_hist_add(map->unmap_hist, unmap_delta);
 
 		/*
 		 * We may test for a long time so periodically check whether
@@ -131,7 +285,10 @@ static int map_benchmark_thread(void *data)
 	}
 
 out:
-	free_pages_exact(buf, size);
+	if (map->bparam.mode == DMA_MAP_SYNC_MODE)
+		dma_unmap_single(map->dev, mb.dma_addr, size, map->dir);
+out_free:
+	map_benchmark_free_buf(map, &mb);
 	return ret;
 }
 
@@ -169,6 +326,10 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	atomic64_set(&map->sum_sq_map, 0);
 	atomic64_set(&map->sum_sq_unmap, 0);
 	atomic64_set(&map->loops, 0);
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		atomic64_set(&map->map_hist[i], 0);
+		atomic64_set(&map->unmap_hist[i], 0);
+	}
 
 	for (i = 0; i < threads; i++) {
 		get_task_struct(tsk[i]);
@@ -215,6 +376,22 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	return ret;
 }
 
+static int map_benchmark_copy_hist(struct map_benchmark_data *map)
+{
+	u64 __user *uhist = u64_to_user_ptr(map->bparam.hist_addr);
+	u64 hist[2][DMA_MAP_HIST_BUCKETS];
+	int i;
+
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		hist[0][i] = atomic64_read(&map->map_hist[i]);
+		hist[1][i] = atomic64_read(&map->unmap_hist[i]);
+	}
+
+	if (copy_to_user(uhist, hist, sizeof(hist)))
+		return -EFAULT;
+	return 0;
+}
+
 static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 		unsigned long arg)
 {
@@ -257,6 +434,22 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		switch (map->bparam.mode) {
+		case DMA_MAP_SG_MODE:
+			if (map->bparam.nents < 1 ||
+			    map->bparam.nents > DMA_MAP_MAX_NENTS) {
+				pr_err("invalid sg entry number\n");
+				return -EINVAL;
+			}
+			break;
+		case DMA_MAP_SINGLE_MODE:
+		case DMA_MAP_SYNC_MODE:
+			break;
+		default:
+			pr_err("invalid benchmark mode\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -294,6 +487,16 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 
 		if (ret)
 			return ret;
+
+		map->bparam.flags = 0;
+		if (device_iommu_mapped(map->dev))
+			map->bparam.flags |= DMA_MAP_BENCHMARK_F_IOMMU;
+
+		if (map->bparam.hist_addr) {
+			ret = map_benchmark_copy_hist(map);
+			if (ret)
+				return ret;
+		}
 		break;
 	default:
 		return -EINVAL;
@@ -80,6 +80,9 @@ static unsigned int max_segment;
 
 static unsigned long default_nslabs = IO_TLB_DEFAULT_SIZE >> IO_TLB_SHIFT;
 
+/* 0 means one area per possible CPU */
+static unsigned int default_nareas;
+
 static int __init
 setup_io_tlb_npages(char *str)
 {
@@ -90,6 +93,14 @@ setup_io_tlb_npages(char *str)
 	}
 	if (*str == ',')
 		++str;
+	if (isdigit(*str)) {
+		unsigned long nareas = simple_strtoul(str, &str, 0);
+
+		if (nareas)
+			default_nareas = roundup_pow_of_two(nareas);
+		if (*str == ',')
+			++str;
+	}
 	if (!strcmp(str, "force"))
 		swiotlb_force = SWIOTLB_FORCE;
 	else if (!strcmp(str, "noforce"))
@@ -155,6 +166,31 @@ static inline unsigned long nr_slots(u64 val)
 	return DIV_ROUND_UP(val, IO_TLB_SIZE);
 }
 
+/*
+ * Number of areas for a pool of nslabs slots: a power of two, and small
+ * enough that every area still holds at least one whole segment.
+ */
+static unsigned int swiotlb_nareas(unsigned long nslabs)
+{
+	unsigned long nareas = default_nareas ? :
+		roundup_pow_of_two(num_possible_cpus());
+
+	if (nslabs < nareas * IO_TLB_SEGSIZE)
+		nareas = nslabs >= IO_TLB_SEGSIZE ?
+			rounddown_pow_of_two(nslabs / IO_TLB_SEGSIZE) : 1;
+	return nareas;
+}
+
+static unsigned long mem_used(struct io_tlb_mem *mem)
+{
+	unsigned long used = 0;
+	int i;
+
+	for (i = 0; i < mem->nareas; i++)
+		used += mem->areas[i].used;
+	return used;
+}
+
 /*
  * Early SWIOTLB allocation may be too early to allow an architecture to
  * perform the desired operations.  This function allows the architecture to
@@ -176,7 +212,8 @@ void __init swiotlb_update_mem_attributes(void)
 }
 
 static void swiotlb_init_io_tlb_mem(struct io_tlb_mem *mem, phys_addr_t start,
-				    unsigned long nslabs, bool late_alloc)
+				    unsigned long nslabs, bool late_alloc,
+				    unsigned int nareas)
 {
 	void *vaddr = phys_to_virt(start);
 	unsigned long bytes = nslabs << IO_TLB_SHIFT, i;
@@ -184,13 +221,25 @@ static void swiotlb_init_io_tlb_mem(struct io_tlb_mem *mem, phys_addr_t start,
 	mem->nslabs = nslabs;
 	mem->start = start;
 	mem->end = mem->start + bytes;
-	mem->index = 0;
 	mem->late_alloc = late_alloc;
 
 	if (swiotlb_force == SWIOTLB_FORCE)
 		mem->force_bounce = true;
 
-	spin_lock_init(&mem->lock);
+	/*
+	 * Areas are made of whole segments, so that no free run of slots
+	 * crosses into the next area; any slots left over at the end of the
+	 * pool are not used.
+	 */
+	mem->nareas = nareas;
+	mem->area_nslabs = nareas == 1 ? nslabs :
+		ALIGN_DOWN(nslabs / nareas, IO_TLB_SEGSIZE);
+	for (i = 0; i < nareas; i++) {
+		spin_lock_init(&mem->areas[i].lock);
+		mem->areas[i].index = 0;
+		mem->areas[i].used = 0;
+	}
+
 	for (i = 0; i < mem->nslabs; i++) {
 		mem->slots[i].list = IO_TLB_SEGSIZE - io_tlb_offset(i);
 		mem->slots[i].orig_addr = INVALID_PHYS_ADDR;
@@ -202,6 +251,7 @@ static void swiotlb_init_io_tlb_mem(struct io_tlb_mem *mem, phys_addr_t start,
 int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 {
 	struct io_tlb_mem *mem = &io_tlb_default_mem;
+	unsigned int nareas = swiotlb_nareas(nslabs);
 	size_t alloc_size;
 
 	if (swiotlb_force == SWIOTLB_NO_FORCE)
@@ -217,7 +267,13 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		panic("%s: Failed to allocate %zu bytes align=0x%lx\n",
 		      __func__, alloc_size, PAGE_SIZE);
 
-	swiotlb_init_io_tlb_mem(mem, __pa(tlb), nslabs, false);
+	alloc_size = array_size(sizeof(*mem->areas), nareas);
+	mem->areas = memblock_alloc(alloc_size, SMP_CACHE_BYTES);
+	if (!mem->areas)
+		panic("%s: Failed to allocate %zu bytes align=0x%x\n",
+		      __func__, alloc_size, SMP_CACHE_BYTES);
+
+	swiotlb_init_io_tlb_mem(mem, __pa(tlb), nslabs, false, nareas);
 
 	if (verbose)
 		swiotlb_print_info();
@@ -305,6 +361,7 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 {
 	struct io_tlb_mem *mem = &io_tlb_default_mem;
 	unsigned long bytes = nslabs << IO_TLB_SHIFT;
+	unsigned int nareas = swiotlb_nareas(nslabs);
 
 	if (swiotlb_force == SWIOTLB_NO_FORCE)
 		return 0;
@@ -313,13 +370,20 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 	if (WARN_ON_ONCE(mem->nslabs))
 		return -ENOMEM;
 
+	mem->areas = kcalloc(nareas, sizeof(*mem->areas), GFP_KERNEL);
+	if (!mem->areas)
+		return -ENOMEM;
+
 	mem->slots = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO,
 		get_order(array_size(sizeof(*mem->slots), nslabs)));
-	if (!mem->slots)
+	if (!mem->slots) {
+		kfree(mem->areas);
+		mem->areas = NULL;
 		return -ENOMEM;
+	}
 
 	set_memory_decrypted((unsigned long)tlb, bytes >> PAGE_SHIFT);
-	swiotlb_init_io_tlb_mem(mem, virt_to_phys(tlb), nslabs, true);
+	swiotlb_init_io_tlb_mem(mem, virt_to_phys(tlb), nslabs, true, nareas);
 
 	swiotlb_print_info();
 	swiotlb_set_max_segment(mem->nslabs << IO_TLB_SHIFT);
@@ -344,9 +408,12 @@ void __init swiotlb_exit(void)
 	if (mem->late_alloc) {
 		free_pages(tbl_vaddr, get_order(tbl_size));
 		free_pages((unsigned long)mem->slots, get_order(slots_size));
+		kfree(mem->areas);
 	} else {
 		memblock_free_late(mem->start, tbl_size);
 		memblock_free_late(__pa(mem->slots), slots_size);
+		memblock_free_late(__pa(mem->areas),
+				   array_size(sizeof(*mem->areas), mem->nareas));
 	}
 
 	memset(mem, 0, sizeof(*mem));
@@ -450,29 +517,84 @@ static inline unsigned long get_max_slots(unsigned long boundary_mask)
 	return nr_slots(boundary_mask + 1);
 }
 
-static unsigned int wrap_index(struct io_tlb_mem *mem, unsigned int index)
+static unsigned int wrap_area_index(struct io_tlb_mem *mem, unsigned int index)
 {
-	if (index >= mem->nslabs)
+	if (index >= mem->area_nslabs)
 		return 0;
 	return index;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void inc_used_and_hiwater(struct io_tlb_mem *mem, unsigned int nslots)
+{
+	unsigned long old_hiwater, new_used;
+
+	new_used = atomic_long_add_return(nslots, &mem->total_used);
+	old_hiwater = atomic_long_read(&mem->used_hiwater);
+	do {
+		if (new_used <= old_hiwater)
+			break;
+	} while (!atomic_long_try_cmpxchg(&mem->used_hiwater,
+					  &old_hiwater, new_used));
+}
+
+static void dec_used(struct io_tlb_mem *mem, unsigned int nslots)
+{
+	atomic_long_sub(nslots, &mem->total_used);
+}
+
+static void swiotlb_area_lock(struct io_tlb_mem *mem,
+			      struct io_tlb_area *area, unsigned long *flags)
+{
+	if (spin_trylock_irqsave(&area->lock, *flags))
+		return;
+	atomic_long_inc(&mem->contended);
+	spin_lock_irqsave(&area->lock, *flags);
+}
+
+static void count_area_fallback(struct io_tlb_mem *mem)
+{
+	atomic_long_inc(&mem->area_fallbacks);
+}
+#else
+static void inc_used_and_hiwater(struct io_tlb_mem *mem, unsigned int nslots)
+{
+}
+
+static void dec_used(struct io_tlb_mem *mem, unsigned int nslots)
+{
+}
+
+static void swiotlb_area_lock(struct io_tlb_mem *mem,
+			      struct io_tlb_area *area, unsigned long *flags)
+{
+	spin_lock_irqsave(&area->lock, *flags);
+}
+
+static void count_area_fallback(struct io_tlb_mem *mem)
+{
+}
+#endif
+
 /*
  * Find a suitable number of IO TLB entries size that will fit this request and
- * allocate a buffer from that IO TLB pool.
+ * allocate a buffer from the given area of that IO TLB pool.
  */
-static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
-			      size_t alloc_size, unsigned int alloc_align_mask)
+static int swiotlb_do_find_slots(struct device *dev, int area_index,
+				 phys_addr_t orig_addr, size_t alloc_size,
+				 unsigned int alloc_align_mask)
 {
 	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
+	struct io_tlb_area *area = mem->areas + area_index;
 	unsigned long boundary_mask = dma_get_seg_boundary(dev);
 	dma_addr_t tbl_dma_addr =
 		phys_to_dma_unencrypted(dev, mem->start) & boundary_mask;
 	unsigned long max_slots = get_max_slots(boundary_mask);
 	unsigned int iotlb_align_mask = dma_get_min_align_mask(dev);
 	unsigned int nslots = nr_slots(alloc_size), stride;
-	unsigned int index, wrap, count = 0, i;
+	unsigned int index, slot_index, wrap, count = 0, i;
 	unsigned int offset = swiotlb_align_offset(dev, orig_addr);
+	unsigned int slot_base = area_index * mem->area_nslabs;
 	unsigned long flags;
 
 	BUG_ON(!nslots);
@@ -495,16 +617,18 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 		stride = max(stride, stride << (PAGE_SHIFT - IO_TLB_SHIFT));
 	stride = max(stride, (alloc_align_mask >> IO_TLB_SHIFT) + 1);
 
-	spin_lock_irqsave(&mem->lock, flags);
-	if (unlikely(nslots > mem->nslabs - mem->used))
+	swiotlb_area_lock(mem, area, &flags);
+	if (unlikely(nslots > mem->area_nslabs - area->used))
 		goto not_found;
 
-	index = wrap = wrap_index(mem, ALIGN(mem->index, stride));
+	index = wrap = wrap_area_index(mem, ALIGN(area->index, stride));
 	do {
+		slot_index = slot_base + index;
+
 		if (orig_addr &&
-		    (slot_addr(tbl_dma_addr, index) & iotlb_align_mask) !=
+		    (slot_addr(tbl_dma_addr, slot_index) & iotlb_align_mask) !=
 			    (orig_addr & iotlb_align_mask)) {
-			index = wrap_index(mem, index + 1);
+			index = wrap_area_index(mem, index + 1);
 			continue;
 		}
 
@@ -513,26 +637,26 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 		 * contiguous buffers, we allocate the buffers from that slot
 		 * and mark the entries as '0' indicating unavailable.
 		 */
-		if (!iommu_is_span_boundary(index, nslots,
+		if (!iommu_is_span_boundary(slot_index, nslots,
 					    nr_slots(tbl_dma_addr),
 					    max_slots)) {
-			if (mem->slots[index].list >= nslots)
+			if (mem->slots[slot_index].list >= nslots)
 				goto found;
 		}
-		index = wrap_index(mem, index + stride);
+		index = wrap_area_index(mem, index + stride);
 	} while (index != wrap);
 
 not_found:
-	spin_unlock_irqrestore(&mem->lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 	return -1;
 
 found:
-	for (i = index; i < index + nslots; i++) {
+	for (i = slot_index; i < slot_index + nslots; i++) {
 		mem->slots[i].list = 0;
 		mem->slots[i].alloc_size =
-			alloc_size - (offset + ((i - index) << IO_TLB_SHIFT));
+			alloc_size - (offset + ((i - slot_index) << IO_TLB_SHIFT));
 	}
-	for (i = index - 1;
+	for (i = slot_index - 1;
 	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 &&
 	     mem->slots[i].list; i--)
 		mem->slots[i].list = ++count;
@@ -540,14 +664,40 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 	/*
 	 * Update the indices to avoid searching in the next round.
 	 */
-	if (index + nslots < mem->nslabs)
-		mem->index = index + nslots;
+	if (index + nslots < mem->area_nslabs)
+		area->index = index + nslots;
 	else
-		mem->index = 0;
-	mem->used += nslots;
+		area->index = 0;
+	area->used += nslots;
 
-	spin_unlock_irqrestore(&mem->lock, flags);
-	return index;
+	spin_unlock_irqrestore(&area->lock, flags);
+
+	inc_used_and_hiwater(mem, nslots);
+	return slot_index;
+}
+
+/*
+ * Try this CPU's area first and the others in turn after it, so that CPUs
+ * mapping at the same time mostly take different locks.
+ */
+static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
+			      size_t alloc_size, unsigned int alloc_align_mask)
+{
+	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
+	int start = raw_smp_processor_id() & (mem->nareas - 1);
+	int i = start, index;
+
+	do {
+		index = swiotlb_do_find_slots(dev, i, orig_addr, alloc_size,
+					      alloc_align_mask);
+		if (index >= 0)
+			return index;
+		count_area_fallback(mem);
+		if (++i >= mem->nareas)
+			i = 0;
+	} while (i != start);
+
+	return -1;
 }
 
 phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
@@ -579,7 +729,7 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 		if (!(attrs & DMA_ATTR_NO_WARN))
 			dev_warn_ratelimited(dev,
 	"swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
-				 alloc_size, mem->nslabs, mem->used);
+				 alloc_size, mem->nslabs, mem_used(mem));
 		return (phys_addr_t)DMA_MAPPING_ERROR;
 	}
 
@@ -609,6 +759,7 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	unsigned int offset = swiotlb_align_offset(dev, tlb_addr);
 	int index = (tlb_addr - offset - mem->start) >> IO_TLB_SHIFT;
 	int nslots = nr_slots(mem->slots[index].alloc_size + offset);
+	struct io_tlb_area *area = &mem->areas[index / mem->area_nslabs];
 	int count, i;
 
 	/*
@@ -617,7 +768,7 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&mem->lock, flags);
+	swiotlb_area_lock(mem, area, &flags);
 	if (index + nslots < ALIGN(index + 1, IO_TLB_SEGSIZE))
 		count = mem->slots[index + nslots].list;
 	else
@@ -641,8 +792,10 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && mem->slots[i].list;
 	     i--)
 		mem->slots[i].list = ++count;
-	mem->used -= nslots;
-	spin_unlock_irqrestore(&mem->lock, flags);
+	area->used -= nslots;
+	spin_unlock_irqrestore(&area->lock, flags);
+
+	dec_used(mem, nslots);
 }
 
 /*
@@ -741,10 +894,67 @@ EXPORT_SYMBOL_GPL(is_swiotlb_active);
 #ifdef CONFIG_DEBUG_FS
 static struct dentry *debugfs_dir;
 
+static int io_tlb_used_get(void *data, u64 *val)
+{
+	*val = mem_used(data);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
+
+static int io_tlb_hiwater_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->used_hiwater);
+	return 0;
+}
+
+static int io_tlb_hiwater_set(void *data, u64 val)
+{
+	struct io_tlb_mem *mem = data;
+
+	/* only allow setting to zero */
+	if (val != 0)
+		return -EINVAL;
+
+	atomic_long_set(&mem->used_hiwater, val);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_hiwater, io_tlb_hiwater_get,
+			 io_tlb_hiwater_set, "%llu\n");
+
+static int io_tlb_contended_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->contended);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_contended, io_tlb_contended_get, NULL,
+			 "%llu\n");
+
+static int io_tlb_area_fallbacks_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->area_fallbacks);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_area_fallbacks, io_tlb_area_fallbacks_get,
+			 NULL, "%llu\n");
+
 static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem)
 {
 	debugfs_create_ulong("io_tlb_nslabs", 0400, mem->debugfs, &mem->nslabs);
-	debugfs_create_ulong("io_tlb_used", 0400, mem->debugfs, &mem->used);
+	debugfs_create_u32("io_tlb_nareas", 0400, mem->debugfs, &mem->nareas);
+	debugfs_create_file("io_tlb_used", 0400, mem->debugfs, mem,
+			    &fops_io_tlb_used);
+	debugfs_create_file("io_tlb_used_hiwater", 0600, mem->debugfs, mem,
+			    &fops_io_tlb_hiwater);
+	debugfs_create_file("io_tlb_contended", 0400, mem->debugfs, mem,
+			    &fops_io_tlb_contended);
+	debugfs_create_file("io_tlb_area_fallbacks", 0400, mem->debugfs, mem,
+			    &fops_io_tlb_area_fallbacks);
 }
 
 static int __init swiotlb_create_default_debugfs(void)
@@ -821,6 +1031,8 @@ static int rmem_swiotlb_device_init(struct reserved_mem *rmem,
 	 * to it.
 	 */
 	if (!mem) {
+		unsigned int nareas = swiotlb_nareas(nslabs);
+
 		mem = kzalloc(sizeof(*mem), GFP_KERNEL);
 		if (!mem)
 			return -ENOMEM;
@@ -832,9 +1044,16 @@ static int rmem_swiotlb_device_init(struct reserved_mem *rmem,
 			return -ENOMEM;
 		}
 
+		mem->areas = kcalloc(nareas, sizeof(*mem->areas), GFP_KERNEL);
+		if (!mem->areas) {
+			kfree(mem->slots);
+			kfree(mem);
+			return -ENOMEM;
+		}
+
 		set_memory_decrypted((unsigned long)phys_to_virt(rmem->base),
 				     rmem->size >> PAGE_SHIFT);
-		swiotlb_init_io_tlb_mem(mem, rmem->base, nslabs, false);
+		swiotlb_init_io_tlb_mem(mem, rmem->base, nslabs, false, nareas);
 		mem->force_bounce = true;
 		mem->for_alloc = true;
 
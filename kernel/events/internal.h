@@ -15,8 +15,8 @@ struct perf_buffer {
 	struct rcu_head			rcu_head;
 #ifdef CONFIG_PERF_USE_VMALLOC
 	struct work_struct		work;
-	int				page_order;	/* allocation order  */
 #endif
+	int				page_order;	/* allocation order  */
 	int				nr_pages;	/* nr of data pages  */
 	int				overwrite;	/* can overwrite itself */
 	int				paused;		/* can write into ring buffer */
@@ -97,26 +97,18 @@ void perf_event_aux_event(struct perf_event *event, unsigned long head,
 extern struct page *
 perf_mmap_to_page(struct perf_buffer *rb, unsigned long pgoff);
 
-#ifdef CONFIG_PERF_USE_VMALLOC
 /*
- * Back perf_mmap() with vmalloc memory.
- *
- * Required for architectures that have d-cache aliasing issues.
+ * The data area consists of rb->nr_pages chunks of 2^page_order pages.
+ * With CONFIG_PERF_USE_VMALLOC, which is required for architectures that
+ * have d-cache aliasing issues, it is a single vmalloc()ed chunk;
+ * otherwise the chunks are high-order page allocations as far as
+ * available, see rb_alloc().
  */
-
 static inline int page_order(struct perf_buffer *rb)
 {
 	return rb->page_order;
 }
 
-#else
-
-static inline int page_order(struct perf_buffer *rb)
-{
-	return 0;
-}
-#endif
-
 static inline int data_page_nr(struct perf_buffer *rb)
 {
 	return rb->nr_pages << page_order(rb);
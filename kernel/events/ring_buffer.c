@@ -14,9 +14,21 @@
 #include <linux/circ_buf.h>
 #include <linux/poll.h>
 #include <linux/nospec.h>
+#include <linux/moduleparam.h>
 
 #include "internal.h"
 
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "perf."
+
+/*
+ * Default wakeup watermark, in percent of the data area, for events which
+ * do not set attr.wakeup_watermark. Larger values batch more records per
+ * wakeup of the consumer.
+ */
+static unsigned int perf_rb_wakeup_pct = 50;
+module_param_named(rb_wakeup_watermark_pct, perf_rb_wakeup_pct, uint, 0644);
+
 static void perf_output_wakeup(struct perf_output_handle *handle)
 {
 	atomic_set(&handle->rb->poll, EPOLLIN | EPOLLRDNORM);
@@ -313,8 +325,11 @@ ring_buffer_init(struct perf_buffer *rb, long watermark, int flags)
 	if (watermark)
 		rb->watermark = min(max_size, watermark);
 
-	if (!rb->watermark)
-		rb->watermark = max_size / 2;
+	if (!rb->watermark) {
+		unsigned int pct = clamp_val(READ_ONCE(perf_rb_wakeup_pct), 1, 100);
+
+		rb->watermark = mult_frac(max_size, pct, 100);
+	}
 
 	if (flags & RING_BUFFER_WRITABLE)
 		rb->overwrite = 0;
@@ -780,46 +795,68 @@ void rb_free_aux(struct perf_buffer *rb)
 
 /*
  * Back perf_mmap() with regular GFP_KERNEL-0 pages.
+ *
+ * The data area is allocated in chunks of up to 2^perf.rb_data_max_order
+ * pages to cut down on TLB pressure of the kernel side writes, falling
+ * back to smaller orders when memory is fragmented. The chunks are split
+ * so that every page can still be mapped individually.
  */
 
+static unsigned int perf_rb_max_order = PAGE_ALLOC_COSTLY_ORDER;
+module_param_named(rb_data_max_order, perf_rb_max_order, uint, 0644);
+
 static struct page *
 __perf_mmap_to_page(struct perf_buffer *rb, unsigned long pgoff)
 {
-	if (pgoff > rb->nr_pages)
+	unsigned long mask = (1UL << page_order(rb)) - 1;
+
+	if (pgoff > data_page_nr(rb))
 		return NULL;
 
 	if (pgoff == 0)
 		return virt_to_page(rb->user_page);
 
-	return virt_to_page(rb->data_pages[pgoff - 1]);
+	pgoff--;
+	return virt_to_page(rb->data_pages[pgoff >> page_order(rb)]) +
+	       (pgoff & mask);
 }
 
-static void *perf_mmap_alloc_page(int cpu)
+static void *perf_mmap_alloc_page(int cpu, int order)
 {
+	gfp_t gfp = GFP_KERNEL | __GFP_ZERO;
 	struct page *page;
 	int node;
 
+	if (order)
+		gfp |= __GFP_NOWARN | __GFP_NORETRY;
+
 	node = (cpu == -1) ? cpu : cpu_to_node(cpu);
-	page = alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO, 0);
+	page = alloc_pages_node(node, gfp, order);
 	if (!page)
 		return NULL;
 
+	if (order)
+		split_page(page, order);
+
 	return page_address(page);
 }
 
-static void perf_mmap_free_page(void *addr)
+static void perf_mmap_free_page(void *addr, int order)
 {
 	struct page *page = virt_to_page(addr);
+	int i;
 
-	page->mapping = NULL;
-	__free_page(page);
+	for (i = 0; i < (1 << order); i++) {
+		page[i].mapping = NULL;
+		__free_page(page + i);
+	}
 }
 
 struct perf_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 {
 	struct perf_buffer *rb;
 	unsigned long size;
-	int i, node;
+	int i, node, order = 0;
 
 	size = sizeof(struct perf_buffer);
 	size += nr_pages * sizeof(void *);
@@ -832,27 +869,41 @@ struct perf_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 	if (!rb)
 		goto fail;
 
-	rb->user_page = perf_mmap_alloc_page(cpu);
+	rb->user_page = perf_mmap_alloc_page(cpu, 0);
 	if (!rb->user_page)
 		goto fail_user_page;
 
-	for (i = 0; i < nr_pages; i++) {
-		rb->data_pages[i] = perf_mmap_alloc_page(cpu);
-		if (!rb->data_pages[i])
+	if (nr_pages)
+		order = min_t(int, ilog2(nr_pages),
+			      min_t(unsigned int, READ_ONCE(perf_rb_max_order),
+				    MAX_ORDER - 1));
+
+	/* nr_pages is a power of two, so every order divides it evenly. */
+	for (;;) {
+		for (i = 0; i < nr_pages >> order; i++) {
+			rb->data_pages[i] = perf_mmap_alloc_page(cpu, order);
+			if (!rb->data_pages[i])
+				break;
+		}
+		if (i == nr_pages >> order)
+			break;
+
+		for (i--; i >= 0; i--)
+			perf_mmap_free_page(rb->data_pages[i], order);
+		if (!order)
 			goto fail_data_pages;
+		order--;
 	}
 
-	rb->nr_pages = nr_pages;
+	rb->nr_pages = nr_pages >> order;
+	rb->page_order = order;
 
 	ring_buffer_init(rb, watermark, flags);
 
 	return rb;
 
 fail_data_pages:
-	for (i--; i >= 0; i--)
-		perf_mmap_free_page(rb->data_pages[i]);
-
-	perf_mmap_free_page(rb->user_page);
+	perf_mmap_free_page(rb->user_page, 0);
 
 fail_user_page:
 	kfree(rb);
@@ -865,9 +916,9 @@ void rb_free(struct perf_buffer *rb)
 {
 	int i;
 
-	perf_mmap_free_page(rb->user_page);
+	perf_mmap_free_page(rb->user_page, 0);
 	for (i = 0; i < rb->nr_pages; i++)
-		perf_mmap_free_page(rb->data_pages[i]);
+		perf_mmap_free_page(rb->data_pages[i], page_order(rb));
 	kfree(rb);
 }
 
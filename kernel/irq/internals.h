@@ -81,6 +81,9 @@ extern void __enable_irq(struct irq_desc *desc);
 #define IRQ_START_FORCE	true
 #define IRQ_START_COND	false
 
+/* Default number of extra thread handler passes for IRQF_THREAD_POLL */
+#define IRQ_THREAD_POLL_BUDGET	16
+
 extern int irq_activate(struct irq_desc *desc);
 extern int irq_activate_and_startup(struct irq_desc *desc, bool resend);
 extern int irq_startup(struct irq_desc *desc, bool resend, bool force);
@@ -120,6 +120,8 @@ static void desc_set_defaults(unsigned int irq, struct irq_desc *desc, int node,
 	desc->irq_count = 0;
 	desc->irqs_unhandled = 0;
 	desc->tot_count = 0;
+	desc->thread_poll_budget = IRQ_THREAD_POLL_BUDGET;
+	atomic_set(&desc->threads_polled, 0);
 	desc->name = NULL;
 	desc->owner = owner;
 	for_each_possible_cpu(cpu)
@@ -455,6 +455,53 @@ int irq_update_affinity_desc(unsigned int irq,
 	return ret;
 }
 
+/**
+ * irq_affinity_exclude_cpus - Move interrupts away from a set of CPUs
+ * @cpus:	CPUs which should not service interrupts
+ * @fallback:	Affinity for interrupts which have no other CPU left
+ *
+ * Removes @cpus from the affinity of every interrupt whose affinity can be
+ * changed from user space.  Managed and per CPU interrupts are left alone,
+ * their placement is fixed when they are set up.
+ */
+void irq_affinity_exclude_cpus(const struct cpumask *cpus,
+			       const struct cpumask *fallback)
+{
+	cpumask_var_t mask;
+	unsigned int irq;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+
+	irq_lock_sparse();
+	for_each_active_irq(irq) {
+		struct irq_desc *desc = irq_to_desc(irq);
+		struct irq_data *data;
+		unsigned long flags;
+
+		if (!desc)
+			continue;
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		data = irq_desc_get_irq_data(desc);
+		if (__irq_can_set_affinity(desc) &&
+		    !irqd_affinity_is_managed(data) && !irqd_is_per_cpu(data)) {
+			const struct cpumask *cur;
+
+			cur = irq_data_get_affinity_mask(data);
+			if (!cpumask_andnot(mask, cur, cpus))
+				cpumask_andnot(mask, fallback, cpus);
+
+			if (!cpumask_empty(mask) && !cpumask_equal(mask, cur))
+				irq_set_affinity_locked(data, mask, false);
+		}
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+	irq_unlock_sparse();
+
+	free_cpumask_var(mask);
+}
+
 static int __irq_set_affinity(unsigned int irq, const struct cpumask *mask,
 			      bool force)
 {
@@ -1200,6 +1247,28 @@ irq_forced_thread_fn(struct irq_desc *desc, struct irqaction *action)
 	return ret;
 }
 
+/*
+ * IRQF_THREAD_POLL: the device is likely to have more work queued up
+ * right after the handler returns, so poll it again from the thread
+ * instead of unmasking the line and taking another interrupt plus
+ * thread wakeup for it. Each extra pass that finds work is one
+ * interrupt avoided.
+ */
+static void irq_thread_poll(struct irq_desc *desc, struct irqaction *action)
+{
+	unsigned int budget = READ_ONCE(desc->thread_poll_budget);
+
+	while (budget--) {
+		if (kthread_should_stop())
+			break;
+		cond_resched();
+		if (action->thread_fn(action->irq, action->dev_id) != IRQ_HANDLED)
+			break;
+		atomic_inc(&desc->threads_handled);
+		atomic_inc(&desc->threads_polled);
+	}
+}
+
 /*
  * Interrupts explicitly requested as threaded interrupts want to be
  * preemptible - many of them need to sleep and wait for slow busses to
@@ -1211,8 +1280,11 @@ static irqreturn_t irq_thread_fn(struct irq_desc *desc,
 	irqreturn_t ret;
 
 	ret = action->thread_fn(action->irq, action->dev_id);
-	if (ret == IRQ_HANDLED)
+	if (ret == IRQ_HANDLED) {
 		atomic_inc(&desc->threads_handled);
+		if (action->flags & IRQF_THREAD_POLL)
+			irq_thread_poll(desc, action);
+	}
 
 	irq_finalize_oneshot(desc, action);
 	return ret;
@@ -1549,6 +1621,13 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 		}
 	}
 
+	if ((new->flags & IRQF_THREAD_POLL) && (!new->thread_fn || nested)) {
+		pr_err("IRQF_THREAD_POLL requires a non-nested thread handler for %s (irq %d)\n",
+		       new->name, irq);
+		ret = -EINVAL;
+		goto out_mput;
+	}
+
 	/*
 	 * Create a handler thread when a thread function is supplied
 	 * and the interrupt does not nest into another interrupt
@@ -295,6 +295,44 @@ static int irq_spurious_proc_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+static int irq_thread_poll_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+
+	seq_printf(m, "budget %u\n" "polled %u\n",
+		   READ_ONCE(desc->thread_poll_budget),
+		   atomic_read(&desc->threads_polled));
+	return 0;
+}
+
+static int irq_thread_poll_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_thread_poll_proc_show, PDE_DATA(inode));
+}
+
+static ssize_t irq_thread_poll_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	struct irq_desc *desc = irq_to_desc((long)PDE_DATA(file_inode(file)));
+	unsigned int budget;
+	int err;
+
+	err = kstrtouint_from_user(buffer, count, 0, &budget);
+	if (err)
+		return err;
+
+	WRITE_ONCE(desc->thread_poll_budget, budget);
+	return count;
+}
+
+static const struct proc_ops irq_thread_poll_proc_ops = {
+	.proc_open	= irq_thread_poll_proc_open,
+	.proc_read	= seq_read,
+	.proc_lseek	= seq_lseek,
+	.proc_release	= single_release,
+	.proc_write	= irq_thread_poll_proc_write,
+};
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -386,6 +424,9 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 	proc_create_single_data("spurious", 0444, desc->dir,
 			irq_spurious_proc_show, (void *)(long)irq);
 
+	proc_create_data("thread_poll", 0644, desc->dir,
+			 &irq_thread_poll_proc_ops, (void *)(long)irq);
+
 out_unlock:
 	mutex_unlock(&register_lock);
 }
@@ -407,6 +448,7 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 # endif
 #endif
 	remove_proc_entry("spurious", desc->dir);
+	remove_proc_entry("thread_poll", desc->dir);
 
 	sprintf(name, "%u", irq);
 	remove_proc_entry(name, root_irq_dir);
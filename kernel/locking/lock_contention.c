@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Sampling lock contention profiler
+ *
+ * Records how long sampled mutex and rwsem slowpaths blocked, per call site
+ * of the lock operation, without lockdep or CONFIG_LOCK_STAT. It is off
+ * until enabled through <debugfs>/lock_contention/enable, and costs a
+ * static branch per blocking slowpath then. Once enabled, one in
+ * sample_period blocking waits per CPU is timed and accounted to the first
+ * return address on the stack outside the locking and scheduler code.
+ *
+ * <debugfs>/lock_contention/sites lists the call sites seen so far with
+ * a log2 histogram of their wait times; writing to .../reset clears them.
+ */
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/kallsyms.h>
+#include <linux/math64.h>
+#include <linux/percpu.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/debug.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/stacktrace.h>
+#include <linux/string.h>
+
+#include "lock_contention.h"
+
+#define LC_HASH_BITS		7
+#define LC_NR_SITES		(1 << LC_HASH_BITS)
+#define LC_MAX_PROBE		16
+#define LC_STACK_DEPTH		8
+
+/*
+ * Bucket 0 counts waits shorter than 1us, bucket i waits of
+ * [2^(i-1), 2^i) us and the last bucket everything longer.
+ */
+#define LC_HIST_SHIFT		10
+#define LC_HIST_BUCKETS		24
+
+struct lc_site {
+	unsigned long ip;
+	atomic_t hist[LC_HIST_BUCKETS];
+	atomic64_t total_ns;
+	atomic64_t max_ns;
+};
+
+static const char * const lc_type_names[LOCK_CONTENTION_NR_TYPES] = {
+	[LOCK_CONTENTION_MUTEX]		= "mutex",
+	[LOCK_CONTENTION_RWSEM_READ]	= "rwsem-r",
+	[LOCK_CONTENTION_RWSEM_WRITE]	= "rwsem-w",
+};
+
+static struct lc_site lc_sites[LOCK_CONTENTION_NR_TYPES][LC_NR_SITES];
+static atomic_long_t lc_dropped;
+static u32 lc_sample_period = 64;
+static DEFINE_PER_CPU(unsigned int, lc_sample_count);
+
+DEFINE_STATIC_KEY_FALSE(lock_contention_enabled);
+
+u64 __lock_contention_begin(void)
+{
+	unsigned int period = READ_ONCE(lc_sample_period);
+
+	if (period > 1 && this_cpu_inc_return(lc_sample_count) % period)
+		return 0;
+	return local_clock() ?: 1;
+}
+
+/*
+ * The first two entries are in here and in __lock_contention_end(); the
+ * lock and scheduler functions above them are all __sched.
+ */
+static noinline unsigned long lc_call_site(void)
+{
+	unsigned long entries[LC_STACK_DEPTH];
+	unsigned int i, nr;
+
+	nr = stack_trace_save(entries, ARRAY_SIZE(entries), 2);
+	for (i = 0; i < nr; i++)
+		if (!in_sched_functions(entries[i]))
+			return entries[i];
+	return nr ? entries[nr - 1] : 0;
+}
+
+static struct lc_site *lc_find_site(enum lock_contention_type type,
+				    unsigned long ip)
+{
+	unsigned int idx = hash_long(ip, LC_HASH_BITS);
+	struct lc_site *site;
+	unsigned long old;
+	int i;
+
+	for (i = 0; i < LC_MAX_PROBE; i++) {
+		site = &lc_sites[type][(idx + i) & (LC_NR_SITES - 1)];
+		old = READ_ONCE(site->ip);
+		if (old == ip)
+			return site;
+		if (!old) {
+			old = cmpxchg(&site->ip, 0, ip);
+			if (!old || old == ip)
+				return site;
+		}
+	}
+
+	return NULL;
+}
+
+noinline void __lock_contention_end(u64 start, enum lock_contention_type type)
+{
+	u64 delta = local_clock() - start;
+	struct lc_site *site;
+	u64 max;
+	int bucket;
+
+	site = lc_find_site(type, lc_call_site());
+	if (!site) {
+		atomic_long_inc(&lc_dropped);
+		return;
+	}
+
+	bucket = fls64(delta >> LC_HIST_SHIFT);
+	if (bucket >= LC_HIST_BUCKETS)
+		bucket = LC_HIST_BUCKETS - 1;
+	atomic_inc(&site->hist[bucket]);
+	atomic64_add(delta, &site->total_ns);
+
+	max = atomic64_read(&site->max_ns);
+	while (delta > max) {
+		u64 old = atomic64_cmpxchg(&site->max_ns, max, delta);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+static int lc_sites_show(struct seq_file *m, void *v)
+{
+	struct lc_site *site;
+	unsigned long count;
+	int type, i, b;
+
+	seq_printf(m, "sample_period: %u dropped: %ld\n",
+		   READ_ONCE(lc_sample_period), atomic_long_read(&lc_dropped));
+
+	for (type = 0; type < LOCK_CONTENTION_NR_TYPES; type++) {
+		for (i = 0; i < LC_NR_SITES; i++) {
+			site = &lc_sites[type][i];
+			if (!READ_ONCE(site->ip))
+				continue;
+
+			count = 0;
+			for (b = 0; b < LC_HIST_BUCKETS; b++)
+				count += atomic_read(&site->hist[b]);
+			if (!count)
+				continue;
+
+			seq_printf(m, "%-8s %pS samples: %lu avg_us: %llu max_us: %llu\n",
+				   lc_type_names[type], (void *)site->ip, count,
+				   div_u64(div64_ul(atomic64_read(&site->total_ns),
+						    count), NSEC_PER_USEC),
+				   div_u64(atomic64_read(&site->max_ns),
+					   NSEC_PER_USEC));
+
+			for (b = 0; b < LC_HIST_BUCKETS; b++) {
+				unsigned int n = atomic_read(&site->hist[b]);
+
+				if (!n)
+					continue;
+				if (!b)
+					seq_printf(m, "\t%10s us: %u\n", "<1", n);
+				else
+					seq_printf(m, "\t%9lu+ us: %u\n",
+						   1UL << (b - 1), n);
+			}
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(lc_sites);
+
+static int lc_enable_get(void *data, u64 *val)
+{
+	*val = static_key_enabled(&lock_contention_enabled);
+	return 0;
+}
+
+static int lc_enable_set(void *data, u64 val)
+{
+	if (val)
+		static_branch_enable(&lock_contention_enabled);
+	else
+		static_branch_disable(&lock_contention_enabled);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(lc_enable_fops, lc_enable_get, lc_enable_set,
+			 "%llu\n");
+
+/*
+ * Sites being updated while they are cleared may keep a few stale counts;
+ * disable the profiler first for an exact reset.
+ */
+static ssize_t lc_reset_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	memset(lc_sites, 0, sizeof(lc_sites));
+	atomic_long_set(&lc_dropped, 0);
+	return count;
+}
+
+static const struct file_operations lc_reset_fops = {
+	.write	= lc_reset_write,
+	.llseek	= default_llseek,
+};
+
+static int __init lock_contention_init(void)
+{
+	struct dentry *d_root = debugfs_create_dir("lock_contention", NULL);
+
+	debugfs_create_file("enable", 0600, d_root, NULL, &lc_enable_fops);
+	debugfs_create_u32("sample_period", 0600, d_root, &lc_sample_period);
+	debugfs_create_file("sites", 0400, d_root, NULL, &lc_sites_fops);
+	debugfs_create_file("reset", 0200, d_root, NULL, &lc_reset_fops);
+	return 0;
+}
+fs_initcall(lock_contention_init);
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Sampling lock contention profiler
+ */
+#ifndef __LOCKING_LOCK_CONTENTION_H
+#define __LOCKING_LOCK_CONTENTION_H
+
+#include <linux/jump_label.h>
+#include <linux/types.h>
+
+enum lock_contention_type {
+	LOCK_CONTENTION_MUTEX,
+	LOCK_CONTENTION_RWSEM_READ,
+	LOCK_CONTENTION_RWSEM_WRITE,
+	LOCK_CONTENTION_NR_TYPES,
+};
+
+#ifdef CONFIG_LOCK_CONTENTION_PROFILE
+DECLARE_STATIC_KEY_FALSE(lock_contention_enabled);
+
+u64 __lock_contention_begin(void);
+void __lock_contention_end(u64 start, enum lock_contention_type type);
+
+/*
+ * Called by a slowpath when it is about to block. Returns the start time
+ * of the wait if this one is sampled, or 0.
+ */
+static inline u64 lock_contention_begin(void)
+{
+	if (!static_branch_unlikely(&lock_contention_enabled))
+		return 0;
+	return __lock_contention_begin();
+}
+
+/*
+ * Called once the lock was acquired after blocking, with the value
+ * lock_contention_begin() returned.
+ */
+static inline void lock_contention_end(u64 start,
+				       enum lock_contention_type type)
+{
+	if (start)
+		__lock_contention_end(start, type);
+}
+#else
+static inline u64 lock_contention_begin(void)
+{
+	return 0;
+}
+
+static inline void lock_contention_end(u64 start,
+				       enum lock_contention_type type)
+{
+}
+#endif /* CONFIG_LOCK_CONTENTION_PROFILE */
+#endif /* __LOCKING_LOCK_CONTENTION_H */
@@ -32,6 +32,7 @@
 
 #ifndef CONFIG_PREEMPT_RT
 #include "mutex.h"
+#include "lock_contention.h"
 
 #ifdef CONFIG_DEBUG_MUTEXES
 # define MUTEX_WARN_ON(cond) DEBUG_LOCKS_WARN_ON(cond)
@@ -564,6 +565,7 @@ __mutex_lock_common(struct mutex *lock, unsigned int state, unsigned int subclas
 		    struct ww_acquire_ctx *ww_ctx, const bool use_ww_ctx)
 {
 	struct mutex_waiter waiter;
+	u64 wait_start = 0;
 	struct ww_mutex *ww;
 	int ret;
 
@@ -622,6 +624,7 @@ __mutex_lock_common(struct mutex *lock, unsigned int state, unsigned int subclas
 		waiter.ww_ctx = ww_ctx;
 
 	lock_contended(&lock->dep_map, ip);
+	wait_start = lock_contention_begin();
 
 	if (!use_ww_ctx) {
 		/* add waiting tasks to the end of the waitqueue (FIFO): */
@@ -709,6 +712,7 @@ __mutex_lock_common(struct mutex *lock, unsigned int state, unsigned int subclas
 
 	raw_spin_unlock(&lock->wait_lock);
 	preempt_enable();
+	lock_contention_end(wait_start, LOCK_CONTENTION_MUTEX);
 	return 0;
 
 err:
@@ -25,11 +25,13 @@
 #include <linux/sched/signal.h>
 #include <linux/sched/clock.h>
 #include <linux/export.h>
+#include <linux/moduleparam.h>
 #include <linux/rwsem.h>
 #include <linux/atomic.h>
 
 #ifndef CONFIG_PREEMPT_RT
 #include "lock_events.h"
+#include "lock_contention.h"
 
 /*
  * The least significant 2 bits of the owner value has the following
@@ -675,6 +677,29 @@ static inline bool rwsem_try_write_lock_unqueued(struct rw_semaphore *sem)
 	return false;
 }
 
+/*
+ * Try to acquire read lock before the reader has been put on wait queue.
+ * The caller must have backed out the read bias down_read() added.
+ */
+static inline bool rwsem_try_read_lock_unqueued(struct rw_semaphore *sem)
+{
+	long count = atomic_long_read(&sem->count);
+
+	if (count & (RWSEM_WRITER_MASK | RWSEM_FLAG_HANDOFF))
+		return false;
+
+	count = atomic_long_fetch_add_acquire(RWSEM_READER_BIAS, &sem->count);
+	if (!(count & (RWSEM_WRITER_MASK | RWSEM_FLAG_HANDOFF))) {
+		rwsem_set_reader_owned(sem);
+		lockevent_inc(rwsem_opt_rlock);
+		return true;
+	}
+
+	/* Back out the change */
+	atomic_long_add(-RWSEM_READER_BIAS, &sem->count);
+	return false;
+}
+
 static inline bool owner_on_cpu(struct task_struct *owner)
 {
 	/*
@@ -771,12 +796,67 @@ rwsem_spin_on_owner(struct rw_semaphore *sem)
 	return state;
 }
 
+/*
+ * Spin budget
+ *
+ * Spinning on a reader-owned rwsem (writers) or on a running writer
+ * (readers) is only worth it while the lock is released sooner than a
+ * sleep and wakeup would take. With spin_adaptive set, the budget is
+ * learned from how long recent successful spins took to get the lock,
+ * which follows the hold times of the contended locks: it is twice the
+ * running average, and shrinks whenever a spin runs out of budget. It is
+ * always kept between RWSEM_SPIN_MIN_NS and spin_max_us.
+ *
+ * All of it is tunable under /sys/module/rwsem/parameters/.
+ */
+#define RWSEM_SPIN_MIN_NS	(2 * NSEC_PER_USEC)
+
+static bool reader_spin = true;
+module_param(reader_spin, bool, 0644);
+MODULE_PARM_DESC(reader_spin, "Let readers spin on a running writer");
+
+static bool spin_adaptive = true;
+module_param(spin_adaptive, bool, 0644);
+MODULE_PARM_DESC(spin_adaptive, "Learn the spin budget from recent spins");
+
+static unsigned int spin_max_us = 25;
+module_param(spin_max_us, uint, 0644);
+MODULE_PARM_DESC(spin_max_us, "Upper limit of the spin budget (us)");
+
+static unsigned long rwsem_spin_avg_ns;
+
+static u64 rwsem_spin_budget(void)
+{
+	u64 max = (u64)READ_ONCE(spin_max_us) * NSEC_PER_USEC;
+	u64 budget = 2 * (u64)READ_ONCE(rwsem_spin_avg_ns);
+
+	/* until something was learned, allow the full budget */
+	if (!budget)
+		return max;
+	return clamp_t(u64, budget, RWSEM_SPIN_MIN_NS, max);
+}
+
+static void rwsem_spin_learn(u64 spun_ns, bool taken)
+{
+	unsigned long avg = READ_ONCE(rwsem_spin_avg_ns);
+
+	if (!READ_ONCE(spin_adaptive))
+		return;
+
+	/* racy updates only lose a sample now and then */
+	if (taken)
+		avg = avg - avg / 8 + min_t(u64, spun_ns, ULONG_MAX) / 8;
+	else
+		avg -= avg / 8;
+	WRITE_ONCE(rwsem_spin_avg_ns, avg);
+}
+
 /*
  * Calculate reader-owned rwsem spinning threshold for writer
  *
  * The more readers own the rwsem, the longer it will take for them to
- * wind down and free the rwsem. So the empirical formula used to
- * determine the actual spinning time limit here is:
+ * wind down and free the rwsem. Without spin_adaptive, the empirical
+ * formula used to determine the actual spinning time limit here is:
  *
  *   Spinning threshold = (10 + nr_readers/2)us
  *
@@ -789,6 +869,9 @@ static inline u64 rwsem_rspin_threshold(struct rw_semaphore *sem)
 	int readers = count >> RWSEM_READER_SHIFT;
 	u64 delta;
 
+	if (READ_ONCE(spin_adaptive))
+		return sched_clock() + rwsem_spin_budget();
+
 	if (readers > 30)
 		readers = 30;
 	delta = (20 + readers) * NSEC_PER_USEC / 2;
@@ -801,7 +884,7 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 	bool taken = false;
 	int prev_owner_state = OWNER_NULL;
 	int loop = 0;
-	u64 rspin_threshold = 0;
+	u64 rspin_threshold = 0, rspin_start = 0;
 
 	preempt_disable();
 
@@ -827,8 +910,12 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 		 */
 		taken = rwsem_try_write_lock_unqueued(sem);
 
-		if (taken)
+		if (taken) {
+			if (rspin_start)
+				rwsem_spin_learn(sched_clock() - rspin_start,
+						 true);
 			break;
+		}
 
 		/*
 		 * Time-based reader-owned rwsem optimistic spinning
@@ -845,6 +932,7 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 				if (rwsem_test_oflags(sem, RWSEM_NONSPINNABLE))
 					break;
 				rspin_threshold = rwsem_rspin_threshold(sem);
+				rspin_start = sched_clock();
 				loop = 0;
 			}
 
@@ -857,9 +945,13 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 			 */
 			else if (!(++loop & 0xf) && (sched_clock() > rspin_threshold)) {
 				rwsem_set_nonspinnable(sem);
+				rwsem_spin_learn(0, false);
 				lockevent_inc(rwsem_opt_nospin);
+				lockevent_inc(rwsem_opt_expired);
 				break;
 			}
+		} else {
+			rspin_start = 0;
 		}
 
 		/*
@@ -917,6 +1009,61 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 	return taken;
 }
 
+/*
+ * Reader optimistic spinning: spin while a running writer owns the lock
+ * and grab it for read as soon as it is released, instead of sleeping.
+ * Reader-owned locks never get here, a reader can join them directly.
+ */
+static bool rwsem_reader_optimistic_spin(struct rw_semaphore *sem)
+{
+	bool taken = false;
+	u64 start, deadline;
+	int loop = 0;
+
+	preempt_disable();
+
+	if (!osq_lock(&sem->osq))
+		goto done;
+
+	start = sched_clock();
+	deadline = start + rwsem_spin_budget();
+	for (;;) {
+		enum owner_state owner_state;
+
+		owner_state = rwsem_spin_on_owner(sem);
+		if (!(owner_state & OWNER_SPINNABLE))
+			break;
+
+		taken = rwsem_try_read_lock_unqueued(sem);
+		if (taken) {
+			rwsem_spin_learn(sched_clock() - start, true);
+			break;
+		}
+
+		if (need_resched() || rt_task(current))
+			break;
+
+		if (!(++loop & 0xf) && sched_clock() > deadline) {
+			rwsem_spin_learn(0, false);
+			lockevent_inc(rwsem_opt_expired);
+			break;
+		}
+
+		cpu_relax();
+	}
+	osq_unlock(&sem->osq);
+done:
+	preempt_enable();
+	lockevent_cond_inc(rwsem_opt_rfail, !taken);
+	return taken;
+}
+
+static inline bool rwsem_can_reader_spin(struct rw_semaphore *sem, long count)
+{
+	return READ_ONCE(reader_spin) && (count & RWSEM_WRITER_LOCKED) &&
+	       rwsem_can_spin_on_owner(sem);
+}
+
 /*
  * Clear the owner's RWSEM_NONSPINNABLE bit if it is set. This should
  * only be called when the reader count reaches 0.
@@ -938,6 +1085,16 @@ static inline bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 	return false;
 }
 
+static inline bool rwsem_reader_optimistic_spin(struct rw_semaphore *sem)
+{
+	return false;
+}
+
+static inline bool rwsem_can_reader_spin(struct rw_semaphore *sem, long count)
+{
+	return false;
+}
+
 static inline void clear_nonspinnable(struct rw_semaphore *sem) { }
 
 static inline enum owner_state
@@ -958,6 +1115,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 	struct rwsem_waiter waiter;
 	DEFINE_WAKE_Q(wake_q);
 	bool wake = false;
+	u64 wait_start;
 
 	/*
 	 * To prevent a constant stream of readers from starving a sleeping
@@ -990,7 +1148,29 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 		return sem;
 	}
 
+	/*
+	 * Reader optimistic spinning on a running writer, with the read
+	 * bias backed out: a failed spin then queues without it.
+	 */
+	if (rwsem_can_reader_spin(sem, count)) {
+		atomic_long_add(-RWSEM_READER_BIAS, &sem->count);
+		adjustment = 0;
+		if (rwsem_reader_optimistic_spin(sem)) {
+			/* Wake up other readers queued behind the writer */
+			if (atomic_long_read(&sem->count) & RWSEM_FLAG_WAITERS) {
+				raw_spin_lock_irq(&sem->wait_lock);
+				if (!list_empty(&sem->wait_list))
+					rwsem_mark_wake(sem, RWSEM_WAKE_READ_OWNED,
+							&wake_q);
+				raw_spin_unlock_irq(&sem->wait_lock);
+				wake_up_q(&wake_q);
+			}
+			return sem;
+		}
+	}
+
 queue:
+	wait_start = lock_contention_begin();
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_READ;
 	waiter.timeout = jiffies + RWSEM_WAIT_TIMEOUT;
@@ -1002,9 +1182,10 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 		 * In case the wait queue is empty and the lock isn't owned
 		 * by a writer or has the handoff bit set, this reader can
 		 * exit the slowpath and return immediately as its
-		 * RWSEM_READER_BIAS has already been set in the count.
+		 * RWSEM_READER_BIAS has already been set in the count,
+		 * unless it was backed out for optimistic spinning.
 		 */
-		if (!(atomic_long_read(&sem->count) &
+		if (adjustment && !(atomic_long_read(&sem->count) &
 		     (RWSEM_WRITER_MASK | RWSEM_FLAG_HANDOFF))) {
 			/* Provide lock ACQUIRE */
 			smp_acquire__after_ctrl_dep();
@@ -1058,6 +1239,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 
 	__set_current_state(TASK_RUNNING);
 	lockevent_inc(rwsem_rlock);
+	lock_contention_end(wait_start, LOCK_CONTENTION_RWSEM_READ);
 	return sem;
 
 out_nolock:
@@ -1071,12 +1253,13 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 /*
  * Wait until we successfully acquire the write lock
  */
-static struct rw_semaphore *
+static struct rw_semaphore __sched *
 rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 {
 	long count;
 	struct rwsem_waiter waiter;
 	DEFINE_WAKE_Q(wake_q);
+	u64 wait_start;
 
 	/* do optimistic spinning and steal lock if possible */
 	if (rwsem_can_spin_on_owner(sem) && rwsem_optimistic_spin(sem)) {
@@ -1088,6 +1271,7 @@ rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 	 * Optimistic spinning failed, proceed to the slowpath
 	 * and block until we can acquire the sem.
 	 */
+	wait_start = lock_contention_begin();
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_WRITE;
 	waiter.timeout = jiffies + RWSEM_WAIT_TIMEOUT;
@@ -1171,6 +1355,7 @@ rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 	__set_current_state(TASK_RUNNING);
 	raw_spin_unlock_irq(&sem->wait_lock);
 	lockevent_inc(rwsem_wlock);
+	lock_contention_end(wait_start, LOCK_CONTENTION_RWSEM_WRITE);
 	return sem;
 
 out_nolock:
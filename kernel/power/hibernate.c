@@ -30,6 +30,7 @@
 #include <linux/ctype.h>
 #include <linux/genhd.h>
 #include <linux/ktime.h>
+#include <linux/moduleparam.h>
 #include <linux/security.h>
 #include <linux/secretmem.h>
 #include <trace/events/power.h>
@@ -38,6 +39,7 @@
 
 
 static int nocompress;
+static unsigned int hibernate_compressor;
 static int noresume;
 static int nohibernate;
 static int resume_wait;
@@ -759,7 +761,7 @@ int hibernate(void)
 		if (nocompress)
 			flags |= SF_NOCOMPRESS_MODE;
 		else
-		        flags |= SF_CRC32_MODE;
+		        flags |= SF_CRC32_MODE | hibernate_compressor;
 
 		pm_pr_dbg("Writing hibernation image.\n");
 		error = swsusp_write(flags);
@@ -1231,6 +1233,27 @@ static ssize_t image_size_store(struct kobject *kobj, struct kobj_attribute *att
 
 power_attr(image_size);
 
+static ssize_t image_drop_cache_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", image_drop_cache);
+}
+
+static ssize_t image_drop_cache_store(struct kobject *kobj,
+				      struct kobj_attribute *attr,
+				      const char *buf, size_t n)
+{
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	image_drop_cache = val;
+	return n;
+}
+
+power_attr(image_drop_cache);
+
 static ssize_t reserved_size_show(struct kobject *kobj,
 				  struct kobj_attribute *attr, char *buf)
 {
@@ -1258,6 +1281,7 @@ static struct attribute *g[] = {
 	&resume_offset_attr.attr,
 	&resume_attr.attr,
 	&image_size_attr.attr,
+	&image_drop_cache_attr.attr,
 	&reserved_size_attr.attr,
 	NULL,
 };
@@ -1298,6 +1322,37 @@ static int __init resume_offset_setup(char *str)
 	return 1;
 }
 
+static int hibernate_compressor_set(const char *val,
+				    const struct kernel_param *kp)
+{
+	if (sysfs_streq(val, "lzo"))
+		hibernate_compressor = 0;
+	else if (IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4) &&
+		 sysfs_streq(val, "lz4"))
+		hibernate_compressor = SF_COMPRESS_LZ4;
+	else if (IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) &&
+		 sysfs_streq(val, "zstd"))
+		hibernate_compressor = SF_COMPRESS_ZSTD;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+
+static int hibernate_compressor_get(char *buffer,
+				    const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%s\n",
+		       swsusp_compressor_name(hibernate_compressor));
+}
+
+static const struct kernel_param_ops hibernate_compressor_ops = {
+	.set = hibernate_compressor_set,
+	.get = hibernate_compressor_get,
+};
+module_param_cb(compressor, &hibernate_compressor_ops, NULL, 0644);
+MODULE_PARM_DESC(compressor, "hibernation image compressor: lzo, lz4 or zstd");
+
 static int __init hibernate_setup(char *str)
 {
 	if (!strncmp(str, "noresume", 8)) {
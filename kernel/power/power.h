@@ -96,6 +96,8 @@ static struct kobj_attribute _name##_attr = {	\
 
 /* Preferred image size in bytes (default 500 MB) */
 extern unsigned long image_size;
+/* Leave clean page cache out of the image (default off) */
+extern bool image_drop_cache;
 /* Size of memory reserved for drivers (default SPARE_PAGES x PAGE_SIZE) */
 extern unsigned long reserved_size;
 extern int in_suspend;
@@ -168,12 +170,17 @@ extern int swsusp_swap_in_use(void);
 #define SF_PLATFORM_MODE	1
 #define SF_NOCOMPRESS_MODE	2
 #define SF_CRC32_MODE	        4
+#define SF_COMPRESS_LZ4		8
+#define SF_COMPRESS_ZSTD	16
+
+#define SF_COMPRESS_MASK	(SF_COMPRESS_LZ4 | SF_COMPRESS_ZSTD)
 
 /* kernel/power/hibernate.c */
 extern int swsusp_check(void);
 extern void swsusp_free(void);
 extern int swsusp_read(unsigned int *flags_p);
 extern int swsusp_write(unsigned int flags);
+extern const char *swsusp_compressor_name(unsigned int flags);
 extern void swsusp_close(fmode_t);
 #ifdef CONFIG_SUSPEND
 extern int swsusp_unmark(void);
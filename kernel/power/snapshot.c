@@ -139,6 +139,14 @@ void __init hibernate_image_size_init(void)
 	image_size = ((totalram_pages() * 2) / 5) * PAGE_SIZE;
 }
 
+/*
+ * Leave clean page cache out of the image (tunable via
+ * /sys/power/image_drop_cache).  When set, the image size target is lowered
+ * by the number of clean, unmapped file pages, so that preallocation reclaims
+ * them instead of saving data that can be read back from disk after resume.
+ */
+bool image_drop_cache;
+
 /*
  * List of PBEs needed for restoring the pages that were allocated before
  * the suspend and included in the suspend image, but have also been
@@ -1707,6 +1715,25 @@ static unsigned long minimum_image_size(unsigned long saveable)
 	return saveable <= size ? 0 : saveable - size;
 }
 
+/**
+ * clean_cache_pages - Estimate the number of clean, unmapped page cache pages.
+ *
+ * Mapped file pages are left out, they are likely to be touched again right
+ * after resume.
+ */
+static unsigned long clean_cache_pages(void)
+{
+	long pages;
+
+	pages = global_node_page_state(NR_ACTIVE_FILE)
+		+ global_node_page_state(NR_INACTIVE_FILE)
+		- global_node_page_state(NR_FILE_DIRTY)
+		- global_node_page_state(NR_WRITEBACK)
+		- global_node_page_state(NR_FILE_MAPPED);
+
+	return pages > 0 ? pages : 0;
+}
+
 /**
  * hibernate_preallocate_memory - Preallocate memory for hibernation image.
  *
@@ -1728,6 +1755,8 @@ static unsigned long minimum_image_size(unsigned long saveable)
  * the preallocation of memory is continued until the total number of saveable
  * pages in the system is below the requested image size or the minimum
  * acceptable image size returned by minimum_image_size(), whichever is greater.
+ * With image_drop_cache set, the requested image size is further capped at the
+ * number of saveable pages that are not clean page cache.
  */
 int hibernate_preallocate_memory(void)
 {
@@ -1783,6 +1812,8 @@ int hibernate_preallocate_memory(void)
 			- 2 * DIV_ROUND_UP(reserved_size, PAGE_SIZE);
 	/* Compute the desired number of image pages specified by image_size. */
 	size = DIV_ROUND_UP(image_size, PAGE_SIZE);
+	if (image_drop_cache)
+		size = min(size, saveable - min(saveable, clean_cache_pages()));
 	if (size > max_size)
 		size = max_size;
 	/*
@@ -25,6 +25,8 @@
 #include <linux/pm.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
+#include <linux/lz4.h>
+#include <linux/zstd.h>
 #include <linux/vmalloc.h>
 #include <linux/cpumask.h>
 #include <linux/atomic.h>
@@ -518,7 +520,11 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 #define LZO_UNC_PAGES	32
 #define LZO_UNC_SIZE	(LZO_UNC_PAGES * PAGE_SIZE)
 
-/* Number of pages/bytes we need for compressed data (worst case). */
+/*
+ * Number of pages/bytes we need for compressed data (worst case).  LZO has
+ * the largest bound of the supported compressors, so it covers LZ4 and zstd
+ * as well.
+ */
 #define LZO_CMP_PAGES	DIV_ROUND_UP(lzo1x_worst_compress(LZO_UNC_SIZE) + \
 			             LZO_HEADER, PAGE_SIZE)
 #define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
@@ -530,6 +536,29 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 #define LZO_MIN_RD_PAGES	1024
 #define LZO_MAX_RD_PAGES	8192
 
+/* Compression workspace for LZO or LZ4, zstd allocates its own. */
+#define LZO_WRK_SIZE	(LZO1X_1_MEM_COMPRESS > LZ4_MEM_COMPRESS ? \
+			 LZO1X_1_MEM_COMPRESS : LZ4_MEM_COMPRESS)
+
+/* zstd level for the image, level 3 keeps compression close to disk speed */
+#define HIB_ZSTD_LEVEL	3
+
+const char *swsusp_compressor_name(unsigned int flags)
+{
+	switch (flags & SF_COMPRESS_MASK) {
+	case SF_COMPRESS_LZ4:
+		return "lz4";
+	case SF_COMPRESS_ZSTD:
+		return "zstd";
+	default:
+		return "lzo";
+	}
+}
+
+static ZSTD_parameters hib_zstd_params(void)
+{
+	return ZSTD_getParams(HIB_ZSTD_LEVEL, LZO_UNC_SIZE, 0);
+}
 
 /**
  *	save_image - save the suspend image data
@@ -622,26 +651,80 @@ static int crc32_threadfn(void *data)
 	return 0;
 }
 /**
- * Structure used for LZO data compression.
+ * Structure used for data compression.
  */
 struct cmp_data {
 	struct task_struct *thr;                  /* thread */
 	atomic_t ready;                           /* ready to start flag */
 	atomic_t stop;                            /* ready to stop flag */
 	int ret;                                  /* return code */
+	unsigned int alg;                         /* SF_COMPRESS_* or 0 */
+	void *zstd_wrk;                           /* zstd workspace */
+	ZSTD_CCtx *cctx;                          /* zstd context */
 	wait_queue_head_t go;                     /* start compression */
 	wait_queue_head_t done;                   /* compression done */
 	size_t unc_len;                           /* uncompressed length */
 	size_t cmp_len;                           /* compressed length */
 	unsigned char unc[LZO_UNC_SIZE];          /* uncompressed buffer */
 	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
-	unsigned char wrk[LZO1X_1_MEM_COMPRESS];  /* compression workspace */
+	unsigned char wrk[LZO_WRK_SIZE];          /* compression workspace */
 };
 
+static int hib_compress_init(struct cmp_data *d, unsigned int alg)
+{
+	d->alg = alg;
+
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) &&
+	    alg == SF_COMPRESS_ZSTD) {
+		size_t size = ZSTD_CCtxWorkspaceBound(hib_zstd_params().cParams);
+
+		d->zstd_wrk = vmalloc(size);
+		if (!d->zstd_wrk)
+			return -ENOMEM;
+
+		d->cctx = ZSTD_initCCtx(d->zstd_wrk, size);
+		if (!d->cctx)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int hib_compress(struct cmp_data *d)
+{
+	unsigned char *dst = d->cmp + LZO_HEADER;
+	size_t dst_len = LZO_CMP_SIZE - LZO_HEADER;
+
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4) &&
+	    d->alg == SF_COMPRESS_LZ4) {
+		int len = LZ4_compress_default((const char *)d->unc,
+					       (char *)dst, d->unc_len,
+					       dst_len, d->wrk);
+
+		d->cmp_len = len;
+		return len > 0 ? 0 : -1;
+	}
+
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) &&
+	    d->alg == SF_COMPRESS_ZSTD) {
+		size_t len = ZSTD_compressCCtx(d->cctx, dst, dst_len,
+					       d->unc, d->unc_len,
+					       hib_zstd_params());
+
+		if (ZSTD_isError(len))
+			return -1;
+
+		d->cmp_len = len;
+		return 0;
+	}
+
+	return lzo1x_1_compress(d->unc, d->unc_len, dst, &d->cmp_len, d->wrk);
+}
+
 /**
  * Compression function that runs in its own thread.
  */
-static int lzo_compress_threadfn(void *data)
+static int compress_threadfn(void *data)
 {
 	struct cmp_data *d = data;
 
@@ -657,9 +740,7 @@ static int lzo_compress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->ret = lzo1x_1_compress(d->unc, d->unc_len,
-		                          d->cmp + LZO_HEADER, &d->cmp_len,
-		                          d->wrk);
+		d->ret = hib_compress(d);
 		atomic_set_release(&d->stop, 1);
 		wake_up(&d->done);
 	}
@@ -667,15 +748,18 @@ static int lzo_compress_threadfn(void *data)
 }
 
 /**
- * save_image_lzo - Save the suspend image data compressed with LZO.
+ * save_compressed_image - Save the suspend image data compressed.
  * @handle: Swap map handle to use for saving the image.
  * @snapshot: Image to read data from.
  * @nr_to_write: Number of pages to save.
+ * @flags: Image flags, selecting the compressor.
  */
-static int save_image_lzo(struct swap_map_handle *handle,
-                          struct snapshot_handle *snapshot,
-                          unsigned int nr_to_write)
+static int save_compressed_image(struct swap_map_handle *handle,
+                                 struct snapshot_handle *snapshot,
+                                 unsigned int nr_to_write,
+                                 unsigned int flags)
 {
+	unsigned int alg = flags & SF_COMPRESS_MASK;
 	unsigned int m;
 	int ret = 0;
 	int nr_pages;
@@ -713,6 +797,14 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	}
 	for (thr = 0; thr < nr_threads; thr++)
 		memset(&data[thr], 0, offsetof(struct cmp_data, go));
+	for (thr = 0; thr < nr_threads; thr++) {
+		ret = hib_compress_init(&data[thr], alg);
+		if (ret) {
+			pr_err("Failed to set up %s compression\n",
+			       swsusp_compressor_name(alg));
+			goto out_clean;
+		}
+	}
 
 	crc = kmalloc(sizeof(*crc), GFP_KERNEL);
 	if (!crc) {
@@ -729,7 +821,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		init_waitqueue_head(&data[thr].go);
 		init_waitqueue_head(&data[thr].done);
 
-		data[thr].thr = kthread_run(lzo_compress_threadfn,
+		data[thr].thr = kthread_run(compress_threadfn,
 		                            &data[thr],
 		                            "image_compress/%u", thr);
 		if (IS_ERR(data[thr].thr)) {
@@ -767,7 +859,8 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	 */
 	handle->reqd_free_pages = reqd_free_pages();
 
-	pr_info("Using %u thread(s) for compression\n", nr_threads);
+	pr_info("Using %u thread(s) for %s compression\n", nr_threads,
+		swsusp_compressor_name(alg));
 	pr_info("Compressing and saving image data (%u pages)...\n",
 		nr_to_write);
 	m = nr_to_write / 10;
@@ -817,14 +910,15 @@ static int save_image_lzo(struct swap_map_handle *handle,
 			ret = data[thr].ret;
 
 			if (ret < 0) {
-				pr_err("LZO compression failed\n");
+				pr_err("%s compression failed\n",
+				       swsusp_compressor_name(alg));
 				goto out_finish;
 			}
 
 			if (unlikely(!data[thr].cmp_len ||
 			             data[thr].cmp_len >
 			             lzo1x_worst_compress(data[thr].unc_len))) {
-				pr_err("Invalid LZO compressed length\n");
+				pr_err("Invalid compressed length\n");
 				ret = -1;
 				goto out_finish;
 			}
@@ -870,9 +964,11 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		kfree(crc);
 	}
 	if (data) {
-		for (thr = 0; thr < nr_threads; thr++)
+		for (thr = 0; thr < nr_threads; thr++) {
 			if (data[thr].thr)
 				kthread_stop(data[thr].thr);
+			vfree(data[thr].zstd_wrk);
+		}
 		vfree(data);
 	}
 	if (page) free_page((unsigned long)page);
@@ -942,7 +1038,8 @@ int swsusp_write(unsigned int flags)
 	if (!error) {
 		error = (flags & SF_NOCOMPRESS_MODE) ?
 			save_image(&handle, &snapshot, pages - 1) :
-			save_image_lzo(&handle, &snapshot, pages - 1);
+			save_compressed_image(&handle, &snapshot, pages - 1,
+					      flags);
 	}
 out_finish:
 	error = swap_writer_finish(&handle, flags, error);
@@ -1109,13 +1206,16 @@ static int load_image(struct swap_map_handle *handle,
 }
 
 /**
- * Structure used for LZO data decompression.
+ * Structure used for data decompression.
  */
 struct dec_data {
 	struct task_struct *thr;                  /* thread */
 	atomic_t ready;                           /* ready to start flag */
 	atomic_t stop;                            /* ready to stop flag */
 	int ret;                                  /* return code */
+	unsigned int alg;                         /* SF_COMPRESS_* or 0 */
+	void *zstd_wrk;                           /* zstd workspace */
+	ZSTD_DCtx *dctx;                          /* zstd context */
 	wait_queue_head_t go;                     /* start decompression */
 	wait_queue_head_t done;                   /* decompression done */
 	size_t unc_len;                           /* uncompressed length */
@@ -1124,10 +1224,70 @@ struct dec_data {
 	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
 };
 
+static int hib_decompress_init(struct dec_data *d, unsigned int alg)
+{
+	/* The image may have been written by a kernel with more compressors */
+	if ((alg == SF_COMPRESS_LZ4 &&
+	     !IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4)) ||
+	    (alg == SF_COMPRESS_ZSTD &&
+	     !IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD)))
+		return -EOPNOTSUPP;
+
+	d->alg = alg;
+
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) &&
+	    alg == SF_COMPRESS_ZSTD) {
+		size_t size = ZSTD_DCtxWorkspaceBound();
+
+		d->zstd_wrk = vmalloc(size);
+		if (!d->zstd_wrk)
+			return -ENOMEM;
+
+		d->dctx = ZSTD_initDCtx(d->zstd_wrk, size);
+		if (!d->dctx)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int hib_decompress(struct dec_data *d)
+{
+	const unsigned char *src = d->cmp + LZO_HEADER;
+
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4) &&
+	    d->alg == SF_COMPRESS_LZ4) {
+		int len = LZ4_decompress_safe((const char *)src,
+					      (char *)d->unc, d->cmp_len,
+					      LZO_UNC_SIZE);
+
+		if (len < 0)
+			return -1;
+
+		d->unc_len = len;
+		return 0;
+	}
+
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) &&
+	    d->alg == SF_COMPRESS_ZSTD) {
+		size_t len = ZSTD_decompressDCtx(d->dctx, d->unc, LZO_UNC_SIZE,
+						 src, d->cmp_len);
+
+		if (ZSTD_isError(len))
+			return -1;
+
+		d->unc_len = len;
+		return 0;
+	}
+
+	d->unc_len = LZO_UNC_SIZE;
+	return lzo1x_decompress_safe(src, d->cmp_len, d->unc, &d->unc_len);
+}
+
 /**
  * Decompression function that runs in its own thread.
  */
-static int lzo_decompress_threadfn(void *data)
+static int decompress_threadfn(void *data)
 {
 	struct dec_data *d = data;
 
@@ -1143,9 +1303,7 @@ static int lzo_decompress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->unc_len = LZO_UNC_SIZE;
-		d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
-		                               d->unc, &d->unc_len);
+		d->ret = hib_decompress(d);
 		if (clean_pages_on_decompress)
 			flush_icache_range((unsigned long)d->unc,
 					   (unsigned long)d->unc + d->unc_len);
@@ -1157,15 +1315,18 @@ static int lzo_decompress_threadfn(void *data)
 }
 
 /**
- * load_image_lzo - Load compressed image data and decompress them with LZO.
+ * load_compressed_image - Load compressed image data and decompress them.
  * @handle: Swap map handle to use for loading data.
  * @snapshot: Image to copy uncompressed data into.
  * @nr_to_read: Number of pages to load.
+ * @flags: Image flags, selecting the compressor.
  */
-static int load_image_lzo(struct swap_map_handle *handle,
-                          struct snapshot_handle *snapshot,
-                          unsigned int nr_to_read)
+static int load_compressed_image(struct swap_map_handle *handle,
+                                 struct snapshot_handle *snapshot,
+                                 unsigned int nr_to_read,
+                                 unsigned int flags)
 {
+	unsigned int alg = flags & SF_COMPRESS_MASK;
 	unsigned int m;
 	int ret = 0;
 	int eof = 0;
@@ -1206,6 +1367,14 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	}
 	for (thr = 0; thr < nr_threads; thr++)
 		memset(&data[thr], 0, offsetof(struct dec_data, go));
+	for (thr = 0; thr < nr_threads; thr++) {
+		ret = hib_decompress_init(&data[thr], alg);
+		if (ret) {
+			pr_err("Failed to set up %s decompression\n",
+			       swsusp_compressor_name(alg));
+			goto out_clean;
+		}
+	}
 
 	crc = kmalloc(sizeof(*crc), GFP_KERNEL);
 	if (!crc) {
@@ -1224,7 +1393,7 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		init_waitqueue_head(&data[thr].go);
 		init_waitqueue_head(&data[thr].done);
 
-		data[thr].thr = kthread_run(lzo_decompress_threadfn,
+		data[thr].thr = kthread_run(decompress_threadfn,
 		                            &data[thr],
 		                            "image_decompress/%u", thr);
 		if (IS_ERR(data[thr].thr)) {
@@ -1286,7 +1455,8 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	}
 	want = ring_size = i;
 
-	pr_info("Using %u thread(s) for decompression\n", nr_threads);
+	pr_info("Using %u thread(s) for %s decompression\n", nr_threads,
+		swsusp_compressor_name(alg));
 	pr_info("Loading and decompressing image data (%u pages)...\n",
 		nr_to_read);
 	m = nr_to_read / 10;
@@ -1348,7 +1518,7 @@ static int load_image_lzo(struct swap_map_handle *handle,
 			if (unlikely(!data[thr].cmp_len ||
 			             data[thr].cmp_len >
 			             lzo1x_worst_compress(LZO_UNC_SIZE))) {
-				pr_err("Invalid LZO compressed length\n");
+				pr_err("Invalid compressed length\n");
 				ret = -1;
 				goto out_finish;
 			}
@@ -1399,14 +1569,15 @@ static int load_image_lzo(struct swap_map_handle *handle,
 			ret = data[thr].ret;
 
 			if (ret < 0) {
-				pr_err("LZO decompression failed\n");
+				pr_err("%s decompression failed\n",
+				       swsusp_compressor_name(alg));
 				goto out_finish;
 			}
 
 			if (unlikely(!data[thr].unc_len ||
 			             data[thr].unc_len > LZO_UNC_SIZE ||
 			             data[thr].unc_len & (PAGE_SIZE - 1))) {
-				pr_err("Invalid LZO uncompressed length\n");
+				pr_err("Invalid uncompressed length\n");
 				ret = -1;
 				goto out_finish;
 			}
@@ -1467,9 +1638,11 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		kfree(crc);
 	}
 	if (data) {
-		for (thr = 0; thr < nr_threads; thr++)
+		for (thr = 0; thr < nr_threads; thr++) {
 			if (data[thr].thr)
 				kthread_stop(data[thr].thr);
+			vfree(data[thr].zstd_wrk);
+		}
 		vfree(data);
 	}
 	vfree(page);
@@ -1503,7 +1676,8 @@ int swsusp_read(unsigned int *flags_p)
 	if (!error) {
 		error = (*flags_p & SF_NOCOMPRESS_MODE) ?
 			load_image(&handle, &snapshot, header->pages - 1) :
-			load_image_lzo(&handle, &snapshot, header->pages - 1);
+			load_compressed_image(&handle, &snapshot,
+					      header->pages - 1, *flags_p);
 	}
 	swap_reader_finish(&handle);
 end:
@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -2236,6 +2237,134 @@ int vprintk_store(int facility, int level,
 	return ret;
 }
 
+/*
+ * Console offloading.  With printk.offload=1, printk() only stores the
+ * record and the "printk" kthread prints it, so a slow console no longer
+ * holds up the CPU that logged the message.  The kthread keeps at most
+ * printk.offload_backlog records queued for the consoles; older ones are
+ * skipped and reported through the usual "messages dropped" line.  Printing
+ * is still done synchronously before the system is running, during an oops
+ * and on panic.
+ */
+static bool printk_offload;
+
+static unsigned int printk_offload_backlog = 1000;
+module_param_named(offload_backlog, printk_offload_backlog, uint, 0644);
+MODULE_PARM_DESC(offload_backlog, "max records queued for offloaded consoles (0 = unlimited)");
+
+static unsigned long printk_offload_dropped;
+module_param_named(offload_dropped, printk_offload_dropped, ulong, 0444);
+MODULE_PARM_DESC(offload_dropped, "records skipped to keep within offload_backlog");
+
+static struct task_struct *printk_kthread;
+static DECLARE_WAIT_QUEUE_HEAD(printk_kthread_wait);
+static bool printk_kthread_pending;
+
+static bool printk_offload_active(void)
+{
+	return READ_ONCE(printk_offload) && printk_kthread &&
+	       system_state == SYSTEM_RUNNING && !oops_in_progress &&
+	       atomic_read(&panic_cpu) == PANIC_CPU_INVALID;
+}
+
+/* Called from irq_work context. */
+static void printk_kthread_wake(void)
+{
+	WRITE_ONCE(printk_kthread_pending, true);
+	wake_up(&printk_kthread_wait);
+}
+
+/* Must be called with console_sem held. */
+static void printk_offload_trim_backlog(void)
+{
+	unsigned int backlog = READ_ONCE(printk_offload_backlog);
+	u64 next_seq = prb_next_seq(prb);
+	u64 skip;
+
+	if (!backlog || next_seq - console_seq <= backlog)
+		return;
+
+	skip = next_seq - console_seq - backlog;
+	console_seq += skip;
+	console_dropped += skip;
+	printk_offload_dropped += skip;
+}
+
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		/* Interruptible, so an idle kthread is not counted as loadavg. */
+		wait_event_interruptible(printk_kthread_wait,
+					 READ_ONCE(printk_kthread_pending));
+		WRITE_ONCE(printk_kthread_pending, false);
+
+		/* console_lock() allows console_unlock() to reschedule. */
+		console_lock();
+		printk_offload_trim_backlog();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+/*
+ * The kthread is only started once offloading is enabled, either at boot
+ * from printk_offload_init() or later through the parameter.
+ */
+static DEFINE_MUTEX(printk_kthread_mutex);
+static bool printk_kthread_allowed;
+
+static int printk_kthread_start(void)
+{
+	struct task_struct *tsk;
+	int ret = 0;
+
+	mutex_lock(&printk_kthread_mutex);
+	if (!printk_kthread_allowed || printk_kthread ||
+	    !READ_ONCE(printk_offload))
+		goto out;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		ret = PTR_ERR(tsk);
+		pr_err("failed to start printk kthread: %d\n", ret);
+		goto out;
+	}
+
+	printk_kthread = tsk;
+out:
+	mutex_unlock(&printk_kthread_mutex);
+	return ret;
+}
+
+static int printk_offload_set(const char *val, const struct kernel_param *kp)
+{
+	int ret;
+
+	ret = param_set_bool(val, kp);
+	if (ret)
+		return ret;
+
+	return printk_kthread_start();
+}
+
+static const struct kernel_param_ops printk_offload_ops = {
+	.set = printk_offload_set,
+	.get = param_get_bool,
+};
+module_param_cb(offload, &printk_offload_ops, &printk_offload, 0644);
+MODULE_PARM_DESC(offload, "print to consoles from a kthread");
+
+static int __init printk_offload_init(void)
+{
+	mutex_lock(&printk_kthread_mutex);
+	printk_kthread_allowed = true;
+	mutex_unlock(&printk_kthread_mutex);
+
+	return printk_kthread_start();
+}
+late_initcall(printk_offload_init);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const struct dev_printk_info *dev_info,
 			    const char *fmt, va_list args)
@@ -2257,6 +2386,10 @@ asmlinkage int vprintk_emit(int facility, int level,
 
 	printed_len = vprintk_store(facility, level, dev_info, fmt, args);
 
+	/* Let the printk kthread do the printing, see defer_console_output(). */
+	if (!in_sched && printk_offload_active())
+		in_sched = true;
+
 	/* If called from the scheduler, we can not call up(). */
 	if (!in_sched) {
 		/*
@@ -3273,9 +3406,13 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
-		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
-			console_unlock();
+		if (printk_offload_active()) {
+			printk_kthread_wake();
+		} else {
+			/* If trylock fails, someone else is doing the printing */
+			if (console_trylock())
+				console_unlock();
+		}
 	}
 
 	if (pending & PRINTK_PENDING_WAKEUP)
@@ -19,15 +19,19 @@
 #include <linux/interrupt.h>
 #include <linux/kthread.h>
 #include <linux/kernel.h>
+#include <linux/local_lock.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/notifier.h>
 #include <linux/percpu.h>
+#include <linux/percpu-rwsem.h>
 #include <linux/rcupdate.h>
 #include <linux/rcupdate_trace.h>
 #include <linux/reboot.h>
 #include <linux/sched.h>
+#include <linux/seqlock.h>
+#include <linux/sort.h>
 #include <linux/spinlock.h>
 #include <linux/smp.h>
 #include <linux/stat.h>
@@ -66,7 +70,7 @@ MODULE_AUTHOR("Joel Fernandes (Google) <joel@joelfernandes.org>");
 
 static char *scale_type = "rcu";
 module_param(scale_type, charp, 0444);
-MODULE_PARM_DESC(scale_type, "Type of test (rcu, srcu, refcnt, rwsem, rwlock.");
+MODULE_PARM_DESC(scale_type, "Type of test (rcu, srcu, refcnt, rwsem, rwlock, percpu-rwsem, seqcount, local-lock.");
 
 torture_param(int, verbose, 0, "Enable verbose debugging printk()s");
 torture_param(int, verbose_batched, 0, "Batch verbose debugging printk()s");
@@ -82,6 +86,8 @@ torture_param(int, nreaders, -1, "Number of readers, -1 for 75% of CPUs.");
 torture_param(int, nruns, 30, "Number of experiments to run.");
 // Reader delay in nanoseconds, 0 for no delay.
 torture_param(int, readdelay, 0, "Read-side delay in nanoseconds.");
+// Emit results as comma-separated values for post-processing.
+torture_param(bool, csv, false, "Print results in CSV format.");
 
 #ifdef MODULE
 # define REFSCALE_SHUTDOWN 0
@@ -362,6 +368,100 @@ static struct ref_scale_ops rwsem_ops = {
 	.name		= "rwsem"
 };
 
+// Definitions for percpu-rwsem
+DEFINE_STATIC_PERCPU_RWSEM(test_percpu_rwsem);
+
+static void ref_percpu_rwsem_section(const int nloops)
+{
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		percpu_down_read(&test_percpu_rwsem);
+		percpu_up_read(&test_percpu_rwsem);
+	}
+}
+
+static void ref_percpu_rwsem_delay_section(const int nloops, const int udl, const int ndl)
+{
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		percpu_down_read(&test_percpu_rwsem);
+		un_delay(udl, ndl);
+		percpu_up_read(&test_percpu_rwsem);
+	}
+}
+
+static struct ref_scale_ops percpu_rwsem_ops = {
+	.readsection	= ref_percpu_rwsem_section,
+	.delaysection	= ref_percpu_rwsem_delay_section,
+	.name		= "percpu-rwsem"
+};
+
+// Definitions for seqcount
+static seqcount_t test_seqcount = SEQCNT_ZERO(test_seqcount);
+
+static void ref_seqcount_section(const int nloops)
+{
+	unsigned int seq;
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		do {
+			seq = read_seqcount_begin(&test_seqcount);
+		} while (read_seqcount_retry(&test_seqcount, seq));
+	}
+}
+
+static void ref_seqcount_delay_section(const int nloops, const int udl, const int ndl)
+{
+	unsigned int seq;
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		do {
+			seq = read_seqcount_begin(&test_seqcount);
+			un_delay(udl, ndl);
+		} while (read_seqcount_retry(&test_seqcount, seq));
+	}
+}
+
+static struct ref_scale_ops seqcount_ops = {
+	.readsection	= ref_seqcount_section,
+	.delaysection	= ref_seqcount_delay_section,
+	.name		= "seqcount"
+};
+
+// Definitions for per-CPU local_lock
+static DEFINE_PER_CPU(local_lock_t, test_local_lock) = INIT_LOCAL_LOCK(test_local_lock);
+
+static void ref_local_lock_section(const int nloops)
+{
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		local_lock(&test_local_lock);
+		local_unlock(&test_local_lock);
+	}
+}
+
+static void ref_local_lock_delay_section(const int nloops, const int udl, const int ndl)
+{
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		local_lock(&test_local_lock);
+		un_delay(udl, ndl);
+		local_unlock(&test_local_lock);
+	}
+}
+
+static struct ref_scale_ops local_lock_ops = {
+	.readsection	= ref_local_lock_section,
+	.delaysection	= ref_local_lock_delay_section,
+	.name		= "local-lock"
+};
+
 // Definitions for global spinlock
 static DEFINE_SPINLOCK(test_lock);
 
@@ -629,6 +729,48 @@ static u64 process_durations(int n)
 	return sum;
 }
 
+static int ref_scale_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a;
+	u64 y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+// Sort the per-reader per-run samples (in units of 1/1000 ns per loop)
+// and print their distribution, either human-readable or as CSV.
+static void process_percentiles(u64 *samples, int n)
+{
+	static const char * const labels[] = { "min", "p50", "p90", "p99", "max" };
+	static const int pcts[] = { 0, 50, 90, 99, 100 };
+	char buf[64 + ARRAY_SIZE(pcts) * 32];
+	char *p = buf;
+	u64 v;
+	u32 rem;
+	int i;
+
+	sort(samples, n, sizeof(*samples), ref_scale_cmp_u64, NULL);
+
+	if (csv) {
+		p += sprintf(p, "type,nreaders,loops");
+		for (i = 0; i < ARRAY_SIZE(labels); i++)
+			p += sprintf(p, ",%s", labels[i]);
+		SCALEOUT("%s\n", buf);
+		p = buf;
+		p += sprintf(p, "%s,%d,%ld", scale_type, nreaders, loops);
+	} else {
+		p += sprintf(p, "Per-reader time per loop (nanoseconds):");
+	}
+	for (i = 0; i < ARRAY_SIZE(pcts); i++) {
+		v = div_u64_rem(samples[(n - 1) * pcts[i] / 100], 1000, &rem);
+		if (csv)
+			p += sprintf(p, ",%llu.%03u", v, rem);
+		else
+			p += sprintf(p, " %s %llu.%03u", labels[i], v, rem);
+	}
+	SCALEOUT("%s\n", buf);
+}
+
 // The main_func is the main orchestrator, it performs a bunch of
 // experiments.  For every experiment, it orders all the readers
 // involved to start and waits for them to finish the experiment. It
@@ -642,14 +784,16 @@ static int main_func(void *arg)
 	char buf1[64];
 	char *buf;
 	u64 *result_avg;
+	u64 *samples;
 
 	set_cpus_allowed_ptr(current, cpumask_of(nreaders % nr_cpu_ids));
 	set_user_nice(current, MAX_NICE);
 
 	VERBOSE_SCALEOUT("main_func task started");
 	result_avg = kzalloc(nruns * sizeof(*result_avg), GFP_KERNEL);
+	samples = kcalloc(nruns * nreaders, sizeof(*samples), GFP_KERNEL);
 	buf = kzalloc(64 + nruns * 32, GFP_KERNEL);
-	if (!result_avg || !buf) {
+	if (!result_avg || !samples || !buf) {
 		VERBOSE_SCALEOUT_ERRSTRING("out of memory");
 		errexit = true;
 	}
@@ -693,6 +837,9 @@ static int main_func(void *arg)
 			goto end;
 
 		result_avg[exp] = div_u64(1000 * process_durations(nreaders), nreaders * loops);
+		for (r = 0; r < nreaders; r++)
+			samples[exp * nreaders + r] =
+				div_u64(1000 * reader_tasks[r].last_duration_ns, loops);
 	}
 
 	// Print the average of all experiments
@@ -701,7 +848,7 @@ static int main_func(void *arg)
 	if (!errexit) {
 		buf[0] = 0;
 		strcat(buf, "\n");
-		strcat(buf, "Runs\tTime(ns)\n");
+		strcat(buf, csv ? "run,ns_per_loop\n" : "Runs\tTime(ns)\n");
 	}
 
 	for (exp = 0; exp < nruns; exp++) {
@@ -711,12 +858,14 @@ static int main_func(void *arg)
 		if (errexit)
 			break;
 		avg = div_u64_rem(result_avg[exp], 1000, &rem);
-		sprintf(buf1, "%d\t%llu.%03u\n", exp + 1, avg, rem);
+		sprintf(buf1, csv ? "%d,%llu.%03u\n" : "%d\t%llu.%03u\n", exp + 1, avg, rem);
 		strcat(buf, buf1);
 	}
 
-	if (!errexit)
+	if (!errexit) {
 		SCALEOUT("%s", buf);
+		process_percentiles(samples, nruns * nreaders);
+	}
 
 	// This will shutdown everything including us.
 	if (shutdown) {
@@ -731,6 +880,7 @@ static int main_func(void *arg)
 end:
 	torture_kthread_stopping("main_func");
 	kfree(result_avg);
+	kfree(samples);
 	kfree(buf);
 	return 0;
 }
@@ -739,8 +889,8 @@ static void
 ref_scale_print_module_parms(struct ref_scale_ops *cur_ops, const char *tag)
 {
 	pr_alert("%s" SCALE_FLAG
-		 "--- %s:  verbose=%d shutdown=%d holdoff=%d loops=%ld nreaders=%d nruns=%d readdelay=%d\n", scale_type, tag,
-		 verbose, shutdown, holdoff, loops, nreaders, nruns, readdelay);
+		 "--- %s:  verbose=%d shutdown=%d holdoff=%d loops=%ld nreaders=%d nruns=%d readdelay=%d csv=%d\n", scale_type, tag,
+		 verbose, shutdown, holdoff, loops, nreaders, nruns, readdelay, csv);
 }
 
 static void
@@ -793,7 +943,8 @@ ref_scale_init(void)
 	int firsterr = 0;
 	static struct ref_scale_ops *scale_ops[] = {
 		&rcu_ops, &srcu_ops, &rcu_trace_ops, &rcu_tasks_ops, &refcnt_ops, &rwlock_ops,
-		&rwsem_ops, &lock_ops, &lock_irq_ops, &acqrel_ops, &clock_ops,
+		&rwsem_ops, &percpu_rwsem_ops, &seqcount_ops, &local_lock_ops,
+		&lock_ops, &lock_irq_ops, &acqrel_ops, &clock_ops,
 	};
 
 	if (!torture_init_begin(scale_type, verbose))
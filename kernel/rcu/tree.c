@@ -2978,7 +2978,7 @@ static void check_cb_ovld(struct rcu_data *rdp)
 
 /* Helper function for call_rcu() and friends.  */
 static void
-__call_rcu(struct rcu_head *head, rcu_callback_t func)
+__call_rcu(struct rcu_head *head, rcu_callback_t func, bool lazy)
 {
 	static atomic_t doublefrees;
 	unsigned long flags;
@@ -3023,7 +3023,7 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func)
 	}
 
 	check_cb_ovld(rdp);
-	if (rcu_nocb_try_bypass(rdp, head, &was_alldone, flags))
+	if (rcu_nocb_try_bypass(rdp, head, &was_alldone, flags, lazy))
 		return; // Enqueued onto ->nocb_bypass, so just leave.
 	// If no-CBs CPU gets here, rcu_nocb_try_bypass() acquired ->nocb_lock.
 	rcu_segcblist_enqueue(&rdp->cblist, head);
@@ -3088,10 +3088,32 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func)
  */
 void call_rcu(struct rcu_head *head, rcu_callback_t func)
 {
-	__call_rcu(head, func);
+	__call_rcu(head, func, false);
 }
 EXPORT_SYMBOL_GPL(call_rcu);
 
+/**
+ * call_rcu_lazy() - Queue a non-urgent RCU callback.
+ * @head: structure to be used for queueing the RCU updates.
+ * @func: actual callback function to be invoked after the grace period
+ *
+ * This is identical to call_rcu() in terms of grace-period and
+ * memory-ordering guarantees, but tells RCU that nobody is waiting
+ * on the callback.  When the rcutree.nocb_lazy module parameter is set,
+ * callbacks queued this way on a no-CBs CPU are held on the ->nocb_bypass
+ * list for up to rcutree.nocb_lazy_flush_jiffies before a grace period
+ * is requested on their behalf, which allows an otherwise idle system
+ * to batch them instead of waking up for each one.  Lazy callbacks are
+ * flushed early by any non-lazy callback, by rcu_barrier(), and under
+ * memory pressure, so this is suitable for callbacks that only free
+ * memory.  Do not use it for anything whose completion someone waits on.
+ */
+void call_rcu_lazy(struct rcu_head *head, rcu_callback_t func)
+{
+	__call_rcu(head, func, true);
+}
+EXPORT_SYMBOL_GPL(call_rcu_lazy);
+
 
 /* Maximum number of jiffies to wait before draining a batch. */
 #define KFREE_DRAIN_JIFFIES (HZ / 50)
@@ -4007,11 +4029,14 @@ static void rcu_barrier_func(void *cpu_in)
 {
 	uintptr_t cpu = (uintptr_t)cpu_in;
 	struct rcu_data *rdp = per_cpu_ptr(&rcu_data, cpu);
+	bool wake_gp;
 
 	rcu_barrier_trace(TPS("IRQ"), -1, rcu_state.barrier_sequence);
 	rdp->barrier_head.func = rcu_barrier_callback;
 	debug_rcu_head_queue(&rdp->barrier_head);
 	rcu_nocb_lock(rdp);
+	/* Flushed lazy callbacks would otherwise wait for the lazy timeout. */
+	wake_gp = rcu_rdp_is_offloaded(rdp) && rcu_nocb_bypass_lazy(rdp);
 	WARN_ON_ONCE(!rcu_nocb_flush_bypass(rdp, NULL, jiffies));
 	if (rcu_segcblist_entrain(&rdp->cblist, &rdp->barrier_head)) {
 		atomic_inc(&rcu_state.barrier_cpu_count);
@@ -4021,6 +4046,8 @@ static void rcu_barrier_func(void *cpu_in)
 				  rcu_state.barrier_sequence);
 	}
 	rcu_nocb_unlock(rdp);
+	if (wake_gp)
+		wake_nocb_gp(rdp, false);
 }
 
 /**
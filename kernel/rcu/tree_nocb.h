@@ -84,7 +84,24 @@ early_param("rcu_nocb_poll", parse_rcu_nocb_poll);
  * on ->nocb_lock, which only can happen at high call_rcu() rates.
  */
 static int nocb_nobypass_lim_per_jiffy = 16 * 1000 / HZ;
-module_param(nocb_nobypass_lim_per_jiffy, int, 0);
+module_param(nocb_nobypass_lim_per_jiffy, int, 0644);
+
+/*
+ * When enabled, callbacks queued by call_rcu_lazy() skip the direct
+ * ->cblist enqueue and sit on ->nocb_bypass for up to
+ * nocb_lazy_flush_jiffies, so that a mostly idle system does not start
+ * a grace period (and wake the rcuo kthreads) for each of them.  Both
+ * may be changed at runtime.
+ */
+static bool nocb_lazy;
+module_param(nocb_lazy, bool, 0644);
+static ulong nocb_lazy_flush_jiffies = 10 * HZ;
+module_param(nocb_lazy_flush_jiffies, ulong, 0644);
+
+static unsigned long rcu_nocb_lazy_flush_jiffies(void)
+{
+	return max(READ_ONCE(nocb_lazy_flush_jiffies), 1UL);
+}
 
 /*
  * Acquire the specified rcu_data structure's ->nocb_bypass_lock.  If the
@@ -243,6 +260,17 @@ static bool wake_nocb_gp(struct rcu_data *rdp, bool force)
 	return __wake_nocb_gp(rdp_gp, rdp, force, flags);
 }
 
+/*
+ * Does ->nocb_bypass hold nothing but lazy callbacks?  The GP kthread may
+ * then sleep until the lazy flush timer fires.  Call with the nocb lock held.
+ */
+static bool rcu_nocb_bypass_lazy(struct rcu_data *rdp)
+{
+	long ncbs = rcu_cblist_n_cbs(&rdp->nocb_bypass);
+
+	return ncbs && ncbs == READ_ONCE(rdp->lazy_len);
+}
+
 /*
  * Arrange to wake the GP kthread for this NOCB group at some future
  * time when it is safe to do so.
@@ -257,9 +285,16 @@ static void wake_nocb_gp_defer(struct rcu_data *rdp, int waketype,
 
 	/*
 	 * Bypass wakeup overrides previous deferments. In case
-	 * of callback storm, no need to wake up too early.
+	 * of callback storm, no need to wake up too early.  A lazy
+	 * wakeup only arms the timer if nothing more urgent is pending.
 	 */
-	if (waketype == RCU_NOCB_WAKE_BYPASS) {
+	if (waketype == RCU_NOCB_WAKE_LAZY) {
+		if (rdp_gp->nocb_defer_wakeup == RCU_NOCB_WAKE_NOT) {
+			mod_timer(&rdp_gp->nocb_timer,
+				  jiffies + rcu_nocb_lazy_flush_jiffies());
+			WRITE_ONCE(rdp_gp->nocb_defer_wakeup, waketype);
+		}
+	} else if (waketype == RCU_NOCB_WAKE_BYPASS) {
 		mod_timer(&rdp_gp->nocb_timer, jiffies + 2);
 		WRITE_ONCE(rdp_gp->nocb_defer_wakeup, waketype);
 	} else {
@@ -299,6 +334,7 @@ static bool rcu_nocb_do_flush_bypass(struct rcu_data *rdp, struct rcu_head *rhp,
 		rcu_segcblist_inc_len(&rdp->cblist); /* Must precede enqueue. */
 	rcu_cblist_flush_enqueue(&rcl, &rdp->nocb_bypass, rhp);
 	rcu_segcblist_insert_pend_cbs(&rdp->cblist, &rcl);
+	WRITE_ONCE(rdp->lazy_len, 0);
 	WRITE_ONCE(rdp->nocb_bypass_first, j);
 	rcu_nocb_bypass_unlock(rdp);
 	return true;
@@ -348,20 +384,29 @@ static void rcu_nocb_try_flush_bypass(struct rcu_data *rdp, unsigned long j)
  * non-empty, the corresponding no-CBs grace-period kthread must not be
  * in an indefinite sleep state.
  *
+ * Lazy callbacks always go to ->nocb_bypass when nocb_lazy is set,
+ * and a bypass list holding nothing but lazy callbacks is allowed to
+ * age for nocb_lazy_flush_jiffies rather than a single jiffy.  The
+ * first non-lazy callback ends the laziness for the whole list.
+ *
  * Finally, it is not permitted to use the bypass during early boot,
  * as doing so would confuse the auto-initialization code.  Besides
  * which, there is no point in worrying about lock contention while
  * there is only one CPU in operation.
  */
 static bool rcu_nocb_try_bypass(struct rcu_data *rdp, struct rcu_head *rhp,
-				bool *was_alldone, unsigned long flags)
+				bool *was_alldone, unsigned long flags,
+				bool lazy)
 {
 	unsigned long c;
 	unsigned long cur_gp_seq;
 	unsigned long j = jiffies;
 	long ncbs = rcu_cblist_n_cbs(&rdp->nocb_bypass);
+	bool bypass_is_lazy;
 
 	lockdep_assert_irqs_disabled();
+	lazy = lazy && READ_ONCE(nocb_lazy);
+	bypass_is_lazy = ncbs && ncbs == READ_ONCE(rdp->lazy_len);
 
 	// Pure softirq/rcuc based processing: no bypassing, no
 	// locking.
@@ -403,8 +448,9 @@ static bool rcu_nocb_try_bypass(struct rcu_data *rdp, struct rcu_head *rhp,
 
 	// If there hasn't yet been all that many ->cblist enqueues
 	// this jiffy, tell the caller to enqueue onto ->cblist.  But flush
-	// ->nocb_bypass first.
-	if (rdp->nocb_nobypass_count < nocb_nobypass_lim_per_jiffy) {
+	// ->nocb_bypass first.  Lazy callbacks go straight to the bypass.
+	if (rdp->nocb_nobypass_count < READ_ONCE(nocb_nobypass_lim_per_jiffy) &&
+	    !lazy) {
 		rcu_nocb_lock(rdp);
 		*was_alldone = !rcu_segcblist_pend_cbs(&rdp->cblist);
 		if (*was_alldone)
@@ -417,7 +463,10 @@ static bool rcu_nocb_try_bypass(struct rcu_data *rdp, struct rcu_head *rhp,
 
 	// If ->nocb_bypass has been used too long or is too full,
 	// flush ->nocb_bypass to ->cblist.
-	if ((ncbs && j != READ_ONCE(rdp->nocb_bypass_first)) ||
+	if ((ncbs && !bypass_is_lazy && j != READ_ONCE(rdp->nocb_bypass_first)) ||
+	    (bypass_is_lazy &&
+	     time_after(j, READ_ONCE(rdp->nocb_bypass_first) +
+			   rcu_nocb_lazy_flush_jiffies())) ||
 	    ncbs >= qhimark) {
 		rcu_nocb_lock(rdp);
 		if (!rcu_nocb_flush_bypass(rdp, rhp, j)) {
@@ -443,13 +492,18 @@ static bool rcu_nocb_try_bypass(struct rcu_data *rdp, struct rcu_head *rhp,
 	ncbs = rcu_cblist_n_cbs(&rdp->nocb_bypass);
 	rcu_segcblist_inc_len(&rdp->cblist); /* Must precede enqueue. */
 	rcu_cblist_enqueue(&rdp->nocb_bypass, rhp);
+	if (lazy)
+		WRITE_ONCE(rdp->lazy_len, rdp->lazy_len + 1);
 	if (!ncbs) {
 		WRITE_ONCE(rdp->nocb_bypass_first, j);
 		trace_rcu_nocb_wake(rcu_state.name, rdp->cpu, TPS("FirstBQ"));
 	}
 	rcu_nocb_bypass_unlock(rdp);
 	smp_mb(); /* Order enqueue before wake. */
-	if (ncbs) {
+	// The GP kthread needs a kick for the first bypass entry, and also
+	// when a non-lazy callback lands behind a lazy-only list so that
+	// the long lazy timer is replaced by the usual short one.
+	if (ncbs && !(bypass_is_lazy && !lazy)) {
 		local_irq_restore(flags);
 	} else {
 		// No-CBs GP kthread might be indefinitely asleep, if so, wake.
@@ -479,6 +533,8 @@ static void __call_rcu_nocb_wake(struct rcu_data *rdp, bool was_alldone,
 {
 	unsigned long cur_gp_seq;
 	unsigned long j;
+	long bypass_len;
+	long lazy_len;
 	long len;
 	struct task_struct *t;
 
@@ -492,9 +548,16 @@ static void __call_rcu_nocb_wake(struct rcu_data *rdp, bool was_alldone,
 	}
 	// Need to actually to a wakeup.
 	len = rcu_segcblist_n_cbs(&rdp->cblist);
+	bypass_len = rcu_cblist_n_cbs(&rdp->nocb_bypass);
+	lazy_len = READ_ONCE(rdp->lazy_len);
 	if (was_alldone) {
 		rdp->qlen_last_fqs_check = len;
-		if (!irqs_disabled_flags(flags)) {
+		if (lazy_len && bypass_len == lazy_len) {
+			/* ... only lazy CBs, so no hurry ... */
+			rcu_nocb_unlock_irqrestore(rdp, flags);
+			wake_nocb_gp_defer(rdp, RCU_NOCB_WAKE_LAZY,
+					   TPS("WakeLazy"));
+		} else if (!irqs_disabled_flags(flags)) {
 			/* ... if queue was empty ... */
 			rcu_nocb_unlock_irqrestore(rdp, flags);
 			wake_nocb_gp(rdp, false);
@@ -588,6 +651,9 @@ static void nocb_gp_wait(struct rcu_data *my_rdp)
 {
 	bool bypass = false;
 	long bypass_ncbs;
+	bool flush_bypass;
+	bool lazy = false;
+	long lazy_ncbs;
 	int __maybe_unused cpu = my_rdp->cpu;
 	unsigned long cur_gp_seq;
 	unsigned long flags;
@@ -621,22 +687,38 @@ static void nocb_gp_wait(struct rcu_data *my_rdp)
 			continue;
 		}
 		bypass_ncbs = rcu_cblist_n_cbs(&rdp->nocb_bypass);
-		if (bypass_ncbs &&
-		    (time_after(j, READ_ONCE(rdp->nocb_bypass_first) + 1) ||
-		     bypass_ncbs > 2 * qhimark)) {
-			// Bypass full or old, so flush it.
-			(void)rcu_nocb_try_flush_bypass(rdp, j);
-			bypass_ncbs = rcu_cblist_n_cbs(&rdp->nocb_bypass);
-		} else if (!bypass_ncbs && rcu_segcblist_empty(&rdp->cblist)) {
+		lazy_ncbs = READ_ONCE(rdp->lazy_len);
+		flush_bypass = false;
+		if (bypass_ncbs && lazy_ncbs == bypass_ncbs) {
+			// Lazy-only bypass, so let it age longer.
+			flush_bypass = time_after(j, READ_ONCE(rdp->nocb_bypass_first) +
+						     rcu_nocb_lazy_flush_jiffies()) ||
+				       bypass_ncbs > 2 * qhimark;
+		} else if (bypass_ncbs) {
+			flush_bypass = time_after(j, READ_ONCE(rdp->nocb_bypass_first) + 1) ||
+				       bypass_ncbs > 2 * qhimark;
+		} else if (rcu_segcblist_empty(&rdp->cblist)) {
 			rcu_nocb_unlock_irqrestore(rdp, flags);
 			if (needwake_state)
 				swake_up_one(&rdp->nocb_state_wq);
 			continue; /* No callbacks here, try next. */
 		}
+		if (flush_bypass) {
+			// Bypass full or old, so flush it.
+			if (lazy_ncbs == bypass_ncbs)
+				WRITE_ONCE(rdp->nocb_lazy_flushes,
+					   rdp->nocb_lazy_flushes + 1);
+			(void)rcu_nocb_try_flush_bypass(rdp, j);
+			bypass_ncbs = rcu_cblist_n_cbs(&rdp->nocb_bypass);
+			lazy_ncbs = READ_ONCE(rdp->lazy_len);
+		}
 		if (bypass_ncbs) {
 			trace_rcu_nocb_wake(rcu_state.name, rdp->cpu,
-					    TPS("Bypass"));
-			bypass = true;
+					    bypass_ncbs == lazy_ncbs ? TPS("Lazy") : TPS("Bypass"));
+			if (bypass_ncbs == lazy_ncbs)
+				lazy = true;
+			else
+				bypass = true;
 		}
 		rnp = rdp->mynode;
 
@@ -682,7 +764,7 @@ static void nocb_gp_wait(struct rcu_data *my_rdp)
 			swake_up_one(&rdp->nocb_state_wq);
 	}
 
-	my_rdp->nocb_gp_bypass = bypass;
+	my_rdp->nocb_gp_bypass = bypass || lazy;
 	my_rdp->nocb_gp_gp = needwait_gp;
 	my_rdp->nocb_gp_seq = needwait_gp ? wait_gp_seq : 0;
 
@@ -691,6 +773,10 @@ static void nocb_gp_wait(struct rcu_data *my_rdp)
 		// timer in order to avoid stranding its callbacks.
 		wake_nocb_gp_defer(my_rdp, RCU_NOCB_WAKE_BYPASS,
 				   TPS("WakeBypassIsDeferred"));
+	} else if (lazy && !rcu_nocb_poll) {
+		// Only lazy callbacks are waiting, so use the long timer.
+		wake_nocb_gp_defer(my_rdp, RCU_NOCB_WAKE_LAZY,
+				   TPS("WakeLazyIsDeferred"));
 	}
 	if (rcu_nocb_poll) {
 		/* Polling, so trace if first poll in the series. */
@@ -1092,6 +1178,63 @@ int rcu_nocb_cpu_offload(int cpu)
 }
 EXPORT_SYMBOL_GPL(rcu_nocb_cpu_offload);
 
+/*
+ * Lazy callbacks typically free memory, so don't let them linger on
+ * ->nocb_bypass while the system is trying to reclaim.
+ */
+static unsigned long
+lazy_rcu_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
+{
+	int cpu;
+	unsigned long count = 0;
+
+	if (!READ_ONCE(nocb_lazy))
+		return 0;
+
+	for_each_cpu(cpu, rcu_nocb_mask)
+		count += READ_ONCE(per_cpu_ptr(&rcu_data, cpu)->lazy_len);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+static unsigned long
+lazy_rcu_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
+{
+	int cpu;
+	unsigned long flags;
+	unsigned long count = 0;
+
+	for_each_cpu(cpu, rcu_nocb_mask) {
+		struct rcu_data *rdp = per_cpu_ptr(&rcu_data, cpu);
+		long lazy_len;
+
+		if (!READ_ONCE(rdp->lazy_len))
+			continue;
+		rcu_nocb_lock_irqsave(rdp, flags);
+		lazy_len = READ_ONCE(rdp->lazy_len);
+		if (!lazy_len || !rcu_rdp_is_offloaded(rdp)) {
+			rcu_nocb_unlock_irqrestore(rdp, flags);
+			continue;
+		}
+		WARN_ON_ONCE(!rcu_nocb_flush_bypass(rdp, NULL, jiffies));
+		rcu_nocb_unlock_irqrestore(rdp, flags);
+		wake_nocb_gp(rdp, false);
+		sc->nr_to_scan -= lazy_len;
+		count += lazy_len;
+		if (sc->nr_to_scan <= 0)
+			break;
+	}
+
+	return count ? count : SHRINK_STOP;
+}
+
+static struct shrinker lazy_rcu_shrinker = {
+	.count_objects = lazy_rcu_shrink_count,
+	.scan_objects = lazy_rcu_shrink_scan,
+	.batch = 0,
+	.seeks = DEFAULT_SEEKS,
+};
+
 void __init rcu_init_nohz(void)
 {
 	int cpu;
@@ -1139,6 +1282,9 @@ void __init rcu_init_nohz(void)
 		rcu_segcblist_set_flags(&rdp->cblist, SEGCBLIST_KTHREAD_GP);
 	}
 	rcu_organize_nocb_kthreads();
+
+	if (!cpumask_empty(rcu_nocb_mask) && register_shrinker(&lazy_rcu_shrinker))
+		pr_err("Failed to register lazy RCU shrinker!\n");
 }
 
 /* Initialize per-rcu_data variables for no-CBs CPUs. */
@@ -1342,7 +1488,7 @@ static void show_rcu_nocb_state(struct rcu_data *rdp)
 
 	sprintf(bufw, "%ld", rsclp->gp_seq[RCU_WAIT_TAIL]);
 	sprintf(bufr, "%ld", rsclp->gp_seq[RCU_NEXT_READY_TAIL]);
-	pr_info("   CB %d^%d->%d %c%c%c%c%c F%ld L%ld C%d %c%c%s%c%s%c%c q%ld %c CPU %d%s\n",
+	pr_info("   CB %d^%d->%d %c%c%c%c%c F%ld L%ld C%d %c%c%s%c%s%c%c q%ld z%ld/%lu %c CPU %d%s\n",
 		rdp->cpu, rdp->nocb_gp_rdp->cpu,
 		rdp->nocb_next_cb_rdp ? rdp->nocb_next_cb_rdp->cpu : -1,
 		"kK"[!!rdp->nocb_cb_kthread],
@@ -1361,6 +1507,7 @@ static void show_rcu_nocb_state(struct rcu_data *rdp)
 		".N"[!rcu_segcblist_segempty(rsclp, RCU_NEXT_TAIL)],
 		".B"[!!rcu_cblist_n_cbs(&rdp->nocb_bypass)],
 		rcu_segcblist_n_cbs(&rdp->cblist),
+		READ_ONCE(rdp->lazy_len), READ_ONCE(rdp->nocb_lazy_flushes),
 		rdp->nocb_cb_kthread ? task_state_to_char(rdp->nocb_cb_kthread) : '.',
 		rdp->nocb_cb_kthread ? (int)task_cpu(rdp->nocb_gp_kthread) : -1,
 		show_rcu_should_be_on_cpu(rdp->nocb_cb_kthread));
@@ -1416,6 +1563,16 @@ static void rcu_lockdep_assert_cblist_protected(struct rcu_data *rdp)
 	lockdep_assert_irqs_disabled();
 }
 
+static bool wake_nocb_gp(struct rcu_data *rdp, bool force)
+{
+	return false;
+}
+
+static bool rcu_nocb_bypass_lazy(struct rcu_data *rdp)
+{
+	return false;
+}
+
 static void rcu_nocb_gp_cleanup(struct swait_queue_head *sq)
 {
 }
@@ -1436,7 +1593,8 @@ static bool rcu_nocb_flush_bypass(struct rcu_data *rdp, struct rcu_head *rhp,
 }
 
 static bool rcu_nocb_try_bypass(struct rcu_data *rdp, struct rcu_head *rhp,
-				bool *was_alldone, unsigned long flags)
+				bool *was_alldone, unsigned long flags,
+				bool lazy)
 {
 	return false;
 }
@@ -608,6 +608,19 @@ static cpumask_var_t tick_broadcast_oneshot_mask __cpumask_var_read_mostly;
 static cpumask_var_t tick_broadcast_pending_mask __cpumask_var_read_mostly;
 static cpumask_var_t tick_broadcast_force_mask __cpumask_var_read_mostly;
 
+/*
+ * CPUs whose next event is at most this far after an expiring broadcast
+ * event are woken up together with it instead of getting a broadcast
+ * interrupt and IPI of their own. 0 disables coalescing.
+ */
+static unsigned int tick_broadcast_slack_ns;
+module_param_named(coalesce_slack_ns, tick_broadcast_slack_ns, uint, 0644);
+
+/* Protected by tick_broadcast_lock */
+static unsigned long tick_broadcast_nr_events;
+static unsigned long tick_broadcast_nr_woken;
+static unsigned long tick_broadcast_nr_coalesced;
+
 /*
  * Exposed for debugging: see timer_list.c
  */
@@ -616,6 +629,18 @@ struct cpumask *tick_get_broadcast_oneshot_mask(void)
 	return tick_broadcast_oneshot_mask;
 }
 
+void tick_broadcast_oneshot_get_stats(struct tick_broadcast_stats *stats)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&tick_broadcast_lock, flags);
+	stats->slack_ns = READ_ONCE(tick_broadcast_slack_ns);
+	stats->events = tick_broadcast_nr_events;
+	stats->woken = tick_broadcast_nr_woken;
+	stats->coalesced = tick_broadcast_nr_coalesced;
+	raw_spin_unlock_irqrestore(&tick_broadcast_lock, flags);
+}
+
 /*
  * Called before going idle with interrupts disabled. Checks whether a
  * broadcast event from the other core is about to happen. We detected
@@ -686,7 +711,7 @@ void tick_check_oneshot_broadcast_this_cpu(void)
 static void tick_handle_oneshot_broadcast(struct clock_event_device *dev)
 {
 	struct tick_device *td;
-	ktime_t now, next_event;
+	ktime_t now, next_event, coalesce;
 	int cpu, next_cpu = 0;
 	bool bc_local;
 
@@ -695,7 +720,14 @@ static void tick_handle_oneshot_broadcast(struct clock_event_device *dev)
 	next_event = KTIME_MAX;
 	cpumask_clear(tmpmask);
 	now = ktime_get();
-	/* Find all expired events */
+	coalesce = ktime_add_ns(now, READ_ONCE(tick_broadcast_slack_ns));
+	tick_broadcast_nr_events++;
+	/*
+	 * Find all expired events and the ones which expire within the
+	 * coalescing slack. The latter are woken up early, which is
+	 * cheaper than another broadcast interrupt and IPI right after
+	 * this one.
+	 */
 	for_each_cpu(cpu, tick_broadcast_oneshot_mask) {
 		/*
 		 * Required for !SMP because for_each_cpu() reports
@@ -706,7 +738,10 @@ static void tick_handle_oneshot_broadcast(struct clock_event_device *dev)
 			break;
 
 		td = &per_cpu(tick_cpu_device, cpu);
-		if (td->evtdev->next_event <= now) {
+		if (td->evtdev->next_event <= coalesce) {
+			if (td->evtdev->next_event > now)
+				tick_broadcast_nr_coalesced++;
+			tick_broadcast_nr_woken++;
 			cpumask_set_cpu(cpu, tmpmask);
 			/*
 			 * Mark the remote cpu in the pending mask, so
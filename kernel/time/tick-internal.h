@@ -125,11 +125,19 @@ static inline int tick_check_oneshot_change(int allow_nohz) { return 0; }
 
 /* Functions related to oneshot broadcasting */
 #if defined(CONFIG_GENERIC_CLOCKEVENTS_BROADCAST) && defined(CONFIG_TICK_ONESHOT)
+struct tick_broadcast_stats {
+	unsigned int		slack_ns;
+	unsigned long		events;
+	unsigned long		woken;
+	unsigned long		coalesced;
+};
+
 extern void tick_broadcast_switch_to_oneshot(void);
 extern int tick_broadcast_oneshot_active(void);
 extern void tick_check_oneshot_broadcast_this_cpu(void);
 bool tick_broadcast_oneshot_available(void);
 extern struct cpumask *tick_get_broadcast_oneshot_mask(void);
+extern void tick_broadcast_oneshot_get_stats(struct tick_broadcast_stats *stats);
 #else /* !(BROADCAST && ONESHOT): */
 static inline void tick_broadcast_switch_to_oneshot(void) { }
 static inline int tick_broadcast_oneshot_active(void) { return 0; }
@@ -1352,6 +1352,7 @@ static void tick_nohz_handler(struct clock_event_device *dev)
 	struct tick_sched *ts = this_cpu_ptr(&tick_cpu_sched);
 	struct pt_regs *regs = get_irq_regs();
 	ktime_t now = ktime_get();
+	ktime_t next = dev->next_event;
 
 	dev->next_event = KTIME_MAX;
 
@@ -1363,8 +1364,10 @@ static void tick_nohz_handler(struct clock_event_device *dev)
 		 * The clockevent device is not reprogrammed, so change the
 		 * clock event device to ONESHOT_STOPPED to avoid spurious
 		 * interrupts on devices which might not be truly one shot.
+		 * A coalesced broadcast wakeup can arrive before the
+		 * programmed event though, which must not get lost.
 		 */
-		tick_program_event(KTIME_MAX, 1);
+		tick_program_event(next > now ? next : KTIME_MAX, 1);
 		return;
 	}
 
@@ -182,17 +182,26 @@ EXPORT_SYMBOL(jiffies_64);
 /*
  * The resulting wheel size. If NOHZ is configured we allocate two
  * wheels so we have a separate storage for the deferrable timers.
+ * On SMP a third wheel holds the non-pinned ("global") timers, which
+ * an idle CPU may leave to another CPU of its migration group.
  */
 #define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
 
 #ifdef CONFIG_NO_HZ_COMMON
-# define NR_BASES	2
 # define BASE_STD	0
 # define BASE_DEF	1
+# ifdef CONFIG_SMP
+#  define NR_BASES	3
+#  define BASE_GLOBAL	2
+# else
+#  define NR_BASES	2
+#  define BASE_GLOBAL	BASE_STD
+# endif
 #else
 # define NR_BASES	1
 # define BASE_STD	0
 # define BASE_DEF	0
+# define BASE_GLOBAL	0
 #endif
 
 struct timer_base {
@@ -208,6 +217,7 @@ struct timer_base {
 	bool			next_expiry_recalc;
 	bool			is_idle;
 	bool			timers_pending;
+	bool			expiry_active;
 	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
 	struct hlist_head	vectors[WHEEL_SIZE];
 } ____cacheline_aligned;
@@ -268,8 +278,329 @@ static inline bool is_timers_nohz_active(void)
 {
 	return static_branch_unlikely(&timers_nohz_active);
 }
+
+#ifdef CONFIG_SMP
+/*
+ * Pull model timer migration.
+ *
+ * CPUs are split into migration groups of tmigr_group_size. A CPU that
+ * goes idle publishes the first expiry of its global base to its group
+ * and, as long as another CPU of the group is active, programs its own
+ * wakeup for pinned timers only. Active CPUs check the group's earliest
+ * published expiry from the tick and run the expired global timers of
+ * the idle CPUs on their behalf. The last CPU of a group to go idle
+ * keeps the whole group's earliest global expiry as its own wakeup.
+ *
+ * A CPU counts as active from timer_clear_idle() until its next
+ * get_next_timer_interrupt() decides to stop the tick, so an active CPU
+ * always runs the tick. nohz_full CPUs do not take part.
+ */
+struct tmigr_group {
+	raw_spinlock_t		lock;
+	unsigned int		first_cpu;
+	unsigned int		nr_cpus;
+	unsigned int		nr_active;
+	bool			has_expiry;
+	unsigned long		next_expiry;
+};
+
+struct tmigr_cpu {
+	struct tmigr_group	*group;
+	bool			idle;
+	bool			has_expiry;
+	unsigned long		next_expiry;
+};
+
+static DEFINE_PER_CPU(struct tmigr_cpu, tmigr_cpus);
+static DEFINE_STATIC_KEY_FALSE(tmigr_ready);
+static unsigned int tmigr_group_size = 8;
+
+static int __init tmigr_group_size_setup(char *str)
+{
+	unsigned int size;
+
+	if (kstrtouint(str, 0, &size) || !size)
+		return 0;
+	tmigr_group_size = size;
+	return 1;
+}
+__setup("tmigr_group_size=", tmigr_group_size_setup);
+
+static inline struct tmigr_group *tmigr_cpu_group(unsigned int cpu)
+{
+	if (!static_branch_unlikely(&tmigr_ready))
+		return NULL;
+	return per_cpu(tmigr_cpus, cpu).group;
+}
+
+/* Recompute the group's earliest global expiry over its idle CPUs. */
+static void tmigr_group_update(struct tmigr_group *grp)
+{
+	unsigned long next = 0;
+	unsigned int cpu;
+	bool pending = false;
+
+	lockdep_assert_held(&grp->lock);
+
+	for (cpu = grp->first_cpu; cpu < grp->first_cpu + grp->nr_cpus; cpu++) {
+		struct tmigr_cpu *tc = per_cpu_ptr(&tmigr_cpus, cpu);
+
+		if (!tc->idle || !tc->has_expiry)
+			continue;
+		if (!pending || time_before(tc->next_expiry, next))
+			next = tc->next_expiry;
+		pending = true;
+	}
+	WRITE_ONCE(grp->next_expiry, next);
+	WRITE_ONCE(grp->has_expiry, pending);
+}
+
+/*
+ * The local CPU is about to stop its tick with its global base expiring
+ * at @gnext (if @gpending). Returns true and the expiry this CPU has to
+ * wake up for in @next if it is the last active CPU of its group;
+ * returns false when the group takes care of the global timers.
+ */
+static bool tmigr_cpu_idle(struct tmigr_group *grp, unsigned long gnext,
+			   bool gpending, unsigned long *next)
+{
+	struct tmigr_cpu *tc = this_cpu_ptr(&tmigr_cpus);
+	bool ret;
+
+	raw_spin_lock(&grp->lock);
+	tc->next_expiry = gnext;
+	tc->has_expiry = gpending;
+	if (!tc->idle) {
+		tc->idle = true;
+		grp->nr_active--;
+	}
+	tmigr_group_update(grp);
+	ret = !grp->nr_active && grp->has_expiry;
+	*next = grp->next_expiry;
+	raw_spin_unlock(&grp->lock);
+
+	return ret;
+}
+
+/*
+ * Called from get_next_timer_interrupt() with both bases locked when the
+ * CPU is about to stop its tick. Hands the global timers over to the
+ * group and returns the next event once they are left out, unless this
+ * is the last active CPU of the group.
+ */
+static u64 tmigr_next_event(struct timer_base *base, unsigned long basej,
+			    u64 basem, unsigned long gnext, bool gpending,
+			    u64 expires)
+{
+	struct tmigr_group *grp = tmigr_cpu_group(base->cpu);
+	unsigned long nextevt = base->next_expiry;
+	bool pending = base->timers_pending;
+
+	if (!grp || !static_branch_likely(&timers_migration_enabled))
+		return expires;
+
+	if (tmigr_cpu_idle(grp, gnext, gpending, &gnext) &&
+	    (!pending || time_before(gnext, nextevt))) {
+		nextevt = gnext;
+		pending = true;
+	}
+
+	if (!pending)
+		return KTIME_MAX;
+	if (time_before_eq(nextevt, basej))
+		return basem;
+	return basem + (u64)(nextevt - basej) * TICK_NSEC;
+}
+
+static void tmigr_cpu_active(void)
+{
+	struct tmigr_group *grp = tmigr_cpu_group(smp_processor_id());
+	struct tmigr_cpu *tc = this_cpu_ptr(&tmigr_cpus);
+
+	if (!grp || !READ_ONCE(tc->idle))
+		return;
+
+	raw_spin_lock(&grp->lock);
+	if (tc->idle) {
+		tc->idle = false;
+		grp->nr_active++;
+		tmigr_group_update(grp);
+	}
+	raw_spin_unlock(&grp->lock);
+}
+
+static bool tmigr_remote_expired(void)
+{
+	struct tmigr_group *grp = tmigr_cpu_group(smp_processor_id());
+
+	return grp && READ_ONCE(grp->has_expiry) &&
+	       time_after_eq(jiffies, READ_ONCE(grp->next_expiry));
+}
+
+/*
+ * A timer queued on an idle CPU's global base while another CPU of the
+ * group is expiring that base (i.e. rearmed from its own callback) does
+ * not need to wake the CPU: tmigr_handle_remote() republishes the
+ * base's next expiry once it is done.
+ */
+static inline bool tmigr_handles_base(struct timer_base *base,
+				      struct timer_list *timer)
+{
+	return base->expiry_active && !(timer->flags & TIMER_PINNED) &&
+	       base == per_cpu_ptr(&timer_bases[BASE_GLOBAL], base->cpu) &&
+	       base->cpu != smp_processor_id() && tmigr_cpu_group(base->cpu);
+}
+
+static void __run_timers(struct timer_base *base);
+static unsigned long __next_timer_interrupt(struct timer_base *base);
+
+/* Run the expired global timers of the idle CPUs in our group. */
+static void tmigr_handle_remote(void)
+{
+	struct tmigr_group *grp;
+	unsigned int cpu;
+
+	if (!tmigr_remote_expired())
+		return;
+
+	grp = this_cpu_ptr(&tmigr_cpus)->group;
+	for (cpu = grp->first_cpu; cpu < grp->first_cpu + grp->nr_cpus; cpu++) {
+		struct tmigr_cpu *tc = per_cpu_ptr(&tmigr_cpus, cpu);
+		struct timer_base *base;
+
+		if (!cpu_online(cpu) ||
+		    !READ_ONCE(tc->idle) || !READ_ONCE(tc->has_expiry) ||
+		    time_before(jiffies, READ_ONCE(tc->next_expiry)))
+			continue;
+
+		base = per_cpu_ptr(&timer_bases[BASE_GLOBAL], cpu);
+		__run_timers(base);
+
+		/*
+		 * Republish under the base lock, which serializes against
+		 * the CPU publishing its own expiry on the way into idle.
+		 * A CPU which went offline meanwhile has been, or is about
+		 * to be, cleared by tmigr_cpu_dead() under the group lock;
+		 * don't bring its stale expiry back.
+		 */
+		raw_spin_lock_irq(&base->lock);
+		if (base->next_expiry_recalc)
+			base->next_expiry = __next_timer_interrupt(base);
+		raw_spin_lock(&grp->lock);
+		if (tc->idle && cpu_online(cpu)) {
+			tc->next_expiry = base->next_expiry;
+			tc->has_expiry = base->timers_pending;
+		}
+		tmigr_group_update(grp);
+		raw_spin_unlock(&grp->lock);
+		raw_spin_unlock_irq(&base->lock);
+	}
+}
+
+#ifdef CONFIG_HOTPLUG_CPU
+static void tmigr_cpu_dead(unsigned int cpu)
+{
+	struct tmigr_group *grp = tmigr_cpu_group(cpu);
+	struct tmigr_cpu *tc = per_cpu_ptr(&tmigr_cpus, cpu);
+	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_GLOBAL], cpu);
+
+	if (!grp)
+		return;
+
+	raw_spin_lock_irq(&grp->lock);
+	if (!tc->idle) {
+		tc->idle = true;
+		grp->nr_active--;
+	}
+	tc->has_expiry = false;
+	tmigr_group_update(grp);
+	raw_spin_unlock_irq(&grp->lock);
+
+	/*
+	 * Wait for a remote expiry which might still be running on the
+	 * dead CPU's global base and keep further ones out until the CPU
+	 * comes back; timers_prepare_cpu() clears expiry_active again.
+	 */
+	raw_spin_lock_irq(&base->lock);
+	while (base->expiry_active) {
+		raw_spin_unlock_irq(&base->lock);
+		cpu_relax();
+		raw_spin_lock_irq(&base->lock);
+	}
+	base->expiry_active = true;
+	raw_spin_unlock_irq(&base->lock);
+}
+#else
+static inline void tmigr_cpu_dead(unsigned int cpu) { }
+#endif
+
+static int __init tmigr_init(void)
+{
+	unsigned int ngroups = DIV_ROUND_UP(nr_cpu_ids, tmigr_group_size);
+	struct tmigr_group *groups;
+	unsigned int cpu, i;
+
+	if (tmigr_group_size < 2 || nr_cpu_ids < 2)
+		return 0;
+
+	groups = kcalloc(ngroups, sizeof(*groups), GFP_KERNEL);
+	if (!groups)
+		return -ENOMEM;
+
+	for (i = 0; i < ngroups; i++) {
+		raw_spin_lock_init(&groups[i].lock);
+		groups[i].first_cpu = i * tmigr_group_size;
+		groups[i].nr_cpus = min(tmigr_group_size,
+					nr_cpu_ids - groups[i].first_cpu);
+	}
+
+	/*
+	 * Everybody starts out idle, which at worst makes a CPU believe
+	 * it is the last one awake until it has been through idle once.
+	 */
+	for_each_possible_cpu(cpu) {
+		struct tmigr_cpu *tc = per_cpu_ptr(&tmigr_cpus, cpu);
+
+		tc->idle = true;
+		if (!tick_nohz_full_cpu(cpu))
+			tc->group = &groups[cpu / tmigr_group_size];
+	}
+
+	static_branch_enable(&tmigr_ready);
+	pr_info("timer migration: %u group(s) of up to %u CPUs\n",
+		ngroups, tmigr_group_size);
+	return 0;
+}
+early_initcall(tmigr_init);
+#else
+static inline void tmigr_cpu_active(void) { }
+static inline void tmigr_cpu_dead(unsigned int cpu) { }
+static inline bool tmigr_remote_expired(void) { return false; }
+static inline void tmigr_handle_remote(void) { }
+static inline u64 tmigr_next_event(struct timer_base *base,
+				   unsigned long basej, u64 basem,
+				   unsigned long gnext, bool gpending,
+				   u64 expires)
+{
+	return expires;
+}
+static inline bool tmigr_handles_base(struct timer_base *base,
+				      struct timer_list *timer)
+{
+	return false;
+}
+#endif /* CONFIG_SMP */
 #else
 static inline bool is_timers_nohz_active(void) { return false; }
+static inline void tmigr_cpu_active(void) { }
+static inline void tmigr_cpu_dead(unsigned int cpu) { }
+static inline bool tmigr_remote_expired(void) { return false; }
+static inline void tmigr_handle_remote(void) { }
+static inline bool tmigr_handles_base(struct timer_base *base,
+				      struct timer_list *timer)
+{
+	return false;
+}
 #endif /* NO_HZ_COMMON */
 
 static unsigned long round_jiffies_common(unsigned long j, int cpu,
@@ -566,7 +897,7 @@ trigger_dyntick_cpu(struct timer_base *base, struct timer_list *timer)
 	 * timer is not deferrable. If the other CPU is on the way to idle
 	 * then it can't set base->is_idle as we hold the base lock:
 	 */
-	if (base->is_idle)
+	if (base->is_idle && !tmigr_handles_base(base, timer))
 		wake_up_nohz_cpu(base->cpu);
 }
 
@@ -847,30 +1178,28 @@ static int detach_if_pending(struct timer_list *timer, struct timer_base *base,
 	return 1;
 }
 
-static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
+static inline unsigned int timer_base_index(u32 tflags)
 {
-	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_STD], cpu);
-
 	/*
 	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
-	 * to use the deferrable base.
+	 * to use the deferrable base. Non-pinned timers go to the global
+	 * base, which is BASE_STD unless NO_HZ_COMMON and SMP are set.
 	 */
 	if (IS_ENABLED(CONFIG_NO_HZ_COMMON) && (tflags & TIMER_DEFERRABLE))
-		base = per_cpu_ptr(&timer_bases[BASE_DEF], cpu);
-	return base;
+		return BASE_DEF;
+	if (!(tflags & TIMER_PINNED))
+		return BASE_GLOBAL;
+	return BASE_STD;
 }
 
-static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
+static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	return per_cpu_ptr(&timer_bases[timer_base_index(tflags)], cpu);
+}
 
-	/*
-	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
-	 * to use the deferrable base.
-	 */
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON) && (tflags & TIMER_DEFERRABLE))
-		base = this_cpu_ptr(&timer_bases[BASE_DEF]);
-	return base;
+static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
+{
+	return this_cpu_ptr(&timer_bases[timer_base_index(tflags)]);
 }
 
 static inline struct timer_base *get_timer_base(u32 tflags)
@@ -1176,6 +1505,10 @@ void add_timer_on(struct timer_list *timer, int cpu)
 
 	BUG_ON(timer_pending(timer) || !timer->function);
 
+	/* The caller wants this CPU, so keep the timer out of migration. */
+	if (!(timer->flags & TIMER_PINNED))
+		timer->flags |= TIMER_PINNED;
+
 	new_base = get_timer_cpu_base(timer->flags, cpu);
 
 	/*
@@ -1663,20 +1996,11 @@ static u64 cmp_next_hrtimer_event(u64 basem, u64 expires)
  * Returns the tick aligned clock monotonic time of the next pending
  * timer or KTIME_MAX if no timer is pending.
  */
-u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
+static unsigned long timer_base_next_expiry(struct timer_base *base,
+					    unsigned long basej)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
-	u64 expires = KTIME_MAX;
 	unsigned long nextevt;
 
-	/*
-	 * Pretend that there is no timer pending if the cpu is offline.
-	 * Possible pending timers will be migrated later to an active cpu.
-	 */
-	if (cpu_is_offline(smp_processor_id()))
-		return expires;
-
-	raw_spin_lock(&base->lock);
 	if (base->next_expiry_recalc)
 		base->next_expiry = __next_timer_interrupt(base);
 	nextevt = base->next_expiry;
@@ -1692,23 +2016,64 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 		else if (time_after(nextevt, base->clk))
 			base->clk = nextevt;
 	}
+	return nextevt;
+}
+
+u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
+{
+	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base_global = this_cpu_ptr(&timer_bases[BASE_GLOBAL]);
+	unsigned long nextevt, gnext = 0;
+	bool pending, gpending = false;
+	u64 expires = KTIME_MAX;
+
+	/*
+	 * Pretend that there is no timer pending if the cpu is offline.
+	 * Possible pending timers will be migrated later to an active cpu.
+	 */
+	if (cpu_is_offline(smp_processor_id()))
+		return expires;
+
+	raw_spin_lock(&base->lock);
+	if (base_global != base)
+		raw_spin_lock_nested(&base_global->lock, SINGLE_DEPTH_NESTING);
+
+	nextevt = timer_base_next_expiry(base, basej);
+	pending = base->timers_pending;
+	if (base_global != base) {
+		gnext = timer_base_next_expiry(base_global, basej);
+		gpending = base_global->timers_pending;
+		if (gpending && (!pending || time_before(gnext, nextevt))) {
+			nextevt = gnext;
+			pending = true;
+		}
+	}
 
 	if (time_before_eq(nextevt, basej)) {
 		expires = basem;
 		base->is_idle = false;
+		base_global->is_idle = false;
 	} else {
-		if (base->timers_pending)
+		if (pending)
 			expires = basem + (u64)(nextevt - basej) * TICK_NSEC;
 		/*
 		 * If we expect to sleep more than a tick, mark the base idle.
 		 * Also the tick is stopped so any added timer must forward
 		 * the base clk itself to keep granularity small. This idle
-		 * logic is only maintained for the BASE_STD base, deferrable
-		 * timers may still see large granularity skew (by design).
+		 * logic is only maintained for the BASE_STD and BASE_GLOBAL
+		 * bases, deferrable timers may still see large granularity
+		 * skew (by design).
 		 */
-		if ((expires - basem) > TICK_NSEC)
+		if ((expires - basem) > TICK_NSEC) {
 			base->is_idle = true;
+			base_global->is_idle = true;
+			expires = tmigr_next_event(base, basej, basem, gnext,
+						   gpending, expires);
+		}
 	}
+
+	if (base_global != base)
+		raw_spin_unlock(&base_global->lock);
 	raw_spin_unlock(&base->lock);
 
 	return cmp_next_hrtimer_event(basem, expires);
@@ -1721,15 +2086,16 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
  */
 void timer_clear_idle(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
-
 	/*
 	 * We do this unlocked. The worst outcome is a remote enqueue sending
 	 * a pointless IPI, but taking the lock would just make the window for
 	 * sending the IPI a few instructions smaller for the cost of taking
 	 * the lock in the exit from idle path.
 	 */
-	base->is_idle = false;
+	__this_cpu_write(timer_bases[BASE_STD].is_idle, false);
+	__this_cpu_write(timer_bases[BASE_GLOBAL].is_idle, false);
+
+	tmigr_cpu_active();
 }
 #endif
 
@@ -1748,6 +2114,17 @@ static inline void __run_timers(struct timer_base *base)
 	timer_base_lock_expiry(base);
 	raw_spin_lock_irq(&base->lock);
 
+	/*
+	 * The global base of an idle CPU may be expired by another CPU of
+	 * its migration group. Only one of them gets to do it.
+	 */
+	if (base->expiry_active) {
+		raw_spin_unlock_irq(&base->lock);
+		timer_base_unlock_expiry(base);
+		return;
+	}
+	base->expiry_active = true;
+
 	while (time_after_eq(jiffies, base->clk) &&
 	       time_after_eq(jiffies, base->next_expiry)) {
 		levels = collect_expired_timers(base, heads);
@@ -1766,6 +2143,7 @@ static inline void __run_timers(struct timer_base *base)
 		while (levels--)
 			expire_timers(base, heads + levels);
 	}
+	base->expiry_active = false;
 	raw_spin_unlock_irq(&base->lock);
 	timer_base_unlock_expiry(base);
 }
@@ -1778,8 +2156,12 @@ static __latent_entropy void run_timer_softirq(struct softirq_action *h)
 	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
 
 	__run_timers(base);
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON))
+	if (IS_ENABLED(CONFIG_NO_HZ_COMMON)) {
 		__run_timers(this_cpu_ptr(&timer_bases[BASE_DEF]));
+		if (BASE_GLOBAL != BASE_STD)
+			__run_timers(this_cpu_ptr(&timer_bases[BASE_GLOBAL]));
+		tmigr_handle_remote();
+	}
 }
 
 /*
@@ -1788,18 +2170,22 @@ static __latent_entropy void run_timer_softirq(struct softirq_action *h)
 static void run_local_timers(void)
 {
 	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	int i;
 
 	hrtimer_run_queues();
-	/* Raise the softirq only if required. */
-	if (time_before(jiffies, base->next_expiry)) {
-		if (!IS_ENABLED(CONFIG_NO_HZ_COMMON))
-			return;
-		/* CPU is awake, so check the deferrable base. */
-		base++;
-		if (time_before(jiffies, base->next_expiry))
+	/*
+	 * Raise the softirq only if required. The CPU is awake, so check
+	 * the deferrable and global bases as well as the global timers
+	 * its migration group has to run for idle CPUs.
+	 */
+	for (i = 0; i < NR_BASES; i++, base++) {
+		if (time_after_eq(jiffies, base->next_expiry)) {
+			raise_softirq(TIMER_SOFTIRQ);
 			return;
+		}
 	}
-	raise_softirq(TIMER_SOFTIRQ);
+	if (tmigr_remote_expired())
+		raise_softirq(TIMER_SOFTIRQ);
 }
 
 /*
@@ -1985,6 +2371,7 @@ int timers_prepare_cpu(unsigned int cpu)
 		base->next_expiry = base->clk + NEXT_TIMER_MAX_DELTA;
 		base->timers_pending = false;
 		base->is_idle = false;
+		base->expiry_active = false;
 	}
 	return 0;
 }
@@ -1997,6 +2384,8 @@ int timers_dead_cpu(unsigned int cpu)
 
 	BUG_ON(cpu_online(cpu));
 
+	tmigr_cpu_dead(cpu);
+
 	for (b = 0; b < NR_BASES; b++) {
 		old_base = per_cpu_ptr(&timer_bases[b], cpu);
 		new_base = get_cpu_ptr(&timer_bases[b]);
@@ -246,8 +246,19 @@ static void timer_list_show_tickdevices_header(struct seq_file *m)
 	SEQ_printf(m, "tick_broadcast_mask: %*pb\n",
 		   cpumask_pr_args(tick_get_broadcast_mask()));
 #ifdef CONFIG_TICK_ONESHOT
-	SEQ_printf(m, "tick_broadcast_oneshot_mask: %*pb\n",
-		   cpumask_pr_args(tick_get_broadcast_oneshot_mask()));
+	{
+		struct tick_broadcast_stats stats;
+
+		SEQ_printf(m, "tick_broadcast_oneshot_mask: %*pb\n",
+			   cpumask_pr_args(tick_get_broadcast_oneshot_mask()));
+		tick_broadcast_oneshot_get_stats(&stats);
+		SEQ_printf(m, "tick_broadcast_coalesce_slack: %u nsecs\n",
+			   stats.slack_ns);
+		SEQ_printf(m, "tick_broadcast_events: %lu\n", stats.events);
+		SEQ_printf(m, "tick_broadcast_woken: %lu\n", stats.woken);
+		SEQ_printf(m, "tick_broadcast_coalesced: %lu\n",
+			   stats.coalesced);
+	}
 #endif
 	SEQ_printf(m, "\n");
 #endif
@@ -256,7 +267,7 @@ static void timer_list_show_tickdevices_header(struct seq_file *m)
 
 static inline void timer_list_header(struct seq_file *m, u64 now)
 {
-	SEQ_printf(m, "Timer List Version: v0.9\n");
+	SEQ_printf(m, "Timer List Version: v0.10\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 	SEQ_printf(m, "\n");
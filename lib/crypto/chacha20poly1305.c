@@ -21,6 +21,12 @@
 
 #define CHACHA_KEY_WORDS	(CHACHA_KEY_SIZE / sizeof(u32))
 
+/*
+ * ChaCha20 and Poly1305 are run over the message in turns of this many bytes,
+ * so that each chunk is still in L1 when the second pass gets to it.
+ */
+#define CHACHA20POLY1305_CHUNK_SIZE	(16 * CHACHA_BLOCK_SIZE)
+
 static void chacha_load_key(u32 *k, const u8 *in)
 {
 	k[0] = get_unaligned_le32(in);
@@ -53,6 +59,26 @@ static void xchacha_init(u32 *chacha_state, const u8 *key, const u8 *nonce)
 	memzero_explicit(iv, sizeof(iv));
 }
 
+static void chacha20poly1305_crypt_chunked(u32 *chacha_state,
+					   struct poly1305_desc_ctx *poly1305_state,
+					   u8 *dst, const u8 *src, size_t len,
+					   bool encrypt)
+{
+	while (len) {
+		size_t l = min_t(size_t, len, CHACHA20POLY1305_CHUNK_SIZE);
+
+		if (!encrypt)
+			poly1305_update(poly1305_state, src, l);
+		chacha20_crypt(chacha_state, dst, src, l);
+		if (encrypt)
+			poly1305_update(poly1305_state, dst, l);
+
+		dst += l;
+		src += l;
+		len -= l;
+	}
+}
+
 static void
 __chacha20poly1305_encrypt(u8 *dst, const u8 *src, const size_t src_len,
 			   const u8 *ad, const size_t ad_len, u32 *chacha_state)
@@ -71,9 +97,8 @@ __chacha20poly1305_encrypt(u8 *dst, const u8 *src, const size_t src_len,
 	if (ad_len & 0xf)
 		poly1305_update(&poly1305_state, pad0, 0x10 - (ad_len & 0xf));
 
-	chacha20_crypt(chacha_state, dst, src, src_len);
-
-	poly1305_update(&poly1305_state, dst, src_len);
+	chacha20poly1305_crypt_chunked(chacha_state, &poly1305_state, dst, src,
+				       src_len, true);
 	if (src_len & 0xf)
 		poly1305_update(&poly1305_state, pad0, 0x10 - (src_len & 0xf));
 
@@ -146,7 +171,8 @@ __chacha20poly1305_decrypt(u8 *dst, const u8 *src, const size_t src_len,
 		poly1305_update(&poly1305_state, pad0, 0x10 - (ad_len & 0xf));
 
 	dst_len = src_len - POLY1305_DIGEST_SIZE;
-	poly1305_update(&poly1305_state, src, dst_len);
+	chacha20poly1305_crypt_chunked(chacha_state, &poly1305_state, dst, src,
+				       dst_len, false);
 	if (dst_len & 0xf)
 		poly1305_update(&poly1305_state, pad0, 0x10 - (dst_len & 0xf));
 
@@ -156,9 +182,10 @@ __chacha20poly1305_decrypt(u8 *dst, const u8 *src, const size_t src_len,
 
 	poly1305_final(&poly1305_state, b.mac);
 
+	/* never hand out plaintext that failed authentication */
 	ret = crypto_memneq(b.mac, src + dst_len, POLY1305_DIGEST_SIZE);
-	if (likely(!ret))
-		chacha20_crypt(chacha_state, dst, src, dst_len);
+	if (unlikely(ret))
+		memzero_explicit(dst, dst_len);
 
 	memzero_explicit(&b, sizeof(b));
 
@@ -100,6 +100,80 @@ module_param_named(deferrable, kfence_deferrable, bool, 0444);
 static bool kfence_check_on_panic __read_mostly;
 module_param_named(check_on_panic, kfence_check_on_panic, bool, 0444);
 
+/*
+ * If true, stretch the sample interval while the time spent in KFENCE exceeds
+ * kfence_budget_ppm, or while the pool is filling up.
+ */
+static bool kfence_adaptive __read_mostly;
+module_param_named(adaptive, kfence_adaptive, bool, 0644);
+
+/* CPU time budget in adaptive mode, in parts per million of one CPU. */
+static unsigned long kfence_budget_ppm __read_mostly = 1000;
+module_param_named(budget_ppm, kfence_budget_ppm, ulong, 0644);
+
+/* The adaptive sample interval is at most kfence_sample_interval << this. */
+#define KFENCE_ADAPTIVE_MAX_SHIFT 6
+
+/* Current adaptive back-off; only written by toggle_allocation_gate(). */
+static unsigned int kfence_interval_shift;
+
+/* Time spent toggling the static key and in guarded allocations and frees. */
+static atomic64_t kfence_overhead_ns = ATOMIC64_INIT(0);
+
+/*
+ * Caches never sampled by KFENCE, as a list of NUL-terminated names ended by an
+ * empty name. Updates alternate between the two buffers, and wait for readers
+ * of the previous list before returning, so the next update may reuse it.
+ */
+#define KFENCE_SKIP_CACHES_LEN 256
+static char kfence_skip_caches_buf[2][KFENCE_SKIP_CACHES_LEN];
+static char __rcu *kfence_skip_caches;
+
+static int param_set_skip_caches(const char *val, const struct kernel_param *kp)
+{
+	char *cur = rcu_dereference_protected(kfence_skip_caches, true);
+	char *buf = kfence_skip_caches_buf[cur == kfence_skip_caches_buf[0]];
+	size_t len = strcspn(val, "\n");
+	size_t i;
+
+	/* Leave room for the terminating empty name. */
+	if (len > KFENCE_SKIP_CACHES_LEN - 2)
+		return -EINVAL;
+
+	memcpy(buf, val, len);
+	for (i = 0; i < len; i++) {
+		if (buf[i] == ',')
+			buf[i] = '\0';
+	}
+	buf[len] = '\0';
+	buf[len + 1] = '\0';
+
+	rcu_assign_pointer(kfence_skip_caches, len ? buf : NULL);
+	if (system_state != SYSTEM_BOOTING)
+		synchronize_rcu();
+	return 0;
+}
+
+static int param_get_skip_caches(char *buffer, const struct kernel_param *kp)
+{
+	const char *name;
+	int len = 0;
+
+	rcu_read_lock();
+	name = rcu_dereference(kfence_skip_caches);
+	for (; name && *name; name += strlen(name) + 1)
+		len += scnprintf(buffer + len, PAGE_SIZE - len, "%s%s", len ? "," : "", name);
+	rcu_read_unlock();
+
+	return len + scnprintf(buffer + len, PAGE_SIZE - len, "\n");
+}
+
+static const struct kernel_param_ops skip_caches_param_ops = {
+	.set = param_set_skip_caches,
+	.get = param_get_skip_caches,
+};
+module_param_cb(skip_caches, &skip_caches_param_ops, NULL, 0644);
+
 /* The pool of pages used for guard pages and objects. */
 char *__kfence_pool __ro_after_init;
 EXPORT_SYMBOL(__kfence_pool); /* Export for test modules. */
@@ -160,6 +234,7 @@ enum kfence_counter_id {
 	KFENCE_COUNTER_SKIP_INCOMPAT,
 	KFENCE_COUNTER_SKIP_CAPACITY,
 	KFENCE_COUNTER_SKIP_COVERED,
+	KFENCE_COUNTER_SKIP_CACHE,
 	KFENCE_COUNTER_COUNT,
 };
 static atomic_long_t counters[KFENCE_COUNTER_COUNT];
@@ -172,6 +247,7 @@ static const char *const counter_names[] = {
 	[KFENCE_COUNTER_SKIP_INCOMPAT]	= "skipped allocations (incompatible)",
 	[KFENCE_COUNTER_SKIP_CAPACITY]	= "skipped allocations (capacity)",
 	[KFENCE_COUNTER_SKIP_COVERED]	= "skipped allocations (covered)",
+	[KFENCE_COUNTER_SKIP_CACHE]	= "skipped allocations (cache)",
 };
 static_assert(ARRAY_SIZE(counter_names) == KFENCE_COUNTER_COUNT);
 
@@ -184,6 +260,24 @@ static inline bool should_skip_covered(void)
 	return atomic_long_read(&counters[KFENCE_COUNTER_ALLOCATED]) > thresh;
 }
 
+static bool should_skip_cache(struct kmem_cache *s)
+{
+	const char *name;
+	bool ret = false;
+
+	rcu_read_lock();
+	name = rcu_dereference(kfence_skip_caches);
+	for (; name && *name; name += strlen(name) + 1) {
+		if (!strcmp(name, s->name)) {
+			ret = true;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
 static u32 get_alloc_stack_hash(unsigned long *stack_entries, size_t num_entries)
 {
 	num_entries = min(num_entries, UNIQUE_ALLOC_STACK_DEPTH);
@@ -628,6 +722,11 @@ static int stats_show(struct seq_file *seq, void *v)
 	seq_printf(seq, "enabled: %i\n", READ_ONCE(kfence_enabled));
 	for (i = 0; i < KFENCE_COUNTER_COUNT; i++)
 		seq_printf(seq, "%s: %ld\n", counter_names[i], atomic_long_read(&counters[i]));
+	seq_printf(seq, "adaptive: %i\n", READ_ONCE(kfence_adaptive));
+	seq_printf(seq, "current sample interval (ms): %lu\n",
+		   READ_ONCE(kfence_sample_interval) << READ_ONCE(kfence_interval_shift));
+	seq_printf(seq, "total overhead (us): %llu\n",
+		   div_u64(atomic64_read(&kfence_overhead_ns), NSEC_PER_USEC));
 
 	return 0;
 }
@@ -744,6 +843,36 @@ static void wake_up_kfence_timer(struct irq_work *work)
 static DEFINE_IRQ_WORK(wake_up_kfence_timer_work, wake_up_kfence_timer);
 #endif
 
+/*
+ * In adaptive mode, back off exponentially while the overhead since the last
+ * sample exceeds the budget or the pool is past kfence_skip_covered_thresh, and
+ * come back once the overhead drops below half of the budget.
+ */
+static unsigned long next_sample_interval(void)
+{
+	static u64 last_time, last_overhead;
+	u64 now = local_clock();
+	u64 overhead = atomic64_read(&kfence_overhead_ns);
+	u64 elapsed = now - last_time;
+	u64 spent = overhead - last_overhead;
+	/* Both sides in ns * 10^6, to compare against the budget in ppm. */
+	u64 budget = elapsed * READ_ONCE(kfence_budget_ppm);
+	unsigned int shift = kfence_interval_shift;
+
+	last_time = now;
+	last_overhead = overhead;
+
+	if (!READ_ONCE(kfence_adaptive))
+		shift = 0;
+	else if (spent * 1000000 > budget || should_skip_covered())
+		shift = min_t(unsigned int, shift + 1, KFENCE_ADAPTIVE_MAX_SHIFT);
+	else if (shift && spent * 2 * 1000000 < budget)
+		shift--;
+
+	WRITE_ONCE(kfence_interval_shift, shift);
+	return kfence_sample_interval << shift;
+}
+
 /*
  * Set up delayed work, which will enable and disable the static key. We need to
  * use a work queue (rather than a simple timer), since enabling and disabling a
@@ -757,13 +886,19 @@ static DEFINE_IRQ_WORK(wake_up_kfence_timer_work, wake_up_kfence_timer);
  */
 static void toggle_allocation_gate(struct work_struct *work)
 {
+#ifdef CONFIG_KFENCE_STATIC_KEYS
+	u64 start;
+#endif
+
 	if (!READ_ONCE(kfence_enabled))
 		return;
 
 	atomic_set(&kfence_allocation_gate, 0);
 #ifdef CONFIG_KFENCE_STATIC_KEYS
 	/* Enable static key, and await allocation to happen. */
+	start = local_clock();
 	static_branch_enable(&kfence_allocation_key);
+	atomic64_add(local_clock() - start, &kfence_overhead_ns);
 
 	if (sysctl_hung_task_timeout_secs) {
 		/*
@@ -777,10 +912,12 @@ static void toggle_allocation_gate(struct work_struct *work)
 	}
 
 	/* Disable static key and reset timer. */
+	start = local_clock();
 	static_branch_disable(&kfence_allocation_key);
+	atomic64_add(local_clock() - start, &kfence_overhead_ns);
 #endif
 	queue_delayed_work(system_unbound_wq, &kfence_timer,
-			   msecs_to_jiffies(kfence_sample_interval));
+			   msecs_to_jiffies(next_sample_interval()));
 }
 
 /* === Public interface ===================================================== */
@@ -891,6 +1028,8 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 	unsigned long stack_entries[KFENCE_STACK_DEPTH];
 	size_t num_stack_entries;
 	u32 alloc_stack_hash;
+	void *ret;
+	u64 start;
 
 	/*
 	 * Perform size check before switching kfence_allocation_gate, so that
@@ -913,6 +1052,12 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 		return NULL;
 	}
 
+	/* Like the checks above, don't use up the sample on a skipped cache. */
+	if (unlikely(rcu_access_pointer(kfence_skip_caches)) && should_skip_cache(s)) {
+		atomic_long_inc(&counters[KFENCE_COUNTER_SKIP_CACHE]);
+		return NULL;
+	}
+
 	if (atomic_inc_return(&kfence_allocation_gate) > 1)
 		return NULL;
 #ifdef CONFIG_KFENCE_STATIC_KEYS
@@ -932,6 +1077,7 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 	if (!READ_ONCE(kfence_enabled))
 		return NULL;
 
+	start = local_clock();
 	num_stack_entries = stack_trace_save(stack_entries, KFENCE_STACK_DEPTH, 0);
 
 	/*
@@ -946,11 +1092,14 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 	alloc_stack_hash = get_alloc_stack_hash(stack_entries, num_stack_entries);
 	if (should_skip_covered() && alloc_covered_contains(alloc_stack_hash)) {
 		atomic_long_inc(&counters[KFENCE_COUNTER_SKIP_COVERED]);
-		return NULL;
+		ret = NULL;
+	} else {
+		ret = kfence_guarded_alloc(s, size, flags, stack_entries, num_stack_entries,
+					   alloc_stack_hash);
 	}
 
-	return kfence_guarded_alloc(s, size, flags, stack_entries, num_stack_entries,
-				    alloc_stack_hash);
+	atomic64_add(local_clock() - start, &kfence_overhead_ns);
+	return ret;
 }
 
 size_t kfence_ksize(const void *addr)
@@ -988,10 +1137,14 @@ void __kfence_free(void *addr)
 	 * objects once it has been freed. meta->cache may be NULL if the cache
 	 * was destroyed.
 	 */
-	if (unlikely(meta->cache && (meta->cache->flags & SLAB_TYPESAFE_BY_RCU)))
+	if (unlikely(meta->cache && (meta->cache->flags & SLAB_TYPESAFE_BY_RCU))) {
 		call_rcu(&meta->rcu_head, rcu_guarded_free);
-	else
+	} else {
+		u64 start = local_clock();
+
 		kfence_guarded_free(addr, meta, false);
+		atomic64_add(local_clock() - start, &kfence_overhead_ns);
+	}
 }
 
 bool kfence_handle_page_fault(unsigned long addr, bool is_write, struct pt_regs *regs)
@@ -1818,12 +1818,36 @@ static void rfcomm_process_connect(struct rfcomm_session *s)
 	}
 }
 
+/* Piggyback credits on a queued UIH data frame instead of sending them in a
+ * frame of their own. Returns false if the frame can't carry them.
+ */
+static bool rfcomm_uih_add_credits(struct rfcomm_dlc *d, struct sk_buff *skb,
+				   u8 credits)
+{
+	int hlen = (skb->data[2] & 0x01) ? 3 : 4;
+	struct rfcomm_hdr *hdr;
+
+	if (__test_pf(skb->data[1]) || skb_headroom(skb) < 1 ||
+	    skb->len + 1 > d->session->mtu + 5)
+		return false;
+
+	hdr = skb_push(skb, 1);
+	memmove(skb->data, skb->data + 1, hlen);
+	skb->data[hlen] = credits;
+
+	hdr->ctrl = __ctrl(RFCOMM_UIH, 1);
+	skb->data[skb->len - 1] = __fcs((void *) hdr);
+
+	return true;
+}
+
 /* Send data queued for the DLC.
  * Return number of frames left in the queue.
  */
 static int rfcomm_process_tx(struct rfcomm_dlc *d)
 {
 	struct sk_buff *skb;
+	u8 credits = 0;
 	int err;
 
 	BT_DBG("dlc %p state %ld cfc %d rx_credits %d tx_credits %d",
@@ -1838,7 +1862,7 @@ static int rfcomm_process_tx(struct rfcomm_dlc *d)
 		 * Give them some credits */
 		if (!test_bit(RFCOMM_RX_THROTTLED, &d->flags) &&
 				d->rx_credits <= (d->cfc >> 2)) {
-			rfcomm_send_credits(d->session, d->addr, d->cfc - d->rx_credits);
+			credits = d->cfc - d->rx_credits;
 			d->rx_credits = d->cfc;
 		}
 	} else {
@@ -1848,9 +1872,14 @@ static int rfcomm_process_tx(struct rfcomm_dlc *d)
 	}
 
 	if (test_bit(RFCOMM_TX_THROTTLED, &d->flags))
-		return skb_queue_len(&d->tx_queue);
+		goto send_credits;
 
 	while (d->tx_credits && (skb = skb_dequeue(&d->tx_queue))) {
+		/* Once added the credits stay with the frame, even if it
+		 * has to be requeued below. */
+		if (credits && rfcomm_uih_add_credits(d, skb, credits))
+			credits = 0;
+
 		err = rfcomm_send_frame(d->session, skb->data, skb->len);
 		if (err < 0) {
 			skb_queue_head(&d->tx_queue, skb);
@@ -1866,6 +1895,11 @@ static int rfcomm_process_tx(struct rfcomm_dlc *d)
 		set_bit(RFCOMM_TX_THROTTLED, &d->flags);
 	}
 
+send_credits:
+	/* No data frame went out to carry them */
+	if (credits)
+		rfcomm_send_credits(d->session, d->addr, credits);
+
 	return skb_queue_len(&d->tx_queue);
 }
 
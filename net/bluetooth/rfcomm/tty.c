@@ -26,6 +26,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/hrtimer.h>
 
 #include <linux/tty.h>
 #include <linux/tty_driver.h>
@@ -43,6 +44,11 @@
 static DEFINE_MUTEX(rfcomm_ioctl_mutex);
 static struct tty_driver *rfcomm_tty_driver;
 
+/* Upper bound a partially filled frame is held back to coalesce writes */
+static unsigned int tx_coalesce_us;
+module_param(tx_coalesce_us, uint, 0644);
+MODULE_PARM_DESC(tx_coalesce_us, "Delay in us to coalesce small TTY writes into one frame (0 = off)");
+
 struct rfcomm_dev {
 	struct tty_port		port;
 	struct list_head	list;
@@ -67,6 +73,11 @@ struct rfcomm_dev {
 	atomic_t		wmem_alloc;
 
 	struct sk_buff_head	pending;
+
+	/* Frame being filled by coalesced writes, see tx_coalesce_us */
+	spinlock_t		tx_lock;
+	struct sk_buff		*tx_skb;
+	struct hrtimer		tx_timer;
 };
 
 static LIST_HEAD(rfcomm_dev_list);
@@ -75,6 +86,7 @@ static DEFINE_MUTEX(rfcomm_dev_lock);
 static void rfcomm_dev_data_ready(struct rfcomm_dlc *dlc, struct sk_buff *skb);
 static void rfcomm_dev_state_change(struct rfcomm_dlc *dlc, int err);
 static void rfcomm_dev_modem_status(struct rfcomm_dlc *dlc, u8 v24_sig);
+static enum hrtimer_restart rfcomm_dev_tx_timeout(struct hrtimer *timer);
 
 /* ---- Device functions ---- */
 
@@ -275,6 +287,10 @@ static struct rfcomm_dev *__rfcomm_dev_add(struct rfcomm_dev_req *req,
 
 	skb_queue_head_init(&dev->pending);
 
+	spin_lock_init(&dev->tx_lock);
+	hrtimer_init(&dev->tx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+	dev->tx_timer.function = rfcomm_dev_tx_timeout;
+
 	rfcomm_dlc_lock(dlc);
 
 	if (req->flags & (1 << RFCOMM_REUSE_DLC)) {
@@ -385,6 +401,93 @@ static struct sk_buff *rfcomm_wmalloc(struct rfcomm_dev *dev, unsigned long size
 	return skb;
 }
 
+/* Queue the partially filled frame, if any. Called with dev->tx_lock held, so
+ * that frames are queued in the order they were filled. */
+static void __rfcomm_dev_tx_flush(struct rfcomm_dev *dev)
+{
+	struct sk_buff *skb = dev->tx_skb;
+
+	if (!skb)
+		return;
+
+	dev->tx_skb = NULL;
+	rfcomm_dlc_send_noerror(dev->dlc, skb);
+}
+
+static void rfcomm_dev_tx_flush(struct rfcomm_dev *dev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->tx_lock, flags);
+	__rfcomm_dev_tx_flush(dev);
+	spin_unlock_irqrestore(&dev->tx_lock, flags);
+}
+
+static void rfcomm_dev_tx_discard(struct rfcomm_dev *dev)
+{
+	struct sk_buff *skb;
+	unsigned long flags;
+
+	hrtimer_cancel(&dev->tx_timer);
+
+	spin_lock_irqsave(&dev->tx_lock, flags);
+	skb = dev->tx_skb;
+	dev->tx_skb = NULL;
+	spin_unlock_irqrestore(&dev->tx_lock, flags);
+
+	kfree_skb(skb);
+}
+
+static enum hrtimer_restart rfcomm_dev_tx_timeout(struct hrtimer *timer)
+{
+	struct rfcomm_dev *dev = container_of(timer, struct rfcomm_dev, tx_timer);
+
+	rfcomm_dev_tx_flush(dev);
+
+	return HRTIMER_NORESTART;
+}
+
+/* Append to the frame being filled, queueing it once it reaches the MTU.
+ * Returns the number of bytes taken, or -ENOMEM. */
+static int rfcomm_dev_tx_coalesce(struct rfcomm_dev *dev,
+				  const unsigned char *buf, int count,
+				  unsigned int delay_us)
+{
+	struct rfcomm_dlc *dlc = dev->dlc;
+	struct sk_buff *skb;
+	unsigned long flags;
+	int room, size;
+
+	spin_lock_irqsave(&dev->tx_lock, flags);
+
+	skb = dev->tx_skb;
+	if (!skb) {
+		skb = rfcomm_wmalloc(dev, dlc->mtu + RFCOMM_SKB_RESERVE, GFP_ATOMIC);
+		if (!skb) {
+			spin_unlock_irqrestore(&dev->tx_lock, flags);
+			return -ENOMEM;
+		}
+
+		skb_reserve(skb, RFCOMM_SKB_HEAD_RESERVE);
+		dev->tx_skb = skb;
+		hrtimer_start(&dev->tx_timer, us_to_ktime(delay_us),
+			      HRTIMER_MODE_REL_SOFT);
+	}
+
+	/* The MTU may have changed since the frame was allocated */
+	room = min_t(int, dlc->mtu - skb->len,
+		     skb_tailroom(skb) - RFCOMM_SKB_TAIL_RESERVE);
+	size = clamp(room, 0, count);
+	skb_put_data(skb, buf, size);
+
+	if (room <= size)
+		__rfcomm_dev_tx_flush(dev);
+
+	spin_unlock_irqrestore(&dev->tx_lock, flags);
+
+	return size;
+}
+
 /* ---- Device IOCTLs ---- */
 
 #define NOCAP_FLAGS ((1 << RFCOMM_REUSE_DLC) | (1 << RFCOMM_RELEASE_ONHUP))
@@ -697,6 +800,7 @@ static void rfcomm_tty_cleanup(struct tty_struct *tty)
 	 * purge the dlc->tx_queue to avoid circular dependencies
 	 * between dev and dlc
 	 */
+	rfcomm_dev_tx_discard(dev);
 	skb_queue_purge(&dev->dlc->tx_queue);
 
 	tty_port_put(&dev->port);
@@ -784,11 +888,29 @@ static int rfcomm_tty_write(struct tty_struct *tty, const unsigned char *buf, in
 {
 	struct rfcomm_dev *dev = (struct rfcomm_dev *) tty->driver_data;
 	struct rfcomm_dlc *dlc = dev->dlc;
+	unsigned int delay_us = READ_ONCE(tx_coalesce_us);
 	struct sk_buff *skb;
 	int sent = 0, size;
 
 	BT_DBG("tty %p count %d", tty, count);
 
+	if (delay_us) {
+		while (count) {
+			size = rfcomm_dev_tx_coalesce(dev, buf + sent, count,
+						      delay_us);
+			if (size < 0)
+				break;
+
+			sent  += size;
+			count -= size;
+		}
+
+		return sent;
+	}
+
+	/* Coalescing may just have been turned off */
+	rfcomm_dev_tx_flush(dev);
+
 	while (count) {
 		size = min_t(uint, count, dlc->mtu);
 
@@ -1024,6 +1146,9 @@ static unsigned int rfcomm_tty_chars_in_buffer(struct tty_struct *tty)
 	if (!skb_queue_empty(&dev->dlc->tx_queue))
 		return dev->dlc->mtu;
 
+	if (READ_ONCE(dev->tx_skb))
+		return dev->dlc->mtu;
+
 	return 0;
 }
 
@@ -1036,6 +1161,7 @@ static void rfcomm_tty_flush_buffer(struct tty_struct *tty)
 	if (!dev || !dev->dlc)
 		return;
 
+	rfcomm_dev_tx_discard(dev);
 	skb_queue_purge(&dev->dlc->tx_queue);
 	tty_wakeup(tty);
 }
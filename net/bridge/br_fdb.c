@@ -56,12 +56,22 @@ void br_fdb_fini(void)
 
 int br_fdb_hash_init(struct net_bridge *br)
 {
-	return rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	int err;
+
+	br->fdb_cache = alloc_percpu(struct br_fdb_cache);
+	if (!br->fdb_cache)
+		return -ENOMEM;
+
+	err = rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	if (err)
+		free_percpu(br->fdb_cache);
+	return err;
 }
 
 void br_fdb_hash_fini(struct net_bridge *br)
 {
 	rhashtable_destroy(&br->fdb_hash_tbl);
+	free_percpu(br->fdb_cache);
 }
 
 /* if topology_changing then use forward_delay (default 15 sec)
@@ -101,6 +111,45 @@ static struct net_bridge_fdb_entry *fdb_find_rcu(struct rhashtable *tbl,
 	return rhashtable_lookup(tbl, &key, br_fdb_rht_params);
 }
 
+static unsigned int fdb_cache_slot(const unsigned char *addr, __u16 vid)
+{
+	return (addr[4] ^ addr[5] ^ vid) & (BR_FDB_CACHE_SIZE - 1);
+}
+
+/* Like fdb_find_rcu() but tries this cpu's recent hits first. Only used
+ * with BHs off, which keeps us on this cpu for the per-cpu access.
+ */
+static struct net_bridge_fdb_entry *fdb_find_cached(struct net_bridge *br,
+						    const unsigned char *addr,
+						    __u16 vid)
+{
+	struct net_bridge_fdb_entry *fdb;
+	struct br_fdb_cache *cache;
+	unsigned int slot;
+	unsigned long gen;
+
+	if (unlikely(!in_softirq()))
+		return fdb_find_rcu(&br->fdb_hash_tbl, addr, vid);
+
+	cache = this_cpu_ptr(br->fdb_cache);
+	slot = fdb_cache_slot(addr, vid);
+	/* pairs with the release in fdb_delete() */
+	gen = smp_load_acquire(&br->fdb_gen);
+
+	fdb = cache->ent[slot];
+	if (fdb && cache->gen[slot] == gen && fdb->key.vlan_id == vid &&
+	    ether_addr_equal(fdb->key.addr.addr, addr))
+		return fdb;
+
+	fdb = fdb_find_rcu(&br->fdb_hash_tbl, addr, vid);
+	if (fdb) {
+		cache->ent[slot] = fdb;
+		cache->gen[slot] = gen;
+	}
+
+	return fdb;
+}
+
 /* requires bridge hash_lock */
 static struct net_bridge_fdb_entry *br_fdb_find(struct net_bridge *br,
 						const unsigned char *addr,
@@ -145,7 +194,7 @@ struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
 					     const unsigned char *addr,
 					     __u16 vid)
 {
-	return fdb_find_rcu(&br->fdb_hash_tbl, addr, vid);
+	return fdb_find_cached(br, addr, vid);
 }
 
 /* When a static FDB entry is added, the mac address from the entry is
@@ -204,6 +253,8 @@ static void fdb_delete(struct net_bridge *br, struct net_bridge_fdb_entry *f,
 	hlist_del_init_rcu(&f->fdb_node);
 	rhashtable_remove_fast(&br->fdb_hash_tbl, &f->rhnode,
 			       br_fdb_rht_params);
+	/* invalidate cached hits before the entry can be freed */
+	smp_store_release(&br->fdb_gen, br->fdb_gen + 1);
 	fdb_notify(br, f, RTM_DELNEIGH, swdev_notify);
 	call_rcu(&f->rcu, fdb_rcu_free);
 }
@@ -588,7 +639,7 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 	if (hold_time(br) == 0)
 		return;
 
-	fdb = fdb_find_rcu(&br->fdb_hash_tbl, addr, vid);
+	fdb = fdb_find_cached(br, addr, vid);
 	if (likely(fdb)) {
 		/* attempt to update an entry for a local interface */
 		if (unlikely(test_bit(BR_FDB_LOCAL, &fdb->flags))) {
@@ -599,7 +650,8 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 			unsigned long now = jiffies;
 			bool fdb_modified = false;
 
-			if (now != fdb->updated) {
+			if (time_after_eq(now, READ_ONCE(fdb->updated) +
+						BR_FDB_REFRESH_INTERVAL)) {
 				fdb->updated = now;
 				fdb_modified = __fdb_mark_active(fdb);
 			}
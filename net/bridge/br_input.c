@@ -172,7 +172,8 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 		if (test_bit(BR_FDB_LOCAL, &dst->flags))
 			return br_pass_frame_up(skb, false);
 
-		if (now != dst->used)
+		if (time_after_eq(now, READ_ONCE(dst->used) +
+					  BR_FDB_REFRESH_INTERVAL))
 			dst->used = now;
 		br_forward(dst->dst, skb, local_rcv, false);
 	} else {
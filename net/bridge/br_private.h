@@ -237,6 +237,14 @@ struct net_bridge_vlan_group {
 	u16				num_vlans;
 	u16				pvid;
 	u8				pvid_state;
+	/* Data path shortcuts, kept in sync with the entries under RTNL:
+	 * vlan_map has the vids that are usable for filtering, fwd_map the
+	 * subset in forwarding state and untagged_map the subset that
+	 * egresses untagged.
+	 */
+	DECLARE_BITMAP(vlan_map, VLAN_N_VID);
+	DECLARE_BITMAP(fwd_map, VLAN_N_VID);
+	DECLARE_BITMAP(untagged_map, VLAN_N_VID);
 };
 
 /* bridge fdb flags */
@@ -271,6 +279,22 @@ struct net_bridge_fdb_entry {
 	struct rcu_head			rcu;
 };
 
+/* The data path refreshes updated/used at most this often, so that hot
+ * entries are not rewritten, and their cacheline bounced, on every frame.
+ */
+#define BR_FDB_REFRESH_INTERVAL	(HZ / 10)
+
+/* Per-cpu cache of recent fdb hits, direct mapped by address. A slot is
+ * only valid while its generation matches net_bridge::fdb_gen, which is
+ * bumped whenever an entry is deleted.
+ */
+#define BR_FDB_CACHE_SIZE	4
+
+struct br_fdb_cache {
+	struct net_bridge_fdb_entry	*ent[BR_FDB_CACHE_SIZE];
+	unsigned long			gen[BR_FDB_CACHE_SIZE];
+};
+
 #define MDB_PG_FLAGS_PERMANENT	BIT(0)
 #define MDB_PG_FLAGS_OFFLOAD	BIT(1)
 #define MDB_PG_FLAGS_FAST_LEAVE	BIT(2)
@@ -460,6 +484,8 @@ struct net_bridge {
 #endif
 
 	struct rhashtable		fdb_hash_tbl;
+	struct br_fdb_cache __percpu	*fdb_cache;
+	unsigned long			fdb_gen;
 	struct list_head		port_list;
 #if IS_ENABLED(CONFIG_BRIDGE_NETFILTER)
 	union {
@@ -1747,6 +1773,8 @@ bool br_vlan_global_opts_can_enter_range(const struct net_bridge_vlan *v_curr,
 					 const struct net_bridge_vlan *r_end);
 bool br_vlan_global_opts_fill(struct sk_buff *skb, u16 vid, u16 vid_range,
 			      const struct net_bridge_vlan *v_opts);
+void br_vlan_map_update(struct net_bridge_vlan_group *vg,
+			const struct net_bridge_vlan *v, bool present);
 
 /* vlan state manipulation helpers using *_ONCE to annotate lock-free access */
 static inline u8 br_vlan_get_state(const struct net_bridge_vlan *v)
@@ -58,6 +58,21 @@ static bool __vlan_delete_pvid(struct net_bridge_vlan_group *vg, u16 vid)
 	return true;
 }
 
+/* Must be called under RTNL whenever the usability, state or untagged flag
+ * of v changes, present is false when v is being removed from vg.
+ */
+void br_vlan_map_update(struct net_bridge_vlan_group *vg,
+			const struct net_bridge_vlan *v, bool present)
+{
+	bool use = present && br_vlan_should_use(v);
+
+	assign_bit(v->vid, vg->vlan_map, use);
+	assign_bit(v->vid, vg->fwd_map,
+		   use && br_vlan_get_state(v) == BR_STATE_FORWARDING);
+	assign_bit(v->vid, vg->untagged_map,
+		   use && (v->flags & BRIDGE_VLAN_INFO_UNTAGGED));
+}
+
 /* return true if anything changed, false otherwise */
 static bool __vlan_add_flags(struct net_bridge_vlan *v, u16 flags)
 {
@@ -80,6 +95,8 @@ static bool __vlan_add_flags(struct net_bridge_vlan *v, u16 flags)
 	else
 		v->flags &= ~BRIDGE_VLAN_INFO_UNTAGGED;
 
+	br_vlan_map_update(vg, v, true);
+
 	return ret || !!(old_flags ^ v->flags);
 }
 
@@ -373,6 +390,7 @@ static int __vlan_del(struct net_bridge_vlan *v)
 		v->flags &= ~BRIDGE_VLAN_INFO_BRENTRY;
 		vg->num_vlans--;
 	}
+	br_vlan_map_update(vg, v, masterv == v);
 
 	if (masterv != v) {
 		vlan_tunnel_info_del(vg, v);
@@ -443,6 +461,17 @@ struct sk_buff *br_handle_vlan(struct net_bridge *br,
 	 * send untagged; otherwise, send tagged.
 	 */
 	br_vlan_get_tag(skb, &vid);
+
+	/* Without per-vlan stats or tunnels the entry itself isn't needed */
+	if (!br_opt_get(br, BROPT_VLAN_STATS_ENABLED) &&
+	    !(p && (p->flags & BR_VLAN_TUNNEL)) &&
+	    vg && test_bit(vid, vg->vlan_map)) {
+		if (test_bit(vid, vg->untagged_map) &&
+		    !br_switchdev_frame_uses_tx_fwd_offload(skb))
+			__vlan_hwaccel_clear_tag(skb);
+		goto out;
+	}
+
 	v = br_vlan_find(vg, vid);
 	/* Vlan entry must be configured at this point.  The
 	 * only exception is the bridge is set in promisc mode and the
@@ -566,6 +595,16 @@ static bool __allowed_ingress(const struct net_bridge *br,
 			return true;
 		}
 	}
+
+	if (!vg || !test_bit(*vid, vg->vlan_map))
+		goto drop;
+
+	/* Forwarding vlan and nothing that needs the entry, skip the lookup */
+	if (test_bit(*vid, vg->fwd_map) &&
+	    !br_opt_get(br, BROPT_MCAST_VLAN_SNOOPING_ENABLED) &&
+	    !br_opt_get(br, BROPT_VLAN_STATS_ENABLED))
+		return true;
+
 	v = br_vlan_find(vg, *vid);
 	if (!v || !br_vlan_should_use(v))
 		goto drop;
@@ -614,20 +653,16 @@ bool br_allowed_ingress(const struct net_bridge *br,
 bool br_allowed_egress(struct net_bridge_vlan_group *vg,
 		       const struct sk_buff *skb)
 {
-	const struct net_bridge_vlan *v;
 	u16 vid;
 
 	/* If this packet was not filtered at input, let it pass */
 	if (!BR_INPUT_SKB_CB(skb)->vlan_filtered)
 		return true;
 
+	/* Only forwarding vlans may egress, that is exactly fwd_map */
 	br_vlan_get_tag(skb, &vid);
-	v = br_vlan_find(vg, vid);
-	if (v && br_vlan_should_use(v) &&
-	    br_vlan_state_allowed(br_vlan_get_state(v), false))
-		return true;
 
-	return false;
+	return vg && test_bit(vid, vg->fwd_map);
 }
 
 /* Called under RCU */
@@ -657,6 +692,9 @@ bool br_should_learn(struct net_bridge_port *p, struct sk_buff *skb, u16 *vid)
 		return true;
 	}
 
+	if (test_bit(*vid, vg->fwd_map))
+		return true;
+
 	v = br_vlan_find(vg, *vid);
 	if (v && br_vlan_state_allowed(br_vlan_get_state(v), true))
 		return true;
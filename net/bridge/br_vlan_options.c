@@ -106,6 +106,7 @@ static int br_vlan_modify_state(struct net_bridge_vlan_group *vg,
 		br_vlan_set_pvid_state(vg, state);
 
 	br_vlan_set_state(v, state);
+	br_vlan_map_update(vg, v, true);
 	*changed = true;
 
 	return 0;
@@ -44,6 +44,8 @@
 #include <linux/types.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/percpu.h>
 #include <linux/spinlock.h>
 #include <linux/rcupdate.h>
 #include <linux/rculist.h>
@@ -69,6 +71,7 @@ MODULE_ALIAS(CAN_GW_NAME);
 #define CGW_MIN_HOPS 1
 #define CGW_MAX_HOPS 6
 #define CGW_DEFAULT_HOPS 1
+#define CGW_GRP_HASH_BITS 6
 
 static unsigned int max_hops __read_mostly = CGW_DEFAULT_HOPS;
 module_param(max_hops, uint, 0444);
@@ -123,13 +126,35 @@ struct can_can_gw {
 	int dst_idx;
 };
 
+/* per-CPU statistics of a CAN gateway job */
+struct cgw_job_stats {
+	u32 handled_frames;
+	u32 dropped_frames;
+	u32 deleted_frames;
+};
+
+/* Jobs whose filter would land in the linearly walked can_id/mask list of
+ * af_can are grouped by source device and filter mask. A group registers
+ * a single receiver and finds its jobs by hashing can_id & mask, so the
+ * receive cost scales with the number of distinct masks, not of jobs.
+ */
+struct cgw_grp {
+	struct hlist_node list;
+	struct rcu_head rcu;
+	struct net_device *dev;
+	canid_t mask;
+	unsigned int count;
+	DECLARE_HASHTABLE(jobs, CGW_GRP_HASH_BITS);
+};
+
 /* list entry for CAN gateways jobs */
 struct cgw_job {
 	struct hlist_node list;
 	struct rcu_head rcu;
-	u32 handled_frames;
-	u32 dropped_frames;
-	u32 deleted_frames;
+	struct cgw_job_stats __percpu *stats;
+	struct cgw_grp *grp;
+	struct hlist_node grp_node;
+	canid_t grp_id;
 	struct cf_mod __rcu *cf_mod;
 	union {
 		/* CAN frame data source */
@@ -488,12 +513,12 @@ static void can_can_gw_rcv(struct sk_buff *skb, void *data)
 
 	if (cgw_hops(skb) >= max_hops) {
 		/* indicate deleted frames due to misconfiguration */
-		gwj->deleted_frames++;
+		this_cpu_inc(gwj->stats->deleted_frames);
 		return;
 	}
 
 	if (!(gwj->dst.dev->flags & IFF_UP)) {
-		gwj->dropped_frames++;
+		this_cpu_inc(gwj->stats->dropped_frames);
 		return;
 	}
 
@@ -514,7 +539,7 @@ static void can_can_gw_rcv(struct sk_buff *skb, void *data)
 		nskb = skb_clone(skb, GFP_ATOMIC);
 
 	if (!nskb) {
-		gwj->dropped_frames++;
+		this_cpu_inc(gwj->stats->dropped_frames);
 		return;
 	}
 
@@ -542,7 +567,7 @@ static void can_can_gw_rcv(struct sk_buff *skb, void *data)
 		/* dlc may have changed, make sure it fits to the CAN frame */
 		if (cf->len > max_len) {
 			/* delete frame due to misconfiguration */
-			gwj->deleted_frames++;
+			this_cpu_inc(gwj->stats->deleted_frames);
 			kfree_skb(nskb);
 			return;
 		}
@@ -561,13 +586,122 @@ static void can_can_gw_rcv(struct sk_buff *skb, void *data)
 
 	/* send to netdevice */
 	if (can_send(nskb, gwj->flags & CGW_FLAGS_CAN_ECHO))
-		gwj->dropped_frames++;
+		this_cpu_inc(gwj->stats->dropped_frames);
 	else
-		gwj->handled_frames++;
+		this_cpu_inc(gwj->stats->handled_frames);
+}
+
+/* receive function of a job group: dispatch to the jobs matching the id */
+static void cgw_grp_rcv(struct sk_buff *skb, void *data)
+{
+	struct cgw_grp *grp = (struct cgw_grp *)data;
+	canid_t id = ((struct can_frame *)skb->data)->can_id & grp->mask;
+	struct cgw_job *gwj;
+
+	hash_for_each_possible_rcu(grp->jobs, gwj, grp_node, id) {
+		if (gwj->grp_id == id)
+			can_can_gw_rcv(skb, gwj);
+	}
+}
+
+/* Normalize the job filter the way af_can does and tell whether it would
+ * end up in the can_id/mask list, which is the only one walked linearly.
+ */
+static bool cgw_filter_groupable(const struct can_filter *filter,
+				 canid_t *id, canid_t *mask)
+{
+	const canid_t eff_rtr = CAN_EFF_FLAG | CAN_RTR_FLAG;
+
+	*id = filter->can_id;
+	*mask = filter->can_mask;
+
+	if ((*id & CAN_INV_FILTER) || (*mask & CAN_ERR_FLAG))
+		return false;
+
+	if ((*mask & CAN_EFF_FLAG) && !(*id & CAN_EFF_FLAG))
+		*mask &= (CAN_SFF_MASK | eff_rtr);
+
+	*id &= *mask;
+
+	if (!*mask)
+		return false;
+
+	/* single non-RTR can_ids are already looked up directly by af_can */
+	if ((*mask & eff_rtr) == eff_rtr && !(*id & CAN_RTR_FLAG)) {
+		if ((*id & CAN_EFF_FLAG) &&
+		    *mask == (CAN_EFF_MASK | eff_rtr))
+			return false;
+		if (!(*id & CAN_EFF_FLAG) &&
+		    *mask == (CAN_SFF_MASK | eff_rtr))
+			return false;
+	}
+
+	return true;
+}
+
+static int cgw_grp_add_job(struct net *net, struct cgw_job *gwj,
+			   canid_t id, canid_t mask)
+{
+	struct cgw_grp *grp;
+	int err;
+
+	ASSERT_RTNL();
+
+	hlist_for_each_entry(grp, &net->can.cgw_grp_list, list) {
+		if (grp->dev == gwj->src.dev && grp->mask == mask)
+			goto found;
+	}
+
+	grp = kzalloc(sizeof(*grp), GFP_KERNEL);
+	if (!grp)
+		return -ENOMEM;
+
+	grp->dev = gwj->src.dev;
+	grp->mask = mask;
+	hash_init(grp->jobs);
+
+	/* the group has to see all frames of its source device */
+	err = can_rx_register(net, grp->dev, 0, 0, cgw_grp_rcv, grp,
+			      "gw", NULL);
+	if (err) {
+		kfree(grp);
+		return err;
+	}
+	hlist_add_head(&grp->list, &net->can.cgw_grp_list);
+
+found:
+	gwj->grp = grp;
+	gwj->grp_id = id;
+	grp->count++;
+	hash_add_rcu(grp->jobs, &gwj->grp_node, id);
+
+	return 0;
+}
+
+static void cgw_grp_del_job(struct net *net, struct cgw_job *gwj)
+{
+	struct cgw_grp *grp = gwj->grp;
+
+	ASSERT_RTNL();
+
+	hash_del_rcu(&gwj->grp_node);
+	gwj->grp = NULL;
+
+	if (--grp->count)
+		return;
+
+	hlist_del(&grp->list);
+	can_rx_unregister(net, grp->dev, 0, 0, cgw_grp_rcv, grp);
+	kfree_rcu(grp, rcu);
 }
 
 static inline int cgw_register_filter(struct net *net, struct cgw_job *gwj)
 {
+	canid_t id, mask;
+
+	if (cgw_filter_groupable(&gwj->ccgw.filter, &id, &mask))
+		return cgw_grp_add_job(net, gwj, id, mask);
+
 	return can_rx_register(net, gwj->src.dev, gwj->ccgw.filter.can_id,
 			       gwj->ccgw.filter.can_mask, can_can_gw_rcv,
 			       gwj, "gw", NULL);
@@ -575,6 +709,11 @@ static inline int cgw_register_filter(struct net *net, struct cgw_job *gwj)
 
 static inline void cgw_unregister_filter(struct net *net, struct cgw_job *gwj)
 {
+	if (gwj->grp) {
+		cgw_grp_del_job(net, gwj);
+		return;
+	}
+
 	can_rx_unregister(net, gwj->src.dev, gwj->ccgw.filter.can_id,
 			  gwj->ccgw.filter.can_mask, can_can_gw_rcv, gwj);
 }
@@ -588,9 +727,24 @@ static void cgw_job_free_rcu(struct rcu_head *rcu_head)
 	 * cf_mod can also be removed without mandating an additional grace period.
 	 */
 	kfree(rcu_access_pointer(gwj->cf_mod));
+	free_percpu(gwj->stats);
 	kmem_cache_free(cgw_cache, gwj);
 }
 
+static void cgw_job_stats_sum(struct cgw_job *gwj, struct cgw_job_stats *sum)
+{
+	int cpu;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		struct cgw_job_stats *st = per_cpu_ptr(gwj->stats, cpu);
+
+		sum->handled_frames += READ_ONCE(st->handled_frames);
+		sum->dropped_frames += READ_ONCE(st->dropped_frames);
+		sum->deleted_frames += READ_ONCE(st->deleted_frames);
+	}
+}
+
 /* Return cgw_job::cf_mod with RTNL protected section */
 static struct cf_mod *cgw_job_cf_mod(struct cgw_job *gwj)
 {
@@ -627,6 +781,7 @@ static int cgw_notifier(struct notifier_block *nb,
 static int cgw_put_job(struct sk_buff *skb, struct cgw_job *gwj, int type,
 		       u32 pid, u32 seq, int flags)
 {
+	struct cgw_job_stats st;
 	struct rtcanmsg *rtcan;
 	struct nlmsghdr *nlh;
 	struct cf_mod *mod;
@@ -641,19 +796,20 @@ static int cgw_put_job(struct sk_buff *skb, struct cgw_job *gwj, int type,
 	rtcan->flags = gwj->flags;
 
 	/* add statistics if available */
+	cgw_job_stats_sum(gwj, &st);
 
-	if (gwj->handled_frames) {
-		if (nla_put_u32(skb, CGW_HANDLED, gwj->handled_frames) < 0)
+	if (st.handled_frames) {
+		if (nla_put_u32(skb, CGW_HANDLED, st.handled_frames) < 0)
 			goto cancel;
 	}
 
-	if (gwj->dropped_frames) {
-		if (nla_put_u32(skb, CGW_DROPPED, gwj->dropped_frames) < 0)
+	if (st.dropped_frames) {
+		if (nla_put_u32(skb, CGW_DROPPED, st.dropped_frames) < 0)
 			goto cancel;
 	}
 
-	if (gwj->deleted_frames) {
-		if (nla_put_u32(skb, CGW_DELETED, gwj->deleted_frames) < 0)
+	if (st.deleted_frames) {
+		if (nla_put_u32(skb, CGW_DELETED, st.deleted_frames) < 0)
 			goto cancel;
 	}
 
@@ -1136,9 +1292,14 @@ static int cgw_create_job(struct sk_buff *skb,  struct nlmsghdr *nlh,
 		goto out_free_cf;
 	}
 
-	gwj->handled_frames = 0;
-	gwj->dropped_frames = 0;
-	gwj->deleted_frames = 0;
+	/* alloc_percpu provides zero'ed memory */
+	gwj->stats = alloc_percpu(struct cgw_job_stats);
+	if (!gwj->stats) {
+		kmem_cache_free(cgw_cache, gwj);
+		err = -ENOMEM;
+		goto out_free_cf;
+	}
+	gwj->grp = NULL;
 	gwj->flags = r->flags;
 	gwj->gwtype = r->gwtype;
 	gwj->limit_hops = limhops;
@@ -1172,6 +1333,7 @@ static int cgw_create_job(struct sk_buff *skb,  struct nlmsghdr *nlh,
 		hlist_add_head_rcu(&gwj->list, &net->can.cgw_list);
 out:
 	if (err) {
+		free_percpu(gwj->stats);
 		kmem_cache_free(cgw_cache, gwj);
 out_free_cf:
 		kfree(mod);
@@ -1271,6 +1433,7 @@ static int cgw_remove_job(struct sk_buff *skb, struct nlmsghdr *nlh,
 static int __net_init cangw_pernet_init(struct net *net)
 {
 	INIT_HLIST_HEAD(&net->can.cgw_list);
+	INIT_HLIST_HEAD(&net->can.cgw_grp_list);
 	return 0;
 }
 
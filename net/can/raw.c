@@ -89,6 +89,7 @@ struct raw_sock {
 	int recv_own_msgs;
 	int fd_frames;
 	int join_filters;
+	int recv_batch;
 	int count;                 /* number of active filters */
 	struct can_filter dfilter; /* default/single filter */
 	struct can_filter *filter; /* pointer to filter(s) */
@@ -352,6 +353,7 @@ static int raw_init(struct sock *sk)
 	ro->recv_own_msgs    = 0;
 	ro->fd_frames        = 0;
 	ro->join_filters     = 0;
+	ro->recv_batch       = 0;
 
 	/* alloc_percpu provides zero'ed memory */
 	ro->uniq = alloc_percpu(struct uniqframe);
@@ -407,6 +409,10 @@ static int raw_release(struct socket *sock)
 	ro->count = 0;
 	free_percpu(ro->uniq);
 
+	if (ro->recv_batch)
+		net_disable_timestamp();
+	ro->recv_batch = 0;
+
 	sock_orphan(sk);
 	sock->sk = NULL;
 
@@ -531,6 +537,7 @@ static int raw_setsockopt(struct socket *sock, int level, int optname,
 	struct net_device *dev = NULL;
 	can_err_mask_t err_mask = 0;
 	int count = 0;
+	int flag;
 	int err = 0;
 
 	if (level != SOL_CAN_RAW)
@@ -686,6 +693,24 @@ static int raw_setsockopt(struct socket *sock, int level, int optname,
 
 		break;
 
+	case CAN_RAW_RECV_BATCH:
+		if (optlen != sizeof(flag))
+			return -EINVAL;
+
+		if (copy_from_sockptr(&flag, optval, optlen))
+			return -EFAULT;
+
+		/* batch records always carry a timestamp */
+		lock_sock(sk);
+		if (flag && !ro->recv_batch)
+			net_enable_timestamp();
+		else if (!flag && ro->recv_batch)
+			net_disable_timestamp();
+		ro->recv_batch = !!flag;
+		release_sock(sk);
+
+		break;
+
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -765,6 +790,12 @@ static int raw_getsockopt(struct socket *sock, int level, int optname,
 		val = &ro->join_filters;
 		break;
 
+	case CAN_RAW_RECV_BATCH:
+		if (len > sizeof(int))
+			len = sizeof(int);
+		val = &ro->recv_batch;
+		break;
+
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -858,6 +889,94 @@ static int raw_sendmsg(struct socket *sock, struct msghdr *msg, size_t size)
 	return err;
 }
 
+/* Copy one frame as a CAN_RAW_RECV_BATCH record */
+static int raw_put_batch_rec(struct msghdr *msg, struct sk_buff *skb)
+{
+	struct {
+		struct can_raw_batch_hdr hdr;
+		u8 frame[CANFD_MTU];
+	} rec;
+	ktime_t hwts = skb_hwtstamps(skb)->hwtstamp;
+	unsigned int pflags = *(raw_flags(skb));
+
+	memset(&rec, 0, sizeof(rec));
+	if (hwts) {
+		rec.hdr.tstamp = ktime_to_ns(hwts);
+		rec.hdr.flags |= CAN_RAW_BATCH_HWTSTAMP;
+	} else {
+		rec.hdr.tstamp = ktime_to_ns(skb->tstamp);
+	}
+	rec.hdr.ifindex = ((struct sockaddr_can *)skb->cb)->can_ifindex;
+	if (pflags & MSG_DONTROUTE)
+		rec.hdr.flags |= CAN_RAW_BATCH_LOCAL;
+	if (pflags & MSG_CONFIRM)
+		rec.hdr.flags |= CAN_RAW_BATCH_OWN;
+	rec.hdr.len = skb->len;
+	memcpy(rec.frame, skb->data, skb->len);
+
+	return memcpy_to_msg(msg, &rec, CAN_RAW_BATCH_RECLEN(skb->len));
+}
+
+/* Return the next queued frame if its record still fits into the
+ * remaining buffer space, without sleeping.
+ */
+static struct sk_buff *raw_dequeue_batch(struct sock *sk, size_t room)
+{
+	struct sk_buff_head *queue = &sk->sk_receive_queue;
+	struct sk_buff *skb;
+
+	spin_lock_bh(&queue->lock);
+	skb = skb_peek(queue);
+	if (skb && CAN_RAW_BATCH_RECLEN(skb->len) <= room)
+		__skb_unlink(skb, queue);
+	else
+		skb = NULL;
+	spin_unlock_bh(&queue->lock);
+
+	return skb;
+}
+
+static int raw_recvmsg_batch(struct sock *sk, struct msghdr *msg,
+			     size_t size, int flags, int noblock)
+{
+	struct sk_buff *skb;
+	size_t copied = 0;
+	int err = 0;
+
+	skb = skb_recv_datagram(sk, flags, noblock, &err);
+	if (!skb)
+		return err;
+
+	/* a record is never split, the first one must fit completely */
+	if (size < CAN_RAW_BATCH_RECLEN(skb->len)) {
+		skb_free_datagram(sk, skb);
+		return -EMSGSIZE;
+	}
+
+	sock_recv_ts_and_drops(msg, sk, skb);
+
+	if (msg->msg_name) {
+		__sockaddr_check_size(RAW_MIN_NAMELEN);
+		msg->msg_namelen = RAW_MIN_NAMELEN;
+		memcpy(msg->msg_name, skb->cb, msg->msg_namelen);
+	}
+
+	do {
+		err = raw_put_batch_rec(msg, skb);
+		if (err < 0) {
+			skb_free_datagram(sk, skb);
+			break;
+		}
+		copied += CAN_RAW_BATCH_RECLEN(skb->len);
+		skb_free_datagram(sk, skb);
+
+		if (flags & MSG_PEEK)
+			break;
+	} while ((skb = raw_dequeue_batch(sk, size - copied)));
+
+	return copied ? copied : err;
+}
+
 static int raw_recvmsg(struct socket *sock, struct msghdr *msg, size_t size,
 		       int flags)
 {
@@ -873,6 +992,9 @@ static int raw_recvmsg(struct socket *sock, struct msghdr *msg, size_t size,
 		return sock_recv_errqueue(sk, msg, size,
 					  SOL_CAN_RAW, SCM_CAN_RAW_ERRQUEUE);
 
+	if (raw_sk(sk)->recv_batch)
+		return raw_recvmsg_batch(sk, msg, size, flags, noblock);
+
 	skb = skb_recv_datagram(sk, flags, noblock, &err);
 	if (!skb)
 		return err;
@@ -56,6 +56,9 @@ static const struct snmp_mib mptcp_snmp_list[] = {
 	SNMP_MIB_ITEM("RcvPruned", MPTCP_MIB_RCVPRUNED),
 	SNMP_MIB_ITEM("SubflowStale", MPTCP_MIB_SUBFLOWSTALE),
 	SNMP_MIB_ITEM("SubflowRecover", MPTCP_MIB_SUBFLOWRECOVER),
+	SNMP_MIB_ITEM("SchedSwitch", MPTCP_MIB_SCHEDSWITCH),
+	SNMP_MIB_ITEM("SchedBackup", MPTCP_MIB_SCHEDBACKUP),
+	SNMP_MIB_ITEM("SchedNoSubflow", MPTCP_MIB_SCHEDNOSUBFLOW),
 	SNMP_MIB_SENTINEL
 };
 
@@ -49,6 +49,9 @@ enum linux_mptcp_mib_field {
 	MPTCP_MIB_RCVPRUNED,		/* Incoming packet dropped due to memory limit */
 	MPTCP_MIB_SUBFLOWSTALE,		/* Subflows entered 'stale' status */
 	MPTCP_MIB_SUBFLOWRECOVER,	/* Subflows returned to active status after being stale */
+	MPTCP_MIB_SCHEDSWITCH,		/* Scheduler moved the transmission to another subflow */
+	MPTCP_MIB_SCHEDBACKUP,		/* Scheduler picked a backup subflow, no other one was active */
+	MPTCP_MIB_SCHEDNOSUBFLOW,	/* Scheduler found no subflow able to transmit */
 	__MPTCP_MIB_MAX
 };
 
@@ -1492,11 +1492,12 @@ bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
 	return __mptcp_subflow_active(subflow);
 }
 
-/* implement the mptcp packet scheduler;
- * returns the subflow that will transmit the next DSS
+/* pick the active subflow with the lowest metric, metric() returning
+ * U64_MAX for subflows that must not be used;
  * additionally updates the rtx timeout
  */
-static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
+static struct sock *mptcp_subflow_pick_send(struct mptcp_sock *msk,
+					    u64 (*metric)(const struct sock *ssk))
 {
 	struct subflow_send_info send_info[2];
 	struct mptcp_subflow_context *subflow;
@@ -1505,25 +1506,7 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	struct sock *ssk;
 	long tout = 0;
 	u64 ratio;
-	u32 pace;
-
-	sock_owned_by_me(sk);
-
-	if (__mptcp_check_fallback(msk)) {
-		if (!msk->first)
-			return NULL;
-		return sk_stream_memory_free(msk->first) ? msk->first : NULL;
-	}
-
-	/* re-use last subflow, if the burst allow that */
-	if (msk->last_snd && msk->snd_burst > 0 &&
-	    sk_stream_memory_free(msk->last_snd) &&
-	    mptcp_subflow_active(mptcp_subflow_ctx(msk->last_snd))) {
-		mptcp_set_timeout(sk);
-		return msk->last_snd;
-	}
 
-	/* pick the subflow with the lower wmem/wspace ratio */
 	for (i = 0; i < 2; ++i) {
 		send_info[i].ssk = NULL;
 		send_info[i].ratio = -1;
@@ -1541,12 +1524,7 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 		if (!sk_stream_memory_free(subflow->tcp_sock) || !tcp_sk(ssk)->snd_wnd)
 			continue;
 
-		pace = READ_ONCE(ssk->sk_pacing_rate);
-		if (!pace)
-			continue;
-
-		ratio = div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32,
-				pace);
+		ratio = metric(ssk);
 		if (ratio < send_info[backup].ratio) {
 			send_info[backup].ssk = ssk;
 			send_info[backup].ratio = ratio;
@@ -1555,8 +1533,11 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	__mptcp_set_timeout(sk, tout);
 
 	/* pick the best backup if no other subflow is active */
-	if (!nr_active)
+	if (!nr_active) {
 		send_info[0].ssk = send_info[1].ssk;
+		if (send_info[0].ssk)
+			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_SCHEDBACKUP);
+	}
 
 	if (send_info[0].ssk) {
 		msk->last_snd = send_info[0].ssk;
@@ -1568,6 +1549,83 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	return NULL;
 }
 
+/* lower wmem/wspace ratio first */
+static u64 mptcp_sched_default_metric(const struct sock *ssk)
+{
+	u32 pace = READ_ONCE(ssk->sk_pacing_rate);
+
+	if (!pace)
+		return U64_MAX;
+
+	return div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32, pace);
+}
+
+static struct sock *mptcp_sched_default_get_send(struct mptcp_sock *msk)
+{
+	/* re-use last subflow, if the burst allow that */
+	if (msk->last_snd && msk->snd_burst > 0 &&
+	    sk_stream_memory_free(msk->last_snd) &&
+	    mptcp_subflow_active(mptcp_subflow_ctx(msk->last_snd))) {
+		mptcp_set_timeout((struct sock *)msk);
+		return msk->last_snd;
+	}
+
+	return mptcp_subflow_pick_send(msk, mptcp_sched_default_metric);
+}
+
+/* lower smoothed rtt first, subflows without a sample yet come last */
+static u64 mptcp_sched_minrtt_metric(const struct sock *ssk)
+{
+	u32 srtt = READ_ONCE(tcp_sk(ssk)->srtt_us);
+
+	return srtt ? srtt : U32_MAX;
+}
+
+/* Re-evaluated for every DSS instead of for every burst: a subflow whose
+ * rtt grows past the other ones' stops being used right away, at the cost
+ * of a subflow walk per DSS.
+ */
+static struct sock *mptcp_sched_minrtt_get_send(struct mptcp_sock *msk)
+{
+	return mptcp_subflow_pick_send(msk, mptcp_sched_minrtt_metric);
+}
+
+static struct mptcp_sched_ops mptcp_sched_default = {
+	.get_send	= mptcp_sched_default_get_send,
+	.name		= "default",
+};
+
+static struct mptcp_sched_ops mptcp_sched_minrtt = {
+	.get_send	= mptcp_sched_minrtt_get_send,
+	.name		= "minrtt",
+};
+
+/* implement the mptcp packet scheduler;
+ * returns the subflow that will transmit the next DSS
+ */
+static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
+{
+	struct sock *prev = msk->last_snd;
+	struct sock *sk = (struct sock *)msk;
+	struct sock *ssk;
+
+	sock_owned_by_me(sk);
+
+	if (__mptcp_check_fallback(msk)) {
+		if (!msk->first)
+			return NULL;
+		return sk_stream_memory_free(msk->first) ? msk->first : NULL;
+	}
+
+	ssk = msk->sched->get_send(msk);
+	if (!ssk)
+		MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_SCHEDNOSUBFLOW);
+	else if (prev && ssk != prev)
+		MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_SCHEDSWITCH);
+
+	return ssk;
+}
+
 static void mptcp_push_release(struct sock *sk, struct sock *ssk,
 			       struct mptcp_sendmsg_info *info)
 {
@@ -2581,6 +2639,7 @@ static int __mptcp_init_sock(struct sock *sk)
 static int mptcp_init_sock(struct sock *sk)
 {
 	struct inet_connection_sock *icsk = inet_csk(sk);
+	char sched_name[MPTCP_SCHED_NAME_MAX];
 	struct net *net = sock_net(sk);
 	int ret;
 
@@ -2608,6 +2667,13 @@ static int mptcp_init_sock(struct sock *sk)
 	tcp_cleanup_congestion_control(sk);
 	icsk->icsk_ca_ops = NULL;
 
+	/* likewise, clones inherit the packet scheduler of the listener */
+	mptcp_get_scheduler(net, sched_name);
+	rcu_read_lock();
+	mptcp_sk(sk)->sched = mptcp_sched_find(sched_name) ?:
+			      &mptcp_sched_default;
+	rcu_read_unlock();
+
 	sk_sockets_allocated_inc(sk);
 	sk->sk_rcvbuf = READ_ONCE(sock_net(sk)->ipv4.sysctl_tcp_rmem[1]);
 	sk->sk_sndbuf = READ_ONCE(sock_net(sk)->ipv4.sysctl_tcp_wmem[1]);
@@ -3696,6 +3762,10 @@ void __init mptcp_proto_init(void)
 	mptcp_pm_init();
 	mptcp_token_init();
 
+	if (mptcp_register_scheduler(&mptcp_sched_default) ||
+	    mptcp_register_scheduler(&mptcp_sched_minrtt))
+		panic("Failed to register MPTCP packet schedulers.\n");
+
 	if (proto_register(&mptcp_prot, 1) != 0)
 		panic("Failed to register MPTCP proto.\n");
 
@@ -218,6 +218,20 @@ struct mptcp_data_frag {
 	struct page *page;
 };
 
+struct mptcp_sock;
+
+#define MPTCP_SCHED_NAME_MAX	16
+
+/* MPTCP packet scheduler: get_send() is invoked with the msk socket lock
+ * held and returns the subflow that will transmit the next DSS, updating
+ * msk->last_snd and msk->snd_burst accordingly.
+ */
+struct mptcp_sched_ops {
+	struct sock *(*get_send)(struct mptcp_sock *msk);
+	char			name[MPTCP_SCHED_NAME_MAX];
+	struct list_head	list;
+};
+
 /* MPTCP connection sock */
 struct mptcp_sock {
 	/* inet_connection_sock must be the first member */
@@ -277,6 +291,7 @@ struct mptcp_sock {
 
 	u32 setsockopt_seq;
 	char		ca_name[TCP_CA_NAME_MAX];
+	struct mptcp_sched_ops	*sched;
 };
 
 #define mptcp_lock_sock(___sk, cb) do {					\
@@ -576,6 +591,7 @@ unsigned int mptcp_get_add_addr_timeout(const struct net *net);
 int mptcp_is_checksum_enabled(const struct net *net);
 int mptcp_allow_join_id0(const struct net *net);
 unsigned int mptcp_stale_loss_cnt(const struct net *net);
+void mptcp_get_scheduler(const struct net *net, char *name);
 void mptcp_subflow_fully_established(struct mptcp_subflow_context *subflow,
 				     struct mptcp_options_received *mp_opt);
 bool __mptcp_retransmit_pending_data(struct sock *sk);
@@ -639,6 +655,9 @@ static inline bool mptcp_has_another_subflow(struct sock *ssk)
 	return false;
 }
 
+struct mptcp_sched_ops *mptcp_sched_find(const char *name);
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+
 void __init mptcp_proto_init(void);
 #if IS_ENABLED(CONFIG_MPTCP_IPV6)
 int __init mptcp_proto_v6_init(void);
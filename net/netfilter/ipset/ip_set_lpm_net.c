@@ -0,0 +1,594 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* Kernel module implementing an IP set type: the lpm:net type
+ *
+ * The elements are stored in a path-compressed binary trie keyed by the
+ * network address, so a lookup costs at most one node per prefix bit no
+ * matter how many different prefix lengths are present in the set.  The
+ * hash:net type instead probes its hash once per distinct prefix length,
+ * which gets expensive with large blocklists of mixed-size netblocks.
+ */
+
+#include <linux/module.h>
+#include <linux/ip.h>
+#include <linux/rculist.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/netlink.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/ipset/pfxlen.h>
+#include <linux/netfilter/ipset/ip_set.h>
+
+#define IPSET_TYPE_REV_MIN	0
+#define IPSET_TYPE_REV_MAX	0
+
+MODULE_LICENSE("GPL");
+IP_SET_MODULE_DESC("lpm:net", IPSET_TYPE_REV_MIN, IPSET_TYPE_REV_MAX);
+MODULE_ALIAS("ip_set_lpm:net");
+
+#define LPM_NET_DEFAULT_MAXELEM	65536
+
+/* Node flags */
+#define LPM_NET_F_INTERMEDIATE	0x01	/* branching point, not an element */
+#define LPM_NET_F_NOMATCH	0x02	/* element added with nomatch */
+
+/* Trie nodes: the elements plus the branching points between them */
+struct lpm_net_node {
+	struct rcu_head rcu;
+	struct lpm_net_node __rcu *child[2];
+	struct list_head list;		/* elements only, for listing */
+	union nf_inet_addr ip;
+	u8 cidr;
+	u8 flags;
+};
+
+/* Member elements as passed to the add/del/test functions */
+struct lpm_net_elem {
+	union nf_inet_addr ip;
+	u8 cidr;
+};
+
+/* Type structure */
+struct lpm_net {
+	struct lpm_net_node __rcu *root;
+	struct list_head members;	/* the elements in insertion order */
+	u32 maxelem;			/* max elements in the set */
+	u32 nodes;			/* elements plus intermediate nodes */
+	u8 host_mask;			/* 32 or 128 */
+};
+
+/* Length of the common prefix of the node and the address, compared one
+ * 32-bit word at a time and capped at the shorter of the two prefixes.
+ */
+static u8
+lpm_net_match_len(const struct lpm_net_node *node,
+		  const union nf_inet_addr *ip, u8 cidr)
+{
+	u8 limit = min(node->cidr, cidr);
+	u8 len = 0;
+	u32 diff;
+	int i;
+
+	for (i = 0; len < limit; i++) {
+		diff = be32_to_cpu(node->ip.all[i] ^ ip->all[i]);
+		if (diff)
+			return min_t(u8, len + 32 - fls(diff), limit);
+		len += 32;
+	}
+	return min(len, limit);
+}
+
+static int
+lpm_net_bit(const union nf_inet_addr *ip, u8 bit)
+{
+	return (be32_to_cpu(ip->all[bit / 32]) >> (31 - bit % 32)) & 1;
+}
+
+static int
+lpm_net_match(const struct lpm_net_node *node)
+{
+	return READ_ONCE(node->flags) & LPM_NET_F_NOMATCH ? -ENOTEMPTY : 1;
+}
+
+static struct lpm_net_node *
+lpm_net_alloc(struct lpm_net *t, const struct lpm_net_elem *e, u8 flags)
+{
+	struct lpm_net_node *node;
+
+	node = kzalloc(sizeof(*node), GFP_ATOMIC);
+	if (!node)
+		return NULL;
+	node->ip = e->ip;
+	node->cidr = e->cidr;
+	node->flags = flags;
+	t->nodes++;
+
+	return node;
+}
+
+static void
+lpm_net_free(struct lpm_net *t, struct lpm_net_node *node)
+{
+	t->nodes--;
+	kfree_rcu(node, rcu);
+}
+
+/* Longest prefix match of a host address, or exact match of a network */
+static int
+lpm_net_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	     struct ip_set_ext *mext, u32 flags)
+{
+	struct lpm_net *t = set->data;
+	struct lpm_net_elem *e = value;
+	struct lpm_net_node *node, *found = NULL;
+
+	node = rcu_dereference_bh(t->root);
+	while (node) {
+		if (lpm_net_match_len(node, &e->ip, e->cidr) < node->cidr)
+			break;
+		if (node->cidr == e->cidr) {
+			if (!(READ_ONCE(node->flags) & LPM_NET_F_INTERMEDIATE))
+				found = node;
+			break;
+		}
+		if (e->cidr == t->host_mask &&
+		    !(READ_ONCE(node->flags) & LPM_NET_F_INTERMEDIATE))
+			found = node;
+		node = rcu_dereference_bh(node->child[lpm_net_bit(&e->ip,
+								  node->cidr)]);
+	}
+	if (!found)
+		return 0;
+
+	return lpm_net_match(found);
+}
+
+static int
+lpm_net_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	    struct ip_set_ext *mext, u32 flags)
+{
+	struct lpm_net *t = set->data;
+	struct lpm_net_elem *e = value;
+	struct lpm_net_node __rcu **slot = &t->root;
+	struct lpm_net_node *node, *new, *im;
+	u8 nflags = (flags >> 16) & IPSET_FLAG_NOMATCH ? LPM_NET_F_NOMATCH : 0;
+	u8 len = 0;
+
+	while ((node = rcu_dereference_protected(*slot,
+					lockdep_is_held(&set->lock)))) {
+		len = lpm_net_match_len(node, &e->ip, e->cidr);
+		if (node->cidr != len || node->cidr == e->cidr)
+			break;
+		slot = &node->child[lpm_net_bit(&e->ip, node->cidr)];
+	}
+
+	if (node && node->cidr == e->cidr && len == e->cidr) {
+		/* The prefix is already in the trie */
+		if (!(node->flags & LPM_NET_F_INTERMEDIATE)) {
+			if (!(flags & IPSET_FLAG_EXIST))
+				return -IPSET_ERR_EXIST;
+			WRITE_ONCE(node->flags, nflags);
+			return 0;
+		}
+		if (set->elements >= t->maxelem)
+			return -IPSET_ERR_HASH_FULL;
+		list_add_tail_rcu(&node->list, &t->members);
+		WRITE_ONCE(node->flags, nflags);
+		set->elements++;
+		return 0;
+	}
+
+	if (set->elements >= t->maxelem)
+		return -IPSET_ERR_HASH_FULL;
+	new = lpm_net_alloc(t, e, nflags);
+	if (!new)
+		return -ENOMEM;
+
+	if (node && len == e->cidr) {
+		/* The new element is a shorter prefix of the node */
+		RCU_INIT_POINTER(new->child[lpm_net_bit(&node->ip, len)], node);
+	} else if (node) {
+		/* The two diverge at bit len: branch there */
+		struct lpm_net_elem branch = { .ip = node->ip, .cidr = len };
+
+		im = lpm_net_alloc(t, &branch, LPM_NET_F_INTERMEDIATE);
+		if (!im) {
+			lpm_net_free(t, new);
+			return -ENOMEM;
+		}
+		if (lpm_net_bit(&e->ip, len)) {
+			RCU_INIT_POINTER(im->child[0], node);
+			RCU_INIT_POINTER(im->child[1], new);
+		} else {
+			RCU_INIT_POINTER(im->child[0], new);
+			RCU_INIT_POINTER(im->child[1], node);
+		}
+		list_add_tail_rcu(&new->list, &t->members);
+		rcu_assign_pointer(*slot, im);
+		set->elements++;
+		return 0;
+	}
+	list_add_tail_rcu(&new->list, &t->members);
+	rcu_assign_pointer(*slot, new);
+	set->elements++;
+
+	return 0;
+}
+
+static int
+lpm_net_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	    struct ip_set_ext *mext, u32 flags)
+{
+	struct lpm_net *t = set->data;
+	struct lpm_net_elem *e = value;
+	struct lpm_net_node __rcu **slot = &t->root, **pslot = NULL;
+	struct lpm_net_node *node, *parent = NULL, *child;
+
+	while ((node = rcu_dereference_protected(*slot,
+					lockdep_is_held(&set->lock)))) {
+		if (lpm_net_match_len(node, &e->ip, e->cidr) != node->cidr ||
+		    node->cidr == e->cidr)
+			break;
+		parent = node;
+		pslot = slot;
+		slot = &node->child[lpm_net_bit(&e->ip, node->cidr)];
+	}
+	if (!node || node->cidr != e->cidr ||
+	    lpm_net_match_len(node, &e->ip, e->cidr) != e->cidr ||
+	    (node->flags & LPM_NET_F_INTERMEDIATE))
+		return -IPSET_ERR_EXIST;
+
+	list_del_rcu(&node->list);
+	set->elements--;
+
+	/* Still a branching point: keep it as an intermediate node */
+	if (rcu_access_pointer(node->child[0]) &&
+	    rcu_access_pointer(node->child[1])) {
+		WRITE_ONCE(node->flags, LPM_NET_F_INTERMEDIATE);
+		return 0;
+	}
+
+	/* A leaf below an intermediate node: the sibling replaces both */
+	if (parent && (parent->flags & LPM_NET_F_INTERMEDIATE) &&
+	    !rcu_access_pointer(node->child[0]) &&
+	    !rcu_access_pointer(node->child[1])) {
+		child = rcu_dereference_protected(
+			parent->child[rcu_access_pointer(parent->child[0]) ==
+				      node], lockdep_is_held(&set->lock));
+		rcu_assign_pointer(*pslot, child);
+		lpm_net_free(t, parent);
+		lpm_net_free(t, node);
+		return 0;
+	}
+
+	child = rcu_dereference_protected(node->child[0],
+					  lockdep_is_held(&set->lock));
+	if (!child)
+		child = rcu_dereference_protected(node->child[1],
+						  lockdep_is_held(&set->lock));
+	rcu_assign_pointer(*slot, child);
+	lpm_net_free(t, node);
+
+	return 0;
+}
+
+static int
+lpm_net_kadt(struct ip_set *set, const struct sk_buff *skb,
+	     const struct xt_action_param *par,
+	     enum ipset_adt adt, struct ip_set_adt_opt *opt)
+{
+	const struct lpm_net *t = set->data;
+	ipset_adtfn adtfn = set->variant->adt[adt];
+	struct lpm_net_elem e = { .cidr = t->host_mask };
+
+	if (set->family == NFPROTO_IPV4)
+		ip4addrptr(skb, opt->flags & IPSET_DIM_ONE_SRC, &e.ip.ip);
+	else
+		ip6addrptr(skb, opt->flags & IPSET_DIM_ONE_SRC, &e.ip.in6);
+
+	return adtfn(set, &e, NULL, &opt->ext, opt->cmdflags);
+}
+
+static int
+lpm_net_uadt(struct ip_set *set, struct nlattr *tb[],
+	     enum ipset_adt adt, u32 *lineno, u32 flags, bool retried)
+{
+	const struct lpm_net *t = set->data;
+	ipset_adtfn adtfn = set->variant->adt[adt];
+	struct lpm_net_elem e = { .cidr = t->host_mask };
+	u32 ip = 0, ip_to = 0;
+	int ret;
+
+	if (tb[IPSET_ATTR_LINENO])
+		*lineno = nla_get_u32(tb[IPSET_ATTR_LINENO]);
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_CADT_FLAGS)))
+		return -IPSET_ERR_PROTOCOL;
+	if (unlikely(tb[IPSET_ATTR_IP_TO] && set->family != NFPROTO_IPV4))
+		return -IPSET_ERR_HASH_RANGE_UNSUPPORTED;
+
+	if (tb[IPSET_ATTR_CIDR]) {
+		e.cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+		if (!e.cidr || e.cidr > t->host_mask)
+			return -IPSET_ERR_INVALID_CIDR;
+	}
+
+	if (tb[IPSET_ATTR_CADT_FLAGS]) {
+		u32 cadt_flags = ip_set_get_h32(tb[IPSET_ATTR_CADT_FLAGS]);
+
+		if (cadt_flags & IPSET_FLAG_NOMATCH)
+			flags |= (IPSET_FLAG_NOMATCH << 16);
+	}
+
+	if (set->family == NFPROTO_IPV6) {
+		ret = ip_set_get_ipaddr6(tb[IPSET_ATTR_IP], &e.ip);
+		if (ret)
+			return ret;
+		ip6_netmask(&e.ip, e.cidr);
+		goto out;
+	}
+
+	ret = ip_set_get_hostipaddr4(tb[IPSET_ATTR_IP], &ip);
+	if (ret)
+		return ret;
+
+	if (adt == IPSET_TEST || !tb[IPSET_ATTR_IP_TO]) {
+		e.ip.ip = htonl(ip & ip_set_hostmask(e.cidr));
+		goto out;
+	}
+
+	/* A range splits into at most 62 networks, no need to restart */
+	ret = ip_set_get_hostipaddr4(tb[IPSET_ATTR_IP_TO], &ip_to);
+	if (ret)
+		return ret;
+	if (ip_to < ip)
+		swap(ip, ip_to);
+	if (ip + UINT_MAX == ip_to)
+		return -IPSET_ERR_HASH_RANGE;
+
+	do {
+		e.ip.ip = htonl(ip);
+		ip = ip_set_range_to_cidr(ip, ip_to, &e.cidr);
+		ret = adtfn(set, &e, NULL, NULL, flags);
+		if (ret && !ip_set_eexist(ret, flags))
+			return ret;
+
+		ret = 0;
+	} while (ip++ < ip_to);
+	return ret;
+
+out:
+	ret = adtfn(set, &e, NULL, NULL, flags);
+
+	return ip_set_enomatch(ret, flags, adt, set) ? -ret :
+	       ip_set_eexist(ret, flags) ? 0 : ret;
+}
+
+static void
+lpm_net_flush(struct ip_set *set)
+{
+	struct lpm_net *t = set->data;
+	struct lpm_net_node __rcu **slot;
+	struct lpm_net_node *node;
+
+	/* Unlink one leaf per pass, readers may still be walking the trie */
+	while (rcu_access_pointer(t->root)) {
+		slot = &t->root;
+		for (;;) {
+			node = rcu_dereference_protected(*slot, 1);
+			if (rcu_access_pointer(node->child[0]))
+				slot = &node->child[0];
+			else if (rcu_access_pointer(node->child[1]))
+				slot = &node->child[1];
+			else
+				break;
+		}
+		RCU_INIT_POINTER(*slot, NULL);
+		lpm_net_free(t, node);
+	}
+	INIT_LIST_HEAD_RCU(&t->members);
+	set->elements = 0;
+}
+
+static void
+lpm_net_destroy(struct ip_set *set)
+{
+	lpm_net_flush(set);
+	kfree(set->data);
+
+	set->data = NULL;
+}
+
+static int
+lpm_net_head(struct ip_set *set, struct sk_buff *skb)
+{
+	const struct lpm_net *t = set->data;
+	struct nlattr *nested;
+	size_t memsize = sizeof(*t) + t->nodes * sizeof(struct lpm_net_node);
+
+	nested = nla_nest_start(skb, IPSET_ATTR_DATA);
+	if (!nested)
+		goto nla_put_failure;
+	if (nla_put_net32(skb, IPSET_ATTR_MAXELEM, htonl(t->maxelem)) ||
+	    nla_put_net32(skb, IPSET_ATTR_REFERENCES, htonl(set->ref)) ||
+	    nla_put_net32(skb, IPSET_ATTR_MEMSIZE, htonl(memsize)) ||
+	    nla_put_net32(skb, IPSET_ATTR_ELEMENTS, htonl(set->elements)))
+		goto nla_put_failure;
+	if (unlikely(ip_set_put_flags(skb, set)))
+		goto nla_put_failure;
+	nla_nest_end(skb, nested);
+
+	return 0;
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static bool
+lpm_net_data_list(struct sk_buff *skb, const struct ip_set *set,
+		  const struct lpm_net_node *node)
+{
+	u8 flags = READ_ONCE(node->flags);
+
+	if ((set->family == NFPROTO_IPV4 ?
+	     nla_put_ipaddr4(skb, IPSET_ATTR_IP, node->ip.ip) :
+	     nla_put_ipaddr6(skb, IPSET_ATTR_IP, &node->ip.in6)) ||
+	    nla_put_u8(skb, IPSET_ATTR_CIDR, node->cidr) ||
+	    ((flags & LPM_NET_F_NOMATCH) &&
+	     nla_put_net32(skb, IPSET_ATTR_CADT_FLAGS,
+			   htonl(IPSET_FLAG_NOMATCH))))
+		return true;
+	return false;
+}
+
+static int
+lpm_net_list(const struct ip_set *set,
+	     struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct lpm_net *t = set->data;
+	struct nlattr *atd, *nested;
+	u32 i = 0, first = cb->args[IPSET_CB_ARG0];
+	struct lpm_net_node *node;
+	int ret = 0;
+
+	atd = nla_nest_start(skb, IPSET_ATTR_ADT);
+	if (!atd)
+		return -EMSGSIZE;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(node, &t->members, list) {
+		if (i < first) {
+			i++;
+			continue;
+		}
+		nested = nla_nest_start(skb, IPSET_ATTR_DATA);
+		if (!nested)
+			goto nla_put_failure;
+		if (lpm_net_data_list(skb, set, node))
+			goto nla_put_failure;
+		nla_nest_end(skb, nested);
+		i++;
+	}
+
+	nla_nest_end(skb, atd);
+	/* Set listing finished */
+	cb->args[IPSET_CB_ARG0] = 0;
+	goto out;
+
+nla_put_failure:
+	nla_nest_cancel(skb, nested);
+	if (unlikely(i == first)) {
+		nla_nest_cancel(skb, atd);
+		cb->args[IPSET_CB_ARG0] = 0;
+		ret = -EMSGSIZE;
+	} else {
+		cb->args[IPSET_CB_ARG0] = i;
+		nla_nest_end(skb, atd);
+	}
+out:
+	rcu_read_unlock();
+	return ret;
+}
+
+static bool
+lpm_net_same_set(const struct ip_set *a, const struct ip_set *b)
+{
+	const struct lpm_net *x = a->data;
+	const struct lpm_net *y = b->data;
+
+	return x->maxelem == y->maxelem &&
+	       a->extensions == b->extensions;
+}
+
+static const struct ip_set_type_variant lpm_net_variant = {
+	.kadt	= lpm_net_kadt,
+	.uadt	= lpm_net_uadt,
+	.adt	= {
+		[IPSET_ADD] = lpm_net_add,
+		[IPSET_DEL] = lpm_net_del,
+		[IPSET_TEST] = lpm_net_test,
+	},
+	.destroy = lpm_net_destroy,
+	.flush	= lpm_net_flush,
+	.head	= lpm_net_head,
+	.list	= lpm_net_list,
+	.same_set = lpm_net_same_set,
+};
+
+/* Create lpm:net type of sets */
+
+static struct lock_class_key lpm_net_lockdep_key;
+
+static int
+lpm_net_create(struct net *net, struct ip_set *set, struct nlattr *tb[],
+	       u32 flags)
+{
+	u32 maxelem = LPM_NET_DEFAULT_MAXELEM;
+	struct lpm_net *t;
+
+	if (!(set->family == NFPROTO_IPV4 || set->family == NFPROTO_IPV6))
+		return -IPSET_ERR_INVALID_FAMILY;
+
+	if (unlikely(!ip_set_optattr_netorder(tb, IPSET_ATTR_MAXELEM)))
+		return -IPSET_ERR_PROTOCOL;
+
+	if (tb[IPSET_ATTR_MAXELEM])
+		maxelem = ip_set_get_h32(tb[IPSET_ATTR_MAXELEM]);
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+
+	t->maxelem = maxelem;
+	t->host_mask = set->family == NFPROTO_IPV4 ? 32 : 128;
+	INIT_LIST_HEAD(&t->members);
+
+	lockdep_set_class(&set->lock, &lpm_net_lockdep_key);
+	set->variant = &lpm_net_variant;
+	set->dsize = sizeof(struct lpm_net_node);
+	set->data = t;
+
+	return 0;
+}
+
+static struct ip_set_type lpm_net_type __read_mostly = {
+	.name		= "lpm:net",
+	.protocol	= IPSET_PROTOCOL,
+	.features	= IPSET_TYPE_IP | IPSET_TYPE_NOMATCH,
+	.dimension	= IPSET_DIM_ONE,
+	.family		= NFPROTO_UNSPEC,
+	.revision_min	= IPSET_TYPE_REV_MIN,
+	.revision_max	= IPSET_TYPE_REV_MAX,
+	.create		= lpm_net_create,
+	.create_policy	= {
+		[IPSET_ATTR_MAXELEM]	= { .type = NLA_U32 },
+	},
+	.adt_policy	= {
+		[IPSET_ATTR_IP]		= { .type = NLA_NESTED },
+		[IPSET_ATTR_IP_TO]	= { .type = NLA_NESTED },
+		[IPSET_ATTR_CIDR]	= { .type = NLA_U8 },
+		[IPSET_ATTR_LINENO]	= { .type = NLA_U32 },
+		[IPSET_ATTR_CADT_FLAGS]	= { .type = NLA_U32 },
+	},
+	.me		= THIS_MODULE,
+};
+
+static int __init
+lpm_net_init(void)
+{
+	return ip_set_type_register(&lpm_net_type);
+}
+
+static void __exit
+lpm_net_fini(void)
+{
+	ip_set_type_unregister(&lpm_net_type);
+	rcu_barrier();
+}
+
+module_init(lpm_net_init);
+module_exit(lpm_net_fini);
@@ -21,6 +21,8 @@
 #include <linux/slab.h>
 #include <linux/net.h>
 #include <linux/gcd.h>
+#include <linux/percpu.h>
+#include <linux/seqlock.h>
 
 #include <net/ip_vs.h>
 
@@ -55,13 +57,21 @@
  */
 
 /*
- * current destination pointer for weighted round-robin scheduling
+ * current destination pointer for weighted round-robin scheduling, every
+ * CPU walks the destinations on its own so that scheduling needs no lock
  */
 struct ip_vs_wrr_mark {
 	struct ip_vs_dest *cl;	/* current dest or head */
 	int cw;			/* current weight */
+	unsigned int gen;	/* weights generation cl and cw belong to */
+};
+
+struct ip_vs_wrr_data {
+	struct ip_vs_wrr_mark __percpu *marks;
+	seqlock_t		lock;	/* protects mw, di and gen */
 	int mw;			/* maximum weight */
 	int di;			/* decreasing interval */
+	unsigned int gen;	/* bumped on every destination change */
 	struct rcu_head		rcu_head;
 };
 
@@ -105,50 +115,67 @@ static int ip_vs_wrr_max_weight(struct ip_vs_service *svc)
 
 static int ip_vs_wrr_init_svc(struct ip_vs_service *svc)
 {
-	struct ip_vs_wrr_mark *mark;
+	struct ip_vs_wrr_data *data;
 
 	/*
-	 *    Allocate the mark variable for WRR scheduling
+	 *    Allocate the mark variables for WRR scheduling
 	 */
-	mark = kmalloc(sizeof(struct ip_vs_wrr_mark), GFP_KERNEL);
-	if (mark == NULL)
+	data = kmalloc(sizeof(struct ip_vs_wrr_data), GFP_KERNEL);
+	if (data == NULL)
+		return -ENOMEM;
+
+	data->marks = alloc_percpu(struct ip_vs_wrr_mark);
+	if (data->marks == NULL) {
+		kfree(data);
 		return -ENOMEM;
+	}
 
-	mark->cl = list_entry(&svc->destinations, struct ip_vs_dest, n_list);
-	mark->di = ip_vs_wrr_gcd_weight(svc);
-	mark->mw = ip_vs_wrr_max_weight(svc) - (mark->di - 1);
-	mark->cw = mark->mw;
-	svc->sched_data = mark;
+	seqlock_init(&data->lock);
+	data->di = ip_vs_wrr_gcd_weight(svc);
+	data->mw = ip_vs_wrr_max_weight(svc) - (data->di - 1);
+	/* the zeroed marks are from generation 0 and get reset on first use */
+	data->gen = 1;
+	svc->sched_data = data;
 
 	return 0;
 }
 
 
+static void ip_vs_wrr_free_rcu(struct rcu_head *head)
+{
+	struct ip_vs_wrr_data *data = container_of(head, struct ip_vs_wrr_data,
+						   rcu_head);
+
+	free_percpu(data->marks);
+	kfree(data);
+}
+
 static void ip_vs_wrr_done_svc(struct ip_vs_service *svc)
 {
-	struct ip_vs_wrr_mark *mark = svc->sched_data;
+	struct ip_vs_wrr_data *data = svc->sched_data;
 
 	/*
-	 *    Release the mark variable
+	 *    Release the mark variables
 	 */
-	kfree_rcu(mark, rcu_head);
+	call_rcu(&data->rcu_head, ip_vs_wrr_free_rcu);
 }
 
 
+/*
+ * Destination changes only bump the generation, every CPU then restarts its
+ * own walk the next time it schedules.  The per-CPU current dest may be
+ * unlinked by now, it is never followed once the generation changed.
+ */
 static int ip_vs_wrr_dest_changed(struct ip_vs_service *svc,
 				  struct ip_vs_dest *dest)
 {
-	struct ip_vs_wrr_mark *mark = svc->sched_data;
-
-	spin_lock_bh(&svc->sched_lock);
-	mark->cl = list_entry(&svc->destinations, struct ip_vs_dest, n_list);
-	mark->di = ip_vs_wrr_gcd_weight(svc);
-	mark->mw = ip_vs_wrr_max_weight(svc) - (mark->di - 1);
-	if (mark->cw > mark->mw || !mark->cw)
-		mark->cw = mark->mw;
-	else if (mark->di > 1)
-		mark->cw = (mark->cw / mark->di) * mark->di + 1;
-	spin_unlock_bh(&svc->sched_lock);
+	struct ip_vs_wrr_data *data = svc->sched_data;
+
+	write_seqlock_bh(&data->lock);
+	data->di = ip_vs_wrr_gcd_weight(svc);
+	data->mw = ip_vs_wrr_max_weight(svc) - (data->di - 1);
+	data->gen++;
+	write_sequnlock_bh(&data->lock);
 	return 0;
 }
 
@@ -161,15 +188,35 @@ ip_vs_wrr_schedule(struct ip_vs_service *svc, const struct sk_buff *skb,
 		   struct ip_vs_iphdr *iph)
 {
 	struct ip_vs_dest *dest, *last, *stop = NULL;
-	struct ip_vs_wrr_mark *mark = svc->sched_data;
+	struct ip_vs_wrr_data *data = svc->sched_data;
+	struct ip_vs_wrr_mark *mark;
 	bool last_pass = false, restarted = false;
+	unsigned int seq, gen;
+	int mw, di;
 
 	IP_VS_DBG(6, "%s(): Scheduling...\n", __func__);
 
-	spin_lock_bh(&svc->sched_lock);
+	do {
+		seq = read_seqbegin(&data->lock);
+		mw = data->mw;
+		di = data->di;
+		gen = data->gen;
+	} while (read_seqretry(&data->lock, seq));
+
+	local_bh_disable();
+	mark = this_cpu_ptr(data->marks);
+	if (unlikely(mark->gen != gen)) {
+		mark->cl = list_entry(&svc->destinations, struct ip_vs_dest,
+				      n_list);
+		if (mark->cw > mw || !mark->cw)
+			mark->cw = mw;
+		else if (di > 1)
+			mark->cw = (mark->cw / di) * di + 1;
+		mark->gen = gen;
+	}
 	dest = mark->cl;
 	/* No available dests? */
-	if (mark->mw == 0)
+	if (mw == 0)
 		goto err_noavail;
 	last = dest;
 	/* Stop only after all dests were checked for weight >= 1 (last pass) */
@@ -183,9 +230,9 @@ ip_vs_wrr_schedule(struct ip_vs_service *svc, const struct sk_buff *skb,
 			if (dest == stop)
 				goto err_over;
 		}
-		mark->cw -= mark->di;
+		mark->cw -= di;
 		if (mark->cw <= 0) {
-			mark->cw = mark->mw;
+			mark->cw = mw;
 			/* Stop if we tried last pass from first dest:
 			 * 1. last_pass: we started checks when cw > di but
 			 *	then all dests were checked for w >= 1
@@ -197,7 +244,7 @@ ip_vs_wrr_schedule(struct ip_vs_service *svc, const struct sk_buff *skb,
 				goto err_over;
 			restarted = true;
 		}
-		last_pass = mark->cw <= mark->di;
+		last_pass = mark->cw <= di;
 		if (last_pass && restarted &&
 		    &last->n_list != &svc->destinations) {
 			/* First traversal was for w >= 1 but only
@@ -218,7 +265,7 @@ ip_vs_wrr_schedule(struct ip_vs_service *svc, const struct sk_buff *skb,
 	mark->cl = dest;
 
   out:
-	spin_unlock_bh(&svc->sched_lock);
+	local_bh_enable();
 	return dest;
 
 err_noavail:
@@ -257,7 +304,7 @@ static int __init ip_vs_wrr_init(void)
 static void __exit ip_vs_wrr_cleanup(void)
 {
 	unregister_ip_vs_scheduler(&ip_vs_wrr_scheduler);
-	synchronize_rcu();
+	rcu_barrier();	/* wait for the marks to be freed */
 }
 
 module_init(ip_vs_wrr_init);
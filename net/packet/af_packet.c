@@ -91,9 +91,15 @@
 #endif
 #include <linux/bpf.h>
 #include <net/compat.h>
+#include <net/busy_poll.h>
 
 #include "internal.h"
 
+static bool tpacket_v3_adaptive_tov;
+module_param(tpacket_v3_adaptive_tov, bool, 0644);
+MODULE_PARM_DESC(tpacket_v3_adaptive_tov,
+		 "Scale TPACKET_V3 block retire timeout with the packet rate");
+
 /*
    Assumptions:
    - If the device has no dev->header_ops->create, there is no LL header
@@ -644,6 +650,8 @@ static void init_prb_bdqc(struct packet_sock *po,
 		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
 						req_u->req3.tp_block_size);
 	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
+	p1->tov_max_jiffies = p1->tov_in_jiffies;
+	p1->adaptive_tov = READ_ONCE(tpacket_v3_adaptive_tov);
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 	rwlock_init(&p1->blk_fill_in_prog_lock);
 
@@ -956,6 +964,30 @@ static void *prb_dispatch_next_block(struct tpacket_kbdq_core *pkc,
 	return (void *)pkc->nxt_offset;
 }
 
+/*
+ * Adaptive retire:
+ * With the timeout set for the line rate, a trickle of packets sits in a
+ * mostly empty block for the whole tmo, which is pure latency.  So when
+ * the timer retires a block holding only a few packets, halve the tmo;
+ * when a block fills up, or the timer finds a well filled one, double it
+ * back towards the configured value so that busy links keep filling whole
+ * blocks and waking user-space once per block.
+ */
+#define PRB_ADAPT_LOW_PKTS	16
+
+static void prb_adapt_retire_tov(struct tpacket_kbdq_core *pkc,
+		unsigned int status, unsigned int num_pkts)
+{
+	if (!pkc->adaptive_tov)
+		return;
+
+	if ((status & TP_STATUS_BLK_TMO) && num_pkts < PRB_ADAPT_LOW_PKTS)
+		pkc->tov_in_jiffies = max(pkc->tov_in_jiffies / 2, 1UL);
+	else
+		pkc->tov_in_jiffies = min(pkc->tov_in_jiffies * 2,
+					  pkc->tov_max_jiffies);
+}
+
 static void prb_retire_current_block(struct tpacket_kbdq_core *pkc,
 		struct packet_sock *po, unsigned int status)
 {
@@ -977,6 +1009,12 @@ static void prb_retire_current_block(struct tpacket_kbdq_core *pkc,
 			write_lock(&pkc->blk_fill_in_prog_lock);
 			write_unlock(&pkc->blk_fill_in_prog_lock);
 		}
+		if (status & TP_STATUS_BLK_TMO)
+			pkc->blk_retire_tmo++;
+		else
+			pkc->blk_retire_full++;
+		/* the block belongs to user-space once closed */
+		prb_adapt_retire_tov(pkc, status, BLOCK_NUM_PKTS(pbd));
 		prb_close_block(pkc, pbd, po, status);
 		return;
 	}
@@ -1430,9 +1468,9 @@ static unsigned int fanout_demux_rollover(struct packet_fanout *f,
 		    packet_rcv_has_room(po_next, skb) == ROOM_NORMAL) {
 			if (i != j)
 				po->rollover->sock = i;
-			atomic_long_inc(&po->rollover->num);
+			this_cpu_inc(po->rollover->stats->num);
 			if (room == ROOM_LOW)
-				atomic_long_inc(&po->rollover->num_huge);
+				this_cpu_inc(po->rollover->stats->num_huge);
 			return i;
 		}
 
@@ -1440,10 +1478,83 @@ static unsigned int fanout_demux_rollover(struct packet_fanout *f,
 			i = 0;
 	} while (i != j);
 
-	atomic_long_inc(&po->rollover->num_failed);
+	this_cpu_inc(po->rollover->stats->num_failed);
 	return idx;
 }
 
+/* Receive backlog of @po, in percent of its socket buffer or ring. */
+static unsigned int packet_rcv_load(const struct packet_sock *po)
+{
+	const struct sock *sk = &po->sk;
+
+	if (po->prot_hook.func != tpacket_rcv) {
+		int rcvbuf = READ_ONCE(sk->sk_rcvbuf);
+		int rmem = atomic_read(&sk->sk_rmem_alloc);
+
+		if (rcvbuf <= 0 || rmem >= rcvbuf)
+			return 100;
+		return div_u64((u64)rmem * 100, rcvbuf);
+	}
+
+	/* Rings fill contiguously from the head, so a free slot half,
+	 * a quarter or an eighth of the ring ahead bounds the backlog.
+	 */
+	if (po->tp_version == TPACKET_V3) {
+		if (__tpacket_v3_has_room(po, 1))
+			return 50;
+		if (__tpacket_v3_has_room(po, 2))
+			return 75;
+		if (__tpacket_v3_has_room(po, 3))
+			return 87;
+		return __tpacket_v3_has_room(po, 0) ? 99 : 100;
+	}
+
+	if (__tpacket_has_room(po, 1))
+		return 50;
+	if (__tpacket_has_room(po, 2))
+		return 75;
+	if (__tpacket_has_room(po, 3))
+		return 87;
+	return __tpacket_has_room(po, 0) ? 99 : 100;
+}
+
+/*
+ * Least loaded: a flow stays on its hash member while that member's
+ * backlog is below the group's load_threshold, then goes to whichever
+ * member is least loaded at that moment.  Moves are accounted in the
+ * hash member's rollover stats (num, or num_failed if no member was
+ * less loaded).
+ */
+static unsigned int fanout_demux_least_loaded(struct packet_fanout *f,
+					      struct sk_buff *skb,
+					      unsigned int num)
+{
+	unsigned int idx = fanout_demux_hash(f, skb, num);
+	unsigned int i, best = idx, load, best_load;
+	struct packet_sock *po;
+
+	po = pkt_sk(rcu_dereference(f->arr[idx]));
+	best_load = packet_rcv_load(po);
+	if (best_load < READ_ONCE(f->load_threshold))
+		return idx;
+
+	for (i = 0; i < num; i++) {
+		if (i == idx)
+			continue;
+		load = packet_rcv_load(pkt_sk(rcu_dereference(f->arr[i])));
+		if (load < best_load) {
+			best = i;
+			best_load = load;
+		}
+	}
+
+	if (best != idx)
+		this_cpu_inc(po->rollover->stats->num);
+	else
+		this_cpu_inc(po->rollover->stats->num_failed);
+	return best;
+}
+
 static unsigned int fanout_demux_qm(struct packet_fanout *f,
 				    struct sk_buff *skb,
 				    unsigned int num)
@@ -1511,6 +1622,9 @@ static int packet_rcv_fanout(struct sk_buff *skb, struct net_device *dev,
 	case PACKET_FANOUT_ROLLOVER:
 		idx = fanout_demux_rollover(f, skb, 0, false, num);
 		break;
+	case PACKET_FANOUT_LEAST_LOADED:
+		idx = fanout_demux_least_loaded(f, skb, num);
+		break;
 	case PACKET_FANOUT_CBPF:
 	case PACKET_FANOUT_EBPF:
 		idx = fanout_demux_bpf(f, skb, num);
@@ -1577,6 +1691,9 @@ static void fanout_init_data(struct packet_fanout *f)
 	case PACKET_FANOUT_LB:
 		atomic_set(&f->rr_cur, 0);
 		break;
+	case PACKET_FANOUT_LEAST_LOADED:
+		f->load_threshold = FANOUT_LOAD_THRESHOLD_DEF;
+		break;
 	case PACKET_FANOUT_CBPF:
 	case PACKET_FANOUT_EBPF:
 		RCU_INIT_POINTER(f->bpf_prog, NULL);
@@ -1642,6 +1759,23 @@ static int fanout_set_data_ebpf(struct packet_sock *po, sockptr_t data,
 	return 0;
 }
 
+/* PACKET_FANOUT_DATA on a least-loaded group sets its threshold (%) */
+static int fanout_set_data_load(struct packet_sock *po, sockptr_t data,
+				unsigned int len)
+{
+	u32 val;
+
+	if (len != sizeof(val))
+		return -EINVAL;
+	if (copy_from_sockptr(&val, data, len))
+		return -EFAULT;
+	if (val > 100)
+		return -EINVAL;
+
+	WRITE_ONCE(po->fanout->load_threshold, val);
+	return 0;
+}
+
 static int fanout_set_data(struct packet_sock *po, sockptr_t data,
 			   unsigned int len)
 {
@@ -1650,6 +1784,8 @@ static int fanout_set_data(struct packet_sock *po, sockptr_t data,
 		return fanout_set_data_cbpf(po, data, len);
 	case PACKET_FANOUT_EBPF:
 		return fanout_set_data_ebpf(po, data, len);
+	case PACKET_FANOUT_LEAST_LOADED:
+		return fanout_set_data_load(po, data, len);
 	default:
 		return -EINVAL;
 	}
@@ -1694,6 +1830,13 @@ static bool fanout_find_new_id(struct sock *sk, u16 *new_id)
 	return false;
 }
 
+static void packet_rollover_free(struct packet_rollover *rollover)
+{
+	if (rollover)
+		free_percpu(rollover->stats);
+	kfree(rollover);
+}
+
 static int fanout_add(struct sock *sk, struct fanout_args *args)
 {
 	struct packet_rollover *rollover = NULL;
@@ -1715,6 +1858,7 @@ static int fanout_add(struct sock *sk, struct fanout_args *args)
 	case PACKET_FANOUT_CPU:
 	case PACKET_FANOUT_RND:
 	case PACKET_FANOUT_QM:
+	case PACKET_FANOUT_LEAST_LOADED:
 	case PACKET_FANOUT_CBPF:
 	case PACKET_FANOUT_EBPF:
 		break;
@@ -1729,14 +1873,15 @@ static int fanout_add(struct sock *sk, struct fanout_args *args)
 		goto out;
 
 	if (type == PACKET_FANOUT_ROLLOVER ||
+	    type == PACKET_FANOUT_LEAST_LOADED ||
 	    (type_flags & PACKET_FANOUT_FLAG_ROLLOVER)) {
 		err = -ENOMEM;
 		rollover = kzalloc(sizeof(*rollover), GFP_KERNEL);
 		if (!rollover)
 			goto out;
-		atomic_long_set(&rollover->num, 0);
-		atomic_long_set(&rollover->num_huge, 0);
-		atomic_long_set(&rollover->num_failed, 0);
+		rollover->stats = alloc_percpu(struct packet_rollover_stats);
+		if (!rollover->stats)
+			goto out;
 	}
 
 	if (type_flags & PACKET_FANOUT_FLAG_UNIQUEID) {
@@ -1824,7 +1969,7 @@ static int fanout_add(struct sock *sk, struct fanout_args *args)
 	}
 
 out:
-	kfree(rollover);
+	packet_rollover_free(rollover);
 	mutex_unlock(&fanout_mutex);
 	return err;
 }
@@ -2303,6 +2448,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		goto drop_n_restore;
 	}
 
+	sk_mark_napi_id(sk, skb);
+
 	if (skb->ip_summed == CHECKSUM_PARTIAL)
 		status |= TP_STATUS_CSUMNOTREADY;
 	else if (skb->pkt_type != PACKET_OUTGOING &&
@@ -3174,7 +3321,7 @@ static int packet_release(struct socket *sock)
 
 	synchronize_net();
 
-	kfree(po->rollover);
+	packet_rollover_free(po->rollover);
 	if (f) {
 		fanout_release_data(f);
 		kvfree(f);
@@ -4063,7 +4210,7 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 	void *data = &val;
 	union tpacket_stats_u st;
 	struct tpacket_rollover_stats rstats;
-	int drops;
+	int drops, cpu;
 
 	if (level != SOL_PACKET)
 		return -ENOPROTOOPT;
@@ -4150,9 +4297,15 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 	case PACKET_ROLLOVER_STATS:
 		if (!po->rollover)
 			return -EINVAL;
-		rstats.tp_all = atomic_long_read(&po->rollover->num);
-		rstats.tp_huge = atomic_long_read(&po->rollover->num_huge);
-		rstats.tp_failed = atomic_long_read(&po->rollover->num_failed);
+		memset(&rstats, 0, sizeof(rstats));
+		for_each_possible_cpu(cpu) {
+			const struct packet_rollover_stats *rs;
+
+			rs = per_cpu_ptr(po->rollover->stats, cpu);
+			rstats.tp_all += READ_ONCE(rs->num);
+			rstats.tp_huge += READ_ONCE(rs->num_huge);
+			rstats.tp_failed += READ_ONCE(rs->num_failed);
+		}
 		data = &rstats;
 		lv = sizeof(rstats);
 		break;
@@ -4273,6 +4426,50 @@ static int packet_ioctl(struct socket *sock, unsigned int cmd,
 	return 0;
 }
 
+static bool packet_rx_ring_ready(struct packet_sock *po)
+{
+	struct sock *sk = &po->sk;
+	bool ready = false;
+
+	spin_lock_bh(&sk->sk_receive_queue.lock);
+	if (po->rx_ring.pg_vec)
+		ready = !packet_previous_rx_frame(po, &po->rx_ring,
+						  TP_STATUS_KERNEL);
+	spin_unlock_bh(&sk->sk_receive_queue.lock);
+
+	return ready;
+}
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+static bool packet_busy_loop_end(void *p, unsigned long start_time)
+{
+	struct sock *sk = p;
+
+	return packet_rx_ring_ready(pkt_sk(sk)) ||
+	       sk_busy_loop_timeout(sk, start_time);
+}
+
+/*
+ * Frames land in the ring, not in sk_receive_queue, so sk_busy_loop()
+ * would never see them arrive; spin on the ring's block status instead.
+ */
+static void packet_ring_busy_loop(struct sock *sk)
+{
+	unsigned int napi_id = READ_ONCE(sk->sk_napi_id);
+
+	if (napi_id < MIN_NAPI_ID || packet_rx_ring_ready(pkt_sk(sk)))
+		return;
+
+	napi_busy_loop(napi_id, packet_busy_loop_end, sk,
+		       READ_ONCE(sk->sk_prefer_busy_poll),
+		       READ_ONCE(sk->sk_busy_poll_budget) ?: BUSY_POLL_BUDGET);
+}
+#else
+static inline void packet_ring_busy_loop(struct sock *sk)
+{
+}
+#endif
+
 static __poll_t packet_poll(struct file *file, struct socket *sock,
 				poll_table *wait)
 {
@@ -4280,6 +4477,10 @@ static __poll_t packet_poll(struct file *file, struct socket *sock,
 	struct packet_sock *po = pkt_sk(sk);
 	__poll_t mask = datagram_poll(file, sock, wait);
 
+	if (po->tp_version == TPACKET_V3 && po->rx_ring.pg_vec &&
+	    sk_can_busy_loop(sk))
+		packet_ring_busy_loop(sk);
+
 	spin_lock_bh(&sk->sk_receive_queue.lock);
 	if (po->rx_ring.pg_vec) {
 		if (!packet_previous_rx_frame(po, &po->rx_ring,
@@ -4731,6 +4932,85 @@ static const struct seq_operations packet_seq_ops = {
 	.stop	= packet_seq_stop,
 	.show	= packet_seq_show,
 };
+
+static int packet_ring_seq_show(struct seq_file *seq, void *v)
+{
+	if (v == SEQ_START_TOKEN)
+		seq_puts(seq,
+			 "Inode  Blocks Tov    TovMax Full       Timeout    Frozen\n");
+	else {
+		struct sock *s = sk_entry(v);
+		const struct packet_sock *po = pkt_sk(s);
+		const struct tpacket_kbdq_core *pkc = &po->rx_ring.prb_bdqc;
+
+		if (po->tp_version != TPACKET_V3 || !po->rx_ring.pg_vec)
+			return 0;
+
+		seq_printf(seq, "%-6lu %-6u %-6u %-6u %-10lu %-10lu %-10u\n",
+			   sock_i_ino(s),
+			   pkc->knum_blocks,
+			   jiffies_to_msecs(READ_ONCE(pkc->tov_in_jiffies)),
+			   jiffies_to_msecs(pkc->tov_max_jiffies),
+			   READ_ONCE(pkc->blk_retire_full),
+			   READ_ONCE(pkc->blk_retire_tmo),
+			   po->stats.stats3.tp_freeze_q_cnt);
+	}
+
+	return 0;
+}
+
+static const struct seq_operations packet_ring_seq_ops = {
+	.start	= packet_seq_start,
+	.next	= packet_seq_next,
+	.stop	= packet_seq_stop,
+	.show	= packet_ring_seq_show,
+};
+
+static int packet_fanout_seq_show(struct seq_file *seq, void *v)
+{
+	if (v == SEQ_START_TOKEN)
+		seq_puts(seq,
+			 "Inode  Id    Type Rollover   Huge       Failed     Drops\n");
+	else {
+		struct sock *s = sk_entry(v);
+		const struct packet_sock *po = pkt_sk(s);
+		const struct packet_rollover *rollover;
+		const struct packet_fanout *f;
+		struct packet_rollover_stats rs = {};
+		int cpu;
+
+		/* both are freed only after an RCU grace period */
+		f = READ_ONCE(po->fanout);
+		if (!f)
+			return 0;
+
+		rollover = READ_ONCE(po->rollover);
+		if (rollover) {
+			for_each_possible_cpu(cpu) {
+				const struct packet_rollover_stats *p;
+
+				p = per_cpu_ptr(rollover->stats, cpu);
+				rs.num += READ_ONCE(p->num);
+				rs.num_huge += READ_ONCE(p->num_huge);
+				rs.num_failed += READ_ONCE(p->num_failed);
+			}
+		}
+
+		seq_printf(seq, "%-6lu %-5u %-4u %-10lu %-10lu %-10lu %-10u\n",
+			   sock_i_ino(s), f->id, f->type,
+			   rs.num, rs.num_huge, rs.num_failed,
+			   atomic_read(&po->tp_drops));
+	}
+
+	return 0;
+}
+
+static const struct seq_operations packet_fanout_seq_ops = {
+	.start	= packet_seq_start,
+	.next	= packet_seq_next,
+	.stop	= packet_seq_stop,
+	.show	= packet_fanout_seq_show,
+};
 #endif
 
 static int __net_init packet_net_init(struct net *net)
@@ -4742,13 +5022,29 @@ static int __net_init packet_net_init(struct net *net)
 	if (!proc_create_net("packet", 0, net->proc_net, &packet_seq_ops,
 			sizeof(struct seq_net_private)))
 		return -ENOMEM;
+	if (!proc_create_net("packet_v3_ring", 0, net->proc_net,
+			&packet_ring_seq_ops, sizeof(struct seq_net_private)))
+		goto err_ring;
+	if (!proc_create_net("packet_fanout", 0, net->proc_net,
+			&packet_fanout_seq_ops, sizeof(struct seq_net_private)))
+		goto err_fanout;
 #endif /* CONFIG_PROC_FS */
 
 	return 0;
+
+#ifdef CONFIG_PROC_FS
+err_fanout:
+	remove_proc_entry("packet_v3_ring", net->proc_net);
+err_ring:
+	remove_proc_entry("packet", net->proc_net);
+	return -ENOMEM;
+#endif
 }
 
 static void __net_exit packet_net_exit(struct net *net)
 {
+	remove_proc_entry("packet_fanout", net->proc_net);
+	remove_proc_entry("packet_v3_ring", net->proc_net);
 	remove_proc_entry("packet", net->proc_net);
 	WARN_ON_ONCE(!hlist_empty(&net->packet.sklist));
 }
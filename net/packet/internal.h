@@ -48,6 +48,14 @@ struct tpacket_kbdq_core {
 	unsigned short  version;
 	unsigned long	tov_in_jiffies;
 
+	/* adaptive retire moves tov_in_jiffies within [1, tov_max_jiffies] */
+	unsigned char	adaptive_tov;
+	unsigned long	tov_max_jiffies;
+
+	/* why blocks were handed to user-space */
+	unsigned long	blk_retire_full;
+	unsigned long	blk_retire_tmo;
+
 	/* timer to retire an outstanding block */
 	struct timer_list retire_blk_timer;
 };
@@ -79,6 +87,14 @@ struct packet_ring_buffer {
 extern struct mutex fanout_mutex;
 #define PACKET_FANOUT_MAX	(1 << 16)
 
+/* Next free fanout type after PACKET_FANOUT_EBPF; the uapi
+ * <linux/if_packet.h> is not carried in this tree.
+ */
+#define PACKET_FANOUT_LEAST_LOADED	8
+
+/* default backlog, in percent, above which least-loaded moves a flow */
+#define FANOUT_LOAD_THRESHOLD_DEF	75
+
 struct packet_fanout {
 	possible_net_t		net;
 	unsigned int		num_members;
@@ -89,6 +105,7 @@ struct packet_fanout {
 	union {
 		atomic_t		rr_cur;
 		struct bpf_prog __rcu	*bpf_prog;
+		unsigned int		load_threshold;
 	};
 	struct list_head	list;
 	spinlock_t		lock;
@@ -97,11 +114,16 @@ struct packet_fanout {
 	struct sock	__rcu	*arr[];
 };
 
+struct packet_rollover_stats {
+	unsigned long		num;
+	unsigned long		num_huge;
+	unsigned long		num_failed;
+};
+
 struct packet_rollover {
 	int			sock;
-	atomic_long_t		num;
-	atomic_long_t		num_huge;
-	atomic_long_t		num_failed;
+	/* bumped from whichever CPU demuxed the packet */
+	struct packet_rollover_stats __percpu *stats;
 #define ROLLOVER_HLEN	(L1_CACHE_BYTES / sizeof(u32))
 	u32			history[ROLLOVER_HLEN] ____cacheline_aligned;
 } ____cacheline_aligned_in_smp;
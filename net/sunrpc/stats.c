@@ -244,6 +244,11 @@ static int do_print_stats(struct rpc_clnt *clnt, struct rpc_xprt *xprt, void *se
 	struct seq_file *seq = seqv;
 
 	xprt->ops->print_stats(xprt, seq);
+	if (xprt->stat.recv_wakeups)
+		seq_printf(seq, "\txprt_recv:\t%lu %lu %lu\n",
+			   xprt->stat.recv_wakeups,
+			   xprt->stat.recv_batched,
+			   xprt->stat.recv_batch_max);
 	return 0;
 }
 
@@ -37,7 +37,7 @@
 
 static void svc_unregister(const struct svc_serv *serv, struct net *net);
 
-#define SVC_POOL_DEFAULT	SVC_POOL_GLOBAL
+#define SVC_POOL_DEFAULT	SVC_POOL_AUTO
 
 /*
  * Mode for mapping cpus to pools.
@@ -378,8 +378,27 @@ svc_pool_for_cpu(struct svc_serv *serv, int cpu)
 		pidx = m->to_pool[cpu_to_node(cpu)];
 		break;
 	}
+	pidx %= serv->sv_nrpools;
 
-	return &serv->sv_pools[pidx % serv->sv_nrpools];
+	/*
+	 * With fewer threads than pools some pools have none; queue on
+	 * the next pool that has threads rather than on one nobody will
+	 * ever service.
+	 */
+	if (unlikely(!READ_ONCE(serv->sv_pools[pidx].sp_nrthreads))) {
+		unsigned int i;
+
+		for (i = 1; i < serv->sv_nrpools; i++) {
+			unsigned int next = (pidx + i) % serv->sv_nrpools;
+
+			if (READ_ONCE(serv->sv_pools[next].sp_nrthreads)) {
+				pidx = next;
+				break;
+			}
+		}
+	}
+
+	return &serv->sv_pools[pidx];
 }
 
 int svc_rpcb_setup(struct svc_serv *serv, struct net *net)
@@ -468,6 +468,7 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 	atomic_long_inc(&pool->sp_stats.packets);
 
 	spin_lock_bh(&pool->sp_lock);
+	xprt->xpt_qtime = ktime_get();
 	list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
 	pool->sp_stats.sockets_queued++;
 	spin_unlock_bh(&pool->sp_lock);
@@ -491,12 +492,24 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 }
 EXPORT_SYMBOL_GPL(svc_xprt_enqueue);
 
+static void svc_pool_account_wait(struct svc_pool *pool, ktime_t qtime)
+{
+	s64 us = ktime_us_delta(ktime_get(), qtime);
+	unsigned int bucket = 0;
+
+	if (us > 0)
+		bucket = min_t(unsigned int, ilog2(us) / 2 + 1,
+			       SVC_POOL_WAIT_BUCKETS - 1);
+	atomic_long_inc(&pool->sp_stats.wait_hist[bucket]);
+}
+
 /*
  * Dequeue the first transport, if there is one.
  */
 static struct svc_xprt *svc_xprt_dequeue(struct svc_pool *pool)
 {
 	struct svc_xprt	*xprt = NULL;
+	ktime_t qtime;
 
 	if (list_empty(&pool->sp_sockets))
 		goto out;
@@ -506,9 +519,12 @@ static struct svc_xprt *svc_xprt_dequeue(struct svc_pool *pool)
 		xprt = list_first_entry(&pool->sp_sockets,
 					struct svc_xprt, xpt_ready);
 		list_del_init(&xprt->xpt_ready);
+		qtime = xprt->xpt_qtime;
 		svc_xprt_get(xprt);
 	}
 	spin_unlock_bh(&pool->sp_lock);
+	if (xprt)
+		svc_pool_account_wait(pool, qtime);
 out:
 	return xprt;
 }
@@ -1445,19 +1461,31 @@ static void svc_pool_stats_stop(struct seq_file *m, void *p)
 
 static int svc_pool_stats_show(struct seq_file *m, void *p)
 {
+	static const char * const wait_names[SVC_POOL_WAIT_BUCKETS] = {
+		"lt-1us", "lt-4us", "lt-16us", "lt-64us", "lt-256us",
+		"lt-1ms", "lt-4ms", "lt-16ms", "lt-65ms", "ge-65ms",
+	};
 	struct svc_pool *pool = p;
+	int i;
 
 	if (p == SEQ_START_TOKEN) {
-		seq_puts(m, "# pool packets-arrived sockets-enqueued threads-woken threads-timedout\n");
+		seq_puts(m, "# pool packets-arrived sockets-enqueued threads-woken threads-timedout");
+		for (i = 0; i < SVC_POOL_WAIT_BUCKETS; i++)
+			seq_printf(m, " wait-%s", wait_names[i]);
+		seq_putc(m, '\n');
 		return 0;
 	}
 
-	seq_printf(m, "%u %lu %lu %lu %lu\n",
+	seq_printf(m, "%u %lu %lu %lu %lu",
 		pool->sp_id,
 		(unsigned long)atomic_long_read(&pool->sp_stats.packets),
 		pool->sp_stats.sockets_queued,
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_woken),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_timedout));
+	for (i = 0; i < SVC_POOL_WAIT_BUCKETS; i++)
+		seq_printf(m, " %lu", (unsigned long)
+			   atomic_long_read(&pool->sp_stats.wait_hist[i]));
+	seq_putc(m, '\n');
 
 	return 0;
 }
@@ -592,6 +592,27 @@ xs_read_stream_call(struct sock_xprt *transport, struct msghdr *msg, int flags)
 }
 #endif /* CONFIG_SUNRPC_BACKCHANNEL */
 
+/* Caller holds xprt->queue_lock */
+static void xs_read_stream_complete_deferred(struct sock_xprt *transport)
+{
+	struct rpc_rqst *req = transport->recv.done;
+
+	transport->recv.done = NULL;
+	xprt_complete_rqst(req->rq_task, transport->recv.done_copied);
+	xprt_unpin_rqst(req);
+}
+
+static void xs_read_stream_flush_deferred(struct sock_xprt *transport)
+{
+	struct rpc_xprt *xprt = &transport->xprt;
+
+	if (!transport->recv.done)
+		return;
+	spin_lock(&xprt->queue_lock);
+	xs_read_stream_complete_deferred(transport);
+	spin_unlock(&xprt->queue_lock);
+}
+
 static ssize_t
 xs_read_stream_reply(struct sock_xprt *transport, struct msghdr *msg, int flags)
 {
@@ -601,6 +622,10 @@ xs_read_stream_reply(struct sock_xprt *transport, struct msghdr *msg, int flags)
 
 	/* Look up and lock the request corresponding to the given XID */
 	spin_lock(&xprt->queue_lock);
+	if (transport->recv.done) {
+		xs_read_stream_complete_deferred(transport);
+		xprt->stat.recv_batched++;
+	}
 	req = xprt_lookup_rqst(xprt, transport->recv.xid);
 	if (!req || (transport->recv.copied && !req->rq_private_buf.len)) {
 		msg->msg_flags |= MSG_TRUNC;
@@ -611,11 +636,18 @@ xs_read_stream_reply(struct sock_xprt *transport, struct msghdr *msg, int flags)
 
 	ret = xs_read_stream_request(transport, msg, flags, req);
 
+	if (msg->msg_flags & (MSG_EOR|MSG_TRUNC)) {
+		/* Leave it pinned; it is completed under the queue_lock
+		 * hold that looks up the next reply, or once the socket
+		 * has been drained.
+		 */
+		transport->recv.done = req;
+		transport->recv.done_copied = transport->recv.copied;
+		return ret;
+	}
+
 	spin_lock(&xprt->queue_lock);
-	if (msg->msg_flags & (MSG_EOR|MSG_TRUNC))
-		xprt_complete_rqst(req->rq_task, transport->recv.copied);
-	else
-		req->rq_private_buf.len = transport->recv.copied;
+	req->rq_private_buf.len = transport->recv.copied;
 	xprt_unpin_rqst(req);
 out:
 	spin_unlock(&xprt->queue_lock);
@@ -710,6 +742,8 @@ static void xs_poll_check_readable(struct sock_xprt *transport)
 
 static void xs_stream_data_receive(struct sock_xprt *transport)
 {
+	struct rpc_xprt *xprt = &transport->xprt;
+	unsigned long recvs = xprt->stat.recvs;
 	size_t read = 0;
 	ssize_t ret = 0;
 
@@ -721,8 +755,20 @@ static void xs_stream_data_receive(struct sock_xprt *transport)
 		if (ret < 0)
 			break;
 		read += ret;
-		cond_resched();
+		if (need_resched()) {
+			xs_read_stream_flush_deferred(transport);
+			cond_resched();
+		}
 	}
+	xs_read_stream_flush_deferred(transport);
+
+	recvs = xprt->stat.recvs - recvs;
+	if (recvs) {
+		xprt->stat.recv_wakeups++;
+		if (recvs > xprt->stat.recv_batch_max)
+			xprt->stat.recv_batch_max = recvs;
+	}
+
 	if (ret == -ESHUTDOWN)
 		kernel_sock_shutdown(transport->sock, SHUT_RDWR);
 	else
@@ -49,6 +49,21 @@ struct tls_decrypt_arg {
 	bool async;
 };
 
+/* Records a socket may have queued on an async AEAD, per direction, before
+ * waiting for them to finish; 0 leaves it to the crypto engine's backlog.
+ */
+static unsigned int async_depth;
+module_param(async_depth, uint, 0644);
+MODULE_PARM_DESC(async_depth, "Max async crypto records in flight per socket and direction (0 = unlimited)");
+
+/* The *_pending counters carry a bias of one while nothing is in flight. */
+static bool tls_async_depth_reached(atomic_t *pending)
+{
+	unsigned int depth = READ_ONCE(async_depth);
+
+	return depth && atomic_read(pending) > depth;
+}
+
 noinline void tls_err_abort(struct sock *sk, int err)
 {
 	WARN_ON_ONCE(err >= 0);
@@ -265,6 +280,12 @@ static int tls_do_decryption(struct sock *sk,
 			       (u8 *)iv_recv);
 
 	if (darg->async) {
+		if (tls_async_depth_reached(&ctx->decrypt_pending)) {
+			ret = tls_decrypt_async_wait(ctx);
+			if (ret)
+				return ret;
+		}
+
 		/* Using skb->sk to push sk through to crypto async callback
 		 * handler. This allows propagating errors up to the socket
 		 * if needed. It _must_ be cleared in the async handler
@@ -534,6 +555,13 @@ static int tls_do_encryption(struct sock *sk,
 	struct scatterlist *sge = sk_msg_elem(msg_en, start);
 	int rc, iv_offset = 0;
 
+	if (ctx->async_capable &&
+	    tls_async_depth_reached(&ctx->encrypt_pending)) {
+		rc = tls_encrypt_async_wait(ctx);
+		if (rc)
+			return rc;
+	}
+
 	/* For CCM based ciphers, first byte of IV is a constant */
 	if (prot->cipher_type == TLS_CIPHER_AES_CCM_128) {
 		rec->iv_data[0] = TLS_AES_CCM_IV_B0_BYTE;
@@ -496,6 +496,7 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	skb_queue_purge(&sk->sk_error_queue);
 
 	WARN_ON(refcount_read(&sk->sk_wmem_alloc));
 	WARN_ON(!sk_unhashed(sk));
@@ -2021,6 +2022,42 @@ static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other
 }
 #endif
 
+/* Leave one frag spare so an unaligned user buffer still fits */
+#define UNIX_SKB_ZEROCOPY_SZ	((MAX_SKB_FRAGS - 1) * PAGE_SIZE)
+
+static bool unix_zerocopy_ok(struct sock *sk, struct msghdr *msg, size_t len)
+{
+	int min_size = READ_ONCE(sock_net(sk)->unx.sysctl_zerocopy_min_size);
+
+	/* Only user memory can be pinned; kernel senders keep copying */
+	return min_size > 0 && len >= min_size &&
+	       iter_is_iovec(&msg->msg_iter);
+}
+
+/* Pin @size bytes of the user buffer into the frags of the headless @skb.
+ * The pinned pages are charged to the sender like copied data so that
+ * sk_sndbuf still bounds what a slow reader can hold on to, and the
+ * completion is reported on the sender's error queue once the reader
+ * has consumed (or dropped) the skb.
+ */
+static int unix_zerocopy_fill(struct sk_buff *skb, struct msghdr *msg,
+			      int size, struct ubuf_info *uarg)
+{
+	struct iov_iter *from = &msg->msg_iter;
+	size_t left = iov_iter_count(from) - size;
+	int err;
+
+	/* The pinned pages are charged to skb->sk, the sender, as they go in */
+	iov_iter_truncate(from, size);
+	err = zerocopy_sg_from_iter(skb, from);
+	iov_iter_reexpand(from, iov_iter_count(from) + left);
+	if (err)
+		return err;
+
+	skb_zcopy_set(skb, uarg, NULL);
+	return 0;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
@@ -2032,6 +2069,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	struct scm_cookie scm;
 	bool fds_sent = false;
 	int data_len;
+	struct ubuf_info *uarg = NULL;
 
 	wait_for_unix_gc();
 	err = scm_send(sock, msg, &scm, false);
@@ -2061,12 +2099,43 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (READ_ONCE(sk->sk_shutdown) & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	if ((msg->msg_flags & MSG_ZEROCOPY) && unix_zerocopy_ok(sk, msg, len)) {
+		uarg = msg_zerocopy_realloc(sk, len, NULL);
+		if (!uarg) {
+			err = -ENOBUFS;
+			goto out_err;
+		}
+	}
+
 	while (sent < len) {
 		size = len - sent;
 
 		/* Keep two messages in the pipe so it schedules better */
 		size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
 
+		if (uarg) {
+			size = min_t(int, size, UNIX_SKB_ZEROCOPY_SZ);
+			skb = sock_alloc_send_pskb(sk, 0, 0,
+						   msg->msg_flags & MSG_DONTWAIT,
+						   &err, 0);
+			if (!skb)
+				goto out_err;
+
+			err = unix_scm_to_skb(&scm, skb, !fds_sent);
+			if (err < 0) {
+				kfree_skb(skb);
+				goto out_err;
+			}
+			fds_sent = true;
+
+			err = unix_zerocopy_fill(skb, msg, size, uarg);
+			if (err) {
+				kfree_skb(skb);
+				goto out_err;
+			}
+			goto queue;
+		}
+
 		/* allow fallback to order-0 allocations */
 		size = min_t(int, size, SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
 
@@ -2097,6 +2166,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			goto out_err;
 		}
 
+queue:
 		unix_state_lock(other);
 
 		if (sock_flag(other, SOCK_DEAD) ||
@@ -2120,6 +2190,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	}
 #endif
 
+	net_zcopy_put(uarg);
 	scm_destroy(&scm);
 
 	return sent;
@@ -2132,6 +2203,11 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		send_sig(SIGPIPE, current, 0);
 	err = -EPIPE;
 out_err:
+	/* Buffers already queued still complete under this notification id */
+	if (sent)
+		net_zcopy_put(uarg);
+	else
+		net_zcopy_put_abort(uarg, true);
 	scm_destroy(&scm);
 	return sent ? : err;
 }
@@ -2199,7 +2275,7 @@ static ssize_t unix_stream_sendpage(struct socket *socket, struct page *page,
 	skb = skb_peek_tail(&other->sk_receive_queue);
 	if (tail && tail == skb) {
 		skb = newskb;
-	} else if (!skb || !unix_skb_scm_eq(skb, &scm)) {
+	} else if (!skb || skb_zcopy(skb) || !unix_skb_scm_eq(skb, &scm)) {
 		if (newskb) {
 			skb = newskb;
 		} else {
@@ -2855,6 +2931,13 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 		return prot->recvmsg(sk, msg, size, flags & MSG_DONTWAIT,
 					    flags & ~MSG_DONTWAIT, NULL);
 #endif
+	/* MSG_ZEROCOPY completions, reported the way TCP reports them so
+	 * existing users can parse them unchanged.
+	 */
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return sock_recv_errqueue(sock->sk, msg, size,
+					  SOL_IP, IP_RECVERR);
+
 	return unix_stream_read_generic(&state, true);
 }
 
@@ -2862,6 +2945,10 @@ static int unix_stream_splice_actor(struct sk_buff *skb,
 				    int skip, int chunk,
 				    struct unix_stream_read_state *state)
 {
+	/* The pipe may outlive the skb; never hand it the sender's pages */
+	if (skb_orphan_frags_rx(skb, GFP_KERNEL))
+		return -ENOMEM;
+
 	return skb_splice_bits(skb, state->socket->sk,
 			       UNIXCB(skb).consumed + skip,
 			       state->pipe, chunk, state->splice_flags);
@@ -3065,7 +3152,8 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	state = READ_ONCE(sk->sk_state);
 
 	/* exceptional events? */
-	if (READ_ONCE(sk->sk_err))
+	if (READ_ONCE(sk->sk_err) ||
+	    !skb_queue_empty_lockless(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
@@ -3358,6 +3446,7 @@ static int __net_init unix_net_init(struct net *net)
 	int error = -ENOMEM;
 
 	net->unx.sysctl_max_dgram_qlen = 10;
+	net->unx.sysctl_zerocopy_min_size = 0;
 	if (unix_sysctl_register(net))
 		goto out;
 
@@ -31,6 +31,7 @@
 #include "xsk.h"
 
 #define TX_BATCH_SIZE 32
+#define XSK_GENERIC_XMIT_BURST 16
 
 static DEFINE_PER_CPU(struct list_head, xskmap_flush_list);
 
@@ -526,15 +527,151 @@ static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
 	return skb;
 }
 
+/* Hand a burst of descriptors that were built into skbs but not sent back
+ * to the Tx ring, releasing their completion queue slots.
+ */
+static void xsk_generic_xmit_unwind(struct xdp_sock *xs, struct sk_buff **skbs,
+				    u32 *cons, u32 from, u32 n)
+{
+	unsigned long flags;
+	u32 i;
+
+	if (from == n)
+		return;
+
+	for (i = from; i < n; i++) {
+		skbs[i]->destructor = sock_wfree;
+		/* Free skb without triggering the perf drop trace */
+		consume_skb(skbs[i]);
+	}
+
+	spin_lock_irqsave(&xs->pool->cq_lock, flags);
+	for (i = from; i < n; i++)
+		xskq_prod_cancel(xs->pool->cq);
+	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+
+	xskq_cons_rewind(xs->tx, cons[from]);
+}
+
+/* Drop built skbs that can no longer be handed back to the Tx ring.  Their
+ * destructor still completes the descriptors.
+ */
+static void xsk_generic_xmit_drop(struct xdp_sock *xs, struct sk_buff **skbs,
+				  u32 from, u32 n)
+{
+	u32 i;
+
+	for (i = from; i < n; i++) {
+		atomic_long_inc(&xs->dev->tx_dropped);
+		kfree_skb(skbs[i]);
+	}
+}
+
+/* Send a burst under one Tx queue lock, with xmit_more set on all but the
+ * last skb so the driver only kicks the hardware once.  This is
+ * __dev_direct_xmit() stretched over several skbs.  Returns the number of
+ * descriptors consumed; anything after that is unwound.
+ */
+static u32 xsk_generic_xmit_burst(struct xdp_sock *xs, struct sk_buff **skbs,
+				  u32 *cons, u32 n, int *err)
+{
+	struct net_device *dev = xs->dev;
+	netdev_tx_t ret = NETDEV_TX_OK;
+	struct sk_buff *bad = NULL;
+	struct netdev_queue *txq;
+	bool again = false;
+	u32 i, nv;
+
+	*err = -EBUSY;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev))) {
+		xsk_generic_xmit_drop(xs, skbs, 0, 1);
+		xsk_generic_xmit_unwind(xs, skbs, cons, 1, n);
+		return 1;
+	}
+
+	/* Validate outside the Tx lock, as __dev_direct_xmit() does.  The
+	 * burst ends at the first skb that does not pass: it is dropped and
+	 * the descriptors behind it go back to the ring.
+	 */
+	for (nv = 0; nv < n; nv++) {
+		bad = validate_xmit_skb_list(skbs[nv], dev, &again);
+		if (bad != skbs[nv]) {
+			xsk_generic_xmit_unwind(xs, skbs, cons, nv + 1, n);
+			break;
+		}
+		bad = NULL;
+		skb_set_queue_mapping(skbs[nv], xs->queue_id);
+	}
+
+	txq = netdev_get_tx_queue(dev, xs->queue_id);
+
+	local_bh_disable();
+
+	dev_xmit_recursion_inc();
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	for (i = 0; i < nv; i++) {
+		if (netif_xmit_frozen_or_drv_stopped(txq)) {
+			ret = NETDEV_TX_BUSY;
+			break;
+		}
+		ret = netdev_start_xmit(skbs[i], dev, txq, i + 1 < nv);
+		if (!dev_xmit_complete(ret))
+			break;
+		/* Ignore NET_XMIT_CN as packet might have been sent */
+		if (ret == NET_XMIT_DROP)
+			break;
+	}
+	HARD_TX_UNLOCK(dev, txq);
+	dev_xmit_recursion_dec();
+
+	local_bh_enable();
+
+	if (i == nv && !bad) {
+		*err = 0;
+		return n;
+	}
+
+	if (i < nv) {
+		if (ret == NETDEV_TX_BUSY && !bad) {
+			/* Tell user-space to retry the send */
+			xsk_generic_xmit_unwind(xs, skbs, cons, i, n);
+			*err = -EAGAIN;
+			return i;
+		}
+
+		/* SKB completed but not sent */
+		if (ret == NET_XMIT_DROP)
+			i++;
+	}
+
+	if (!bad) {
+		xsk_generic_xmit_unwind(xs, skbs, cons, i, n);
+		return i;
+	}
+
+	/* The descriptor of the skb that failed validation is consumed, so
+	 * the unsent ones ahead of it cannot go back to the ring either.
+	 */
+	xsk_generic_xmit_drop(xs, skbs, i, nv);
+	atomic_long_inc(&dev->tx_dropped);
+	kfree_skb_list(bad);
+	return nv + 1;
+}
+
 static int xsk_generic_xmit(struct sock *sk)
 {
+	struct sk_buff *skbs[XSK_GENERIC_XMIT_BURST];
+	u32 cons[XSK_GENERIC_XMIT_BURST];
 	struct xdp_sock *xs = xdp_sk(sk);
 	u32 max_batch = TX_BATCH_SIZE;
 	bool sent_frame = false;
+	bool stop = false;
 	struct xdp_desc desc;
 	struct sk_buff *skb;
 	unsigned long flags;
-	int err = 0;
+	int err = 0, xerr;
+	u32 n;
 
 	mutex_lock(&xs->mutex);
 
@@ -547,58 +684,68 @@ static int xsk_generic_xmit(struct sock *sk)
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
-		if (max_batch-- == 0) {
-			err = -EAGAIN;
-			goto out;
-		}
+	while (!stop) {
+		for (n = 0; n < XSK_GENERIC_XMIT_BURST; n++) {
+			/* Only the first read of a burst may publish the
+			 * consumer pointer, the rest may still be unwound.
+			 */
+			if (!(n ? xskq_cons_peek_desc_nopublish(xs->tx, &desc,
+								xs->pool) :
+				  xskq_cons_peek_desc(xs->tx, &desc, xs->pool))) {
+				xs->tx->queue_empty_descs++;
+				stop = true;
+				break;
+			}
 
-		/* This is the backpressure mechanism for the Tx path.
-		 * Reserve space in the completion queue and only proceed
-		 * if there is space in it. This avoids having to implement
-		 * any buffering in the Tx path.
-		 */
-		spin_lock_irqsave(&xs->pool->cq_lock, flags);
-		if (xskq_prod_reserve(xs->pool->cq)) {
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
-		}
-		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+			if (max_batch-- == 0) {
+				err = -EAGAIN;
+				stop = true;
+				break;
+			}
 
-		skb = xsk_build_skb(xs, &desc);
-		if (IS_ERR(skb)) {
-			err = PTR_ERR(skb);
+			/* This is the backpressure mechanism for the Tx path.
+			 * Reserve space in the completion queue and only proceed
+			 * if there is space in it. This avoids having to implement
+			 * any buffering in the Tx path.
+			 */
 			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
+			if (xskq_prod_reserve(xs->pool->cq)) {
+				spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+				stop = true;
+				break;
+			}
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
-		}
 
-		err = __dev_direct_xmit(skb, xs->queue_id);
-		if  (err == NETDEV_TX_BUSY) {
-			/* Tell user-space to retry the send */
-			skb->destructor = sock_wfree;
-			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			/* Free skb without triggering the perf drop trace */
-			consume_skb(skb);
-			err = -EAGAIN;
-			goto out;
-		}
+			skb = xsk_build_skb(xs, &desc);
+			if (IS_ERR(skb)) {
+				err = PTR_ERR(skb);
+				spin_lock_irqsave(&xs->pool->cq_lock, flags);
+				xskq_prod_cancel(xs->pool->cq);
+				spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+				stop = true;
+				break;
+			}
 
-		xskq_cons_release(xs->tx);
-		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			goto out;
+			cons[n] = xs->tx->cached_cons;
+			xskq_cons_release(xs->tx);
+			skbs[n] = skb;
 		}
 
-		sent_frame = true;
+		if (!n)
+			break;
+
+		if (xsk_generic_xmit_burst(xs, skbs, cons, n, &xerr))
+			sent_frame = true;
+		if (xerr) {
+			err = xerr;
+			break;
+		}
 	}
 
-	xs->tx->queue_empty_descs++;
+	/* The burst reads do not publish the consumer pointer, so do it here
+	 * in case the ring ran empty or a burst ended early.
+	 */
+	__xskq_cons_release(xs->tx);
 
 out:
 	if (sent_frame)
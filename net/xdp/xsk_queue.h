@@ -286,6 +286,24 @@ static inline bool xskq_cons_peek_desc(struct xsk_queue *q,
 	return xskq_cons_read_desc(q, desc, pool);
 }
 
+/* Like xskq_cons_peek_desc(), but never publishes the consumer pointer, so
+ * everything read since the last publish can still be handed back with
+ * xskq_cons_rewind().
+ */
+static inline bool xskq_cons_peek_desc_nopublish(struct xsk_queue *q,
+						 struct xdp_desc *desc,
+						 struct xsk_buff_pool *pool)
+{
+	if (q->cached_prod == q->cached_cons)
+		__xskq_cons_peek(q);
+	return xskq_cons_read_desc(q, desc, pool);
+}
+
+static inline void xskq_cons_rewind(struct xsk_queue *q, u32 cached_cons)
+{
+	q->cached_cons = cached_cons;
+}
+
 /* To improve performance in the xskq_cons_release functions, only update local state here.
  * Reflect this to global state when we get new entries from the ring in
  * xskq_cons_get_entries() and whenever Rx or Tx processing are completed in the NAPI loop.
@@ -26,6 +26,7 @@
 #include <linux/slab.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
+#include <linux/hash.h>
 
 #include <crypto/aead.h>
 
@@ -675,6 +676,73 @@ void __xfrm_state_destroy(struct xfrm_state *x, bool sync)
 }
 EXPORT_SYMBOL(__xfrm_state_destroy);
 
+/*
+ * Per-CPU cache of the SA that xfrm_state_find() last picked for a policy
+ * template, so that resolving bundles for a busy policy does not have to walk
+ * the bydst chains every time. Entries hold no reference: they are only
+ * trusted while xfrm_state_lookup_cache_genid is unchanged, and that is
+ * bumped whenever a state is inserted or deleted, i.e. before a cached state
+ * can be freed and whenever a better candidate may have shown up.
+ */
+#define XFRM_STATE_LOOKUP_CACHE_BITS	4
+
+struct xfrm_state_lookup_cache {
+	struct {
+		const struct xfrm_policy	*pol;
+		const struct xfrm_tmpl		*tmpl;
+		struct xfrm_state		*x;
+		unsigned int			genid;
+	} ent[1 << XFRM_STATE_LOOKUP_CACHE_BITS];
+};
+
+static DEFINE_PER_CPU(struct xfrm_state_lookup_cache, xfrm_state_lookup_cache);
+static atomic_t xfrm_state_lookup_cache_genid;
+
+static void xfrm_state_lookup_cache_invalidate(void)
+{
+	/*
+	 * Order the caller's km.state and hash updates before the bump, so
+	 * that a lookup which samples the new genid cannot pick a dead state.
+	 */
+	smp_mb__before_atomic();
+	atomic_inc(&xfrm_state_lookup_cache_genid);
+}
+
+/* Must be called under rcu_read_lock(); the result is only valid inside. */
+static struct xfrm_state *
+xfrm_state_lookup_cache_get(const struct xfrm_policy *pol,
+			    const struct xfrm_tmpl *tmpl)
+{
+	unsigned int i = hash_ptr(tmpl, XFRM_STATE_LOOKUP_CACHE_BITS);
+	struct xfrm_state_lookup_cache *c;
+	struct xfrm_state *x = NULL;
+
+	local_bh_disable();
+	c = this_cpu_ptr(&xfrm_state_lookup_cache);
+	if (c->ent[i].pol == pol && c->ent[i].tmpl == tmpl &&
+	    c->ent[i].genid == atomic_read(&xfrm_state_lookup_cache_genid))
+		x = c->ent[i].x;
+	local_bh_enable();
+
+	return x;
+}
+
+static void xfrm_state_lookup_cache_set(const struct xfrm_policy *pol,
+					const struct xfrm_tmpl *tmpl,
+					struct xfrm_state *x, unsigned int genid)
+{
+	unsigned int i = hash_ptr(tmpl, XFRM_STATE_LOOKUP_CACHE_BITS);
+	struct xfrm_state_lookup_cache *c;
+
+	local_bh_disable();
+	c = this_cpu_ptr(&xfrm_state_lookup_cache);
+	c->ent[i].pol = pol;
+	c->ent[i].tmpl = tmpl;
+	c->ent[i].x = x;
+	c->ent[i].genid = genid;
+	local_bh_enable();
+}
+
 int __xfrm_state_delete(struct xfrm_state *x)
 {
 	struct net *net = xs_net(x);
@@ -691,6 +759,7 @@ int __xfrm_state_delete(struct xfrm_state *x)
 		if (x->id.spi)
 			hlist_del_rcu(&x->byspi);
 		net->xfrm.state_num--;
+		xfrm_state_lookup_cache_invalidate();
 		spin_unlock(&net->xfrm.xfrm_state_lock);
 
 		if (x->encap_sk)
@@ -1083,12 +1152,36 @@ xfrm_state_find(const xfrm_address_t *daddr, const xfrm_address_t *saddr,
 	unsigned short encap_family = tmpl->encap_family;
 	unsigned int sequence;
 	struct km_event c;
+	unsigned int genid;
 
 	to_put = NULL;
 
 	sequence = read_seqcount_begin(&net->xfrm.xfrm_state_hash_generation);
 
+	/* sample before the walk, so that whatever it finds is covered */
+	genid = atomic_read(&xfrm_state_lookup_cache_genid);
+	smp_rmb();
+
 	rcu_read_lock();
+	x = xfrm_state_lookup_cache_get(pol, tmpl);
+	/* the policy may have been freed and reused in another netns */
+	if (x && net_eq(xs_net(x), net) &&
+	    x->km.state == XFRM_STATE_VALID && !x->km.dying &&
+	    x->props.family == encap_family &&
+	    x->props.reqid == tmpl->reqid &&
+	    (mark & x->mark.m) == x->mark.v &&
+	    x->if_id == if_id &&
+	    !(x->props.flags & XFRM_STATE_WILDRECV) &&
+	    xfrm_state_addr_check(x, daddr, saddr, encap_family) &&
+	    tmpl->mode == x->props.mode &&
+	    tmpl->id.proto == x->id.proto &&
+	    (tmpl->id.spi == x->id.spi || !tmpl->id.spi)) {
+		xfrm_state_look_at(pol, x, fl, family,
+				   &best, &acquire_in_progress, &error);
+		if (best)
+			goto out;
+	}
+
 	h = xfrm_dst_hash(net, daddr, saddr, tmpl->reqid, encap_family);
 	hlist_for_each_entry_rcu(x, net->xfrm.state_bydst + h, bydst) {
 		if (x->props.family == encap_family &&
@@ -1123,6 +1216,8 @@ xfrm_state_find(const xfrm_address_t *daddr, const xfrm_address_t *saddr,
 
 found:
 	x = best;
+	if (x)
+		xfrm_state_lookup_cache_set(pol, tmpl, x, genid);
 	if (!x && !error && !acquire_in_progress) {
 		if (tmpl->id.spi &&
 		    (x0 = __xfrm_state_lookup(net, mark, daddr, tmpl->id.spi,
@@ -1305,6 +1400,7 @@ static void __xfrm_state_insert(struct xfrm_state *x)
 		mod_timer(&x->rtimer, jiffies + x->replay_maxage);
 
 	net->xfrm.state_num++;
+	xfrm_state_lookup_cache_invalidate();
 
 	xfrm_hash_grow_check(net, x->bydst.next != NULL);
 }
@@ -141,7 +141,13 @@ static void dmaengine_pcm_dma_complete(void *arg)
 		new_pos = 0;
 	prtd->pos = new_pos;
 
-	snd_pcm_period_elapsed(substream);
+	/*
+	 * Not every DMA controller can leave out the interrupt at the end of
+	 * a cyclic period. If the application asked for no period wakeups it
+	 * schedules itself based on the pointer, so don't wake it up here.
+	 */
+	if (!substream->runtime->no_period_wakeup)
+		snd_pcm_period_elapsed(substream);
 }
 
 static int dmaengine_pcm_prepare_and_submit(struct snd_pcm_substream *substream)
@@ -32,7 +32,8 @@ int samsung_asoc_dma_platform_register(struct device *dev, dma_filter_fn filter,
 	pcm_conf->chan_names[SNDRV_PCM_STREAM_CAPTURE] = rx;
 
 	return devm_snd_dmaengine_pcm_register(dev, pcm_conf,
-				SND_DMAENGINE_PCM_FLAG_COMPAT);
+				SND_DMAENGINE_PCM_FLAG_COMPAT |
+				SND_DMAENGINE_PCM_FLAG_NO_PERIOD_WAKEUP);
 }
 EXPORT_SYMBOL_GPL(samsung_asoc_dma_platform_register);
 
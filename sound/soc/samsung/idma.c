@@ -32,7 +32,7 @@ static const struct snd_pcm_hardware idma_hardware = {
 	.period_bytes_min = 128,
 	.period_bytes_max = MAX_IDMA_PERIOD,
 	.periods_min = 1,
-	.periods_max = 2,
+	.periods_max = MAX_IDMA_PERIODS,
 };
 
 struct idma_ctrl {
@@ -260,26 +260,36 @@ static int idma_mmap(struct snd_soc_component *component,
 static irqreturn_t iis_irq(int irqno, void *dev_id)
 {
 	struct idma_ctrl *prtd = (struct idma_ctrl *)dev_id;
-	u32 iisahb, val, addr;
+	u32 iisahb, val, addr, size;
+	dma_addr_t pos;
 
 	iisahb  = readl(idma.regs + I2SAHB);
 
 	val = (iisahb & AHB_LVL0INT) ? AHB_CLRLVL0INT : 0;
+	if (!val)
+		return IRQ_NONE;
 
-	if (val) {
-		iisahb |= val;
-		writel(iisahb, idma.regs + I2SAHB);
+	iisahb |= val;
+	writel(iisahb, idma.regs + I2SAHB);
 
-		addr = readl(idma.regs + I2SLVL0ADDR) - idma.lp_tx_addr;
-		addr += prtd->periodsz;
-		addr %= (u32)(prtd->end - prtd->start);
-		addr += idma.lp_tx_addr;
+	/*
+	 * Arm the next period boundary after the current transfer
+	 * position rather than one period after the previous one. With
+	 * sub-millisecond periods the interrupt may be serviced late, and
+	 * a level address that is already behind the DMA would only fire
+	 * again after the whole buffer has wrapped.
+	 */
+	size = prtd->end - prtd->start;
+	idma_getpos(&pos);
+	addr = pos - idma.lp_tx_addr;
+	addr = (addr / prtd->periodsz + 1) * prtd->periodsz;
+	addr %= size;
+	addr += idma.lp_tx_addr;
 
-		writel(addr, idma.regs + I2SLVL0ADDR);
+	writel(addr, idma.regs + I2SLVL0ADDR);
 
-		if (prtd->cb)
-			prtd->cb(prtd->token, prtd->period);
-	}
+	if (prtd->cb)
+		prtd->cb(prtd->token, prtd->period);
 
 	return IRQ_HANDLED;
 }
@@ -293,6 +303,21 @@ static int idma_open(struct snd_soc_component *component,
 
 	snd_soc_set_runtime_hwparams(substream, &idma_hardware);
 
+	/*
+	 * The level 0 interrupt address walks the buffer in period steps,
+	 * so the buffer must be a whole number of periods. The transfer
+	 * counter has word granularity.
+	 */
+	ret = snd_pcm_hw_constraint_integer(runtime,
+					    SNDRV_PCM_HW_PARAM_PERIODS);
+	if (ret < 0)
+		return ret;
+
+	ret = snd_pcm_hw_constraint_step(runtime, 0,
+					 SNDRV_PCM_HW_PARAM_PERIOD_BYTES, 4);
+	if (ret < 0)
+		return ret;
+
 	prtd = kzalloc(sizeof(struct idma_ctrl), GFP_KERNEL);
 	if (prtd == NULL)
 		return -ENOMEM;
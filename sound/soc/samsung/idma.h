@@ -15,5 +15,6 @@ extern void idma_reg_addr_init(void __iomem *regs, dma_addr_t addr);
 
 #define MAX_IDMA_PERIOD (128 * 1024)
 #define MAX_IDMA_BUFFER (160 * 1024)
+#define MAX_IDMA_PERIODS 64
 
 #endif /* __SND_SOC_SAMSUNG_IDMA_H_ */
@@ -109,6 +109,7 @@ dmaengine_pcm_set_runtime_hwparams(struct snd_soc_component *component,
 	struct device *dma_dev = dmaengine_dma_dev(pcm, substream);
 	struct dma_chan *chan = pcm->chan[substream->stream];
 	struct snd_dmaengine_dai_dma_data *dma_data;
+	struct dma_slave_caps dma_caps;
 	struct snd_pcm_hardware hw;
 
 	if (rtd->num_cpus > 1) {
@@ -146,6 +147,13 @@ dmaengine_pcm_set_runtime_hwparams(struct snd_soc_component *component,
 						  &hw,
 						  chan);
 
+	/* Without period interrupts the pointer must be sample accurate */
+	if ((pcm->flags & SND_DMAENGINE_PCM_FLAG_NO_PERIOD_WAKEUP) &&
+	    !(hw.info & SNDRV_PCM_INFO_BATCH) && chan &&
+	    !dma_get_slave_caps(chan, &dma_caps) &&
+	    dma_caps.residue_granularity == DMA_RESIDUE_GRANULARITY_BURST)
+		hw.info |= SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
+
 	return snd_soc_set_runtime_hwparams(substream, &hw);
 }
 
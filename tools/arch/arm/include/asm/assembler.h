@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Subset of arch/arm/include/asm/assembler.h needed to build the
+ * tools/arch/arm/lib string routines in user space, in ARM state.
+ */
+#ifndef __TOOLS_ASM_ASSEMBLER_H__
+#define __TOOLS_ASM_ASSEMBLER_H__
+
+#ifndef __ASSEMBLY__
+#error "Only include this from assembly code"
+#endif
+
+#ifndef __ARMEB__
+#define lspull          lsr
+#define lspush          lsl
+#else
+#define lspull          lsl
+#define lspush          lsr
+#endif
+
+#define PLD(code...)	code
+#define CALGN(code...)
+#define W(instr)	instr
+
+	.macro	ret, reg
+	bx	\reg
+	.endm
+
+#endif /* __TOOLS_ASM_ASSEMBLER_H__ */
@@ -0,0 +1,8 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __TOOLS_ASM_UNWIND_H
+#define __TOOLS_ASM_UNWIND_H
+
+/* No kernel unwind tables in user space */
+#define UNWIND(code...)
+
+#endif /* __TOOLS_ASM_UNWIND_H */
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/time.h>
 #include <errno.h>
 #include <linux/time64.h>
@@ -33,6 +34,7 @@ static const char	*function_str	= "all";
 static int		nr_loops	= 1;
 static bool		use_cycles;
 static int		cycles_fd;
+static bool		use_l2c;
 
 static const struct option options[] = {
 	OPT_STRING('s', "size", &size_str, "1MB",
@@ -48,6 +50,9 @@ static const struct option options[] = {
 	OPT_BOOLEAN('c', "cycles", &use_cycles,
 		    "Use a cycles event instead of gettimeofday() to measure performance"),
 
+	OPT_BOOLEAN('L', "l2c", &use_l2c,
+		    "Report L2C-310 hit rate and write-back bandwidth (needs system wide counters)"),
+
 	OPT_END()
 };
 
@@ -96,6 +101,169 @@ static double timeval2double(struct timeval *ts)
 	return (double)ts->tv_sec + (double)ts->tv_usec / (double)USEC_PER_SEC;
 }
 
+/*
+ * The L2C-310 counters are a system wide resource, exposed by the
+ * l2c_310 PMU on the single CPU listed in its cpumask, so what they
+ * report includes anything else running during the measured loop.
+ * The PMU only has two counters, so the five events below are
+ * multiplexed and their counts scaled to the time they were enabled.
+ */
+#define L2C_PMU_PATH	"/sys/bus/event_source/devices/l2c_310/"
+#define L2C_LINE_SIZE	32
+
+enum {
+	L2C_DRHIT,
+	L2C_DRREQ,
+	L2C_DWHIT,
+	L2C_DWREQ,
+	L2C_CO,
+	L2C_NR_EVENTS,
+};
+
+/* Event encodings, see arch/arm/mm/cache-l2x0-pmu.c */
+static const u64 l2c_events[L2C_NR_EVENTS] = {
+	[L2C_DRHIT]	= 0x2,
+	[L2C_DRREQ]	= 0x3,
+	[L2C_DWHIT]	= 0x4,
+	[L2C_DWREQ]	= 0x5,
+	[L2C_CO]	= 0x1,
+};
+
+static int l2c_type, l2c_cpu;
+static int l2c_fd[L2C_NR_EVENTS] = { -1, -1, -1, -1, -1 };
+static u64 l2c_count[L2C_NR_EVENTS];
+static struct timeval l2c_tv_start, l2c_tv_end;
+
+static int l2c_read_sysfs_int(const char *name, int *val)
+{
+	FILE *f = fopen(name, "r");
+	int ret;
+
+	if (!f)
+		return -1;
+	/* cpumask is a cpu list, the PMU only ever uses one CPU */
+	ret = fscanf(f, "%d", val) == 1 ? 0 : -1;
+	fclose(f);
+
+	return ret;
+}
+
+static void l2c_close(void)
+{
+	int i;
+
+	for (i = 0; i < L2C_NR_EVENTS; i++) {
+		if (l2c_fd[i] >= 0)
+			close(l2c_fd[i]);
+		l2c_fd[i] = -1;
+	}
+}
+
+static int l2c_open(void)
+{
+	struct perf_event_attr attr = {
+		.type		= l2c_type,
+		.size		= sizeof(attr),
+		.disabled	= 1,
+		.read_format	= PERF_FORMAT_TOTAL_TIME_ENABLED |
+				  PERF_FORMAT_TOTAL_TIME_RUNNING,
+	};
+	int i;
+
+	for (i = 0; i < L2C_NR_EVENTS; i++) {
+		attr.config = l2c_events[i];
+		l2c_fd[i] = sys_perf_event_open(&attr, -1, l2c_cpu, -1, perf_event_open_cloexec_flag());
+		if (l2c_fd[i] < 0) {
+			pr_debug("Failed to open l2c_310 event 0x%llx: %s\n",
+				 (unsigned long long)l2c_events[i], strerror(errno));
+			l2c_close();
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int init_l2c(void)
+{
+	if (l2c_read_sysfs_int(L2C_PMU_PATH "type", &l2c_type) ||
+	    l2c_read_sysfs_int(L2C_PMU_PATH "cpumask", &l2c_cpu)) {
+		pr_debug("No l2c_310 PMU found\n");
+		return -1;
+	}
+
+	/* The events are opened for each measurement, check that they can be */
+	if (l2c_open() < 0)
+		return -1;
+	l2c_close();
+
+	return 0;
+}
+
+static void l2c_start(void)
+{
+	int i;
+
+	if (!use_l2c)
+		return;
+
+	BUG_ON(l2c_open() < 0);
+	BUG_ON(gettimeofday(&l2c_tv_start, NULL));
+	for (i = 0; i < L2C_NR_EVENTS; i++)
+		ioctl(l2c_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static void l2c_stop(void)
+{
+	/* value, time enabled, time running */
+	u64 val[3];
+	int i, ret;
+
+	if (!use_l2c)
+		return;
+
+	for (i = 0; i < L2C_NR_EVENTS; i++)
+		ioctl(l2c_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+	BUG_ON(gettimeofday(&l2c_tv_end, NULL));
+
+	for (i = 0; i < L2C_NR_EVENTS; i++) {
+		ret = read(l2c_fd[i], val, sizeof(val));
+		BUG_ON(ret != sizeof(val));
+		l2c_count[i] = val[2] ? (u64)((double)val[0] * val[1] / val[2]) : 0;
+	}
+
+	l2c_close();
+}
+
+static void print_l2c(void)
+{
+	u64 hits = l2c_count[L2C_DRHIT] + l2c_count[L2C_DWHIT];
+	u64 reqs = l2c_count[L2C_DRREQ] + l2c_count[L2C_DWREQ];
+	double hit_rate = reqs ? 100.0 * hits / reqs : 0.0;
+	double wb_bps, secs;
+	struct timeval tv_diff;
+
+	timersub(&l2c_tv_end, &l2c_tv_start, &tv_diff);
+	secs = timeval2double(&tv_diff);
+	wb_bps = secs > 0.0 ? (double)l2c_count[L2C_CO] * L2C_LINE_SIZE / secs : 0.0;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14lf%% L2C data hit rate (%llu/%llu)\n", hit_rate,
+		       (unsigned long long)hits, (unsigned long long)reqs);
+		printf(" %14lf MB/sec L2C write-back\n", wb_bps / K / K);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lf\n%lf\n", hit_rate, wb_bps);
+		break;
+
+	default:
+		BUG_ON(1);
+		break;
+	}
+}
+
 #define print_bps(x) do {						\
 		if (x < K)						\
 			printf(" %14lf bytes/sec\n", x);		\
@@ -164,6 +332,9 @@ static void __bench_mem_function(struct bench_mem_info *info, int r_idx, size_t
 		break;
 	}
 
+	if (use_l2c)
+		print_l2c();
+
 out_free:
 	free(src);
 	free(dst);
@@ -189,6 +360,11 @@ static int bench_mem_common(int argc, const char **argv, struct bench_mem_info *
 		}
 	}
 
+	if (use_l2c && init_l2c() < 0) {
+		fprintf(stderr, "Failed to open l2c_310 counters\n");
+		return -1;
+	}
+
 	size = (size_t)perf_atoll((char *)size_str);
 	size_total = (double)size * nr_loops;
 
@@ -243,10 +419,12 @@ static u64 do_memcpy_cycles(const struct function *r, size_t size, void *src, vo
 
 	memcpy_prefault(fn, size, src, dst);
 
+	l2c_start();
 	cycle_start = get_cycles();
 	for (i = 0; i < nr_loops; ++i)
 		fn(dst, src, size);
 	cycle_end = get_cycles();
+	l2c_stop();
 
 	return cycle_end - cycle_start;
 }
@@ -259,10 +437,12 @@ static double do_memcpy_gettimeofday(const struct function *r, size_t size, void
 
 	memcpy_prefault(fn, size, src, dst);
 
+	l2c_start();
 	BUG_ON(gettimeofday(&tv_start, NULL));
 	for (i = 0; i < nr_loops; ++i)
 		fn(dst, src, size);
 	BUG_ON(gettimeofday(&tv_end, NULL));
+	l2c_stop();
 
 	timersub(&tv_end, &tv_start, &tv_diff);
 
@@ -278,6 +458,12 @@ struct function memcpy_functions[] = {
 # define MEMCPY_FN(_fn, _name, _desc) {.name = _name, .desc = _desc, .fn.memcpy = _fn},
 # include "mem-memcpy-x86-64-asm-def.h"
 # undef MEMCPY_FN
+#endif
+
+#ifdef __arm__
+# define MEMCPY_FN(_fn, _name, _desc) {.name = _name, .desc = _desc, .fn.memcpy = _fn},
+# include "mem-memcpy-arm-asm-def.h"
+# undef MEMCPY_FN
 #endif
 
 	{ .name = NULL, }
@@ -313,10 +499,12 @@ static u64 do_memset_cycles(const struct function *r, size_t size, void *src __m
 	 */
 	fn(dst, -1, size);
 
+	l2c_start();
 	cycle_start = get_cycles();
 	for (i = 0; i < nr_loops; ++i)
 		fn(dst, i, size);
 	cycle_end = get_cycles();
+	l2c_stop();
 
 	return cycle_end - cycle_start;
 }
@@ -333,10 +521,12 @@ static double do_memset_gettimeofday(const struct function *r, size_t size, void
 	 */
 	fn(dst, -1, size);
 
+	l2c_start();
 	BUG_ON(gettimeofday(&tv_start, NULL));
 	for (i = 0; i < nr_loops; ++i)
 		fn(dst, i, size);
 	BUG_ON(gettimeofday(&tv_end, NULL));
+	l2c_stop();
 
 	timersub(&tv_end, &tv_start, &tv_diff);
 
@@ -357,6 +547,12 @@ static const struct function memset_functions[] = {
 # define MEMSET_FN(_fn, _name, _desc) { .name = _name, .desc = _desc, .fn.memset = _fn },
 # include "mem-memset-x86-64-asm-def.h"
 # undef MEMSET_FN
+#endif
+
+#ifdef __arm__
+# define MEMSET_FN(_fn, _name, _desc) { .name = _name, .desc = _desc, .fn.memset = _fn },
+# include "mem-memset-arm-asm-def.h"
+# undef MEMSET_FN
 #endif
 
 	{ .name = NULL, }
@@ -11,3 +11,13 @@
 
 #endif
 
+#ifdef __arm__
+
+#define MEMCPY_FN(fn, name, desc)		\
+	void *fn(void *, const void *, size_t);
+
+#include "mem-memcpy-arm-asm-def.h"
+
+#undef MEMCPY_FN
+
+#endif
@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+MEMCPY_FN(__memcpy,
+	"arm-ldm",
+	"ldm/stm-based memcpy() in arch/arm/lib/memcpy.S")
+
+MEMCPY_FN(memcpy_neon_bench,
+	"arm-neon",
+	"NEON bulk loop in arch/arm/lib/neon-memcpy-core.S, tail by memcpy.S")
@@ -11,3 +11,13 @@
 
 #endif
 
+#ifdef __arm__
+
+#define MEMSET_FN(fn, name, desc)		\
+	void *fn(void *, int, size_t);
+
+#include "mem-memset-arm-asm-def.h"
+
+#undef MEMSET_FN
+
+#endif
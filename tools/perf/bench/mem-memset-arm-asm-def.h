@@ -0,0 +1,5 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+MEMSET_FN(__memset,
+	"arm-stm",
+	"stm-based memset() in arch/arm/lib/memset.S")
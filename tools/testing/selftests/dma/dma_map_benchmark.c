@@ -23,12 +23,28 @@
 #define DMA_MAP_TO_DEVICE	1
 #define DMA_MAP_FROM_DEVICE	2
 
+#define DMA_MAP_SINGLE_MODE	0
+#define DMA_MAP_SG_MODE		1
+#define DMA_MAP_SYNC_MODE	2
+
+#define DMA_MAP_MAX_NENTS	256
+
+#define DMA_MAP_BENCHMARK_F_IOMMU	(1U << 0)
+
+#define DMA_MAP_HIST_BUCKETS	32
+
 static char *directions[] = {
 	"BIDIRECTIONAL",
 	"TO_DEVICE",
 	"FROM_DEVICE",
 };
 
+static char *modes[] = {
+	"single",
+	"sg",
+	"sync",
+};
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -41,9 +57,32 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule; /* how many PAGE_SIZE will do map/unmap once a time */
-	__u8 expansion[76];	/* For future use */
+	__u32 mode; /* what to measure, DMA_MAP_*_MODE */
+	__u32 nents; /* sg entries of granule pages each in DMA_MAP_SG_MODE */
+	__u32 flags; /* DMA_MAP_BENCHMARK_F_*, set by the kernel */
+	__u64 hist_addr; /* user buffer for __u64 [2][DMA_MAP_HIST_BUCKETS] */
+	__u8 expansion[56];	/* For future use */
 };
 
+static void print_hist(const char *name, __u64 *hist)
+{
+	int i;
+
+	printf("%s latency histogram(ns):\n", name);
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		if (i == 0)
+			printf("%12s %12d: %llu\n", "", 0, hist[i]);
+		else if (i == DMA_MAP_HIST_BUCKETS - 1)
+			printf("%12lu %12s: %llu\n", 1UL << (i - 1), "-",
+			       hist[i]);
+		else
+			printf("%12lu %12lu: %llu\n", 1UL << (i - 1),
+			       (1UL << i) - 1, hist[i]);
+	}
+}
+
 int main(int argc, char **argv)
 {
 	struct map_benchmark map;
@@ -54,11 +93,14 @@ int main(int argc, char **argv)
 	int bits = 32, xdelay = 0, dir = DMA_MAP_BIDIRECTIONAL;
 	/* default granule 1 PAGESIZE */
 	int granule = 1;
+	/* default dma_map_single, one sg entry, no histograms */
+	int mode = DMA_MAP_SINGLE_MODE, nents = 1, histogram = 0;
+	__u64 hist[2][DMA_MAP_HIST_BUCKETS];
 
 	int cmd = DMA_MAP_BENCHMARK;
 	char *p;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:m:e:H")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -81,6 +123,15 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'm':
+			mode = atoi(optarg);
+			break;
+		case 'e':
+			nents = atoi(optarg);
+			break;
+		case 'H':
+			histogram = 1;
+			break;
 		default:
 			return -1;
 		}
@@ -121,6 +172,18 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (mode != DMA_MAP_SINGLE_MODE && mode != DMA_MAP_SG_MODE &&
+			mode != DMA_MAP_SYNC_MODE) {
+		fprintf(stderr, "invalid mode\n");
+		exit(1);
+	}
+
+	if (nents < 1 || nents > DMA_MAP_MAX_NENTS) {
+		fprintf(stderr, "invalid number of sg entries, must be in 1-%d\n",
+			DMA_MAP_MAX_NENTS);
+		exit(1);
+	}
+
 	fd = open("/sys/kernel/debug/dma_map_benchmark", O_RDWR);
 	if (fd == -1) {
 		perror("open");
@@ -135,6 +198,10 @@ int main(int argc, char **argv)
 	map.dma_dir = dir;
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
+	map.mode = mode;
+	map.nents = nents;
+	if (histogram)
+		map.hist_addr = (__u64)(unsigned long)hist;
 
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
@@ -143,10 +210,20 @@ int main(int argc, char **argv)
 
 	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d\n",
 			threads, seconds, node, dir[directions], granule);
+	printf("mode:%s nents:%d iommu:%s\n", modes[mode],
+			mode == DMA_MAP_SG_MODE ? nents : 1,
+			map.flags & DMA_MAP_BENCHMARK_F_IOMMU ? "yes" : "no");
 	printf("average map latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
 
+	if (histogram) {
+		print_hist(mode == DMA_MAP_SYNC_MODE ? "sync for device" : "map",
+			   hist[0]);
+		print_hist(mode == DMA_MAP_SYNC_MODE ? "sync for cpu" : "unmap",
+			   hist[1]);
+	}
+
 	return 0;
 }